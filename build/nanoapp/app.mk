@@ -130,6 +130,12 @@ COMMON_CFLAGS += -DCHRE_NANOAPP_TOKENIZED_LOGGING_ENABLED
 include $(CHRE_PREFIX)/external/pigweed/pw_tokenizer.mk
 endif
 
+# Optional profiling of nanoapp scopes, see util/nanoapp/profiler.h ###########
+
+ifneq ($(CHRE_NANOAPP_PROFILING_ENABLED),)
+COMMON_CFLAGS += -DCHRE_NANOAPP_PROFILING_ENABLED
+endif
+
 # Variant-specific Nanoapp Support Source Files ################################
 
 APP_SUPPORT_PATH = $(CHRE_PREFIX)/build/app_support
@@ -44,10 +44,15 @@ $(error "You should supply an ANDROID_BUILD_TOP environment variable \
 endif
 export GOOGLETEST_PREFIX=$(ANDROID_BUILD_TOP)/external/googletest
 include $(CHRE_PREFIX)/build/arch/x86.mk
+include $(CHRE_PREFIX)/platform/shared/mbedtls/mbedtls.mk
 
 TARGET_CFLAGS += $(GOOGLETEST_CFLAGS)
 TARGET_CFLAGS += $(GOOGLE_X86_GOOGLETEST_CFLAGS)
 
+# MbedTLS is used by the shared nanoapp authentication code.
+TARGET_CFLAGS += $(MBEDTLS_CFLAGS)
+TARGET_VARIANT_SRCS += $(MBEDTLS_SRCS)
+
 # Instruct the build to link a final executable.
 TARGET_BUILD_BIN = true
 
@@ -20,6 +20,7 @@ COMMON_SRCS += $(CHRE_PREFIX)/core/init.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/log.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/nanoapp.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/settings.cc
+COMMON_SRCS += $(CHRE_PREFIX)/core/shared_payload.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/static_nanoapps.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/system_health_monitor.cc
 COMMON_SRCS += $(CHRE_PREFIX)/core/timer_pool.cc
@@ -62,6 +63,17 @@ ifeq ($(CHRE_WWAN_SUPPORT_ENABLED), true)
 COMMON_SRCS += $(CHRE_PREFIX)/core/wwan_request_manager.cc
 endif
 
+# Optional watchdog timing the handling of each event by nanoapps.
+ifeq ($(CHRE_EVENT_LOOP_WATCHDOG_ENABLED), true)
+COMMON_SRCS += $(CHRE_PREFIX)/core/event_loop_watchdog.cc
+COMMON_CFLAGS += -DCHRE_EVENT_LOOP_WATCHDOG_ENABLED
+endif
+
+# Optional batching of the messages sent by nanoapps to the host.
+ifeq ($(CHRE_HOST_MESSAGE_BATCHING_ENABLED), true)
+COMMON_CFLAGS += -DCHRE_HOST_MESSAGE_BATCHING_ENABLED
+endif
+
 # Optional Telemetry support.
 ifeq ($(CHRE_TELEMETRY_SUPPORT_ENABLED), true)
 COMMON_SRCS += $(CHRE_PREFIX)/core/telemetry_manager.cc
@@ -80,6 +92,7 @@ endif
 
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/audio_util_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/ble_request_test.cc
+GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/event_dispatch_table_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/memory_manager_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/request_multiplexer_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/core/tests/sensor_request_test.cc
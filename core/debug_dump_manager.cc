@@ -93,6 +93,7 @@ void DebugDumpManager::collectFrameworkDebugDumps() {
   eventLoopManager->getBleRequestManager().logStateToBuffer(mDebugDump);
 #endif  // CHRE_BLE_SUPPORT_ENABLED
   eventLoopManager->getSettingManager().logStateToBuffer(mDebugDump);
+  eventLoopManager->getHostCommsManager().logStateToBuffer(mDebugDump);
   logStateToBuffer(mDebugDump);
 }
 
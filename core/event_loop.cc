@@ -26,6 +26,7 @@
 #include "chre/platform/context.h"
 #include "chre/platform/fatal_error.h"
 #include "chre/platform/system_time.h"
+#include "chre/platform/tracing.h"
 #include "chre/util/conditional_lock_guard.h"
 #include "chre/util/lock_guard.h"
 #include "chre/util/system/debug_dump.h"
@@ -145,7 +146,22 @@ void EventLoop::invokeMessageFreeFunction(uint64_t appId,
 void EventLoop::run() {
   LOGI("EventLoop start");
 
+  // The number of events to distribute before the next scheduled nanoapp is
+  // started.
+  size_t numEventsBeforeNextStart = 0;
   while (mRunning) {
+    if (!mPendingNanoappStarts.empty() &&
+        (numEventsBeforeNextStart == 0 || mEvents.empty())) {
+      startPendingNanoapp();
+      // Interleave the events pending now, including the ones posted by the
+      // nanoapp that just started, with the start of the next nanoapp
+      numEventsBeforeNextStart = mEvents.size();
+      continue;
+    }
+    if (numEventsBeforeNextStart > 0) {
+      numEventsBeforeNextStart--;
+    }
+
     // Events are delivered in a single stage: they arrive in the inbound event
     // queue mEvents (potentially posted from another thread), then within
     // this context these events are distributed to all interested Nanoapps,
@@ -156,7 +172,13 @@ void EventLoop::run() {
     Event *event = mEvents.pop();
     // Need size() + 1 since the to-be-processed event has already been removed.
     mPowerControlManager.preEventLoopProcess(mEvents.size() + 1);
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+    mWatchdog.onLoopPassStart(event->eventType);
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
     distributeEvent(event);
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+    mWatchdog.onLoopPassEnd(!mEvents.empty());
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
 
     mPowerControlManager.postEventLoopProcess(mEvents.size());
   }
@@ -168,7 +190,8 @@ void EventLoop::run() {
     freeEvent(mEvents.pop());
   }
 
-  // Unload all running nanoapps
+  // Drop the nanoapps which never started, then unload all running nanoapps
+  mPendingNanoappStarts.clear();
   while (!mNanoapps.empty()) {
     unloadNanoappAtIndex(mNanoapps.size() - 1);
   }
@@ -195,6 +218,11 @@ bool EventLoop::startNanoapp(UniquePtr<Nanoapp> &nanoapp) {
                                                     &existingInstanceId)) {
     LOGE("App with ID 0x%016" PRIx64 " already exists as instance ID %" PRIu16,
          nanoapp->getAppId(), existingInstanceId);
+  } else if (isNanoappStartPending(nanoapp->getAppId())) {
+    // The scheduled nanoapp isn't visible to the queries by app ID yet, so an
+    // app with the same ID must not start in the meantime
+    LOGE("App with ID 0x%016" PRIx64 " is already scheduled to start",
+         nanoapp->getAppId());
   } else {
     Nanoapp *newNanoapp = nanoapp.get();
     {
@@ -216,6 +244,13 @@ bool EventLoop::startNanoapp(UniquePtr<Nanoapp> &nanoapp) {
                       /*allowSystemNanoappUnload=*/true,
                       /*nanoappStarted=*/false);
       } else {
+        LOGD("Nanoapp 0x%016" PRIx64 " started in %" PRIu64 " us",
+             newNanoapp->getAppId(),
+             newNanoapp->getStartTimes().total.toRawNanoseconds() /
+                 kOneMicrosecondInNanoseconds);
+#ifdef CHRE_TELEMETRY_SUPPORT_ENABLED
+        eventLoopManager->getTelemetryManager().onNanoappStarted(*newNanoapp);
+#endif  // CHRE_TELEMETRY_SUPPORT_ENABLED
         notifyAppStatusChange(CHRE_EVENT_NANOAPP_STARTED, *newNanoapp);
       }
     }
@@ -224,6 +259,16 @@ bool EventLoop::startNanoapp(UniquePtr<Nanoapp> &nanoapp) {
   return success;
 }
 
+bool EventLoop::scheduleNanoappStart(UniquePtr<Nanoapp> &nanoapp) {
+  CHRE_ASSERT(!nanoapp.isNull());
+  bool success = !nanoapp.isNull() &&
+                 mPendingNanoappStarts.push_back(std::move(nanoapp));
+  if (!success) {
+    LOG_OOM();
+  }
+  return success;
+}
+
 bool EventLoop::unloadNanoapp(uint16_t instanceId,
                               bool allowSystemNanoappUnload,
                               bool nanoappStarted) {
@@ -314,7 +359,7 @@ bool EventLoop::deliverEventSync(uint16_t nanoappInstanceId,
               kDefaultTargetGroupMask);
   for (const UniquePtr<Nanoapp> &app : mNanoapps) {
     if (app->getInstanceId() == nanoappInstanceId) {
-      deliverNextEvent(app, &event);
+      deliverNextEvent(*app, &event);
       return true;
     }
   }
@@ -459,7 +504,26 @@ void EventLoop::logStateToBuffer(DebugDumpWrapper &debugDump) const {
     for (const UniquePtr<Nanoapp> &app : mNanoapps) {
       app->logMessageHistoryEntry(debugDump);
     }
+
+    mNanoapps[0]->logStartTimesHeader(debugDump);
+    for (const UniquePtr<Nanoapp> &app : mNanoapps) {
+      app->logStartTimesEntry(debugDump);
+    }
   }
+
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+  mWatchdog.logStateToBuffer(debugDump);
+  for (const UniquePtr<Nanoapp> &app : mNanoapps) {
+    if (app->getNumEventBudgetOverruns() > 0) {
+      debugDump.print("  App 0x%016" PRIx64 " budget=%" PRIu64
+                      "ms overruns=%" PRIu32 " throttledEvents=%" PRIu32 "\n",
+                      app->getAppId(),
+                      Milliseconds(app->getEventBudget()).getMilliseconds(),
+                      app->getNumEventBudgetOverruns(),
+                      app->getNumThrottledEvents());
+    }
+  }
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
 }
 
 bool EventLoop::allocateAndPostEvent(uint16_t eventType, void *eventData,
@@ -483,7 +547,7 @@ bool EventLoop::allocateAndPostEvent(uint16_t eventType, void *eventData,
   return success;
 }
 
-void EventLoop::deliverNextEvent(const UniquePtr<Nanoapp> &app, Event *event) {
+void EventLoop::deliverNextEvent(Nanoapp &app, Event *event) {
   constexpr Seconds kLatencyThreshold = Seconds(1);
   constexpr Seconds kThrottleInterval(1);
   constexpr uint16_t kThrottleCount = 10;
@@ -507,20 +571,57 @@ void EventLoop::deliverNextEvent(const UniquePtr<Nanoapp> &app, Event *event) {
                   SystemTime::getMonotonicTime());
   }
 
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+  if (event->isLowPriority && mWatchdog.isThrottled(app)) {
+    app.onEventThrottled();
+    return;
+  }
+  bool watchdogArmed = mWatchdog.arm(app, event->eventType);
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+
+  CHRE_TRACE_START("Deliver event", "event_loop", event->eventType);
   // TODO: cleaner way to set/clear this? RAII-style?
-  mCurrentApp = app.get();
-  app->processEvent(event);
+  mCurrentApp = &app;
+  app.processEvent(event);
   mCurrentApp = nullptr;
+
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+  if (watchdogArmed) {
+    mWatchdog.disarm();
+  }
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+  CHRE_TRACE_END("Deliver event", "event_loop", event->eventType);
 }
 
 void EventLoop::distributeEvent(Event *event) {
+  // The event is freed before the end of its trace
+  uint16_t eventType = event->eventType;
+  CHRE_TRACE_START("Distribute event", "event_loop", eventType);
   bool eventDelivered = false;
-  for (const UniquePtr<Nanoapp> &app : mNanoapps) {
-    if ((event->targetInstanceId == chre::kBroadcastInstanceId &&
-         app->isRegisteredForBroadcastEvent(event)) ||
-        event->targetInstanceId == app->getInstanceId()) {
+#ifdef CHRE_STATIC_EVENT_DISPATCH
+  if (event->targetInstanceId == kBroadcastInstanceId &&
+      eventType != CHRE_EVENT_HOST_ENDPOINT_NOTIFICATION) {
+    // Nanoapps may register or unregister while handling the event, so the
+    // next handler is looked up after each delivery
+    uint32_t minInstanceId = 0;
+    Nanoapp *app;
+    while ((app = mBroadcastDispatchTable.findNextHandler(
+                eventType, event->targetAppGroupMask, minInstanceId)) !=
+           nullptr) {
       eventDelivered = true;
-      deliverNextEvent(app, event);
+      deliverNextEvent(*app, event);
+      minInstanceId = app->getInstanceId() + 1u;
+    }
+  } else
+#endif  // CHRE_STATIC_EVENT_DISPATCH
+  {
+    for (const UniquePtr<Nanoapp> &app : mNanoapps) {
+      if ((event->targetInstanceId == chre::kBroadcastInstanceId &&
+           app->isRegisteredForBroadcastEvent(event)) ||
+          event->targetInstanceId == app->getInstanceId()) {
+        eventDelivered = true;
+        deliverNextEvent(*app, event);
+      }
     }
   }
   // Log if an event unicast to a nanoapp isn't delivered, as this is could be
@@ -535,6 +636,7 @@ void EventLoop::distributeEvent(Event *event) {
   }
   CHRE_ASSERT(event->isUnreferenced());
   freeEvent(event);
+  CHRE_TRACE_END("Distribute event", "event_loop", eventType);
 }
 
 void EventLoop::flushInboundEventQueue() {
@@ -657,6 +759,15 @@ void EventLoop::unloadNanoappAtIndex(size_t index, bool nanoappStarted) {
           nanoapp.get());
   logDanglingResources("heap blocks", numFreedBlocks);
 
+  // Other nanoapps may still reference the shared payloads, which are only
+  // freed with their last reference
+  logDanglingResources("shared payload references",
+                       nanoapp->releaseSharedPayloadRefs());
+
+#ifdef CHRE_STATIC_EVENT_DISPATCH
+  mBroadcastDispatchTable.removeNanoapp(nanoapp.get());
+#endif  // CHRE_STATIC_EVENT_DISPATCH
+
   // Destroy the Nanoapp instance
   mNanoapps.erase(index);
 
@@ -674,6 +785,22 @@ void EventLoop::handleNanoappWakeupBuckets() {
   }
 }
 
+bool EventLoop::isNanoappStartPending(uint64_t appId) const {
+  for (const UniquePtr<Nanoapp> &app : mPendingNanoappStarts) {
+    if (app->getAppId() == appId) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void EventLoop::startPendingNanoapp() {
+  UniquePtr<Nanoapp> nanoapp = std::move(mPendingNanoappStarts.front());
+  mPendingNanoappStarts.erase(0);
+  startNanoapp(nanoapp);
+}
+
 void EventLoop::logDanglingResources(const char *name, uint32_t count) {
   if (count > 0) {
     LOGE("App 0x%016" PRIx64 " had %" PRIu32 " remaining %s at unload",
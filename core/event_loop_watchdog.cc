@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/core/event_loop_watchdog.h"
+
+#include <cinttypes>
+
+#include "chre/core/event.h"
+#include "chre/core/event_loop_manager.h"
+#include "chre/core/nanoapp.h"
+#include "chre/platform/fatal_error.h"
+#include "chre/platform/log.h"
+#include "chre/platform/system_time.h"
+#include "chre/util/throttle.h"
+
+namespace chre {
+
+EventLoopWatchdog::EventLoopWatchdog() {
+  if (!mTimer.init()) {
+    FATAL_ERROR("Failed to initialize a system timer for the watchdog");
+  }
+}
+
+void EventLoopWatchdog::onLoopPassStart(uint16_t eventType) {
+  mPassEventType = eventType;
+  mCurrentDelivery.store(packDelivery(kSystemInstanceId, eventType));
+}
+
+void EventLoopWatchdog::onLoopPassEnd(bool eventsPending) {
+  mCurrentDelivery.store(kIdle);
+  if (!eventsPending && mTimerSet) {
+    mTimer.cancel();
+    mTimerSet = false;
+  }
+}
+
+bool EventLoopWatchdog::arm(Nanoapp &nanoapp, uint16_t eventType) {
+  if (mNanoapp != nullptr) {
+    return false;
+  }
+
+  mNanoapp = &nanoapp;
+  mEventType = eventType;
+  mBudget = nanoapp.getEventBudget();
+  // The deadline of the previous delivery is moved before this one is
+  // published, so that it can't be attributed to this nanoapp
+  if (mTimer.set(handleTimerCallback, this, mBudget)) {
+    mTimerSet = true;
+  } else {
+    LOGE("Failed to set the deadline of the event loop watchdog");
+  }
+  mCurrentDelivery.store(packDelivery(nanoapp.getInstanceId(), eventType));
+  mStartTime = SystemTime::getMonotonicTime();
+  return true;
+}
+
+void EventLoopWatchdog::disarm() {
+  CHRE_ASSERT(mNanoapp != nullptr);
+  Nanoseconds elapsed = SystemTime::getMonotonicTime() - mStartTime;
+  mCurrentDelivery.store(packDelivery(kSystemInstanceId, mPassEventType));
+  if (elapsed > mBudget) {
+    onBudgetExceeded(elapsed);
+  }
+  mNanoapp = nullptr;
+}
+
+bool EventLoopWatchdog::isThrottled(const Nanoapp &nanoapp) const {
+  return mThrottleDuration.toRawNanoseconds() > 0 &&
+         SystemTime::getMonotonicTime() < nanoapp.getThrottledUntil();
+}
+
+void EventLoopWatchdog::logStateToBuffer(DebugDumpWrapper &debugDump) const {
+  debugDump.print("\nEvent Loop Watchdog:\n");
+  debugDump.print("  Default budget: %" PRIu64 "ms, throttle duration: %" PRIu64
+                  "ms, overruns: %" PRIu32 "\n",
+                  kDefaultBudget.getMilliseconds(),
+                  Milliseconds(mThrottleDuration).getMilliseconds(),
+                  mNumOverruns);
+
+  uint64_t nowNs = SystemTime::getMonotonicTime().toRawNanoseconds();
+  for (const Overrun &overrun : mOverruns) {
+    debugDump.print("  App 0x%016" PRIx64 " took %" PRIu32
+                    "ms to handle event 0x%" PRIx16 " %" PRIu64 "s ago\n",
+                    overrun.appId, overrun.elapsedMs, overrun.eventType,
+                    (nowNs - overrun.timestampNs) / kOneSecondInNanoseconds);
+  }
+}
+
+void EventLoopWatchdog::onBudgetExceeded(Nanoseconds elapsed) {
+  constexpr Seconds kLogThrottleInterval(1);
+  constexpr uint16_t kLogThrottleCount = 10;
+
+  Nanoseconds now = SystemTime::getMonotonicTime();
+  uint64_t elapsedMs = Milliseconds(elapsed).getMilliseconds();
+  CHRE_THROTTLE(LOGW("Nanoapp 0x%016" PRIx64 " took %" PRIu64
+                     "ms to handle event 0x%" PRIx16 ", budget %" PRIu64 "ms",
+                     mNanoapp->getAppId(), elapsedMs, mEventType,
+                     Milliseconds(mBudget).getMilliseconds()),
+                kLogThrottleInterval, kLogThrottleCount, now);
+
+  if (mNumOverruns < UINT32_MAX) ++mNumOverruns;
+  Overrun overrun;
+  overrun.appId = mNanoapp->getAppId();
+  overrun.timestampNs = now.toRawNanoseconds();
+  overrun.elapsedMs = static_cast<uint32_t>(
+      (elapsedMs > UINT32_MAX) ? UINT32_MAX : elapsedMs);
+  overrun.eventType = mEventType;
+  mOverruns.kick_push(overrun);
+  mNanoapp->onEventBudgetExceeded(now + mThrottleDuration);
+
+#ifdef CHRE_TELEMETRY_SUPPORT_ENABLED
+  // A nanoapp stalling on every event would otherwise flood the host
+  constexpr Seconds kMetricThrottleInterval(kOneDayInSeconds);
+  constexpr uint16_t kMetricThrottleCount = 10;
+  CHRE_THROTTLE(EventLoopManagerSingleton::get()
+                    ->getTelemetryManager()
+                    .onEventBudgetExceeded(*mNanoapp, mEventType, elapsed),
+                kMetricThrottleInterval, kMetricThrottleCount, now);
+#endif  // CHRE_TELEMETRY_SUPPORT_ENABLED
+}
+
+void EventLoopWatchdog::handleTimerCallback(void *data) {
+  // Invoked from the timer context while the event loop keeps running, so only
+  // the snapshot of the current delivery is read
+  auto *watchdog = static_cast<EventLoopWatchdog *>(data);
+  uint32_t delivery = watchdog->mCurrentDelivery.load();
+  auto instanceId = static_cast<uint16_t>(delivery >> 16);
+  auto eventType = static_cast<uint16_t>(delivery);
+  if (delivery != kIdle && instanceId != kSystemInstanceId) {
+    watchdog->mNumMissedDeadlines.fetch_increment();
+    LOGE("Nanoapp instance %" PRIu16 " has been handling event 0x%" PRIx16
+         " past its budget", instanceId, eventType);
+  }
+}
+
+}  // namespace chre
@@ -16,6 +16,7 @@
 
 #include "chre/core/host_comms_manager.h"
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstdint>
 #include <type_traits>
@@ -27,6 +28,8 @@
 #include "chre/platform/context.h"
 #include "chre/platform/host_link.h"
 #include "chre/platform/log.h"
+#include "chre/platform/system_time.h"
+#include "chre/platform/tracing.h"
 #include "chre/target_platform/log.h"
 #include "chre/util/duplicate_message_detector.h"
 #include "chre/util/macros.h"
@@ -93,9 +96,10 @@ bool HostCommsManager::completeTransaction(
   auto callback = [](uint16_t /*type*/, void *data, void *extraData) {
     uint32_t txnId = NestedDataPtr<uint32_t>(data);
     uint8_t err = NestedDataPtr<uint8_t>(extraData);
-    EventLoopManagerSingleton::get()
-        ->getHostCommsManager()
-        .handleMessageDeliveryStatusSync(txnId, err);
+    HostCommsManager &hostCommsManager =
+        EventLoopManagerSingleton::get()->getHostCommsManager();
+    hostCommsManager.recordReliableMessageResponse(txnId);
+    hostCommsManager.handleMessageDeliveryStatusSync(txnId, err);
   };
   EventLoopManagerSingleton::get()->deferCallback(
       SystemCallbackType::ReliableMessageEvent,
@@ -155,6 +159,12 @@ void HostCommsManager::freeAllReliableMessagesFromNanoapp(
 }
 
 void HostCommsManager::flushNanoappMessages(Nanoapp &nanoapp) {
+#ifdef CHRE_HOST_MESSAGE_BATCHING_ENABLED
+  // Batched messages reference memory owned by the nanoapp, so make sure they
+  // have been handed off to HostLink before flushing it
+  flushMessageBatch();
+#endif  // CHRE_HOST_MESSAGE_BATCHING_ENABLED
+
   // First we remove all of the outgoing reliable message transactions from the
   // transaction manager, which triggers sending any pending reliable messages
   removeAllTransactionsFromNanoapp(nanoapp);
@@ -169,6 +179,7 @@ void HostCommsManager::flushNanoappMessages(Nanoapp &nanoapp) {
 // TODO(b/346345637): rename this to better reflect its true meaning, which is
 // that HostLink doesn't reference the memory anymore
 void HostCommsManager::onMessageToHostComplete(const MessageToHost *message) {
+  CHRE_TRACE_INSTANT("Message to host complete", "host_comms");
   // We do not call onMessageToHostCompleteInternal for reliable messages
   // until the completion callback is called.
   if (message != nullptr && !message->isReliable) {
@@ -185,6 +196,8 @@ bool HostCommsManager::sendMessageToHostFromNanoapp(
     uint32_t messageType, uint16_t hostEndpoint, uint32_t messagePermissions,
     chreMessageFreeFunction *freeCallback, bool isReliable,
     const void *cookie) {
+  CHRE_TRACE_INSTANT("Message to host", "host_comms",
+                     nanoapp->getInstanceId());
   if (!shouldAcceptMessageToHostFromNanoapp(nanoapp, messageData, messageSize,
                                             hostEndpoint, messagePermissions,
                                             isReliable)) {
@@ -211,8 +224,13 @@ bool HostCommsManager::sendMessageToHostFromNanoapp(
   bool success = false;
   if (isReliable) {
 #ifdef CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+    mReliableMessageBeingAdded = msgToHost;
     success = mTransactionManager.add(nanoapp->getInstanceId(),
                                       &msgToHost->messageSequenceNumber);
+    mReliableMessageBeingAdded = nullptr;
+    if (success) {
+      addOutstandingReliableMessage(msgToHost);
+    }
 #endif  // CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
   } else {
     success = doSendMessageToHostFromNanoapp(nanoapp, msgToHost);
@@ -228,6 +246,7 @@ void HostCommsManager::sendMessageToNanoappFromHost(
     uint64_t appId, uint32_t messageType, uint16_t hostEndpoint,
     const void *messageData, size_t messageSize, bool isReliable,
     uint32_t messageSequenceNumber) {
+  CHRE_TRACE_INSTANT("Message from host", "host_comms", messageType);
   std::pair<chreError, MessageFromHost *> output =
       validateAndCraftMessageFromHostToNanoapp(
           appId, messageType, hostEndpoint, messageData, messageSize,
@@ -379,9 +398,25 @@ bool HostCommsManager::doSendMessageToHostFromNanoapp(
   bool wokeHost = !hostWasAwake && !mIsNanoappBlamedForWakeup;
   msgToHost->toHostData.wokeHost = wokeHost;
 
+#ifdef CHRE_HOST_MESSAGE_BATCHING_ENABLED
+  // Messages too large to fit in a batch frame alongside its container are
+  // sent on their own
+  bool fitsInBatch = msgToHost->message.size() + kBatchedMessageOverhead <=
+                     kMaxBatchEncodedSize;
+  if (!wokeHost && !msgToHost->isReliable && fitsInBatch) {
+    addMessageToBatch(msgToHost);
+  } else {
+    // Send anything that's already batched first to preserve ordering
+    flushMessageBatch();
+    if (!HostLink::sendMessage(msgToHost)) {
+      return false;
+    }
+  }
+#else
   if (!HostLink::sendMessage(msgToHost)) {
     return false;
   }
+#endif  // CHRE_HOST_MESSAGE_BATCHING_ENABLED
 
   if (wokeHost) {
     EventLoopManagerSingleton::get()
@@ -394,8 +429,73 @@ bool HostCommsManager::doSendMessageToHostFromNanoapp(
   return true;
 }
 
+#ifdef CHRE_HOST_MESSAGE_BATCHING_ENABLED
+void HostCommsManager::addMessageToBatch(const MessageToHost *msgToHost) {
+  size_t encodedSize = msgToHost->message.size() + kBatchedMessageOverhead;
+  if (mMessageBatch.full() ||
+      mMessageBatchEncodedSize + encodedSize > kMaxBatchEncodedSize) {
+    flushMessageBatch();
+  }
+
+  mMessageBatch.push_back(msgToHost);
+  mMessageBatchEncodedSize += encodedSize;
+
+  if (mMessageBatch.size() == 1) {
+    auto callback = [](uint16_t /*type*/, void * /*data*/,
+                       void * /*extraData*/) {
+      EventLoopManagerSingleton::get()
+          ->getHostCommsManager()
+          .onMessageBatchTimeout();
+    };
+    mMessageBatchTimerHandle =
+        EventLoopManagerSingleton::get()->setDelayedCallback(
+            SystemCallbackType::HostMessageBatchTimeout, /*data=*/nullptr,
+            callback, kMaxBatchAge);
+    if (mMessageBatchTimerHandle == CHRE_TIMER_INVALID) {
+      LOGW("Couldn't set message batch timer - flushing immediately");
+      flushMessageBatch();
+    }
+  }
+}
+
+void HostCommsManager::flushMessageBatch() {
+  if (mMessageBatch.empty()) {
+    return;
+  }
+
+  if (mMessageBatchTimerHandle != CHRE_TIMER_INVALID) {
+    EventLoopManagerSingleton::get()->cancelDelayedCallback(
+        mMessageBatchTimerHandle);
+    mMessageBatchTimerHandle = CHRE_TIMER_INVALID;
+  }
+
+  if (!HostLink::sendMessageBatch(mMessageBatch.data(), mMessageBatch.size())) {
+    // The nanoapps were already told that these messages were accepted, so we
+    // need to release them here to ensure their free callbacks are invoked
+    LOGE("Failed to send batch of %zu messages to host; dropping",
+         mMessageBatch.size());
+    for (const MessageToHost *msgToHost : mMessageBatch) {
+      onMessageToHostCompleteInternal(msgToHost);
+    }
+  }
+
+  mMessageBatch.resize(0);
+  mMessageBatchEncodedSize = 0;
+}
+
+void HostCommsManager::onMessageBatchTimeout() {
+  mMessageBatchTimerHandle = CHRE_TIMER_INVALID;
+  flushMessageBatch();
+}
+#endif  // CHRE_HOST_MESSAGE_BATCHING_ENABLED
+
 MessageToHost *HostCommsManager::findMessageToHostBySeq(
     uint32_t messageSequenceNumber) {
+#ifdef CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+  OutstandingReliableMessage *entry =
+      findOutstandingReliableMessage(messageSequenceNumber);
+  return (entry == nullptr) ? nullptr : entry->message;
+#else
   return mMessagePool.find(
       [](HostMessage *inputMessage, void *data) {
         NestedDataPtr<uint32_t> targetMessageSequenceNumber(data);
@@ -404,8 +504,167 @@ MessageToHost *HostCommsManager::findMessageToHostBySeq(
                    targetMessageSequenceNumber;
       },
       NestedDataPtr<uint32_t>(messageSequenceNumber));
+#endif  // CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+}
+
+#ifdef CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+HostCommsManager::OutstandingReliableMessage *
+HostCommsManager::findOutstandingReliableMessage(
+    uint32_t messageSequenceNumber) {
+  constexpr size_t kMask = kMaxOutstandingMessages - 1;
+  size_t slot = messageSequenceNumber & kMask;
+  for (size_t i = 0; i < kMaxOutstandingMessages; ++i) {
+    OutstandingReliableMessage &entry = mOutstandingReliableMessages[slot];
+    if (entry.message == nullptr) {
+      break;
+    } else if (entry.message->messageSequenceNumber == messageSequenceNumber) {
+      return &entry;
+    }
+    slot = (slot + 1) & kMask;
+  }
+
+  // The first attempt at a message can happen from within
+  // TransactionManager::add(), before the message was added to the index
+  if (mReliableMessageBeingAdded != nullptr &&
+      mReliableMessageBeingAdded->messageSequenceNumber ==
+          messageSequenceNumber) {
+    return addOutstandingReliableMessage(mReliableMessageBeingAdded);
+  }
+  return nullptr;
 }
 
+HostCommsManager::OutstandingReliableMessage *
+HostCommsManager::addOutstandingReliableMessage(MessageToHost *msgToHost) {
+  constexpr size_t kMask = kMaxOutstandingMessages - 1;
+  size_t slot = msgToHost->messageSequenceNumber & kMask;
+  for (size_t i = 0; i < kMaxOutstandingMessages; ++i) {
+    OutstandingReliableMessage &entry = mOutstandingReliableMessages[slot];
+    if (entry.message == msgToHost) {
+      return &entry;
+    } else if (entry.message == nullptr) {
+      entry.message = msgToHost;
+      entry.attemptCount = 0;
+      return &entry;
+    }
+    slot = (slot + 1) & kMask;
+  }
+
+  // Not expected, as the index has a slot for every message in mMessagePool
+  CHRE_ASSERT_LOG(false, "Reliable message index full");
+  return nullptr;
+}
+
+void HostCommsManager::removeOutstandingReliableMessage(
+    uint32_t messageSequenceNumber) {
+  constexpr size_t kMask = kMaxOutstandingMessages - 1;
+  size_t hole = messageSequenceNumber & kMask;
+  size_t i = 0;
+  for (; i < kMaxOutstandingMessages; ++i) {
+    MessageToHost *message = mOutstandingReliableMessages[hole].message;
+    if (message == nullptr) {
+      return;
+    } else if (message->messageSequenceNumber == messageSequenceNumber) {
+      break;
+    }
+    hole = (hole + 1) & kMask;
+  }
+  if (i == kMaxOutstandingMessages) {
+    return;
+  }
+
+  // Shift back any later entries in the probe sequence that would no longer
+  // be reachable from their home slot once this one is emptied
+  size_t slot = hole;
+  while (true) {
+    slot = (slot + 1) & kMask;
+    MessageToHost *message = mOutstandingReliableMessages[slot].message;
+    if (message == nullptr) {
+      break;
+    }
+    size_t home = message->messageSequenceNumber & kMask;
+    bool homeInRange = (hole <= slot) ? (hole < home && home <= slot)
+                                      : (hole < home || home <= slot);
+    if (!homeInRange) {
+      mOutstandingReliableMessages[hole] = mOutstandingReliableMessages[slot];
+      hole = slot;
+    }
+  }
+  mOutstandingReliableMessages[hole] = OutstandingReliableMessage();
+}
+
+HostCommsManager::ReliableMessageEndpointStats &
+HostCommsManager::getReliableMessageEndpointStats(uint16_t hostEndpoint) {
+  ReliableMessageEndpointStats *leastRecentlyUsed = nullptr;
+  for (ReliableMessageEndpointStats &stats : mReliableMessageEndpointStats) {
+    if (stats.hostEndpoint == hostEndpoint) {
+      return stats;
+    } else if (leastRecentlyUsed == nullptr ||
+               stats.lastActivityTime < leastRecentlyUsed->lastActivityTime) {
+      leastRecentlyUsed = &stats;
+    }
+  }
+
+  ReliableMessageEndpointStats newStats;
+  newStats.hostEndpoint = hostEndpoint;
+  if (!mReliableMessageEndpointStats.full()) {
+    mReliableMessageEndpointStats.push_back(newStats);
+    return mReliableMessageEndpointStats.back();
+  }
+  *leastRecentlyUsed = newStats;
+  return *leastRecentlyUsed;
+}
+
+void HostCommsManager::recordReliableMessageResponse(
+    uint32_t messageSequenceNumber) {
+  OutstandingReliableMessage *entry =
+      findOutstandingReliableMessage(messageSequenceNumber);
+  if (entry == nullptr || entry->attemptCount == 0) {
+    return;
+  }
+
+  Nanoseconds now = SystemTime::getMonotonicTime();
+  Nanoseconds latency = now - entry->firstAttemptTime;
+  ReliableMessageEndpointStats &stats =
+      getReliableMessageEndpointStats(entry->message->toHostData.hostEndpoint);
+  stats.lastActivityTime = now;
+  stats.ackCount++;
+  stats.totalLatency = stats.totalLatency + latency;
+  if (latency > stats.maxLatency) {
+    stats.maxLatency = latency;
+  }
+
+  // Per Karn's algorithm, only messages which were not retried give an RTT
+  // sample, as we can't tell which attempt the host acknowledged otherwise
+  if (entry->attemptCount == 1) {
+    updateRttEstimate(stats, latency);
+  }
+}
+
+void HostCommsManager::updateRttEstimate(ReliableMessageEndpointStats &stats,
+                                         Nanoseconds rtt) {
+  uint64_t sample = rtt.toRawNanoseconds();
+  uint64_t srtt = stats.smoothedRtt.toRawNanoseconds();
+  uint64_t rttVar = stats.rttVariation.toRawNanoseconds();
+  if (stats.rttSampleCount == 0) {
+    srtt = sample;
+    rttVar = sample / 2;
+  } else {
+    uint64_t delta = (srtt > sample) ? srtt - sample : sample - srtt;
+    rttVar = (3 * rttVar + delta) / 4;
+    srtt = (7 * srtt + sample) / 8;
+  }
+  stats.rttSampleCount++;
+  stats.smoothedRtt = Nanoseconds(srtt);
+  stats.rttVariation = Nanoseconds(rttVar);
+
+  uint64_t retryWaitTime = std::clamp(
+      srtt + 4 * rttVar,
+      Nanoseconds(kReliableMessageMinRetryWaitTime).toRawNanoseconds(),
+      Nanoseconds(kReliableMessageMaxRetryWaitTime).toRawNanoseconds());
+  stats.retryWaitTime = Nanoseconds(retryWaitTime);
+}
+#endif  // CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+
 void HostCommsManager::freeMessageToHost(MessageToHost *msgToHost) {
   if (msgToHost->toHostData.nanoappFreeFunction != nullptr) {
     EventLoopManagerSingleton::get()->getEventLoop().invokeMessageFreeFunction(
@@ -433,6 +692,26 @@ void HostCommsManager::onTransactionAttempt(uint32_t messageSequenceNumber,
          (message == nullptr) ? " msg" : "",
          (nanoapp == nullptr) ? " napp" : "");
   } else {
+#ifdef CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+    OutstandingReliableMessage *entry =
+        findOutstandingReliableMessage(messageSequenceNumber);
+    if (entry == nullptr) {
+      LOGE("Reliable message %" PRIu32 " isn't outstanding",
+           messageSequenceNumber);
+      return;
+    }
+    Nanoseconds now = SystemTime::getMonotonicTime();
+    ReliableMessageEndpointStats &stats =
+        getReliableMessageEndpointStats(message->toHostData.hostEndpoint);
+    stats.lastActivityTime = now;
+    if (entry->attemptCount++ == 0) {
+      entry->firstAttemptTime = now;
+      stats.sentCount++;
+    } else {
+      stats.retryCount++;
+    }
+#endif  // CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+
     bool success = doSendMessageToHostFromNanoapp(nanoapp, message);
     LOGD("Attempted to send reliable message %" PRIu32 " from nanoapp %" PRIu16
          " with success: %s",
@@ -444,9 +723,37 @@ void HostCommsManager::onTransactionFailure(uint32_t messageSequenceNumber,
                                             uint16_t nanoappInstanceId) {
   LOGE("Reliable message %" PRIu32 " from nanoapp %" PRIu16 " timed out",
        messageSequenceNumber, nanoappInstanceId);
+#ifdef CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+  MessageToHost *message = findMessageToHostBySeq(messageSequenceNumber);
+  if (message != nullptr) {
+    getReliableMessageEndpointStats(message->toHostData.hostEndpoint)
+        .timeoutCount++;
+  }
+#endif  // CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
   handleMessageDeliveryStatusSync(messageSequenceNumber, CHRE_ERROR_TIMEOUT);
 }
 
+Nanoseconds HostCommsManager::getTransactionTimeout(
+    [[maybe_unused]] uint32_t messageSequenceNumber,
+    uint16_t /*nanoappInstanceId*/, [[maybe_unused]] uint8_t attemptCount,
+    Nanoseconds defaultTimeout) {
+#ifdef CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+  MessageToHost *message = findMessageToHostBySeq(messageSequenceNumber);
+  if (message != nullptr) {
+    const ReliableMessageEndpointStats &stats =
+        getReliableMessageEndpointStats(message->toHostData.hostEndpoint);
+    uint64_t maxWaitTime =
+        Nanoseconds(kReliableMessageMaxRetryWaitTime).toRawNanoseconds();
+    uint64_t waitTime = stats.retryWaitTime.toRawNanoseconds();
+    for (uint8_t i = 1; i < attemptCount && waitTime < maxWaitTime; ++i) {
+      waitTime *= 2;
+    }
+    return Nanoseconds(std::min(waitTime, maxWaitTime));
+  }
+#endif  // CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+  return defaultTimeout;
+}
+
 void HostCommsManager::handleDuplicateAndSendMessageDeliveryStatus(
     [[maybe_unused]] uint32_t messageSequenceNumber,
     [[maybe_unused]] uint16_t hostEndpoint,
@@ -500,6 +807,13 @@ void HostCommsManager::onMessageToHostCompleteInternal(
   // which is technically possible if a reliable message timed out before it
   // was released
 
+#ifdef CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+  // Reliable messages are only completed from the event loop thread
+  if (msgToHost->isReliable && !msgToHost->fromHost) {
+    removeOutstandingReliableMessage(msgToHost->messageSequenceNumber);
+  }
+#endif  // CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+
   // If there's no free callback, we can free the message right away as the
   // message pool is thread-safe; otherwise, we need to do it from within the
   // EventLoop context.
@@ -524,6 +838,39 @@ void HostCommsManager::onMessageToHostCompleteInternal(
   }
 }
 
+void HostCommsManager::logStateToBuffer(
+    [[maybe_unused]] DebugDumpWrapper &debugDump) const {
+#ifdef CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+  size_t outstandingCount = 0;
+  for (const OutstandingReliableMessage &entry : mOutstandingReliableMessages) {
+    if (entry.message != nullptr) {
+      outstandingCount++;
+    }
+  }
+
+  debugDump.print("\nReliable messages to host: %zu outstanding\n",
+                  outstandingCount);
+  for (const ReliableMessageEndpointStats &stats :
+       mReliableMessageEndpointStats) {
+    uint64_t avgLatencyMs =
+        (stats.ackCount == 0)
+            ? 0
+            : Milliseconds(stats.totalLatency).getMilliseconds() /
+                  stats.ackCount;
+    debugDump.print(
+        " endpoint 0x%04" PRIx16 ": sent=%" PRIu32 " retries=%" PRIu32
+        " acked=%" PRIu32 " timeouts=%" PRIu32 " srtt=%" PRIu64
+        "ms rttvar=%" PRIu64 "ms retryWait=%" PRIu64 "ms avgLatency=%" PRIu64
+        "ms maxLatency=%" PRIu64 "ms\n",
+        stats.hostEndpoint, stats.sentCount, stats.retryCount, stats.ackCount,
+        stats.timeoutCount, Milliseconds(stats.smoothedRtt).getMilliseconds(),
+        Milliseconds(stats.rttVariation).getMilliseconds(),
+        Milliseconds(stats.retryWaitTime).getMilliseconds(), avgLatencyMs,
+        Milliseconds(stats.maxLatency).getMilliseconds());
+  }
+#endif  // CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+}
+
 bool HostCommsManager::shouldSendReliableMessageToNanoapp(
     [[maybe_unused]] uint32_t messageSequenceNumber,
     [[maybe_unused]] uint16_t hostEndpoint) {
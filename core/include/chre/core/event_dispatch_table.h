@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_CORE_EVENT_DISPATCH_TABLE_H_
+#define CHRE_CORE_EVENT_DISPATCH_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chre/util/non_copyable.h"
+
+namespace chre {
+
+/**
+ * Maps broadcast event types to the nanoapps registered for them, so that a
+ * broadcast event is delivered by looking up its handlers instead of checking
+ * the registrations of every nanoapp. Used by the EventLoop when
+ * CHRE_STATIC_EVENT_DISPATCH is defined, in place of the per-nanoapp
+ * registration vectors.
+ *
+ * The registrations are kept in a fixed-size array sorted by event type then
+ * nanoapp instance ID, so the table uses no heap and the handlers of an event
+ * type are contiguous. Handlers are found one at a time in instance ID order
+ * with findNextHandler(), which stays valid when nanoapps register or
+ * unregister while an event is being delivered.
+ *
+ * @tparam NanoappType the type of the nanoapps, which must provide
+ *         uint16_t getInstanceId() const
+ * @tparam kMaxRegistrations the maximum number of event types registered,
+ *         summed over all nanoapps
+ */
+template <typename NanoappType, size_t kMaxRegistrations>
+class EventDispatchTable : public NonCopyable {
+ public:
+  /**
+   * Registers a nanoapp for the broadcast events of a type targeting any of
+   * the given groups, adding to its groups if it's already registered.
+   *
+   * @return false if the table is full
+   */
+  bool registerEvent(NanoappType *nanoapp, uint16_t eventType,
+                     uint16_t groupIdMask);
+
+  /**
+   * Unregisters a nanoapp from the given groups of an event type, removing its
+   * registration once no groups remain.
+   */
+  void unregisterEvent(const NanoappType *nanoapp, uint16_t eventType,
+                       uint16_t groupIdMask);
+
+  /**
+   * @return true if the nanoapp is registered for the event type in any of the
+   *         given groups
+   */
+  bool isRegistered(const NanoappType *nanoapp, uint16_t eventType,
+                    uint16_t groupIdMask) const;
+
+  /**
+   * @return the groups the nanoapp is registered for the event type in, or 0
+   *         if it isn't registered for it
+   */
+  uint16_t getGroupIdMask(const NanoappType *nanoapp,
+                          uint16_t eventType) const;
+
+  /**
+   * Removes all registrations of a nanoapp, e.g. when it's unloaded.
+   */
+  void removeNanoapp(const NanoappType *nanoapp);
+
+  /**
+   * Finds the next nanoapp which should receive a broadcast event.
+   *
+   * @param eventType the type of the event
+   * @param targetGroupMask the groups targeted by the event
+   * @param minInstanceId the lowest instance ID of the nanoapp to find, i.e.
+   *        0 to find the first handler, then one more than the instance ID
+   *        of the previous handler
+   *
+   * @return the registered nanoapp with the lowest instance ID at least
+   *         minInstanceId, or nullptr if there is none
+   */
+  NanoappType *findNextHandler(uint16_t eventType, uint16_t targetGroupMask,
+                               uint32_t minInstanceId) const;
+
+  /**
+   * @return the number of registrations, one per nanoapp and event type
+   */
+  size_t size() const {
+    return mSize;
+  }
+
+ private:
+  struct Registration {
+    //! The event type in the upper 16 bits and the instance ID of the nanoapp
+    //! in the lower ones, by which the registrations are sorted.
+    uint32_t key;
+    uint16_t groupIdMask;
+    NanoappType *nanoapp;
+  };
+
+  Registration mRegistrations[kMaxRegistrations];
+  size_t mSize = 0;
+
+  static uint32_t makeKey(uint16_t eventType, uint16_t instanceId) {
+    return (static_cast<uint32_t>(eventType) << 16) | instanceId;
+  }
+
+  /**
+   * @return the index of the first registration with a key at least the given
+   *         one, or mSize if there is none
+   */
+  size_t lowerBound(uint64_t key) const;
+
+  /**
+   * @return the index of the registration with the given key, or mSize if
+   *         there is none
+   */
+  size_t find(uint32_t key) const;
+
+  void erase(size_t index);
+};
+
+}  // namespace chre
+
+#include "chre/core/event_dispatch_table_impl.h"
+
+#endif  // CHRE_CORE_EVENT_DISPATCH_TABLE_H_
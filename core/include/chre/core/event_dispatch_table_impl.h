@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_CORE_EVENT_DISPATCH_TABLE_IMPL_H_
+#define CHRE_CORE_EVENT_DISPATCH_TABLE_IMPL_H_
+
+#include "chre/core/event_dispatch_table.h"
+
+namespace chre {
+
+template <typename NanoappType, size_t kMaxRegistrations>
+bool EventDispatchTable<NanoappType, kMaxRegistrations>::registerEvent(
+    NanoappType *nanoapp, uint16_t eventType, uint16_t groupIdMask) {
+  uint32_t key = makeKey(eventType, nanoapp->getInstanceId());
+  size_t index = lowerBound(key);
+  if (index < mSize && mRegistrations[index].key == key) {
+    mRegistrations[index].groupIdMask |= groupIdMask;
+    return true;
+  }
+
+  if (mSize == kMaxRegistrations) {
+    return false;
+  }
+  for (size_t i = mSize; i > index; i--) {
+    mRegistrations[i] = mRegistrations[i - 1];
+  }
+  mRegistrations[index] = {key, groupIdMask, nanoapp};
+  mSize++;
+  return true;
+}
+
+template <typename NanoappType, size_t kMaxRegistrations>
+void EventDispatchTable<NanoappType, kMaxRegistrations>::unregisterEvent(
+    const NanoappType *nanoapp, uint16_t eventType, uint16_t groupIdMask) {
+  size_t index = find(makeKey(eventType, nanoapp->getInstanceId()));
+  if (index < mSize) {
+    mRegistrations[index].groupIdMask &= ~groupIdMask;
+    if (mRegistrations[index].groupIdMask == 0) {
+      erase(index);
+    }
+  }
+}
+
+template <typename NanoappType, size_t kMaxRegistrations>
+bool EventDispatchTable<NanoappType, kMaxRegistrations>::isRegistered(
+    const NanoappType *nanoapp, uint16_t eventType,
+    uint16_t groupIdMask) const {
+  return (getGroupIdMask(nanoapp, eventType) & groupIdMask) != 0;
+}
+
+template <typename NanoappType, size_t kMaxRegistrations>
+uint16_t EventDispatchTable<NanoappType, kMaxRegistrations>::getGroupIdMask(
+    const NanoappType *nanoapp, uint16_t eventType) const {
+  size_t index = find(makeKey(eventType, nanoapp->getInstanceId()));
+  return (index < mSize) ? mRegistrations[index].groupIdMask : 0;
+}
+
+template <typename NanoappType, size_t kMaxRegistrations>
+void EventDispatchTable<NanoappType, kMaxRegistrations>::removeNanoapp(
+    const NanoappType *nanoapp) {
+  size_t numKept = 0;
+  for (size_t i = 0; i < mSize; i++) {
+    if (mRegistrations[i].nanoapp != nanoapp) {
+      mRegistrations[numKept++] = mRegistrations[i];
+    }
+  }
+  mSize = numKept;
+}
+
+template <typename NanoappType, size_t kMaxRegistrations>
+NanoappType *
+EventDispatchTable<NanoappType, kMaxRegistrations>::findNextHandler(
+    uint16_t eventType, uint16_t targetGroupMask,
+    uint32_t minInstanceId) const {
+  uint64_t key = (static_cast<uint64_t>(eventType) << 16) + minInstanceId;
+  for (size_t i = lowerBound(key);
+       i < mSize && (mRegistrations[i].key >> 16) == eventType; i++) {
+    if (mRegistrations[i].groupIdMask & targetGroupMask) {
+      return mRegistrations[i].nanoapp;
+    }
+  }
+  return nullptr;
+}
+
+template <typename NanoappType, size_t kMaxRegistrations>
+size_t EventDispatchTable<NanoappType, kMaxRegistrations>::lowerBound(
+    uint64_t key) const {
+  size_t low = 0;
+  size_t high = mSize;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (mRegistrations[mid].key < key) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+template <typename NanoappType, size_t kMaxRegistrations>
+size_t EventDispatchTable<NanoappType, kMaxRegistrations>::find(
+    uint32_t key) const {
+  size_t index = lowerBound(key);
+  return (index < mSize && mRegistrations[index].key == key) ? index : mSize;
+}
+
+template <typename NanoappType, size_t kMaxRegistrations>
+void EventDispatchTable<NanoappType, kMaxRegistrations>::erase(size_t index) {
+  mSize--;
+  for (size_t i = index; i < mSize; i++) {
+    mRegistrations[i] = mRegistrations[i + 1];
+  }
+}
+
+}  // namespace chre
+
+#endif  // CHRE_CORE_EVENT_DISPATCH_TABLE_IMPL_H_
@@ -25,12 +25,17 @@
 #include "chre/platform/power_control_manager.h"
 #include "chre/platform/system_time.h"
 #include "chre/util/dynamic_vector.h"
+#include "chre/util/intrusive_list.h"
 #include "chre/util/non_copyable.h"
 #include "chre/util/system/debug_dump.h"
 #include "chre/util/system/stats_container.h"
 #include "chre/util/unique_ptr.h"
 #include "chre_api/chre/event.h"
 
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+#include "chre/core/event_loop_watchdog.h"
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+
 #ifdef CHRE_STATIC_EVENT_LOOP
 #include "chre/util/fixed_size_blocking_queue.h"
 #include "chre/util/synchronized_memory_pool.h"
@@ -43,7 +48,21 @@
 #ifndef CHRE_MAX_UNSCHEDULED_EVENT_COUNT
 #define CHRE_MAX_UNSCHEDULED_EVENT_COUNT 96
 #endif
+
+#ifdef CHRE_STATIC_EVENT_DISPATCH
+#include "chre/core/event_dispatch_table.h"
+
+//! The maximum number of broadcast event types registered, summed over all
+//! nanoapps.
+#ifndef CHRE_MAX_BROADCAST_REGISTRATIONS
+#define CHRE_MAX_BROADCAST_REGISTRATIONS 64
+#endif
+#endif  // CHRE_STATIC_EVENT_DISPATCH
 #else
+#ifdef CHRE_STATIC_EVENT_DISPATCH
+#error "CHRE_STATIC_EVENT_DISPATCH requires CHRE_STATIC_EVENT_LOOP"
+#endif
+
 #include "chre/util/blocking_segmented_queue.h"
 #include "chre/util/synchronized_expandable_memory_pool.h"
 
@@ -142,6 +161,25 @@ class EventLoop : public NonCopyable {
    */
   bool startNanoapp(UniquePtr<Nanoapp> &nanoapp);
 
+  /**
+   * Schedules a nanoapp to be started by run(), e.g. for static nanoapps
+   * started when CHRE initializes. Scheduled nanoapps are started one at a
+   * time, and the events pending when one is started are distributed before
+   * the next one is, so that a slow nanoappStart() doesn't delay system events
+   * and nanoapps that are already running. This function must only be called
+   * from the context of the thread that runs this event loop.
+   *
+   * A scheduled nanoapp isn't listed or found by its app ID until it has
+   * started, and startNanoapp() rejects any nanoapp with the same app ID in
+   * the meantime, e.g. one loaded by the host.
+   *
+   * @param nanoapp The nanoapp that will be started. Upon success, this
+   *        UniquePtr will become invalid, as the underlying Nanoapp instance
+   *        will have been transferred to this EventLoop.
+   * @return true if the nanoapp was scheduled to start
+   */
+  bool scheduleNanoappStart(UniquePtr<Nanoapp> &nanoapp);
+
   /**
    * Stops and unloads a nanoapp identified by its instance ID. The end entry
    * point will be invoked, and the chre::Nanoapp instance will be destroyed.
@@ -302,6 +340,39 @@ class EventLoop : public NonCopyable {
     return mTimerPool;
   }
 
+  /**
+   * Obtains the shared payloads which were allocated by the nanoapps of this
+   * event loop and not freed yet. Must only be called within the context of
+   * this EventLoop.
+   */
+  IntrusiveList<SharedPayload *> &getSharedPayloads() {
+    return mSharedPayloads;
+  }
+
+#ifdef CHRE_STATIC_EVENT_DISPATCH
+  //! Maps broadcast event types to the nanoapps registered for them.
+  typedef EventDispatchTable<Nanoapp, CHRE_MAX_BROADCAST_REGISTRATIONS>
+      BroadcastDispatchTable;
+
+  /**
+   * Obtains the table of broadcast event registrations of the nanoapps of
+   * this event loop. Must only be called within the context of this EventLoop.
+   */
+  BroadcastDispatchTable &getBroadcastDispatchTable() {
+    return mBroadcastDispatchTable;
+  }
+#endif  // CHRE_STATIC_EVENT_DISPATCH
+
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+  /**
+   * Obtains the watchdog timing the handling of events by the nanoapps of this
+   * event loop. Must only be called within the context of this EventLoop.
+   */
+  EventLoopWatchdog &getWatchdog() {
+    return mWatchdog;
+  }
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+
   /**
    * Searches the set of nanoapps managed by this EventLoop for one with the
    * given instance ID.
@@ -408,9 +479,27 @@ class EventLoop : public NonCopyable {
   //! The timer used schedule timed events for tasks running in this event loop.
   TimerPool mTimerPool;
 
+  //! The live shared payloads, see getSharedPayloads().
+  IntrusiveList<SharedPayload *> mSharedPayloads;
+
+#ifdef CHRE_STATIC_EVENT_DISPATCH
+  //! The broadcast event registrations of the nanoapps in mNanoapps.
+  BroadcastDispatchTable mBroadcastDispatchTable;
+#endif  // CHRE_STATIC_EVENT_DISPATCH
+
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+  //! Times the handling of events by the nanoapps in mNanoapps.
+  EventLoopWatchdog mWatchdog;
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+
   //! The list of nanoapps managed by this event loop.
   DynamicVector<UniquePtr<Nanoapp>> mNanoapps;
 
+  //! The nanoapps scheduled by scheduleNanoappStart() which haven't been
+  //! started yet, in the order they are started. Only accessed from the thread
+  //! that runs this event loop.
+  DynamicVector<UniquePtr<Nanoapp>> mPendingNanoappStarts;
+
   //! This lock *must* be held whenever we:
   //!   (1) make changes to the mNanoapps vector, or
   //!   (2) read the mNanoapps vector from a thread other than the one
@@ -477,7 +566,7 @@ class EventLoop : public NonCopyable {
   /**
    * Delivers the next event pending to the Nanoapp.
    */
-  void deliverNextEvent(const UniquePtr<Nanoapp> &app, Event *event);
+  void deliverNextEvent(Nanoapp &app, Event *event);
 
   /**
    * Given an event pulled from the main incoming event queue (mEvents), deliver
@@ -559,6 +648,17 @@ class EventLoop : public NonCopyable {
    * @param count The number of dangling resources.
    */
   void logDanglingResources(const char *name, uint32_t count);
+
+  /**
+   * @param appId The app ID of the nanoapp.
+   * @return true if a nanoapp with this app ID is in mPendingNanoappStarts.
+   */
+  bool isNanoappStartPending(uint64_t appId) const;
+
+  /**
+   * Starts the first nanoapp of mPendingNanoappStarts.
+   */
+  void startPendingNanoapp();
 };
 
 }  // namespace chre
@@ -76,6 +76,7 @@ enum class SystemCallbackType : uint16_t {
   ReliableMessageEvent,
   TimerPoolTimerExpired,
   TransactionManagerTimeout,
+  HostMessageBatchTimeout,
 };
 
 //! Deferred/delayed callbacks use the event subsystem but are invariably sent
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_CORE_EVENT_LOOP_WATCHDOG_H_
+#define CHRE_CORE_EVENT_LOOP_WATCHDOG_H_
+
+#include <cstdint>
+
+#include "chre/platform/atomic.h"
+#include "chre/platform/system_timer.h"
+#include "chre/util/array_queue.h"
+#include "chre/util/non_copyable.h"
+#include "chre/util/system/debug_dump.h"
+#include "chre/util/time.h"
+
+//! The default time a nanoapp may spend handling a single event, which can be
+//! overridden per nanoapp with Nanoapp::setEventBudget().
+#ifndef CHRE_EVENT_LOOP_WATCHDOG_BUDGET_MS
+#define CHRE_EVENT_LOOP_WATCHDOG_BUDGET_MS 100
+#endif
+
+//! The number of budget overruns kept for the debug dump.
+#ifndef CHRE_EVENT_LOOP_WATCHDOG_MAX_OVERRUNS
+#define CHRE_EVENT_LOOP_WATCHDOG_MAX_OVERRUNS 8
+#endif
+
+namespace chre {
+
+class Nanoapp;
+
+/**
+ * Times the handling of each event by a nanoapp against the budget of the
+ * nanoapp, so that a nanoapp stalling the event loop is identified while it
+ * stalls rather than through the latency of the events delivered after it.
+ *
+ * Each delivery is timed with the monotonic clock only. Once the nanoapp
+ * returns, an overrun is recorded for the debug dump, reported through the
+ * TelemetryManager and, if a throttle duration is set, the low-priority events
+ * of the nanoapp are dropped for that duration so that it holds up the other
+ * nanoapps less often.
+ *
+ * A nanoapp which never returns is caught by a SystemTimer set to the budget
+ * of the nanoapp when the watchdog is armed. Setting the timer moves the
+ * deadline of the previous delivery, so it is only cancelled once the event
+ * loop has no more events to distribute, and firing between deliveries is
+ * ignored. If it fires while a nanoapp is still handling an event, that
+ * nanoapp is logged from the timer context.
+ *
+ * Must only be used from the context of the EventLoop, apart from the timer
+ * callback.
+ */
+class EventLoopWatchdog : public NonCopyable {
+ public:
+  static constexpr Milliseconds kDefaultBudget =
+      Milliseconds(CHRE_EVENT_LOOP_WATCHDOG_BUDGET_MS);
+
+  EventLoopWatchdog();
+
+  /**
+   * Called before the event of a pass of the event loop is distributed.
+   *
+   * @param eventType the type of the event distributed in this pass
+   */
+  void onLoopPassStart(uint16_t eventType);
+
+  /**
+   * Called once the event of the pass was distributed, so that the timer is
+   * ignored if it fires before the next pass.
+   *
+   * @param eventsPending whether more events are queued, otherwise the timer
+   *        is cancelled so that it doesn't fire while the event loop is idle
+   */
+  void onLoopPassEnd(bool eventsPending);
+
+  /**
+   * Arms the watchdog before a nanoapp handles an event, setting the timer to
+   * the budget of the nanoapp. Events delivered synchronously while the
+   * watchdog is armed are accounted to the outer event, so arming is ignored
+   * in that case.
+   *
+   * @param nanoapp the nanoapp handling the event
+   * @param eventType the type of the event
+   *
+   * @return true if the watchdog was armed, in which case disarm() must be
+   *         called once the nanoapp returns
+   */
+  bool arm(Nanoapp &nanoapp, uint16_t eventType);
+
+  /**
+   * Disarms the watchdog once the nanoapp given to arm() returned, recording
+   * an overrun if it exceeded its budget.
+   */
+  void disarm();
+
+  /**
+   * @param nanoapp a nanoapp of the EventLoop
+   *
+   * @return true if the low-priority events of the nanoapp must be dropped
+   *         rather than delivered, as it recently exceeded its budget
+   */
+  bool isThrottled(const Nanoapp &nanoapp) const;
+
+  /**
+   * Sets the time the low-priority events of a nanoapp are dropped for after
+   * it exceeds its budget. Zero, the default, disables throttling.
+   */
+  void setThrottleDuration(Nanoseconds duration) {
+    mThrottleDuration = duration;
+  }
+
+  /**
+   * @return the number of overruns recorded since the EventLoop started
+   */
+  uint32_t getNumOverruns() const {
+    return mNumOverruns;
+  }
+
+  /**
+   * @return the number of times the timer fired while a nanoapp was still
+   *         handling an event, i.e. before the nanoapp returned
+   */
+  uint32_t getNumMissedDeadlines() const {
+    return mNumMissedDeadlines.load();
+  }
+
+  /**
+   * Prints the recent overruns in a string buffer.
+   */
+  void logStateToBuffer(DebugDumpWrapper &debugDump) const;
+
+ private:
+  //! An event which a nanoapp took longer than its budget to handle.
+  struct Overrun {
+    uint64_t appId;
+    uint64_t timestampNs;
+    uint32_t elapsedMs;
+    uint16_t eventType;
+  };
+
+  //! The value of mCurrentDelivery outside of the passes of the event loop.
+  static constexpr uint32_t kIdle = UINT32_MAX;
+
+  SystemTimer mTimer;
+
+  //! Whether mTimer was set since it was last cancelled.
+  bool mTimerSet = false;
+
+  //! The instance ID of the nanoapp handling an event in the upper 16 bits,
+  //! kSystemInstanceId between deliveries, and the type of the event in the
+  //! lower 16 bits, or kIdle. Packed so that the timer callback reads a
+  //! consistent snapshot.
+  AtomicUint32 mCurrentDelivery{kIdle};
+
+  //! Incremented from the timer context, see getNumMissedDeadlines().
+  AtomicUint32 mNumMissedDeadlines{0};
+
+  //! The type of the event distributed in the current pass.
+  uint16_t mPassEventType = 0;
+
+  //! The nanoapp handling an event while armed, or nullptr.
+  Nanoapp *mNanoapp = nullptr;
+  uint16_t mEventType = 0;
+  Nanoseconds mStartTime;
+  Nanoseconds mBudget;
+
+  Nanoseconds mThrottleDuration = Nanoseconds(0);
+
+  uint32_t mNumOverruns = 0;
+
+  //! The most recent overruns, oldest first.
+  ArrayQueue<Overrun, CHRE_EVENT_LOOP_WATCHDOG_MAX_OVERRUNS> mOverruns;
+
+  /**
+   * Records an overrun of the armed nanoapp and applies throttling.
+   */
+  void onBudgetExceeded(Nanoseconds elapsed);
+
+  static uint32_t packDelivery(uint16_t instanceId, uint16_t eventType) {
+    return (static_cast<uint32_t>(instanceId) << 16) | eventType;
+  }
+
+  static void handleTimerCallback(void *data);
+};
+
+}  // namespace chre
+
+#endif  // CHRE_CORE_EVENT_LOOP_WATCHDOG_H_
@@ -26,12 +26,18 @@
 #include "chre/platform/host_link.h"
 #include "chre/util/buffer.h"
 #include "chre/util/duplicate_message_detector.h"
+#include "chre/util/fixed_size_vector.h"
 #include "chre/util/non_copyable.h"
 #include "chre/util/synchronized_memory_pool.h"
+#include "chre/util/system/debug_dump.h"
 #include "chre/util/time.h"
 #include "chre/util/transaction_manager.h"
 #include "chre_api/chre/event.h"
 
+#ifdef CHRE_HOST_MESSAGE_BATCHING_ENABLED
+#include "chre/platform/shared/host_protocol_common.h"
+#endif  // CHRE_HOST_MESSAGE_BATCHING_ENABLED
+
 namespace chre {
 
 //! Only valid for messages from host to CHRE - indicates that the sender of the
@@ -222,27 +228,127 @@ class HostCommsManager : public HostLink, private TransactionManagerCallback {
                                     bool isReliable,
                                     uint32_t messageSequenceNumber);
 
+  /**
+   * Prints state in a string buffer. Must only be called from the context of
+   * the main CHRE thread.
+   *
+   * @param debugDump The debug dump wrapper where a string can be printed
+   *     into one of the buffers.
+   */
+  void logStateToBuffer(DebugDumpWrapper &debugDump) const;
+
  private:
+  friend class HostCommsManagerTest;
+  friend class HostMessageBatchingTest;
+
   //! How many times we'll try sending a reliable message before giving up.
   static constexpr uint16_t kReliableMessageMaxAttempts = 4;
 
   //! How long we'll wait after sending a reliable message which doesn't receive
-  //! an ACK before trying again.
+  //! an ACK before trying again, until we've measured the round trip time to
+  //! the destination host endpoint.
   static constexpr Milliseconds kReliableMessageRetryWaitTime =
       Milliseconds(250);
 
-  //! How long we'll wait before timing out a reliable message.
+  //! Bounds on the adaptive retry wait time, which is derived from the
+  //! measured round trip time to each host endpoint and doubled on each retry.
+  static constexpr Milliseconds kReliableMessageMinRetryWaitTime =
+      Milliseconds(50);
+  static constexpr Milliseconds kReliableMessageMaxRetryWaitTime =
+      Milliseconds(1000);
+
+  //! The longest a reliable message can be outstanding before timing out,
+  //! which is when every attempt waits for the maximum retry wait time, since
+  //! the adaptive wait time is clamped to it even after backoff.
   static constexpr Nanoseconds kReliableMessageTimeout =
-      kReliableMessageRetryWaitTime * kReliableMessageMaxAttempts;
+      Nanoseconds(kReliableMessageMaxRetryWaitTime) *
+      kReliableMessageMaxAttempts;
 
   //! How long we'll wait before removing a duplicate message record from the
-  //! duplicate message detector.
+  //! duplicate message detector. Must outlast the retries of the host for the
+  //! same message, which are bounded similarly to ours.
   static constexpr Nanoseconds kReliableMessageDuplicateDetectorTimeout =
       kReliableMessageTimeout * 3;
 
   //! The maximum number of messages we can have outstanding at any given time.
   static constexpr size_t kMaxOutstandingMessages = 32;
 
+  static_assert(kReliableMessageTimeout <=
+                    Nanoseconds(CHRE_ASYNC_RESULT_TIMEOUT_NS),
+                "Reliable message retries must complete within the async "
+                "result timeout");
+  static_assert((kMaxOutstandingMessages & (kMaxOutstandingMessages - 1)) == 0,
+                "Outstanding reliable message index size must be a power of 2");
+
+  //! The maximum number of host endpoints we keep reliable message statistics
+  //! for. The least recently used entry is replaced when this is exceeded.
+  static constexpr size_t kMaxReliableMessageEndpoints = 8;
+
+  //! Tracks an outstanding reliable message to the host, indexed by its
+  //! message sequence number.
+  struct OutstandingReliableMessage {
+    //! The message, or nullptr if this slot in the index is free.
+    MessageToHost *message = nullptr;
+
+    //! The time of the first attempt at sending the message.
+    Nanoseconds firstAttemptTime;
+
+    //! The number of attempts made at sending the message.
+    uint8_t attemptCount = 0;
+  };
+
+  //! Round trip time estimate and delivery statistics for reliable messages
+  //! sent to a single host endpoint. The RTT estimate follows RFC 6298.
+  struct ReliableMessageEndpointStats {
+    uint16_t hostEndpoint;
+
+    //! Smoothed round trip time and its mean deviation. Only valid when
+    //! rttSampleCount > 0.
+    Nanoseconds smoothedRtt;
+    Nanoseconds rttVariation;
+
+    //! The wait time before the first retry, derived from the RTT estimate.
+    Nanoseconds retryWaitTime = kReliableMessageRetryWaitTime;
+
+    //! Sum and maximum of the time from first attempt to delivery status, over
+    //! ackCount messages.
+    Nanoseconds totalLatency;
+    Nanoseconds maxLatency;
+
+    //! The last time a message was sent to or acknowledged by this endpoint,
+    //! used to pick an entry to replace.
+    Nanoseconds lastActivityTime;
+
+    uint32_t sentCount = 0;
+    uint32_t retryCount = 0;
+    uint32_t ackCount = 0;
+    uint32_t timeoutCount = 0;
+    uint32_t rttSampleCount = 0;
+  };
+
+#ifdef CHRE_HOST_MESSAGE_BATCHING_ENABLED
+  //! The maximum number of messages that are coalesced into a single
+  //! NanoappMessageBatch frame.
+  static constexpr size_t kMaxBatchedMessages = 8;
+
+  //! Estimated per-message encoding overhead in a NanoappMessageBatch.
+  static constexpr size_t kBatchedMessageOverhead =
+      HostProtocolCommon::kNanoappMessageEncodingOverhead;
+
+  //! The maximum estimated encoded size of the messages in a batch. Keeps a
+  //! batch frame, including its container, no larger than the largest single
+  //! message frame the transport already handles.
+  static constexpr size_t kMaxBatchEncodedSize =
+      CHRE_MESSAGE_TO_HOST_MAX_SIZE + kBatchedMessageOverhead -
+      HostProtocolCommon::kNanoappMessageBatchEncodingOverhead;
+
+  //! The maximum time a message can wait in the batch before it's sent.
+  static constexpr Milliseconds kMaxBatchAge = Milliseconds(20);
+
+  static_assert(kMaxBatchedMessages <= kMaxOutstandingMessages,
+                "Batch can't hold more messages than can be outstanding");
+#endif  // CHRE_HOST_MESSAGE_BATCHING_ENABLED
+
   //! Ensures that we do not blame more than once per host wakeup. This is
   //! checked before calling host blame to make sure it is set once. The power
   //! control managers then reset back to false on host suspend.
@@ -254,12 +360,40 @@ class HostCommsManager : public HostLink, private TransactionManagerCallback {
   //! messages directly in onMessageToHostComplete.
   SynchronizedMemoryPool<HostMessage, kMaxOutstandingMessages> mMessagePool;
 
+#ifdef CHRE_HOST_MESSAGE_BATCHING_ENABLED
+  //! Messages to the host that are waiting to be sent in the next
+  //! NanoappMessageBatch, in the order they were sent by nanoapps. Only
+  //! accessed from the event loop thread.
+  FixedSizeVector<const MessageToHost *, kMaxBatchedMessages> mMessageBatch;
+
+  //! The estimated encoded size of the messages in mMessageBatch.
+  size_t mMessageBatchEncodedSize = 0;
+
+  //! The timer used to flush mMessageBatch once its oldest message reaches
+  //! kMaxBatchAge.
+  TimerHandle mMessageBatchTimerHandle = CHRE_TIMER_INVALID;
+#endif  // CHRE_HOST_MESSAGE_BATCHING_ENABLED
+
 #ifdef CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
   //! The duplicate message detector for reliable messages.
   DuplicateMessageDetector mDuplicateMessageDetector;
 
   //! The transaction manager for reliable messages.
   TransactionManager<kMaxOutstandingMessages, TimerPool> mTransactionManager;
+
+  //! Open-addressed index of outstanding reliable messages to the host, keyed
+  //! by message sequence number. Only accessed from the event loop thread.
+  OutstandingReliableMessage
+      mOutstandingReliableMessages[kMaxOutstandingMessages];
+
+  //! The reliable message currently being passed to mTransactionManager.add(),
+  //! which may be attempted before it's added to the index since its sequence
+  //! number is only assigned during that call.
+  MessageToHost *mReliableMessageBeingAdded = nullptr;
+
+  //! Per host endpoint RTT estimates and statistics for reliable messages.
+  FixedSizeVector<ReliableMessageEndpointStats, kMaxReliableMessageEndpoints>
+      mReliableMessageEndpointStats;
 #endif  // CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
 
   /**
@@ -320,6 +454,29 @@ class HostCommsManager : public HostLink, private TransactionManagerCallback {
   bool doSendMessageToHostFromNanoapp(Nanoapp *nanoapp,
                                       MessageToHost *msgToHost);
 
+#ifdef CHRE_HOST_MESSAGE_BATCHING_ENABLED
+  /**
+   * Adds a message to the pending NanoappMessageBatch, first flushing the
+   * batch if the message doesn't fit. Arms the batch timer if the message is
+   * the first one in the batch. Must be called from the event loop thread.
+   *
+   * @param msgToHost The message to batch.
+   */
+  void addMessageToBatch(const MessageToHost *msgToHost);
+
+  /**
+   * Sends all messages in the pending NanoappMessageBatch to the host, if any,
+   * and cancels the batch timer. Must be called from the event loop thread.
+   */
+  void flushMessageBatch();
+
+  /**
+   * Invoked when the batch timer expires to flush the pending
+   * NanoappMessageBatch.
+   */
+  void onMessageBatchTimeout();
+#endif  // CHRE_HOST_MESSAGE_BATCHING_ENABLED
+
   /**
    * Find the message to the host associated with the message sequence number,
    * if it exists. Returns nullptr otherwise.
@@ -329,6 +486,62 @@ class HostCommsManager : public HostLink, private TransactionManagerCallback {
    */
   MessageToHost *findMessageToHostBySeq(uint32_t messageSequenceNumber);
 
+#ifdef CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+  /**
+   * Looks up an outstanding reliable message in the index by its message
+   * sequence number. Also indexes mReliableMessageBeingAdded if it matches.
+   *
+   * @param messageSequenceNumber The message sequence number.
+   * @return The index entry or nullptr if not found.
+   */
+  OutstandingReliableMessage *findOutstandingReliableMessage(
+      uint32_t messageSequenceNumber);
+
+  /**
+   * Adds a reliable message with an assigned sequence number to the index of
+   * outstanding messages, if it isn't already present.
+   *
+   * @param msgToHost The reliable message.
+   * @return The index entry for the message.
+   */
+  OutstandingReliableMessage *addOutstandingReliableMessage(
+      MessageToHost *msgToHost);
+
+  /**
+   * Removes a reliable message from the index of outstanding messages, if
+   * present.
+   *
+   * @param messageSequenceNumber The message sequence number.
+   */
+  void removeOutstandingReliableMessage(uint32_t messageSequenceNumber);
+
+  /**
+   * @return The statistics entry for the host endpoint, creating it (and
+   *         replacing the least recently used entry if needed) if it doesn't
+   *         exist.
+   */
+  ReliableMessageEndpointStats &getReliableMessageEndpointStats(
+      uint16_t hostEndpoint);
+
+  /**
+   * Updates the RTT estimate and latency statistics for the host endpoint of
+   * a reliable message once the host has acknowledged it.
+   *
+   * @param messageSequenceNumber The message sequence number.
+   */
+  void recordReliableMessageResponse(uint32_t messageSequenceNumber);
+
+  /**
+   * Folds a round trip time sample into the RTT estimate of a host endpoint
+   * per RFC 6298, and derives the retry wait time of the endpoint from it.
+   *
+   * @param stats The statistics entry of the host endpoint.
+   * @param rtt The round trip time sample.
+   */
+  static void updateRttEstimate(ReliableMessageEndpointStats &stats,
+                                Nanoseconds rtt);
+#endif  // CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+
   /**
    * Releases memory associated with a message to the host, including invoking
    * the Nanoapp's free callback (if given). Must be called from within the
@@ -353,6 +566,16 @@ class HostCommsManager : public HostLink, private TransactionManagerCallback {
   void onTransactionFailure(uint32_t messageSequenceNumber,
                             uint16_t nanoappInstanceId) final;
 
+  /**
+   * Computes the retry wait time for a reliable message from the RTT estimate
+   * of its host endpoint, with exponential backoff on each attempt.
+   * @see TransactionManagerCallback
+   */
+  Nanoseconds getTransactionTimeout(uint32_t messageSequenceNumber,
+                                    uint16_t nanoappInstanceId,
+                                    uint8_t attemptCount,
+                                    Nanoseconds defaultTimeout) final;
+
   /**
    * Handles a duplicate message from the host by setting the error in the
    * duplicate message detector and sends a message delivery status to the
@@ -23,6 +23,7 @@
 
 #include "chre/core/event.h"
 #include "chre/core/event_ref_queue.h"
+#include "chre/core/shared_payload.h"
 #include "chre/platform/heap_block_header.h"
 #include "chre/platform/platform_nanoapp.h"
 #include "chre/platform/system_time.h"
@@ -33,6 +34,10 @@
 #include "chre/util/system/stats_container.h"
 #include "chre_api/chre/event.h"
 
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+#include "chre/core/event_loop_watchdog.h"
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+
 namespace chre {
 
 /**
@@ -107,6 +112,100 @@ class Nanoapp : public PlatformNanoapp {
     }
   }
 
+  /**
+   * @return The number of references to shared payloads the nanoapp holds.
+   *
+   * @see chreSharedPayloadAlloc
+   */
+  size_t getNumSharedPayloadRefs() const {
+    return mSharedPayloadRefs.size();
+  }
+
+  /**
+   * Records a reference to a shared payload taken by the nanoapp, so that it's
+   * released when the nanoapp is unloaded if the nanoapp doesn't release it.
+   *
+   * @return false if the reference couldn't be recorded
+   */
+  bool addSharedPayloadRef(SharedPayload *payload);
+
+  /**
+   * Forgets a reference recorded by addSharedPayloadRef(), once the nanoapp
+   * releases it.
+   *
+   * @return false if the nanoapp doesn't hold a reference to the payload
+   */
+  bool removeSharedPayloadRef(const SharedPayload *payload);
+
+  /**
+   * Releases the references to shared payloads the nanoapp still holds, e.g.
+   * when it's unloaded. Other nanoapps may still hold references to the same
+   * payloads.
+   *
+   * @return The number of references released.
+   */
+  uint32_t releaseSharedPayloadRefs();
+
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+  /**
+   * @return The time the nanoapp may spend handling a single event before the
+   *     EventLoopWatchdog records an overrun.
+   */
+  Nanoseconds getEventBudget() const {
+    return mEventBudget;
+  }
+
+  /**
+   * Overrides the default budget of the nanoapp, e.g. for nanoapps known to
+   * do heavy processing on some events.
+   */
+  void setEventBudget(Nanoseconds budget) {
+    mEventBudget = budget;
+  }
+
+  /**
+   * @return The number of events the nanoapp exceeded its budget on.
+   */
+  uint32_t getNumEventBudgetOverruns() const {
+    return mNumEventBudgetOverruns;
+  }
+
+  /**
+   * @return The number of low-priority events dropped while the nanoapp was
+   *     throttled.
+   */
+  uint32_t getNumThrottledEvents() const {
+    return mNumThrottledEvents;
+  }
+
+  /**
+   * @return The time until which the low-priority events of the nanoapp are
+   *     dropped.
+   */
+  Nanoseconds getThrottledUntil() const {
+    return mThrottledUntil;
+  }
+
+  /**
+   * Called by the EventLoopWatchdog when the nanoapp exceeds its budget.
+   *
+   * @param throttledUntil The time until which the low-priority events of the
+   *     nanoapp are dropped.
+   */
+  void onEventBudgetExceeded(Nanoseconds throttledUntil) {
+    if (mNumEventBudgetOverruns < UINT32_MAX) ++mNumEventBudgetOverruns;
+    mThrottledUntil = throttledUntil;
+  }
+
+  /**
+   * Called when a low-priority event isn't delivered to the nanoapp because it
+   * is throttled.
+   */
+  void onEventThrottled() {
+    if (mNumThrottledEvents < UINT32_MAX) ++mNumThrottledEvents;
+  }
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+
   /**
    * @return true if the nanoapp should receive broadcast event
    */
@@ -121,8 +220,10 @@ class Nanoapp : public PlatformNanoapp {
    * @param groupIdMask A mask of group IDs to register the nanoapp for. If an
    *     event is sent that targets any of the group IDs in the mask, it will
    *     be delivered to the nanoapp.
+   * @return false if the registration couldn't be recorded, i.e. the table of
+   *     CHRE_MAX_BROADCAST_REGISTRATIONS is full with static event dispatch
    */
-  void registerForBroadcastEvent(
+  bool registerForBroadcastEvent(
       uint16_t eventType, uint16_t groupIdMask = kDefaultTargetGroupMask);
 
   /**
@@ -136,6 +237,13 @@ class Nanoapp : public PlatformNanoapp {
   void unregisterForBroadcastEvent(
       uint16_t eventType, uint16_t groupIdMask = kDefaultTargetGroupMask);
 
+  /**
+   * @param eventType The broadcast event type to look up.
+   * @return The mask of group IDs the nanoapp is registered for events of the
+   *     given type with, or 0 if it isn't registered for them.
+   */
+  uint16_t getBroadcastEventGroupIdMask(uint16_t eventType) const;
+
   /**
    * Configures whether nanoapp info events will be sent to the nanoapp.
    * Nanoapps are not sent nanoapp start/stop events by default.
@@ -244,6 +352,23 @@ class Nanoapp : public PlatformNanoapp {
    */
   void logMessageHistoryEntry(DebugDumpWrapper &debugDump) const;
 
+  /**
+   * Prints header for the start time stats table in a string buffer. Must only
+   * be called from the context of the main CHRE thread.
+   *
+   * @param debugDump The object that is printed into for debug dump logs.
+   */
+  void logStartTimesHeader(DebugDumpWrapper &debugDump) const;
+
+  /**
+   * Prints the time spent in each phase of starting the nanoapp, see
+   * NanoappStartTimes, in a string buffer. Must only be called from the context
+   * of the main CHRE thread.
+   *
+   * @param debugDump The object that is printed into for debug dump logs.
+   */
+  void logStartTimesEntry(DebugDumpWrapper &debugDump) const;
+
   /**
    * @return true if the nanoapp is permitted to use the provided permission.
    */
@@ -329,6 +454,18 @@ class Nanoapp : public PlatformNanoapp {
   //! The peak total number of bytes allocated by the nanoapp.
   size_t mPeakAllocatedBytes = 0;
 
+  //! The references to shared payloads held by the nanoapp, with one entry
+  //! per reference.
+  DynamicVector<SharedPayload *> mSharedPayloadRefs;
+
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+  //! The state of the nanoapp kept by the EventLoopWatchdog.
+  Nanoseconds mEventBudget = EventLoopWatchdog::kDefaultBudget;
+  Nanoseconds mThrottledUntil = Nanoseconds(0);
+  uint32_t mNumEventBudgetOverruns = 0;
+  uint32_t mNumThrottledEvents = 0;
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+
   //! Container for "bucketed" stats associated with wakeup logging
   struct BucketedStats {
     BucketedStats(uint16_t wakeupCount_, uint16_t hostMessageCount_,
@@ -355,6 +492,7 @@ class Nanoapp : public PlatformNanoapp {
   //! Collects process time in nanoseconds of each event
   StatsContainer<uint64_t> mEventProcessTime;
 
+#ifndef CHRE_STATIC_EVENT_DISPATCH
   //! Metadata needed for keeping track of the registered events for this
   //! nanoapp.
   struct EventRegistration {
@@ -370,6 +508,7 @@ class Nanoapp : public PlatformNanoapp {
   // also be a better way of handling this (perhaps we map event type to apps
   // who care about them).
   DynamicVector<EventRegistration> mRegisteredEvents;
+#endif  // CHRE_STATIC_EVENT_DISPATCH
 
   //! The registered host endpoints to receive notifications for.
   DynamicVector<uint16_t> mRegisteredHostEndpoints;
@@ -380,9 +519,11 @@ class Nanoapp : public PlatformNanoapp {
   //! Whether nanoappStart is being executed.
   bool mIsInNanoappStart = false;
 
+#ifndef CHRE_STATIC_EVENT_DISPATCH
   //! @return index of event registration if found. mRegisteredEvents.size() if
   //!     not.
   size_t registrationIndex(uint16_t eventType) const;
+#endif  // CHRE_STATIC_EVENT_DISPATCH
 
   /**
    * A special function to deliver GNSS measurement events to nanoapps and
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_CORE_SHARED_PAYLOAD_H_
+#define CHRE_CORE_SHARED_PAYLOAD_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chre/util/intrusive_list.h"
+#include "chre/util/system/ref_base.h"
+
+namespace chre {
+
+class Nanoapp;
+
+/**
+ * The header of a payload allocated by chreSharedPayloadAlloc(), which
+ * precedes the data of the payload in the same allocation. The payload is
+ * freed from the system heap once its last reference is released, regardless
+ * of which nanoapp allocated it, and is charged to the heap usage of that
+ * nanoapp until then.
+ *
+ * Live payloads are linked in the list returned by
+ * EventLoop::getSharedPayloads(), so the pointers passed by nanoapps can be
+ * validated without reading memory CHRE didn't allocate. Payloads must only be
+ * allocated and released within the context of the EventLoop.
+ */
+class alignas(8) SharedPayload : public RefBase<SharedPayload> {
+ public:
+  /**
+   * Allocates a shared payload with a single reference.
+   *
+   * @param nanoapp the nanoapp allocating the payload, which is charged for it
+   * @param size the size of the data of the payload in bytes
+   *
+   * @return the payload, or nullptr if the allocation failed
+   */
+  static SharedPayload *allocate(Nanoapp &nanoapp, uint32_t size);
+
+  /**
+   * @param data the data of a payload, as returned by getData()
+   *
+   * @return the payload, or nullptr if data is null or isn't the data of a
+   *         live shared payload. Only compares data with the addresses of the
+   *         live payloads, so it's safe to call with any pointer.
+   */
+  static SharedPayload *fromData(const void *data);
+
+  /**
+   * @return the data of the payload, which follows its header
+   */
+  void *getData() {
+    return this + 1;
+  }
+
+ private:
+  friend class RefBase<SharedPayload>;
+
+  //! Links the payload in the list of live payloads.
+  ListNode<SharedPayload *> mNode;
+
+  //! The size of the data of the payload in bytes.
+  uint32_t mSize;
+
+  //! The instance ID of the nanoapp charged for the payload.
+  uint16_t mInstanceId;
+
+  SharedPayload(uint32_t size, uint16_t instanceId)
+      : mNode(this), mSize(size), mInstanceId(instanceId) {}
+
+  ~SharedPayload() override;
+};
+
+}  // namespace chre
+
+#endif  // CHRE_CORE_SHARED_PAYLOAD_H_
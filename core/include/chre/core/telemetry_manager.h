@@ -20,9 +20,12 @@
 #include <cinttypes>
 
 #include "chre/util/non_copyable.h"
+#include "chre/util/time.h"
 
 namespace chre {
 
+class Nanoapp;
+
 /**
  * Container class that handles reporting system telemetry metrics to the host.
  */
@@ -50,6 +53,26 @@ class TelemetryManager : public NonCopyable {
    */
   void onPalOpenFailure(PalType type);
 
+  /**
+   * Sends telemetry data related to the time spent starting a nanoapp.
+   *
+   * @param nanoapp The nanoapp that was started successfully.
+   */
+  void onNanoappStarted(const Nanoapp &nanoapp);
+
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+  /**
+   * Sends telemetry data related to a nanoapp exceeding its budget for handling
+   * an event.
+   *
+   * @param nanoapp The nanoapp that exceeded its budget.
+   * @param eventType The type of the event the nanoapp was handling.
+   * @param elapsed The time the nanoapp spent handling the event.
+   */
+  void onEventBudgetExceeded(const Nanoapp &nanoapp, uint16_t eventType,
+                             Nanoseconds elapsed);
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+
   /**
    * Collects system-level metrics to send to the host for logging.
    */
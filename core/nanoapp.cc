@@ -49,7 +49,9 @@ bool Nanoapp::start() {
   // TODO(b/294116163): update trace with nanoapp instance id and nanoapp name
   CHRE_TRACE_INSTANT("Nanoapp start");
   mIsInNanoappStart = true;
+  Nanoseconds startTime = SystemTime::getMonotonicTime();
   bool success = PlatformNanoapp::start();
+  mStartTimes.total = SystemTime::getMonotonicTime() - startTime;
   mIsInNanoappStart = false;
   return success;
 }
@@ -66,6 +68,12 @@ bool Nanoapp::isRegisteredForBroadcastEvent(const Event *event) const {
         static_cast<const chreHostEndpointNotification *>(event->eventData);
     registered = isRegisteredForHostEndpointNotifications(data->hostEndpointId);
   } else {
+#ifdef CHRE_STATIC_EVENT_DISPATCH
+    registered = EventLoopManagerSingleton::get()
+                     ->getEventLoop()
+                     .getBroadcastDispatchTable()
+                     .isRegistered(this, eventType, targetGroupIdMask);
+#else
     size_t foundIndex = registrationIndex(eventType);
     if (foundIndex < mRegisteredEvents.size()) {
       const EventRegistration &reg = mRegisteredEvents[foundIndex];
@@ -73,12 +81,24 @@ bool Nanoapp::isRegisteredForBroadcastEvent(const Event *event) const {
         registered = true;
       }
     }
+#endif  // CHRE_STATIC_EVENT_DISPATCH
   }
   return registered;
 }
 
-void Nanoapp::registerForBroadcastEvent(uint16_t eventType,
+bool Nanoapp::registerForBroadcastEvent(uint16_t eventType,
                                         uint16_t groupIdMask) {
+#ifdef CHRE_STATIC_EVENT_DISPATCH
+  if (!EventLoopManagerSingleton::get()
+           ->getEventLoop()
+           .getBroadcastDispatchTable()
+           .registerEvent(this, eventType, groupIdMask)) {
+    LOGE("Can't register app 0x%016" PRIx64 " for event 0x%" PRIx16
+         ": CHRE_MAX_BROADCAST_REGISTRATIONS reached",
+         getAppId(), eventType);
+    return false;
+  }
+#else
   size_t foundIndex = registrationIndex(eventType);
   if (foundIndex < mRegisteredEvents.size()) {
     mRegisteredEvents[foundIndex].groupIdMask |= groupIdMask;
@@ -86,10 +106,18 @@ void Nanoapp::registerForBroadcastEvent(uint16_t eventType,
                  EventRegistration(eventType, groupIdMask))) {
     FATAL_ERROR_OOM();
   }
+#endif  // CHRE_STATIC_EVENT_DISPATCH
+  return true;
 }
 
 void Nanoapp::unregisterForBroadcastEvent(uint16_t eventType,
                                           uint16_t groupIdMask) {
+#ifdef CHRE_STATIC_EVENT_DISPATCH
+  EventLoopManagerSingleton::get()
+      ->getEventLoop()
+      .getBroadcastDispatchTable()
+      .unregisterEvent(this, eventType, groupIdMask);
+#else
   size_t foundIndex = registrationIndex(eventType);
   if (foundIndex < mRegisteredEvents.size()) {
     EventRegistration &reg = mRegisteredEvents[foundIndex];
@@ -98,6 +126,48 @@ void Nanoapp::unregisterForBroadcastEvent(uint16_t eventType,
       mRegisteredEvents.erase(foundIndex);
     }
   }
+#endif  // CHRE_STATIC_EVENT_DISPATCH
+}
+
+uint16_t Nanoapp::getBroadcastEventGroupIdMask(uint16_t eventType) const {
+#ifdef CHRE_STATIC_EVENT_DISPATCH
+  return EventLoopManagerSingleton::get()
+      ->getEventLoop()
+      .getBroadcastDispatchTable()
+      .getGroupIdMask(this, eventType);
+#else
+  size_t foundIndex = registrationIndex(eventType);
+  return (foundIndex < mRegisteredEvents.size())
+             ? mRegisteredEvents[foundIndex].groupIdMask
+             : 0;
+#endif  // CHRE_STATIC_EVENT_DISPATCH
+}
+
+bool Nanoapp::addSharedPayloadRef(SharedPayload *payload) {
+  bool success = mSharedPayloadRefs.push_back(payload);
+  if (!success) {
+    LOG_OOM();
+  }
+  return success;
+}
+
+bool Nanoapp::removeSharedPayloadRef(const SharedPayload *payload) {
+  for (size_t i = 0; i < mSharedPayloadRefs.size(); i++) {
+    if (mSharedPayloadRefs[i] == payload) {
+      mSharedPayloadRefs.erase(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t Nanoapp::releaseSharedPayloadRefs() {
+  auto numRefs = static_cast<uint32_t>(mSharedPayloadRefs.size());
+  for (SharedPayload *payload : mSharedPayloadRefs) {
+    payload->decRef();
+  }
+  mSharedPayloadRefs.clear();
+  return numRefs;
 }
 
 void Nanoapp::configureNanoappInfoEvents(bool enable) {
@@ -323,11 +393,33 @@ void Nanoapp::logMessageHistoryEntry(DebugDumpWrapper &debugDump) const {
   debugDump.print(" %6" PRIu64 "\n", mWakeupBuckets.front().eventProcessTime);
 }
 
+void Nanoapp::logStartTimesHeader(DebugDumpWrapper &debugDump) const {
+  debugDump.print("\n%10sNanoapp%9s|%13sStart Time (Us)\n", "", "", "");
+  debugDump.print(
+      "%26s|    Load |   Reloc |    Init |   Start |   Total\n", "");
+}
+
+void Nanoapp::logStartTimesEntry(DebugDumpWrapper &debugDump) const {
+  const NanoappStartTimes &times = getStartTimes();
+  debugDump.print("%25s |", getAppName());
+  debugDump.print(" %7" PRIu64 " |", times.load.toRawNanoseconds() /
+                                         kOneMicrosecondInNanoseconds);
+  debugDump.print(" %7" PRIu64 " |", times.relocation.toRawNanoseconds() /
+                                         kOneMicrosecondInNanoseconds);
+  debugDump.print(" %7" PRIu64 " |", times.initArray.toRawNanoseconds() /
+                                         kOneMicrosecondInNanoseconds);
+  debugDump.print(" %7" PRIu64 " |", times.start.toRawNanoseconds() /
+                                         kOneMicrosecondInNanoseconds);
+  debugDump.print(" %7" PRIu64 "\n", times.total.toRawNanoseconds() /
+                                        kOneMicrosecondInNanoseconds);
+}
+
 bool Nanoapp::permitPermissionUse(uint32_t permission) const {
   return !supportsAppPermissions() ||
          ((getAppPermissions() & permission) == permission);
 }
 
+#ifndef CHRE_STATIC_EVENT_DISPATCH
 size_t Nanoapp::registrationIndex(uint16_t eventType) const {
   size_t foundIndex = 0;
   for (; foundIndex < mRegisteredEvents.size(); ++foundIndex) {
@@ -338,6 +430,7 @@ size_t Nanoapp::registrationIndex(uint16_t eventType) const {
   }
   return foundIndex;
 }
+#endif  // CHRE_STATIC_EVENT_DISPATCH
 
 void Nanoapp::handleGnssMeasurementDataEvent(const Event *event) {
 #ifdef CHRE_GNSS_MEASUREMENT_BACK_COMPAT_ENABLED
@@ -224,8 +224,8 @@ bool SensorRequestManager::setSensorRequest(
       } else if (!nanoappHasRequest) {
         // The request changes the mode to the enabled state and there was no
         // existing request. The request is newly created and added to the
-        // multiplexer. The nanoapp is registered for events if this request was
-        // successful.
+        // multiplexer. The nanoapp is registered for events first, so that the
+        // request isn't made if the nanoapp couldn't receive them.
         uint16_t biasEventType;
         if (sensor.getBiasEventType(&biasEventType) && sensor.isCalibrated()) {
           // Per API requirements, turn on bias reporting for calibrated sensors
@@ -233,22 +233,35 @@ bool SensorRequestManager::setSensorRequest(
           request.setBiasUpdatesRequested(true);
         }
 
-        success = addRequest(sensor, request, &requestChanged);
-        if (success) {
-          nanoapp->registerForBroadcastEvent(eventType,
-                                             sensor.getTargetGroupMask());
-
-          if (request.getBiasUpdatesRequested()) {
-            nanoapp->registerForBroadcastEvent(biasEventType,
-                                               sensor.getTargetGroupMask());
+        uint16_t groupIdMask = sensor.getTargetGroupMask();
+        bool biasUpdatesRequested = request.getBiasUpdatesRequested();
+        // A failed request only removes the registrations it added, e.g. not
+        // one made through chreSensorConfigureBiasEvents().
+        uint16_t addedEventGroups =
+            groupIdMask & ~nanoapp->getBroadcastEventGroupIdMask(eventType);
+        uint16_t addedBiasGroups =
+            biasUpdatesRequested
+                ? groupIdMask &
+                      ~nanoapp->getBroadcastEventGroupIdMask(biasEventType)
+                : 0;
+        success =
+            nanoapp->registerForBroadcastEvent(eventType, groupIdMask) &&
+            (!biasUpdatesRequested ||
+             nanoapp->registerForBroadcastEvent(biasEventType, groupIdMask)) &&
+            addRequest(sensor, request, &requestChanged);
+        if (!success) {
+          if (addedEventGroups != 0) {
+            nanoapp->unregisterForBroadcastEvent(eventType, addedEventGroups);
           }
-
-          // Deliver last valid event to new clients of on-change sensors
-          if (sensor.getLastEvent() != nullptr) {
-            EventLoopManagerSingleton::get()->getEventLoop().postEventOrDie(
-                eventType, sensor.getLastEvent(), nullptr /* freeCallback */,
-                nanoapp->getInstanceId());
+          if (addedBiasGroups != 0) {
+            nanoapp->unregisterForBroadcastEvent(biasEventType,
+                                                 addedBiasGroups);
           }
+        } else if (sensor.getLastEvent() != nullptr) {
+          // Deliver last valid event to new clients of on-change sensors
+          EventLoopManagerSingleton::get()->getEventLoop().postEventOrDie(
+              eventType, sensor.getLastEvent(), nullptr /* freeCallback */,
+              nanoapp->getInstanceId());
         }
       } else {
         // Ensure bias events stay requested if they were previously enabled.
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/core/shared_payload.h"
+
+#include <new>
+
+#include "chre/core/event_loop_manager.h"
+#include "chre/core/nanoapp.h"
+#include "chre/platform/log.h"
+#include "chre/platform/memory.h"
+
+namespace chre {
+
+SharedPayload *SharedPayload::allocate(Nanoapp &nanoapp, uint32_t size) {
+  MemoryManager &memoryManager =
+      EventLoopManagerSingleton::get()->getMemoryManager();
+  if (!memoryManager.nanoappCharge(&nanoapp, size)) {
+    return nullptr;
+  }
+
+  void *memory = memoryAlloc(sizeof(SharedPayload) + size);
+  if (memory == nullptr) {
+    LOG_OOM();
+    memoryManager.nanoappUncharge(&nanoapp, size);
+    return nullptr;
+  }
+  auto *payload = new (memory) SharedPayload(size, nanoapp.getInstanceId());
+  IntrusiveList<SharedPayload *> &payloads =
+      EventLoopManagerSingleton::get()->getEventLoop().getSharedPayloads();
+  payloads.link_back(&payload->mNode);
+  return payload;
+}
+
+SharedPayload *SharedPayload::fromData(const void *data) {
+  if (data == nullptr) {
+    return nullptr;
+  }
+  uintptr_t address =
+      reinterpret_cast<uintptr_t>(data) - sizeof(SharedPayload);
+  for (ListNode<SharedPayload *> &node :
+       EventLoopManagerSingleton::get()->getEventLoop().getSharedPayloads()) {
+    if (reinterpret_cast<uintptr_t>(node.item) == address) {
+      return node.item;
+    }
+  }
+  return nullptr;
+}
+
+SharedPayload::~SharedPayload() {
+  IntrusiveList<SharedPayload *> &payloads =
+      EventLoopManagerSingleton::get()->getEventLoop().getSharedPayloads();
+  payloads.unlink_node(&mNode);
+
+  // The nanoapp charged for the payload may have been unloaded since
+  Nanoapp *nanoapp = EventLoopManagerSingleton::get()
+                         ->getEventLoop()
+                         .findNanoappByInstanceId(mInstanceId);
+  EventLoopManagerSingleton::get()->getMemoryManager().nanoappUncharge(nanoapp,
+                                                                       mSize);
+}
+
+}  // namespace chre
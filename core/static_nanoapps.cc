@@ -65,8 +65,11 @@ void loadStaticNanoapps() {
     // Cast the kStaticNanoappCount to size_t to avoid tautological comparison
     // warnings when the kStaticNanoappCount is zero.
     for (size_t i = 0; i < reinterpret_cast<size_t>(kStaticNanoappCount); i++) {
+      // The nanoapps are started by the event loop, interleaved with the
+      // events posted in the meantime
       UniquePtr<Nanoapp> nanoapp = kStaticNanoappList[i]();
-      EventLoopManagerSingleton::get()->getEventLoop().startNanoapp(nanoapp);
+      EventLoopManagerSingleton::get()->getEventLoop().scheduleNanoappStart(
+          nanoapp);
     }
   }
 }
@@ -19,6 +19,7 @@
 #include <pb_encode.h>
 
 #include "chre/core/event_loop_manager.h"
+#include "chre/core/nanoapp.h"
 #include "chre/platform/fatal_error.h"
 #include "chre/platform/shared/host_protocol_chre.h"
 #include "chre/util/macros.h"
@@ -46,6 +47,8 @@ namespace {
 // hardware/google/pixel/pixelstats/pixelatoms.proto.
 constexpr uint32_t kEventQueueSnapshotReportedId = 105035;
 constexpr uint32_t kPalOpenedFailedId = 105032;
+constexpr uint32_t kNanoappStartReportedId = 105037;
+constexpr uint32_t kNanoappEventBudgetExceededId = 105038;
 
 void sendMetricToHost(uint32_t atomId, const pb_field_t fields[],
                       const void *data) {
@@ -102,6 +105,54 @@ void sendEventLoopStats(uint32_t maxQueueSize, uint32_t numDroppedEvents) {
                    &result);
 }
 
+void sendNanoappStartMetric(const Nanoapp &nanoapp) {
+  const NanoappStartTimes &times = nanoapp.getStartTimes();
+  _android_chre_metrics_ChreNanoappStartReported result =
+      CHREATOMS_GET(ChreNanoappStartReported_init_default);
+  result.has_nanoapp_id = true;
+  result.nanoapp_id = static_cast<int64_t>(nanoapp.getAppId());
+  result.has_load_time_us = true;
+  result.load_time_us =
+      times.load.toRawNanoseconds() / kOneMicrosecondInNanoseconds;
+  result.has_relocation_time_us = true;
+  result.relocation_time_us =
+      times.relocation.toRawNanoseconds() / kOneMicrosecondInNanoseconds;
+  result.has_init_array_time_us = true;
+  result.init_array_time_us =
+      times.initArray.toRawNanoseconds() / kOneMicrosecondInNanoseconds;
+  result.has_start_time_us = true;
+  result.start_time_us =
+      times.start.toRawNanoseconds() / kOneMicrosecondInNanoseconds;
+  result.has_total_time_us = true;
+  result.total_time_us =
+      times.total.toRawNanoseconds() / kOneMicrosecondInNanoseconds;
+
+  sendMetricToHost(kNanoappStartReportedId,
+                   CHREATOMS_GET(ChreNanoappStartReported_fields), &result);
+}
+
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+void sendEventBudgetExceededMetric(const Nanoapp &nanoapp, uint16_t eventType,
+                                   Nanoseconds elapsed) {
+  _android_chre_metrics_ChreNanoappEventBudgetExceeded result =
+      CHREATOMS_GET(ChreNanoappEventBudgetExceeded_init_default);
+  result.has_nanoapp_id = true;
+  result.nanoapp_id = static_cast<int64_t>(nanoapp.getAppId());
+  result.has_event_type = true;
+  result.event_type = eventType;
+  result.has_elapsed_time_ms = true;
+  result.elapsed_time_ms =
+      static_cast<int64_t>(Milliseconds(elapsed).getMilliseconds());
+  result.has_budget_ms = true;
+  result.budget_ms = static_cast<int64_t>(
+      Milliseconds(nanoapp.getEventBudget()).getMilliseconds());
+
+  sendMetricToHost(kNanoappEventBudgetExceededId,
+                   CHREATOMS_GET(ChreNanoappEventBudgetExceeded_fields),
+                   &result);
+}
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+
 _android_chre_metrics_ChrePalType toAtomPalType(
     TelemetryManager::PalType type) {
   switch (type) {
@@ -148,6 +199,18 @@ void TelemetryManager::onPalOpenFailure(PalType type) {
       callback);
 }
 
+void TelemetryManager::onNanoappStarted(const Nanoapp &nanoapp) {
+  sendNanoappStartMetric(nanoapp);
+}
+
+#ifdef CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+void TelemetryManager::onEventBudgetExceeded(const Nanoapp &nanoapp,
+                                             uint16_t eventType,
+                                             Nanoseconds elapsed) {
+  sendEventBudgetExceededMetric(nanoapp, eventType, elapsed);
+}
+#endif  // CHRE_EVENT_LOOP_WATCHDOG_ENABLED
+
 void TelemetryManager::collectSystemMetrics() {
   EventLoop &eventLoop = EventLoopManagerSingleton::get()->getEventLoop();
   sendEventLoopStats(eventLoop.getMaxEventQueueSize(),
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+#include "chre/core/event_dispatch_table.h"
+
+using chre::EventDispatchTable;
+
+namespace {
+
+constexpr uint16_t kEventType = 0x0401;
+constexpr uint16_t kOtherEventType = 0x0402;
+constexpr uint16_t kGroup1 = 0x0001;
+constexpr uint16_t kGroup2 = 0x0002;
+
+class FakeNanoapp {
+ public:
+  explicit FakeNanoapp(uint16_t instanceId) : mInstanceId(instanceId) {}
+
+  uint16_t getInstanceId() const {
+    return mInstanceId;
+  }
+
+ private:
+  uint16_t mInstanceId;
+};
+
+typedef EventDispatchTable<FakeNanoapp, 4> FakeDispatchTable;
+
+//! Counts the handlers of an event as the EventLoop iterates them.
+size_t countHandlers(const FakeDispatchTable &table, uint16_t eventType,
+                     uint16_t targetGroupMask) {
+  size_t count = 0;
+  uint32_t minInstanceId = 0;
+  FakeNanoapp *app;
+  while ((app = table.findNextHandler(eventType, targetGroupMask,
+                                      minInstanceId)) != nullptr) {
+    count++;
+    minInstanceId = app->getInstanceId() + 1u;
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST(EventDispatchTable, FindsHandlersInInstanceIdOrder) {
+  FakeDispatchTable table;
+  FakeNanoapp app1(1), app2(2), app3(3);
+  EXPECT_TRUE(table.registerEvent(&app3, kEventType, kGroup1));
+  EXPECT_TRUE(table.registerEvent(&app1, kEventType, kGroup1));
+  EXPECT_TRUE(table.registerEvent(&app2, kOtherEventType, kGroup1));
+  EXPECT_EQ(table.size(), 3);
+
+  EXPECT_EQ(table.findNextHandler(kEventType, kGroup1, 0), &app1);
+  EXPECT_EQ(table.findNextHandler(kEventType, kGroup1, 2), &app3);
+  EXPECT_EQ(table.findNextHandler(kEventType, kGroup1, 4), nullptr);
+  EXPECT_EQ(table.findNextHandler(kOtherEventType, kGroup1, 0), &app2);
+  EXPECT_EQ(table.findNextHandler(kEventType + 2, kGroup1, 0), nullptr);
+  EXPECT_EQ(countHandlers(table, kEventType, kGroup1), 2);
+}
+
+TEST(EventDispatchTable, MatchesGroups) {
+  FakeDispatchTable table;
+  FakeNanoapp app1(1), app2(2);
+  EXPECT_TRUE(table.registerEvent(&app1, kEventType, kGroup1));
+  EXPECT_TRUE(table.registerEvent(&app2, kEventType, kGroup2));
+  EXPECT_TRUE(table.registerEvent(&app1, kEventType, kGroup2));
+  EXPECT_EQ(table.size(), 2);
+
+  EXPECT_EQ(countHandlers(table, kEventType, kGroup1), 1);
+  EXPECT_EQ(countHandlers(table, kEventType, kGroup2), 2);
+  EXPECT_TRUE(table.isRegistered(&app1, kEventType, kGroup1));
+  EXPECT_FALSE(table.isRegistered(&app2, kEventType, kGroup1));
+  EXPECT_EQ(table.getGroupIdMask(&app1, kEventType), kGroup1 | kGroup2);
+  EXPECT_EQ(table.getGroupIdMask(&app2, kEventType), kGroup2);
+  EXPECT_EQ(table.getGroupIdMask(&app1, kOtherEventType), 0);
+
+  table.unregisterEvent(&app1, kEventType, kGroup1);
+  EXPECT_FALSE(table.isRegistered(&app1, kEventType, kGroup1));
+  EXPECT_EQ(table.getGroupIdMask(&app1, kEventType), kGroup2);
+  EXPECT_TRUE(table.isRegistered(&app1, kEventType, kGroup2));
+  table.unregisterEvent(&app1, kEventType, kGroup2);
+  EXPECT_EQ(table.size(), 1);
+  EXPECT_EQ(countHandlers(table, kEventType, kGroup2), 1);
+}
+
+TEST(EventDispatchTable, RemovesNanoapp) {
+  FakeDispatchTable table;
+  FakeNanoapp app1(1), app2(2);
+  EXPECT_TRUE(table.registerEvent(&app1, kEventType, kGroup1));
+  EXPECT_TRUE(table.registerEvent(&app2, kEventType, kGroup1));
+  EXPECT_TRUE(table.registerEvent(&app1, kOtherEventType, kGroup1));
+
+  table.removeNanoapp(&app1);
+  EXPECT_EQ(table.size(), 1);
+  EXPECT_EQ(table.findNextHandler(kEventType, kGroup1, 0), &app2);
+  EXPECT_EQ(table.findNextHandler(kOtherEventType, kGroup1, 0), nullptr);
+}
+
+TEST(EventDispatchTable, RejectsRegistrationsWhenFull) {
+  FakeDispatchTable table;
+  FakeNanoapp app(1);
+  for (uint16_t i = 0; i < 4; i++) {
+    EXPECT_TRUE(table.registerEvent(&app, kEventType + i, kGroup1));
+  }
+  EXPECT_FALSE(table.registerEvent(&app, kEventType + 4, kGroup1));
+
+  // Adding groups to an existing registration doesn't need space
+  EXPECT_TRUE(table.registerEvent(&app, kEventType, kGroup2));
+}
+
+TEST(EventDispatchTable, HandlesLargestEventTypeAndInstanceId) {
+  FakeDispatchTable table;
+  FakeNanoapp app(UINT16_MAX);
+  EXPECT_TRUE(table.registerEvent(&app, UINT16_MAX, kGroup1));
+  EXPECT_EQ(table.findNextHandler(UINT16_MAX, kGroup1, 0), &app);
+  EXPECT_EQ(table.findNextHandler(UINT16_MAX, kGroup1, UINT16_MAX + 1u),
+            nullptr);
+  EXPECT_EQ(countHandlers(table, UINT16_MAX, kGroup1), 1);
+}
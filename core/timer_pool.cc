@@ -21,6 +21,7 @@
 #include "chre/core/event_loop_manager.h"
 #include "chre/platform/fatal_error.h"
 #include "chre/platform/system_time.h"
+#include "chre/platform/tracing.h"
 #include "chre/target_platform/log.h"
 #include "chre/util/lock_guard.h"
 #include "chre/util/nested_data_ptr.h"
@@ -260,6 +261,8 @@ bool TimerPool::handleExpiredTimersAndScheduleNextLocked() {
     TimerRequest &currentTimerRequest = mTimerRequests.top();
     if (currentTime >= currentTimerRequest.expirationTime) {
       handledExpiredTimer = true;
+      CHRE_TRACE_INSTANT("Timer expired", "timer_pool",
+                         currentTimerRequest.timerHandle);
 
       // This timer has expired, so post an event if it is a nanoapp timer, or
       // submit a deferred callback if it's a system timer.
@@ -324,6 +327,7 @@ bool TimerPool::hasNanoappTimers(uint16_t instanceId) {
 }
 
 void TimerPool::handleSystemTimerCallback(void *timerPoolPtr) {
+  CHRE_TRACE_INSTANT("System timer fired", "timer_pool");
   auto callback = [](uint16_t /* type */, void *data, void * /* extraData */) {
     auto *timerPool = static_cast<TimerPool *>(data);
     if (!timerPool->handleExpiredTimersAndScheduleNext()) {
@@ -36,11 +36,18 @@ bool WwanRequestManager::requestCellInfo(Nanoapp *nanoapp, const void *cookie) {
 
   bool success = false;
   if (!mCellInfoRequestingNanoappInstanceId.has_value()) {
-    success = mPlatformWwan.requestCellInfo();
+    // The nanoapp is registered first so that the request isn't made if it
+    // couldn't receive the result
+    success =
+        nanoapp->registerForBroadcastEvent(CHRE_EVENT_WWAN_CELL_INFO_RESULT);
     if (success) {
-      nanoapp->registerForBroadcastEvent(CHRE_EVENT_WWAN_CELL_INFO_RESULT);
-      mCellInfoRequestingNanoappInstanceId = nanoapp->getInstanceId();
-      mCellInfoRequestingNanoappCookie = cookie;
+      success = mPlatformWwan.requestCellInfo();
+      if (success) {
+        mCellInfoRequestingNanoappInstanceId = nanoapp->getInstanceId();
+        mCellInfoRequestingNanoappCookie = cookie;
+      } else {
+        nanoapp->unregisterForBroadcastEvent(CHRE_EVENT_WWAN_CELL_INFO_RESULT);
+      }
     }
   } else {
     LOGE("Cell info request made while a request is in flight");
@@ -16,11 +16,16 @@
 
 #include "chre_host/bt_snoop_log_parser.h"
 
+#include <arpa/inet.h>
 #include <endian.h>
+#include <fcntl.h>
 #include <string.h>
 #include <unistd.h>
-#include <fstream>
+#include <bitset>
+#include <cerrno>
+#include <cstdio>
 #include <optional>
+#include <utility>
 
 #include "chre/util/time.h"
 #include "chre_host/daemon_base.h"
@@ -39,9 +44,7 @@ namespace {
 // functionalities.
 using HciPacket = std::vector<uint8_t>;
 
-constexpr char kSnoopLogFilePath[] = "/data/vendor/chre/chre_btsnoop_hci.log";
-constexpr char kLastSnoopLogFilePath[] =
-    "/data/vendor/chre/chre_btsnoop_hci.log.last";
+constexpr char kLastSnoopLogFileSuffix[] = ".last";
 
 constexpr size_t kDefaultBtSnoopMaxPacketsPerFile = 0xffff;
 
@@ -63,6 +66,10 @@ constexpr uint64_t kBtSnoopEpochDelta = 0x00dcddb30f2f8000ULL;
 // field.
 constexpr size_t kBtSnoopLogOffset = 2;
 
+constexpr size_t kWriteBufferSize = CHRE_HOST_BT_SNOOP_WRITE_BUFFER_SIZE;
+constexpr size_t kMaxPendingBuffers = CHRE_HOST_BT_SNOOP_MAX_PENDING_BUFFERS;
+constexpr size_t kPreallocationSize = CHRE_HOST_BT_SNOOP_PREALLOCATION_SIZE;
+
 struct FileHeaderType {
   uint8_t identification_pattern[8];
   uint32_t version_number;
@@ -85,6 +92,21 @@ uint64_t htonll(uint64_t ll) {
 
 }  // namespace
 
+BtSnoopLogParser::BtSnoopLogParser(std::string snoopLogFilePath)
+    : mSnoopLogFilePath(std::move(snoopLogFilePath)),
+      mLastSnoopLogFilePath(mSnoopLogFilePath + kLastSnoopLogFileSuffix) {}
+
+BtSnoopLogParser::~BtSnoopLogParser() {
+  {
+    std::lock_guard<std::mutex> lock(mWriterMutex);
+    mStopWriter = true;
+  }
+  mWriterCondVar.notify_one();
+  if (mWriterThread.joinable()) {
+    mWriterThread.join();
+  }
+}
+
 std::optional<size_t> BtSnoopLogParser::log(const char *buffer,
                                             size_t maxLogMessageLen) {
   const auto *message = reinterpret_cast<const BtSnoopLog *>(buffer);
@@ -101,6 +123,19 @@ std::optional<size_t> BtSnoopLogParser::log(const char *buffer,
   return logMessageSize;
 }
 
+void BtSnoopLogParser::flush() {
+  std::unique_lock<std::mutex> lock(mWriterMutex);
+  if (!mWriterThread.joinable()) {
+    return;
+  }
+  mFlushRequested = true;
+  mWriterCondVar.notify_one();
+  mWrittenCondVar.wait(lock, [this]() {
+    return mCurrentBuffer.data.empty() && mPendingBuffers.empty() &&
+           !mWriting;
+  });
+}
+
 void BtSnoopLogParser::capture(const uint8_t *packet, size_t packetSize,
                                BtSnoopDirection direction) {
   uint64_t timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
@@ -134,27 +169,151 @@ void BtSnoopLogParser::capture(const uint8_t *packet, size_t packetSize,
     header.length_captured = htonl(length);
   }
 
+  bool startsNewFile = false;
   mPacketCounter++;
   if (mPacketCounter > kDefaultBtSnoopMaxPacketsPerFile) {
-    openNextSnoopLogFile();
+    mPacketCounter = 0;
+    startsNewFile = true;
     LOGW("Snoop Log file reached maximum size");
   }
-  if (ensureSnoopLogFileIsOpen()) {
-    if (!mBtSnoopOstream.write(reinterpret_cast<const char *>(&header),
-                               sizeof(PacketHeaderType))) {
-      LOGE("Failed to write packet header for btsnoop, error: \"%s\"",
-           strerror(errno));
+
+  size_t recordSize = sizeof(PacketHeaderType) + packetSize;
+  {
+    std::unique_lock<std::mutex> lock(mWriterMutex);
+    if (startsNewFile ||
+        mCurrentBuffer.data.size() + recordSize > kWriteBufferSize) {
+      // Parsing is held up rather than dropping records if the file writes
+      // fall behind by kMaxPendingBuffers
+      mWrittenCondVar.wait(lock, [this]() {
+        return mPendingBuffers.size() < kMaxPendingBuffers;
+      });
+      queueCurrentBufferLocked();
+      mCurrentBuffer.startsNewFile |= startsNewFile;
+    }
+    // An idle writer thread waits without a timeout for the first record
+    if (mCurrentBuffer.data.empty()) {
+      mWriterCondVar.notify_one();
     }
-    if (!mBtSnoopOstream.write(reinterpret_cast<const char *>(packet),
-                               length - 1)) {
-      LOGE("Failed to write packet payload for btsnoop, error: \"%s\"",
-           strerror(errno));
+    const auto *headerBytes = reinterpret_cast<const uint8_t *>(&header);
+    mCurrentBuffer.data.insert(mCurrentBuffer.data.end(), headerBytes,
+                               headerBytes + sizeof(PacketHeaderType));
+    mCurrentBuffer.data.insert(mCurrentBuffer.data.end(), packet,
+                               packet + packetSize);
+    mCurrentBuffer.numPackets++;
+
+    if (!mWriterThread.joinable()) {
+      mWriterThread = std::thread(&BtSnoopLogParser::writerThreadMain, this);
     }
   }
 }
 
+void BtSnoopLogParser::queueCurrentBufferLocked() {
+  if (mCurrentBuffer.data.empty()) {
+    return;
+  }
+
+  std::vector<uint8_t> nextData;
+  if (!mFreeBuffers.empty()) {
+    nextData = std::move(mFreeBuffers.back());
+    mFreeBuffers.pop_back();
+  } else {
+    nextData.reserve(kWriteBufferSize);
+  }
+
+  mPendingBuffers.push_back(std::move(mCurrentBuffer));
+  mCurrentBuffer = WriteBuffer{.data = std::move(nextData)};
+  mWriterCondVar.notify_one();
+}
+
+void BtSnoopLogParser::writerThreadMain() {
+  std::unique_lock<std::mutex> lock(mWriterMutex);
+  auto hasWork = [this]() {
+    return !mPendingBuffers.empty() || mStopWriter || mFlushRequested;
+  };
+  while (true) {
+    if (!hasWork() && mCurrentBuffer.data.empty() && !mSyncPending) {
+      // Nothing is waiting to be written or synced until a record is captured
+      mWriterCondVar.wait(lock, [&]() {
+        return hasWork() || !mCurrentBuffer.data.empty();
+      });
+    }
+    if (!hasWork()) {
+      mWriterCondVar.wait_for(lock, kWriteInterval, hasWork);
+    }
+    // Records in a partially filled buffer are written once nothing else is
+    // pending, at least every kWriteInterval
+    if (mPendingBuffers.empty()) {
+      queueCurrentBufferLocked();
+    }
+
+    if (mPendingBuffers.empty()) {
+      mFlushRequested = false;
+      mWrittenCondVar.notify_all();
+      if (mStopWriter) {
+        break;
+      }
+      lock.unlock();
+      syncSnoopLogFile(/* force= */ false);
+      lock.lock();
+      continue;
+    }
+
+    WriteBuffer buffer = std::move(mPendingBuffers.front());
+    mPendingBuffers.pop_front();
+    mWriting = true;
+    mWrittenCondVar.notify_all();
+    lock.unlock();
+    writeBuffer(buffer);
+    syncSnoopLogFile(/* force= */ false);
+    lock.lock();
+    mWriting = false;
+    buffer.data.clear();
+    mFreeBuffers.push_back(std::move(buffer.data));
+  }
+  lock.unlock();
+
+  closeSnoopLogFile();
+}
+
+void BtSnoopLogParser::writeBuffer(const WriteBuffer &buffer) {
+  if (buffer.startsNewFile) {
+    openNextSnoopLogFile();
+  }
+  if (ensureSnoopLogFileIsOpen() &&
+      !writeToFile(buffer.data.data(), buffer.data.size())) {
+    LOGE("Failed to write %zu packets for btsnoop, error: \"%s\"",
+         buffer.numPackets, strerror(errno));
+  }
+}
+
+bool BtSnoopLogParser::writeToFile(const uint8_t *data, size_t size) {
+  // Storage is reserved ahead of the writes so that the file isn't extended a
+  // few blocks at a time. The file size itself only grows with the writes.
+  if (mPreallocationSupported && mFileSize + size > mPreallocatedSize) {
+    size_t preallocatedSize = mFileSize + size + kPreallocationSize;
+    if (fallocate(mFd, FALLOC_FL_KEEP_SIZE, 0,
+                  static_cast<off_t>(preallocatedSize)) == 0) {
+      mPreallocatedSize = preallocatedSize;
+    } else if (errno == EOPNOTSUPP) {
+      mPreallocationSupported = false;
+    }
+  }
+
+  while (size > 0) {
+    ssize_t written = TEMP_FAILURE_RETRY(write(mFd, data, size));
+    if (written < 0) {
+      return false;
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+    mFileSize += static_cast<size_t>(written);
+    mSyncPending = true;
+  }
+  return true;
+}
+
 bool BtSnoopLogParser::ensureSnoopLogFileIsOpen() {
-  if (mBtSnoopOstream.is_open()) {
+  if (mFd >= 0) {
     return true;
   }
   return openNextSnoopLogFile();
@@ -162,32 +321,51 @@ bool BtSnoopLogParser::ensureSnoopLogFileIsOpen() {
 
 bool BtSnoopLogParser::openNextSnoopLogFile() {
   closeSnoopLogFile();
-  if (access(kSnoopLogFilePath, F_OK) == 0 &&
-      std::rename(kSnoopLogFilePath, kLastSnoopLogFilePath) != 0) {
+  if (access(mSnoopLogFilePath.c_str(), F_OK) == 0 &&
+      std::rename(mSnoopLogFilePath.c_str(), mLastSnoopLogFilePath.c_str()) !=
+          0) {
     LOGE("Unable to rename existing snoop log, error: \"%s\"", strerror(errno));
   }
 
   bool success = false;
-  mBtSnoopOstream.open(kSnoopLogFilePath, std::ios::binary | std::ios::out);
-  mBtSnoopOstream.setf(std::ios::unitbuf);
-  if (mBtSnoopOstream.fail()) {
+  mFd = TEMP_FAILURE_RETRY(open(mSnoopLogFilePath.c_str(),
+                                O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                0666));
+  if (mFd < 0) {
     LOGE("Fail to create snoop log file, error: \"%s\"", strerror(errno));
-  } else if (!mBtSnoopOstream.write(
-                 reinterpret_cast<const char *>(&kBtSnoopFileHeader),
+  } else if (!writeToFile(
+                 reinterpret_cast<const uint8_t *>(&kBtSnoopFileHeader),
                  sizeof(FileHeaderType))) {
     LOGE("Unable to write file header to \"%s\", error: \"%s\"",
-         kSnoopLogFilePath, strerror(errno));
+         mSnoopLogFilePath.c_str(), strerror(errno));
   } else {
+    mLastSyncTime = std::chrono::steady_clock::now();
     success = true;
   }
   return success;
 }
 
 void BtSnoopLogParser::closeSnoopLogFile() {
-  if (mBtSnoopOstream.is_open()) {
-    mBtSnoopOstream.close();
+  if (mFd >= 0) {
+    syncSnoopLogFile(/* force= */ true);
+    close(mFd);
+    mFd = -1;
+  }
+  mFileSize = 0;
+  mPreallocatedSize = 0;
+}
+
+void BtSnoopLogParser::syncSnoopLogFile(bool force) {
+  auto now = std::chrono::steady_clock::now();
+  if (mFd < 0 || !mSyncPending ||
+      (!force && now - mLastSyncTime < kSyncInterval)) {
+    return;
+  }
+  if (fdatasync(mFd) != 0) {
+    LOGE("Failed to sync the snoop log file, error: \"%s\"", strerror(errno));
   }
-  mPacketCounter = 0;
+  mSyncPending = false;
+  mLastSyncTime = now;
 }
 
 }  // namespace chre
@@ -38,11 +38,12 @@ namespace android {
 namespace chre {
 
 #ifdef CHRE_DAEMON_METRIC_ENABLED
-using ::aidl::android::frameworks::stats::IStats;
 using ::aidl::android::frameworks::stats::VendorAtom;
 using ::aidl::android::frameworks::stats::VendorAtomValue;
 
 using ::android::chre::Atoms::CHRE_EVENT_QUEUE_SNAPSHOT_REPORTED;
+using ::android::chre::Atoms::CHRE_NANOAPP_EVENT_BUDGET_EXCEEDED;
+using ::android::chre::Atoms::CHRE_NANOAPP_START_REPORTED;
 using ::android::chre::Atoms::CHRE_PAL_OPEN_FAILED;
 using ::android::chre::Atoms::ChrePalOpenFailed;
 #endif  // CHRE_DAEMON_METRIC_ENABLED
@@ -187,6 +188,29 @@ void ChreDaemonBase::handleMetricLog(const ::chre::fbs::MetricLogT *metricMsg) {
       }
       break;
     }
+    case CHRE_NANOAPP_START_REPORTED: {
+      metrics::ChreNanoappStartReported metric;
+      if (!metric.ParseFromArray(encodedMetric.data(), encodedMetric.size())) {
+        LOGE("Failed to parse metric data");
+      } else if (!mMetricsReporter.logNanoappStartReported(
+                     metric.nanoapp_id(), metric.load_time_us(),
+                     metric.relocation_time_us(), metric.init_array_time_us(),
+                     metric.start_time_us(), metric.total_time_us())) {
+        LOGE("Could not log the nanoapp start metric");
+      }
+      break;
+    }
+    case CHRE_NANOAPP_EVENT_BUDGET_EXCEEDED: {
+      metrics::ChreNanoappEventBudgetExceeded metric;
+      if (!metric.ParseFromArray(encodedMetric.data(), encodedMetric.size())) {
+        LOGE("Failed to parse metric data");
+      } else if (!mMetricsReporter.logNanoappEventBudgetExceeded(
+                     metric.nanoapp_id(), metric.event_type(),
+                     metric.elapsed_time_ms(), metric.budget_ms())) {
+        LOGE("Could not log the nanoapp event budget exceeded metric");
+      }
+      break;
+    }
     default: {
 #ifdef CHRE_LOG_ATOM_EXTENSION_ENABLED
       handleVendorMetricLog(metricMsg);
@@ -198,22 +222,8 @@ void ChreDaemonBase::handleMetricLog(const ::chre::fbs::MetricLogT *metricMsg) {
 }
 
 void ChreDaemonBase::reportMetric(const VendorAtom &atom) {
-  const std::string statsServiceName =
-      std::string(IStats::descriptor).append("/default");
-  if (!AServiceManager_isDeclared(statsServiceName.c_str())) {
-    LOGE("Stats service is not declared.");
-    return;
-  }
-
-  std::shared_ptr<IStats> stats_client = IStats::fromBinder(ndk::SpAIBinder(
-      AServiceManager_waitForService(statsServiceName.c_str())));
-  if (stats_client == nullptr) {
-    LOGE("Failed to get IStats service");
-    return;
-  }
-
-  const ndk::ScopedAStatus ret = stats_client->reportVendorAtom(atom);
-  if (!ret.isOk()) {
+  // Shares the connection to the stats service with the common metrics
+  if (!mMetricsReporter.reportMetric(atom)) {
     LOGE("Failed to report vendor atom");
   }
 }
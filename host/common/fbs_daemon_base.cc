@@ -113,22 +113,27 @@ void FbsDaemonBase::onMessageReceived(const unsigned char *messageBuffer,
     hostClientId = ::chre::kHostClientIdUnspecified;
   }
 
-  std::unique_ptr<fbs::MessageContainerT> container =
-      fbs::UnPackMessageContainer(messageBuffer);
+  // Tables are read in place, as most messages are either logs or forwarded to
+  // clients as-is and don't need to be unpacked via the object API
+  const fbs::MessageContainer *container =
+      fbs::GetMessageContainer(messageBuffer);
 
   if (messageType == fbs::ChreMessage::LogMessage) {
-    const auto *logMessage = container->message.AsLogMessage();
-    const std::vector<int8_t> &logData = logMessage->buffer;
-
-    getLogger().log(reinterpret_cast<const uint8_t *>(logData.data()),
-                    logData.size());
+    const flatbuffers::Vector<int8_t> *logData =
+        container->message_as_LogMessage()->buffer();
+    if (logData != nullptr) {
+      getLogger().log(reinterpret_cast<const uint8_t *>(logData->data()),
+                      logData->size());
+    }
   } else if (messageType == fbs::ChreMessage::LogMessageV2) {
-    const auto *logMessage = container->message.AsLogMessageV2();
-    const std::vector<int8_t> &logDataBuffer = logMessage->buffer;
-    const auto *logData =
-        reinterpret_cast<const uint8_t *>(logDataBuffer.data());
-    uint32_t numLogsDropped = logMessage->num_logs_dropped;
-    getLogger().logV2(logData, logDataBuffer.size(), numLogsDropped);
+    const auto *logMessage = container->message_as_LogMessageV2();
+    const flatbuffers::Vector<int8_t> *logDataBuffer = logMessage->buffer();
+    if (logDataBuffer != nullptr) {
+      const auto *logData =
+          reinterpret_cast<const uint8_t *>(logDataBuffer->data());
+      uint32_t numLogsDropped = logMessage->num_logs_dropped();
+      getLogger().logV2(logData, logDataBuffer->size(), numLogsDropped);
+    }
   } else if (messageType == fbs::ChreMessage::TimeSyncRequest) {
     sendTimeSync(true /* logOnError */);
   } else if (messageType == fbs::ChreMessage::LowPowerMicAccessRequest) {
@@ -137,15 +142,20 @@ void FbsDaemonBase::onMessageReceived(const unsigned char *messageBuffer,
     configureLpma(false /* enabled */);
   } else if (messageType == fbs::ChreMessage::MetricLog) {
 #ifdef CHRE_DAEMON_METRIC_ENABLED
-    const auto *metricMsg = container->message.AsMetricLog();
-    handleMetricLog(metricMsg);
+    std::unique_ptr<fbs::MetricLogT> metricMsg(
+        container->message_as_MetricLog()->UnPack());
+    handleMetricLog(metricMsg.get());
 #endif  // CHRE_DAEMON_METRIC_ENABLED
   } else if (messageType == fbs::ChreMessage::NanConfigurationRequest) {
-    handleNanConfigurationRequest(
-        container->message.AsNanConfigurationRequest());
+    std::unique_ptr<fbs::NanConfigurationRequestT> request(
+        container->message_as_NanConfigurationRequest()->UnPack());
+    handleNanConfigurationRequest(request.get());
   } else if (messageType == fbs::ChreMessage::NanoappTokenDatabaseInfo) {
     // TODO(b/242760291): Use this info to map nanoapp log detokenizers with
     // instance ID in log message parser.
+  } else if (messageType == fbs::ChreMessage::NanoappMessageBatch) {
+    handleNanoappMessageBatch(*container->message_as_NanoappMessageBatch(),
+                              hostClientId);
   } else if (hostClientId == kHostClientIdDaemon) {
     handleDaemonMessage(messageBuffer);
   } else if (hostClientId == ::chre::kHostClientIdUnspecified) {
@@ -156,23 +166,51 @@ void FbsDaemonBase::onMessageReceived(const unsigned char *messageBuffer,
   }
 }
 
+void FbsDaemonBase::handleNanoappMessageBatch(
+    const fbs::NanoappMessageBatch &batch, uint16_t hostClientId) {
+  if (batch.messages() == nullptr) {
+    return;
+  }
+
+  // Clients expect a single NanoappMessage per frame, so re-encode each message
+  // in the batch individually, preserving the order CHRE sent them in
+  for (const fbs::NanoappMessage *message : *batch.messages()) {
+    const flatbuffers::Vector<uint8_t> *messageData = message->message();
+    size_t messageSize = (messageData == nullptr) ? 0 : messageData->size();
+    flatbuffers::FlatBufferBuilder builder(
+        messageSize + HostProtocolHost::kNanoappMessageEncodingOverhead);
+    HostProtocolHost::encodeNanoappMessage(
+        builder, message->app_id(), message->message_type(),
+        message->host_endpoint(),
+        (messageData == nullptr) ? nullptr : messageData->data(), messageSize,
+        message->permissions(), message->message_permissions(),
+        message->woke_host());
+
+    if (hostClientId == ::chre::kHostClientIdUnspecified) {
+      mServer.sendToAllClients(builder.GetBufferPointer(), builder.GetSize());
+    } else {
+      mServer.sendToClientById(builder.GetBufferPointer(), builder.GetSize(),
+                               hostClientId);
+    }
+  }
+}
+
 void FbsDaemonBase::handleDaemonMessage(const uint8_t *message) {
-  std::unique_ptr<fbs::MessageContainerT> container =
-      fbs::UnPackMessageContainer(message);
-  if (container->message.type != fbs::ChreMessage::LoadNanoappResponse) {
+  const fbs::MessageContainer *container = fbs::GetMessageContainer(message);
+  if (container->message_type() != fbs::ChreMessage::LoadNanoappResponse) {
     LOGE("Invalid message from CHRE directed to daemon");
   } else {
-    const auto *response = container->message.AsLoadNanoappResponse();
+    const auto *response = container->message_as_LoadNanoappResponse();
     if (mPreloadedNanoappPendingTransactions.empty()) {
       LOGE("Received nanoapp load response with no pending load");
     } else if (mPreloadedNanoappPendingTransactions.front().transactionId !=
-               response->transaction_id) {
+               response->transaction_id()) {
       LOGE("Received nanoapp load response with ID %" PRIu32
            " expected transaction id %" PRIu32,
-           response->transaction_id,
+           response->transaction_id(),
            mPreloadedNanoappPendingTransactions.front().transactionId);
     } else {
-      if (!response->success) {
+      if (!response->success()) {
         LOGE("Received unsuccessful nanoapp load response with ID %" PRIu32,
              mPreloadedNanoappPendingTransactions.front().transactionId);
 
@@ -16,6 +16,11 @@
 
 #include "chre_host/file_stream.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <fstream>
 #include "chre_host/log.h"
 
@@ -43,5 +48,43 @@ bool readFileContents(const char *filename, std::vector<uint8_t> &buffer) {
   return success;
 }
 
+bool mapFileContents(const char *filename,
+                     std::shared_ptr<const uint8_t> &contents, size_t &size) {
+  int fd = open(filename, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOGE("Couldn't open file '%s': %d (%s)", filename, errno, strerror(errno));
+    return false;
+  }
+
+  bool success = false;
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0) {
+    LOGE("Couldn't stat file '%s': %d (%s)", filename, errno, strerror(errno));
+  } else if (fileStat.st_size == 0) {
+    contents.reset();
+    size = 0;
+    success = true;
+  } else {
+    size_t fileSize = static_cast<size_t>(fileStat.st_size);
+    void *address = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+      LOGE("Couldn't map file '%s': %d (%s)", filename, errno,
+           strerror(errno));
+    } else {
+      contents = std::shared_ptr<const uint8_t>(
+          static_cast<const uint8_t *>(address),
+          [fileSize](const uint8_t *data) {
+            munmap(const_cast<uint8_t *>(data), fileSize);
+          });
+      size = fileSize;
+      success = true;
+    }
+  }
+
+  // The mapping stays valid after the file is closed
+  close(fd);
+  return success;
+}
+
 }  // namespace chre
 }  // namespace android
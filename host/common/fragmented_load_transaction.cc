@@ -21,64 +21,72 @@
 namespace android {
 namespace chre {
 
-namespace {
-
-/**
- * Returns a vector containing a specific subarray of the original vector.
- *
- * If the ending index of the subarray exceeds that of the source vector,
- * the size will be truncated to the last element of the source vector.
- *
- * @param source the source vector
- * @param start the starting index of the subarray
- * @param size the size of the subarray
- *
- * @return the vector containing the subarray
- */
-inline std::vector<uint8_t> getSubVector(const std::vector<uint8_t> &source,
-                                         size_t start, size_t size) {
-  size_t end = std::min(source.size(), start + size);
-  return (source.size() == 0)
-             ? std::vector<uint8_t>()
-             : std::vector<uint8_t>(source.begin() + start,
-                                    source.begin() + end);  // [start, end)
-}
-
-}  // anonymous namespace
+FragmentedLoadTransaction::FragmentedLoadTransaction(
+    uint32_t transactionId, uint64_t appId, uint32_t appVersion,
+    uint32_t appFlags, uint32_t targetApiVersion,
+    const std::vector<uint8_t> &appBinary, size_t fragmentSize)
+    : FragmentedLoadTransaction(
+          transactionId, appId, appVersion, appFlags, targetApiVersion,
+          std::make_shared<const std::vector<uint8_t>>(appBinary),
+          fragmentSize) {}
 
 FragmentedLoadTransaction::FragmentedLoadTransaction(
     uint32_t transactionId, uint64_t appId, uint32_t appVersion,
     uint32_t appFlags, uint32_t targetApiVersion,
-    const std::vector<uint8_t> &appBinary, size_t fragmentSize) {
-  // Start with fragmentId at 1 since 0 is used to indicate
-  // legacy behavior at CHRE
-  size_t fragmentId = 1;
-  size_t byteIndex = 0;
-  do {
-    // It is guaranteed that mFragmentRequests must have at least one element,
-    // which is the precondition of the getters retrieving the info from the
-    // first fragmented request.
-    if (fragmentId == 1) {
-      mFragmentRequests.emplace_back(
-          fragmentId++, transactionId, appId, appVersion, appFlags,
-          targetApiVersion, appBinary.size(),
-          getSubVector(appBinary, byteIndex, fragmentSize));
-    } else {
-      mFragmentRequests.emplace_back(
-          fragmentId++, transactionId, appId,
-          getSubVector(appBinary, byteIndex, fragmentSize));
-    }
+    std::shared_ptr<const std::vector<uint8_t>> appBinary, size_t fragmentSize)
+    : FragmentedLoadTransaction(
+          transactionId, appId, appVersion, appFlags, targetApiVersion,
+          // Aliases the vector's data while keeping the vector alive
+          std::shared_ptr<const uint8_t>(appBinary, appBinary->data()),
+          appBinary->size(), fragmentSize) {}
 
-    byteIndex += fragmentSize;
-  } while (byteIndex < appBinary.size());
+FragmentedLoadTransaction::FragmentedLoadTransaction(
+    uint32_t transactionId, uint64_t appId, uint32_t appVersion,
+    uint32_t appFlags, uint32_t targetApiVersion,
+    std::shared_ptr<const uint8_t> appBinary, size_t appBinarySize,
+    size_t fragmentSize)
+    : mTransactionId(transactionId),
+      mAppId(appId),
+      mAppVersion(appVersion),
+      mAppFlags(appFlags),
+      mTargetApiVersion(targetApiVersion),
+      mBinary(std::move(appBinary)),
+      mBinarySize(appBinarySize),
+      mFragmentSize(fragmentSize == 0 ? appBinarySize : fragmentSize) {
+  // There is always at least one fragment, even for an empty binary
+  mNumFragments =
+      (mFragmentSize == 0)
+          ? 1
+          : std::max<size_t>(1, (mBinarySize + mFragmentSize - 1) /
+                                    mFragmentSize);
 }
 
 const FragmentedLoadRequest &FragmentedLoadTransaction::getNextRequest() {
-  return mFragmentRequests.at(mCurrentRequestIndex++);
+  size_t offset = mCurrentRequestIndex * mFragmentSize;
+  NanoappBinaryFragment fragment(
+      mBinary, offset, std::min(mFragmentSize, mBinarySize - offset));
+
+  // Start with fragmentId at 1 since 0 is used to indicate legacy behavior at
+  // CHRE. Only the first fragment carries the nanoapp's metadata.
+  size_t fragmentId = ++mCurrentRequestIndex;
+  if (fragmentId == 1) {
+    mCurrentRequest.emplace(fragmentId, mTransactionId, mAppId, mAppVersion,
+                            mAppFlags, mTargetApiVersion, mBinarySize,
+                            std::move(fragment));
+    mCurrentRequest->appBinaryHash = mAppBinaryHash;
+  } else {
+    mCurrentRequest.emplace(fragmentId, mTransactionId, mAppId,
+                            std::move(fragment));
+  }
+  return *mCurrentRequest;
 }
 
 bool FragmentedLoadTransaction::isComplete() const {
-  return (mCurrentRequestIndex >= mFragmentRequests.size());
+  return (mCurrentRequestIndex >= mNumFragments);
+}
+
+void FragmentedLoadTransaction::rewindTo(size_t fragmentId) {
+  mCurrentRequestIndex = std::min(fragmentId - 1, mNumFragments - 1);
 }
 
 }  // namespace chre
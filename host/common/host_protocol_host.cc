@@ -45,51 +45,85 @@ const char *getStringFromByteVector(const std::vector<int8_t> &vec) {
   return str;
 }
 
+namespace {
+
+//! Unpacks a single table of a message via the object API.
+template <typename TableType>
+std::unique_ptr<typename TableType::NativeTableType> unpack(
+    const TableType *table) {
+  return std::unique_ptr<typename TableType::NativeTableType>(table->UnPack());
+}
+
+}  // namespace
+
 bool HostProtocolHost::decodeMessageFromChre(const void *message,
                                              size_t messageLen,
                                              IChreMessageHandlers &handlers) {
   bool success = verifyMessage(message, messageLen);
   if (success) {
-    std::unique_ptr<fbs::MessageContainerT> container =
-        fbs::UnPackMessageContainer(message);
-    fbs::ChreMessageUnion &msg = container->message;
+    // Nanoapp messages are read in place, all other messages are unpacked
+    // individually via the object API
+    const fbs::MessageContainer *container = fbs::GetMessageContainer(message);
 
-    switch (container->message.type) {
+    switch (container->message_type()) {
       case fbs::ChreMessage::NanoappMessage:
-        handlers.handleNanoappMessage(*msg.AsNanoappMessage());
+        handlers.handleNanoappMessageInPlace(
+            *container->message_as_NanoappMessage());
+        break;
+
+      case fbs::ChreMessage::NanoappMessageBatch: {
+        const auto *messages =
+            container->message_as_NanoappMessageBatch()->messages();
+        if (messages != nullptr) {
+          for (const fbs::NanoappMessage *nanoappMessage : *messages) {
+            handlers.handleNanoappMessageInPlace(*nanoappMessage);
+          }
+        }
         break;
+      }
 
       case fbs::ChreMessage::HubInfoResponse:
-        handlers.handleHubInfoResponse(*msg.AsHubInfoResponse());
+        handlers.handleHubInfoResponse(
+            *unpack(container->message_as_HubInfoResponse()));
         break;
 
       case fbs::ChreMessage::NanoappListResponse:
-        handlers.handleNanoappListResponse(*msg.AsNanoappListResponse());
+        handlers.handleNanoappListResponse(
+            *unpack(container->message_as_NanoappListResponse()));
         break;
 
       case fbs::ChreMessage::LoadNanoappResponse:
-        handlers.handleLoadNanoappResponse(*msg.AsLoadNanoappResponse());
+        handlers.handleLoadNanoappResponse(
+            *unpack(container->message_as_LoadNanoappResponse()));
         break;
 
       case fbs::ChreMessage::UnloadNanoappResponse:
-        handlers.handleUnloadNanoappResponse(*msg.AsUnloadNanoappResponse());
+        handlers.handleUnloadNanoappResponse(
+            *unpack(container->message_as_UnloadNanoappResponse()));
         break;
 
       case fbs::ChreMessage::DebugDumpData:
-        handlers.handleDebugDumpData(*msg.AsDebugDumpData());
+        handlers.handleDebugDumpData(
+            *unpack(container->message_as_DebugDumpData()));
         break;
 
       case fbs::ChreMessage::DebugDumpResponse:
-        handlers.handleDebugDumpResponse(*msg.AsDebugDumpResponse());
+        handlers.handleDebugDumpResponse(
+            *unpack(container->message_as_DebugDumpResponse()));
         break;
 
       case fbs::ChreMessage::SelfTestResponse:
-        handlers.handleSelfTestResponse(*msg.AsSelfTestResponse());
+        handlers.handleSelfTestResponse(
+            *unpack(container->message_as_SelfTestResponse()));
+        break;
+
+      case fbs::ChreMessage::TraceData:
+        handlers.handleTraceData(*unpack(container->message_as_TraceData()));
         break;
 
       default:
         LOGW("Got invalid/unexpected message type %" PRIu8,
-             static_cast<uint8_t>(msg.type));
+             static_cast<uint8_t>(container->message_type()));
         success = false;
     }
   }
@@ -113,11 +147,13 @@ void HostProtocolHost::encodeDebugConfiguration(FlatBufferBuilder &builder) {
 
 void HostProtocolHost::encodeFragmentedLoadNanoappRequest(
     flatbuffers::FlatBufferBuilder &builder,
-    const FragmentedLoadRequest &request, bool respondBeforeStart) {
+    const FragmentedLoadRequest &request, bool respondBeforeStart,
+    uint32_t fragmentWindowSize) {
   encodeLoadNanoappRequestForBinary(
       builder, request.transactionId, request.appId, request.appVersion,
-      request.appFlags, request.targetApiVersion, request.binary,
-      request.fragmentId, request.appTotalSizeBytes, respondBeforeStart);
+      request.appFlags, request.targetApiVersion, request.binary.data(),
+      request.binary.size(), request.fragmentId, request.appTotalSizeBytes,
+      respondBeforeStart, fragmentWindowSize, request.appBinaryHash);
 }
 
 void HostProtocolHost::encodeNanoappListRequest(FlatBufferBuilder &builder) {
@@ -144,6 +180,11 @@ void HostProtocolHost::encodeDebugDumpRequest(FlatBufferBuilder &builder) {
   finalize(builder, fbs::ChreMessage::DebugDumpRequest, request.Union());
 }
 
+void HostProtocolHost::encodeTraceDataRequest(FlatBufferBuilder &builder) {
+  auto request = fbs::CreateTraceDataRequest(builder);
+  finalize(builder, fbs::ChreMessage::TraceDataRequest, request.Union());
+}
+
 bool HostProtocolHost::extractHostClientIdAndType(
     const void *message, size_t messageLen, uint16_t *hostClientId,
     ::chre::fbs::ChreMessage *messageType) {
@@ -184,13 +225,14 @@ bool HostProtocolHost::mutateHostClientId(void *message, size_t messageLen,
 void HostProtocolHost::encodeLoadNanoappRequestForBinary(
     FlatBufferBuilder &builder, uint32_t transactionId, uint64_t appId,
     uint32_t appVersion, uint32_t appFlags, uint32_t targetApiVersion,
-    const std::vector<uint8_t> &nanoappBinary, uint32_t fragmentId,
-    size_t appTotalSizeBytes, bool respondBeforeStart) {
-  auto appBinary = builder.CreateVector(nanoappBinary);
+    const uint8_t *nanoappBinary, size_t nanoappBinarySize,
+    uint32_t fragmentId, size_t appTotalSizeBytes, bool respondBeforeStart,
+    uint32_t fragmentWindowSize, uint64_t appBinaryHash) {
+  auto appBinary = builder.CreateVector(nanoappBinary, nanoappBinarySize);
   auto request = fbs::CreateLoadNanoappRequest(
       builder, transactionId, appId, appVersion, targetApiVersion, appBinary,
       fragmentId, appTotalSizeBytes, 0 /* app_binary_file_name */, appFlags,
-      respondBeforeStart);
+      respondBeforeStart, fragmentWindowSize, appBinaryHash);
   finalize(builder, fbs::ChreMessage::LoadNanoappRequest, request.Union());
 }
 
@@ -17,18 +17,76 @@
 #ifndef CHRE_BT_SNOOP_LOG_PARSER_H_
 #define CHRE_BT_SNOOP_LOG_PARSER_H_
 
+#include <chrono>
 #include <cinttypes>
-#include <fstream>
-#include <memory>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "chre/platform/shared/bt_snoop_log.h"
 
+#ifndef CHRE_HOST_BT_SNOOP_WRITE_BUFFER_SIZE
+//! Size of the buffers snoop records are batched in before being handed to the
+//! writer thread.
+#define CHRE_HOST_BT_SNOOP_WRITE_BUFFER_SIZE (64 * 1024)
+#endif
+
+#ifndef CHRE_HOST_BT_SNOOP_MAX_PENDING_BUFFERS
+//! Max number of full buffers waiting for the writer thread. Adding records
+//! blocks when the writer falls further behind.
+#define CHRE_HOST_BT_SNOOP_MAX_PENDING_BUFFERS 16
+#endif
+
+#ifndef CHRE_HOST_BT_SNOOP_WRITE_INTERVAL_MS
+//! Max time a record waits in a partially filled buffer before being written.
+#define CHRE_HOST_BT_SNOOP_WRITE_INTERVAL_MS 1000
+#endif
+
+#ifndef CHRE_HOST_BT_SNOOP_SYNC_INTERVAL_MS
+//! Min time between syncs of the snoop log file to storage.
+#define CHRE_HOST_BT_SNOOP_SYNC_INTERVAL_MS 5000
+#endif
+
+#ifndef CHRE_HOST_BT_SNOOP_PREALLOCATION_SIZE
+//! Size of the blocks of storage preallocated for the snoop log file ahead of
+//! the writes.
+#define CHRE_HOST_BT_SNOOP_PREALLOCATION_SIZE (1024 * 1024)
+#endif
+
 namespace android {
 namespace chre {
 
+/**
+ * Writes the BT snoop logs received in CHRE logs to a file in the btsnoop
+ * format.
+ *
+ * Records are encoded on the thread calling log() into buffers that are
+ * written to the file by a dedicated thread, started on the first record, so
+ * that log parsing isn't held up by file writes.
+ */
 class BtSnoopLogParser {
  public:
+  static constexpr char kDefaultSnoopLogFilePath[] =
+      "/data/vendor/chre/chre_btsnoop_hci.log";
+
+  /**
+   * @param snoopLogFilePath Path of the snoop log file. The previous file is
+   * renamed with a ".last" suffix when a new one is started.
+   */
+  explicit BtSnoopLogParser(
+      std::string snoopLogFilePath = kDefaultSnoopLogFilePath);
+
+  BtSnoopLogParser(const BtSnoopLogParser &) = delete;
+  BtSnoopLogParser &operator=(const BtSnoopLogParser &) = delete;
+
+  /** Writes out the pending records and stops the writer thread. */
+  ~BtSnoopLogParser();
+
   /**
    * Add a BT event to the snoop log file.
    *
@@ -40,6 +98,9 @@ class BtSnoopLogParser {
    */
   std::optional<size_t> log(const char *buffer, size_t maxLogMessageLen);
 
+  /** Blocks until the records added so far are written to the file. */
+  void flush();
+
  private:
   enum class PacketType : uint8_t {
     CMD = 1,
@@ -66,14 +127,21 @@ class BtSnoopLogParser {
     PacketType type;
   } __attribute__((packed));
 
-  bool ensureSnoopLogFileIsOpen();
-
-  void closeSnoopLogFile();
+  //! Encoded records handed to the writer thread.
+  struct WriteBuffer {
+    std::vector<uint8_t> data;
+    size_t numPackets = 0;
+    //! Whether the records go to a new snoop log file.
+    bool startsNewFile = false;
+  };
 
-  bool openNextSnoopLogFile();
+  static constexpr auto kWriteInterval =
+      std::chrono::milliseconds(CHRE_HOST_BT_SNOOP_WRITE_INTERVAL_MS);
+  static constexpr auto kSyncInterval =
+      std::chrono::milliseconds(CHRE_HOST_BT_SNOOP_SYNC_INTERVAL_MS);
 
   /**
-   * Write BT event to the snoop log file.
+   * Encode a BT event into the current write buffer.
    *
    * @param packet The BT event packet.
    * @param packetSize Size of the packet.
@@ -82,11 +150,60 @@ class BtSnoopLogParser {
   void capture(const uint8_t *packet, size_t packetSize,
                BtSnoopDirection direction);
 
-  //! File stream used to write the log file.
-  std::ofstream mBtSnoopOstream;
+  /**
+   * Queues the current write buffer for the writer thread if it isn't empty,
+   * and starts a new one. Must be called with mWriterMutex held and fewer than
+   * kMaxPendingBuffers queued.
+   */
+  void queueCurrentBufferLocked();
+
+  void writerThreadMain();
+
+  //! Methods below are only called from the writer thread.
+
+  void writeBuffer(const WriteBuffer &buffer);
+
+  bool writeToFile(const uint8_t *data, size_t size);
+
+  bool ensureSnoopLogFileIsOpen();
 
-  //! Number of BT packtets in the log file.
+  void closeSnoopLogFile();
+
+  bool openNextSnoopLogFile();
+
+  //! Syncs the file to storage if it was written since the last sync, and
+  //! either @p force is true or kSyncInterval has elapsed.
+  void syncSnoopLogFile(bool force);
+
+  const std::string mSnoopLogFilePath;
+  const std::string mLastSnoopLogFilePath;
+
+  //! Number of BT packtets in the log file, counted as they are captured.
+  //! Only accessed from the thread calling log().
   uint32_t mPacketCounter = 0;
+
+  //! Protects the buffers and flags shared with the writer thread. Members
+  //! below, up to mWriterThread, are guarded by it.
+  std::mutex mWriterMutex;
+  std::condition_variable mWriterCondVar;
+  std::condition_variable mWrittenCondVar;
+  WriteBuffer mCurrentBuffer;
+  std::deque<WriteBuffer> mPendingBuffers;
+  //! Emptied buffers kept to be reused with their capacity.
+  std::vector<std::vector<uint8_t>> mFreeBuffers;
+  //! Whether the writer thread is writing a buffer taken from the queue.
+  bool mWriting = false;
+  bool mStopWriter = false;
+  bool mFlushRequested = false;
+  std::thread mWriterThread;
+
+  //! The state of the snoop log file, only accessed from the writer thread.
+  int mFd = -1;
+  size_t mFileSize = 0;
+  size_t mPreallocatedSize = 0;
+  bool mPreallocationSupported = true;
+  bool mSyncPending = false;
+  std::chrono::steady_clock::time_point mLastSyncTime;
 };
 
 }  // namespace chre
@@ -94,6 +94,16 @@ class FbsDaemonBase : public ChreDaemonBase {
    */
   void handleDaemonMessage(const uint8_t *message) override;
 
+  /**
+   * Handles a batch of nanoapp messages sent from CHRE by forwarding each
+   * message to the client(s) as an individual NanoappMessage, in order.
+   *
+   * @param batch The batch of nanoapp messages.
+   * @param hostClientId The host client ID the batch was directed to.
+   */
+  void handleNanoappMessageBatch(const ::chre::fbs::NanoappMessageBatch &batch,
+                                 uint16_t hostClientId);
+
   /**
    * Platform-specific method to actually do the message sending requested by
    * sendMessageToChre.
@@ -17,6 +17,9 @@
 #ifndef CHRE_HOST_FILE_STREAM_H_
 #define CHRE_HOST_FILE_STREAM_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace android {
@@ -31,6 +34,20 @@ namespace chre {
  */
 bool readFileContents(const char *filename, std::vector<uint8_t> &buffer);
 
+/**
+ * Maps a file into memory read-only, so that large files such as nanoapp
+ * binaries can be used without reading them into the heap.
+ *
+ * @param filename The name of the file.
+ * @param contents Populated with the contents of the file, which stay mapped
+ *        until the last reference to them is released. Null if the file is
+ *        empty.
+ * @param size Populated with the size of the file in bytes.
+ * @return true if the file was successfully mapped.
+ */
+bool mapFileContents(const char *filename,
+                     std::shared_ptr<const uint8_t> &contents, size_t &size);
+
 }  // namespace chre
 }  // namespace android
 
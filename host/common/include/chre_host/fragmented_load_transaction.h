@@ -18,6 +18,9 @@
 #define CHRE_HOST_FRAGMENTED_LOAD_TRANSACTION_H_
 
 #include <cinttypes>
+#include <cstddef>
+#include <memory>
+#include <optional>
 #include <vector>
 
 #ifndef CHRE_HOST_DEFAULT_FRAGMENT_SIZE
@@ -26,6 +29,12 @@
 #define CHRE_HOST_DEFAULT_FRAGMENT_SIZE (30 * 1024)
 #endif
 
+#ifndef CHRE_HOST_DEFAULT_FRAGMENT_WINDOW_SIZE
+// The number of fragments requested to be in flight for a windowed load. CHRE
+// may accept fewer, see LoadNanoappResponse.fragment_window_size.
+#define CHRE_HOST_DEFAULT_FRAGMENT_WINDOW_SIZE 4
+#endif
+
 namespace android {
 namespace chre {
 
@@ -33,6 +42,50 @@ namespace chre {
 // fragment starts from id 1.
 static constexpr uint32_t kNoFragmentId = 0;
 
+/**
+ * A read-only view of a fragment of a nanoapp binary. The view shares
+ * ownership of the whole binary, so fragments can be handed out and copied
+ * without copying the bytes they refer to.
+ */
+class NanoappBinaryFragment {
+ public:
+  NanoappBinaryFragment() = default;
+
+  /**
+   * @param binary the whole nanoapp binary
+   * @param offset the offset of the fragment within the binary
+   * @param size the size of the fragment in bytes
+   */
+  NanoappBinaryFragment(std::shared_ptr<const uint8_t> binary, size_t offset,
+                        size_t size)
+      : mBinary(std::move(binary)), mOffset(offset), mSize(size) {}
+
+  [[nodiscard]] const uint8_t *data() const {
+    return (mBinary == nullptr) ? nullptr : mBinary.get() + mOffset;
+  }
+
+  [[nodiscard]] size_t size() const {
+    return mSize;
+  }
+
+  [[nodiscard]] bool empty() const {
+    return mSize == 0;
+  }
+
+  [[nodiscard]] const uint8_t *begin() const {
+    return data();
+  }
+
+  [[nodiscard]] const uint8_t *end() const {
+    return data() + mSize;
+  }
+
+ private:
+  std::shared_ptr<const uint8_t> mBinary;
+  size_t mOffset = 0;
+  size_t mSize = 0;
+};
+
 /**
  * A struct which represents a single fragmented request. The caller should use
  * this class along with FragmentedLoadTransaction to get global attributes for
@@ -47,17 +100,20 @@ struct FragmentedLoadRequest {
   uint32_t appFlags;
   uint32_t targetApiVersion;
   size_t appTotalSizeBytes;
-  std::vector<uint8_t> binary;
+  NanoappBinaryFragment binary;
+  //! The hash identifying the binary for CHRE to reuse a copy it retained, or
+  //! 0. Only set for the first fragment.
+  uint64_t appBinaryHash = 0;
 
   FragmentedLoadRequest(size_t fragmentId, uint32_t transactionId,
-                        uint64_t appId, const std::vector<uint8_t> &binary)
+                        uint64_t appId, NanoappBinaryFragment binary)
       : FragmentedLoadRequest(fragmentId, transactionId, appId, 0, 0, 0, 0,
-                              binary) {}
+                              std::move(binary)) {}
 
   FragmentedLoadRequest(size_t fragmentId, uint32_t transactionId,
                         uint64_t appId, uint32_t appVersion, uint32_t appFlags,
                         uint32_t targetApiVersion, size_t appTotalSizeBytes,
-                        const std::vector<uint8_t> &binary)
+                        NanoappBinaryFragment binary)
       : fragmentId(fragmentId),
         transactionId(transactionId),
         appId(appId),
@@ -65,7 +121,7 @@ struct FragmentedLoadRequest {
         appFlags(appFlags),
         targetApiVersion(targetApiVersion),
         appTotalSizeBytes(appTotalSizeBytes),
-        binary(binary) {}
+        binary(std::move(binary)) {}
 };
 
 /**
@@ -75,6 +131,9 @@ struct FragmentedLoadRequest {
  * The caller should use the getNextRequest() to retrieve the next available
  * fragment and send a load request with the fragmented binary and the fragment
  * ID.
+ *
+ * Fragments are views over a single copy of the binary held by the
+ * transaction, and each request is only built when it is retrieved.
  */
 class FragmentedLoadTransaction {
  public:
@@ -84,7 +143,7 @@ class FragmentedLoadTransaction {
    * @param appVersion the version of the nanoapp
    * @param appFlags the flags specified by the nanoapp to be loaded.
    * @param targetApiVersion the API version this nanoapp is targeted for
-   * @param appBinary the nanoapp binary data
+   * @param appBinary the nanoapp binary data, which is copied once
    * @param fragmentSize the size of each fragment in bytes
    */
   FragmentedLoadTransaction(uint32_t transactionId, uint64_t appId,
@@ -93,6 +152,30 @@ class FragmentedLoadTransaction {
                             const std::vector<uint8_t> &appBinary,
                             size_t fragmentSize = kDefaultFragmentSize);
 
+  /**
+   * Same as above, but shares ownership of the binary instead of copying it.
+   */
+  FragmentedLoadTransaction(
+      uint32_t transactionId, uint64_t appId, uint32_t appVersion,
+      uint32_t appFlags, uint32_t targetApiVersion,
+      std::shared_ptr<const std::vector<uint8_t>> appBinary,
+      size_t fragmentSize = kDefaultFragmentSize);
+
+  /**
+   * Same as above, for a binary held in an arbitrary buffer, e.g. a file
+   * mapped with mapFileContents().
+   *
+   * @param appBinary the nanoapp binary data, which must stay valid and
+   *        unmodified while any reference to it is held
+   * @param appBinarySize the size of appBinary in bytes
+   */
+  FragmentedLoadTransaction(uint32_t transactionId, uint64_t appId,
+                            uint32_t appVersion, uint32_t appFlags,
+                            uint32_t targetApiVersion,
+                            std::shared_ptr<const uint8_t> appBinary,
+                            size_t appBinarySize,
+                            size_t fragmentSize = kDefaultFragmentSize);
+
   /**
    * Retrieves the FragmentedLoadRequest including the next fragment of the
    * binary. Invoking getNextRequest() will prepare the next fragment for a
@@ -111,26 +194,71 @@ class FragmentedLoadTransaction {
    */
   [[nodiscard]] bool isComplete() const;
 
+  /**
+   * Makes the fragment with the given ID the one returned by the next call to
+   * getNextRequest(), e.g. to resend the fragments following the last one
+   * acknowledged by CHRE.
+   *
+   * @param fragmentId the ID of the fragment, starting from 1 and at most
+   *        getNumFragments()
+   */
+  void rewindTo(size_t fragmentId);
+
+  /**
+   * @return the ID of the fragment getNextRequest() returns next.
+   */
+  [[nodiscard]] size_t getNextFragmentId() const {
+    return mCurrentRequestIndex + 1;
+  }
+
+  [[nodiscard]] size_t getNumFragments() const {
+    return mNumFragments;
+  }
+
   [[nodiscard]] uint32_t getTransactionId() const {
-    return mFragmentRequests[0].transactionId;
+    return mTransactionId;
   }
 
   [[nodiscard]] uint64_t getNanoappId() const {
-    return mFragmentRequests[0].appId;
+    return mAppId;
   }
 
   [[nodiscard]] size_t getNanoappTotalSize() const {
-    return !mFragmentRequests[0].appTotalSizeBytes;
+    return mBinarySize;
   }
 
   [[nodiscard]] uint32_t getNanoappVersion() const {
-    return mFragmentRequests[0].appVersion;
+    return mAppVersion;
+  }
+
+  /**
+   * Sets the hash identifying the binary, which lets CHRE load the nanoapp
+   * from a copy of the binary it retained since it was last loaded instead of
+   * receiving all fragments. See LoadNanoappRequest.app_binary_hash.
+   *
+   * @param appBinaryHash a hash of the binary, or 0 to always send it
+   */
+  void setBinaryHash(uint64_t appBinaryHash) {
+    mAppBinaryHash = appBinaryHash;
   }
 
  private:
-  std::vector<FragmentedLoadRequest> mFragmentRequests;
+  uint32_t mTransactionId;
+  uint64_t mAppId;
+  uint32_t mAppVersion;
+  uint32_t mAppFlags;
+  uint32_t mTargetApiVersion;
+  uint64_t mAppBinaryHash = 0;
+
+  std::shared_ptr<const uint8_t> mBinary;
+  size_t mBinarySize;
+  size_t mFragmentSize;
+  size_t mNumFragments;
   size_t mCurrentRequestIndex = 0;
 
+  //! The request last returned by getNextRequest().
+  std::optional<FragmentedLoadRequest> mCurrentRequest;
+
   static constexpr size_t kDefaultFragmentSize =
       CHRE_HOST_DEFAULT_FRAGMENT_SIZE;
 };
@@ -17,6 +17,10 @@ struct MessageDeliveryStatus;
 struct MessageDeliveryStatusBuilder;
 struct MessageDeliveryStatusT;
 
+struct NanoappMessageBatch;
+struct NanoappMessageBatchBuilder;
+struct NanoappMessageBatchT;
+
 struct HubInfoRequest;
 struct HubInfoRequestBuilder;
 struct HubInfoRequestT;
@@ -145,6 +149,14 @@ struct PulseResponse;
 struct PulseResponseBuilder;
 struct PulseResponseT;
 
+struct TraceDataRequest;
+struct TraceDataRequestBuilder;
+struct TraceDataRequestT;
+
+struct TraceData;
+struct TraceDataBuilder;
+struct TraceDataT;
+
 struct HostAddress;
 
 struct MessageContainer;
@@ -266,33 +278,36 @@ enum class LogType : int8_t {
   TOKENIZED = 1,
   BLUETOOTH = 2,
   NANOAPP_TOKENIZED = 3,
+  DEFERRED_STRING = 4,
   MIN = STRING,
-  MAX = NANOAPP_TOKENIZED
+  MAX = DEFERRED_STRING
 };
 
-inline const LogType (&EnumValuesLogType())[4] {
+inline const LogType (&EnumValuesLogType())[5] {
   static const LogType values[] = {
     LogType::STRING,
     LogType::TOKENIZED,
     LogType::BLUETOOTH,
-    LogType::NANOAPP_TOKENIZED
+    LogType::NANOAPP_TOKENIZED,
+    LogType::DEFERRED_STRING
   };
   return values;
 }
 
 inline const char * const *EnumNamesLogType() {
-  static const char * const names[5] = {
+  static const char * const names[6] = {
     "STRING",
     "TOKENIZED",
     "BLUETOOTH",
     "NANOAPP_TOKENIZED",
+    "DEFERRED_STRING",
     nullptr
   };
   return names;
 }
 
 inline const char *EnumNameLogType(LogType e) {
-  if (flatbuffers::IsOutRange(e, LogType::STRING, LogType::NANOAPP_TOKENIZED)) return "";
+  if (flatbuffers::IsOutRange(e, LogType::STRING, LogType::DEFERRED_STRING)) return "";
   const size_t index = static_cast<size_t>(e);
   return EnumNamesLogType()[index];
 }
@@ -363,11 +378,14 @@ enum class ChreMessage : uint8_t {
   PulseResponse = 30,
   NanoappTokenDatabaseInfo = 31,
   MessageDeliveryStatus = 32,
+  NanoappMessageBatch = 33,
+  TraceDataRequest = 34,
+  TraceData = 35,
   MIN = NONE,
-  MAX = MessageDeliveryStatus
+  MAX = TraceData
 };
 
-inline const ChreMessage (&EnumValuesChreMessage())[33] {
+inline const ChreMessage (&EnumValuesChreMessage())[36] {
   static const ChreMessage values[] = {
     ChreMessage::NONE,
     ChreMessage::NanoappMessage,
@@ -401,13 +419,16 @@ inline const ChreMessage (&EnumValuesChreMessage())[33] {
     ChreMessage::PulseRequest,
     ChreMessage::PulseResponse,
     ChreMessage::NanoappTokenDatabaseInfo,
-    ChreMessage::MessageDeliveryStatus
+    ChreMessage::MessageDeliveryStatus,
+    ChreMessage::NanoappMessageBatch,
+    ChreMessage::TraceDataRequest,
+    ChreMessage::TraceData
   };
   return values;
 }
 
 inline const char * const *EnumNamesChreMessage() {
-  static const char * const names[34] = {
+  static const char * const names[37] = {
     "NONE",
     "NanoappMessage",
     "HubInfoRequest",
@@ -441,13 +462,16 @@ inline const char * const *EnumNamesChreMessage() {
     "PulseResponse",
     "NanoappTokenDatabaseInfo",
     "MessageDeliveryStatus",
+    "NanoappMessageBatch",
+    "TraceDataRequest",
+    "TraceData",
     nullptr
   };
   return names;
 }
 
 inline const char *EnumNameChreMessage(ChreMessage e) {
-  if (flatbuffers::IsOutRange(e, ChreMessage::NONE, ChreMessage::MessageDeliveryStatus)) return "";
+  if (flatbuffers::IsOutRange(e, ChreMessage::NONE, ChreMessage::TraceData)) return "";
   const size_t index = static_cast<size_t>(e);
   return EnumNamesChreMessage()[index];
 }
@@ -584,6 +608,18 @@ template<> struct ChreMessageTraits<chre::fbs::MessageDeliveryStatus> {
   static const ChreMessage enum_value = ChreMessage::MessageDeliveryStatus;
 };
 
+template<> struct ChreMessageTraits<chre::fbs::NanoappMessageBatch> {
+  static const ChreMessage enum_value = ChreMessage::NanoappMessageBatch;
+};
+
+template<> struct ChreMessageTraits<chre::fbs::TraceDataRequest> {
+  static const ChreMessage enum_value = ChreMessage::TraceDataRequest;
+};
+
+template<> struct ChreMessageTraits<chre::fbs::TraceData> {
+  static const ChreMessage enum_value = ChreMessage::TraceData;
+};
+
 struct ChreMessageUnion {
   ChreMessage type;
   void *value;
@@ -872,6 +908,30 @@ struct ChreMessageUnion {
     return type == ChreMessage::MessageDeliveryStatus ?
       reinterpret_cast<const chre::fbs::MessageDeliveryStatusT *>(value) : nullptr;
   }
+  chre::fbs::NanoappMessageBatchT *AsNanoappMessageBatch() {
+    return type == ChreMessage::NanoappMessageBatch ?
+      reinterpret_cast<chre::fbs::NanoappMessageBatchT *>(value) : nullptr;
+  }
+  const chre::fbs::NanoappMessageBatchT *AsNanoappMessageBatch() const {
+    return type == ChreMessage::NanoappMessageBatch ?
+      reinterpret_cast<const chre::fbs::NanoappMessageBatchT *>(value) : nullptr;
+  }
+  chre::fbs::TraceDataRequestT *AsTraceDataRequest() {
+    return type == ChreMessage::TraceDataRequest ?
+      reinterpret_cast<chre::fbs::TraceDataRequestT *>(value) : nullptr;
+  }
+  const chre::fbs::TraceDataRequestT *AsTraceDataRequest() const {
+    return type == ChreMessage::TraceDataRequest ?
+      reinterpret_cast<const chre::fbs::TraceDataRequestT *>(value) : nullptr;
+  }
+  chre::fbs::TraceDataT *AsTraceData() {
+    return type == ChreMessage::TraceData ?
+      reinterpret_cast<chre::fbs::TraceDataT *>(value) : nullptr;
+  }
+  const chre::fbs::TraceDataT *AsTraceData() const {
+    return type == ChreMessage::TraceData ?
+      reinterpret_cast<const chre::fbs::TraceDataT *>(value) : nullptr;
+  }
 };
 
 bool VerifyChreMessage(flatbuffers::Verifier &verifier, const void *obj, ChreMessage type);
@@ -1188,6 +1248,75 @@ inline flatbuffers::Offset<MessageDeliveryStatus> CreateMessageDeliveryStatus(
 
 flatbuffers::Offset<MessageDeliveryStatus> CreateMessageDeliveryStatus(flatbuffers::FlatBufferBuilder &_fbb, const MessageDeliveryStatusT *_o, const flatbuffers::rehasher_function_t *_rehasher = nullptr);
 
+struct NanoappMessageBatchT : public flatbuffers::NativeTable {
+  typedef NanoappMessageBatch TableType;
+  std::vector<std::unique_ptr<chre::fbs::NanoappMessageT>> messages;
+  NanoappMessageBatchT() {
+  }
+};
+
+struct NanoappMessageBatch FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  typedef NanoappMessageBatchT NativeTableType;
+  typedef NanoappMessageBatchBuilder Builder;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_MESSAGES = 4
+  };
+  const flatbuffers::Vector<flatbuffers::Offset<chre::fbs::NanoappMessage>> *messages() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<chre::fbs::NanoappMessage>> *>(VT_MESSAGES);
+  }
+  flatbuffers::Vector<flatbuffers::Offset<chre::fbs::NanoappMessage>> *mutable_messages() {
+    return GetPointer<flatbuffers::Vector<flatbuffers::Offset<chre::fbs::NanoappMessage>> *>(VT_MESSAGES);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_MESSAGES) &&
+           verifier.VerifyVector(messages()) &&
+           verifier.VerifyVectorOfTables(messages()) &&
+           verifier.EndTable();
+  }
+  NanoappMessageBatchT *UnPack(const flatbuffers::resolver_function_t *_resolver = nullptr) const;
+  void UnPackTo(NanoappMessageBatchT *_o, const flatbuffers::resolver_function_t *_resolver = nullptr) const;
+  static flatbuffers::Offset<NanoappMessageBatch> Pack(flatbuffers::FlatBufferBuilder &_fbb, const NanoappMessageBatchT* _o, const flatbuffers::rehasher_function_t *_rehasher = nullptr);
+};
+
+struct NanoappMessageBatchBuilder {
+  typedef NanoappMessageBatch Table;
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_messages(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<chre::fbs::NanoappMessage>>> messages) {
+    fbb_.AddOffset(NanoappMessageBatch::VT_MESSAGES, messages);
+  }
+  explicit NanoappMessageBatchBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  NanoappMessageBatchBuilder &operator=(const NanoappMessageBatchBuilder &);
+  flatbuffers::Offset<NanoappMessageBatch> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<NanoappMessageBatch>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<NanoappMessageBatch> CreateNanoappMessageBatch(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<chre::fbs::NanoappMessage>>> messages = 0) {
+  NanoappMessageBatchBuilder builder_(_fbb);
+  builder_.add_messages(messages);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<NanoappMessageBatch> CreateNanoappMessageBatchDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    const std::vector<flatbuffers::Offset<chre::fbs::NanoappMessage>> *messages = nullptr) {
+  auto messages__ = messages ? _fbb.CreateVector<flatbuffers::Offset<chre::fbs::NanoappMessage>>(*messages) : 0;
+  return chre::fbs::CreateNanoappMessageBatch(
+      _fbb,
+      messages__);
+}
+
+flatbuffers::Offset<NanoappMessageBatch> CreateNanoappMessageBatch(flatbuffers::FlatBufferBuilder &_fbb, const NanoappMessageBatchT *_o, const flatbuffers::rehasher_function_t *_rehasher = nullptr);
+
 struct HubInfoRequestT : public flatbuffers::NativeTable {
   typedef HubInfoRequest TableType;
   HubInfoRequestT() {
@@ -1877,6 +2006,8 @@ struct LoadNanoappRequestT : public flatbuffers::NativeTable {
   std::vector<int8_t> app_binary_file_name;
   uint32_t app_flags;
   bool respond_before_start;
+  uint32_t fragment_window_size;
+  uint64_t app_binary_hash;
   LoadNanoappRequestT()
       : transaction_id(0),
         app_id(0),
@@ -1885,7 +2016,9 @@ struct LoadNanoappRequestT : public flatbuffers::NativeTable {
         fragment_id(0),
         total_app_size(0),
         app_flags(0),
-        respond_before_start(false) {
+        respond_before_start(false),
+        fragment_window_size(0),
+        app_binary_hash(0) {
   }
 };
 
@@ -1940,7 +2073,9 @@ struct LoadNanoappRequest FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
     VT_TOTAL_APP_SIZE = 16,
     VT_APP_BINARY_FILE_NAME = 18,
     VT_APP_FLAGS = 20,
-    VT_RESPOND_BEFORE_START = 22
+    VT_RESPOND_BEFORE_START = 22,
+    VT_FRAGMENT_WINDOW_SIZE = 24,
+    VT_APP_BINARY_HASH = 26
   };
   uint32_t transaction_id() const {
     return GetField<uint32_t>(VT_TRANSACTION_ID, 0);
@@ -2014,6 +2149,26 @@ struct LoadNanoappRequest FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   bool mutate_respond_before_start(bool _respond_before_start) {
     return SetField<uint8_t>(VT_RESPOND_BEFORE_START, static_cast<uint8_t>(_respond_before_start), 0);
   }
+  /// If nonzero, the requestor may send up to this many fragments of a
+  /// fragmented load without waiting for their responses. See
+  /// LoadNanoappResponse::fragment_window_size.
+  uint32_t fragment_window_size() const {
+    return GetField<uint32_t>(VT_FRAGMENT_WINDOW_SIZE, 0);
+  }
+  bool mutate_fragment_window_size(uint32_t _fragment_window_size) {
+    return SetField<uint32_t>(VT_FRAGMENT_WINDOW_SIZE, _fragment_window_size, 0);
+  }
+  /// If nonzero, a hash of the whole nanoapp binary chosen by the requestor,
+  /// set in the first fragment. CHRE may retain binaries across restarts and
+  /// load the nanoapp from the retained copy of a binary loaded earlier with
+  /// the same app ID, version, size and hash, see
+  /// LoadNanoappResponse::binary_resident.
+  uint64_t app_binary_hash() const {
+    return GetField<uint64_t>(VT_APP_BINARY_HASH, 0);
+  }
+  bool mutate_app_binary_hash(uint64_t _app_binary_hash) {
+    return SetField<uint64_t>(VT_APP_BINARY_HASH, _app_binary_hash, 0);
+  }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<uint32_t>(verifier, VT_TRANSACTION_ID) &&
@@ -2028,6 +2183,8 @@ struct LoadNanoappRequest FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
            verifier.VerifyVector(app_binary_file_name()) &&
            VerifyField<uint32_t>(verifier, VT_APP_FLAGS) &&
            VerifyField<uint8_t>(verifier, VT_RESPOND_BEFORE_START) &&
+           VerifyField<uint32_t>(verifier, VT_FRAGMENT_WINDOW_SIZE) &&
+           VerifyField<uint64_t>(verifier, VT_APP_BINARY_HASH) &&
            verifier.EndTable();
   }
   LoadNanoappRequestT *UnPack(const flatbuffers::resolver_function_t *_resolver = nullptr) const;
@@ -2069,6 +2226,12 @@ struct LoadNanoappRequestBuilder {
   void add_respond_before_start(bool respond_before_start) {
     fbb_.AddElement<uint8_t>(LoadNanoappRequest::VT_RESPOND_BEFORE_START, static_cast<uint8_t>(respond_before_start), 0);
   }
+  void add_fragment_window_size(uint32_t fragment_window_size) {
+    fbb_.AddElement<uint32_t>(LoadNanoappRequest::VT_FRAGMENT_WINDOW_SIZE, fragment_window_size, 0);
+  }
+  void add_app_binary_hash(uint64_t app_binary_hash) {
+    fbb_.AddElement<uint64_t>(LoadNanoappRequest::VT_APP_BINARY_HASH, app_binary_hash, 0);
+  }
   explicit LoadNanoappRequestBuilder(flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -2093,8 +2256,11 @@ inline flatbuffers::Offset<LoadNanoappRequest> CreateLoadNanoappRequest(
     uint32_t total_app_size = 0,
     flatbuffers::Offset<flatbuffers::Vector<int8_t>> app_binary_file_name = 0,
     uint32_t app_flags = 0,
-    bool respond_before_start = false) {
+    bool respond_before_start = false,
+    uint32_t fragment_window_size = 0,
+    uint64_t app_binary_hash = 0) {
   LoadNanoappRequestBuilder builder_(_fbb);
+  builder_.add_app_binary_hash(app_binary_hash);
   builder_.add_app_id(app_id);
   builder_.add_app_flags(app_flags);
   builder_.add_app_binary_file_name(app_binary_file_name);
@@ -2104,6 +2270,7 @@ inline flatbuffers::Offset<LoadNanoappRequest> CreateLoadNanoappRequest(
   builder_.add_target_api_version(target_api_version);
   builder_.add_app_version(app_version);
   builder_.add_transaction_id(transaction_id);
+  builder_.add_fragment_window_size(fragment_window_size);
   builder_.add_respond_before_start(respond_before_start);
   return builder_.Finish();
 }
@@ -2119,7 +2286,9 @@ inline flatbuffers::Offset<LoadNanoappRequest> CreateLoadNanoappRequestDirect(
     uint32_t total_app_size = 0,
     const std::vector<int8_t> *app_binary_file_name = nullptr,
     uint32_t app_flags = 0,
-    bool respond_before_start = false) {
+    bool respond_before_start = false,
+    uint32_t fragment_window_size = 0,
+    uint64_t app_binary_hash = 0) {
   auto app_binary__ = app_binary ? _fbb.CreateVector<uint8_t>(*app_binary) : 0;
   auto app_binary_file_name__ = app_binary_file_name ? _fbb.CreateVector<int8_t>(*app_binary_file_name) : 0;
   return chre::fbs::CreateLoadNanoappRequest(
@@ -2133,7 +2302,9 @@ inline flatbuffers::Offset<LoadNanoappRequest> CreateLoadNanoappRequestDirect(
       total_app_size,
       app_binary_file_name__,
       app_flags,
-      respond_before_start);
+      respond_before_start,
+      fragment_window_size,
+      app_binary_hash);
 }
 
 flatbuffers::Offset<LoadNanoappRequest> CreateLoadNanoappRequest(flatbuffers::FlatBufferBuilder &_fbb, const LoadNanoappRequestT *_o, const flatbuffers::rehasher_function_t *_rehasher = nullptr);
@@ -2143,10 +2314,14 @@ struct LoadNanoappResponseT : public flatbuffers::NativeTable {
   uint32_t transaction_id;
   bool success;
   uint32_t fragment_id;
+  uint32_t fragment_window_size;
+  bool binary_resident;
   LoadNanoappResponseT()
       : transaction_id(0),
         success(false),
-        fragment_id(0) {
+        fragment_id(0),
+        fragment_window_size(0),
+        binary_resident(false) {
   }
 };
 
@@ -2156,7 +2331,9 @@ struct LoadNanoappResponse FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table
   enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
     VT_TRANSACTION_ID = 4,
     VT_SUCCESS = 6,
-    VT_FRAGMENT_ID = 8
+    VT_FRAGMENT_ID = 8,
+    VT_FRAGMENT_WINDOW_SIZE = 10,
+    VT_BINARY_RESIDENT = 12
   };
   uint32_t transaction_id() const {
     return GetField<uint32_t>(VT_TRANSACTION_ID, 0);
@@ -2180,11 +2357,33 @@ struct LoadNanoappResponse FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table
   bool mutate_fragment_id(uint32_t _fragment_id) {
     return SetField<uint32_t>(VT_FRAGMENT_ID, _fragment_id, 0);
   }
+  /// The number of fragments CHRE accepts in flight for this transaction.
+  /// If 0, CHRE doesn't support windowed loading and the requestor must wait
+  /// for the response to each fragment before sending the next one.
+  /// Otherwise, fragment_id is a cumulative acknowledgement of all fragments
+  /// up to and including it.
+  uint32_t fragment_window_size() const {
+    return GetField<uint32_t>(VT_FRAGMENT_WINDOW_SIZE, 0);
+  }
+  bool mutate_fragment_window_size(uint32_t _fragment_window_size) {
+    return SetField<uint32_t>(VT_FRAGMENT_WINDOW_SIZE, _fragment_window_size, 0);
+  }
+  /// If true, CHRE loaded the nanoapp from the retained copy of a binary with
+  /// the app_binary_hash given in the first fragment, and the requestor must
+  /// not send the remaining fragments. This response ends the transaction.
+  bool binary_resident() const {
+    return GetField<uint8_t>(VT_BINARY_RESIDENT, 0) != 0;
+  }
+  bool mutate_binary_resident(bool _binary_resident) {
+    return SetField<uint8_t>(VT_BINARY_RESIDENT, static_cast<uint8_t>(_binary_resident), 0);
+  }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<uint32_t>(verifier, VT_TRANSACTION_ID) &&
            VerifyField<uint8_t>(verifier, VT_SUCCESS) &&
            VerifyField<uint32_t>(verifier, VT_FRAGMENT_ID) &&
+           VerifyField<uint32_t>(verifier, VT_FRAGMENT_WINDOW_SIZE) &&
+           VerifyField<uint8_t>(verifier, VT_BINARY_RESIDENT) &&
            verifier.EndTable();
   }
   LoadNanoappResponseT *UnPack(const flatbuffers::resolver_function_t *_resolver = nullptr) const;
@@ -2205,6 +2404,12 @@ struct LoadNanoappResponseBuilder {
   void add_fragment_id(uint32_t fragment_id) {
     fbb_.AddElement<uint32_t>(LoadNanoappResponse::VT_FRAGMENT_ID, fragment_id, 0);
   }
+  void add_fragment_window_size(uint32_t fragment_window_size) {
+    fbb_.AddElement<uint32_t>(LoadNanoappResponse::VT_FRAGMENT_WINDOW_SIZE, fragment_window_size, 0);
+  }
+  void add_binary_resident(bool binary_resident) {
+    fbb_.AddElement<uint8_t>(LoadNanoappResponse::VT_BINARY_RESIDENT, static_cast<uint8_t>(binary_resident), 0);
+  }
   explicit LoadNanoappResponseBuilder(flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -2221,10 +2426,14 @@ inline flatbuffers::Offset<LoadNanoappResponse> CreateLoadNanoappResponse(
     flatbuffers::FlatBufferBuilder &_fbb,
     uint32_t transaction_id = 0,
     bool success = false,
-    uint32_t fragment_id = 0) {
+    uint32_t fragment_id = 0,
+    uint32_t fragment_window_size = 0,
+    bool binary_resident = false) {
   LoadNanoappResponseBuilder builder_(_fbb);
   builder_.add_fragment_id(fragment_id);
   builder_.add_transaction_id(transaction_id);
+  builder_.add_fragment_window_size(fragment_window_size);
+  builder_.add_binary_resident(binary_resident);
   builder_.add_success(success);
   return builder_.Finish();
 }
@@ -3888,6 +4097,168 @@ inline flatbuffers::Offset<PulseResponse> CreatePulseResponse(
 
 flatbuffers::Offset<PulseResponse> CreatePulseResponse(flatbuffers::FlatBufferBuilder &_fbb, const PulseResponseT *_o, const flatbuffers::rehasher_function_t *_rehasher = nullptr);
 
+struct TraceDataRequestT : public flatbuffers::NativeTable {
+  typedef TraceDataRequest TableType;
+  TraceDataRequestT() {
+  }
+};
+
+struct TraceDataRequest FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  typedef TraceDataRequestT NativeTableType;
+  typedef TraceDataRequestBuilder Builder;
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           verifier.EndTable();
+  }
+  TraceDataRequestT *UnPack(const flatbuffers::resolver_function_t *_resolver = nullptr) const;
+  void UnPackTo(TraceDataRequestT *_o, const flatbuffers::resolver_function_t *_resolver = nullptr) const;
+  static flatbuffers::Offset<TraceDataRequest> Pack(flatbuffers::FlatBufferBuilder &_fbb, const TraceDataRequestT* _o, const flatbuffers::rehasher_function_t *_rehasher = nullptr);
+};
+
+struct TraceDataRequestBuilder {
+  typedef TraceDataRequest Table;
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  explicit TraceDataRequestBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  TraceDataRequestBuilder &operator=(const TraceDataRequestBuilder &);
+  flatbuffers::Offset<TraceDataRequest> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<TraceDataRequest>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<TraceDataRequest> CreateTraceDataRequest(
+    flatbuffers::FlatBufferBuilder &_fbb) {
+  TraceDataRequestBuilder builder_(_fbb);
+  return builder_.Finish();
+}
+
+flatbuffers::Offset<TraceDataRequest> CreateTraceDataRequest(flatbuffers::FlatBufferBuilder &_fbb, const TraceDataRequestT *_o, const flatbuffers::rehasher_function_t *_rehasher = nullptr);
+
+struct TraceDataT : public flatbuffers::NativeTable {
+  typedef TraceData TableType;
+  std::vector<uint8_t> records;
+  std::vector<int8_t> strings;
+  uint32_t num_dropped;
+  bool last;
+  TraceDataT()
+      : num_dropped(0),
+        last(false) {
+  }
+};
+
+struct TraceData FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  typedef TraceDataT NativeTableType;
+  typedef TraceDataBuilder Builder;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_RECORDS = 4,
+    VT_STRINGS = 6,
+    VT_NUM_DROPPED = 8,
+    VT_LAST = 10
+  };
+  const flatbuffers::Vector<uint8_t> *records() const {
+    return GetPointer<const flatbuffers::Vector<uint8_t> *>(VT_RECORDS);
+  }
+  flatbuffers::Vector<uint8_t> *mutable_records() {
+    return GetPointer<flatbuffers::Vector<uint8_t> *>(VT_RECORDS);
+  }
+  const flatbuffers::Vector<int8_t> *strings() const {
+    return GetPointer<const flatbuffers::Vector<int8_t> *>(VT_STRINGS);
+  }
+  flatbuffers::Vector<int8_t> *mutable_strings() {
+    return GetPointer<flatbuffers::Vector<int8_t> *>(VT_STRINGS);
+  }
+  uint32_t num_dropped() const {
+    return GetField<uint32_t>(VT_NUM_DROPPED, 0);
+  }
+  bool mutate_num_dropped(uint32_t _num_dropped) {
+    return SetField<uint32_t>(VT_NUM_DROPPED, _num_dropped, 0);
+  }
+  bool last() const {
+    return GetField<uint8_t>(VT_LAST, 0) != 0;
+  }
+  bool mutate_last(bool _last) {
+    return SetField<uint8_t>(VT_LAST, static_cast<uint8_t>(_last), 0);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_RECORDS) &&
+           verifier.VerifyVector(records()) &&
+           VerifyOffset(verifier, VT_STRINGS) &&
+           verifier.VerifyVector(strings()) &&
+           VerifyField<uint32_t>(verifier, VT_NUM_DROPPED) &&
+           VerifyField<uint8_t>(verifier, VT_LAST) &&
+           verifier.EndTable();
+  }
+  TraceDataT *UnPack(const flatbuffers::resolver_function_t *_resolver = nullptr) const;
+  void UnPackTo(TraceDataT *_o, const flatbuffers::resolver_function_t *_resolver = nullptr) const;
+  static flatbuffers::Offset<TraceData> Pack(flatbuffers::FlatBufferBuilder &_fbb, const TraceDataT* _o, const flatbuffers::rehasher_function_t *_rehasher = nullptr);
+};
+
+struct TraceDataBuilder {
+  typedef TraceData Table;
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_records(flatbuffers::Offset<flatbuffers::Vector<uint8_t>> records) {
+    fbb_.AddOffset(TraceData::VT_RECORDS, records);
+  }
+  void add_strings(flatbuffers::Offset<flatbuffers::Vector<int8_t>> strings) {
+    fbb_.AddOffset(TraceData::VT_STRINGS, strings);
+  }
+  void add_num_dropped(uint32_t num_dropped) {
+    fbb_.AddElement<uint32_t>(TraceData::VT_NUM_DROPPED, num_dropped, 0);
+  }
+  void add_last(bool last) {
+    fbb_.AddElement<uint8_t>(TraceData::VT_LAST, static_cast<uint8_t>(last), 0);
+  }
+  explicit TraceDataBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  TraceDataBuilder &operator=(const TraceDataBuilder &);
+  flatbuffers::Offset<TraceData> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<TraceData>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<TraceData> CreateTraceData(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> records = 0,
+    flatbuffers::Offset<flatbuffers::Vector<int8_t>> strings = 0,
+    uint32_t num_dropped = 0,
+    bool last = false) {
+  TraceDataBuilder builder_(_fbb);
+  builder_.add_num_dropped(num_dropped);
+  builder_.add_strings(strings);
+  builder_.add_records(records);
+  builder_.add_last(last);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<TraceData> CreateTraceDataDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    const std::vector<uint8_t> *records = nullptr,
+    const std::vector<int8_t> *strings = nullptr,
+    uint32_t num_dropped = 0,
+    bool last = false) {
+  auto records__ = records ? _fbb.CreateVector<uint8_t>(*records) : 0;
+  auto strings__ = strings ? _fbb.CreateVector<int8_t>(*strings) : 0;
+  return chre::fbs::CreateTraceData(
+      _fbb,
+      records__,
+      strings__,
+      num_dropped,
+      last);
+}
+
+flatbuffers::Offset<TraceData> CreateTraceData(flatbuffers::FlatBufferBuilder &_fbb, const TraceDataT *_o, const flatbuffers::rehasher_function_t *_rehasher = nullptr);
+
 struct MessageContainerT : public flatbuffers::NativeTable {
   typedef MessageContainer TableType;
   chre::fbs::ChreMessageUnion message;
@@ -4010,6 +4381,15 @@ struct MessageContainer FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   const chre::fbs::MessageDeliveryStatus *message_as_MessageDeliveryStatus() const {
     return message_type() == chre::fbs::ChreMessage::MessageDeliveryStatus ? static_cast<const chre::fbs::MessageDeliveryStatus *>(message()) : nullptr;
   }
+  const chre::fbs::NanoappMessageBatch *message_as_NanoappMessageBatch() const {
+    return message_type() == chre::fbs::ChreMessage::NanoappMessageBatch ? static_cast<const chre::fbs::NanoappMessageBatch *>(message()) : nullptr;
+  }
+  const chre::fbs::TraceDataRequest *message_as_TraceDataRequest() const {
+    return message_type() == chre::fbs::ChreMessage::TraceDataRequest ? static_cast<const chre::fbs::TraceDataRequest *>(message()) : nullptr;
+  }
+  const chre::fbs::TraceData *message_as_TraceData() const {
+    return message_type() == chre::fbs::ChreMessage::TraceData ? static_cast<const chre::fbs::TraceData *>(message()) : nullptr;
+  }
   void *mutable_message() {
     return GetPointer<void *>(VT_MESSAGE);
   }
@@ -4166,6 +4546,18 @@ template<> inline const chre::fbs::MessageDeliveryStatus *MessageContainer::mess
   return message_as_MessageDeliveryStatus();
 }
 
+template<> inline const chre::fbs::NanoappMessageBatch *MessageContainer::message_as<chre::fbs::NanoappMessageBatch>() const {
+  return message_as_NanoappMessageBatch();
+}
+
+template<> inline const chre::fbs::TraceDataRequest *MessageContainer::message_as<chre::fbs::TraceDataRequest>() const {
+  return message_as_TraceDataRequest();
+}
+
+template<> inline const chre::fbs::TraceData *MessageContainer::message_as<chre::fbs::TraceData>() const {
+  return message_as_TraceData();
+}
+
 struct MessageContainerBuilder {
   typedef MessageContainer Table;
   flatbuffers::FlatBufferBuilder &fbb_;
@@ -4286,6 +4678,32 @@ inline flatbuffers::Offset<MessageDeliveryStatus> CreateMessageDeliveryStatus(fl
       _error_code);
 }
 
+inline NanoappMessageBatchT *NanoappMessageBatch::UnPack(const flatbuffers::resolver_function_t *_resolver) const {
+  std::unique_ptr<chre::fbs::NanoappMessageBatchT> _o = std::unique_ptr<chre::fbs::NanoappMessageBatchT>(new NanoappMessageBatchT());
+  UnPackTo(_o.get(), _resolver);
+  return _o.release();
+}
+
+inline void NanoappMessageBatch::UnPackTo(NanoappMessageBatchT *_o, const flatbuffers::resolver_function_t *_resolver) const {
+  (void)_o;
+  (void)_resolver;
+  { auto _e = messages(); if (_e) { _o->messages.resize(_e->size()); for (flatbuffers::uoffset_t _i = 0; _i < _e->size(); _i++) { _o->messages[_i] = std::unique_ptr<chre::fbs::NanoappMessageT>(_e->Get(_i)->UnPack(_resolver)); } } }
+}
+
+inline flatbuffers::Offset<NanoappMessageBatch> NanoappMessageBatch::Pack(flatbuffers::FlatBufferBuilder &_fbb, const NanoappMessageBatchT* _o, const flatbuffers::rehasher_function_t *_rehasher) {
+  return CreateNanoappMessageBatch(_fbb, _o, _rehasher);
+}
+
+inline flatbuffers::Offset<NanoappMessageBatch> CreateNanoappMessageBatch(flatbuffers::FlatBufferBuilder &_fbb, const NanoappMessageBatchT *_o, const flatbuffers::rehasher_function_t *_rehasher) {
+  (void)_rehasher;
+  (void)_o;
+  struct _VectorArgs { flatbuffers::FlatBufferBuilder *__fbb; const NanoappMessageBatchT* __o; const flatbuffers::rehasher_function_t *__rehasher; } _va = { &_fbb, _o, _rehasher}; (void)_va;
+  auto _messages = _o->messages.size() ? _fbb.CreateVector<flatbuffers::Offset<chre::fbs::NanoappMessage>> (_o->messages.size(), [](size_t i, _VectorArgs *__va) { return CreateNanoappMessage(*__va->__fbb, __va->__o->messages[i].get(), __va->__rehasher); }, &_va ) : 0;
+  return chre::fbs::CreateNanoappMessageBatch(
+      _fbb,
+      _messages);
+}
+
 inline HubInfoRequestT *HubInfoRequest::UnPack(const flatbuffers::resolver_function_t *_resolver) const {
   std::unique_ptr<chre::fbs::HubInfoRequestT> _o = std::unique_ptr<chre::fbs::HubInfoRequestT>(new HubInfoRequestT());
   UnPackTo(_o.get(), _resolver);
@@ -4509,6 +4927,8 @@ inline void LoadNanoappRequest::UnPackTo(LoadNanoappRequestT *_o, const flatbuff
   { auto _e = app_binary_file_name(); if (_e) { _o->app_binary_file_name.resize(_e->size()); for (flatbuffers::uoffset_t _i = 0; _i < _e->size(); _i++) { _o->app_binary_file_name[_i] = _e->Get(_i); } } }
   { auto _e = app_flags(); _o->app_flags = _e; }
   { auto _e = respond_before_start(); _o->respond_before_start = _e; }
+  { auto _e = fragment_window_size(); _o->fragment_window_size = _e; }
+  { auto _e = app_binary_hash(); _o->app_binary_hash = _e; }
 }
 
 inline flatbuffers::Offset<LoadNanoappRequest> LoadNanoappRequest::Pack(flatbuffers::FlatBufferBuilder &_fbb, const LoadNanoappRequestT* _o, const flatbuffers::rehasher_function_t *_rehasher) {
@@ -4529,6 +4949,8 @@ inline flatbuffers::Offset<LoadNanoappRequest> CreateLoadNanoappRequest(flatbuff
   auto _app_binary_file_name = _o->app_binary_file_name.size() ? _fbb.CreateVector(_o->app_binary_file_name) : 0;
   auto _app_flags = _o->app_flags;
   auto _respond_before_start = _o->respond_before_start;
+  auto _fragment_window_size = _o->fragment_window_size;
+  auto _app_binary_hash = _o->app_binary_hash;
   return chre::fbs::CreateLoadNanoappRequest(
       _fbb,
       _transaction_id,
@@ -4540,7 +4962,9 @@ inline flatbuffers::Offset<LoadNanoappRequest> CreateLoadNanoappRequest(flatbuff
       _total_app_size,
       _app_binary_file_name,
       _app_flags,
-      _respond_before_start);
+      _respond_before_start,
+      _fragment_window_size,
+      _app_binary_hash);
 }
 
 inline LoadNanoappResponseT *LoadNanoappResponse::UnPack(const flatbuffers::resolver_function_t *_resolver) const {
@@ -4555,6 +4979,8 @@ inline void LoadNanoappResponse::UnPackTo(LoadNanoappResponseT *_o, const flatbu
   { auto _e = transaction_id(); _o->transaction_id = _e; }
   { auto _e = success(); _o->success = _e; }
   { auto _e = fragment_id(); _o->fragment_id = _e; }
+  { auto _e = fragment_window_size(); _o->fragment_window_size = _e; }
+  { auto _e = binary_resident(); _o->binary_resident = _e; }
 }
 
 inline flatbuffers::Offset<LoadNanoappResponse> LoadNanoappResponse::Pack(flatbuffers::FlatBufferBuilder &_fbb, const LoadNanoappResponseT* _o, const flatbuffers::rehasher_function_t *_rehasher) {
@@ -4568,11 +4994,15 @@ inline flatbuffers::Offset<LoadNanoappResponse> CreateLoadNanoappResponse(flatbu
   auto _transaction_id = _o->transaction_id;
   auto _success = _o->success;
   auto _fragment_id = _o->fragment_id;
+  auto _fragment_window_size = _o->fragment_window_size;
+  auto _binary_resident = _o->binary_resident;
   return chre::fbs::CreateLoadNanoappResponse(
       _fbb,
       _transaction_id,
       _success,
-      _fragment_id);
+      _fragment_id,
+      _fragment_window_size,
+      _binary_resident);
 }
 
 inline NanoappTokenDatabaseInfoT *NanoappTokenDatabaseInfo::UnPack(const flatbuffers::resolver_function_t *_resolver) const {
@@ -5217,6 +5647,64 @@ inline flatbuffers::Offset<PulseResponse> CreatePulseResponse(flatbuffers::FlatB
       _fbb);
 }
 
+inline TraceDataRequestT *TraceDataRequest::UnPack(const flatbuffers::resolver_function_t *_resolver) const {
+  std::unique_ptr<chre::fbs::TraceDataRequestT> _o = std::unique_ptr<chre::fbs::TraceDataRequestT>(new TraceDataRequestT());
+  UnPackTo(_o.get(), _resolver);
+  return _o.release();
+}
+
+inline void TraceDataRequest::UnPackTo(TraceDataRequestT *_o, const flatbuffers::resolver_function_t *_resolver) const {
+  (void)_o;
+  (void)_resolver;
+}
+
+inline flatbuffers::Offset<TraceDataRequest> TraceDataRequest::Pack(flatbuffers::FlatBufferBuilder &_fbb, const TraceDataRequestT* _o, const flatbuffers::rehasher_function_t *_rehasher) {
+  return CreateTraceDataRequest(_fbb, _o, _rehasher);
+}
+
+inline flatbuffers::Offset<TraceDataRequest> CreateTraceDataRequest(flatbuffers::FlatBufferBuilder &_fbb, const TraceDataRequestT *_o, const flatbuffers::rehasher_function_t *_rehasher) {
+  (void)_rehasher;
+  (void)_o;
+  struct _VectorArgs { flatbuffers::FlatBufferBuilder *__fbb; const TraceDataRequestT* __o; const flatbuffers::rehasher_function_t *__rehasher; } _va = { &_fbb, _o, _rehasher}; (void)_va;
+  return chre::fbs::CreateTraceDataRequest(
+      _fbb);
+}
+
+inline TraceDataT *TraceData::UnPack(const flatbuffers::resolver_function_t *_resolver) const {
+  std::unique_ptr<chre::fbs::TraceDataT> _o = std::unique_ptr<chre::fbs::TraceDataT>(new TraceDataT());
+  UnPackTo(_o.get(), _resolver);
+  return _o.release();
+}
+
+inline void TraceData::UnPackTo(TraceDataT *_o, const flatbuffers::resolver_function_t *_resolver) const {
+  (void)_o;
+  (void)_resolver;
+  { auto _e = records(); if (_e) { _o->records.resize(_e->size()); for (flatbuffers::uoffset_t _i = 0; _i < _e->size(); _i++) { _o->records[_i] = _e->Get(_i); } } }
+  { auto _e = strings(); if (_e) { _o->strings.resize(_e->size()); for (flatbuffers::uoffset_t _i = 0; _i < _e->size(); _i++) { _o->strings[_i] = _e->Get(_i); } } }
+  { auto _e = num_dropped(); _o->num_dropped = _e; }
+  { auto _e = last(); _o->last = _e; }
+}
+
+inline flatbuffers::Offset<TraceData> TraceData::Pack(flatbuffers::FlatBufferBuilder &_fbb, const TraceDataT* _o, const flatbuffers::rehasher_function_t *_rehasher) {
+  return CreateTraceData(_fbb, _o, _rehasher);
+}
+
+inline flatbuffers::Offset<TraceData> CreateTraceData(flatbuffers::FlatBufferBuilder &_fbb, const TraceDataT *_o, const flatbuffers::rehasher_function_t *_rehasher) {
+  (void)_rehasher;
+  (void)_o;
+  struct _VectorArgs { flatbuffers::FlatBufferBuilder *__fbb; const TraceDataT* __o; const flatbuffers::rehasher_function_t *__rehasher; } _va = { &_fbb, _o, _rehasher}; (void)_va;
+  auto _records = _o->records.size() ? _fbb.CreateVector(_o->records) : 0;
+  auto _strings = _o->strings.size() ? _fbb.CreateVector(_o->strings) : 0;
+  auto _num_dropped = _o->num_dropped;
+  auto _last = _o->last;
+  return chre::fbs::CreateTraceData(
+      _fbb,
+      _records,
+      _strings,
+      _num_dropped,
+      _last);
+}
+
 inline MessageContainerT *MessageContainer::UnPack(const flatbuffers::resolver_function_t *_resolver) const {
   std::unique_ptr<chre::fbs::MessageContainerT> _o = std::unique_ptr<chre::fbs::MessageContainerT>(new MessageContainerT());
   UnPackTo(_o.get(), _resolver);
@@ -5382,6 +5870,18 @@ inline bool VerifyChreMessage(flatbuffers::Verifier &verifier, const void *obj,
       auto ptr = reinterpret_cast<const chre::fbs::MessageDeliveryStatus *>(obj);
       return verifier.VerifyTable(ptr);
     }
+    case ChreMessage::NanoappMessageBatch: {
+      auto ptr = reinterpret_cast<const chre::fbs::NanoappMessageBatch *>(obj);
+      return verifier.VerifyTable(ptr);
+    }
+    case ChreMessage::TraceDataRequest: {
+      auto ptr = reinterpret_cast<const chre::fbs::TraceDataRequest *>(obj);
+      return verifier.VerifyTable(ptr);
+    }
+    case ChreMessage::TraceData: {
+      auto ptr = reinterpret_cast<const chre::fbs::TraceData *>(obj);
+      return verifier.VerifyTable(ptr);
+    }
     default: return true;
   }
 }
@@ -5528,6 +6028,18 @@ inline void *ChreMessageUnion::UnPack(const void *obj, ChreMessage type, const f
       auto ptr = reinterpret_cast<const chre::fbs::MessageDeliveryStatus *>(obj);
       return ptr->UnPack(resolver);
     }
+    case ChreMessage::NanoappMessageBatch: {
+      auto ptr = reinterpret_cast<const chre::fbs::NanoappMessageBatch *>(obj);
+      return ptr->UnPack(resolver);
+    }
+    case ChreMessage::TraceDataRequest: {
+      auto ptr = reinterpret_cast<const chre::fbs::TraceDataRequest *>(obj);
+      return ptr->UnPack(resolver);
+    }
+    case ChreMessage::TraceData: {
+      auto ptr = reinterpret_cast<const chre::fbs::TraceData *>(obj);
+      return ptr->UnPack(resolver);
+    }
     default: return nullptr;
   }
 }
@@ -5662,6 +6174,18 @@ inline flatbuffers::Offset<void> ChreMessageUnion::Pack(flatbuffers::FlatBufferB
       auto ptr = reinterpret_cast<const chre::fbs::MessageDeliveryStatusT *>(value);
       return CreateMessageDeliveryStatus(_fbb, ptr, _rehasher).Union();
     }
+    case ChreMessage::NanoappMessageBatch: {
+      auto ptr = reinterpret_cast<const chre::fbs::NanoappMessageBatchT *>(value);
+      return CreateNanoappMessageBatch(_fbb, ptr, _rehasher).Union();
+    }
+    case ChreMessage::TraceDataRequest: {
+      auto ptr = reinterpret_cast<const chre::fbs::TraceDataRequestT *>(value);
+      return CreateTraceDataRequest(_fbb, ptr, _rehasher).Union();
+    }
+    case ChreMessage::TraceData: {
+      auto ptr = reinterpret_cast<const chre::fbs::TraceDataT *>(value);
+      return CreateTraceData(_fbb, ptr, _rehasher).Union();
+    }
     default: return 0;
   }
 }
@@ -5796,6 +6320,18 @@ inline ChreMessageUnion::ChreMessageUnion(const ChreMessageUnion &u) : type(u.ty
       value = new chre::fbs::MessageDeliveryStatusT(*reinterpret_cast<chre::fbs::MessageDeliveryStatusT *>(u.value));
       break;
     }
+    case ChreMessage::NanoappMessageBatch: {
+      FLATBUFFERS_ASSERT(false);  // chre::fbs::NanoappMessageBatchT not copyable.
+      break;
+    }
+    case ChreMessage::TraceDataRequest: {
+      value = new chre::fbs::TraceDataRequestT(*reinterpret_cast<chre::fbs::TraceDataRequestT *>(u.value));
+      break;
+    }
+    case ChreMessage::TraceData: {
+      value = new chre::fbs::TraceDataT(*reinterpret_cast<chre::fbs::TraceDataT *>(u.value));
+      break;
+    }
     default:
       break;
   }
@@ -5963,6 +6499,21 @@ inline void ChreMessageUnion::Reset() {
       delete ptr;
       break;
     }
+    case ChreMessage::NanoappMessageBatch: {
+      auto ptr = reinterpret_cast<chre::fbs::NanoappMessageBatchT *>(value);
+      delete ptr;
+      break;
+    }
+    case ChreMessage::TraceDataRequest: {
+      auto ptr = reinterpret_cast<chre::fbs::TraceDataRequestT *>(value);
+      delete ptr;
+      break;
+    }
+    case ChreMessage::TraceData: {
+      auto ptr = reinterpret_cast<chre::fbs::TraceDataT *>(value);
+      delete ptr;
+      break;
+    }
     default: break;
   }
   value = nullptr;
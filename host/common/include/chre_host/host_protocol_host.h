@@ -25,6 +25,7 @@
 #include "chre_host/generated/host_messages_generated.h"
 #include "flatbuffers/flatbuffers.h"
 
+#include <memory>
 #include <vector>
 
 namespace android {
@@ -54,6 +55,18 @@ class IChreMessageHandlers {
   virtual void handleNanoappMessage(
       const ::chre::fbs::NanoappMessageT & /*message*/){};
 
+  /**
+   * Handles a nanoapp message read in place from the received buffer, which
+   * is only valid for the duration of this call. Override this instead of
+   * handleNanoappMessage() to avoid unpacking the message via the object API.
+   * By default, unpacks the message and passes it to handleNanoappMessage().
+   */
+  virtual void handleNanoappMessageInPlace(
+      const ::chre::fbs::NanoappMessage &message) {
+    std::unique_ptr<::chre::fbs::NanoappMessageT> unpacked(message.UnPack());
+    handleNanoappMessage(*unpacked);
+  }
+
   virtual void handleHubInfoResponse(
       const ::chre::fbs::HubInfoResponseT & /*response*/){};
 
@@ -74,6 +87,8 @@ class IChreMessageHandlers {
 
   virtual void handleSelfTestResponse(
       const ::chre::fbs::SelfTestResponseT & /*response*/){};
+
+  virtual void handleTraceData(const ::chre::fbs::TraceDataT & /*data*/){};
 };
 
 /**
@@ -132,10 +147,13 @@ class HostProtocolHost : public ::chre::HostProtocolCommon {
    *        metadata
    * @param respondBeforeStart See LoadNanoappRequest.respond_before_start in
    *        flatbuffers message.
+   * @param fragmentWindowSize See LoadNanoappRequest.fragment_window_size in
+   *        flatbuffers message.
    */
   static void encodeFragmentedLoadNanoappRequest(
       flatbuffers::FlatBufferBuilder &builder,
-      const FragmentedLoadRequest &request, bool respondBeforeStart = false);
+      const FragmentedLoadRequest &request, bool respondBeforeStart = false,
+      uint32_t fragmentWindowSize = 0);
 
   /**
    * Encodes a message requesting the list of loaded nanoapps from CHRE
@@ -180,6 +198,15 @@ class HostProtocolHost : public ::chre::HostProtocolCommon {
    */
   static void encodeDebugDumpRequest(flatbuffers::FlatBufferBuilder &builder);
 
+  /**
+   * Encodes a message requesting the trace records buffered by CHRE, which
+   * replies with TraceData messages
+   *
+   * @param builder A newly constructed FlatBufferBuilder that will be used to
+   *        construct the message
+   */
+  static void encodeTraceDataRequest(flatbuffers::FlatBufferBuilder &builder);
+
   /**
    * Decodes the host client ID included in the message container
    *
@@ -214,12 +241,18 @@ class HostProtocolHost : public ::chre::HostProtocolCommon {
    *
    * @param builder A newly constructed FlatBufferBuilder that will be used to
    *        construct the message
+   * @param nanoappBinary Points to the (fragment of the) binary to send, which
+   *        is copied directly into the builder
+   * @param nanoappBinarySize The size of nanoappBinary in bytes
+   * @param appBinaryHash The hash identifying the whole binary, or 0
    */
   static void encodeLoadNanoappRequestForBinary(
       flatbuffers::FlatBufferBuilder &builder, uint32_t transactionId,
       uint64_t appId, uint32_t appVersion, uint32_t appFlags,
-      uint32_t targetApiVersion, const std::vector<uint8_t> &nanoappBinary,
-      uint32_t fragmentId, size_t appTotalSizeBytes, bool respondBeforeStart);
+      uint32_t targetApiVersion, const uint8_t *nanoappBinary,
+      size_t nanoappBinarySize, uint32_t fragmentId, size_t appTotalSizeBytes,
+      bool respondBeforeStart, uint32_t fragmentWindowSize = 0,
+      uint64_t appBinaryHash = 0);
 
   /**
    * Encodes a message requesting to load a nanoapp specified by the included
@@ -18,10 +18,19 @@
 #define CHRE_LOG_MESSAGE_PARSER_H_
 
 #include <endian.h>
+#include <array>
+#include <atomic>
 #include <cinttypes>
+#include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "chre/platform/shared/deferred_log_format.h"
 #include "chre/util/time.h"
 #include "chre_host/bt_snoop_log_parser.h"
 #include "chre_host/generated/host_messages_generated.h"
@@ -32,6 +41,24 @@
 
 #include "pw_tokenizer/detokenize.h"
 
+#ifndef CHRE_HOST_LOG_EMIT_QUEUE_SIZE
+// The number of decoded log buffers which can be waiting for the emitter
+// thread. Parsing further log buffers blocks until the queue has room.
+#define CHRE_HOST_LOG_EMIT_QUEUE_SIZE 16
+#endif
+
+#ifndef CHRE_HOST_NANOAPP_LOG_RATE_LIMIT
+// The number of tokenized logs per second emitted for each nanoapp over time.
+// Set to 0 to disable rate limiting.
+#define CHRE_HOST_NANOAPP_LOG_RATE_LIMIT 200
+#endif
+
+#ifndef CHRE_HOST_NANOAPP_LOG_BURST_LIMIT
+// The number of tokenized logs a nanoapp may send in a burst before being
+// limited to CHRE_HOST_NANOAPP_LOG_RATE_LIMIT.
+#define CHRE_HOST_NANOAPP_LOG_BURST_LIMIT 1000
+#endif
+
 using chre::fbs::LogType;
 using pw::tokenizer::DetokenizedString;
 using pw::tokenizer::Detokenizer;
@@ -39,8 +66,20 @@ using pw::tokenizer::Detokenizer;
 namespace android {
 namespace chre {
 
+/**
+ * Decodes log buffers from CHRE and emits their logs to logcat.
+ *
+ * Decoding is done on the thread calling log() or logV2(), typically the one
+ * reading from the transport, into a batch of records. Emitting the records is
+ * left to a dedicated thread so that floods of logs don't hold up other
+ * messages from CHRE.
+ */
 class LogMessageParser : public INanoappLoadListener {
  public:
+  //! Receives each decoded log, in place of logcat. See setLogSink().
+  using LogSink = std::function<void(uint8_t level, uint32_t timestampMillis,
+                                     const char *logMessage)>;
+
   LogMessageParser();
 
   /**
@@ -49,6 +88,8 @@ class LogMessageParser : public INanoappLoadListener {
   LogMessageParser(bool enableVerboseLogging)
       : mVerboseLoggingEnabled(enableVerboseLogging) {}
 
+  ~LogMessageParser();
+
   /**
    * Initializes the log message parser by reading the log token database,
    * and instantiates a detokenizer to handle encoded log messages.
@@ -76,7 +117,31 @@ class LogMessageParser : public INanoappLoadListener {
   void dump(const uint8_t *logBuffer, size_t logBufferSize);
 
   /**
-   * Stores a pigweed detokenizer for decoding logs from a given nanoapp.
+   * Enables or disables emitting logs from a dedicated thread, which is
+   * enabled by default. When disabled, logs are emitted before log() and
+   * logV2() return. Must be called before any log is parsed.
+   */
+  void setAsyncEmitEnabled(bool enabled) {
+    mAsyncEmitEnabled = enabled;
+  }
+
+  /**
+   * Sends decoded logs to the given sink instead of logcat, e.g. for tests and
+   * benchmarks. Must be called before any log is parsed.
+   */
+  void setLogSink(LogSink sink) {
+    mLogSink = std::move(sink);
+  }
+
+  /**
+   * Blocks until all the logs parsed so far have been emitted.
+   */
+  void flush();
+
+  /**
+   * Stores the token database of a given nanoapp, from which a pigweed
+   * detokenizer is built when the nanoapp first sends a tokenized log. Only
+   * the token database section is kept, and the nanoapp binary is released.
    *
    * @param appId The app ID associated with the nanoapp.
    * @param instanceId The instance ID assigned to this nanoapp by the CHRE
@@ -105,15 +170,17 @@ class LogMessageParser : public INanoappLoadListener {
   void resetNanoappDetokenizerState();
 
   // Functions from INanoappLoadListener.
-  void onNanoappLoadStarted(
-      uint64_t appId,
-      std::shared_ptr<const std::vector<uint8_t>> nanoappBinary) override;
+  void onNanoappLoadStarted(uint64_t appId,
+                            std::shared_ptr<const uint8_t> nanoappBinary,
+                            size_t nanoappBinarySize) override;
 
   void onNanoappLoadFailed(uint64_t appId) override;
 
   void onNanoappUnloaded(uint64_t appId) override;
 
  private:
+  friend class LogMessageParserTest;
+
   static constexpr char kHubLogFormatStr[] = "@ %3" PRIu32 ".%03" PRIu32 ": %s";
 
   // Constants used to extract the log type from log metadata.
@@ -162,20 +229,119 @@ class LogMessageParser : public INanoappLoadListener {
     char data[];
   } __attribute__((packed));
 
+  /**
+   * Helper struct for readable decoding of a deferred format string log.
+   */
+  struct DeferredLog {
+    uint8_t size;
+    uint8_t formatIndex;
+    char data[];
+  } __attribute__((packed));
+
+  /**
+   * A batch of logs decoded from a single log buffer. Batches are reused so
+   * that their storage is only allocated when a buffer holds more logs than
+   * any before it.
+   */
+  struct LogRecordBatch {
+    struct Record {
+      uint8_t level;
+      uint32_t timestampMillis;
+      //! The offset of the NULL terminated log message in messages.
+      size_t messageOffset;
+    };
+
+    std::vector<Record> records;
+    std::string messages;
+
+    void clear() {
+      records.clear();
+      messages.clear();
+    }
+
+    void add(uint8_t level, uint32_t timestampMillis, const char *message,
+             size_t messageLength) {
+      records.push_back({level, timestampMillis, messages.size()});
+      messages.append(message, messageLength);
+      messages.push_back('\0');
+    }
+  };
+
+  /**
+   * Tracks the rate of tokenized logs from a nanoapp with a token bucket.
+   */
+  struct NanoappLogRateLimiter {
+    double tokens = CHRE_HOST_NANOAPP_LOG_BURST_LIMIT;
+    //! The CHRE timestamp of the last refill, unset until the first log.
+    std::optional<uint32_t> lastRefillMillis;
+    uint32_t numSuppressed = 0;
+  };
+
+  static constexpr size_t kEmitQueueSize = CHRE_HOST_LOG_EMIT_QUEUE_SIZE;
+
   bool mVerboseLoggingEnabled;
 
+  bool mAsyncEmitEnabled = true;
+
+  LogSink mLogSink;
+
+  //! A single producer, single consumer queue of decoded batches. The thread
+  //! parsing logs fills mEmitQueue[mEmitQueueWriteCount % kEmitQueueSize] in
+  //! place and then publishes it by incrementing mEmitQueueWriteCount. The
+  //! emitter thread consumes batches up to that count.
+  std::array<LogRecordBatch, kEmitQueueSize> mEmitQueue;
+  std::atomic<size_t> mEmitQueueWriteCount{0};
+  std::atomic<size_t> mEmitQueueReadCount{0};
+
+  //! The batch being decoded into, or nullptr if logs are emitted directly.
+  LogRecordBatch *mCurrentBatch = nullptr;
+
+  //! A batch used when logs are emitted synchronously.
+  LogRecordBatch mSyncBatch;
+
+  //! Only used to sleep while waiting on the emit queue: by the emitter thread
+  //! while the queue is empty, and by the parsing thread and flush() while it
+  //! is full or draining.
+  std::mutex mEmitterMutex;
+  std::condition_variable mEmitterCondVar;
+  std::condition_variable mEmittedCondVar;
+  bool mStopEmitter = false;
+  std::thread mEmitterThread;
+
+  //! Rate limiters of nanoapps by instance ID. Guarded by mNanoappMutex.
+  std::unordered_map<uint16_t /*instanceId*/, NanoappLogRateLimiter>
+      mNanoappLogRateLimiters GUARDED_BY(mNanoappMutex);
+
   //! The number of logs dropped since CHRE start.
   uint32_t mNumLogsDropped = 0;
 
   //! Log detokenizer used for CHRE system logs.
   std::unique_ptr<Detokenizer> mSystemDetokenizer;
 
+  //! The format strings of deferred logs defined in the log buffer currently
+  //! being parsed, indexed by format index.
+  std::array<std::optional<std::string>, ::chre::kDeferredLogMaxFormats>
+      mDeferredLogFormats;
+
   /**
    * Helper struct for keep track of nanoapp's log detokenizer with appIDs.
    */
   struct NanoappDetokenizer {
+    //! Null until the first tokenized log from the nanoapp is decoded.
     std::unique_ptr<Detokenizer> detokenizer;
     uint64_t appId;
+
+    //! A copy of the token database section of the nanoapp binary, which is
+    //! released once the detokenizer is built.
+    std::vector<uint8_t> tokenDatabase;
+  };
+
+  /**
+   * A nanoapp binary being loaded, held until its token database is known.
+   */
+  struct NanoappBinary {
+    std::shared_ptr<const uint8_t> data;
+    size_t size;
   };
 
   //! Maps nanoapp instance IDs to the corresponding app ID and pigweed
@@ -185,9 +351,8 @@ class LogMessageParser : public INanoappLoadListener {
 
   //! This is used to find the binary associated with a nanoapp with its app ID.
   //! Guarded by mNanoappMutex.
-  std::unordered_map<uint64_t /*appId*/,
-                     std::shared_ptr<const std::vector<uint8_t>>>
-      mNanoappAppIdToBinary GUARDED_BY(mNanoappMutex);
+  std::unordered_map<uint64_t /*appId*/, NanoappBinary> mNanoappAppIdToBinary
+      GUARDED_BY(mNanoappMutex);
 
   //! The mutex used to guard operations of mNanoappAppIdtoBinary and
   //! mNanoappDetokenizers.
@@ -201,7 +366,12 @@ class LogMessageParser : public INanoappLoadListener {
   //! start of the ELF header.
   size_t mNanoappImageHeaderSize = 0;
 
-  void updateAndPrintDroppedLogs(uint32_t numLogsDropped);
+  /**
+   * Emits the number of logs CHRE dropped since the previous log buffer, into
+   * the current batch so that it's ordered along with the logs.
+   */
+  void updateAndPrintDroppedLogs(uint32_t numLogsDropped,
+                                 uint32_t timestampMillis);
 
   //! Method for parsing unencoded (string) log messages.
   std::optional<size_t> parseAndEmitStringLogMessageAndGetSize(
@@ -234,9 +404,67 @@ class LogMessageParser : public INanoappLoadListener {
   std::optional<size_t> parseAndEmitNanoappTokenizedLogMessageAndGetSize(
       const LogMessageV2 *message, size_t maxLogMessageLen);
 
+  /**
+   * Parses and emits a deferred format string log message while also
+   * returning the size of the parsed message for buffer index bookkeeping.
+   *
+   * @param message Buffer containing the log metadata and log payload.
+   * @param maxLogMessageLen The max size allowed for the log payload.
+   * @return Size of the log message payload, std::nullopt if the message
+   * format is invalid. Note that the size includes the 1 byte header that
+   * tracks the message size.
+   */
+  std::optional<size_t> parseAndEmitDeferredLogMessageAndGetSize(
+      const LogMessageV2 *message, size_t maxLogMessageLen);
+
+  /**
+   * Formats a deferred log from its format string and the arguments captured
+   * by CHRE.
+   *
+   * @return The formatted log, or std::nullopt if the arguments don't match
+   * the format string.
+   */
+  static std::optional<std::string> formatDeferredLog(const std::string &format,
+                                                      const uint8_t *args,
+                                                      size_t argsSize);
+
+  /**
+   * Adds a decoded log to the batch being decoded, or emits it right away if
+   * asynchronous emission is disabled.
+   */
   void emitLogMessage(uint8_t level, uint32_t timestampMillis,
                       const char *logMessage);
 
+  void emitLogMessage(uint8_t level, uint32_t timestampMillis,
+                      const char *logMessage, size_t logMessageLength);
+
+  //! Writes a single log to logcat or the log sink.
+  void writeLogMessage(uint8_t level, uint32_t timestampMillis,
+                       const char *logMessage);
+
+  /**
+   * Starts decoding a log buffer into a batch, which is a free slot of the
+   * emit queue unless asynchronous emission is disabled. Waits for a slot if
+   * the emitter thread has fallen behind by a full queue.
+   */
+  void beginBatch();
+
+  //! Hands the batch started by beginBatch() over to the emitter thread.
+  void publishBatch();
+
+  //! Writes out all the logs of a batch.
+  void writeBatch(const LogRecordBatch &batch);
+
+  void emitterThreadEntry();
+
+  /**
+   * @return true if a tokenized log from the nanoapp with the given instance
+   * ID should be dropped as the nanoapp exceeded its log rate. A summary of the
+   * number of dropped logs is emitted once the nanoapp is allowed to log again.
+   */
+  bool isNanoappLogRateLimited(uint16_t instanceId, uint32_t timestampMillis)
+      REQUIRES(mNanoappMutex);
+
   /**
    * Initialize the Log Detokenizer
    *
@@ -316,16 +544,26 @@ class LogMessageParser : public INanoappLoadListener {
   /**
    * Helper function that returns the nanoapp binary from its appId.
    */
-  std::shared_ptr<const std::vector<uint8_t>> fetchNanoappBinary(uint64_t appId)
+  std::optional<NanoappBinary> fetchNanoappBinary(uint64_t appId)
       EXCLUDES(mNanoappMutex);
 
   /**
-   * Helper function that registers a nanoapp detokenizer with its appID and
-   * instanceID.
+   * Helper function that registers the token database of a nanoapp with its
+   * appID and instanceID.
    */
-  void registerDetokenizer(uint64_t appId, uint16_t instanceId,
-                           pw::Result<Detokenizer> nanoappDetokenizer)
+  void registerTokenDatabase(uint64_t appId, uint16_t instanceId,
+                             std::vector<uint8_t> tokenDatabase)
       EXCLUDES(mNanoappMutex);
+
+  /**
+   * Helper function that returns the detokenizer of a nanoapp, building it
+   * from the nanoapp's token database if it hasn't been used yet.
+   *
+   * @return The detokenizer, or nullptr if there is no valid token database
+   * for the nanoapp.
+   */
+  Detokenizer *getNanoappDetokenizer(uint16_t instanceId)
+      REQUIRES(mNanoappMutex);
 };
 
 }  // namespace chre
@@ -19,14 +19,75 @@
 
 #include <aidl/android/frameworks/stats/IStats.h>
 #include <chre_atoms_log.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <thread>
+
+#ifndef CHRE_HOST_METRICS_AGGREGATION_WINDOW_MS
+//! The window over which occurrences of the same atom are aggregated before
+//! being reported.
+#define CHRE_HOST_METRICS_AGGREGATION_WINDOW_MS 60000
+#endif
+
+#ifndef CHRE_HOST_METRICS_MAX_AGGREGATED_ATOMS
+//! Max number of distinct atoms aggregated in a window.
+#define CHRE_HOST_METRICS_MAX_AGGREGATED_ATOMS 64
+#endif
+
+#ifndef CHRE_HOST_METRICS_MAX_REPORTS_PER_ATOM
+//! Max number of times the same atom is reported per window. Atoms are
+//! reported more than once in a window only when the aggregated atoms are
+//! reported early to make room for new ones.
+#define CHRE_HOST_METRICS_MAX_REPORTS_PER_ATOM 4
+#endif
 
 namespace android::chre {
 
+/**
+ * Reports CHRE metrics to the stats service.
+ *
+ * Metrics reporting occurrences, e.g. AP wakeups, are aggregated by atom, i.e.
+ * by atom ID and values, and reported by a dedicated thread at the end of each
+ * aggregation window, so that they don't cost a binder call on the thread
+ * logging them. Each aggregated atom is reported once, with the number of
+ * occurrences appended to its values as the count field of the atom. A window
+ * starts with the first occurrence logged after the previous one ended.
+ * Snapshot metrics are reported immediately.
+ */
 class MetricsReporter {
  public:
-  MetricsReporter() = default;
-  ~MetricsReporter() = default;
+  struct AggregationConfig {
+    //! Aggregated atoms are reported at the end of each window. Atoms are
+    //! reported immediately, with a count of 1, if zero.
+    std::chrono::milliseconds window{CHRE_HOST_METRICS_AGGREGATION_WINDOW_MS};
+    //! When this many atoms are aggregated, they are reported early to make
+    //! room for further atoms, whose occurrences are dropped meanwhile.
+    size_t maxAtoms = CHRE_HOST_METRICS_MAX_AGGREGATED_ATOMS;
+    //! The number of times an atom may be reported per window, which bounds
+    //! the number of early reports. Occurrences of new atoms are dropped
+    //! until the end of the window once it's reached.
+    uint32_t maxReportsPerAtom = CHRE_HOST_METRICS_MAX_REPORTS_PER_ATOM;
+  };
+
+  MetricsReporter();
+
+  /**
+   * @param config How occurrence metrics are aggregated.
+   * @param statsService The stats service to report to, e.g. a fake one in
+   *        tests. Connects to the system's stats service if null.
+   */
+  explicit MetricsReporter(
+      AggregationConfig config,
+      std::shared_ptr<aidl::android::frameworks::stats::IStats> statsService =
+          nullptr);
+
+  /** Reports the aggregated atoms and stops the aggregation thread. */
+  ~MetricsReporter();
 
   MetricsReporter(const MetricsReporter &) = delete;
   MetricsReporter &operator=(const MetricsReporter &) = delete;
@@ -40,14 +101,28 @@ class MetricsReporter {
   bool reportMetric(const aidl::android::frameworks::stats::VendorAtom &atom);
 
   /**
-   * Reports an AP Wakeup caused by a nanoapp.
+   * Records an occurrence of the atom, to be reported at the end of the
+   * aggregation window.
+   *
+   * @param atom the vendor atom to be reported, without its count field
+   * @return true if the occurrence was recorded, false if it was dropped
+   *         because too many distinct atoms are aggregated.
+   */
+  bool aggregateMetric(
+      const aidl::android::frameworks::stats::VendorAtom &atom);
+
+  /** Reports the atoms aggregated so far, each with its count. */
+  void flush();
+
+  /**
+   * Reports an AP Wakeup caused by a nanoapp. The metric is aggregated.
    *
    * @return whether the operation was successful.
    */
   bool logApWakeupOccurred(uint64_t nanoappId);
 
   /**
-   * Reports a nanoapp load failed metric.
+   * Reports a nanoapp load failed metric. The metric is aggregated.
    *
    * @return whether the operation was successful.
    */
@@ -57,7 +132,7 @@ class MetricsReporter {
       android::chre::Atoms::ChreHalNanoappLoadFailed::Reason reason);
 
   /**
-   * Reports a PAL open failed metric.
+   * Reports a PAL open failed metric. The metric is aggregated.
    *
    * @return whether the operation was successful.
    */
@@ -75,6 +150,25 @@ class MetricsReporter {
                                      int32_t mean_event_queue_size,
                                      int32_t num_dropped_events);
 
+  /**
+   * Reports the time spent in each phase of starting a nanoapp, in
+   * microseconds.
+   *
+   * @return whether the operation was successful.
+   */
+  bool logNanoappStartReported(uint64_t nanoappId, int64_t loadTimeUs,
+                               int64_t relocationTimeUs,
+                               int64_t initArrayTimeUs, int64_t startTimeUs,
+                               int64_t totalTimeUs);
+
+  /**
+   * Reports a nanoapp which took longer than its budget to handle an event.
+   *
+   * @return whether the operation was successful.
+   */
+  bool logNanoappEventBudgetExceeded(uint64_t nanoappId, int32_t eventType,
+                                     int64_t elapsedTimeMs, int64_t budgetMs);
+
   /**
    * Called when the binder dies for the stats service.
    */
@@ -90,11 +184,35 @@ class MetricsReporter {
    */
   std::shared_ptr<aidl::android::frameworks::stats::IStats> getStatsService();
 
+  void aggregationThreadMain();
+
+  const AggregationConfig mAggregationConfig;
+
+  //! Whether mStatsService was given rather than connected to.
+  const bool mHasStatsServiceOverride;
+
   std::mutex mStatsServiceMutex;
   std::shared_ptr<aidl::android::frameworks::stats::IStats> mStatsService =
       nullptr;
+
+  //! Protects the aggregation state. Members below are guarded by it.
+  std::mutex mAggregationMutex;
+  std::condition_variable mAggregationCondVar;
+  //! Number of occurrences of each atom in the current window.
+  std::map<aidl::android::frameworks::stats::VendorAtom, uint32_t>
+      mAggregatedAtoms;
+  //! Number of occurrences dropped in the current window.
+  uint32_t mNumDroppedOccurrences = 0;
+  //! The end of the current aggregation window.
+  std::chrono::steady_clock::time_point mWindowEnd;
+  //! Number of times the aggregated atoms were reported early in the current
+  //! window.
+  uint32_t mNumEarlyFlushes = 0;
+  bool mFlushRequested = false;
+  bool mStopAggregationThread = false;
+  std::thread mAggregationThread;
 };
 
 }  // namespace android::chre
 
-#endif  // CHRE_HOST_METRICS_REPORTER_H_
\ No newline at end of file
+#endif  // CHRE_HOST_METRICS_REPORTER_H_
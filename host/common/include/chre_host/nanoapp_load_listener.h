@@ -17,6 +17,10 @@
 #ifndef CHRE_NANOAPP_LOAD_LISTENER_H_
 #define CHRE_NANOAPP_LOAD_LISTENER_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
 namespace android {
 namespace chre {
 
@@ -28,10 +32,13 @@ class INanoappLoadListener {
    * Called before we send any nanoapp data to CHRE.
    *
    * @param appId The app ID associated with the nanoapp binary.
+   * @param nanoappBinary The nanoapp binary, which may be a file mapped into
+   *        memory. Listeners should hold on to it no longer than they need to.
+   * @param nanoappBinarySize The size of the nanoapp binary in bytes.
    */
   virtual void onNanoappLoadStarted(
-      uint64_t appId,
-      std::shared_ptr<const std::vector<uint8_t>> nanoappBinary) = 0;
+      uint64_t appId, std::shared_ptr<const uint8_t> nanoappBinary,
+      size_t nanoappBinarySize) = 0;
 
   /**
    * Called after a nanoapp load failed.
@@ -19,11 +19,15 @@
 
 #include <android/binder_to_string.h>
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "chre_connection.h"
 
@@ -48,6 +52,14 @@ using ::aidl::android::hardware::contexthub::EventLogger;
  * image and are loaded when CHRE starts. These are known as preloaded nanoapps.
  * A HAL implementation should use this class to load preloaded nanoapps before
  * exposing API to HAL clients.
+ *
+ * If CHRE supports it, the fragments of each nanoapp are sent in a sliding
+ * window, see LoadNanoappRequest in host_messages.fbs, and up to
+ * ChreConnection::getMaxConcurrentNanoappLoads() nanoapps are loaded at once.
+ *
+ * Each request carries a hash of the binary, so that after a restart CHRE can
+ * load a nanoapp from a copy of the binary it retained without receiving the
+ * remaining fragments.
  */
 class PreloadedNanoappLoader {
  public:
@@ -87,6 +99,15 @@ class PreloadedNanoappLoader {
   bool onLoadNanoappResponse(const ::chre::fbs::LoadNanoappResponseT &response,
                              HalClientId clientId);
 
+  /**
+   * Callback function to handle a nanoapp list response from CHRE.
+   *
+   * @return true if the response was for a query sent by the loader, in which
+   *         case it must not be handled otherwise.
+   */
+  bool onNanoappListResponse(
+      const ::chre::fbs::NanoappListResponseT &response, HalClientId clientId);
+
   void getPreloadedNanoappIds(std::vector<uint64_t> &out_preloadedNanoappIds);
 
   /** Returns true if the loading is ongoing. */
@@ -95,50 +116,129 @@ class PreloadedNanoappLoader {
   }
 
  private:
-  /** Tracks the transaction state of the ongoing nanoapp loading */
+  /** Tracks the state of an ongoing nanoapp load transaction. */
   struct Transaction {
-    uint32_t transactionId;
-    size_t fragmentId;
+    //! The ID of the last fragment acknowledged by CHRE, or kNoFragmentId.
+    size_t lastAckedFragmentId = kNoFragmentId;
+    //! The number of fragments CHRE accepts in flight, or 0 if each fragment
+    //! must be acknowledged before the next one is sent.
+    uint32_t windowSize = 0;
+    //! True if CHRE failed the transaction.
+    bool failed = false;
+    //! True if CHRE loaded the nanoapp from a binary it retained, so the
+    //! remaining fragments aren't needed.
+    bool binaryResident = false;
+  };
+
+  /** The hash of a nanoapp binary, valid while its file is unmodified. */
+  struct BinaryHash {
+    size_t size;
+    int64_t modifiedTimeNs;
+    uint64_t hash;
   };
 
+  /**
+   * Gets the hash identifying a nanoapp binary for CHRE, only hashing the
+   * binary if it's not known or its file was modified since it was hashed.
+   *
+   * @param nanoappFileName The nanoapp binary file name.
+   * @param appBinary The contents of the file.
+   * @param appSize The size of appBinary in bytes.
+   * @return the hash, never 0, or 0 if the file can't be checked.
+   */
+  uint64_t getBinaryHash(const std::string &nanoappFileName,
+                         const uint8_t *appBinary, size_t appSize);
+
   /**
    * Loads a preloaded nanoapp.
    *
    * @param appHeader The nanoapp header binary blob.
    * @param nanoappFileName The nanoapp binary file name.
    * @param transactionId The transaction ID identifying this load transaction.
+   * @param willRetry If true, a failure isn't logged as the load will be
+   *        retried.
    * @return true if successful, false otherwise.
    */
   bool loadNanoapp(const NanoAppBinaryHeader *appHeader,
-                   const std::string &nanoappFileName, uint32_t transactionId);
+                   const std::string &nanoappFileName, uint32_t transactionId,
+                   bool willRetry = false);
 
   /**
-   * Chunks the nanoapp binary into fragments and load each fragment
-   * sequentially.
+   * Chunks the nanoapp binary into fragments and loads them, keeping as many
+   * fragments in flight as CHRE accepts. The fragments refer to appBinary
+   * rather than copies of it.
+   *
+   * @param failureReason Populated with the reason of a failure.
    */
   bool sendFragmentedLoadAndWaitForEachResponse(
       uint64_t appId, uint32_t appVersion, uint32_t appFlags,
-      uint32_t appTargetApiVersion, const uint8_t *appBinary, size_t appSize,
-      uint32_t transactionId);
+      uint32_t appTargetApiVersion, std::shared_ptr<const uint8_t> appBinary,
+      size_t appSize, uint64_t appBinaryHash, uint32_t transactionId,
+      ::android::chre::Atoms::ChreHalNanoappLoadFailed::Reason *failureReason);
+
+  /**
+   * Sends the fragments of a transaction registered in mPendingTransactions
+   * and waits until all of them are acknowledged, resending the fragments
+   * following the last acknowledged one if CHRE stops responding.
+   */
+  bool sendFragmentsAndWaitForAcks(
+      FragmentedLoadTransaction &transaction,
+      ::android::chre::Atoms::ChreHalNanoappLoadFailed::Reason *failureReason);
+
+  /**
+   * Queries CHRE for the loaded nanoapps, to resolve whether a load whose
+   * outcome is ambiguous succeeded. Must be called with
+   * mPreloadedNanoappsMutex held through lock, which is released while
+   * waiting for the response.
+   *
+   * @return true if the nanoapp is loaded, false if it isn't or the query
+   *         failed.
+   */
+  bool isNanoappLoaded(uint64_t appId, std::unique_lock<std::mutex> &lock);
 
   /** Sends the FragmentedLoadRequest to CHRE. */
-  std::future<bool> sendFragmentedLoadRequest(
-      ::android::chre::FragmentedLoadRequest &request);
+  bool sendFragmentedLoadRequest(
+      const ::android::chre::FragmentedLoadRequest &request);
 
-  /** Verifies the future returned by sendFragmentedLoadRequest(). */
-  [[nodiscard]] bool waitAndVerifyFuture(std::future<bool> &future,
-                                         const FragmentedLoadRequest &request);
+  /**
+   * Verifies the response of a loading request.
+   *
+   * @return true if the response acknowledges fragments of the transaction.
+   */
+  [[nodiscard]] static bool verifyFragmentLoadResponse(
+      const ::chre::fbs::LoadNanoappResponseT &response,
+      const Transaction &transaction);
 
-  /** Verifies the response of a loading request. */
-  [[nodiscard]] bool verifyFragmentLoadResponse(
-      const ::chre::fbs::LoadNanoappResponseT &response) const;
+  /** The ongoing load transactions, keyed by their transaction IDs. */
+  std::unordered_map<uint32_t, Transaction> mPendingTransactions;
 
-  Transaction mPreloadedNanoappPendingTransaction{0, 0};
+  /**
+   * The hashes of the nanoapp binaries loaded so far, keyed by their file
+   * names, so that binaries are only hashed again when they change.
+   */
+  std::unordered_map<std::string, BinaryHash> mBinaryHashes;
 
-  /** The value of this promise carries the result in the load response. */
-  std::optional<std::promise<bool>> mFragmentedLoadPromise = std::nullopt;
+  /**
+   * The number of nanoapp list queries sent by the loader and responses
+   * received for them. CHRE responds in order, so the response to a query is
+   * the one bringing the count of responses to the number of the query.
+   */
+  size_t mNumNanoappListQueries = 0;
+  size_t mNumNanoappListResponses = 0;
+
+  /** The nanoapps listed in the latest nanoapp list response. */
+  std::vector<uint64_t> mLoadedNanoappIds;
+
+  /**
+   * Notified when a transaction in mPendingTransactions changes or a nanoapp
+   * list response is received.
+   */
+  std::condition_variable mTransactionCondition;
 
-  /** The mutex used to guard states change for preloading. */
+  /**
+   * The mutex used to guard states change for preloading, including
+   * mBinaryHashes.
+   */
   std::mutex mPreloadedNanoappsMutex;
 
   std::atomic_bool mIsPreloadingOngoing = false;
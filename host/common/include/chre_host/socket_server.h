@@ -17,12 +17,12 @@
 #ifndef CHRE_HOST_SOCKET_SERVER_H_
 #define CHRE_HOST_SOCKET_SERVER_H_
 
-#include <poll.h>
-
 #include <atomic>
+#include <deque>
 #include <functional>
-#include <map>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include <android-base/macros.h>
@@ -30,8 +30,40 @@
 
 namespace android::chre {
 
+/**
+ * Serves CHRE messages to clients connected to the daemon's socket.
+ *
+ * All sockets are serviced by a single epoll loop in run(). Messages to clients
+ * are sent without blocking from the calling thread. When a client's socket
+ * buffer is full, messages are held in a bounded per-client queue and sent from
+ * the epoll loop once the socket becomes writable, so a slow client only ever
+ * delays its own messages. When a client's queue is full, further messages to
+ * it are dropped and counted in its metrics.
+ */
 class SocketServer {
  public:
+  //! Per-client delivery statistics, see getClientMetrics().
+  struct ClientMetrics {
+    uint16_t clientId;
+
+    //! The number of messages written to the client's socket.
+    uint64_t messagesSent;
+
+    //! The number of messages that couldn't be sent immediately and were
+    //! queued.
+    uint64_t messagesQueued;
+
+    //! The number of messages dropped because the client's queue was full.
+    uint64_t messagesDropped;
+
+    //! The number of messages and bytes currently queued for the client.
+    size_t backlogMessages;
+    size_t backlogBytes;
+
+    //! The largest number of messages queued for the client at once.
+    size_t maxBacklogMessages;
+  };
+
   SocketServer();
 
   /**
@@ -61,7 +93,9 @@ class SocketServer {
            ClientMessageCallback clientMessageCallback);
 
   /**
-   * Delivers data to all connected clients. This method is thread-safe.
+   * Delivers data to all connected clients. This method is thread-safe and
+   * doesn't block on slow clients. At most one copy of the data is made, which
+   * is shared by all clients it needs to be queued for.
    *
    * @param data Pointer to buffer containing message data
    * @param length Number of bytes of data to send
@@ -70,16 +104,22 @@ class SocketServer {
 
   /**
    * Sends a message to one client, specified via its unique client ID. This
-   * method is thread-safe.
+   * method is thread-safe and doesn't block on a slow client.
    *
    * @param data
    * @param length
    * @param clientId
    *
-   * @return true if the message was successfully sent to the specified client
+   * @return true if the message was sent or queued for the specified client
    */
   bool sendToClientById(const void *data, size_t length, uint16_t clientId);
 
+  /**
+   * @return The delivery statistics of each connected client. This method is
+   *         thread-safe.
+   */
+  std::vector<ClientMetrics> getClientMetrics();
+
   static void shutdownServer() {
     sSignalReceived = true;
   }
@@ -98,40 +138,91 @@ class SocketServer {
   // which will be removed after migrating generic HAL to multiclient HAL.
   static constexpr uint16_t kMaxHalClientId = 0x1ff;
 
+  //! The maximum number of messages and bytes that can be queued for a single
+  //! client before further messages to it are dropped.
+  static constexpr size_t kMaxQueuedMessagesPerClient = 256;
+  static constexpr size_t kMaxQueuedBytesPerClient = 2 * kMaxPacketSize;
+
+  //! The epoll user data identifying the listen socket. Client sockets are
+  //! identified by their client ID, which is never 0.
+  static constexpr uint64_t kListenSocketEpollData = 0;
+
+  using SharedBuffer = std::shared_ptr<const std::vector<uint8_t>>;
+
+  struct ClientData {
+    int socket;
+    uint16_t clientId;
+
+    //! Messages waiting for the socket to become writable, oldest first.
+    std::deque<SharedBuffer> outQueue;
+
+    //! Whether EPOLLOUT is currently requested for the socket.
+    bool waitingForWritable = false;
+
+    //! Whether messages have been dropped since the queue was last empty,
+    //! used to only log the first drop.
+    bool dropping = false;
+
+    ClientMetrics metrics = {};
+  };
+
   int mSockFd = INVALID_SOCKET;
+  int mEpollFd = -1;
   // Socket client id and Hal client id are using the same field in the fbs
   // message. To keep their id range disjoint enables message routing for both
   // at the same time. There are 0xffff - 0x01ff = 0xfe00 (65024) socket
   // client ids to use, which should be more than enough.
   uint16_t mNextClientId = kMaxHalClientId + 1;
-  // TODO: std::vector-ify this
-  struct pollfd mPollFds[1 + kMaxActiveClients] = {};
-
-  struct ClientData {
-    uint16_t clientId;
-  };
 
-  // Maps from socket FD to ClientData
-  std::map<int, ClientData> mClients;
+  // Maps from client ID to ClientData
+  std::unordered_map<uint16_t, ClientData> mClients;
 
   // A buffer to read packets into. Allocated here to prevent a large object on
   // the stack.
   std::vector<uint8_t> mRecvBuffer = std::vector<uint8_t>(kMaxPacketSize);
 
-  // Ensures that mClients can be safely iterated over from other threads
-  // without worrying about potential modification from the RX thread
+  // Guards mClients, including the outbound queue of each client, against
+  // concurrent access from senders and the RX thread. It's only ever held for
+  // non-blocking socket operations.
   std::mutex mClientsMutex;
 
   ClientMessageCallback mClientMessageCallback;
 
   void acceptClientConnection();
 
-  void disconnectClient(int clientSocket);
+  void disconnectClient(uint16_t clientId);
+
+  void handleClientData(uint16_t clientId);
+
+  /**
+   * Sends a message to a client, or queues it if the client's socket isn't
+   * writable. mClientsMutex must be held.
+   *
+   * @param buffer Points to the shared copy of data if one has already been
+   *        made. If the message needs to be queued and this is empty, it's set
+   *        to a new copy of data which can be reused for other clients.
+   *
+   * @return false if the message was dropped
+   */
+  bool sendOrQueueLocked(ClientData &client, const void *data, size_t length,
+                         SharedBuffer &buffer);
+
+  /**
+   * Sends as many queued messages to the client as its socket accepts, and
+   * updates whether EPOLLOUT is requested for it. mClientsMutex must be held.
+   */
+  void flushQueueLocked(ClientData &client);
 
-  void handleClientData(int clientSocket);
+  /**
+   * Performs a single non-blocking send.
+   *
+   * @return true if the packet was sent. Otherwise, errno is set and is
+   *         EAGAIN/EWOULDBLOCK if the socket's buffer is full.
+   */
+  bool sendNonBlocking(const ClientData &client, const void *data,
+                       size_t length);
 
-  bool sendToClientSocket(const void *data, size_t length, int clientSocket,
-                          uint16_t clientId);
+  void setWaitingForWritableLocked(ClientData &client, bool waiting);
 
   void serviceSocket();
 
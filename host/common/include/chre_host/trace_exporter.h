@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_HOST_TRACE_EXPORTER_H_
+#define CHRE_HOST_TRACE_EXPORTER_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "chre_host/generated/host_messages_generated.h"
+
+namespace android {
+namespace chre {
+
+/**
+ * Collects the trace records of the TraceData messages CHRE sends in response
+ * to a TraceDataRequest, and exports them in the Chrome JSON trace event
+ * format, which can be opened in Perfetto (ui.perfetto.dev) or
+ * chrome://tracing.
+ *
+ * Each CHRE thread which recorded traces is shown as a thread of the trace,
+ * traces with a group are categorized by it and trace IDs are kept in the
+ * arguments of the events.
+ */
+class TraceExporter {
+ public:
+  //! The size of a record in TraceData::records, see host_messages.fbs.
+  static constexpr size_t kRecordSize = 18;
+
+  /**
+   * Adds the records of a TraceData message.
+   *
+   * @return false if the message is malformed, in which case none of its
+   *         records are added
+   */
+  bool addTraceData(const ::chre::fbs::TraceDataT &data);
+
+  /**
+   * @return true once the last TraceData message of the request was added
+   */
+  bool isComplete() const {
+    return mComplete;
+  }
+
+  size_t getNumRecords() const {
+    return mRecords.size();
+  }
+
+  /**
+   * @return the number of records CHRE dropped because its buffers were full
+   */
+  uint32_t getNumDropped() const {
+    return mNumDropped;
+  }
+
+  /**
+   * Writes the records added so far as a Chrome JSON trace, ordered by
+   * timestamp.
+   */
+  void writeChromeJson(std::ostream &out) const;
+
+ private:
+  struct Record {
+    uint64_t timestampNs;
+    uint32_t traceId;
+    std::string label;
+    std::optional<std::string> group;
+    uint8_t type;
+    uint8_t thread;
+  };
+
+  std::vector<Record> mRecords;
+  uint32_t mNumDropped = 0;
+  bool mComplete = false;
+
+  /**
+   * Writes a string as a quoted JSON string.
+   */
+  static void writeJsonString(std::ostream &out, const std::string &str);
+};
+
+}  // namespace chre
+}  // namespace android
+
+#endif  // CHRE_HOST_TRACE_EXPORTER_H_
@@ -18,6 +18,7 @@
 
 #include <endian.h>
 #include <string.h>
+#include <algorithm>
 #include <optional>
 
 #include "chre/util/macros.h"
@@ -31,6 +32,11 @@
 #include "pw_span/span.h"
 #include "pw_tokenizer/detokenize.h"
 
+using chre::DeferredLogArgType;
+using chre::DeferredLogConversion;
+using chre::getNextDeferredLogConversion;
+using chre::kDeferredLogFormatDefinitionFlag;
+using chre::kDeferredLogMaxFormats;
 using chre::kOneMillisecondInNanoseconds;
 using chre::kOneSecondInMilliseconds;
 using chre::fbs::LogType;
@@ -57,14 +63,41 @@ constexpr size_t kSystemTokenizedLogOffset = 1;
 //! payload. The value accounts for the size of the uint8_t logSize field and
 //! the uint16_t instanceId field.
 constexpr size_t kNanoappTokenizedLogOffset = 3;
+//! The number of bytes in a deferred format string log entry in addition to the
+//! log payload. The value indicates the size of the uint8_t logSize field.
+constexpr size_t kDeferredLogOffset = 1;
 //! This value is used to indicate that a nanoapp does not have a token database
 //! section.
 constexpr uint32_t kInvalidTokenDatabaseSize = 0;
+
+//! Formats a single argument of a deferred log and appends it to the output.
+template <typename T>
+void appendFormattedArg(std::string &output, const std::string &conversion,
+                        T value) {
+  int size = snprintf(nullptr, 0, conversion.c_str(), value);
+  if (size > 0) {
+    size_t offset = output.size();
+    output.resize(offset + size + 1);
+    snprintf(&output[offset], size + 1, conversion.c_str(), value);
+    output.resize(offset + size);
+  }
+}
 }  // anonymous namespace
 
 LogMessageParser::LogMessageParser()
     : mVerboseLoggingEnabled(kVerboseLoggingEnabled) {}
 
+LogMessageParser::~LogMessageParser() {
+  if (mEmitterThread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mEmitterMutex);
+      mStopEmitter = true;
+    }
+    mEmitterCondVar.notify_one();
+    mEmitterThread.join();
+  }
+}
+
 std::unique_ptr<Detokenizer> LogMessageParser::logDetokenizerInit() {
 #ifdef CHRE_TOKENIZED_LOGGING_ENABLED
   constexpr const char kLogDatabaseFilePath[] =
@@ -156,6 +189,7 @@ uint8_t LogMessageParser::getLogLevelFromMetadata(uint8_t metadata) {
 }
 
 void LogMessageParser::log(const uint8_t *logBuffer, size_t logBufferSize) {
+  beginBatch();
   size_t bufferIndex = 0;
   while (bufferIndex < logBufferSize) {
     const LogMessage *message =
@@ -167,6 +201,7 @@ void LogMessageParser::log(const uint8_t *logBuffer, size_t logBufferSize) {
                    strnlen(message->logMessage, logBufferSize - bufferIndex) +
                    1;
   }
+  publishBatch();
 }
 
 std::optional<size_t>
@@ -183,7 +218,8 @@ LogMessageParser::parseAndEmitTokenizedLogMessageAndGetSize(
         detokenizer->Detokenize(encodedLog->data, encodedLog->size);
     std::string decodedString = detokenizedString.BestStringWithErrors();
     emitLogMessage(getLogLevelFromMetadata(message->metadata),
-                   le32toh(message->timestampMillis), decodedString.c_str());
+                   le32toh(message->timestampMillis), decodedString.c_str(),
+                   decodedString.size());
   } else {
     // TODO(b/327515992): Stop decoding and emitting system log messages if
     // detokenizer is null .
@@ -198,9 +234,9 @@ LogMessageParser::parseAndEmitNanoappTokenizedLogMessageAndGetSize(
   std::lock_guard<std::mutex> lock(mNanoappMutex);
   auto *tokenizedLog =
       reinterpret_cast<const NanoappTokenizedLog *>(message->logMessage);
-  auto detokenizerIter = mNanoappDetokenizers.find(tokenizedLog->instanceId);
+  Detokenizer *detokenizer = getNanoappDetokenizer(tokenizedLog->instanceId);
   size_t logMessageSize = tokenizedLog->size + kNanoappTokenizedLogOffset;
-  if (detokenizerIter == mNanoappDetokenizers.end()) {
+  if (detokenizer == nullptr) {
     LOGE(
         "Unable to find nanoapp log detokenizer associated with instance ID: "
         "%" PRIu16,
@@ -209,17 +245,159 @@ LogMessageParser::parseAndEmitNanoappTokenizedLogMessageAndGetSize(
   } else if (logMessageSize > maxLogMessageLen) {
     LOGE("Dropping log due to log message size exceeds the end of log buffer");
     logMessageSize = maxLogMessageLen;
-  } else {
-    auto detokenizer = detokenizerIter->second.detokenizer.get();
+  } else if (!isNanoappLogRateLimited(tokenizedLog->instanceId,
+                                      le32toh(message->timestampMillis))) {
     DetokenizedString detokenizedString =
         detokenizer->Detokenize(tokenizedLog->data, tokenizedLog->size);
     std::string decodedString = detokenizedString.BestStringWithErrors();
     emitLogMessage(getLogLevelFromMetadata(message->metadata),
-                   le32toh(message->timestampMillis), decodedString.c_str());
+                   le32toh(message->timestampMillis), decodedString.c_str(),
+                   decodedString.size());
   }
   return logMessageSize;
 }
 
+std::optional<size_t>
+LogMessageParser::parseAndEmitDeferredLogMessageAndGetSize(
+    const LogMessageV2 *message, size_t maxLogMessageLen) {
+  auto *deferredLog =
+      reinterpret_cast<const DeferredLog *>(message->logMessage);
+  if (maxLogMessageLen <= kDeferredLogOffset || deferredLog->size == 0 ||
+      deferredLog->size + kDeferredLogOffset > maxLogMessageLen) {
+    LOGE("Dropping log due to log message size exceeds the end of log buffer");
+    return std::nullopt;
+  }
+
+  uint8_t formatIndex =
+      deferredLog->formatIndex & ~kDeferredLogFormatDefinitionFlag;
+  if (formatIndex >= kDeferredLogMaxFormats) {
+    LOGE("Invalid deferred log format index %" PRIu8, formatIndex);
+    return std::nullopt;
+  }
+
+  const char *data = deferredLog->data;
+  size_t dataSize = deferredLog->size - sizeof(deferredLog->formatIndex);
+  if ((deferredLog->formatIndex & kDeferredLogFormatDefinitionFlag) != 0) {
+    size_t formatLength = strnlen(data, dataSize);
+    if (formatLength == dataSize) {
+      LOGE("Dropping deferred log due to unterminated format string");
+      return std::nullopt;
+    }
+    mDeferredLogFormats[formatIndex].emplace(data, formatLength);
+    data += formatLength + 1;
+    dataSize -= formatLength + 1;
+  }
+
+  const std::optional<std::string> &format = mDeferredLogFormats[formatIndex];
+  if (!format.has_value()) {
+    // The log which defined the format string was dropped.
+    LOGE("Unable to decode deferred log with unknown format index %" PRIu8,
+         formatIndex);
+  } else {
+    std::optional<std::string> decodedString = formatDeferredLog(
+        *format, reinterpret_cast<const uint8_t *>(data), dataSize);
+    if (decodedString.has_value()) {
+      emitLogMessage(getLogLevelFromMetadata(message->metadata),
+                     le32toh(message->timestampMillis),
+                     decodedString->c_str(), decodedString->size());
+    } else {
+      LOGE("Unable to decode deferred log with format \"%s\"",
+           format->c_str());
+    }
+  }
+  return deferredLog->size + kDeferredLogOffset;
+}
+
+std::optional<std::string> LogMessageParser::formatDeferredLog(
+    const std::string &format, const uint8_t *args, size_t argsSize) {
+  std::string output;
+  size_t argsIndex = 0;
+  auto readArg = [&](void *value, size_t size) {
+    if (argsIndex + size > argsSize) {
+      return false;
+    }
+    memcpy(value, &args[argsIndex], size);
+    argsIndex += size;
+    return true;
+  };
+
+  const char *literalStart = format.c_str();
+  const char *cursor = literalStart;
+  DeferredLogConversion conversion;
+  while (getNextDeferredLogConversion(&cursor, &conversion)) {
+    output.append(literalStart, conversion.start - literalStart);
+    literalStart = cursor;
+    std::string spec(conversion.start, conversion.length);
+
+    switch (conversion.argType) {
+      case DeferredLogArgType::NONE:
+        output.push_back('%');
+        break;
+
+      case DeferredLogArgType::INT32: {
+        uint32_t value;
+        if (!readArg(&value, sizeof(value))) {
+          return std::nullopt;
+        }
+        appendFormattedArg(output, spec, le32toh(value));
+        break;
+      }
+
+      case DeferredLogArgType::INT64: {
+        uint64_t value;
+        if (!readArg(&value, sizeof(value))) {
+          return std::nullopt;
+        }
+        // CHRE widens all of these to 64 bits, which may not match the size
+        // of the original type on the host.
+        spec.replace(conversion.modifierOffset, conversion.modifierLength,
+                     "ll");
+        appendFormattedArg(output, spec,
+                           static_cast<unsigned long long>(le64toh(value)));
+        break;
+      }
+
+      case DeferredLogArgType::DOUBLE: {
+        double value;
+        if (!readArg(&value, sizeof(value))) {
+          return std::nullopt;
+        }
+        appendFormattedArg(output, spec, value);
+        break;
+      }
+
+      case DeferredLogArgType::POINTER: {
+        uint64_t value;
+        if (!readArg(&value, sizeof(value))) {
+          return std::nullopt;
+        }
+        appendFormattedArg(output, "0x%" PRIx64, le64toh(value));
+        break;
+      }
+
+      case DeferredLogArgType::STRING: {
+        const char *value = reinterpret_cast<const char *>(&args[argsIndex]);
+        size_t length = strnlen(value, argsSize - argsIndex);
+        if (length == argsSize - argsIndex) {
+          return std::nullopt;
+        }
+        argsIndex += length + 1;
+        appendFormattedArg(output, spec, value);
+        break;
+      }
+
+      default:
+        return std::nullopt;
+    }
+  }
+  output.append(literalStart);
+
+  if (argsIndex != argsSize) {
+    return std::nullopt;
+  }
+  return output;
+}
+
 std::optional<size_t> LogMessageParser::parseAndEmitStringLogMessageAndGetSize(
     const LogMessageV2 *message, size_t maxLogMessageLen) {
   maxLogMessageLen = maxLogMessageLen - kStringLogOverhead;
@@ -229,11 +407,13 @@ std::optional<size_t> LogMessageParser::parseAndEmitStringLogMessageAndGetSize(
     return std::nullopt;
   }
   emitLogMessage(getLogLevelFromMetadata(message->metadata),
-                 le32toh(message->timestampMillis), message->logMessage);
+                 le32toh(message->timestampMillis), message->logMessage,
+                 logMessageSize);
   return logMessageSize + kStringLogOverhead;
 }
 
-void LogMessageParser::updateAndPrintDroppedLogs(uint32_t numLogsDropped) {
+void LogMessageParser::updateAndPrintDroppedLogs(uint32_t numLogsDropped,
+                                                 uint32_t timestampMillis) {
   if (numLogsDropped < mNumLogsDropped) {
     LOGE(
         "The numLogsDropped value received from CHRE is less than the last "
@@ -244,12 +424,35 @@ void LogMessageParser::updateAndPrintDroppedLogs(uint32_t numLogsDropped) {
   uint32_t diffLogsDropped = numLogsDropped - mNumLogsDropped;
   mNumLogsDropped = numLogsDropped;
   if (diffLogsDropped > 0) {
-    LOGI("# logs dropped: %" PRIu32, diffLogsDropped);
+    char summary[32];
+    snprintf(summary, sizeof(summary), "# logs dropped: %" PRIu32,
+             diffLogsDropped);
+    emitLogMessage(LogLevel::INFO, timestampMillis, summary);
   }
 }
 
 void LogMessageParser::emitLogMessage(uint8_t level, uint32_t timestampMillis,
                                       const char *logMessage) {
+  emitLogMessage(level, timestampMillis, logMessage, strlen(logMessage));
+}
+
+void LogMessageParser::emitLogMessage(uint8_t level, uint32_t timestampMillis,
+                                      const char *logMessage,
+                                      size_t logMessageLength) {
+  if (mCurrentBatch != nullptr) {
+    mCurrentBatch->add(level, timestampMillis, logMessage, logMessageLength);
+  } else {
+    writeLogMessage(level, timestampMillis, logMessage);
+  }
+}
+
+void LogMessageParser::writeLogMessage(uint8_t level, uint32_t timestampMillis,
+                                       const char *logMessage) {
+  if (mLogSink) {
+    mLogSink(level, timestampMillis, logMessage);
+    return;
+  }
+
   constexpr const char kLogTag[] = "CHRE";
   uint32_t timeSec = timestampMillis / kOneSecondInMilliseconds;
   uint32_t timeMsRemainder = timestampMillis % kOneSecondInMilliseconds;
@@ -262,7 +465,16 @@ void LogMessageParser::logV2(const uint8_t *logBuffer, size_t logBufferSize,
                              uint32_t numLogsDropped) {
   constexpr size_t kLogHeaderSize = sizeof(LogMessageV2);
 
-  updateAndPrintDroppedLogs(numLogsDropped);
+  beginBatch();
+  // Emitted ahead of the logs of this buffer, after those of earlier buffers
+  uint32_t firstTimestampMillis =
+      (logBufferSize >= kLogHeaderSize)
+          ? le32toh(reinterpret_cast<const LogMessageV2 *>(logBuffer)
+                        ->timestampMillis)
+          : 0;
+  updateAndPrintDroppedLogs(numLogsDropped, firstTimestampMillis);
+  // Deferred log format strings are only defined for the buffer they're in.
+  mDeferredLogFormats.fill(std::nullopt);
 
   std::optional<size_t> logMessageSize = std::nullopt;
   size_t bufferIndex = 0;
@@ -291,6 +503,10 @@ void LogMessageParser::logV2(const uint8_t *logBuffer, size_t logBufferSize,
         logMessageSize = parseAndEmitNanoappTokenizedLogMessageAndGetSize(
             message, maxLogMessageLen);
         break;
+      case LogType::DEFERRED_STRING:
+        logMessageSize = parseAndEmitDeferredLogMessageAndGetSize(
+            message, maxLogMessageLen);
+        break;
       default:
         LOGE("Unexpected log type 0x%" PRIx8,
              (message->metadata & kLogTypeMask) >> kLogTypeBitOffset);
@@ -298,19 +514,141 @@ void LogMessageParser::logV2(const uint8_t *logBuffer, size_t logBufferSize,
     }
     if (!logMessageSize.has_value()) {
       LOGE("Log message at offset %zu is corrupted, aborting...", bufferIndex);
-      return;
+      break;
     }
     bufferIndex += kLogHeaderSize + logMessageSize.value();
   }
+  publishBatch();
+}
+
+void LogMessageParser::beginBatch() {
+  if (!mAsyncEmitEnabled) {
+    mSyncBatch.clear();
+    mCurrentBatch = &mSyncBatch;
+    return;
+  }
+
+  if (!mEmitterThread.joinable()) {
+    mEmitterThread =
+        std::thread(&LogMessageParser::emitterThreadEntry, this);
+  }
+
+  size_t writeCount = mEmitQueueWriteCount.load(std::memory_order_relaxed);
+  auto hasRoom = [this, writeCount] {
+    return writeCount - mEmitQueueReadCount.load(std::memory_order_acquire) <
+           kEmitQueueSize;
+  };
+  if (!hasRoom()) {
+    std::unique_lock<std::mutex> lock(mEmitterMutex);
+    mEmittedCondVar.wait(lock, hasRoom);
+  }
+
+  mCurrentBatch = &mEmitQueue[writeCount % kEmitQueueSize];
+  mCurrentBatch->clear();
+}
+
+void LogMessageParser::publishBatch() {
+  mCurrentBatch = nullptr;
+  if (!mAsyncEmitEnabled) {
+    writeBatch(mSyncBatch);
+    return;
+  }
+
+  mEmitQueueWriteCount.fetch_add(1, std::memory_order_release);
+  {
+    // Synchronizes with the emitter checking the queue before it sleeps, so
+    // that the notification can't be missed
+    std::lock_guard<std::mutex> lock(mEmitterMutex);
+  }
+  mEmitterCondVar.notify_one();
+}
+
+void LogMessageParser::writeBatch(const LogRecordBatch &batch) {
+  for (const LogRecordBatch::Record &record : batch.records) {
+    writeLogMessage(record.level, record.timestampMillis,
+                    &batch.messages[record.messageOffset]);
+  }
+}
+
+void LogMessageParser::emitterThreadEntry() {
+  std::unique_lock<std::mutex> lock(mEmitterMutex);
+  while (true) {
+    size_t readCount = mEmitQueueReadCount.load(std::memory_order_relaxed);
+    size_t writeCount = mEmitQueueWriteCount.load(std::memory_order_acquire);
+    if (readCount == writeCount) {
+      if (mStopEmitter) {
+        break;
+      }
+      mEmitterCondVar.wait(lock);
+      continue;
+    }
+
+    lock.unlock();
+    writeBatch(mEmitQueue[readCount % kEmitQueueSize]);
+    lock.lock();
+    mEmitQueueReadCount.store(readCount + 1, std::memory_order_release);
+    mEmittedCondVar.notify_all();
+  }
+}
+
+void LogMessageParser::flush() {
+  if (!mEmitterThread.joinable()) {
+    return;
+  }
+  size_t writeCount = mEmitQueueWriteCount.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lock(mEmitterMutex);
+  mEmittedCondVar.wait(lock, [this, writeCount] {
+    return mEmitQueueReadCount.load(std::memory_order_acquire) >= writeCount;
+  });
+}
+
+bool LogMessageParser::isNanoappLogRateLimited(uint16_t instanceId,
+                                               uint32_t timestampMillis) {
+  constexpr double kLogsPerSecond = CHRE_HOST_NANOAPP_LOG_RATE_LIMIT;
+  constexpr double kMaxBurst = CHRE_HOST_NANOAPP_LOG_BURST_LIMIT;
+  if (kLogsPerSecond == 0) {
+    return false;
+  }
+
+  // The bucket is refilled by the time logged by CHRE rather than the time
+  // logs are parsed, as a buffer holds logs from a span of time
+  NanoappLogRateLimiter &limiter = mNanoappLogRateLimiters[instanceId];
+  if (!limiter.lastRefillMillis.has_value()) {
+    limiter.lastRefillMillis = timestampMillis;
+  }
+  // Wraps around along with the timestamps, and logs out of order don't refill
+  auto elapsedMillis =
+      static_cast<int32_t>(timestampMillis - *limiter.lastRefillMillis);
+  if (elapsedMillis > 0) {
+    limiter.lastRefillMillis = timestampMillis;
+    limiter.tokens =
+        std::min(kMaxBurst, limiter.tokens + elapsedMillis * kLogsPerSecond /
+                                                 kOneSecondInMilliseconds);
+  }
+  if (limiter.tokens < 1) {
+    limiter.numSuppressed++;
+    return true;
+  }
+
+  limiter.tokens -= 1;
+  if (limiter.numSuppressed > 0) {
+    char summary[96];
+    snprintf(summary, sizeof(summary),
+             "Dropped %" PRIu32 " logs from nanoapp instance %" PRIu16
+             " exceeding its log rate",
+             limiter.numSuppressed, instanceId);
+    emitLogMessage(LogLevel::WARNING, timestampMillis, summary);
+    limiter.numSuppressed = 0;
+  }
+  return false;
 }
 
 void LogMessageParser::addNanoappDetokenizer(uint64_t appId,
                                              uint16_t instanceId,
                                              uint64_t databaseOffset,
                                              size_t databaseSize) {
-  std::shared_ptr<const std::vector<uint8_t>> appBinary =
-      fetchNanoappBinary(appId);
-  if (!appBinary) {
+  std::optional<NanoappBinary> appBinary = fetchNanoappBinary(appId);
+  if (!appBinary.has_value()) {
     LOGE(
         "Binary not in cache, can't extract log token database for app ID "
         "0x%016" PRIx64,
@@ -318,60 +656,90 @@ void LogMessageParser::addNanoappDetokenizer(uint64_t appId,
   } else {
     removeNanoappDetokenizerAndBinary(appId);
     if (databaseSize != kInvalidTokenDatabaseSize) {
-      if (checkTokenDatabaseOverflow(databaseOffset, databaseSize,
-                                     appBinary->size())) {
+      // The database offset is relative to the ELF header, which follows the
+      // image header
+      size_t elfSize = (appBinary->size > kImageHeaderSize)
+                           ? appBinary->size - kImageHeaderSize
+                           : 0;
+      if (checkTokenDatabaseOverflow(databaseOffset, databaseSize, elfSize)) {
         LOGE(
             "Token database fails memory bounds check for nanoapp with app ID "
             "0x%016" PRIx64 ". Token database offset received: %" PRIu32
             "; size received: %zu; Size of the appBinary: %zu.",
-            appId, databaseOffset, databaseSize, appBinary->size());
+            appId, databaseOffset, databaseSize, appBinary->size);
       } else {
+        // Only the token database is kept so that the binary, which may be
+        // much larger, can be released. The detokenizer is built on demand as
+        // many nanoapps never send a tokenized log.
         const uint8_t *tokenDatabaseBinaryStart =
-            appBinary->data() + kImageHeaderSize + databaseOffset;
-
-        pw::span<const uint8_t> tokenEntries(tokenDatabaseBinaryStart,
-                                             databaseSize);
-        pw::Result<Detokenizer> nanoappDetokenizer =
-            pw::tokenizer::Detokenizer::FromElfSection(tokenEntries);
-
-        registerDetokenizer(appId, instanceId, std::move(nanoappDetokenizer));
+            appBinary->data.get() + kImageHeaderSize + databaseOffset;
+        registerTokenDatabase(
+            appId, instanceId,
+            std::vector<uint8_t>(tokenDatabaseBinaryStart,
+                                 tokenDatabaseBinaryStart + databaseSize));
       }
     }
   }
 }
 
-void LogMessageParser::registerDetokenizer(
-    uint64_t appId, uint16_t instanceId,
-    pw::Result<Detokenizer> nanoappDetokenizer) {
+void LogMessageParser::registerTokenDatabase(
+    uint64_t appId, uint16_t instanceId, std::vector<uint8_t> tokenDatabase) {
   std::lock_guard<std::mutex> lock(mNanoappMutex);
 
-  if (nanoappDetokenizer.ok()) {
-    NanoappDetokenizer detokenizer;
-    detokenizer.appId = appId;
-    detokenizer.detokenizer =
-        std::make_unique<Detokenizer>(std::move(*nanoappDetokenizer));
-    mNanoappDetokenizers[instanceId] = std::move(detokenizer);
-  } else {
-    LOGE("Unable to parse log detokenizer for app with ID: 0x%016" PRIx64,
-         appId);
+  NanoappDetokenizer detokenizer;
+  detokenizer.appId = appId;
+  detokenizer.tokenDatabase = std::move(tokenDatabase);
+  mNanoappDetokenizers[instanceId] = std::move(detokenizer);
+}
+
+Detokenizer *LogMessageParser::getNanoappDetokenizer(uint16_t instanceId) {
+  auto detokenizerIter = mNanoappDetokenizers.find(instanceId);
+  if (detokenizerIter == mNanoappDetokenizers.end()) {
+    return nullptr;
+  }
+
+  NanoappDetokenizer &nanoappDetokenizer = detokenizerIter->second;
+  if (nanoappDetokenizer.detokenizer == nullptr) {
+    pw::span<const uint8_t> tokenEntries(
+        nanoappDetokenizer.tokenDatabase.data(),
+        nanoappDetokenizer.tokenDatabase.size());
+    pw::Result<Detokenizer> detokenizer =
+        pw::tokenizer::Detokenizer::FromElfSection(tokenEntries);
+    if (!detokenizer.ok()) {
+      LOGE("Unable to parse log detokenizer for app with ID: 0x%016" PRIx64,
+           nanoappDetokenizer.appId);
+      mNanoappDetokenizers.erase(detokenizerIter);
+      return nullptr;
+    }
+
+    // The detokenizer holds its own copy of the token entries
+    nanoappDetokenizer.detokenizer =
+        std::make_unique<Detokenizer>(std::move(*detokenizer));
+    nanoappDetokenizer.tokenDatabase.clear();
+    nanoappDetokenizer.tokenDatabase.shrink_to_fit();
   }
+  return nanoappDetokenizer.detokenizer.get();
 }
 
-std::shared_ptr<const std::vector<uint8_t>>
+std::optional<LogMessageParser::NanoappBinary>
 LogMessageParser::fetchNanoappBinary(uint64_t appId) {
   std::lock_guard<std::mutex> lock(mNanoappMutex);
   auto appBinaryIter = mNanoappAppIdToBinary.find(appId);
   if (appBinaryIter != mNanoappAppIdToBinary.end()) {
     return appBinaryIter->second;
   }
-  return nullptr;
+  return std::nullopt;
 }
 
 void LogMessageParser::removeNanoappDetokenizerAndBinary(uint64_t appId) {
   std::lock_guard<std::mutex> lock(mNanoappMutex);
-  for (const auto &item : mNanoappDetokenizers) {
-    if (item.second.appId == appId) {
-      mNanoappDetokenizers.erase(item.first);
+  for (auto iter = mNanoappDetokenizers.begin();
+       iter != mNanoappDetokenizers.end();) {
+    if (iter->second.appId == appId) {
+      mNanoappLogRateLimiters.erase(iter->first);
+      iter = mNanoappDetokenizers.erase(iter);
+    } else {
+      ++iter;
     }
   }
   mNanoappAppIdToBinary.erase(appId);
@@ -381,12 +749,15 @@ void LogMessageParser::resetNanoappDetokenizerState() {
   std::lock_guard<std::mutex> lock(mNanoappMutex);
   mNanoappDetokenizers.clear();
   mNanoappAppIdToBinary.clear();
+  mNanoappLogRateLimiters.clear();
 }
 
 void LogMessageParser::onNanoappLoadStarted(
-    uint64_t appId, std::shared_ptr<const std::vector<uint8_t>> nanoappBinary) {
+    uint64_t appId, std::shared_ptr<const uint8_t> nanoappBinary,
+    size_t nanoappBinarySize) {
   std::lock_guard<std::mutex> lock(mNanoappMutex);
-  mNanoappAppIdToBinary[appId] = nanoappBinary;
+  mNanoappAppIdToBinary[appId] = {.data = std::move(nanoappBinary),
+                                  .size = nanoappBinarySize};
 }
 
 void LogMessageParser::onNanoappLoadFailed(uint64_t appId) {
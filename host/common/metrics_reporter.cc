@@ -21,6 +21,7 @@
 #include <cinttypes>
 #include <limits>
 #include <mutex>
+#include <utility>
 
 #include <android/binder_manager.h>
 
@@ -32,10 +33,45 @@ using ::aidl::android::frameworks::stats::VendorAtomValue;
 using ::android::chre::Atoms::CHRE_AP_WAKE_UP_OCCURRED;
 using ::android::chre::Atoms::CHRE_EVENT_QUEUE_SNAPSHOT_REPORTED;
 using ::android::chre::Atoms::CHRE_HAL_NANOAPP_LOAD_FAILED;
+using ::android::chre::Atoms::CHRE_NANOAPP_EVENT_BUDGET_EXCEEDED;
+using ::android::chre::Atoms::CHRE_NANOAPP_START_REPORTED;
 using ::android::chre::Atoms::CHRE_PAL_OPEN_FAILED;
 using ::android::chre::Atoms::ChreHalNanoappLoadFailed;
 using ::android::chre::Atoms::ChrePalOpenFailed;
 
+namespace {
+
+//! @return The atom with the count of its occurrences appended to its values.
+VendorAtom withOccurrenceCount(const VendorAtom &atom, uint32_t count) {
+  VendorAtom countedAtom = atom;
+  VendorAtomValue countValue;
+  countValue.set<VendorAtomValue::intValue>(static_cast<int32_t>(count));
+  countedAtom.values.push_back(std::move(countValue));
+  return countedAtom;
+}
+
+}  // namespace
+
+MetricsReporter::MetricsReporter() : MetricsReporter(AggregationConfig{}) {}
+
+MetricsReporter::MetricsReporter(AggregationConfig config,
+                                 std::shared_ptr<IStats> statsService)
+    : mAggregationConfig(config),
+      mHasStatsServiceOverride(statsService != nullptr),
+      mStatsService(std::move(statsService)) {}
+
+MetricsReporter::~MetricsReporter() {
+  {
+    std::lock_guard<std::mutex> lock(mAggregationMutex);
+    mStopAggregationThread = true;
+  }
+  mAggregationCondVar.notify_one();
+  if (mAggregationThread.joinable()) {
+    mAggregationThread.join();
+  }
+  flush();
+}
+
 std::shared_ptr<IStats> MetricsReporter::getStatsService() {
   const std::string statsServiceName =
       std::string(IStats::descriptor).append("/default");
@@ -90,6 +126,90 @@ bool MetricsReporter::reportMetric(const VendorAtom &atom) {
   return ret.isOk();
 }
 
+bool MetricsReporter::aggregateMetric(const VendorAtom &atom) {
+  if (mAggregationConfig.window.count() == 0) {
+    return reportMetric(withOccurrenceCount(atom, 1));
+  }
+
+  std::lock_guard<std::mutex> lock(mAggregationMutex);
+  auto iter = mAggregatedAtoms.find(atom);
+  if (iter == mAggregatedAtoms.end()) {
+    if (mAggregatedAtoms.size() >= mAggregationConfig.maxAtoms) {
+      // Reports what's aggregated early to make room for further atoms, as
+      // long as that doesn't report an atom too often in this window
+      mNumDroppedOccurrences++;
+      if (!mFlushRequested &&
+          mNumEarlyFlushes + 1 < mAggregationConfig.maxReportsPerAtom) {
+        mNumEarlyFlushes++;
+        mFlushRequested = true;
+        mAggregationCondVar.notify_one();
+      }
+      return false;
+    }
+    iter = mAggregatedAtoms.emplace(atom, 0).first;
+    if (mAggregatedAtoms.size() == 1) {
+      // A window starts with the first occurrence after the last one ended,
+      // and continues after atoms are reported early
+      auto now = std::chrono::steady_clock::now();
+      if (now >= mWindowEnd) {
+        mWindowEnd = now + mAggregationConfig.window;
+        mNumEarlyFlushes = 0;
+      }
+      mAggregationCondVar.notify_one();
+    }
+  }
+  iter->second++;
+
+  if (!mAggregationThread.joinable()) {
+    mAggregationThread =
+        std::thread(&MetricsReporter::aggregationThreadMain, this);
+  }
+  return true;
+}
+
+void MetricsReporter::flush() {
+  std::map<VendorAtom, uint32_t> aggregatedAtoms;
+  uint32_t numDroppedOccurrences;
+  {
+    std::lock_guard<std::mutex> lock(mAggregationMutex);
+    aggregatedAtoms.swap(mAggregatedAtoms);
+    numDroppedOccurrences = mNumDroppedOccurrences;
+    mNumDroppedOccurrences = 0;
+  }
+
+  for (const auto &[atom, count] : aggregatedAtoms) {
+    reportMetric(withOccurrenceCount(atom, count));
+  }
+
+  if (numDroppedOccurrences > 0) {
+    LOGW("Dropped %" PRIu32 " metric occurrences over the rate limits",
+         numDroppedOccurrences);
+  }
+}
+
+void MetricsReporter::aggregationThreadMain() {
+  std::unique_lock<std::mutex> lock(mAggregationMutex);
+  while (!mStopAggregationThread) {
+    if (mAggregatedAtoms.empty()) {
+      // Nothing is reported until the next occurrence
+      mFlushRequested = false;
+      mAggregationCondVar.wait(lock, [this]() {
+        return mStopAggregationThread || !mAggregatedAtoms.empty();
+      });
+      if (mStopAggregationThread) {
+        break;
+      }
+    }
+    mAggregationCondVar.wait_until(lock, mWindowEnd, [this]() {
+      return mStopAggregationThread || mFlushRequested;
+    });
+    mFlushRequested = false;
+    lock.unlock();
+    flush();
+    lock.lock();
+  }
+}
+
 bool MetricsReporter::logApWakeupOccurred(uint64_t nanoappId) {
   std::vector<VendorAtomValue> values(1);
   values[0].set<VendorAtomValue::longValue>(nanoappId);
@@ -99,7 +219,7 @@ bool MetricsReporter::logApWakeupOccurred(uint64_t nanoappId) {
       .values{std::move(values)},
   };
 
-  return reportMetric(atom);
+  return aggregateMetric(atom);
 }
 
 bool MetricsReporter::logNanoappLoadFailed(
@@ -115,7 +235,7 @@ bool MetricsReporter::logNanoappLoadFailed(
       .values{std::move(values)},
   };
 
-  return reportMetric(atom);
+  return aggregateMetric(atom);
 }
 
 bool MetricsReporter::logPalOpenFailed(ChrePalOpenFailed::ChrePalType pal,
@@ -129,7 +249,7 @@ bool MetricsReporter::logPalOpenFailed(ChrePalOpenFailed::ChrePalType pal,
       .values{std::move(values)},
   };
 
-  return reportMetric(atom);
+  return aggregateMetric(atom);
 }
 
 bool MetricsReporter::logEventQueueSnapshotReported(
@@ -158,10 +278,50 @@ bool MetricsReporter::logEventQueueSnapshotReported(
   return reportMetric(atom);
 }
 
+bool MetricsReporter::logNanoappStartReported(
+    uint64_t nanoappId, int64_t loadTimeUs, int64_t relocationTimeUs,
+    int64_t initArrayTimeUs, int64_t startTimeUs, int64_t totalTimeUs) {
+  std::vector<VendorAtomValue> values(6);
+  values[0].set<VendorAtomValue::longValue>(nanoappId);
+  values[1].set<VendorAtomValue::longValue>(loadTimeUs);
+  values[2].set<VendorAtomValue::longValue>(relocationTimeUs);
+  values[3].set<VendorAtomValue::longValue>(initArrayTimeUs);
+  values[4].set<VendorAtomValue::longValue>(startTimeUs);
+  values[5].set<VendorAtomValue::longValue>(totalTimeUs);
+
+  const VendorAtom atom{
+      .atomId = CHRE_NANOAPP_START_REPORTED,
+      .values{std::move(values)},
+  };
+
+  return reportMetric(atom);
+}
+
+bool MetricsReporter::logNanoappEventBudgetExceeded(uint64_t nanoappId,
+                                                    int32_t eventType,
+                                                    int64_t elapsedTimeMs,
+                                                    int64_t budgetMs) {
+  std::vector<VendorAtomValue> values(4);
+  values[0].set<VendorAtomValue::longValue>(nanoappId);
+  values[1].set<VendorAtomValue::intValue>(eventType);
+  values[2].set<VendorAtomValue::longValue>(elapsedTimeMs);
+  values[3].set<VendorAtomValue::longValue>(budgetMs);
+
+  const VendorAtom atom{
+      .atomId = CHRE_NANOAPP_EVENT_BUDGET_EXCEEDED,
+      .values{std::move(values)},
+  };
+
+  return reportMetric(atom);
+}
+
 void MetricsReporter::onBinderDied() {
   LOGI("MetricsReporter: stats service died - reconnecting");
 
   std::lock_guard<std::mutex> lock(mStatsServiceMutex);
+  if (mHasStatsServiceOverride) {
+    return;
+  }
   mStatsService.reset();
   mStatsService = getStatsService();
 }
@@ -16,7 +16,10 @@
 
 #include "chre_host/preloaded_nanoapp_loader.h"
 #include <chre_host/host_protocol_host.h>
+#include <sys/stat.h>
+#include <algorithm>
 #include <fstream>
+#include <thread>
 #include "chre_host/config_util.h"
 #include "chre_host/file_stream.h"
 #include "chre_host/fragmented_load_transaction.h"
@@ -31,6 +34,16 @@ namespace {
 /** Timeout value of waiting for the response of a loading fragment. */
 constexpr auto kTimeoutInMs = std::chrono::milliseconds(2000);
 
+/**
+ * Timeout value of waiting for a windowed load to make progress before the
+ * unacknowledged fragments are resent.
+ */
+constexpr auto kRetransmitTimeoutInMs = std::chrono::milliseconds(500);
+
+/** The number of times unacknowledged fragments are resent in a row. */
+constexpr size_t kMaxRetransmits = 3;
+
+using ::android::chre::mapFileContents;
 using ::android::chre::readFileContents;
 using ::android::chre::Atoms::ChreHalNanoappLoadFailed;
 using ::android::hardware::contexthub::common::implementation::kHalId;
@@ -48,6 +61,17 @@ bool getNanoappHeaderFromFile(const char *headerFileName,
   return true;
 }
 
+/** Computes the 64-bit FNV-1a hash of a nanoapp binary. */
+uint64_t fnv1a64Hash(const uint8_t *data, size_t size) {
+  constexpr uint64_t kFnvOffsetBasis = 0xcbf29ce484222325;
+  constexpr uint64_t kFnvPrime = 0x100000001b3;
+  uint64_t hash = kFnvOffsetBasis;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * kFnvPrime;
+  }
+  return hash;
+}
+
 inline bool shouldSkipNanoapp(
     std::optional<const std::vector<uint64_t>> nanoappIds, uint64_t theAppId) {
   return nanoappIds.has_value() &&
@@ -92,6 +116,17 @@ int PreloadedNanoappLoader::loadPreloadedNanoapps(
     return numOfNanoappsLoaded;
   }
 
+  struct PreloadedNanoapp {
+    std::vector<uint8_t> headerBuffer;
+    std::string filename;
+    uint32_t transactionId;
+
+    const NanoAppBinaryHeader *getHeader() const {
+      return reinterpret_cast<const NanoAppBinaryHeader *>(
+          headerBuffer.data());
+    }
+  };
+  std::vector<PreloadedNanoapp> nanoappsToLoad;
   for (uint32_t i = 0; i < nanoapps.size(); ++i) {
     std::string headerFilename = directory + "/" + nanoapps[i] + ".napp_header";
     std::string nanoappFilename = directory + "/" + nanoapps[i] + ".so";
@@ -109,106 +144,258 @@ int PreloadedNanoappLoader::loadPreloadedNanoapps(
       LOGI("Loading of %s is skipped.", nanoappFilename.c_str());
       continue;
     }
-    // load the binary
-    if (loadNanoapp(header, nanoappFilename, /* transactionId= */ i)) {
-      numOfNanoappsLoaded++;
+    nanoappsToLoad.push_back({std::move(headerBuffer),
+                              std::move(nanoappFilename),
+                              /* transactionId= */ i});
+  }
+
+  // Concurrent loads may fail if CHRE runs out of memory for them, so those
+  // are retried one at a time once the others are done.
+  size_t maxConcurrentLoads = std::min(
+      std::max<size_t>(mConnection->getMaxConcurrentNanoappLoads(), 1),
+      nanoappsToLoad.size());
+  bool isConcurrent = maxConcurrentLoads > 1;
+  std::atomic<size_t> nextNanoapp = 0;
+  std::atomic<int> numLoaded = 0;
+  std::vector<size_t> nanoappsToRetry;
+  std::mutex retryMutex;
+  auto loadWorker = [&]() {
+    for (size_t i = nextNanoapp++; i < nanoappsToLoad.size();
+         i = nextNanoapp++) {
+      const PreloadedNanoapp &nanoapp = nanoappsToLoad[i];
+      if (loadNanoapp(nanoapp.getHeader(), nanoapp.filename,
+                      nanoapp.transactionId, /* willRetry= */ isConcurrent)) {
+        numLoaded++;
+      } else if (isConcurrent) {
+        std::lock_guard<std::mutex> lock(retryMutex);
+        nanoappsToRetry.push_back(i);
+      } else {
+        LOGE("Failed to load nanoapp 0x%" PRIx64
+             " in preloaded nanoapp loader",
+             nanoapp.getHeader()->appId);
+        if (mNanoappLoadListener != nullptr) {
+          mNanoappLoadListener->onNanoappLoadFailed(
+              nanoapp.getHeader()->appId);
+        }
+      }
+    }
+  };
+  std::vector<std::thread> loadThreads;
+  for (size_t i = 1; i < maxConcurrentLoads; ++i) {
+    loadThreads.emplace_back(loadWorker);
+  }
+  loadWorker();
+  for (std::thread &thread : loadThreads) {
+    thread.join();
+  }
+
+  std::sort(nanoappsToRetry.begin(), nanoappsToRetry.end());
+  for (size_t i : nanoappsToRetry) {
+    const PreloadedNanoapp &nanoapp = nanoappsToLoad[i];
+    LOGW("Retrying the load of nanoapp 0x%" PRIx64 " on its own",
+         nanoapp.getHeader()->appId);
+    // Use a new transaction ID as CHRE may still reply to the failed one
+    if (loadNanoapp(nanoapp.getHeader(), nanoapp.filename,
+                    static_cast<uint32_t>(nanoapps.size() + i))) {
+      numLoaded++;
     } else {
       LOGE("Failed to load nanoapp 0x%" PRIx64 " in preloaded nanoapp loader",
-           header->appId);
+           nanoapp.getHeader()->appId);
       if (mNanoappLoadListener != nullptr) {
-        mNanoappLoadListener->onNanoappLoadFailed(header->appId);
+        mNanoappLoadListener->onNanoappLoadFailed(nanoapp.getHeader()->appId);
       }
     }
   }
+  numOfNanoappsLoaded = numLoaded;
   mIsPreloadingOngoing.store(false);
   return numOfNanoappsLoaded;
 }
 
 bool PreloadedNanoappLoader::loadNanoapp(const NanoAppBinaryHeader *appHeader,
                                          const std::string &nanoappFileName,
-                                         uint32_t transactionId) {
-  // parse the binary
-  auto nanoappBuffer = std::make_shared<std::vector<uint8_t>>();
-  if (!readFileContents(nanoappFileName.c_str(), *nanoappBuffer)) {
+                                         uint32_t transactionId,
+                                         bool willRetry) {
+  // Map the binary rather than reading it so that its pages can be reclaimed
+  // once the load is done
+  std::shared_ptr<const uint8_t> nanoappBinary;
+  size_t nanoappSize = 0;
+  if (!mapFileContents(nanoappFileName.c_str(), nanoappBinary, nanoappSize)) {
     LOGE("Unable to read %s.", nanoappFileName.c_str());
     return false;
   }
   if (mNanoappLoadListener != nullptr) {
-    mNanoappLoadListener->onNanoappLoadStarted(appHeader->appId, nanoappBuffer);
+    mNanoappLoadListener->onNanoappLoadStarted(appHeader->appId, nanoappBinary,
+                                               nanoappSize);
   }
   // Build the target API version from major and minor.
   uint32_t targetApiVersion = (appHeader->targetChreApiMajorVersion << 24) |
                               (appHeader->targetChreApiMinorVersion << 16);
+  uint64_t binaryHash =
+      getBinaryHash(nanoappFileName, nanoappBinary.get(), nanoappSize);
+  auto failureReason =
+      ChreHalNanoappLoadFailed::Reason::REASON_CONNECTION_ERROR;
   bool success = sendFragmentedLoadAndWaitForEachResponse(
       appHeader->appId, appHeader->appVersion, appHeader->flags,
-      targetApiVersion, nanoappBuffer->data(), nanoappBuffer->size(),
-      transactionId);
-  mEventLogger.logNanoappLoad(appHeader->appId, nanoappBuffer->size(),
-                              appHeader->appVersion, success);
+      targetApiVersion, std::move(nanoappBinary), nanoappSize, binaryHash,
+      transactionId, &failureReason);
+  if (success || !willRetry) {
+    mEventLogger.logNanoappLoad(appHeader->appId, nanoappSize,
+                                appHeader->appVersion, success);
+  }
+  if (!success && !willRetry && mMetricsReporter != nullptr) {
+    mMetricsReporter->logNanoappLoadFailed(
+        appHeader->appId, ChreHalNanoappLoadFailed::Type::TYPE_PRELOADED,
+        failureReason);
+  }
   return success;
 }
 
+uint64_t PreloadedNanoappLoader::getBinaryHash(
+    const std::string &nanoappFileName, const uint8_t *appBinary,
+    size_t appSize) {
+  struct stat fileStat;
+  if (stat(nanoappFileName.c_str(), &fileStat) != 0) {
+    LOGW("Unable to stat %s, its binary won't be reused by CHRE",
+         nanoappFileName.c_str());
+    return 0;
+  }
+  int64_t modifiedTimeNs =
+      static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1000000000 +
+      fileStat.st_mtim.tv_nsec;
+  {
+    std::lock_guard<std::mutex> lock(mPreloadedNanoappsMutex);
+    auto it = mBinaryHashes.find(nanoappFileName);
+    if (it != mBinaryHashes.end() && it->second.size == appSize &&
+        it->second.modifiedTimeNs == modifiedTimeNs) {
+      return it->second.hash;
+    }
+  }
+
+  // 0 means that the request has no hash
+  uint64_t hash = std::max<uint64_t>(fnv1a64Hash(appBinary, appSize), 1);
+  std::lock_guard<std::mutex> lock(mPreloadedNanoappsMutex);
+  mBinaryHashes[nanoappFileName] = {appSize, modifiedTimeNs, hash};
+  return hash;
+}
+
 bool PreloadedNanoappLoader::sendFragmentedLoadAndWaitForEachResponse(
     uint64_t appId, uint32_t appVersion, uint32_t appFlags,
-    uint32_t appTargetApiVersion, const uint8_t *appBinary, size_t appSize,
-    uint32_t transactionId) {
-  std::vector<uint8_t> binary(appSize);
-  std::copy(appBinary, appBinary + appSize, binary.begin());
-
+    uint32_t appTargetApiVersion, std::shared_ptr<const uint8_t> appBinary,
+    size_t appSize, uint64_t appBinaryHash, uint32_t transactionId,
+    ChreHalNanoappLoadFailed::Reason *failureReason) {
   FragmentedLoadTransaction transaction(transactionId, appId, appVersion,
-                                        appFlags, appTargetApiVersion, binary);
-  while (!transaction.isComplete()) {
-    auto nextRequest = transaction.getNextRequest();
-    auto future = sendFragmentedLoadRequest(nextRequest);
-    if (!waitAndVerifyFuture(future, nextRequest)) {
-      return false;
-    }
+                                        appFlags, appTargetApiVersion,
+                                        std::move(appBinary), appSize);
+  transaction.setBinaryHash(appBinaryHash);
+  {
+    std::lock_guard<std::mutex> lock(mPreloadedNanoappsMutex);
+    mPendingTransactions[transactionId] = Transaction();
   }
-  return true;
+  bool success = sendFragmentsAndWaitForAcks(transaction, failureReason);
+  {
+    std::lock_guard<std::mutex> lock(mPreloadedNanoappsMutex);
+    mPendingTransactions.erase(transactionId);
+  }
+  return success;
 }
 
-bool PreloadedNanoappLoader::waitAndVerifyFuture(
-    std::future<bool> &future, const FragmentedLoadRequest &request) {
-  bool success = false;
-  auto failureReason =
-      ChreHalNanoappLoadFailed::Reason::REASON_CONNECTION_ERROR;
-  if (!future.valid()) {
-    LOGE("Failed to send out the fragmented load fragment");
-  } else if (future.wait_for(kTimeoutInMs) != std::future_status::ready) {
-    LOGE(
-        "Waiting for response of fragment %zu transaction %d times out "
-        "after %lld ms",
-        request.fragmentId, request.transactionId, kTimeoutInMs.count());
-  } else if (!future.get()) {
-    LOGE(
-        "Received a failure result for loading fragment %zu of "
-        "transaction %d",
-        request.fragmentId, request.transactionId);
-    failureReason = ChreHalNanoappLoadFailed::Reason::REASON_ERROR_GENERIC;
-  } else {
-    success = true;
-  }
+bool PreloadedNanoappLoader::sendFragmentsAndWaitForAcks(
+    FragmentedLoadTransaction &transaction,
+    ChreHalNanoappLoadFailed::Reason *failureReason) {
+  uint32_t transactionId = transaction.getTransactionId();
+  size_t numFragments = transaction.getNumFragments();
+  size_t numRetransmits = 0;
 
-  if (!success && mMetricsReporter != nullptr) {
-    mMetricsReporter->logNanoappLoadFailed(
-        request.appId, ChreHalNanoappLoadFailed::Type::TYPE_PRELOADED,
-        failureReason);
+  std::unique_lock<std::mutex> lock(mPreloadedNanoappsMutex);
+  // References to unordered_map elements stay valid while other transactions
+  // are added or removed
+  const Transaction &state = mPendingTransactions.at(transactionId);
+  bool finalFragmentSent = false;
+  while (!state.binaryResident && state.lastAckedFragmentId < numFragments) {
+    // The window is unknown until CHRE responds to the first fragment
+    size_t windowEnd =
+        state.lastAckedFragmentId + std::max<uint32_t>(state.windowSize, 1);
+    while (!transaction.isComplete() &&
+           transaction.getNextFragmentId() <= windowEnd) {
+      const FragmentedLoadRequest &request = transaction.getNextRequest();
+      lock.unlock();
+      bool sent = sendFragmentedLoadRequest(request);
+      lock.lock();
+      if (!sent) {
+        LOGE("Failed to send out fragment %zu of transaction %" PRIu32,
+             request.fragmentId, transactionId);
+        *failureReason =
+            ChreHalNanoappLoadFailed::Reason::REASON_CONNECTION_ERROR;
+        return false;
+      }
+      finalFragmentSent |= (request.fragmentId == numFragments);
+    }
+
+    size_t lastAckedFragmentId = state.lastAckedFragmentId;
+    auto timeout =
+        (state.windowSize == 0) ? kTimeoutInMs : kRetransmitTimeoutInMs;
+    bool progressed = mTransactionCondition.wait_for(lock, timeout, [&]() {
+      return state.failed || state.binaryResident ||
+             state.lastAckedFragmentId > lastAckedFragmentId;
+    });
+    if (state.failed) {
+      // CHRE forgets a transaction once it handles its final fragment, so
+      // fragments resent after it because their acknowledgement was late or
+      // lost are failed even though the nanoapp was loaded
+      if (finalFragmentSent &&
+          isNanoappLoaded(transaction.getNanoappId(), lock)) {
+        LOGW("Nanoapp 0x%" PRIx64 " of transaction %" PRIu32
+             " was loaded despite a failure result",
+             transaction.getNanoappId(), transactionId);
+        return true;
+      }
+      LOGE(
+          "Received a failure result for loading fragment %zu of "
+          "transaction %" PRIu32,
+          lastAckedFragmentId + 1, transactionId);
+      *failureReason = ChreHalNanoappLoadFailed::Reason::REASON_ERROR_GENERIC;
+      return false;
+    }
+    if (progressed) {
+      numRetransmits = 0;
+    } else if (state.windowSize == 0 || ++numRetransmits > kMaxRetransmits) {
+      LOGE(
+          "Waiting for response of fragment %zu transaction %" PRIu32
+          " times out after %lld ms",
+          lastAckedFragmentId + 1, transactionId,
+          static_cast<long long>(timeout.count()));
+      *failureReason =
+          ChreHalNanoappLoadFailed::Reason::REASON_CONNECTION_ERROR;
+      return false;
+    } else {
+      LOGW("Resending fragments of transaction %" PRIu32 " from fragment %zu",
+           transactionId, lastAckedFragmentId + 1);
+      transaction.rewindTo(lastAckedFragmentId + 1);
+    }
   }
-  return success;
+  if (state.binaryResident) {
+    LOGI("Nanoapp 0x%" PRIx64 " was loaded from the binary retained by CHRE",
+         transaction.getNanoappId());
+  }
+  return true;
 }
 
 bool PreloadedNanoappLoader::verifyFragmentLoadResponse(
-    const ::chre::fbs::LoadNanoappResponseT &response) const {
+    const ::chre::fbs::LoadNanoappResponseT &response,
+    const Transaction &transaction) {
   if (!response.success) {
     LOGE("Loading nanoapp binary fragment %d of transaction %u failed.",
          response.fragment_id, response.transaction_id);
     return false;
   }
-  if (mPreloadedNanoappPendingTransaction.fragmentId != response.fragment_id) {
+  // Without a window, each fragment is acknowledged before the next is sent
+  size_t expectedFragmentId = transaction.lastAckedFragmentId + 1;
+  if (response.fragment_window_size == 0 &&
+      response.fragment_id != expectedFragmentId) {
     LOGE(
         "Fragmented load response with unexpected fragment id %u while "
         "%zu is expected",
-        response.fragment_id, mPreloadedNanoappPendingTransaction.fragmentId);
+        response.fragment_id, expectedFragmentId);
     return false;
   }
   return true;
@@ -217,7 +404,8 @@ bool PreloadedNanoappLoader::verifyFragmentLoadResponse(
 bool PreloadedNanoappLoader::onLoadNanoappResponse(
     const ::chre::fbs::LoadNanoappResponseT &response, HalClientId clientId) {
   std::unique_lock<std::mutex> lock(mPreloadedNanoappsMutex);
-  if (clientId != kHalId || !mFragmentedLoadPromise.has_value()) {
+  auto it = mPendingTransactions.find(response.transaction_id);
+  if (clientId != kHalId || it == mPendingTransactions.end()) {
     LOGE(
         "Received an unexpected preload nanoapp %s response for client %d "
         "transaction %u fragment %u",
@@ -225,43 +413,74 @@ bool PreloadedNanoappLoader::onLoadNanoappResponse(
         response.transaction_id, response.fragment_id);
     return false;
   }
-  if (mPreloadedNanoappPendingTransaction.transactionId !=
-      response.transaction_id) {
-    LOGE(
-        "Fragmented load response with transactionId %u but transactionId "
-        "%u is expected. Ignored.",
-        response.transaction_id,
-        mPreloadedNanoappPendingTransaction.transactionId);
+  Transaction &transaction = it->second;
+  if (!verifyFragmentLoadResponse(response, transaction)) {
+    transaction.failed = true;
+  } else {
+    // Responses are cumulative acknowledgements, which may be repeated
+    transaction.windowSize = response.fragment_window_size;
+    transaction.lastAckedFragmentId =
+        std::max<size_t>(transaction.lastAckedFragmentId, response.fragment_id);
+    transaction.binaryResident |= response.binary_resident;
+  }
+  mTransactionCondition.notify_all();
+  return true;
+}
+
+bool PreloadedNanoappLoader::onNanoappListResponse(
+    const ::chre::fbs::NanoappListResponseT &response, HalClientId clientId) {
+  std::lock_guard<std::mutex> lock(mPreloadedNanoappsMutex);
+  if (clientId != kHalId ||
+      mNumNanoappListResponses >= mNumNanoappListQueries) {
     return false;
   }
-  // set value for the future instance.
-  mFragmentedLoadPromise->set_value(verifyFragmentLoadResponse(response));
-  // reset the promise as the value can only be retrieved once from it.
-  mFragmentedLoadPromise = std::nullopt;
+  mNumNanoappListResponses++;
+  mLoadedNanoappIds.clear();
+  for (const auto &nanoapp : response.nanoapps) {
+    mLoadedNanoappIds.push_back(nanoapp->app_id);
+  }
+  mTransactionCondition.notify_all();
   return true;
 }
 
-std::future<bool> PreloadedNanoappLoader::sendFragmentedLoadRequest(
-    ::android::chre::FragmentedLoadRequest &request) {
+bool PreloadedNanoappLoader::isNanoappLoaded(
+    uint64_t appId, std::unique_lock<std::mutex> &lock) {
+  flatbuffers::FlatBufferBuilder builder(64);
+  HostProtocolHost::encodeNanoappListRequest(builder);
+  HostProtocolHost::mutateHostClientId(builder.GetBufferPointer(),
+                                       builder.GetSize(), kHalId);
+  size_t queryNumber = ++mNumNanoappListQueries;
+  lock.unlock();
+  bool sent = mConnection->sendMessage(builder);
+  lock.lock();
+  if (!sent) {
+    LOGE("Failed to query the nanoapps loaded by CHRE");
+    mNumNanoappListQueries--;
+    return false;
+  }
+  if (!mTransactionCondition.wait_for(lock, kTimeoutInMs, [&]() {
+        return mNumNanoappListResponses >= queryNumber;
+      })) {
+    LOGE("Timed out querying the nanoapps loaded by CHRE");
+    // Don't match a late response to a later query
+    mNumNanoappListResponses = std::max(mNumNanoappListResponses, queryNumber);
+    return false;
+  }
+  return std::find(mLoadedNanoappIds.begin(), mLoadedNanoappIds.end(),
+                   appId) != mLoadedNanoappIds.end();
+}
+
+bool PreloadedNanoappLoader::sendFragmentedLoadRequest(
+    const ::android::chre::FragmentedLoadRequest &request) {
   flatbuffers::FlatBufferBuilder builder(request.binary.size() + 128);
   // TODO(b/247124878): Confirm if respondBeforeStart can be set to true on all
   //  the devices.
   HostProtocolHost::encodeFragmentedLoadNanoappRequest(
-      builder, request, /* respondBeforeStart= */ true);
+      builder, request, /* respondBeforeStart= */ true,
+      CHRE_HOST_DEFAULT_FRAGMENT_WINDOW_SIZE);
   HostProtocolHost::mutateHostClientId(builder.GetBufferPointer(),
                                        builder.GetSize(), kHalId);
-
-  std::unique_lock<std::mutex> lock(mPreloadedNanoappsMutex);
-  if (!mConnection->sendMessage(builder.GetBufferPointer(),
-                                builder.GetSize())) {
-    // Returns an invalid future to indicate the failure
-    return std::future<bool>{};
-  }
-  mPreloadedNanoappPendingTransaction = {
-      .transactionId = request.transactionId,
-      .fragmentId = request.fragmentId,
-  };
-  mFragmentedLoadPromise = std::make_optional<std::promise<bool>>();
-  return mFragmentedLoadPromise->get_future();
+  return mConnection->sendMessage(builder.GetBufferPointer(),
+                                  builder.GetSize());
 }
-}  // namespace android::chre
\ No newline at end of file
+}  // namespace android::chre
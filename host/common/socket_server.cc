@@ -16,14 +16,14 @@
 
 #include "chre_host/socket_server.h"
 
-#include <poll.h>
+#include <sys/epoll.h>
 
-#include <cassert>
+#include <algorithm>
 #include <cerrno>
 #include <cinttypes>
 #include <csignal>
 #include <cstdlib>
-#include <map>
+#include <cstring>
 #include <mutex>
 
 #include <cutils/sockets.h>
@@ -35,14 +35,7 @@ namespace chre {
 
 std::atomic<bool> SocketServer::sSignalReceived(false);
 
-SocketServer::SocketServer() {
-  // Initialize the socket fds field for all inactive client slots to -1, so
-  // poll skips over it, and we don't attempt to send on it
-  for (size_t i = 1; i <= kMaxActiveClients; i++) {
-    mPollFds[i].fd = -1;
-    mPollFds[i].events = POLLIN;
-  }
-}
+SocketServer::SocketServer() {}
 
 void SocketServer::run(const char *socketName, bool allowSocketCreation,
                        ClientMessageCallback clientMessageCallback) {
@@ -62,20 +55,33 @@ void SocketServer::run(const char *socketName, bool allowSocketCreation,
     if (ret < 0) {
       LOG_ERROR("Couldn't listen on socket", errno);
     } else {
-      serviceSocket();
+      mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+      struct epoll_event event = {};
+      event.events = EPOLLIN;
+      event.data.u64 = kListenSocketEpollData;
+      if (mEpollFd < 0) {
+        LOG_ERROR("Couldn't create epoll instance", errno);
+      } else if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mSockFd, &event) != 0) {
+        LOG_ERROR("Couldn't add listen socket to epoll", errno);
+      } else {
+        serviceSocket();
+      }
     }
 
     {
       std::lock_guard<std::mutex> lock(mClientsMutex);
       for (const auto &pair : mClients) {
-        int clientSocket = pair.first;
-        if (close(clientSocket) != 0) {
-          LOGI("Couldn't close client %" PRIu16 "'s socket: %s",
-               pair.second.clientId, strerror(errno));
+        if (close(pair.second.socket) != 0) {
+          LOGI("Couldn't close client %" PRIu16 "'s socket: %s", pair.first,
+               strerror(errno));
         }
       }
       mClients.clear();
     }
+    if (mEpollFd >= 0) {
+      close(mEpollFd);
+      mEpollFd = -1;
+    }
     close(mSockFd);
   }
 }
@@ -83,16 +89,12 @@ void SocketServer::run(const char *socketName, bool allowSocketCreation,
 void SocketServer::sendToAllClients(const void *data, size_t length) {
   std::lock_guard<std::mutex> lock(mClientsMutex);
 
+  // Shared by all clients the message has to be queued for, if any
+  SharedBuffer buffer;
   int deliveredCount = 0;
-  for (const auto &pair : mClients) {
-    int clientSocket = pair.first;
-    uint16_t clientId = pair.second.clientId;
-    if (sendToClientSocket(data, length, clientSocket, clientId)) {
+  for (auto &pair : mClients) {
+    if (sendOrQueueLocked(pair.second, data, length, buffer)) {
       deliveredCount++;
-    } else if (errno == EINTR) {
-      // Exit early if we were interrupted - we should only get this for
-      // SIGINT/SIGTERM, so we should exit quickly
-      break;
     }
   }
 
@@ -105,149 +107,237 @@ bool SocketServer::sendToClientById(const void *data, size_t length,
                                     uint16_t clientId) {
   std::lock_guard<std::mutex> lock(mClientsMutex);
 
-  bool sent = false;
-  for (const auto &pair : mClients) {
-    uint16_t thisClientId = pair.second.clientId;
-    if (thisClientId == clientId) {
-      int clientSocket = pair.first;
-      sent = sendToClientSocket(data, length, clientSocket, thisClientId);
-      break;
-    }
+  auto it = mClients.find(clientId);
+  if (it == mClients.end()) {
+    return false;
   }
+  SharedBuffer buffer;
+  return sendOrQueueLocked(it->second, data, length, buffer);
+}
+
+std::vector<SocketServer::ClientMetrics> SocketServer::getClientMetrics() {
+  std::lock_guard<std::mutex> lock(mClientsMutex);
 
-  return sent;
+  std::vector<ClientMetrics> metrics;
+  metrics.reserve(mClients.size());
+  for (const auto &pair : mClients) {
+    metrics.push_back(pair.second.metrics);
+  }
+  return metrics;
 }
 
 void SocketServer::acceptClientConnection() {
-  int clientSocket = accept(mSockFd, NULL, NULL);
+  int clientSocket = accept4(mSockFd, NULL, NULL, SOCK_CLOEXEC);
   if (clientSocket < 0) {
     LOG_ERROR("Couldn't accept client connection", errno);
-  } else if (mClients.size() >= kMaxActiveClients) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mClientsMutex);
+  if (mClients.size() >= kMaxActiveClients) {
     LOGW("Rejecting client request - maximum number of clients reached");
     close(clientSocket);
-  } else {
-    ClientData clientData;
-    clientData.clientId = mNextClientId++;
-
-    // We currently don't handle wraparound - if we're getting this many
-    // connects/disconnects, then something is wrong.
-    // TODO: can handle this properly by iterating over the existing clients to
-    // avoid a conflict.
-    if (clientData.clientId == 0) {
-      LOGE("Couldn't allocate client ID");
-      std::exit(-1);
-    }
+    return;
+  }
 
-    bool slotFound = false;
-    for (size_t i = 1; i <= kMaxActiveClients; i++) {
-      if (mPollFds[i].fd < 0) {
-        mPollFds[i].fd = clientSocket;
-        slotFound = true;
-        break;
-      }
-    }
+  uint16_t clientId = mNextClientId++;
 
-    if (!slotFound) {
-      LOGE("Couldn't find slot for client!");
-      assert(slotFound);
-      close(clientSocket);
-    } else {
-      {
-        std::lock_guard<std::mutex> lock(mClientsMutex);
-        mClients[clientSocket] = clientData;
-      }
-      LOGI(
-          "Accepted new client connection (count %zu), assigned client ID "
-          "%" PRIu16,
-          mClients.size(), clientData.clientId);
-    }
+  // We currently don't handle wraparound - if we're getting this many
+  // connects/disconnects, then something is wrong.
+  // TODO: can handle this properly by iterating over the existing clients to
+  // avoid a conflict.
+  if (clientId == 0) {
+    LOGE("Couldn't allocate client ID");
+    std::exit(-1);
   }
+
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = clientId;
+  if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, clientSocket, &event) != 0) {
+    LOG_ERROR("Couldn't add client socket to epoll", errno);
+    close(clientSocket);
+    return;
+  }
+
+  ClientData &clientData = mClients[clientId];
+  clientData.socket = clientSocket;
+  clientData.clientId = clientId;
+  clientData.metrics.clientId = clientId;
+  LOGI(
+      "Accepted new client connection (count %zu), assigned client ID "
+      "%" PRIu16,
+      mClients.size(), clientId);
 }
 
-void SocketServer::handleClientData(int clientSocket) {
-  const ClientData &clientData = mClients[clientSocket];
-  uint16_t clientId = clientData.clientId;
+void SocketServer::handleClientData(uint16_t clientId) {
+  int clientSocket;
+  {
+    std::lock_guard<std::mutex> lock(mClientsMutex);
+    auto it = mClients.find(clientId);
+    if (it == mClients.end()) {
+      return;
+    }
+    clientSocket = it->second.socket;
+  }
 
+  // The socket is only closed by this thread, so it can be read without
+  // holding the lock. The lock must not be held while invoking the callback,
+  // as it may send a response to the client.
   ssize_t packetSize =
       recv(clientSocket, mRecvBuffer.data(), mRecvBuffer.size(), MSG_DONTWAIT);
   if (packetSize < 0) {
     LOGE("Couldn't get packet from client %" PRIu16 ": %s", clientId,
          strerror(errno));
     if (ENOTCONN == errno) {
-      disconnectClient(clientSocket);
+      disconnectClient(clientId);
     }
   } else if (packetSize == 0) {
     LOGI("Client %" PRIu16 " disconnected", clientId);
-    disconnectClient(clientSocket);
+    disconnectClient(clientId);
   } else {
     LOGV("Got %zd byte packet from client %" PRIu16, packetSize, clientId);
     mClientMessageCallback(clientId, mRecvBuffer.data(), packetSize);
   }
 }
 
-void SocketServer::disconnectClient(int clientSocket) {
-  {
-    std::lock_guard<std::mutex> lock(mClientsMutex);
-    mClients.erase(clientSocket);
+void SocketServer::disconnectClient(uint16_t clientId) {
+  std::lock_guard<std::mutex> lock(mClientsMutex);
+  auto it = mClients.find(clientId);
+  if (it == mClients.end()) {
+    LOGE("Out of sync");
+    return;
+  }
+
+  const ClientData &client = it->second;
+  if (client.metrics.messagesQueued > 0) {
+    LOGI("Client %" PRIu16 " sent %" PRIu64 " queued %" PRIu64
+         " dropped %" PRIu64 " max backlog %zu",
+         clientId, client.metrics.messagesSent, client.metrics.messagesQueued,
+         client.metrics.messagesDropped, client.metrics.maxBacklogMessages);
+  }
+  epoll_ctl(mEpollFd, EPOLL_CTL_DEL, client.socket, nullptr);
+  close(client.socket);
+  mClients.erase(it);
+}
+
+bool SocketServer::sendOrQueueLocked(ClientData &client, const void *data,
+                                     size_t length, SharedBuffer &buffer) {
+  // Messages must be delivered in order, so only send directly if nothing is
+  // queued ahead of this one
+  if (client.outQueue.empty()) {
+    if (sendNonBlocking(client, data, length)) {
+      client.metrics.messagesSent++;
+      return true;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      LOGE("Error sending packet of size %zu to client %" PRIu16 ": %s",
+           length, client.clientId, strerror(errno));
+      return false;
+    }
   }
-  close(clientSocket);
 
-  bool removed = false;
-  for (size_t i = 1; i <= kMaxActiveClients; i++) {
-    if (mPollFds[i].fd == clientSocket) {
-      mPollFds[i].fd = -1;
-      removed = true;
+  ClientMetrics &metrics = client.metrics;
+  if (metrics.backlogMessages >= kMaxQueuedMessagesPerClient ||
+      metrics.backlogBytes + length > kMaxQueuedBytesPerClient) {
+    metrics.messagesDropped++;
+    if (!client.dropping) {
+      LOGW("Dropping messages to client %" PRIu16 " with backlog of %zu",
+           client.clientId, metrics.backlogMessages);
+      client.dropping = true;
+    }
+    return false;
+  }
+
+  if (buffer == nullptr) {
+    auto bytes = static_cast<const uint8_t *>(data);
+    buffer =
+        std::make_shared<const std::vector<uint8_t>>(bytes, bytes + length);
+  }
+  client.outQueue.push_back(buffer);
+  metrics.messagesQueued++;
+  metrics.backlogMessages = client.outQueue.size();
+  metrics.backlogBytes += length;
+  metrics.maxBacklogMessages =
+      std::max(metrics.maxBacklogMessages, metrics.backlogMessages);
+  setWaitingForWritableLocked(client, true);
+  return true;
+}
+
+void SocketServer::flushQueueLocked(ClientData &client) {
+  ClientMetrics &metrics = client.metrics;
+  while (!client.outQueue.empty()) {
+    const std::vector<uint8_t> &message = *client.outQueue.front();
+    if (sendNonBlocking(client, message.data(), message.size())) {
+      metrics.messagesSent++;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
       break;
+    } else {
+      LOGE("Error sending queued packet of size %zu to client %" PRIu16 ": %s",
+           message.size(), client.clientId, strerror(errno));
+      metrics.messagesDropped++;
     }
+    metrics.backlogBytes -= message.size();
+    client.outQueue.pop_front();
   }
 
-  if (!removed) {
-    LOGE("Out of sync");
-    assert(removed);
+  metrics.backlogMessages = client.outQueue.size();
+  if (client.outQueue.empty()) {
+    client.dropping = false;
+    setWaitingForWritableLocked(client, false);
   }
 }
 
-bool SocketServer::sendToClientSocket(const void *data, size_t length,
-                                      int clientSocket, uint16_t clientId) {
+bool SocketServer::sendNonBlocking(const ClientData &client, const void *data,
+                                   size_t length) {
   errno = 0;
-  ssize_t bytesSent = send(clientSocket, data, length, 0);
-  if (bytesSent < 0) {
-    LOGE("Error sending packet of size %zu to client %" PRIu16 ": %s", length,
-         clientId, strerror(errno));
+  ssize_t bytesSent =
+      send(client.socket, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (bytesSent > 0) {
+    LOGV("Delivered message of size %zu bytes to client %" PRIu16, length,
+         client.clientId);
   } else if (bytesSent == 0) {
     LOGW("Client %" PRIu16 " disconnected before message could be delivered",
-         clientId);
-  } else {
-    LOGV("Delivered message of size %zu bytes to client %" PRIu16, length,
-         clientId);
+         client.clientId);
+    errno = ENOTCONN;
   }
-
   return (bytesSent > 0);
 }
 
-void SocketServer::serviceSocket() {
-  constexpr size_t kListenIndex = 0;
-  static_assert(kListenIndex == 0,
-                "Code assumes that the first index is always the listen "
-                "socket");
+void SocketServer::setWaitingForWritableLocked(ClientData &client,
+                                               bool waiting) {
+  if (client.waitingForWritable == waiting) {
+    return;
+  }
 
-  mPollFds[kListenIndex].fd = mSockFd;
-  mPollFds[kListenIndex].events = POLLIN;
+  struct epoll_event event = {};
+  event.events = waiting ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+  event.data.u64 = client.clientId;
+  if (epoll_ctl(mEpollFd, EPOLL_CTL_MOD, client.socket, &event) != 0) {
+    LOGE("Couldn't update epoll events for client %" PRIu16 ": %s",
+         client.clientId, strerror(errno));
+  } else {
+    client.waitingForWritable = waiting;
+  }
+}
 
-  // Signal mask used with ppoll() so we gracefully handle SIGINT and SIGTERM,
-  // and ignore other signals
+void SocketServer::serviceSocket() {
+  // Signal mask used with epoll_pwait() so we gracefully handle SIGINT and
+  // SIGTERM, and ignore other signals
   sigset_t signalMask;
   sigfillset(&signalMask);
   sigdelset(&signalMask, SIGINT);
   sigdelset(&signalMask, SIGTERM);
 
+  struct epoll_event events[1 + kMaxActiveClients];
+
   LOGI("Ready to accept connections");
   while (!sSignalReceived) {
-    int ret = ppoll(mPollFds, 1 + kMaxActiveClients, nullptr, &signalMask);
-    if (ret == -1) {
+    int numEvents = epoll_pwait(mEpollFd, events, 1 + kMaxActiveClients,
+                                -1 /* timeout */, &signalMask);
+    if (numEvents == -1) {
       // Don't use TEMP_FAILURE_RETRY since our logic needs to check
       // sSignalReceived to see if it should exit where as TEMP_FAILURE_RETRY
-      // is a tight retry loop around ppoll.
+      // is a tight retry loop around epoll_pwait.
       if (errno == EINTR) {
         continue;
       }
@@ -255,17 +345,26 @@ void SocketServer::serviceSocket() {
       break;
     }
 
-    if (mPollFds[kListenIndex].revents & POLLIN) {
-      acceptClientConnection();
-    }
-
-    for (size_t i = 1; i <= kMaxActiveClients; i++) {
-      if (mPollFds[i].fd < 0) {
+    for (int i = 0; i < numEvents; i++) {
+      if (events[i].data.u64 == kListenSocketEpollData) {
+        acceptClientConnection();
         continue;
       }
 
-      if (mPollFds[i].revents & POLLIN) {
-        handleClientData(mPollFds[i].fd);
+      auto clientId = static_cast<uint16_t>(events[i].data.u64);
+      if (events[i].events & EPOLLOUT) {
+        std::lock_guard<std::mutex> lock(mClientsMutex);
+        auto it = mClients.find(clientId);
+        if (it != mClients.end()) {
+          flushQueueLocked(it->second);
+        }
+      }
+
+      if (events[i].events & EPOLLIN) {
+        handleClientData(clientId);
+      } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+        LOGI("Client %" PRIu16 " disconnected", clientId);
+        disconnectClient(clientId);
       }
     }
   }
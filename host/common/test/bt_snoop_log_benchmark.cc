@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "chre/platform/shared/bt_snoop_log.h"
+#include "chre_host/bt_snoop_log_parser.h"
+#include "chre_host/file_stream.h"
+
+/**
+ * @file
+ * A benchmark feeding synthetic LogType::BLUETOOTH records to
+ * BtSnoopLogParser, which reports the time spent per record on the calling
+ * thread and the total time until the records are written to the file. The
+ * same records are also written the way the parser used to write them, one
+ * unbuffered record at a time on the calling thread, and both files are
+ * checked to be identical apart from the record timestamps.
+ *
+ * Usage:
+ *  bt_snoop_log_benchmark [num-records] [output-dir]
+ *
+ * The number of records is capped so that they fit in a single file.
+ */
+
+using android::chre::BtSnoopLogParser;
+using android::chre::readFileContents;
+
+namespace {
+
+constexpr size_t kDefaultNumRecords = 60000;
+//! The number of packets in a snoop log file before a new one is started.
+constexpr size_t kMaxRecordsPerFile = 0xffff;
+
+constexpr size_t kFileHeaderSize = 16;
+constexpr size_t kPacketHeaderSize = 25;
+constexpr size_t kTimestampOffset = 16;
+constexpr size_t kTimestampSize = sizeof(uint64_t);
+
+using Record = std::vector<uint8_t>;
+
+//! Generates records in the LogType::BLUETOOTH payload format, i.e. direction,
+//! packet size and packet, sized like a mix of HCI commands and BLE events.
+std::vector<Record> generateRecords(size_t numRecords) {
+  std::vector<Record> records;
+  records.reserve(numRecords);
+  for (size_t i = 0; i < numRecords; i++) {
+    auto direction = (i % 3 == 0)
+                         ? BtSnoopDirection::OUTGOING_TO_ARBITER
+                         : BtSnoopDirection::INCOMING_FROM_BT_CONTROLLER;
+    size_t packetSize = (i % 3 == 0) ? 4 + i % 16 : 20 + (i * 37) % 236;
+    Record record;
+    record.push_back(static_cast<uint8_t>(direction));
+    record.push_back(static_cast<uint8_t>(packetSize));
+    for (size_t j = 0; j < packetSize; j++) {
+      record.push_back(static_cast<uint8_t>(i + j));
+    }
+    records.push_back(std::move(record));
+  }
+  return records;
+}
+
+/**
+ * Writes a record the way BtSnoopLogParser did before it had a writer thread,
+ * to an unbuffered stream which already has the file header.
+ */
+void writeRecordUnbuffered(std::ofstream &stream, const Record &record) {
+  auto direction = static_cast<BtSnoopDirection>(record[0]);
+  size_t packetSize = record[1];
+  bool outgoing = direction == BtSnoopDirection::OUTGOING_TO_ARBITER;
+  std::bitset<32> flags = 0;
+  flags.set(0, !outgoing);
+  flags.set(1, true);
+
+  uint8_t header[kPacketHeaderSize] = {};
+  uint32_t length = htonl(static_cast<uint32_t>(packetSize + 1));
+  uint32_t flagsValue = htonl(static_cast<uint32_t>(flags.to_ulong()));
+  memcpy(&header[0], &length, sizeof(length));
+  memcpy(&header[4], &length, sizeof(length));
+  memcpy(&header[8], &flagsValue, sizeof(flagsValue));
+  header[kPacketHeaderSize - 1] = outgoing ? 1 /* CMD */ : 4 /* EVT */;
+  stream.write(reinterpret_cast<const char *>(header), sizeof(header));
+  stream.write(reinterpret_cast<const char *>(&record[2]),
+               static_cast<std::streamsize>(packetSize));
+}
+
+//! Zeroes the timestamps of the records in a snoop log file.
+bool clearTimestamps(std::vector<uint8_t> &file) {
+  size_t offset = kFileHeaderSize;
+  while (offset + kPacketHeaderSize <= file.size()) {
+    uint32_t length;
+    memcpy(&length, &file[offset], sizeof(length));
+    memset(&file[offset + kTimestampOffset], 0, kTimestampSize);
+    // The length includes the packet type, the last byte of the header
+    offset += kPacketHeaderSize - 1 + ntohl(length);
+  }
+  return offset == file.size();
+}
+
+double toMillis(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  size_t numRecords = std::min<size_t>(
+      (argc > 1) ? strtoul(argv[1], nullptr, 0) : kDefaultNumRecords,
+      kMaxRecordsPerFile);
+  std::filesystem::path dir = (argc > 2)
+                                  ? std::filesystem::path(argv[2])
+                                  : std::filesystem::temp_directory_path();
+  std::string parserPath = dir / "chre_btsnoop_benchmark.log";
+  std::string unbufferedPath = dir / "chre_btsnoop_benchmark_unbuffered.log";
+  std::vector<Record> records = generateRecords(numRecords);
+
+  // The file header is the first record written by the parser, so it's taken
+  // from the parser's output
+  std::vector<uint8_t> parserFile;
+  uint64_t maxCallNs = 0;
+  auto start = std::chrono::steady_clock::now();
+  {
+    BtSnoopLogParser parser(parserPath);
+    for (const Record &record : records) {
+      auto callStart = std::chrono::steady_clock::now();
+      parser.log(reinterpret_cast<const char *>(record.data()), record.size());
+      maxCallNs = std::max<uint64_t>(
+          maxCallNs, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - callStart)
+                         .count());
+    }
+    auto loggedTime = std::chrono::steady_clock::now() - start;
+    parser.flush();
+    auto writtenTime = std::chrono::steady_clock::now() - start;
+    printf("writer thread: %8.1f ms on the calling thread (max %" PRIu64
+           " ns per record), %8.1f ms until written\n",
+           toMillis(loggedTime), maxCallNs, toMillis(writtenTime));
+  }
+  if (!readFileContents(parserPath.c_str(), parserFile) ||
+      parserFile.size() < kFileHeaderSize) {
+    fprintf(stderr, "Failed to read %s\n", parserPath.c_str());
+    return -1;
+  }
+
+  start = std::chrono::steady_clock::now();
+  {
+    std::ofstream stream(unbufferedPath, std::ios::binary | std::ios::out);
+    stream.setf(std::ios::unitbuf);
+    stream.write(reinterpret_cast<const char *>(parserFile.data()),
+                 kFileHeaderSize);
+    for (const Record &record : records) {
+      writeRecordUnbuffered(stream, record);
+    }
+  }
+  printf("unbuffered:    %8.1f ms on the calling thread\n",
+         toMillis(std::chrono::steady_clock::now() - start));
+
+  std::vector<uint8_t> unbufferedFile;
+  bool identical = readFileContents(unbufferedPath.c_str(), unbufferedFile) &&
+                   clearTimestamps(parserFile) &&
+                   clearTimestamps(unbufferedFile) &&
+                   parserFile == unbufferedFile;
+  printf("%zu records, %zu bytes: %s\n", numRecords, parserFile.size(),
+         identical ? "files match" : "FILES DIFFER");
+
+  for (const std::string &path : {parserPath, unbufferedPath}) {
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".last");
+  }
+  return identical ? 0 : -1;
+}
@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "chre_host/file_stream.h"
+#include "chre_host/host_protocol_host.h"
+
+/**
+ * @file
+ * A benchmark comparing the cost of decoding messages from CHRE by unpacking
+ * the whole MessageContainer via the FlatBuffers object API against reading
+ * nanoapp messages in place via HostProtocolHost::decodeMessageFromChre().
+ * Both paths copy each message body into a std::vector the way the HAL
+ * builds its outgoing ContextHubMessage.
+ *
+ * Usage:
+ *  chre_decode_benchmark [iterations] [recorded-stream-path]
+ *
+ * A recorded stream is a sequence of frames from CHRE, each prefixed with its
+ * length as a 32-bit little endian integer. If no stream is given, a synthetic
+ * one is generated with a mix of message sizes and batches.
+ */
+
+using android::chre::HostProtocolHost;
+using android::chre::IChreMessageHandlers;
+using android::chre::readFileContents;
+using flatbuffers::FlatBufferBuilder;
+
+namespace fbs = ::chre::fbs;
+
+namespace {
+
+std::atomic<size_t> gNumAllocations{0};
+std::atomic<size_t> gNumBytesAllocated{0};
+
+constexpr size_t kDefaultIterations = 1000;
+constexpr size_t kBatchSize = 8;
+
+//! Emulates the work done by the HAL per nanoapp message with the object API.
+class UnpackedMessageHandlers : public IChreMessageHandlers {
+ public:
+  void handleNanoappMessage(const fbs::NanoappMessageT &message) override {
+    std::vector<uint8_t> messageBody = message.message;
+    mNumBytes += messageBody.size();
+    mNumMessages++;
+  }
+
+  size_t mNumMessages = 0;
+  size_t mNumBytes = 0;
+};
+
+//! Emulates the work done by the HAL per nanoapp message when read in place.
+class InPlaceMessageHandlers : public IChreMessageHandlers {
+ public:
+  void handleNanoappMessageInPlace(
+      const fbs::NanoappMessage &message) override {
+    std::vector<uint8_t> messageBody;
+    if (message.message() != nullptr) {
+      messageBody.assign(message.message()->begin(), message.message()->end());
+    }
+    mNumBytes += messageBody.size();
+    mNumMessages++;
+  }
+
+  size_t mNumMessages = 0;
+  size_t mNumBytes = 0;
+};
+
+using Frame = std::vector<uint8_t>;
+
+void appendFrame(const FlatBufferBuilder &builder, std::vector<Frame> &frames) {
+  frames.emplace_back(builder.GetBufferPointer(),
+                      builder.GetBufferPointer() + builder.GetSize());
+}
+
+std::vector<Frame> generateStream() {
+  constexpr size_t kMessageSizes[] = {8, 32, 128, 512, 4000};
+  std::vector<uint8_t> payload(4000, 0xa5);
+  std::vector<Frame> frames;
+
+  for (size_t size : kMessageSizes) {
+    FlatBufferBuilder builder;
+    HostProtocolHost::encodeNanoappMessage(builder, 0x476f6f676c000001,
+                                           1 /* messageType */,
+                                           0x8001 /* hostEndpoint */,
+                                           payload.data(), size);
+    appendFrame(builder, frames);
+  }
+
+  FlatBufferBuilder builder;
+  std::vector<flatbuffers::Offset<fbs::NanoappMessage>> messages;
+  for (size_t i = 0; i < kBatchSize; i++) {
+    auto message = builder.CreateVector(payload.data(), 32);
+    messages.push_back(fbs::CreateNanoappMessage(
+        builder, 0x476f6f676c000001, 1 /* message_type */,
+        0x8001 /* host_endpoint */, message));
+  }
+  auto batch =
+      fbs::CreateNanoappMessageBatch(builder, builder.CreateVector(messages));
+  HostProtocolHost::finalize(builder, fbs::ChreMessage::NanoappMessageBatch,
+                             batch.Union());
+  appendFrame(builder, frames);
+  return frames;
+}
+
+bool readStream(const char *path, std::vector<Frame> &frames) {
+  std::vector<uint8_t> contents;
+  if (!readFileContents(path, contents)) {
+    return false;
+  }
+
+  size_t offset = 0;
+  while (offset + sizeof(uint32_t) <= contents.size()) {
+    uint32_t frameSize;
+    memcpy(&frameSize, &contents[offset], sizeof(frameSize));
+    offset += sizeof(frameSize);
+    if (frameSize > contents.size() - offset) {
+      fprintf(stderr, "Truncated frame at offset %zu\n", offset);
+      return false;
+    }
+    frames.emplace_back(&contents[offset], &contents[offset + frameSize]);
+    offset += frameSize;
+  }
+  return !frames.empty();
+}
+
+template <typename DecodeFunction>
+void runBenchmark(const char *name, const std::vector<Frame> &frames,
+                  size_t iterations, const size_t &numMessages,
+                  DecodeFunction decode) {
+  size_t allocationsBefore = gNumAllocations.load();
+  size_t bytesBefore = gNumBytesAllocated.load();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    for (const Frame &frame : frames) {
+      decode(frame);
+    }
+  }
+  auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  double count = static_cast<double>(numMessages);
+  printf("%-10s %10zu msgs %8.1f ns/msg %10.0f msgs/s %6.2f allocs/msg "
+         "%8.1f bytes allocated/msg\n",
+         name, numMessages, elapsedNs / count, count * 1e9 / elapsedNs,
+         (gNumAllocations.load() - allocationsBefore) / count,
+         (gNumBytesAllocated.load() - bytesBefore) / count);
+}
+
+}  // namespace
+
+void *operator new(size_t size) {
+  gNumAllocations.fetch_add(1, std::memory_order_relaxed);
+  gNumBytesAllocated.fetch_add(size, std::memory_order_relaxed);
+  void *ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t /* size */) noexcept {
+  free(ptr);
+}
+
+int main(int argc, char **argv) {
+  size_t iterations =
+      (argc > 1) ? strtoul(argv[1], nullptr, 0) : kDefaultIterations;
+
+  std::vector<Frame> frames;
+  if (argc > 2) {
+    if (!readStream(argv[2], frames)) {
+      fprintf(stderr, "Failed to read recorded stream from %s\n", argv[2]);
+      return -1;
+    }
+  } else {
+    frames = generateStream();
+  }
+
+  // The object API path as used before nanoapp messages were read in place,
+  // where the whole container is unpacked before dispatching
+  size_t numUnpackedMessages = 0;
+  runBenchmark(
+      "unpack", frames, iterations, numUnpackedMessages,
+      [&numUnpackedMessages](const Frame &frame) {
+        if (!HostProtocolHost::verifyMessage(frame.data(), frame.size())) {
+          return;
+        }
+        std::unique_ptr<fbs::MessageContainerT> container =
+            fbs::UnPackMessageContainer(frame.data());
+        std::vector<uint8_t> messageBody;
+        if (container->message.type == fbs::ChreMessage::NanoappMessage) {
+          messageBody = container->message.AsNanoappMessage()->message;
+          numUnpackedMessages++;
+        } else if (container->message.type ==
+                   fbs::ChreMessage::NanoappMessageBatch) {
+          for (const auto &message :
+               container->message.AsNanoappMessageBatch()->messages) {
+            messageBody = message->message;
+            numUnpackedMessages++;
+          }
+        }
+      });
+
+  InPlaceMessageHandlers inPlaceHandlers;
+  runBenchmark("in-place", frames, iterations, inPlaceHandlers.mNumMessages,
+               [&inPlaceHandlers](const Frame &frame) {
+                 HostProtocolHost::decodeMessageFromChre(
+                     frame.data(), frame.size(), inPlaceHandlers);
+               });
+
+  // Handlers that only implement the object API callback, which are passed an
+  // individually unpacked copy of each nanoapp message
+  UnpackedMessageHandlers unpackedHandlers;
+  runBenchmark("default", frames, iterations, unpackedHandlers.mNumMessages,
+               [&unpackedHandlers](const Frame &frame) {
+                 HostProtocolHost::decodeMessageFromChre(
+                     frame.data(), frame.size(), unpackedHandlers);
+               });
+
+  return 0;
+}
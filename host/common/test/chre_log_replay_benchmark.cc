@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <android/log.h>
+
+#include "chre/platform/shared/deferred_log_format.h"
+#include "chre_host/file_stream.h"
+#include "chre_host/log_message_parser.h"
+
+/**
+ * @file
+ * A benchmark replaying LogMessageV2 buffers through LogMessageParser, which
+ * reports the number of logs emitted per second and the time spent per buffer
+ * on the calling thread, i.e. the time the transport read path is held up by
+ * logs. Logs are emitted either synchronously or from the parser's emitter
+ * thread.
+ *
+ * Usage:
+ *  chre_log_replay_benchmark [iterations] [logcat|null] [recorded-log-path]
+ *
+ * By default logs are formatted the way they would be for logcat without being
+ * written, so that logcat doesn't dominate the results. A recorded log is a
+ * sequence of LogMessageV2 buffers, each prefixed with its length as a 32-bit
+ * little endian integer. If none is given, a synthetic one is generated with a
+ * mix of string and deferred format string logs.
+ */
+
+using android::chre::LogMessageParser;
+using android::chre::readFileContents;
+using chre::fbs::LogType;
+
+namespace {
+
+constexpr size_t kDefaultIterations = 200;
+constexpr size_t kLogsPerBuffer = 40;
+constexpr size_t kBuffersPerStream = 50;
+constexpr uint8_t kLogLevelInfo = 3;
+
+using Buffer = std::vector<uint8_t>;
+
+std::atomic<size_t> gNumLogsEmitted{0};
+
+void appendLogHeader(Buffer &buffer, LogType type, uint32_t timestampMillis) {
+  buffer.push_back(static_cast<uint8_t>(
+      (static_cast<uint8_t>(type) << 4) | kLogLevelInfo));
+  uint32_t timestamp = htole32(timestampMillis);
+  const auto *bytes = reinterpret_cast<const uint8_t *>(&timestamp);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(timestamp));
+}
+
+void appendStringLog(Buffer &buffer, uint32_t timestampMillis,
+                     const std::string &message) {
+  appendLogHeader(buffer, LogType::STRING, timestampMillis);
+  buffer.insert(buffer.end(), message.begin(), message.end());
+  buffer.push_back('\0');
+}
+
+void appendDeferredLog(Buffer &buffer, uint32_t timestampMillis,
+                       bool defineFormat, uint32_t sample, double value) {
+  constexpr char kFormat[] = "Sensor %s sample %" PRIu32 " value %.3f";
+  constexpr char kSensorName[] = "accel";
+  Buffer payload;
+  payload.push_back(defineFormat ? chre::kDeferredLogFormatDefinitionFlag : 0);
+  if (defineFormat) {
+    payload.insert(payload.end(), kFormat, kFormat + sizeof(kFormat));
+  }
+  payload.insert(payload.end(), kSensorName,
+                 kSensorName + sizeof(kSensorName));
+  uint32_t sampleLe = htole32(sample);
+  const auto *sampleBytes = reinterpret_cast<const uint8_t *>(&sampleLe);
+  payload.insert(payload.end(), sampleBytes, sampleBytes + sizeof(sampleLe));
+  const auto *valueBytes = reinterpret_cast<const uint8_t *>(&value);
+  payload.insert(payload.end(), valueBytes, valueBytes + sizeof(value));
+
+  appendLogHeader(buffer, LogType::DEFERRED_STRING, timestampMillis);
+  buffer.push_back(static_cast<uint8_t>(payload.size()));
+  buffer.insert(buffer.end(), payload.begin(), payload.end());
+}
+
+std::vector<Buffer> generateStream() {
+  std::vector<Buffer> buffers;
+  uint32_t timestampMillis = 0;
+  for (size_t i = 0; i < kBuffersPerStream; i++) {
+    Buffer buffer;
+    for (size_t j = 0; j < kLogsPerBuffer; j++) {
+      timestampMillis++;
+      if (j % 2 == 0) {
+        appendStringLog(buffer, timestampMillis,
+                        "Nanoapp 0x476f6f676c000001 handled event " +
+                            std::to_string(timestampMillis));
+      } else {
+        appendDeferredLog(buffer, timestampMillis, j == 1 /* defineFormat */,
+                          timestampMillis, timestampMillis * 0.001);
+      }
+    }
+    buffers.push_back(std::move(buffer));
+  }
+  return buffers;
+}
+
+bool readStream(const char *path, std::vector<Buffer> &buffers) {
+  std::vector<uint8_t> contents;
+  if (!readFileContents(path, contents)) {
+    return false;
+  }
+
+  size_t offset = 0;
+  while (offset + sizeof(uint32_t) <= contents.size()) {
+    uint32_t bufferSize;
+    memcpy(&bufferSize, &contents[offset], sizeof(bufferSize));
+    bufferSize = le32toh(bufferSize);
+    offset += sizeof(bufferSize);
+    if (bufferSize > contents.size() - offset) {
+      fprintf(stderr, "Truncated log buffer at offset %zu\n", offset);
+      return false;
+    }
+    buffers.emplace_back(&contents[offset], &contents[offset + bufferSize]);
+    offset += bufferSize;
+  }
+  return !buffers.empty();
+}
+
+//! Formats each log the way it is formatted for logcat, without writing it.
+void nullSink(uint8_t /* level */, uint32_t timestampMillis,
+              const char *logMessage) {
+  char line[512];
+  snprintf(line, sizeof(line), "@ %3" PRIu32 ".%03" PRIu32 ": %s",
+           timestampMillis / 1000, timestampMillis % 1000, logMessage);
+  gNumLogsEmitted.fetch_add(1, std::memory_order_relaxed);
+}
+
+void logcatSink(uint8_t /* level */, uint32_t timestampMillis,
+                const char *logMessage) {
+  __android_log_print(ANDROID_LOG_INFO, "CHRE", "@ %3" PRIu32 ".%03" PRIu32
+                      ": %s", timestampMillis / 1000, timestampMillis % 1000,
+                      logMessage);
+  gNumLogsEmitted.fetch_add(1, std::memory_order_relaxed);
+}
+
+void runBenchmark(const char *name, bool asyncEmit, bool useLogcat,
+                  const std::vector<Buffer> &buffers, size_t iterations) {
+  LogMessageParser parser(false /* enableVerboseLogging */);
+  parser.setAsyncEmitEnabled(asyncEmit);
+  parser.setLogSink(useLogcat ? logcatSink : nullSink);
+  gNumLogsEmitted = 0;
+
+  uint64_t maxCallNs = 0;
+  uint64_t totalCallNs = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    for (const Buffer &buffer : buffers) {
+      auto callStart = std::chrono::steady_clock::now();
+      parser.logV2(buffer.data(), buffer.size(), 0 /* numLogsDropped */);
+      uint64_t callNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - callStart)
+                            .count();
+      totalCallNs += callNs;
+      maxCallNs = std::max(maxCallNs, callNs);
+    }
+  }
+  parser.flush();
+  auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  size_t numBuffers = iterations * buffers.size();
+  double numLogs = static_cast<double>(gNumLogsEmitted.load());
+  printf("%-6s %10.0f logs %10.0f logs/s %8.1f us/buffer avg %8.1f us/buffer "
+         "max on the calling thread\n",
+         name, numLogs, numLogs * 1e9 / elapsedNs,
+         totalCallNs / 1e3 / std::max<size_t>(numBuffers, 1), maxCallNs / 1e3);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  size_t iterations =
+      (argc > 1) ? strtoul(argv[1], nullptr, 0) : kDefaultIterations;
+  bool useLogcat = (argc > 2) && strcmp(argv[2], "logcat") == 0;
+
+  std::vector<Buffer> buffers;
+  if (argc > 3) {
+    if (!readStream(argv[3], buffers)) {
+      fprintf(stderr, "Failed to read recorded logs from %s\n", argv[3]);
+      return -1;
+    }
+  } else {
+    buffers = generateStream();
+  }
+
+  runBenchmark("sync", false /* asyncEmit */, useLogcat, buffers, iterations);
+  runBenchmark("async", true /* asyncEmit */, useLogcat, buffers, iterations);
+  return 0;
+}
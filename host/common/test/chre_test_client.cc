@@ -36,6 +36,7 @@
 #include "chre_host/log.h"
 #include "chre_host/napp_header.h"
 #include "chre_host/socket_client.h"
+#include "chre_host/trace_exporter.h"
 
 /**
  * @file
@@ -47,6 +48,7 @@
  *      [app-version] [api-version] [tcm-capable] [nanoapp-header-path]
  *  chre_test_client load_with_header <nanoapp-header-path> <nanoapp-so-path>
  *  chre_test_client unload <nanoapp-id>
+ *  chre_test_client trace <output-json-path>
  */
 
 using android::sp;
@@ -56,8 +58,10 @@ using android::chre::getStringFromByteVector;
 using android::chre::HostProtocolHost;
 using android::chre::IChreMessageHandlers;
 using android::chre::NanoAppBinaryHeader;
+using android::chre::mapFileContents;
 using android::chre::readFileContents;
 using android::chre::SocketClient;
+using android::chre::TraceExporter;
 using flatbuffers::FlatBufferBuilder;
 
 // Aliased for consistency with the way these symbols are referenced in
@@ -178,12 +182,32 @@ class SocketCallbacks : public SocketClient::ICallbacks,
     mResultPromise.set_value(response.success);
   }
 
+  void handleTraceData(const fbs::TraceDataT &data) override {
+    LOGI("Got trace data of %zu bytes, last %d", data.records.size(),
+         data.last);
+    if (!mTraceExporter.addTraceData(data)) {
+      mTracePromise.set_value(false);
+    } else if (mTraceExporter.isComplete()) {
+      mTracePromise.set_value(true);
+    }
+  }
+
   std::future<bool> getResultFuture() {
     return mResultPromise.get_future();
   }
 
+  std::future<bool> getTraceFuture() {
+    return mTracePromise.get_future();
+  }
+
+  const TraceExporter &getTraceExporter() const {
+    return mTraceExporter;
+  }
+
  private:
   std::promise<bool> mResultPromise;
+  std::promise<bool> mTracePromise;
+  TraceExporter mTraceExporter;
 };
 
 void requestHubInfo(SocketClient &client) {
@@ -222,9 +246,10 @@ void sendMessageToNanoapp(SocketClient &client) {
 
 void sendNanoappLoad(SocketClient &client, uint64_t appId, uint32_t appVersion,
                      uint32_t apiVersion, uint32_t appFlags,
-                     const std::vector<uint8_t> &binary) {
+                     std::shared_ptr<const uint8_t> binary, size_t binarySize) {
   FragmentedLoadTransaction transaction = FragmentedLoadTransaction(
-      1 /* transactionId */, appId, appVersion, appFlags, apiVersion, binary);
+      1 /* transactionId */, appId, appVersion, appFlags, apiVersion,
+      std::move(binary), binarySize);
 
   bool success = true;
   while (!transaction.isComplete()) {
@@ -271,9 +296,10 @@ void sendNanoappLoad(SocketClient &client, uint64_t appId, uint32_t appVersion,
 void sendLoadNanoappRequest(SocketClient &client, const char *headerPath,
                             const char *binaryPath) {
   std::vector<uint8_t> headerBuffer;
-  std::vector<uint8_t> binaryBuffer;
+  std::shared_ptr<const uint8_t> binary;
+  size_t binarySize;
   if (readFileContents(headerPath, headerBuffer) &&
-      readFileContents(binaryPath, binaryBuffer)) {
+      mapFileContents(binaryPath, binary, binarySize)) {
     if (headerBuffer.size() != sizeof(NanoAppBinaryHeader)) {
       LOGE("Header size mismatch");
     } else {
@@ -286,7 +312,8 @@ void sendLoadNanoappRequest(SocketClient &client, const char *headerPath,
                                   (appHeader->targetChreApiMinorVersion << 16);
 
       sendNanoappLoad(client, appHeader->appId, appHeader->appVersion,
-                      targetApiVersion, appHeader->flags, binaryBuffer);
+                      targetApiVersion, appHeader->flags, std::move(binary),
+                      binarySize);
     }
   }
 }
@@ -294,15 +321,17 @@ void sendLoadNanoappRequest(SocketClient &client, const char *headerPath,
 void sendLoadNanoappRequest(SocketClient &client, const char *filename,
                             uint64_t appId, uint32_t appVersion,
                             uint32_t apiVersion, bool tcmApp) {
-  std::vector<uint8_t> buffer;
-  if (readFileContents(filename, buffer)) {
+  std::shared_ptr<const uint8_t> binary;
+  size_t binarySize;
+  if (mapFileContents(filename, binary, binarySize)) {
     // All loaded nanoapps must be signed currently.
     uint32_t appFlags = CHRE_NAPP_HEADER_SIGNED;
     if (tcmApp) {
       appFlags |= CHRE_NAPP_HEADER_TCM_CAPABLE;
     }
 
-    sendNanoappLoad(client, appId, appVersion, apiVersion, appFlags, buffer);
+    sendNanoappLoad(client, appId, appVersion, apiVersion, appFlags,
+                    std::move(binary), binarySize);
   }
 }
 
@@ -329,6 +358,16 @@ void sendSelfTestRequest(SocketClient &client) {
   }
 }
 
+void sendTraceDataRequest(SocketClient &client) {
+  FlatBufferBuilder builder(48);
+  HostProtocolHost::encodeTraceDataRequest(builder);
+
+  LOGI("Sending trace data request");
+  if (!client.sendMessage(builder.GetBufferPointer(), builder.GetSize())) {
+    LOGE("Failed to send message");
+  }
+}
+
 }  // anonymous namespace
 
 static void usage(const std::string &name) {
@@ -340,7 +379,8 @@ static void usage(const std::string &name) {
       name +
       " load <nanoapp-id> <nanoapp-so-path> [app-version] [api-version]\n  " +
       name + " load_with_header <nanoapp-header-path> <nanoapp-so-path>\n  " +
-      name + " unload <nanoapp-id>\n " + name + " self_test\n";
+      name + " unload <nanoapp-id>\n " + name + " self_test\n  " + name +
+      " trace <output-json-path>\n";
 
   LOGI("%s", output.c_str());
 }
@@ -433,6 +473,34 @@ int main(int argc, char *argv[]) {
     } else {
       success = future.get();
     }
+  } else if (cmd == "trace") {
+    const std::string path{argi < argc ? argv[argi++] : ""};
+
+    if (path.empty()) {
+      LOGE("Arguments not provided!");
+      usage(name);
+      success = false;
+    } else {
+      sendTraceDataRequest(client);
+
+      std::future<bool> future = callbacks->getTraceFuture();
+      std::future_status status = future.wait_for(std::chrono::seconds(5));
+
+      if (status != std::future_status::ready) {
+        LOGE("Trace data request timed out");
+        success = false;
+      } else if (!future.get()) {
+        LOGE("Received malformed trace data");
+        success = false;
+      } else {
+        const TraceExporter &exporter = callbacks->getTraceExporter();
+        std::ofstream file(path);
+        exporter.writeChromeJson(file);
+        success = file.good();
+        LOGI("Wrote %zu trace records to %s, %" PRIu32 " dropped",
+             exporter.getNumRecords(), path.c_str(), exporter.getNumDropped());
+      }
+    }
   } else {
     LOGE("Invalid command provided!");
     usage(name);
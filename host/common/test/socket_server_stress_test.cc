@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <utils/StrongPointer.h>
+
+#include "chre_host/socket_client.h"
+#include "chre_host/socket_server.h"
+
+/**
+ * @file
+ * A stress test for SocketServer that runs a server in-process, connects a
+ * number of local SocketClients to it, some of which are slow to read their
+ * messages, and broadcasts a stream of messages to all of them. Verifies that
+ * every client receives its messages in order, that messages to fast clients
+ * aren't dropped, and that broadcasting isn't blocked by slow clients.
+ *
+ * Usage:
+ *  socket_server_stress_test [num-clients] [num-slow-clients] [num-messages]
+ */
+
+using android::sp;
+using android::chre::SocketClient;
+using android::chre::SocketServer;
+
+namespace {
+
+constexpr char kSocketName[] = "chre_socket_server_stress_test";
+constexpr size_t kDefaultNumClients = 6;
+constexpr size_t kDefaultNumSlowClients = 2;
+constexpr uint32_t kDefaultNumMessages = 20000;
+constexpr size_t kMessageSize = 512;
+constexpr auto kSlowClientDelay = std::chrono::microseconds(500);
+//! The interval between broadcasts, which is far beyond the rate CHRE sends
+//! messages at, but low enough for fast clients to keep up.
+constexpr auto kBroadcastInterval = std::chrono::microseconds(20);
+constexpr auto kTimeout = std::chrono::seconds(30);
+
+class StressTestCallbacks : public SocketClient::ICallbacks {
+ public:
+  explicit StressTestCallbacks(bool slow) : mSlow(slow) {}
+
+  void onMessageReceived(const void *data, size_t length) override {
+    uint32_t sequenceNumber;
+    if (length != kMessageSize) {
+      mNumErrors++;
+      return;
+    }
+    memcpy(&sequenceNumber, data, sizeof(sequenceNumber));
+
+    // Messages may be dropped for slow clients, but never reordered
+    if (mNumReceived > 0 && sequenceNumber <= mLastSequenceNumber) {
+      mNumErrors++;
+    }
+    mLastSequenceNumber = sequenceNumber;
+    mNumReceived++;
+
+    if (mSlow) {
+      std::this_thread::sleep_for(kSlowClientDelay);
+    }
+  }
+
+  const bool mSlow;
+  std::atomic<uint32_t> mNumReceived{0};
+  std::atomic<uint32_t> mNumErrors{0};
+  uint32_t mLastSequenceNumber = 0;
+};
+
+struct Client {
+  SocketClient socketClient;
+  sp<StressTestCallbacks> callbacks;
+};
+
+void onSignal(int /* signal */) {}
+
+template <typename Predicate>
+bool waitFor(Predicate predicate) {
+  auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (!predicate()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  size_t numClients = (argc > 1) ? strtoul(argv[1], nullptr, 0)
+                                 : kDefaultNumClients;
+  size_t numSlowClients = (argc > 2) ? strtoul(argv[2], nullptr, 0)
+                                     : kDefaultNumSlowClients;
+  uint32_t numMessages = (argc > 3) ? strtoul(argv[3], nullptr, 0)
+                                    : kDefaultNumMessages;
+  numSlowClients = std::min(numSlowClients, numClients);
+
+  // The server thread is interrupted with SIGINT to exit its epoll loop
+  struct sigaction action = {};
+  action.sa_handler = onSignal;
+  sigaction(SIGINT, &action, nullptr);
+
+  SocketServer server;
+  std::thread serverThread([&server]() {
+    server.run(kSocketName, true /* allowSocketCreation */,
+               [](uint16_t /* clientId */, void * /* data */,
+                  size_t /* length */) {});
+  });
+
+  std::vector<std::unique_ptr<Client>> clients;
+  for (size_t i = 0; i < numClients; i++) {
+    auto client = std::make_unique<Client>();
+    client->callbacks = new StressTestCallbacks(i < numSlowClients);
+    if (!waitFor([&client]() {
+          return client->socketClient.connect(kSocketName, client->callbacks);
+        })) {
+      fprintf(stderr, "Couldn't connect client %zu\n", i);
+      return -1;
+    }
+    clients.push_back(std::move(client));
+  }
+  if (!waitFor([&]() {
+        return server.getClientMetrics().size() == numClients;
+      })) {
+    fprintf(stderr, "Server didn't accept all clients\n");
+    return -1;
+  }
+
+  std::vector<uint8_t> message(kMessageSize);
+  uint64_t maxSendNs = 0;
+  uint64_t totalSendNs = 0;
+  for (uint32_t i = 0; i < numMessages; i++) {
+    memcpy(message.data(), &i, sizeof(i));
+    auto sendStart = std::chrono::steady_clock::now();
+    server.sendToAllClients(message.data(), message.size());
+    uint64_t sendNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - sendStart)
+                          .count();
+    totalSendNs += sendNs;
+    maxSendNs = std::max(maxSendNs, sendNs);
+    std::this_thread::sleep_until(sendStart + kBroadcastInterval);
+  }
+
+  // Wait for the fast clients to receive everything and for all backlogs to
+  // drain before checking the results
+  bool drained = waitFor([&]() {
+    for (const SocketServer::ClientMetrics &metrics :
+         server.getClientMetrics()) {
+      if (metrics.backlogMessages != 0) {
+        return false;
+      }
+    }
+    for (const auto &client : clients) {
+      if (!client->callbacks->mSlow &&
+          client->callbacks->mNumReceived != numMessages) {
+        return false;
+      }
+    }
+    return true;
+  });
+  // Give slow clients time to read what's left in their socket buffers
+  uint32_t lastReceived = 0;
+  waitFor([&]() {
+    uint32_t received = 0;
+    for (const auto &client : clients) {
+      received += client->callbacks->mNumReceived;
+    }
+    bool done = (received == lastReceived);
+    lastReceived = received;
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    return done;
+  });
+
+  printf("Broadcast %" PRIu32 " messages of %zu bytes to %zu clients "
+         "(%zu slow): avg %" PRIu64 " ns, max %" PRIu64 " ns per broadcast\n",
+         numMessages, kMessageSize, numClients, numSlowClients,
+         totalSendNs / std::max<uint32_t>(numMessages, 1), maxSendNs);
+
+  bool success = drained;
+  std::vector<SocketServer::ClientMetrics> metrics = server.getClientMetrics();
+  std::sort(metrics.begin(), metrics.end(), [](const auto &a, const auto &b) {
+    return a.clientId < b.clientId;
+  });
+  for (size_t i = 0; i < clients.size(); i++) {
+    const StressTestCallbacks &callbacks = *clients[i]->callbacks;
+    const SocketServer::ClientMetrics &clientMetrics = metrics[i];
+    printf("Client %" PRIu16 " (%s): received %" PRIu32 " errors %" PRIu32
+           " sent %" PRIu64 " queued %" PRIu64 " dropped %" PRIu64
+           " max backlog %zu\n",
+           clientMetrics.clientId, callbacks.mSlow ? "slow" : "fast",
+           callbacks.mNumReceived.load(), callbacks.mNumErrors.load(),
+           clientMetrics.messagesSent, clientMetrics.messagesQueued,
+           clientMetrics.messagesDropped, clientMetrics.maxBacklogMessages);
+
+    if (callbacks.mNumErrors != 0 ||
+        clientMetrics.messagesSent + clientMetrics.messagesDropped !=
+            numMessages ||
+        callbacks.mNumReceived != clientMetrics.messagesSent ||
+        (!callbacks.mSlow && callbacks.mNumReceived != numMessages)) {
+      success = false;
+    }
+  }
+
+  for (const auto &client : clients) {
+    client->socketClient.disconnect();
+  }
+  SocketServer::shutdownServer();
+  pthread_kill(serverThread.native_handle(), SIGINT);
+  serverThread.join();
+
+  printf("%s\n", success ? "PASS" : "FAIL");
+  return success ? 0 : -1;
+}
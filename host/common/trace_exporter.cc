@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre_host/trace_exporter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <set>
+
+#include "chre_host/log.h"
+
+namespace android {
+namespace chre {
+
+namespace {
+
+//! The offset of the group of a record without one.
+constexpr uint16_t kNoGroup = 0xffff;
+
+//! The types of the records, see host_messages.fbs.
+constexpr uint8_t kTypeInstant = 0;
+constexpr uint8_t kTypeStart = 1;
+constexpr uint8_t kTypeEnd = 2;
+
+uint64_t readLittleEndian(const uint8_t *data, size_t size) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; i++) {
+    value |= static_cast<uint64_t>(data[i]) << (8 * i);
+  }
+  return value;
+}
+
+/**
+ * Reads the null-terminated string at an offset of TraceData::strings.
+ */
+std::optional<std::string> readString(const std::vector<int8_t> &strings,
+                                      uint16_t offset) {
+  auto begin = strings.begin() + std::min<size_t>(offset, strings.size());
+  auto end = std::find(begin, strings.end(), 0);
+  if (offset >= strings.size() || end == strings.end()) {
+    return std::nullopt;
+  }
+  return std::string(begin, end);
+}
+
+const char *getPhase(uint8_t type) {
+  switch (type) {
+    case kTypeStart:
+      return "B";
+    case kTypeEnd:
+      return "E";
+    default:
+      return "i";
+  }
+}
+
+}  // anonymous namespace
+
+bool TraceExporter::addTraceData(const ::chre::fbs::TraceDataT &data) {
+  if (data.records.size() % kRecordSize != 0) {
+    LOGE("Trace data of %zu bytes isn't a whole number of records",
+         data.records.size());
+    return false;
+  }
+
+  std::vector<Record> records;
+  for (size_t i = 0; i < data.records.size(); i += kRecordSize) {
+    const uint8_t *raw = &data.records[i];
+    Record record;
+    record.timestampNs = readLittleEndian(raw, sizeof(uint64_t));
+    record.traceId = static_cast<uint32_t>(readLittleEndian(raw + 8, 4));
+    auto labelOffset = static_cast<uint16_t>(readLittleEndian(raw + 12, 2));
+    auto groupOffset = static_cast<uint16_t>(readLittleEndian(raw + 14, 2));
+    record.type = raw[16];
+    record.thread = raw[17];
+
+    std::optional<std::string> label = readString(data.strings, labelOffset);
+    if (!label.has_value() || record.type > kTypeEnd) {
+      LOGE("Malformed trace record at offset %zu", i);
+      return false;
+    }
+    record.label = std::move(*label);
+    if (groupOffset != kNoGroup) {
+      record.group = readString(data.strings, groupOffset);
+      if (!record.group.has_value()) {
+        LOGE("Malformed trace record group at offset %zu", i);
+        return false;
+      }
+    }
+    records.push_back(std::move(record));
+  }
+
+  mRecords.insert(mRecords.end(), std::make_move_iterator(records.begin()),
+                  std::make_move_iterator(records.end()));
+  mNumDropped += data.num_dropped;
+  mComplete = mComplete || data.last;
+  return true;
+}
+
+void TraceExporter::writeChromeJson(std::ostream &out) const {
+  std::vector<const Record *> sorted;
+  std::set<uint8_t> threads;
+  for (const Record &record : mRecords) {
+    sorted.push_back(&record);
+    threads.insert(record.thread);
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const Record *a, const Record *b) {
+                     return a->timestampNs < b->timestampNs;
+                   });
+
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  for (uint8_t thread : threads) {
+    out << (first ? "\n" : ",\n")
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":"
+        << static_cast<int>(thread) << ",\"args\":{\"name\":\"CHRE thread "
+        << static_cast<int>(thread) << "\"}}";
+    first = false;
+  }
+
+  for (const Record *record : sorted) {
+    // Timestamps are in microseconds, keeping the nanoseconds as decimals
+    char timestamp[32];
+    snprintf(timestamp, sizeof(timestamp), "%" PRIu64 ".%03" PRIu64,
+             record->timestampNs / 1000, record->timestampNs % 1000);
+
+    out << (first ? "\n" : ",\n") << "{\"name\":";
+    writeJsonString(out, record->label);
+    if (record->group.has_value()) {
+      out << ",\"cat\":";
+      writeJsonString(out, *record->group);
+    }
+    out << ",\"ph\":\"" << getPhase(record->type) << "\"";
+    if (record->type == kTypeInstant) {
+      out << ",\"s\":\"t\"";
+    }
+    out << ",\"ts\":" << timestamp
+        << ",\"pid\":0,\"tid\":" << static_cast<int>(record->thread)
+        << ",\"args\":{\"trace_id\":" << record->traceId << "}}";
+    first = false;
+  }
+
+  out << "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"droppedRecords\":"
+      << mNumDropped << "}}\n";
+}
+
+void TraceExporter::writeJsonString(std::ostream &out, const std::string &str) {
+  out << '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x",
+               static_cast<unsigned char>(c));
+      out << escaped;
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+}  // namespace chre
+}  // namespace android
@@ -219,11 +219,12 @@ bool ExynosDaemon::sendFragmentedNanoappLoad(
     uint64_t appId, uint32_t appVersion, uint32_t appFlags,
     uint32_t appTargetApiVersion, const uint8_t *appBinary, size_t appSize,
     uint32_t transactionId) {
-  std::vector<uint8_t> binary(appSize);
-  std::copy(appBinary, appBinary + appSize, binary.begin());
-
+  // The transaction doesn't outlive appBinary, so it can refer to it without
+  // owning or copying it
+  std::shared_ptr<const uint8_t> binary(std::shared_ptr<void>(), appBinary);
   FragmentedLoadTransaction transaction(transactionId, appId, appVersion,
-                                        appFlags, appTargetApiVersion, binary);
+                                        appFlags, appTargetApiVersion,
+                                        std::move(binary), appSize);
 
   bool success = true;
 
@@ -367,7 +367,7 @@ void ContextHub::onNanoappMessage(const ::chre::fbs::NanoappMessageT &message) {
     outMessage.messageBody = message.message;
     outMessage.permissions = chreToAndroidPermissions(message.permissions);
 
-    std::vector<std::string> messageContentPerms =
+    const std::vector<std::string> &messageContentPerms =
         chreToAndroidPermissions(message.message_permissions);
     mCallback->handleContextHubMessage(outMessage, messageContentPerms);
   }
@@ -54,6 +54,15 @@ class ChreConnection {
     return CHRE_HOST_DEFAULT_FRAGMENT_SIZE;
   }
 
+  /**
+   * @return The number of preloaded nanoapps that may be loaded at the same
+   *         time. This must not exceed CHRE_NANOAPP_LOAD_MAX_CONCURRENT in the
+   *         CHRE build, or concurrent loads will replace one another.
+   */
+  virtual size_t getMaxConcurrentNanoappLoads() const {
+    return 1;
+  }
+
   /**
    * Sends a message encapsulated in a FlatBufferBuilder to CHRE.
    *
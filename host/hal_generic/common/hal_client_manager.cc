@@ -32,6 +32,25 @@ using ::aidl::android::hardware::contexthub::IContextHubCallback;
 
 namespace {
 using Client = HalClientManager::Client;
+
+/** A scoped shared lock understood by the thread safety analysis. */
+class SCOPED_CAPABILITY SharedLock {
+ public:
+  explicit SharedLock(std::shared_mutex &mutex) ACQUIRE_SHARED(mutex)
+      : mMutex(mutex) {
+    mMutex.lock_shared();
+  }
+  ~SharedLock() RELEASE() {
+    mMutex.unlock_shared();
+  }
+
+  SharedLock(const SharedLock &) = delete;
+  SharedLock &operator=(const SharedLock &) = delete;
+
+ private:
+  std::shared_mutex &mMutex;
+};
+
 bool getClientMappingsFromFile(const std::string &filePath,
                                Json::Value &mappings) {
   std::fstream file(filePath);
@@ -83,30 +102,44 @@ std::string HalClientManager::getUuid(
   return oStringStream.str();
 }
 
-Client *HalClientManager::getClientByField(
-    const std::function<bool(const Client &client)> &fieldMatcher) {
-  for (Client &client : mClients) {
-    if (fieldMatcher(client)) {
-      return &client;
-    }
-  }
-  return nullptr;
-}
-
 Client *HalClientManager::getClientByClientId(HalClientId clientId) {
-  return getClientByField([&clientId](const Client &client) {
-    return client.clientId == clientId;
-  });
+  return getClientFromIndex(mClientIdToIndex, clientId);
 }
 
 Client *HalClientManager::getClientByUuid(const std::string &uuid) {
-  return getClientByField(
-      [&uuid](const Client &client) { return client.uuid == uuid; });
+  return getClientFromIndex(mUuidToIndex, uuid);
 }
 
 Client *HalClientManager::getClientByProcessId(pid_t pid) {
-  return getClientByField(
-      [&pid](const Client &client) { return client.pid == pid; });
+  return getClientFromIndex(mPidToIndex, pid);
+}
+
+void HalClientManager::addClient(Client &&client) {
+  size_t index = mClients.size();
+  // Like a scan over mClients, the first client with a given key is found.
+  mClientIdToIndex.emplace(client.clientId, index);
+  mUuidToIndex.emplace(client.uuid, index);
+  if (client.pid != Client::kPidUnset) {
+    mPidToIndex.emplace(client.pid, index);
+  }
+  mClients.push_back(std::move(client));
+}
+
+void HalClientManager::resetClient(
+    Client &client, pid_t pid,
+    const std::shared_ptr<IContextHubCallback> &callback,
+    void *deathRecipientCookie) {
+  if (client.pid != Client::kPidUnset) {
+    auto iter = mPidToIndex.find(client.pid);
+    if (iter != mPidToIndex.end() && iter->second == getClientIndex(client)) {
+      mPidToIndex.erase(iter);
+    }
+  }
+  client.reset(/* processId= */ pid, /* contextHubCallback= */ callback,
+               /* cookie= */ deathRecipientCookie);
+  if (pid != Client::kPidUnset) {
+    mPidToIndex.emplace(pid, getClientIndex(client));
+  }
 }
 
 bool HalClientManager::updateNextClientId() {
@@ -138,15 +171,15 @@ bool HalClientManager::createClient(
          mClients.size());
     return false;
   }
-  mClients.emplace_back(uuid, getName(callback), mNextClientId, pid, callback,
-                        deathRecipientCookie);
+  addClient(Client(uuid, getName(callback), mNextClientId, pid, callback,
+                   deathRecipientCookie));
   updateClientIdMappingFile();
   updateNextClientId();
   return true;
 }
 
 HalClientId HalClientManager::getClientId(pid_t pid) {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const SharedLock lock(mLock);
   const Client *client = getClientByProcessId(pid);
   if (client == nullptr) {
     LOGE("Failed to find the client id for pid %d", pid);
@@ -157,7 +190,7 @@ HalClientId HalClientManager::getClientId(pid_t pid) {
 
 std::shared_ptr<IContextHubCallback> HalClientManager::getCallback(
     HalClientId clientId) {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const SharedLock lock(mLock);
   const Client *client = getClientByClientId(clientId);
   if (client == nullptr) {
     LOGE("Failed to find the callback for the client id %" PRIu16, clientId);
@@ -169,7 +202,7 @@ std::shared_ptr<IContextHubCallback> HalClientManager::getCallback(
 bool HalClientManager::registerCallback(
     pid_t pid, const std::shared_ptr<IContextHubCallback> &callback,
     void *deathRecipientCookie) {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const std::lock_guard<std::shared_mutex> lock(mLock);
   Client *client = getClientByProcessId(pid);
   if (client != nullptr) {
     LOGW("The pid %d has already registered. Overriding its callback.", pid);
@@ -196,9 +229,7 @@ bool HalClientManager::registerCallback(
     }
 
     // For a known client the previous assigned clientId will be reused.
-    client->reset(/* processId= */ pid,
-                  /* contextHubCallback= */ callback,
-                  /* cookie= */ deathRecipientCookie);
+    resetClient(*client, pid, callback, deathRecipientCookie);
 
     // Updates a client's name only if it is changed from Client::NAME_UNSET.
     std::string name = getName(callback);
@@ -212,7 +243,7 @@ bool HalClientManager::registerCallback(
 }
 
 void HalClientManager::handleClientDeath(pid_t pid) {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const std::lock_guard<std::shared_mutex> lock(mLock);
   Client *client = getClientByProcessId(pid);
   if (client == nullptr) {
     LOGE("Failed to locate the dead pid %d", pid);
@@ -222,8 +253,8 @@ void HalClientManager::handleClientDeath(pid_t pid) {
   if (!mDeadClientUnlinker(client->callback, client->deathRecipientCookie)) {
     LOGE("Unable to unlink the old callback for pid %d in death handler", pid);
   }
-  client->reset(/* processId= */ Client::kPidUnset,
-                /* contextHubCallback= */ nullptr, /* cookie= */ nullptr);
+  resetClient(*client, Client::kPidUnset, /* callback= */ nullptr,
+              /* deathRecipientCookie= */ nullptr);
 
   if (mPendingLoadTransaction.has_value() &&
       mPendingLoadTransaction->clientId == client->clientId) {
@@ -243,7 +274,7 @@ bool HalClientManager::registerPendingLoadTransaction(
     return false;
   }
 
-  const std::lock_guard<std::mutex> lock(mLock);
+  const std::lock_guard<std::shared_mutex> lock(mLock);
   const Client *client = getClientByProcessId(pid);
   if (client == nullptr) {
     LOGE("Unknown HAL client when registering its pending load transaction.");
@@ -260,7 +291,7 @@ bool HalClientManager::registerPendingLoadTransaction(
 
 std::optional<chre::FragmentedLoadRequest>
 HalClientManager::getNextFragmentedLoadRequest() {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const std::lock_guard<std::shared_mutex> lock(mLock);
   if (mPendingLoadTransaction->transaction->isComplete()) {
     LOGI("Pending load transaction %" PRIu32
          " is finished with client %" PRIu16,
@@ -279,7 +310,7 @@ HalClientManager::getNextFragmentedLoadRequest() {
 bool HalClientManager::registerPendingUnloadTransaction(pid_t pid,
                                                         uint32_t transactionId,
                                                         int64_t nanoappId) {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const std::lock_guard<std::shared_mutex> lock(mLock);
   const Client *client = getClientByProcessId(pid);
   if (client == nullptr) {
     LOGE("Unknown HAL client when registering its pending unload transaction.");
@@ -344,7 +375,7 @@ bool HalClientManager::isNewTransactionAllowed(HalClientId clientId) {
 
 bool HalClientManager::registerEndpointId(pid_t pid,
                                           const HostEndpointId &endpointId) {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const std::lock_guard<std::shared_mutex> lock(mLock);
   Client *client = getClientByProcessId(pid);
   if (client == nullptr) {
     LOGE(
@@ -371,7 +402,7 @@ bool HalClientManager::registerEndpointId(pid_t pid,
 
 bool HalClientManager::removeEndpointId(pid_t pid,
                                         const HostEndpointId &endpointId) {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const std::lock_guard<std::shared_mutex> lock(mLock);
   Client *client = getClientByProcessId(pid);
   if (client == nullptr) {
     LOGE(
@@ -397,7 +428,7 @@ bool HalClientManager::removeEndpointId(pid_t pid,
 
 std::shared_ptr<IContextHubCallback> HalClientManager::getCallbackForEndpoint(
     const HostEndpointId mutatedEndpointId) {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const SharedLock lock(mLock);
   Client *client;
   if (mutatedEndpointId & kVendorEndpointIdBitMask) {
     HalClientId clientId =
@@ -427,7 +458,7 @@ std::shared_ptr<IContextHubCallback> HalClientManager::getCallbackForEndpoint(
 void HalClientManager::sendMessageForAllCallbacks(
     const ContextHubMessage &message,
     const std::vector<std::string> &messageParams) {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const SharedLock lock(mLock);
   for (const auto &client : mClients) {
     if (client.callback != nullptr) {
       client.callback->handleContextHubMessage(message, messageParams);
@@ -437,7 +468,7 @@ void HalClientManager::sendMessageForAllCallbacks(
 
 std::optional<std::unordered_set<HostEndpointId>>
 HalClientManager::getAllConnectedEndpoints(pid_t pid) {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const SharedLock lock(mLock);
   const Client *client = getClientByProcessId(pid);
   if (client == nullptr) {
     LOGE("Unknown HAL client with pid %d", pid);
@@ -448,7 +479,7 @@ HalClientManager::getAllConnectedEndpoints(pid_t pid) {
 
 bool HalClientManager::mutateEndpointIdFromHostIfNeeded(
     pid_t pid, HostEndpointId &endpointId) {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const SharedLock lock(mLock);
   const Client *client = getClientByProcessId(pid);
   if (client == nullptr) {
     LOGE("Unknown HAL client with pid %d", pid);
@@ -477,6 +508,7 @@ HalClientManager::HalClientManager(
   mDeadClientUnlinker = std::move(deadClientUnlinker);
   mClientMappingFilePath = clientIdMappingFilePath;
   mReservedClientIds = reservedClientIds;
+  std::lock_guard<std::shared_mutex> lock{mLock};
   // Parses the file to construct a mapping from process names to client ids.
   Json::Value mappings;
   if (!getClientMappingsFromFile(mClientMappingFilePath, mappings)) {
@@ -495,17 +527,16 @@ HalClientManager::HalClientManager(
       std::string uuid = mapping[kJsonUuid].asString();
       std::string name = mapping[kJsonName].asString();
       auto clientId = static_cast<HalClientId>(mapping[kJsonClientId].asUInt());
-      mClients.emplace_back(uuid, name, clientId);
+      addClient(Client(uuid, name, clientId));
     }
   }
-  std::lock_guard<std::mutex> lock{mLock};
   updateNextClientId();
 }
 
 std::optional<HalClientManager::PendingLoadNanoappInfo>
 HalClientManager::getNanoappInfoFromPendingLoadTransaction(
     HalClientId clientId, uint32_t transactionId, uint32_t currentFragmentId) {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const std::lock_guard<std::shared_mutex> lock(mLock);
   bool success =
       isPendingTransactionMatched(clientId, transactionId,
                                   mPendingLoadTransaction) &&
@@ -532,13 +563,13 @@ HalClientManager::getNanoappInfoFromPendingLoadTransaction(
 }
 
 void HalClientManager::resetPendingLoadTransaction() {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const std::lock_guard<std::shared_mutex> lock(mLock);
   mPendingLoadTransaction.reset();
 }
 
 std::optional<int64_t> HalClientManager::resetPendingUnloadTransaction(
     HalClientId clientId, uint32_t transactionId) {
-  const std::lock_guard<std::mutex> lock(mLock);
+  const std::lock_guard<std::shared_mutex> lock(mLock);
   // Only clear a pending transaction when the client id and the transaction id
   // are both matched
   if (isPendingTransactionMatched(clientId, transactionId,
@@ -556,7 +587,7 @@ std::optional<int64_t> HalClientManager::resetPendingUnloadTransaction(
 void HalClientManager::handleChreRestart() {
   std::vector<std::shared_ptr<IContextHubCallback>> callbacks;
   {
-    const std::lock_guard<std::mutex> lock(mLock);
+    const std::lock_guard<std::shared_mutex> lock(mLock);
     mPendingLoadTransaction.reset();
     mPendingUnloadTransaction.reset();
     for (Client &client : mClients) {
@@ -598,7 +629,7 @@ std::string HalClientManager::debugDump() {
             "{endpointIds, in 'original (mutated)' format, sorted}\n";
 
   // Dump states of each client.
-  const std::lock_guard<std::mutex> lock(mLock);
+  const SharedLock lock(mLock);
 
   std::vector<HostEndpointId> endpointIds;
   for (const auto &client : mClients) {
@@ -25,6 +25,7 @@
 #include <sys/types.h>
 #include <cstddef>
 #include <optional>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -85,6 +86,11 @@ namespace android::hardware::contexthub::common::implementation {
  *
  * Note that HalClientManager is not responsible for generating endpoint ids,
  * which should be managed by HAL clients themselves.
+ *
+ * Clients are indexed by client id, uuid and pid so that the lookups made for
+ * every message don't scan all the clients. The client of an endpoint is
+ * derived from the mutated endpoint id, so it's found through the same indices.
+ * Paths that only look clients up take mLock in shared mode.
  */
 class HalClientManager {
  public:
@@ -474,15 +480,38 @@ class HalClientManager {
   std::string getUuid(const std::shared_ptr<IContextHubCallback> &callback)
       REQUIRES(mLock);
 
-  Client *getClientByField(
-      const std::function<bool(const Client &client)> &fieldMatcher)
-      REQUIRES(mLock);
+  /**
+   * Finds a client through one of the client indices.
+   *
+   * @return the client, or nullptr if none is indexed under the key.
+   */
+  template <typename Key>
+  Client *getClientFromIndex(const std::unordered_map<Key, size_t> &index,
+                             const Key &key) REQUIRES_SHARED(mLock) {
+    auto iter = index.find(key);
+    return iter == index.end() ? nullptr : &mClients[iter->second];
+  }
+
+  Client *getClientByClientId(HalClientId clientId) REQUIRES_SHARED(mLock);
 
-  Client *getClientByClientId(HalClientId clientId) REQUIRES(mLock);
+  Client *getClientByUuid(const std::string &uuid) REQUIRES_SHARED(mLock);
 
-  Client *getClientByUuid(const std::string &uuid) REQUIRES(mLock);
+  Client *getClientByProcessId(pid_t pid) REQUIRES_SHARED(mLock);
 
-  Client *getClientByProcessId(pid_t pid) REQUIRES(mLock);
+  /** Adds a client to mClients and the client indices. */
+  void addClient(Client &&client) REQUIRES(mLock);
+
+  /**
+   * Resets a client through Client::reset(), keeping the pid index up to date.
+   */
+  void resetClient(Client &client, pid_t pid,
+                   const std::shared_ptr<IContextHubCallback> &callback,
+                   void *deathRecipientCookie) REQUIRES(mLock);
+
+  /** Returns the position of the client in mClients. */
+  size_t getClientIndex(const Client &client) REQUIRES_SHARED(mLock) {
+    return static_cast<size_t>(&client - mClients.data());
+  }
 
   DeadClientUnlinker mDeadClientUnlinker{};
 
@@ -495,10 +524,16 @@ class HalClientManager {
   std::unordered_set<HalClientId> mReservedClientIds;
 
   // The lock guarding the access to clients' states and pending transactions
-  std::mutex mLock;
+  std::shared_mutex mLock;
 
+  // Clients are never removed, so indices into mClients stay valid.
   std::vector<Client> mClients GUARDED_BY(mLock);
 
+  // Indices of mClients. A client is only indexed by pid while it's connected.
+  std::unordered_map<HalClientId, size_t> mClientIdToIndex GUARDED_BY(mLock);
+  std::unordered_map<std::string, size_t> mUuidToIndex GUARDED_BY(mLock);
+  std::unordered_map<pid_t, size_t> mPidToIndex GUARDED_BY(mLock);
+
   // States tracking pending transactions
   std::optional<PendingLoadTransaction> mPendingLoadTransaction
       GUARDED_BY(mLock) = std::nullopt;
@@ -208,10 +208,13 @@ ScopedAStatus MultiClientContextHubBase::loadNanoapp(
                               (appBinary.targetChreApiMinorVersion << 16);
   auto nanoappBuffer =
       std::make_shared<std::vector<uint8_t>>(appBinary.customBinary);
-  mLogger.onNanoappLoadStarted(appBinary.nanoappId, nanoappBuffer);
+  mLogger.onNanoappLoadStarted(
+      appBinary.nanoappId,
+      std::shared_ptr<const uint8_t>(nanoappBuffer, nanoappBuffer->data()),
+      nanoappBuffer->size());
   auto transaction = std::make_unique<FragmentedLoadTransaction>(
       transactionId, appBinary.nanoappId, appBinary.nanoappVersion,
-      appBinary.flags, targetApiVersion, appBinary.customBinary,
+      appBinary.flags, targetApiVersion, nanoappBuffer,
       mConnection->getLoadFragmentSizeBytes());
   pid_t pid = AIBinder_getCallingPid();
   if (!mHalClientManager->registerPendingLoadTransaction(
@@ -626,22 +629,31 @@ void MultiClientContextHubBase::handleMessageFromChre(
     LOGE("Invalid message received from CHRE.");
     return;
   }
-  std::unique_ptr<fbs::MessageContainerT> container =
-      fbs::UnPackMessageContainer(messageBuffer);
-  fbs::ChreMessageUnion &message = container->message;
-  HalClientId clientId = container->host_addr->client_id();
+  // Read the container in place rather than unpacking it via the object API,
+  // so that high rate messages (nanoapp messages and logs) are never copied
+  // into intermediate containers. Less frequent responses are unpacked
+  // individually.
+  const fbs::MessageContainer *container =
+      fbs::GetMessageContainer(messageBuffer);
+  HalClientId clientId = container->host_addr()->client_id();
 
-  switch (container->message.type) {
+  switch (container->message_type()) {
     case fbs::ChreMessage::HubInfoResponse: {
-      handleHubInfoResponse(*message.AsHubInfoResponse());
+      std::unique_ptr<fbs::HubInfoResponseT> response(
+          container->message_as_HubInfoResponse()->UnPack());
+      handleHubInfoResponse(*response);
       break;
     }
     case fbs::ChreMessage::NanoappListResponse: {
-      onNanoappListResponse(*message.AsNanoappListResponse(), clientId);
+      std::unique_ptr<fbs::NanoappListResponseT> response(
+          container->message_as_NanoappListResponse()->UnPack());
+      onNanoappListResponse(*response, clientId);
       break;
     }
     case fbs::ChreMessage::LoadNanoappResponse: {
-      onNanoappLoadResponse(*message.AsLoadNanoappResponse(), clientId);
+      std::unique_ptr<fbs::LoadNanoappResponseT> response(
+          container->message_as_LoadNanoappResponse()->UnPack());
+      onNanoappLoadResponse(*response, clientId);
       break;
     }
     case fbs::ChreMessage::TimeSyncRequest: {
@@ -653,43 +665,61 @@ void MultiClientContextHubBase::handleMessageFromChre(
       break;
     }
     case fbs::ChreMessage::UnloadNanoappResponse: {
-      onNanoappUnloadResponse(*message.AsUnloadNanoappResponse(), clientId);
+      std::unique_ptr<fbs::UnloadNanoappResponseT> response(
+          container->message_as_UnloadNanoappResponse()->UnPack());
+      onNanoappUnloadResponse(*response, clientId);
       break;
     }
     case fbs::ChreMessage::NanoappMessage: {
-      onNanoappMessage(*message.AsNanoappMessage());
+      onNanoappMessage(*container->message_as_NanoappMessage());
+      break;
+    }
+    case fbs::ChreMessage::NanoappMessageBatch: {
+      const auto *messages =
+          container->message_as_NanoappMessageBatch()->messages();
+      if (messages != nullptr) {
+        for (const fbs::NanoappMessage *nanoappMessage : *messages) {
+          onNanoappMessage(*nanoappMessage);
+        }
+      }
       break;
     }
     case fbs::ChreMessage::MessageDeliveryStatus: {
-      onMessageDeliveryStatus(*message.AsMessageDeliveryStatus());
+      std::unique_ptr<fbs::MessageDeliveryStatusT> status(
+          container->message_as_MessageDeliveryStatus()->UnPack());
+      onMessageDeliveryStatus(*status);
       break;
     }
     case fbs::ChreMessage::DebugDumpData: {
-      onDebugDumpData(*message.AsDebugDumpData());
+      onDebugDumpData(*container->message_as_DebugDumpData());
       break;
     }
     case fbs::ChreMessage::DebugDumpResponse: {
-      onDebugDumpComplete(*message.AsDebugDumpResponse());
+      std::unique_ptr<fbs::DebugDumpResponseT> response(
+          container->message_as_DebugDumpResponse()->UnPack());
+      onDebugDumpComplete(*response);
       break;
     }
     case fbs::ChreMessage::LogMessageV2: {
-      handleLogMessageV2(*message.AsLogMessageV2());
+      handleLogMessageV2(*container->message_as_LogMessageV2());
       break;
     }
     case fbs::ChreMessage::MetricLog: {
-      onMetricLog(*message.AsMetricLog());
+      std::unique_ptr<fbs::MetricLogT> metricLog(
+          container->message_as_MetricLog()->UnPack());
+      onMetricLog(*metricLog);
       break;
     }
     case fbs::ChreMessage::NanoappTokenDatabaseInfo: {
-      const auto *info = message.AsNanoappTokenDatabaseInfo();
-      mLogger.addNanoappDetokenizer(info->app_id, info->instance_id,
-                                    info->database_offset_bytes,
-                                    info->database_size_bytes);
+      const auto *info = container->message_as_NanoappTokenDatabaseInfo();
+      mLogger.addNanoappDetokenizer(info->app_id(), info->instance_id(),
+                                    info->database_offset_bytes(),
+                                    info->database_size_bytes());
       break;
     }
     default:
       LOGW("Got unexpected message type %" PRIu8,
-           static_cast<uint8_t>(message.type));
+           static_cast<uint8_t>(container->message_type()));
   }
 }
 
@@ -717,10 +747,12 @@ void MultiClientContextHubBase::handleHubInfoResponse(
 }
 
 void MultiClientContextHubBase::onDebugDumpData(
-    const ::chre::fbs::DebugDumpDataT &data) {
-  auto str = std::string(reinterpret_cast<const char *>(data.debug_str.data()),
-                         data.debug_str.size());
-  debugDumpAppend(str);
+    const ::chre::fbs::DebugDumpData &data) {
+  const flatbuffers::Vector<int8_t> *debugStr = data.debug_str();
+  if (debugStr != nullptr) {
+    debugDumpAppend(std::string(
+        reinterpret_cast<const char *>(debugStr->data()), debugStr->size()));
+  }
 }
 
 void MultiClientContextHubBase::onDebugDumpComplete(
@@ -739,6 +771,10 @@ void MultiClientContextHubBase::onDebugDumpComplete(
 void MultiClientContextHubBase::onNanoappListResponse(
     const fbs::NanoappListResponseT &response, HalClientId clientId) {
   LOGD("Received a nanoapp list response for client %" PRIu16, clientId);
+  if (mPreloadedNanoappLoader->isPreloadOngoing() &&
+      mPreloadedNanoappLoader->onNanoappListResponse(response, clientId)) {
+    return;
+  }
   {
     std::unique_lock<std::mutex> lock(mTestModeMutex);
     if (!mTestModeNanoapps.has_value()) {
@@ -881,47 +917,57 @@ void MultiClientContextHubBase::onNanoappUnloadResponse(
 }
 
 void MultiClientContextHubBase::onNanoappMessage(
-    const ::chre::fbs::NanoappMessageT &message) {
-  mEventLogger.logMessageFromNanoapp(message);
+    const ::chre::fbs::NanoappMessage &message) {
   ContextHubMessage outMessage;
-  outMessage.nanoappId = message.app_id;
-  outMessage.hostEndPoint = message.host_endpoint;
-  outMessage.messageType = message.message_type;
-  outMessage.messageBody = message.message;
-  outMessage.permissions = chreToAndroidPermissions(message.permissions);
+  outMessage.nanoappId = message.app_id();
+  outMessage.hostEndPoint = message.host_endpoint();
+  outMessage.messageType = message.message_type();
+  // The message body is copied straight out of the received buffer, which is
+  // the only copy made before it's handed to the client.
+  if (const flatbuffers::Vector<uint8_t> *body = message.message();
+      body != nullptr) {
+    outMessage.messageBody.assign(body->begin(), body->end());
+  }
+  outMessage.permissions = chreToAndroidPermissions(message.permissions());
+  mEventLogger.logMessageFromNanoapp(outMessage);
 
   if (reliable_message_implementation()) {
-    outMessage.isReliable = message.is_reliable;
-    outMessage.messageSequenceNumber = message.message_sequence_number;
+    outMessage.isReliable = message.is_reliable();
+    outMessage.messageSequenceNumber = message.message_sequence_number();
   } else {
     outMessage.isReliable = false;
     outMessage.messageSequenceNumber = 0;
   }
 
-  std::string messageSeq = "reliable message seq=" +
-                           std::to_string(outMessage.messageSequenceNumber);
-  LOGD("Received a nanoapp message from 0x%" PRIx64 " endpoint 0x%" PRIx16
-       ": Type 0x%" PRIx32 " size %zu %s",
-       outMessage.nanoappId, outMessage.hostEndPoint, outMessage.messageType,
-       outMessage.messageBody.size(),
-       outMessage.isReliable ? messageSeq.c_str() : "");
+  // Formatting is left to the logger so no string is built per message
+  if (outMessage.isReliable) {
+    LOGD("Received a nanoapp message from 0x%" PRIx64 " endpoint 0x%" PRIx16
+         ": Type 0x%" PRIx32 " size %zu reliable message seq=%" PRIi32,
+         outMessage.nanoappId, outMessage.hostEndPoint, outMessage.messageType,
+         outMessage.messageBody.size(), outMessage.messageSequenceNumber);
+  } else {
+    LOGD("Received a nanoapp message from 0x%" PRIx64 " endpoint 0x%" PRIx16
+         ": Type 0x%" PRIx32 " size %zu",
+         outMessage.nanoappId, outMessage.hostEndPoint, outMessage.messageType,
+         outMessage.messageBody.size());
+  }
 
-  std::vector<std::string> messageContentPerms =
-      chreToAndroidPermissions(message.message_permissions);
+  const std::vector<std::string> &messageContentPerms =
+      chreToAndroidPermissions(message.message_permissions());
   // broadcast message is sent to every connected endpoint
-  if (message.host_endpoint == CHRE_HOST_ENDPOINT_BROADCAST) {
+  if (message.host_endpoint() == CHRE_HOST_ENDPOINT_BROADCAST) {
     mHalClientManager->sendMessageForAllCallbacks(outMessage,
                                                   messageContentPerms);
   } else if (auto callback = mHalClientManager->getCallbackForEndpoint(
-                 message.host_endpoint);
+                 message.host_endpoint());
              callback != nullptr) {
     outMessage.hostEndPoint =
-        HalClientManager::convertToOriginalEndpointId(message.host_endpoint);
+        HalClientManager::convertToOriginalEndpointId(message.host_endpoint());
     callback->handleContextHubMessage(outMessage, messageContentPerms);
   }
 
-  if (mMetricsReporter != nullptr && message.woke_host) {
-    mMetricsReporter->logApWakeupOccurred(message.app_id);
+  if (mMetricsReporter != nullptr && message.woke_host()) {
+    mMetricsReporter->logApWakeupOccurred(message.app_id());
   }
 }
 
@@ -1067,11 +1113,14 @@ void MultiClientContextHubBase::writeToDebugFile(const char *str) {
 }
 
 void MultiClientContextHubBase::handleLogMessageV2(
-    const ::chre::fbs::LogMessageV2T &logMessage) {
-  const std::vector<int8_t> &logBuffer = logMessage.buffer;
-  auto logData = reinterpret_cast<const uint8_t *>(logBuffer.data());
-  uint32_t numLogsDropped = logMessage.num_logs_dropped;
-  mLogger.logV2(logData, logBuffer.size(), numLogsDropped);
+    const ::chre::fbs::LogMessageV2 &logMessage) {
+  const flatbuffers::Vector<int8_t> *logBuffer = logMessage.buffer();
+  if (logBuffer == nullptr) {
+    return;
+  }
+  auto logData = reinterpret_cast<const uint8_t *>(logBuffer->data());
+  uint32_t numLogsDropped = logMessage.num_logs_dropped();
+  mLogger.logV2(logData, logBuffer->size(), numLogsDropped);
 }
 
 void MultiClientContextHubBase::onMetricLog(
@@ -1110,6 +1159,31 @@ void MultiClientContextHubBase::onMetricLog(
       }
       return;
     }
+    case Atoms::CHRE_NANOAPP_START_REPORTED: {
+      metrics::ChreNanoappStartReported metric;
+      if (!metric.ParseFromArray(encodedMetric.data(), metricSize)) {
+        break;
+      }
+      if (!mMetricsReporter->logNanoappStartReported(
+              metric.nanoapp_id(), metric.load_time_us(),
+              metric.relocation_time_us(), metric.init_array_time_us(),
+              metric.start_time_us(), metric.total_time_us())) {
+        LOGE("Could not log the nanoapp start metric");
+      }
+      return;
+    }
+    case Atoms::CHRE_NANOAPP_EVENT_BUDGET_EXCEEDED: {
+      metrics::ChreNanoappEventBudgetExceeded metric;
+      if (!metric.ParseFromArray(encodedMetric.data(), metricSize)) {
+        break;
+      }
+      if (!mMetricsReporter->logNanoappEventBudgetExceeded(
+              metric.nanoapp_id(), metric.event_type(),
+              metric.elapsed_time_ms(), metric.budget_ms())) {
+        LOGE("Could not log the nanoapp event budget exceeded metric");
+      }
+      return;
+    }
     default: {
       LOGW("Unknown metric ID %" PRIu32, metricMessage.id);
       return;
@@ -150,15 +150,15 @@ class MultiClientContextHubBase
   void onNanoappUnloadResponse(
       const ::chre::fbs::UnloadNanoappResponseT &response,
       HalClientId clientId);
-  void onNanoappMessage(const ::chre::fbs::NanoappMessageT &message);
+  void onNanoappMessage(const ::chre::fbs::NanoappMessage &message);
   void onMessageDeliveryStatus(
       const ::chre::fbs::MessageDeliveryStatusT &status);
-  void onDebugDumpData(const ::chre::fbs::DebugDumpDataT &data);
+  void onDebugDumpData(const ::chre::fbs::DebugDumpData &data);
   void onDebugDumpComplete(
       const ::chre::fbs::DebugDumpResponseT & /* response */);
   void onMetricLog(const ::chre::fbs::MetricLogT &metricMessage);
   void handleClientDeath(pid_t pid);
-  void handleLogMessageV2(const ::chre::fbs::LogMessageV2T &logMessage);
+  void handleLogMessageV2(const ::chre::fbs::LogMessageV2 &logMessage);
 
   /**
    * Enables test mode by unloading all the nanoapps except the system nanoapps.
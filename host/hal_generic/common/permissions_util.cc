@@ -16,6 +16,10 @@
 
 #include "permissions_util.h"
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
 #include "chre/util/macros.h"
 #include "chre/util/system/napp_permissions.h"
 
@@ -25,11 +29,22 @@ namespace contexthub {
 namespace common {
 namespace implementation {
 
-std::vector<std::string> chreToAndroidPermissions(uint32_t chrePermissions) {
-  std::vector<std::string> androidPermissions;
+namespace {
+
+// The bits of a permissions list index, one per group of Android permissions.
+constexpr uint32_t kAudioPermsBit = 1 << 0;
+constexpr uint32_t kLocationPermsBit = 1 << 1;
+constexpr uint32_t kBluetoothPermsBit = 1 << 2;
+constexpr size_t kNumPermissionsLists = 1 << 3;
+
+using PermissionsLists =
+    std::array<std::vector<std::string>, kNumPermissionsLists>;
+
+uint32_t getPermissionsListIndex(uint32_t chrePermissions) {
+  uint32_t index = 0;
   if (BITMASK_HAS_VALUE(chrePermissions,
                         ::chre::NanoappPermissions::CHRE_PERMS_AUDIO)) {
-    androidPermissions.push_back(kRecordAudioPerm);
+    index |= kAudioPermsBit;
   }
 
   if (BITMASK_HAS_VALUE(chrePermissions,
@@ -38,16 +53,40 @@ std::vector<std::string> chreToAndroidPermissions(uint32_t chrePermissions) {
                         ::chre::NanoappPermissions::CHRE_PERMS_WIFI) ||
       BITMASK_HAS_VALUE(chrePermissions,
                         ::chre::NanoappPermissions::CHRE_PERMS_WWAN)) {
-    androidPermissions.push_back(kFineLocationPerm);
-    androidPermissions.push_back(kBackgroundLocationPerm);
+    index |= kLocationPermsBit;
   }
 
   if (BITMASK_HAS_VALUE(chrePermissions,
                         ::chre::NanoappPermissions::CHRE_PERMS_BLE)) {
-    androidPermissions.push_back(kBluetoothScanPerm);
+    index |= kBluetoothPermsBit;
   }
+  return index;
+}
+
+PermissionsLists buildPermissionsLists() {
+  PermissionsLists lists;
+  for (uint32_t index = 0; index < kNumPermissionsLists; index++) {
+    std::vector<std::string> &androidPermissions = lists[index];
+    if (index & kAudioPermsBit) {
+      androidPermissions.push_back(kRecordAudioPerm);
+    }
+    if (index & kLocationPermsBit) {
+      androidPermissions.push_back(kFineLocationPerm);
+      androidPermissions.push_back(kBackgroundLocationPerm);
+    }
+    if (index & kBluetoothPermsBit) {
+      androidPermissions.push_back(kBluetoothScanPerm);
+    }
+  }
+  return lists;
+}
+
+}  // namespace
 
-  return androidPermissions;
+const std::vector<std::string> &chreToAndroidPermissions(
+    uint32_t chrePermissions) {
+  static const PermissionsLists kPermissionsLists = buildPermissionsLists();
+  return kPermissionsLists[getPermissionsListIndex(chrePermissions)];
 }
 
 }  // namespace implementation
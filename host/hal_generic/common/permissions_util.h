@@ -36,8 +36,17 @@ const std::vector<std::string> kSupportedPermissions = {
     kBackgroundLocationPerm, kFineLocationPerm, kRecordAudioPerm,
     kBluetoothScanPerm};
 
-//! Converts the CHRE permissions bitmask to a list of CHRE permissions.
-std::vector<std::string> chreToAndroidPermissions(uint32_t chrePermissions);
+/**
+ * Converts the CHRE permissions bitmask to a list of Android permissions.
+ *
+ * The list only depends on a few bits of the bitmask, so the lists for every
+ * combination of them are built once and shared. This is called for every
+ * message from a nanoapp.
+ *
+ * @return a reference to the list, valid for the lifetime of the process.
+ */
+const std::vector<std::string> &chreToAndroidPermissions(
+    uint32_t chrePermissions);
 
 }  // namespace implementation
 }  // namespace common
@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "chre_host/file_stream.h"
+#include "chre_host/fragmented_load_transaction.h"
+#include "chre_host/host_protocol_host.h"
+#include "gtest/gtest.h"
+
+namespace android::chre {
+
+namespace {
+
+namespace fbs = ::chre::fbs;
+
+constexpr uint32_t kTransactionId = 7;
+constexpr uint64_t kAppId = 0x476f6f676c000123;
+constexpr uint32_t kAppVersion = 0x00010002;
+constexpr uint32_t kAppFlags = 0x3;
+constexpr uint32_t kTargetApiVersion = 0x01090000;
+constexpr size_t kFragmentSize = 1000;
+
+using Encoding = std::vector<std::vector<uint8_t>>;
+
+std::vector<uint8_t> makeBinary(size_t size) {
+  std::vector<uint8_t> binary(size);
+  for (size_t i = 0; i < size; i++) {
+    binary[i] = static_cast<uint8_t>(i * 31 + 7);
+  }
+  return binary;
+}
+
+void appendEncoding(const flatbuffers::FlatBufferBuilder &builder,
+                    Encoding *encoding) {
+  if (encoding != nullptr) {
+    encoding->emplace_back(builder.GetBufferPointer(),
+                           builder.GetBufferPointer() + builder.GetSize());
+  }
+}
+
+/**
+ * Encodes a load the way FragmentedLoadTransaction did when it copied every
+ * fragment into its own vector up front.
+ *
+ * @param encoding Populated with the encoded requests if not null.
+ */
+void encodeWithFragmentCopies(const std::vector<uint8_t> &binary,
+                              size_t fragmentSize, Encoding *encoding) {
+  std::vector<std::vector<uint8_t>> fragments;
+  size_t byteIndex = 0;
+  do {
+    size_t end = std::min(binary.size(), byteIndex + fragmentSize);
+    fragments.push_back(binary.empty()
+                            ? std::vector<uint8_t>()
+                            : std::vector<uint8_t>(binary.begin() + byteIndex,
+                                                   binary.begin() + end));
+    byteIndex += fragmentSize;
+  } while (byteIndex < binary.size());
+
+  for (size_t i = 0; i < fragments.size(); i++) {
+    bool first = (i == 0);
+    flatbuffers::FlatBufferBuilder builder(fragments[i].size() + 128);
+    auto appBinary = builder.CreateVector(fragments[i]);
+    auto request = fbs::CreateLoadNanoappRequest(
+        builder, kTransactionId, kAppId, first ? kAppVersion : 0,
+        first ? kTargetApiVersion : 0, appBinary, i + 1 /* fragment_id */,
+        first ? binary.size() : 0, 0 /* app_binary_file_name */,
+        first ? kAppFlags : 0, true /* respond_before_start */);
+    HostProtocolHost::finalize(builder, fbs::ChreMessage::LoadNanoappRequest,
+                               request.Union());
+    appendEncoding(builder, encoding);
+  }
+}
+
+Encoding encodeWithFragmentCopies(const std::vector<uint8_t> &binary,
+                                  size_t fragmentSize) {
+  Encoding encoding;
+  encodeWithFragmentCopies(binary, fragmentSize, &encoding);
+  return encoding;
+}
+
+void encodeTransaction(FragmentedLoadTransaction &transaction,
+                       Encoding *encoding) {
+  while (!transaction.isComplete()) {
+    const FragmentedLoadRequest &request = transaction.getNextRequest();
+    flatbuffers::FlatBufferBuilder builder(request.binary.size() + 128);
+    HostProtocolHost::encodeFragmentedLoadNanoappRequest(
+        builder, request, true /* respondBeforeStart */);
+    appendEncoding(builder, encoding);
+  }
+}
+
+Encoding encodeTransaction(FragmentedLoadTransaction &transaction) {
+  Encoding encoding;
+  encodeTransaction(transaction, &encoding);
+  return encoding;
+}
+
+class FragmentedLoadTransactionTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mPath = std::filesystem::temp_directory_path() /
+            ("fragmented_load_transaction_test_" + std::to_string(getpid()));
+  }
+
+  void TearDown() override {
+    std::filesystem::remove(mPath);
+  }
+
+  void writeFile(const std::vector<uint8_t> &contents) {
+    std::ofstream file(mPath, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(contents.data()),
+               static_cast<std::streamsize>(contents.size()));
+  }
+
+  std::filesystem::path mPath;
+};
+
+/**
+ * Runs the given function in a child process and returns the growth of the
+ * child's peak RSS in KiB while running it.
+ */
+template <typename Function>
+long measurePeakRssGrowthKb(Function function) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return -1;
+  }
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    struct rusage before = {};
+    struct rusage after = {};
+    getrusage(RUSAGE_SELF, &before);
+    function();
+    getrusage(RUSAGE_SELF, &after);
+    long growthKb = after.ru_maxrss - before.ru_maxrss;
+    ssize_t written = write(fds[1], &growthKb, sizeof(growthKb));
+    _exit(written == sizeof(growthKb) ? 0 : 1);
+  }
+
+  close(fds[1]);
+  long growthKb = -1;
+  if (pid < 0 || read(fds[0], &growthKb, sizeof(growthKb)) !=
+                     static_cast<ssize_t>(sizeof(growthKb))) {
+    growthKb = -1;
+  }
+  close(fds[0]);
+  if (pid > 0) {
+    waitpid(pid, nullptr, 0);
+  }
+  return growthKb;
+}
+
+}  // namespace
+
+TEST_F(FragmentedLoadTransactionTest, EncodingMatchesFragmentCopies) {
+  for (size_t size : {size_t{0}, size_t{1}, kFragmentSize - 1, kFragmentSize,
+                      kFragmentSize + 1, 3 * kFragmentSize + 7}) {
+    std::vector<uint8_t> binary = makeBinary(size);
+    FragmentedLoadTransaction transaction(kTransactionId, kAppId, kAppVersion,
+                                          kAppFlags, kTargetApiVersion, binary,
+                                          kFragmentSize);
+
+    Encoding expected = encodeWithFragmentCopies(binary, kFragmentSize);
+    EXPECT_EQ(transaction.getNumFragments(), expected.size());
+    EXPECT_EQ(transaction.getNanoappTotalSize(), size);
+    EXPECT_EQ(encodeTransaction(transaction), expected)
+        << "Binary size " << size;
+  }
+}
+
+TEST_F(FragmentedLoadTransactionTest, SharedBinaryIsNotCopied) {
+  auto binary = std::make_shared<const std::vector<uint8_t>>(
+      makeBinary(2 * kFragmentSize + 10));
+  FragmentedLoadTransaction transaction(kTransactionId, kAppId, kAppVersion,
+                                        kAppFlags, kTargetApiVersion, binary,
+                                        kFragmentSize);
+
+  size_t offset = 0;
+  while (!transaction.isComplete()) {
+    const FragmentedLoadRequest &request = transaction.getNextRequest();
+    EXPECT_EQ(request.binary.data(), binary->data() + offset);
+    offset += request.binary.size();
+  }
+  EXPECT_EQ(offset, binary->size());
+}
+
+TEST_F(FragmentedLoadTransactionTest, RewindReproducesFragments) {
+  std::vector<uint8_t> binary = makeBinary(4 * kFragmentSize);
+  FragmentedLoadTransaction transaction(kTransactionId, kAppId, kAppVersion,
+                                        kAppFlags, kTargetApiVersion, binary,
+                                        kFragmentSize);
+  Encoding expected = encodeWithFragmentCopies(binary, kFragmentSize);
+  Encoding encoding = encodeTransaction(transaction);
+  ASSERT_EQ(encoding, expected);
+
+  transaction.rewindTo(2);
+  EXPECT_EQ(transaction.getNextFragmentId(), 2);
+  Encoding resent = encodeTransaction(transaction);
+  EXPECT_EQ(resent, Encoding(expected.begin() + 1, expected.end()));
+}
+
+TEST_F(FragmentedLoadTransactionTest, MappedBinaryMatchesFragmentCopies) {
+  std::vector<uint8_t> binary = makeBinary(5 * kFragmentSize + 123);
+  writeFile(binary);
+
+  std::shared_ptr<const uint8_t> mapped;
+  size_t mappedSize = 0;
+  ASSERT_TRUE(mapFileContents(mPath.c_str(), mapped, mappedSize));
+  ASSERT_EQ(mappedSize, binary.size());
+  FragmentedLoadTransaction transaction(kTransactionId, kAppId, kAppVersion,
+                                        kAppFlags, kTargetApiVersion,
+                                        std::move(mapped), mappedSize,
+                                        kFragmentSize);
+
+  EXPECT_EQ(encodeTransaction(transaction),
+            encodeWithFragmentCopies(binary, kFragmentSize));
+}
+
+TEST_F(FragmentedLoadTransactionTest, MappedBinaryLowersPeakRss) {
+  constexpr size_t kBinarySize = 32 * 1024 * 1024;
+  writeFile(makeBinary(kBinarySize));
+
+  long copiesKb = measurePeakRssGrowthKb([this]() {
+    std::vector<uint8_t> binary;
+    readFileContents(mPath.c_str(), binary);
+    encodeWithFragmentCopies(binary, CHRE_HOST_DEFAULT_FRAGMENT_SIZE,
+                             nullptr /* encoding */);
+  });
+  long mappedKb = measurePeakRssGrowthKb([this]() {
+    std::shared_ptr<const uint8_t> binary;
+    size_t size = 0;
+    mapFileContents(mPath.c_str(), binary, size);
+    FragmentedLoadTransaction transaction(kTransactionId, kAppId, kAppVersion,
+                                          kAppFlags, kTargetApiVersion,
+                                          std::move(binary), size);
+    encodeTransaction(transaction, nullptr /* encoding */);
+  });
+
+  ASSERT_GE(copiesKb, 0);
+  ASSERT_GE(mappedKb, 0);
+
+  // Fragment copies hold the binary twice, while only the pages of the mapped
+  // binary count towards the RSS, once
+  constexpr long kBinarySizeKb = kBinarySize / 1024;
+  constexpr long kToleranceKb = kBinarySizeKb / 8;
+  EXPECT_GE(copiesKb, 2 * kBinarySizeKb - kToleranceKb);
+  EXPECT_LE(mappedKb, kBinarySizeKb + kToleranceKb);
+}
+
+}  // namespace android::chre
@@ -562,5 +562,75 @@ TEST_F(HalClientManagerTest, handleChreRestartForConnectedClientsOnly) {
   halClientManager->handleChreRestart();
 }
 
+TEST_F(HalClientManagerTest, ReconnectedClientIsFoundByItsNewPid) {
+  auto halClientManager = std::make_unique<HalClientManagerForTest>(
+      mockDeadClientUnlinker, kClientIdMappingFilePath);
+  std::shared_ptr<ContextHubCallbackForTest> callback =
+      ContextHubCallbackForTest::make<ContextHubCallbackForTest>(kVendorUuid);
+  const pid_t newVendorPid = kVendorPid + 1;
+
+  EXPECT_TRUE(halClientManager->registerCallback(
+      kVendorPid, callback, /* deathRecipientCookie= */ nullptr));
+  HalClientId clientId = halClientManager->getClientId(kVendorPid);
+  halClientManager->handleClientDeath(kVendorPid);
+  EXPECT_EQ(halClientManager->getClientId(kVendorPid),
+            ::chre::kHostClientIdUnspecified);
+
+  // The client keeps its client id when it reconnects from another process
+  EXPECT_TRUE(halClientManager->registerCallback(
+      newVendorPid, callback, /* deathRecipientCookie= */ nullptr));
+  EXPECT_THAT(halClientManager->getClients(), SizeIs(1));
+  EXPECT_EQ(halClientManager->getClientId(newVendorPid), clientId);
+  EXPECT_EQ(halClientManager->getClientId(kVendorPid),
+            ::chre::kHostClientIdUnspecified);
+  EXPECT_EQ(halClientManager->getCallback(clientId), callback);
+}
+
+TEST_F(HalClientManagerTest, RoutesEndpointsOfManyClientsToTheirCallbacks) {
+  constexpr size_t kNumVendorClients = 7;
+  constexpr size_t kNumEndpointsPerClient = 8;  // 64 endpoints in total
+
+  auto halClientManager = std::make_unique<HalClientManagerForTest>(
+      mockDeadClientUnlinker, kClientIdMappingFilePath);
+  std::vector<std::pair<pid_t, std::shared_ptr<ContextHubCallbackForTest>>>
+      clients;
+  clients.emplace_back(
+      kSystemServerPid,
+      ContextHubCallbackForTest::make<ContextHubCallbackForTest>(
+          kSystemServerUuid));
+  for (size_t i = 0; i < kNumVendorClients; i++) {
+    std::string uuid = kVendorUuid;
+    uuid.back() = "0123456789abcdef"[i];
+    clients.emplace_back(
+        kVendorPid + static_cast<pid_t>(i),
+        ContextHubCallbackForTest::make<ContextHubCallbackForTest>(uuid));
+  }
+
+  // Registers the clients and their endpoints, and records the endpoint ids
+  // as seen by CHRE along with the callback each is expected to route to.
+  std::vector<std::pair<HostEndpointId, std::shared_ptr<IContextHubCallback>>>
+      routes;
+  for (const auto &[pid, callback] : clients) {
+    ASSERT_TRUE(halClientManager->registerCallback(
+        pid, callback, /* deathRecipientCookie= */ nullptr));
+    for (HostEndpointId endpointId = 1; endpointId <= kNumEndpointsPerClient;
+         endpointId++) {
+      ASSERT_TRUE(halClientManager->registerEndpointId(pid, endpointId));
+      HostEndpointId mutatedEndpointId = endpointId;
+      ASSERT_TRUE(halClientManager->mutateEndpointIdFromHostIfNeeded(
+          pid, mutatedEndpointId));
+      routes.emplace_back(mutatedEndpointId, callback);
+    }
+  }
+  ASSERT_THAT(routes, SizeIs((kNumVendorClients + 1) * kNumEndpointsPerClient));
+
+  // A message from CHRE to any of the endpoints is routed back to the client
+  // that registered it, even though the clients reuse the same endpoint ids.
+  for (const auto &[mutatedEndpointId, callback] : routes) {
+    EXPECT_EQ(halClientManager->getCallbackForEndpoint(mutatedEndpointId),
+              callback);
+  }
+}
+
 }  // namespace
 }  // namespace android::hardware::contexthub::common::implementation
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "chre_host/generated/host_messages_generated.h"
+#include "chre_host/host_protocol_host.h"
+#include "gtest/gtest.h"
+
+namespace android::chre {
+
+namespace {
+
+namespace fbs = ::chre::fbs;
+
+constexpr uint64_t kAppId = 0x476f6f676c000123;
+constexpr uint16_t kHostEndpoint = 0x8001;
+constexpr uint32_t kPermissions = 0x5;
+constexpr uint32_t kMessagePermissions = 0x1;
+
+struct DecodedMessage {
+  uint64_t appId;
+  uint32_t messageType;
+  uint16_t hostEndpoint;
+  uint32_t permissions;
+  uint32_t messagePermissions;
+  bool wokeHost;
+  std::vector<uint8_t> message;
+};
+
+class MessageCollector : public IChreMessageHandlers {
+ public:
+  void handleNanoappMessageInPlace(
+      const fbs::NanoappMessage &message) override {
+    DecodedMessage decoded;
+    decoded.appId = message.app_id();
+    decoded.messageType = message.message_type();
+    decoded.hostEndpoint = message.host_endpoint();
+    decoded.permissions = message.permissions();
+    decoded.messagePermissions = message.message_permissions();
+    decoded.wokeHost = message.woke_host();
+    if (message.message() != nullptr) {
+      decoded.message.assign(message.message()->begin(),
+                             message.message()->end());
+    }
+    messages.push_back(std::move(decoded));
+  }
+
+  std::vector<DecodedMessage> messages;
+};
+
+//! Encodes a NanoappMessageBatch the same way the CHRE host links do, with the
+//! builder sized from the shared encoding overheads.
+void encodeBatch(flatbuffers::FlatBufferBuilder &builder,
+                 const std::vector<std::vector<uint8_t>> &payloads) {
+  std::vector<flatbuffers::Offset<fbs::NanoappMessage>> offsets;
+  for (size_t i = 0; i < payloads.size(); i++) {
+    auto messageData =
+        builder.CreateVector(payloads[i].data(), payloads[i].size());
+    offsets.push_back(fbs::CreateNanoappMessage(
+        builder, kAppId + i, /* message_type= */ i, kHostEndpoint, messageData,
+        kMessagePermissions, kPermissions, /* woke_host= */ i == 0));
+  }
+  auto batch = fbs::CreateNanoappMessageBatch(builder,
+                                              builder.CreateVector(offsets));
+  HostProtocolHost::finalize(builder, fbs::ChreMessage::NanoappMessageBatch,
+                             batch.Union());
+}
+
+size_t estimateBatchSize(const std::vector<std::vector<uint8_t>> &payloads) {
+  size_t size = HostProtocolHost::kNanoappMessageBatchEncodingOverhead;
+  for (const std::vector<uint8_t> &payload : payloads) {
+    size += payload.size() + HostProtocolHost::kNanoappMessageEncodingOverhead;
+  }
+  return size;
+}
+
+TEST(HostProtocolHostTest, NanoappMessageBatchRoundTrip) {
+  const std::vector<std::vector<uint8_t>> payloads = {
+      {0x01, 0x02, 0x03},
+      {},
+      std::vector<uint8_t>(257, 0xab),
+  };
+  flatbuffers::FlatBufferBuilder builder(estimateBatchSize(payloads));
+  encodeBatch(builder, payloads);
+
+  MessageCollector collector;
+  ASSERT_TRUE(HostProtocolHost::decodeMessageFromChre(
+      builder.GetBufferPointer(), builder.GetSize(), collector));
+
+  // Messages are delivered one by one, in the order they were batched
+  ASSERT_EQ(collector.messages.size(), payloads.size());
+  for (size_t i = 0; i < payloads.size(); i++) {
+    const DecodedMessage &decoded = collector.messages[i];
+    EXPECT_EQ(decoded.appId, kAppId + i);
+    EXPECT_EQ(decoded.messageType, i);
+    EXPECT_EQ(decoded.hostEndpoint, kHostEndpoint);
+    EXPECT_EQ(decoded.permissions, kPermissions);
+    EXPECT_EQ(decoded.messagePermissions, kMessagePermissions);
+    EXPECT_EQ(decoded.wokeHost, i == 0);
+    EXPECT_EQ(decoded.message, payloads[i]);
+  }
+}
+
+TEST(HostProtocolHostTest, NanoappMessageBatchFitsEncodingEstimate) {
+  for (size_t numMessages = 1; numMessages <= 8; numMessages++) {
+    std::vector<std::vector<uint8_t>> payloads;
+    for (size_t i = 0; i < numMessages; i++) {
+      payloads.emplace_back(i * 13, static_cast<uint8_t>(i));
+    }
+    flatbuffers::FlatBufferBuilder builder(estimateBatchSize(payloads));
+    encodeBatch(builder, payloads);
+    EXPECT_LE(builder.GetSize(), estimateBatchSize(payloads))
+        << "with " << numMessages << " messages";
+  }
+}
+
+TEST(HostProtocolHostTest, RejectsCorruptedNanoappMessageBatch) {
+  const std::vector<std::vector<uint8_t>> payloads = {{0x01, 0x02}};
+  flatbuffers::FlatBufferBuilder builder(estimateBatchSize(payloads));
+  encodeBatch(builder, payloads);
+
+  // Truncating the buffer must fail verification rather than decode garbage
+  MessageCollector collector;
+  EXPECT_FALSE(HostProtocolHost::decodeMessageFromChre(
+      builder.GetBufferPointer(), builder.GetSize() / 2, collector));
+  EXPECT_TRUE(collector.messages.empty());
+}
+
+}  // namespace
+
+}  // namespace android::chre
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <endian.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chre_host/generated/host_messages_generated.h"
+#include "chre_host/log_message_parser.h"
+#include "gtest/gtest.h"
+
+namespace android::chre {
+
+namespace {
+
+using ::chre::fbs::LogType;
+
+constexpr uint8_t kLogLevelInfo = 3;
+constexpr uint16_t kInstanceId = 2;
+
+struct EmittedLog {
+  uint32_t timestampMillis;
+  std::string message;
+  std::thread::id threadId;
+};
+
+void appendStringLog(std::vector<uint8_t> &buffer, uint32_t timestampMillis,
+                     const std::string &message) {
+  buffer.push_back(static_cast<uint8_t>(
+      (static_cast<uint8_t>(LogType::STRING) << 4) | kLogLevelInfo));
+  uint32_t timestamp = htole32(timestampMillis);
+  const auto *bytes = reinterpret_cast<const uint8_t *>(&timestamp);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(timestamp));
+  buffer.insert(buffer.end(), message.begin(), message.end());
+  buffer.push_back('\0');
+}
+
+}  // namespace
+
+class LogMessageParserTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mParser.setLogSink([this](uint8_t /* level */, uint32_t timestampMillis,
+                              const char *logMessage) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mLogs.push_back(
+          {timestampMillis, logMessage, std::this_thread::get_id()});
+    });
+  }
+
+  //! Parses a buffer of string logs, one per timestamp.
+  void logStrings(const std::vector<uint32_t> &timestamps,
+                  uint32_t numLogsDropped = 0) {
+    std::vector<uint8_t> buffer;
+    for (uint32_t timestampMillis : timestamps) {
+      appendStringLog(buffer, timestampMillis,
+                      "log " + std::to_string(timestampMillis));
+    }
+    mParser.logV2(buffer.data(), buffer.size(), numLogsDropped);
+  }
+
+  bool isRateLimited(uint32_t timestampMillis) {
+    std::lock_guard<std::mutex> lock(mParser.mNanoappMutex);
+    return mParser.isNanoappLogRateLimited(kInstanceId, timestampMillis);
+  }
+
+  std::vector<EmittedLog> getLogs() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mLogs;
+  }
+
+  LogMessageParser mParser;
+  std::mutex mMutex;
+  std::vector<EmittedLog> mLogs;
+};
+
+TEST_F(LogMessageParserTest, EmitsLogsInOrderFromEmitterThread) {
+  constexpr uint32_t kNumBuffers = 4 * CHRE_HOST_LOG_EMIT_QUEUE_SIZE;
+  constexpr uint32_t kLogsPerBuffer = 10;
+  uint32_t timestampMillis = 0;
+  for (uint32_t i = 0; i < kNumBuffers; i++) {
+    std::vector<uint32_t> timestamps;
+    for (uint32_t j = 0; j < kLogsPerBuffer; j++) {
+      timestamps.push_back(timestampMillis++);
+    }
+    logStrings(timestamps);
+  }
+  mParser.flush();
+
+  std::vector<EmittedLog> logs = getLogs();
+  ASSERT_EQ(logs.size(), kNumBuffers * kLogsPerBuffer);
+  for (uint32_t i = 0; i < logs.size(); i++) {
+    EXPECT_EQ(logs[i].timestampMillis, i);
+    EXPECT_EQ(logs[i].message, "log " + std::to_string(i));
+    EXPECT_NE(logs[i].threadId, std::this_thread::get_id());
+  }
+}
+
+TEST_F(LogMessageParserTest, EmitsLogsBeforeReturningWhenSync) {
+  mParser.setAsyncEmitEnabled(false);
+  logStrings({1, 2});
+
+  std::vector<EmittedLog> logs = getLogs();
+  ASSERT_EQ(logs.size(), 2);
+  EXPECT_EQ(logs[0].message, "log 1");
+  EXPECT_EQ(logs[1].message, "log 2");
+  EXPECT_EQ(logs[1].threadId, std::this_thread::get_id());
+}
+
+TEST_F(LogMessageParserTest, EmitsDroppedLogCountBetweenBuffers) {
+  logStrings({1, 2});
+  logStrings({10, 11}, /* numLogsDropped= */ 5);
+  logStrings({12}, /* numLogsDropped= */ 5);
+  mParser.flush();
+
+  std::vector<EmittedLog> logs = getLogs();
+  ASSERT_EQ(logs.size(), 6);
+  EXPECT_EQ(logs[1].message, "log 2");
+  EXPECT_EQ(logs[2].message, "# logs dropped: 5");
+  EXPECT_EQ(logs[2].timestampMillis, 10);
+  EXPECT_EQ(logs[3].message, "log 10");
+  EXPECT_EQ(logs[5].message, "log 12");
+}
+
+#if CHRE_HOST_NANOAPP_LOG_RATE_LIMIT > 0
+
+TEST_F(LogMessageParserTest, RateLimitsNanoappLogsByLogTimestamps) {
+  constexpr uint32_t kMillisPerLog = 1000 / CHRE_HOST_NANOAPP_LOG_RATE_LIMIT;
+  constexpr uint32_t kStartMillis = 5000;
+
+  // A burst logged at once is allowed up to the burst limit, however long it
+  // takes to parse
+  for (uint32_t i = 0; i < CHRE_HOST_NANOAPP_LOG_BURST_LIMIT; i++) {
+    ASSERT_FALSE(isRateLimited(kStartMillis)) << "log " << i;
+  }
+  EXPECT_TRUE(isRateLimited(kStartMillis));
+  EXPECT_TRUE(isRateLimited(kStartMillis + kMillisPerLog / 2));
+
+  // Logs out of order don't refill the bucket
+  EXPECT_TRUE(isRateLimited(kStartMillis - 1000));
+
+  // A token is regained once enough time passed on CHRE, and the summary of
+  // the dropped logs is emitted ahead of the allowed log
+  EXPECT_FALSE(isRateLimited(kStartMillis + kMillisPerLog));
+  std::vector<EmittedLog> logs = getLogs();
+  ASSERT_EQ(logs.size(), 1);
+  EXPECT_EQ(logs[0].timestampMillis, kStartMillis + kMillisPerLog);
+  EXPECT_NE(logs[0].message.find("Dropped 3 logs"), std::string::npos);
+  EXPECT_TRUE(isRateLimited(kStartMillis + kMillisPerLog));
+}
+
+TEST_F(LogMessageParserTest, RateLimitRefillsAcrossTimestampWrapAround) {
+  constexpr uint32_t kStartMillis = UINT32_MAX - 10;
+  constexpr uint32_t kRefillMillis = 1000 * CHRE_HOST_NANOAPP_LOG_BURST_LIMIT /
+                                     CHRE_HOST_NANOAPP_LOG_RATE_LIMIT;
+  for (uint32_t i = 0; i < CHRE_HOST_NANOAPP_LOG_BURST_LIMIT; i++) {
+    ASSERT_FALSE(isRateLimited(kStartMillis));
+  }
+  EXPECT_TRUE(isRateLimited(kStartMillis));
+
+  // The timestamp wrapped around by the time the whole bucket is refilled
+  for (uint32_t i = 0; i < CHRE_HOST_NANOAPP_LOG_BURST_LIMIT; i++) {
+    ASSERT_FALSE(isRateLimited(kStartMillis + kRefillMillis));
+  }
+  EXPECT_TRUE(isRateLimited(kStartMillis + kRefillMillis));
+}
+
+#endif  // CHRE_HOST_NANOAPP_LOG_RATE_LIMIT > 0
+
+}  // namespace android::chre
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <aidl/android/frameworks/stats/BnStats.h>
+#include <chre_atoms_log.h>
+
+#include "chre_host/metrics_reporter.h"
+#include "gtest/gtest.h"
+
+namespace android::chre {
+
+namespace {
+
+using ::aidl::android::frameworks::stats::BnStats;
+using ::aidl::android::frameworks::stats::VendorAtom;
+using ::aidl::android::frameworks::stats::VendorAtomValue;
+using ::android::chre::Atoms::ChreHalNanoappLoadFailed;
+using ::android::chre::Atoms::ChrePalOpenFailed;
+using ::ndk::ScopedAStatus;
+
+using AtomCounts = std::map<VendorAtom, uint32_t>;
+
+bool isOccurrenceAtom(int32_t atomId) {
+  return atomId == Atoms::CHRE_AP_WAKE_UP_OCCURRED ||
+         atomId == Atoms::CHRE_HAL_NANOAPP_LOAD_FAILED ||
+         atomId == Atoms::CHRE_PAL_OPEN_FAILED;
+}
+
+constexpr auto kLongWindow = std::chrono::hours(1);
+constexpr auto kTimeout = std::chrono::seconds(5);
+
+//! A stats service recording the atoms reported to it.
+class FakeStatsService : public BnStats {
+ public:
+  ScopedAStatus reportVendorAtom(const VendorAtom &atom) override {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (isOccurrenceAtom(atom.atomId)) {
+      // Occurrence metrics end with their count
+      VendorAtom uncountedAtom = atom;
+      uncountedAtom.values.pop_back();
+      mAtomCounts[uncountedAtom] +=
+          atom.values.back().get<VendorAtomValue::intValue>();
+    } else {
+      mAtomCounts[atom]++;
+    }
+    mNumReports++;
+    return ScopedAStatus::ok();
+  }
+
+  //! @return The number of occurrences of each atom, summing their counts.
+  AtomCounts getAtomCounts() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mAtomCounts;
+  }
+
+  size_t getNumReports() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNumReports;
+  }
+
+ private:
+  std::mutex mMutex;
+  AtomCounts mAtomCounts;
+  size_t mNumReports = 0;
+};
+
+class MetricsReporterTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<MetricsReporter> createReporter(
+      MetricsReporter::AggregationConfig config) {
+    return std::make_unique<MetricsReporter>(config, mStatsService);
+  }
+
+  /**
+   * Logs a stream of metrics to the reporter and returns the atoms the stream
+   * consists of, as the reporter would report them if not aggregated.
+   */
+  AtomCounts logRawStream(MetricsReporter &reporter) {
+    std::shared_ptr<FakeStatsService> rawStatsService =
+        ndk::SharedRefBase::make<FakeStatsService>();
+    MetricsReporter rawReporter({.window = std::chrono::milliseconds(0)},
+                                rawStatsService);
+    for (uint32_t i = 0; i < 1000; i++) {
+      for (MetricsReporter *target : {&reporter, &rawReporter}) {
+        uint64_t nanoappId = 0x476f6f676c000000 + i % 7;
+        target->logApWakeupOccurred(nanoappId);
+        if (i % 50 == 0) {
+          target->logNanoappLoadFailed(
+              nanoappId, ChreHalNanoappLoadFailed::TYPE_DYNAMIC,
+              ChreHalNanoappLoadFailed::REASON_ERROR_GENERIC);
+        }
+        if (i % 100 == 0) {
+          target->logPalOpenFailed(
+              static_cast<ChrePalOpenFailed::ChrePalType>(1 + i / 100 % 6),
+              static_cast<ChrePalOpenFailed::Type>(1 /* INITIAL_OPEN */));
+        }
+      }
+    }
+    return rawStatsService->getAtomCounts();
+  }
+
+  //! Waits for the stats service to receive the given number of reports.
+  bool waitForReports(size_t numReports) {
+    auto deadline = std::chrono::steady_clock::now() + kTimeout;
+    while (mStatsService->getNumReports() < numReports &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return mStatsService->getNumReports() >= numReports;
+  }
+
+  //! @return The occurrence counts reported, ordered by atom.
+  std::vector<uint32_t> getCounts() {
+    std::vector<uint32_t> counts;
+    for (const auto &[atom, count] : mStatsService->getAtomCounts()) {
+      counts.push_back(count);
+    }
+    return counts;
+  }
+
+  std::shared_ptr<FakeStatsService> mStatsService =
+      ndk::SharedRefBase::make<FakeStatsService>();
+};
+
+}  // namespace
+
+TEST_F(MetricsReporterTest, AggregatedCountsMatchRawStream) {
+  auto reporter = createReporter({.window = kLongWindow});
+  AtomCounts expected = logRawStream(*reporter);
+  // Nothing is reported before the end of the window
+  EXPECT_EQ(mStatsService->getNumReports(), 0u);
+
+  reporter->flush();
+  EXPECT_EQ(mStatsService->getAtomCounts(), expected);
+  // Each atom is reported once, with its count
+  EXPECT_EQ(mStatsService->getNumReports(), expected.size());
+}
+
+TEST_F(MetricsReporterTest, FlushesOnShutdown) {
+  auto reporter = createReporter({.window = kLongWindow});
+  AtomCounts expected = logRawStream(*reporter);
+
+  reporter.reset();
+  EXPECT_EQ(mStatsService->getAtomCounts(), expected);
+}
+
+TEST_F(MetricsReporterTest, FlushesAtTheEndOfTheWindow) {
+  auto reporter = createReporter({.window = std::chrono::milliseconds(20)});
+  EXPECT_TRUE(reporter->logApWakeupOccurred(1));
+  EXPECT_TRUE(reporter->logApWakeupOccurred(1));
+
+  EXPECT_TRUE(waitForReports(1));
+  EXPECT_EQ(mStatsService->getNumReports(), 1u);
+  EXPECT_EQ(getCounts(), (std::vector<uint32_t>{2}));
+}
+
+TEST_F(MetricsReporterTest, ReportsEachAtomOnceWithItsCount) {
+  auto reporter = createReporter({.window = kLongWindow});
+  for (int i = 0; i < 20; i++) {
+    reporter->logApWakeupOccurred(1);
+  }
+  for (int i = 0; i < 3; i++) {
+    reporter->logApWakeupOccurred(2);
+  }
+  reporter->flush();
+
+  EXPECT_EQ(mStatsService->getNumReports(), 2u);
+  EXPECT_EQ(getCounts(), (std::vector<uint32_t>{20, 3}));
+}
+
+TEST_F(MetricsReporterTest, BoundsTheNumberOfAggregatedAtoms) {
+  auto reporter = createReporter({.window = kLongWindow, .maxAtoms = 2});
+  EXPECT_TRUE(reporter->logApWakeupOccurred(1));
+  EXPECT_TRUE(reporter->logApWakeupOccurred(2));
+  // Further occurrences of aggregated atoms are still recorded
+  EXPECT_TRUE(reporter->logApWakeupOccurred(1));
+
+  reporter->flush();
+  EXPECT_EQ(mStatsService->getNumReports(), 2u);
+  EXPECT_EQ(getCounts(), (std::vector<uint32_t>{2, 1}));
+}
+
+TEST_F(MetricsReporterTest, LimitsEarlyReportsPerWindow) {
+  auto reporter = createReporter(
+      {.window = kLongWindow, .maxAtoms = 1, .maxReportsPerAtom = 2});
+  EXPECT_TRUE(reporter->logApWakeupOccurred(1));
+  // Makes room for the new atom by reporting the aggregated one early
+  EXPECT_FALSE(reporter->logApWakeupOccurred(2));
+  ASSERT_TRUE(waitForReports(1));
+  EXPECT_TRUE(reporter->logApWakeupOccurred(2));
+
+  // Reporting early again would exceed 2 reports per atom in the window
+  EXPECT_FALSE(reporter->logApWakeupOccurred(3));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(mStatsService->getNumReports(), 1u);
+
+  reporter->flush();
+  EXPECT_EQ(getCounts(), (std::vector<uint32_t>{1, 1}));
+}
+
+TEST_F(MetricsReporterTest, ReportsSnapshotsImmediately) {
+  auto reporter = createReporter({.window = kLongWindow});
+  EXPECT_TRUE(reporter->logEventQueueSnapshotReported(
+      /* snapshotChreGetTimeMs= */ 1, /* max_event_queue_size= */ 2,
+      /* mean_event_queue_size= */ 3, /* num_dropped_events= */ 4));
+  EXPECT_EQ(mStatsService->getNumReports(), 1u);
+}
+
+}  // namespace android::chre
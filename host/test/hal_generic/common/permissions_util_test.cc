@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "permissions_util.h"
+
+#include "chre/util/system/napp_permissions.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace android::hardware::contexthub::common::implementation {
+namespace {
+
+using ::chre::NanoappPermissions;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+uint32_t toBitmask(NanoappPermissions permission) {
+  return static_cast<uint32_t>(permission);
+}
+
+TEST(PermissionsUtilTest, ConvertsEachPermission) {
+  EXPECT_THAT(chreToAndroidPermissions(0), IsEmpty());
+  EXPECT_THAT(
+      chreToAndroidPermissions(toBitmask(NanoappPermissions::CHRE_PERMS_AUDIO)),
+      ElementsAre(kRecordAudioPerm));
+  for (NanoappPermissions permission :
+       {NanoappPermissions::CHRE_PERMS_GNSS,
+        NanoappPermissions::CHRE_PERMS_WIFI,
+        NanoappPermissions::CHRE_PERMS_WWAN}) {
+    EXPECT_THAT(chreToAndroidPermissions(toBitmask(permission)),
+                ElementsAre(kFineLocationPerm, kBackgroundLocationPerm));
+  }
+  EXPECT_THAT(
+      chreToAndroidPermissions(toBitmask(NanoappPermissions::CHRE_PERMS_BLE)),
+      ElementsAre(kBluetoothScanPerm));
+}
+
+TEST(PermissionsUtilTest, ConvertsCombinedPermissions) {
+  uint32_t permissions = toBitmask(NanoappPermissions::CHRE_PERMS_AUDIO) |
+                         toBitmask(NanoappPermissions::CHRE_PERMS_GNSS) |
+                         toBitmask(NanoappPermissions::CHRE_PERMS_WIFI) |
+                         toBitmask(NanoappPermissions::CHRE_PERMS_BLE);
+  EXPECT_THAT(chreToAndroidPermissions(permissions),
+              ElementsAre(kRecordAudioPerm, kFineLocationPerm,
+                          kBackgroundLocationPerm, kBluetoothScanPerm));
+}
+
+TEST(PermissionsUtilTest, SharesListsBetweenConversions) {
+  uint32_t gnss = toBitmask(NanoappPermissions::CHRE_PERMS_GNSS);
+  uint32_t wifi = toBitmask(NanoappPermissions::CHRE_PERMS_WIFI);
+  EXPECT_EQ(&chreToAndroidPermissions(gnss), &chreToAndroidPermissions(gnss));
+  // Bitmasks converting to the same permissions share the same list
+  EXPECT_EQ(&chreToAndroidPermissions(gnss), &chreToAndroidPermissions(wifi));
+  EXPECT_EQ(&chreToAndroidPermissions(0), &chreToAndroidPermissions(1u << 31));
+}
+
+}  // namespace
+}  // namespace android::hardware::contexthub::common::implementation
@@ -0,0 +1,532 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "chre_connection.h"
+#include "chre_host/host_protocol_host.h"
+#include "chre_host/napp_header.h"
+#include "chre_host/preloaded_nanoapp_loader.h"
+#include "event_logger.h"
+#include "gtest/gtest.h"
+#include "hal_client_id.h"
+
+namespace android::hardware::contexthub::common::implementation {
+
+namespace {
+
+using ::aidl::android::hardware::contexthub::EventLogger;
+using ::android::chre::HostProtocolHost;
+using ::android::chre::NanoAppBinaryHeader;
+using ::android::chre::PreloadedNanoappLoader;
+using ::std::chrono::milliseconds;
+
+namespace fbs = ::chre::fbs;
+
+constexpr size_t kNumNanoapps = 8;
+constexpr size_t kFragmentsPerNanoapp = 5;
+constexpr uint64_t kAppIdBase = 0x476f6f676c000100;
+
+constexpr milliseconds kLinkDelay(2);
+
+/**
+ * Emulates the fragmented load handling of CHRE, see NanoappLoadManager,
+ * behind a link which delays every message in each direction.
+ */
+class FakeChreConnection : public ChreConnection {
+ public:
+  struct Options {
+    //! The window CHRE accepts, 0 to emulate a CHRE without windowing.
+    uint32_t windowSize = 4;
+    //! The number of nanoapp binaries CHRE has memory for at once.
+    size_t numNanoappBuffers = 1;
+    //! The number of concurrent loads the loader is allowed.
+    size_t maxConcurrentLoads = 1;
+    //! (transaction ID, fragment ID) of fragments lost the first time.
+    std::set<std::pair<uint32_t, uint32_t>> droppedFragments;
+    //! (transaction ID, fragment ID) of responses lost the first time.
+    std::set<std::pair<uint32_t, uint32_t>> droppedResponses;
+    //! Whether CHRE retains the binaries of loaded nanoapps across restarts.
+    bool retainsBinaries = false;
+  };
+
+  explicit FakeChreConnection(Options options)
+      : mOptions(std::move(options)), mThread([this]() { run(); }) {}
+
+  ~FakeChreConnection() override {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStopped = true;
+    }
+    mCondition.notify_all();
+    mThread.join();
+  }
+
+  //! Sets the loader responses are delivered to, or nullptr to drop them.
+  void setLoader(PreloadedNanoappLoader *loader) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLoader = loader;
+  }
+
+  bool init() override {
+    return true;
+  }
+
+  bool sendMessage(void *data, size_t length) override {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    std::lock_guard<std::mutex> lock(mMutex);
+    Packet packet;
+    packet.deliveryTime = std::chrono::steady_clock::now() + kLinkDelay;
+    packet.request.assign(bytes, bytes + length);
+    // Each loader thread waits for the response to its previous request
+    std::thread::id threadId = std::this_thread::get_id();
+    packet.roundTrip = mLastRoundTripByThread[threadId] + 1;
+    mMaxRoundTrip = std::max(mMaxRoundTrip, packet.roundTrip);
+    const auto *request = fbs::GetMessageContainer(bytes)
+                              ->message_as_LoadNanoappRequest();
+    if (request != nullptr) {
+      mThreadByTransaction[request->transaction_id()] = threadId;
+    }
+    mLink.push_back(std::move(packet));
+    mNumInFlight++;
+    mMaxInFlight = std::max(mMaxInFlight, mNumInFlight);
+    mCondition.notify_all();
+    return true;
+  }
+
+  size_t getMaxConcurrentNanoappLoads() const override {
+    return mOptions.maxConcurrentLoads;
+  }
+
+  size_t getMaxInFlight() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMaxInFlight;
+  }
+
+  //! @return The number of sequential round trips the loads took, i.e. the
+  //!         longest chain of requests each sent by a loader thread after it
+  //!         received the response to its previous request.
+  uint32_t getNumRoundTrips() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMaxRoundTrip;
+  }
+
+  size_t getNumListQueries() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNumListQueries;
+  }
+
+  size_t getNumFragmentsReceived() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNumFragmentsReceived;
+  }
+
+  size_t getNumLoaded() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mLoadedAppIds.size();
+  }
+
+  //! Emulates a restart of CHRE, which unloads all nanoapps.
+  void restart() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTransactions.clear();
+    mLoadedAppIds.clear();
+  }
+
+ private:
+  //! A request to CHRE, or a response from it if request is empty.
+  struct Packet {
+    std::chrono::steady_clock::time_point deliveryTime;
+    //! The round trip a request was sent in, which its response belongs to.
+    uint32_t roundTrip = 0;
+    std::vector<uint8_t> request;
+    bool isListResponse = false;
+    fbs::LoadNanoappResponseT response;
+    fbs::NanoappListResponseT listResponse;
+  };
+
+  struct Transaction {
+    uint32_t nextFragmentId;
+    uint32_t windowSize;
+    uint64_t binaryHash;
+  };
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mStopped) {
+      if (mLink.empty()) {
+        mCondition.wait(lock);
+      } else if (std::chrono::steady_clock::now() <
+                 mLink.front().deliveryTime) {
+        mCondition.wait_until(lock, mLink.front().deliveryTime);
+      } else {
+        Packet packet = std::move(mLink.front());
+        mLink.pop_front();
+        if (!packet.request.empty()) {
+          mNumInFlight--;
+          mRequestRoundTrip = packet.roundTrip;
+          handleRequest(packet.request);
+        } else if (mLoader != nullptr) {
+          if (!packet.isListResponse) {
+            uint32_t &lastRoundTrip = mLastRoundTripByThread
+                [mThreadByTransaction[packet.response.transaction_id]];
+            lastRoundTrip = std::max(lastRoundTrip, packet.roundTrip);
+          }
+          // The loader may send more fragments from within the callback
+          PreloadedNanoappLoader *loader = mLoader;
+          lock.unlock();
+          if (packet.isListResponse) {
+            loader->onNanoappListResponse(packet.listResponse, kHalId);
+          } else {
+            loader->onLoadNanoappResponse(packet.response, kHalId);
+          }
+          lock.lock();
+        }
+      }
+    }
+  }
+
+  void handleRequest(const std::vector<uint8_t> &data) {
+    const fbs::MessageContainer *container =
+        fbs::GetMessageContainer(data.data());
+    if (container->message_as_NanoappListRequest() != nullptr) {
+      mNumListQueries++;
+      sendListResponse();
+      return;
+    }
+    const auto *request = container->message_as_LoadNanoappRequest();
+    ASSERT_NE(request, nullptr);
+    uint32_t transactionId = request->transaction_id();
+    uint32_t fragmentId = request->fragment_id();
+    mNumFragmentsReceived++;
+    if (mOptions.droppedFragments.erase({transactionId, fragmentId}) > 0) {
+      return;
+    }
+
+    auto it = mTransactions.find(transactionId);
+    bool isWindowed = mOptions.windowSize > 0;
+    if (fragmentId == 1 && (!isWindowed || it == mTransactions.end())) {
+      auto retained = mRetainedBinaryHashes.find(request->app_id());
+      if (request->app_binary_hash() != 0 &&
+          retained != mRetainedBinaryHashes.end() &&
+          retained->second == request->app_binary_hash()) {
+        mLoadedAppIds.insert(request->app_id());
+        sendResponse(transactionId, fragmentId, /* success= */ true,
+                     mOptions.windowSize, /* binaryResident= */ true);
+        return;
+      }
+      if (it == mTransactions.end() &&
+          mTransactions.size() >= mOptions.numNanoappBuffers) {
+        // Out of memory for another nanoapp binary
+        sendResponse(transactionId, fragmentId, /* success= */ false, 0);
+        return;
+      }
+      uint32_t windowSize =
+          std::min(request->fragment_window_size(), mOptions.windowSize);
+      it = mTransactions
+               .insert_or_assign(
+                   transactionId,
+                   Transaction{1, windowSize, request->app_binary_hash()})
+               .first;
+    }
+
+    if (it == mTransactions.end()) {
+      sendResponse(transactionId, fragmentId, /* success= */ false, 0);
+      return;
+    }
+    Transaction &transaction = it->second;
+    bool success = true;
+    if (fragmentId == transaction.nextFragmentId) {
+      transaction.nextFragmentId++;
+    } else if (transaction.windowSize == 0) {
+      success = false;
+    }
+    // Windowed transactions are acknowledged cumulatively
+    uint32_t ackedFragmentId = (transaction.windowSize == 0)
+                                   ? fragmentId
+                                   : transaction.nextFragmentId - 1;
+    uint32_t windowSize = transaction.windowSize;
+    if (!success || transaction.nextFragmentId > kFragmentsPerNanoapp) {
+      if (success) {
+        mLoadedAppIds.insert(request->app_id());
+        if (mOptions.retainsBinaries) {
+          mRetainedBinaryHashes[request->app_id()] = transaction.binaryHash;
+        }
+      }
+      mTransactions.erase(it);
+    }
+    sendResponse(transactionId, ackedFragmentId, success, windowSize);
+  }
+
+  void sendResponse(uint32_t transactionId, uint32_t fragmentId, bool success,
+                    uint32_t windowSize, bool binaryResident = false) {
+    if (mOptions.droppedResponses.erase({transactionId, fragmentId}) > 0) {
+      return;
+    }
+    Packet packet;
+    packet.deliveryTime = std::chrono::steady_clock::now() + kLinkDelay;
+    packet.roundTrip = mRequestRoundTrip;
+    packet.response.transaction_id = transactionId;
+    packet.response.fragment_id = fragmentId;
+    packet.response.success = success;
+    packet.response.fragment_window_size = windowSize;
+    packet.response.binary_resident = binaryResident;
+    mLink.push_back(std::move(packet));
+  }
+
+  void sendListResponse() {
+    Packet packet;
+    packet.deliveryTime = std::chrono::steady_clock::now() + kLinkDelay;
+    packet.roundTrip = mRequestRoundTrip;
+    packet.isListResponse = true;
+    for (uint64_t appId : mLoadedAppIds) {
+      auto entry = std::make_unique<fbs::NanoappListEntryT>();
+      entry->app_id = appId;
+      packet.listResponse.nanoapps.push_back(std::move(entry));
+    }
+    mLink.push_back(std::move(packet));
+  }
+
+  Options mOptions;
+  PreloadedNanoappLoader *mLoader = nullptr;
+
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  //! Messages in both directions, in the order they are delivered.
+  std::deque<Packet> mLink;
+  std::map<uint32_t, Transaction> mTransactions;
+  std::set<uint64_t> mLoadedAppIds;
+  //! The hashes of the binaries retained by CHRE, keyed by app ID.
+  std::map<uint64_t, uint64_t> mRetainedBinaryHashes;
+  size_t mNumInFlight = 0;
+  size_t mMaxInFlight = 0;
+  size_t mNumFragmentsReceived = 0;
+  size_t mNumListQueries = 0;
+  //! The round trip of the request being handled.
+  uint32_t mRequestRoundTrip = 0;
+  //! The loader thread that sent the requests of each transaction.
+  std::map<uint32_t, std::thread::id> mThreadByTransaction;
+  //! The latest round trip a response was delivered for, by loader thread.
+  std::map<std::thread::id, uint32_t> mLastRoundTripByThread;
+  uint32_t mMaxRoundTrip = 0;
+  bool mStopped = false;
+
+  std::thread mThread;
+};
+
+class PreloadedNanoappLoaderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mDirectory = std::filesystem::temp_directory_path() /
+                 "preloaded_nanoapp_loader_test";
+    std::filesystem::create_directories(mDirectory);
+
+    std::ofstream config(mConfigPath);
+    config << R"({"source_dir": ")" << mDirectory.string()
+           << R"(", "nanoapps": [)";
+    for (size_t i = 0; i < kNumNanoapps; i++) {
+      std::string name = "nanoapp_" + std::to_string(i);
+      config << (i == 0 ? "" : ", ") << '"' << name << '"';
+
+      NanoAppBinaryHeader header{};
+      header.appId = kAppIdBase + i;
+      header.appVersion = 1;
+      std::ofstream headerFile(mDirectory / (name + ".napp_header"),
+                               std::ios::binary);
+      headerFile.write(reinterpret_cast<const char *>(&header),
+                       sizeof(header));
+
+      std::vector<char> binary(kFragmentsPerNanoapp *
+                               CHRE_HOST_DEFAULT_FRAGMENT_SIZE);
+      std::ofstream binaryFile(mDirectory / (name + ".so"), std::ios::binary);
+      binaryFile.write(binary.data(), binary.size());
+    }
+    config << "]}";
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(mDirectory);
+  }
+
+  //! Loads all nanoapps.
+  void loadNanoapps(FakeChreConnection &connection, int *numLoaded) {
+    PreloadedNanoappLoader loader(&connection, mEventLogger,
+                                  /* metricsReporter= */ nullptr,
+                                  mConfigPath.string(),
+                                  /* nanoappLoadListener= */ nullptr);
+    loadNanoapps(connection, loader, numLoaded);
+  }
+
+  //! Same as above, with a loader kept across loads.
+  void loadNanoapps(FakeChreConnection &connection,
+                    PreloadedNanoappLoader &loader, int *numLoaded) {
+    connection.setLoader(&loader);
+    *numLoaded = loader.loadPreloadedNanoapps();
+    connection.setLoader(nullptr);
+  }
+
+  std::filesystem::path mDirectory;
+  std::filesystem::path mConfigPath = std::filesystem::temp_directory_path() /
+                                      "preloaded_nanoapps_test.json";
+  EventLogger mEventLogger;
+};
+
+TEST_F(PreloadedNanoappLoaderTest, WaitsForEachFragmentWithoutWindow) {
+  FakeChreConnection connection({.windowSize = 0});
+  int numLoaded = 0;
+  loadNanoapps(connection, &numLoaded);
+
+  EXPECT_EQ(numLoaded, kNumNanoapps);
+  EXPECT_EQ(connection.getNumLoaded(), kNumNanoapps);
+  EXPECT_EQ(connection.getMaxInFlight(), 1);
+  EXPECT_EQ(connection.getNumFragmentsReceived(),
+            kNumNanoapps * kFragmentsPerNanoapp);
+}
+
+TEST_F(PreloadedNanoappLoaderTest, KeepsWindowOfFragmentsInFlight) {
+  FakeChreConnection connection({.windowSize = 3});
+  int numLoaded = 0;
+  loadNanoapps(connection, &numLoaded);
+
+  EXPECT_EQ(numLoaded, kNumNanoapps);
+  EXPECT_EQ(connection.getNumLoaded(), kNumNanoapps);
+  EXPECT_EQ(connection.getMaxInFlight(), 3);
+  EXPECT_EQ(connection.getNumFragmentsReceived(),
+            kNumNanoapps * kFragmentsPerNanoapp);
+}
+
+TEST_F(PreloadedNanoappLoaderTest, ResendsFragmentsAfterLostFragment) {
+  FakeChreConnection connection({.droppedFragments = {{2, 3}, {5, 5}}});
+  int numLoaded = 0;
+  loadNanoapps(connection, &numLoaded);
+
+  EXPECT_EQ(numLoaded, kNumNanoapps);
+  EXPECT_EQ(connection.getNumLoaded(), kNumNanoapps);
+  EXPECT_GT(connection.getNumFragmentsReceived(),
+            kNumNanoapps * kFragmentsPerNanoapp);
+}
+
+TEST_F(PreloadedNanoappLoaderTest, ConfirmsLoadAfterLostFinalAck) {
+  // The final fragment is resent, which CHRE fails as the transaction is done
+  FakeChreConnection connection(
+      {.droppedResponses = {{1, kFragmentsPerNanoapp}}});
+  int numLoaded = 0;
+  loadNanoapps(connection, &numLoaded);
+
+  EXPECT_EQ(numLoaded, kNumNanoapps);
+  EXPECT_EQ(connection.getNumLoaded(), kNumNanoapps);
+  EXPECT_EQ(connection.getNumListQueries(), 1);
+}
+
+TEST_F(PreloadedNanoappLoaderTest, RetriesConcurrentLoadsOnItsOwn) {
+  // CHRE only has memory for a single nanoapp binary at a time
+  FakeChreConnection connection({.numNanoappBuffers = 1,
+                                 .maxConcurrentLoads = 3});
+  int numLoaded = 0;
+  loadNanoapps(connection, &numLoaded);
+
+  EXPECT_EQ(numLoaded, kNumNanoapps);
+  EXPECT_EQ(connection.getNumLoaded(), kNumNanoapps);
+}
+
+TEST_F(PreloadedNanoappLoaderTest, SkipsTransferOfRetainedBinaries) {
+  FakeChreConnection connection({.retainsBinaries = true});
+  PreloadedNanoappLoader loader(&connection, mEventLogger,
+                                /* metricsReporter= */ nullptr,
+                                mConfigPath.string(),
+                                /* nanoappLoadListener= */ nullptr);
+  int numLoaded = 0;
+  loadNanoapps(connection, loader, &numLoaded);
+  EXPECT_EQ(numLoaded, kNumNanoapps);
+  EXPECT_EQ(connection.getNumFragmentsReceived(),
+            kNumNanoapps * kFragmentsPerNanoapp);
+
+  // Only the first fragment of each nanoapp is sent after the restart
+  connection.restart();
+  loadNanoapps(connection, loader, &numLoaded);
+  EXPECT_EQ(numLoaded, kNumNanoapps);
+  EXPECT_EQ(connection.getNumLoaded(), kNumNanoapps);
+  EXPECT_EQ(connection.getNumFragmentsReceived(),
+            kNumNanoapps * kFragmentsPerNanoapp + kNumNanoapps);
+}
+
+TEST_F(PreloadedNanoappLoaderTest, TransfersModifiedBinary) {
+  FakeChreConnection connection({.retainsBinaries = true});
+  PreloadedNanoappLoader loader(&connection, mEventLogger,
+                                /* metricsReporter= */ nullptr,
+                                mConfigPath.string(),
+                                /* nanoappLoadListener= */ nullptr);
+  int numLoaded = 0;
+  loadNanoapps(connection, loader, &numLoaded);
+  EXPECT_EQ(numLoaded, kNumNanoapps);
+
+  std::filesystem::path binaryPath = mDirectory / "nanoapp_0.so";
+  auto modifiedTime = std::filesystem::last_write_time(binaryPath);
+  {
+    std::vector<char> binary(kFragmentsPerNanoapp *
+                                 CHRE_HOST_DEFAULT_FRAGMENT_SIZE,
+                             1);
+    std::ofstream binaryFile(binaryPath, std::ios::binary);
+    binaryFile.write(binary.data(), binary.size());
+  }
+  std::filesystem::last_write_time(binaryPath,
+                                   modifiedTime + std::chrono::seconds(1));
+
+  connection.restart();
+  size_t numFragmentsBefore = connection.getNumFragmentsReceived();
+  loadNanoapps(connection, loader, &numLoaded);
+  EXPECT_EQ(numLoaded, kNumNanoapps);
+  EXPECT_EQ(connection.getNumLoaded(), kNumNanoapps);
+  EXPECT_EQ(connection.getNumFragmentsReceived() - numFragmentsBefore,
+            (kNumNanoapps - 1) + kFragmentsPerNanoapp);
+}
+
+TEST_F(PreloadedNanoappLoaderTest, PipelinedLoadingTakesFewerRoundTrips) {
+  int numLoaded = 0;
+  FakeChreConnection stopAndWait({.windowSize = 0});
+  loadNanoapps(stopAndWait, &numLoaded);
+  EXPECT_EQ(numLoaded, kNumNanoapps);
+  EXPECT_EQ(stopAndWait.getNumRoundTrips(),
+            kNumNanoapps * kFragmentsPerNanoapp);
+
+  FakeChreConnection windowed({.windowSize = 4});
+  loadNanoapps(windowed, &numLoaded);
+  EXPECT_EQ(numLoaded, kNumNanoapps);
+
+  FakeChreConnection concurrent(
+      {.windowSize = 4, .numNanoappBuffers = 2, .maxConcurrentLoads = 2});
+  loadNanoapps(concurrent, &numLoaded);
+  EXPECT_EQ(numLoaded, kNumNanoapps);
+
+  EXPECT_LT(windowed.getNumRoundTrips(), stopAndWait.getNumRoundTrips());
+  EXPECT_LT(concurrent.getNumRoundTrips(), windowed.getNumRoundTrips());
+}
+
+}  // namespace
+}  // namespace android::hardware::contexthub::common::implementation
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "chre_host/trace_exporter.h"
+#include "gtest/gtest.h"
+
+namespace android::chre {
+
+namespace {
+
+namespace fbs = ::chre::fbs;
+
+constexpr uint16_t kNoGroup = 0xffff;
+
+//! Builds TraceData messages with the encoding of host_protocol_chre.cc.
+class TraceDataBuilder {
+ public:
+  uint16_t addString(const std::string &str) {
+    auto offset = static_cast<uint16_t>(mData.strings.size());
+    mData.strings.insert(mData.strings.end(), str.begin(), str.end());
+    mData.strings.push_back(0);
+    return offset;
+  }
+
+  void addRecord(uint64_t timestampNs, uint32_t traceId, uint16_t label,
+                 uint16_t group, uint8_t type, uint8_t thread) {
+    append(timestampNs, sizeof(timestampNs));
+    append(traceId, sizeof(traceId));
+    append(label, sizeof(label));
+    append(group, sizeof(group));
+    mData.records.push_back(type);
+    mData.records.push_back(thread);
+  }
+
+  fbs::TraceDataT &data() {
+    return mData;
+  }
+
+ private:
+  fbs::TraceDataT mData;
+
+  void append(uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      mData.records.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+};
+
+TEST(TraceExporterTest, ExportsRecordsOrderedByTimestamp) {
+  TraceExporter exporter;
+
+  TraceDataBuilder thread1;
+  uint16_t label = thread1.addString("Deliver event");
+  uint16_t group = thread1.addString("event_loop");
+  thread1.addRecord(2000, 3, label, group, 1, 1);
+  thread1.addRecord(5500, 3, label, group, 2, 1);
+  ASSERT_TRUE(exporter.addTraceData(thread1.data()));
+  EXPECT_FALSE(exporter.isComplete());
+
+  TraceDataBuilder thread0;
+  label = thread0.addString("Timer \"fired\"");
+  thread0.addRecord(3001, 0, label, kNoGroup, 0, 0);
+  thread0.data().num_dropped = 4;
+  thread0.data().last = true;
+  ASSERT_TRUE(exporter.addTraceData(thread0.data()));
+  EXPECT_TRUE(exporter.isComplete());
+  EXPECT_EQ(exporter.getNumRecords(), 3);
+  EXPECT_EQ(exporter.getNumDropped(), 4);
+
+  std::ostringstream json;
+  exporter.writeChromeJson(json);
+  EXPECT_EQ(json.str(),
+            "{\"traceEvents\":[\n"
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,"
+            "\"args\":{\"name\":\"CHRE thread 0\"}},\n"
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,"
+            "\"args\":{\"name\":\"CHRE thread 1\"}},\n"
+            "{\"name\":\"Deliver event\",\"cat\":\"event_loop\",\"ph\":\"B\","
+            "\"ts\":2.000,\"pid\":0,\"tid\":1,\"args\":{\"trace_id\":3}},\n"
+            "{\"name\":\"Timer \\\"fired\\\"\",\"ph\":\"i\",\"s\":\"t\","
+            "\"ts\":3.001,\"pid\":0,\"tid\":0,\"args\":{\"trace_id\":0}},\n"
+            "{\"name\":\"Deliver event\",\"cat\":\"event_loop\",\"ph\":\"E\","
+            "\"ts\":5.500,\"pid\":0,\"tid\":1,\"args\":{\"trace_id\":3}}\n"
+            "],\"displayTimeUnit\":\"ns\",\"otherData\":{\"droppedRecords\":4}}"
+            "\n");
+}
+
+TEST(TraceExporterTest, RejectsMalformedTraceData) {
+  TraceExporter exporter;
+  TraceDataBuilder builder;
+  uint16_t label = builder.addString("label");
+
+  // A partial record
+  builder.addRecord(1000, 0, label, kNoGroup, 0, 0);
+  builder.data().records.pop_back();
+  builder.data().last = true;
+  EXPECT_FALSE(exporter.addTraceData(builder.data()));
+
+  // A string offset out of bounds
+  builder.data().records.clear();
+  builder.addRecord(1000, 0, label, label + 100, 0, 0);
+  EXPECT_FALSE(exporter.addTraceData(builder.data()));
+
+  // An unterminated string
+  builder.data().records.clear();
+  builder.addRecord(1000, 0, label, kNoGroup, 0, 0);
+  builder.data().strings.pop_back();
+  EXPECT_FALSE(exporter.addTraceData(builder.data()));
+
+  // An unknown record type
+  builder.data().strings.push_back(0);
+  builder.data().records.clear();
+  builder.addRecord(1000, 0, label, kNoGroup, 3, 0);
+  EXPECT_FALSE(exporter.addTraceData(builder.data()));
+
+  EXPECT_EQ(exporter.getNumRecords(), 0);
+  EXPECT_FALSE(exporter.isComplete());
+}
+
+}  // namespace
+
+}  // namespace android::chre
@@ -31,9 +31,13 @@ bool NanoappLoader::relocateTable(DynamicHeader *dyn, int tag) {
         break;
       }
 
-      ElfRel *reloc =
-          reinterpret_cast<ElfRel *>(mBinary + getDynEntry(dyn, DT_REL));
       size_t relocSize = getDynEntry(dyn, DT_RELSZ);
+      ElfRel *reloc = reinterpret_cast<ElfRel *>(
+          getFileData(getDynEntry(dyn, DT_REL), relocSize));
+      if (reloc == nullptr) {
+        LOGE("DT_REL table is out of bounds");
+        break;
+      }
       size_t nRelocs = relocSize / sizeof(ElfRel);
       LOGV("Relocation %zu entries in DT_REL table", nRelocs);
 
@@ -152,11 +152,14 @@ void HostMessageHandlers::handlePulseRequest() {}
 void HostMessageHandlers::sendFragmentResponse(uint16_t hostClientId,
                                                uint32_t transactionId,
                                                uint32_t fragmentId,
-                                               bool success) {
+                                               bool success,
+                                               uint32_t fragmentWindowSize,
+                                               bool binaryResident) {
   constexpr size_t kInitialBufferSize = 52;
   ChreFlatBufferBuilder builder(kInitialBufferSize);
   HostProtocolChre::encodeLoadNanoappResponse(
-      builder, hostClientId, transactionId, success, fragmentId);
+      builder, hostClientId, transactionId, success, fragmentId,
+      fragmentWindowSize, binaryResident);
 
   if (!getHostCommsManager().send(builder.GetBufferPointer(),
                                   builder.GetSize())) {
@@ -170,12 +173,13 @@ void HostMessageHandlers::handleLoadNanoappRequest(
     uint16_t hostClientId, uint32_t transactionId, uint64_t appId,
     uint32_t appVersion, uint32_t appFlags, uint32_t targetApiVersion,
     const void *buffer, size_t bufferLen, const char *appFileName,
-    uint32_t fragmentId, size_t appBinaryLen, bool respondBeforeStart) {
+    uint32_t fragmentId, size_t appBinaryLen, bool respondBeforeStart,
+    uint32_t fragmentWindowSize, uint64_t appBinaryHash) {
   UNUSED_VAR(appFileName);
 
   loadNanoappData(hostClientId, transactionId, appId, appVersion, appFlags,
                   targetApiVersion, buffer, bufferLen, fragmentId, appBinaryLen,
-                  respondBeforeStart);
+                  respondBeforeStart, fragmentWindowSize, appBinaryHash);
 }
 
 void HostMessageHandlers::handleUnloadNanoappRequest(
@@ -221,4 +225,9 @@ void HostMessageHandlers::handleNanConfigurationUpdate(bool /* enabled */) {
   LOGE("NAN unsupported.");
 }
 
+void HostMessageHandlers::handleTraceDataRequest(
+    uint16_t /* hostClientId */) {
+  LOGE("Trace data unsupported.");
+}
+
 }  // namespace chre
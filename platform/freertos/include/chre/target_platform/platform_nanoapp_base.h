@@ -22,6 +22,9 @@
 
 namespace chre {
 
+class NanoappLoader;
+struct BinaryAuthentication;
+
 /**
  * FREERTOS-specific nanoapp functionality.
  */
@@ -109,8 +112,24 @@ class PlatformNanoappBase {
   //! Buffer containing the complete DSO binary - only populated if
   //! copyNanoappFragment() was used to load this nanoapp
   void *mAppBinary = nullptr;
+
+  //! The length of the binary sent by the host, including the authentication
+  //! header.
   size_t mAppBinaryLen = 0;
 
+  //! Loader mapping the binary as it is copied by copyNanoappFragment(), used
+  //! instead of mAppBinary if CHRE_NANOAPP_STREAMING_LOAD_ENABLED is defined.
+  //! It becomes mDsoHandle once the nanoapp is opened.
+  NanoappLoader *mStreamingLoader = nullptr;
+
+  //! The binary being authenticated as it is copied by copyNanoappFragment(),
+  //! if CHRE_NAPP_AUTHENTICATION_ENABLED is defined.
+  BinaryAuthentication *mAuthentication = nullptr;
+
+  //! The size of the authentication header at the start of the binary, which
+  //! isn't copied into mAppBinary or mStreamingLoader.
+  size_t mAuthenticationHeaderSize = 0;
+
   //! Null-terminated ASCII string containing the file name that contains the
   //! app binary to be loaded. This is used over mAppBinary to load the nanoapp
   //! if set.
@@ -149,6 +168,32 @@ class PlatformNanoappBase {
    */
   bool openNanoapp();
 
+  /**
+   * Starts authenticating the binary if authentication is enabled, which sets
+   * mAuthentication and mAuthenticationHeaderSize.
+   *
+   * @return true if the binary may be loaded.
+   */
+  bool startAuthentication(size_t appBinaryLen);
+
+  /**
+   * Allocates mAppBinary, or mStreamingLoader if
+   * CHRE_NANOAPP_STREAMING_LOAD_ENABLED is defined, to hold the binary
+   * following the authentication header.
+   *
+   * @return true if the allocation was successful.
+   */
+  bool allocateBinary(size_t binaryLen, bool tcmCapable);
+
+  /**
+   * Verifies the signature of the fully copied binary and releases
+   * mAuthentication.
+   *
+   * @return true if the binary passed authentication or authentication is
+   *         disabled.
+   */
+  bool finishAuthentication();
+
   /**
    * Releases the DSO handle if it was active, by calling dlclose(). This will
    * result in execution of any unload handlers in the nanoapp.
@@ -22,6 +22,14 @@
 #include "chre/core/event_loop_manager.h"
 #include "chre/core/static_nanoapps.h"
 #include "chre/platform/shared/dram_vote_client.h"
+#ifdef CHRE_TRACE_BUFFER_ENABLED
+#include "chre/platform/shared/trace_buffer.h"
+
+// Each task must record into its own ring, which a thread_local can't provide
+#ifndef CHRE_TRACE_BUFFER_TASK_LOCAL_STORAGE_INDEX
+#error "CHRE_TRACE_BUFFER_TASK_LOCAL_STORAGE_INDEX must be set on FreeRTOS"
+#endif
+#endif
 #include "chre/target_platform/init.h"
 
 #ifdef CHRE_USE_BUFFERED_LOGGING
@@ -72,6 +80,10 @@ uint8_t gPrimaryLogBufferData[CHRE_LOG_BUFFER_DATA_SIZE];
 void chreThreadEntry(void *context) {
   UNUSED_VAR(context);
 
+#ifdef CHRE_TRACE_BUFFER_ENABLED
+  // Not deinitialized when CHRE exits, as other tasks may still be tracing
+  chre::TraceBufferSingleton::init();
+#endif
   chre::init();
   chre::EventLoopManagerSingleton::get()->lateInit();
   chre::loadStaticNanoapps();
@@ -25,6 +25,7 @@
 #include "chre/platform/shared/authentication.h"
 #include "chre/platform/shared/nanoapp_dso_util.h"
 #include "chre/platform/shared/nanoapp_loader.h"
+#include "chre/platform/system_time.h"
 #include "chre/util/macros.h"
 #include "chre/util/system/napp_header_utils.h"
 #include "chre/util/system/napp_permissions.h"
@@ -37,6 +38,13 @@ namespace {
 #define CHRE_NANOAPP_LOAD_ALIGNMENT 0
 #endif
 
+// A streamed binary is parsed as its fragments arrive, before the signature
+// covering the whole binary can be verified.
+#if defined(CHRE_NANOAPP_STREAMING_LOAD_ENABLED) && \
+    defined(CHRE_NAPP_AUTHENTICATION_ENABLED)
+#error "Streamed nanoapp loads don't support authentication"
+#endif
+
 const char kDefaultAppVersionString[] = "<undefined>";
 size_t kDefaultAppVersionStringSize = ARRAY_SIZE(kDefaultAppVersionString);
 
@@ -49,6 +57,13 @@ PlatformNanoapp::~PlatformNanoapp() {
     forceDramAccess();
     nanoappBinaryDramFree(mAppBinary);
   }
+  if (mStreamingLoader != nullptr) {
+    forceDramAccess();
+    NanoappLoader::destroy(mStreamingLoader);
+  }
+  if (mAuthentication != nullptr) {
+    abortBinaryAuthentication(mAuthentication);
+  }
 }
 
 bool PlatformNanoapp::start() {
@@ -56,12 +71,22 @@ bool PlatformNanoapp::start() {
   forceDramAccess();
 
   bool success = false;
+  mStartTimes = NanoappStartTimes();
   if (!openNanoapp()) {
     LOGE("Failed to open nanoapp");
   } else if (mAppInfo == nullptr) {
     LOGE("Null app info!");
   } else {
+    if (mDsoHandle != nullptr) {
+      // The handle returned by dlopenbuf() is the loader of the binary
+      const auto *loader = static_cast<const NanoappLoader *>(mDsoHandle);
+      mStartTimes.load = loader->getLoadTime();
+      mStartTimes.relocation = loader->getRelocationTime();
+      mStartTimes.initArray = loader->getInitArrayTime();
+    }
+    Nanoseconds startTime = SystemTime::getMonotonicTime();
     success = mAppInfo->entryPoints.start();
+    mStartTimes.start = SystemTime::getMonotonicTime() - startTime;
   }
 
   return success;
@@ -160,7 +185,8 @@ const char *PlatformNanoappBase::getAppVersionString(size_t *length) const {
 
 bool PlatformNanoappBase::isLoaded() const {
   return (mIsStatic ||
-          (mAppBinary != nullptr && mBytesLoaded == mAppBinaryLen) ||
+          ((mAppBinary != nullptr || mStreamingLoader != nullptr) &&
+           mBytesLoaded == mAppBinaryLen) ||
           mDsoHandle != nullptr || mAppFilename != nullptr);
 }
 
@@ -182,16 +208,16 @@ bool PlatformNanoappBase::reserveBuffer(uint64_t appId, uint32_t appVersion,
   forceDramAccess();
 
   bool success = false;
-  mAppBinary =
-      nanoappBinaryDramAlloc(appBinaryLen, CHRE_NANOAPP_LOAD_ALIGNMENT);
-
+  bool tcmCapable = IS_BIT_SET(appFlags, CHRE_NAPP_HEADER_TCM_CAPABLE);
   bool isSigned = IS_BIT_SET(appFlags, CHRE_NAPP_HEADER_SIGNED);
   if (!isSigned) {
     LOGE("Unable to load unsigned nanoapps");
-  } else if (mAppBinary == nullptr) {
+  } else if (!startAuthentication(appBinaryLen)) {
+    LOGE("Unable to authenticate 0x%" PRIx64 " not loading", appId);
+  } else if (!allocateBinary(appBinaryLen - mAuthenticationHeaderSize,
+                             tcmCapable)) {
     LOG_OOM();
   } else {
-    bool tcmCapable = IS_BIT_SET(appFlags, CHRE_NAPP_HEADER_TCM_CAPABLE);
     mExpectedAppId = appId;
     mExpectedAppVersion = appVersion;
     mExpectedTargetApiVersion = targetApiVersion;
@@ -215,10 +241,29 @@ bool PlatformNanoappBase::copyNanoappFragment(const void *buffer,
     LOGE("Overflow: cannot load %zu bytes to %zu/%zu nanoapp binary buffer",
          bufferLen, mBytesLoaded, mAppBinaryLen);
     success = false;
+  } else if (mAuthentication != nullptr &&
+             !updateBinaryAuthentication(mAuthentication, buffer, bufferLen)) {
+    LOGE("Failed to authenticate 0x%" PRIx64, mExpectedAppId);
+    success = false;
   } else {
-    uint8_t *binaryBuffer = static_cast<uint8_t *>(mAppBinary) + mBytesLoaded;
-    memcpy(binaryBuffer, buffer, bufferLen);
-    mBytesLoaded += bufferLen;
+    //! The authentication header has been consumed by the authentication code
+    //! and isn't kept.
+    size_t headerLen = 0;
+    if (mBytesLoaded < mAuthenticationHeaderSize) {
+      headerLen = MIN(bufferLen, mAuthenticationHeaderSize - mBytesLoaded);
+    }
+    const uint8_t *data = static_cast<const uint8_t *>(buffer) + headerLen;
+    size_t dataLen = bufferLen - headerLen;
+    size_t binaryOffset = mBytesLoaded + headerLen - mAuthenticationHeaderSize;
+
+    if (mStreamingLoader != nullptr) {
+      success = (dataLen == 0 || mStreamingLoader->copyFragment(data, dataLen));
+    } else {
+      memcpy(static_cast<uint8_t *>(mAppBinary) + binaryOffset, data, dataLen);
+    }
+    if (success) {
+      mBytesLoaded += bufferLen;
+    }
   }
 
   return success;
@@ -280,17 +325,32 @@ bool PlatformNanoappBase::openNanoapp() {
   bool success = false;
   if (mIsStatic) {
     success = true;
-  } else if (mAppBinary != nullptr) {
-    //! The true start of the binary will be after the authentication header.
-    //! Use the returned value from authenticateBinary to ensure dlopenbuf has
-    //! the starting address to a valid ELF.
-    void *binaryStart = mAppBinary;
-    if (!authenticateBinary(mAppBinary, mAppBinaryLen, &binaryStart)) {
+  } else if (mStreamingLoader != nullptr) {
+    //! The binary has already been mapped, only relocation and static
+    //! initialization remain.
+    if (mDsoHandle != nullptr) {
+      LOGE("Trying to reopen an existing buffer");
+    } else if (!finishAuthentication()) {
       LOGE("Unable to authenticate 0x%" PRIx64 " not loading", mExpectedAppId);
-    } else if (mDsoHandle != nullptr) {
+    } else if (!mStreamingLoader->finishStreaming()) {
+      LOGE("Failed to open streamed nanoapp 0x%" PRIx64, mExpectedAppId);
+    } else {
+      mDsoHandle = mStreamingLoader;
+      mStreamingLoader = nullptr;
+      success = verifyNanoappInfo();
+      if (success) {
+        sendTokenDatabaseInfo();
+      }
+    }
+  } else if (mAppBinary != nullptr) {
+    //! The authentication header wasn't copied, so the buffer starts with the
+    //! ELF binary.
+    if (mDsoHandle != nullptr) {
       LOGE("Trying to reopen an existing buffer");
+    } else if (!finishAuthentication()) {
+      LOGE("Unable to authenticate 0x%" PRIx64 " not loading", mExpectedAppId);
     } else {
-      mDsoHandle = dlopenbuf(binaryStart, mExpectedTcmCapable);
+      mDsoHandle = dlopenbuf(mAppBinary, mExpectedTcmCapable);
       success = verifyNanoappInfo();
       if (success) {
         sendTokenDatabaseInfo();
@@ -306,6 +366,14 @@ bool PlatformNanoappBase::openNanoapp() {
     nanoappBinaryDramFree(mAppBinary);
     mAppBinary = nullptr;
   }
+  if (mStreamingLoader != nullptr) {
+    NanoappLoader::destroy(mStreamingLoader);
+    mStreamingLoader = nullptr;
+  }
+  if (mAuthentication != nullptr) {
+    abortBinaryAuthentication(mAuthentication);
+    mAuthentication = nullptr;
+  }
 
   // Save this flag locally since it may be referenced while the system is in
   // TCM-only mode.
@@ -316,6 +384,43 @@ bool PlatformNanoappBase::openNanoapp() {
   return success;
 }
 
+bool PlatformNanoappBase::startAuthentication(size_t appBinaryLen) {
+#ifdef CHRE_NAPP_AUTHENTICATION_ENABLED
+  mAuthentication =
+      startBinaryAuthentication(appBinaryLen, &mAuthenticationHeaderSize);
+  return mAuthentication != nullptr;
+#else
+  UNUSED_VAR(appBinaryLen);
+  return true;
+#endif  // CHRE_NAPP_AUTHENTICATION_ENABLED
+}
+
+bool PlatformNanoappBase::allocateBinary(size_t binaryLen, bool tcmCapable) {
+#ifdef CHRE_NANOAPP_STREAMING_LOAD_ENABLED
+  // The binary is mapped into its final location as fragments are copied.
+  mStreamingLoader = NanoappLoader::createStreaming(binaryLen, tcmCapable);
+  return mStreamingLoader != nullptr;
+#else
+  UNUSED_VAR(tcmCapable);
+  mAppBinary = nanoappBinaryDramAlloc(binaryLen, CHRE_NANOAPP_LOAD_ALIGNMENT);
+  return mAppBinary != nullptr;
+#endif  // CHRE_NANOAPP_STREAMING_LOAD_ENABLED
+}
+
+bool PlatformNanoappBase::finishAuthentication() {
+#ifdef CHRE_NAPP_AUTHENTICATION_ENABLED
+  bool success = (mAuthentication != nullptr &&
+                  finishBinaryAuthentication(mAuthentication));
+  mAuthentication = nullptr;
+  return success;
+#else
+  LOGW(
+      "Nanoapp authentication is disabled, which exposes the device to "
+      "security risks!");
+  return true;
+#endif  // CHRE_NAPP_AUTHENTICATION_ENABLED
+}
+
 void PlatformNanoappBase::closeNanoapp() {
   if (mDsoHandle != nullptr) {
     // Force DRAM access since dl* functions are only safe to call with DRAM
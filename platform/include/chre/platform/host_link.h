@@ -67,6 +67,27 @@ class HostLink : public HostLinkBase, public NonCopyable {
    */
   bool sendMessage(const MessageToHost *message);
 
+  /**
+   * Enqueues a set of messages for sending to the host as a single
+   * NanoappMessageBatch frame. The host processes the messages in the order
+   * given. Once the messages are no longer referenced (success or failure),
+   * the platform implementation must invoke
+   * HostCommsManager::onMessageToHostComplete for each message, in order. As
+   * with sendMessage(), this function must wake up the host if it is
+   * suspended.
+   *
+   * Only required when CHRE_HOST_MESSAGE_BATCHING_ENABLED is defined.
+   *
+   * @param messages A non-null array of non-null message pointers. The array
+   *        itself is only valid for the duration of this call.
+   * @param numMessages The number of messages in the array
+   *
+   * @return true if the batch was successfully queued. If false, the platform
+   *         must not have invoked onMessageToHostComplete for any message.
+   */
+  bool sendMessageBatch(const MessageToHost *const *messages,
+                        size_t numMessages);
+
   /**
    * Sends a transaction status to the host.
    *
@@ -63,6 +63,25 @@ class MemoryManager : public NonCopyable {
    */
   uint32_t nanoappFreeAll(Nanoapp *app);
 
+  /**
+   * Accounts for memory allocated on behalf of a nanoapp outside of its heap
+   * blocks, e.g. a shared payload, against the limits of the nanoapp heap.
+   *
+   * @param app The pointer to the nanoapp the memory is charged to.
+   * @param bytes The size in bytes of the memory.
+   * @return false if the memory would exceed the limits.
+   */
+  bool nanoappCharge(Nanoapp *app, uint32_t bytes);
+
+  /**
+   * Reverses nanoappCharge() once the memory is freed.
+   *
+   * @param app The pointer to the nanoapp the memory was charged to, or
+   *        nullptr if it has been unloaded since.
+   * @param bytes The size in bytes of the memory.
+   */
+  void nanoappUncharge(Nanoapp *app, uint32_t bytes);
+
   /**
    * @return current total allocated memory in bytes.
    */
@@ -123,6 +142,24 @@ class MemoryManager : public NonCopyable {
   //! The maximum allowable count of memory allocations for all nanoapps.
   static constexpr size_t kMaxAllocationCount = (8 * 1024);
 
+  /**
+   * @return true if the nanoapp can allocate the given number of bytes within
+   *         the limits of the nanoapp heap, logging why not otherwise.
+   */
+  bool isAllocationAllowed(const Nanoapp *app, uint32_t bytes) const;
+
+  /**
+   * Adds an allocation of the given number of bytes to the totals of the
+   * nanoapp and of all nanoapps.
+   */
+  void addAllocation(Nanoapp *app, uint32_t bytes);
+
+  /**
+   * Removes an allocation added by addAllocation(), from the total of all
+   * nanoapps only if app is nullptr.
+   */
+  void removeAllocation(Nanoapp *app, uint32_t bytes);
+
   /**
    * Called by nanoappAlloc to perform the appropriate call to memory alloc.
    *
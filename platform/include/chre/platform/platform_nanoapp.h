@@ -23,9 +23,34 @@
 #include "chre/target_platform/platform_nanoapp_base.h"
 #include "chre/util/non_copyable.h"
 #include "chre/util/system/debug_dump.h"
+#include "chre/util/time.h"
 
 namespace chre {
 
+/**
+ * The time spent in each phase of starting a nanoapp. Phases which don't apply
+ * to a nanoapp, e.g. relocation for a static nanoapp, or which a platform
+ * doesn't measure separately are left at zero.
+ */
+struct NanoappStartTimes {
+  //! Mapping the binary into memory, including the time spent while its
+  //! fragments were received for a streamed binary.
+  Nanoseconds load;
+
+  //! Fixing relocations and resolving symbols.
+  Nanoseconds relocation;
+
+  //! Invoking the static initializers of the binary (init_array).
+  Nanoseconds initArray;
+
+  //! Invoking nanoappStart().
+  Nanoseconds start;
+
+  //! The whole of Nanoapp::start(), measured by the core. This doesn't include
+  //! the part of the load time spent before the start for a streamed binary.
+  Nanoseconds total;
+};
+
 /**
  * The common interface to Nanoapp functionality that has platform-specific
  * implementation but must be supported for every platform.
@@ -120,6 +145,13 @@ class PlatformNanoapp : public PlatformNanoappBase, public NonCopyable {
    */
   void logStateToBuffer(DebugDumpWrapper &debugDump) const;
 
+  /**
+   * @return the time spent in each phase of the last call to start().
+   */
+  const NanoappStartTimes &getStartTimes() const {
+    return mStartTimes;
+  }
+
  protected:
   /**
    * PlatformNanoapp's constructor is protected, as it must only exist within
@@ -131,6 +163,9 @@ class PlatformNanoapp : public PlatformNanoappBase, public NonCopyable {
    * Unloads the nanoapp from memory.
    */
   ~PlatformNanoapp();
+
+  //! Populated by start(), see NanoappStartTimes.
+  NanoappStartTimes mStartTimes;
 };
 
 }  // namespace chre
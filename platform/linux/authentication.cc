@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+
+#include "chre/platform/shared/authentication.h"
+#include "chre/util/macros.h"
+
+namespace chre {
+namespace {
+
+//! A software key trusted by the Linux build so that the shared authentication
+//! code can be tested. It must never be trusted on a device.
+const uint8_t kLinuxTestPublicKey[] = {
+    0xd2, 0x2a, 0xc0, 0x21, 0x06, 0xa9, 0x56, 0x48, 0x56, 0x14, 0xb9,
+    0xa5, 0x37, 0x38, 0x32, 0x0a, 0x24, 0x04, 0xda, 0x0b, 0xb1, 0x37,
+    0x02, 0xd9, 0xdb, 0x97, 0xf8, 0x2e, 0xec, 0x0d, 0xab, 0x89, 0xa2,
+    0x4c, 0x2c, 0x21, 0x67, 0x4b, 0x9f, 0x4f, 0xe9, 0xe0, 0x11, 0xb6,
+    0xf3, 0x24, 0x9a, 0xdb, 0xab, 0xd9, 0x56, 0x3f, 0x36, 0x4c, 0x15,
+    0x93, 0xc3, 0xfb, 0x79, 0x32, 0x7b, 0x9d, 0x19, 0xff};
+
+const uint8_t *const kTrustedPublicKeys[] = {kLinuxTestPublicKey};
+
+}  // anonymous namespace
+
+const uint8_t *const *getTrustedPublicKeys(size_t *numKeys) {
+  *numKeys = ARRAY_SIZE(kTrustedPublicKeys);
+  return kTrustedPublicKeys;
+}
+
+void setAuthenticationHighPerformance(bool /* enabled */) {}
+
+}  // namespace chre
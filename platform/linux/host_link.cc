@@ -31,6 +31,17 @@ bool HostLink::sendMessage(const MessageToHost *message) {
   return true;
 }
 
+bool HostLink::sendMessageBatch(const MessageToHost *const *messages,
+                                size_t numMessages) {
+  // Just drop the messages since we do not have a real host to send them
+  for (size_t i = 0; i < numMessages; ++i) {
+    EventLoopManagerSingleton::get()
+        ->getHostCommsManager()
+        .onMessageToHostComplete(messages[i]);
+  }
+  return true;
+}
+
 bool HostLink::sendMessageDeliveryStatus(uint32_t /* messageSequenceNumber */,
                                          uint8_t /* errorCode */) {
   // Just drop the message delivery status since we do not have a
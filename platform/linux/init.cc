@@ -28,6 +28,9 @@
 #include "chre/platform/linux/platform_log.h"
 #include "chre/platform/linux/task_util/task_manager.h"
 #include "chre/platform/log.h"
+#ifdef CHRE_TRACE_BUFFER_ENABLED
+#include "chre/platform/shared/trace_buffer.h"
+#endif  // CHRE_TRACE_BUFFER_ENABLED
 #include "chre/platform/system_timer.h"
 #include "chre/util/time.h"
 
@@ -82,6 +85,11 @@ int main(int argc, char **argv) {
     // Initialize logging.
     chre::PlatformLogSingleton::init();
 
+#ifdef CHRE_TRACE_BUFFER_ENABLED
+    // Initialize tracing.
+    chre::TraceBufferSingleton::init();
+#endif  // CHRE_TRACE_BUFFER_ENABLED
+
 #ifdef CHRE_AUDIO_SUPPORT_ENABLED
     // Initialize audio sources.
     if (!audioFileArg.getValue().empty()) {
@@ -114,12 +122,11 @@ int main(int argc, char **argv) {
       }
 
       // Load dynamic nanoapps specified on the command-line.
-      chre::DynamicVector<chre::UniquePtr<chre::Nanoapp>> dynamicNanoapps;
       for (const auto &nanoapp : nanoappsArg.getValue()) {
-        dynamicNanoapps.push_back(chre::MakeUnique<chre::Nanoapp>());
-        dynamicNanoapps.back()->loadFromFile(nanoapp);
-        EventLoopManagerSingleton::get()->getEventLoop().startNanoapp(
-            dynamicNanoapps.back());
+        auto dynamicNanoapp = chre::MakeUnique<chre::Nanoapp>();
+        dynamicNanoapp->loadFromFile(nanoapp);
+        EventLoopManagerSingleton::get()->getEventLoop().scheduleNanoappStart(
+            dynamicNanoapp);
       }
 
       EventLoopManagerSingleton::get()->getEventLoop().run();
@@ -128,6 +135,9 @@ int main(int argc, char **argv) {
 
     chre::TaskManagerSingleton::deinit();
     chre::deinit();
+#ifdef CHRE_TRACE_BUFFER_ENABLED
+    chre::TraceBufferSingleton::deinit();
+#endif  // CHRE_TRACE_BUFFER_ENABLED
     chre::PlatformLogSingleton::deinit();
   } catch (TCLAP::ExitException) {
   }
@@ -22,6 +22,7 @@
 #include "chre/platform/assert.h"
 #include "chre/platform/log.h"
 #include "chre/platform/shared/nanoapp_dso_util.h"
+#include "chre/platform/system_time.h"
 #include "chre/util/system/napp_permissions.h"
 #include "chre_api/chre/version.h"
 
@@ -32,7 +33,18 @@ PlatformNanoapp::~PlatformNanoapp() {
 }
 
 bool PlatformNanoapp::start() {
-  return openNanoapp() && mAppInfo->entryPoints.start();
+  // dlopen() maps, relocates and initializes the binary at once, so all of it
+  // is counted as loading
+  mStartTimes = NanoappStartTimes();
+  Nanoseconds openStartTime = SystemTime::getMonotonicTime();
+  bool success = openNanoapp();
+  if (success) {
+    Nanoseconds startTime = SystemTime::getMonotonicTime();
+    mStartTimes.load = startTime - openStartTime;
+    success = mAppInfo->entryPoints.start();
+    mStartTimes.start = SystemTime::getMonotonicTime() - startTime;
+  }
+  return success;
 }
 
 void PlatformNanoapp::handleEvent(uint32_t senderInstanceId, uint16_t eventType,
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "chre/platform/shared/authentication.h"
+
+namespace {
+
+using chre::abortBinaryAuthentication;
+using chre::BinaryAuthentication;
+using chre::finishBinaryAuthentication;
+using chre::startBinaryAuthentication;
+using chre::updateBinaryAuthentication;
+
+constexpr size_t kHeaderSize = 0x1000;
+constexpr size_t kSignatureOffset = 0;
+constexpr size_t kPublicKeyOffset = 0x200;
+constexpr size_t kHeaderInfoOffset = 0x400;
+constexpr size_t kImageHashOffset = kHeaderInfoOffset + 32;
+constexpr size_t kImageSize = 3000;
+
+// The public key trusted by the Linux build, see platform/linux.
+constexpr uint8_t kPublicKey[] = {
+    0xd2, 0x2a, 0xc0, 0x21, 0x06, 0xa9, 0x56, 0x48, 0x56, 0x14, 0xb9,
+    0xa5, 0x37, 0x38, 0x32, 0x0a, 0x24, 0x04, 0xda, 0x0b, 0xb1, 0x37,
+    0x02, 0xd9, 0xdb, 0x97, 0xf8, 0x2e, 0xec, 0x0d, 0xab, 0x89, 0xa2,
+    0x4c, 0x2c, 0x21, 0x67, 0x4b, 0x9f, 0x4f, 0xe9, 0xe0, 0x11, 0xb6,
+    0xf3, 0x24, 0x9a, 0xdb, 0xab, 0xd9, 0x56, 0x3f, 0x36, 0x4c, 0x15,
+    0x93, 0xc3, 0xfb, 0x79, 0x32, 0x7b, 0x9d, 0x19, 0xff};
+
+// The SHA-256 hash of the image built by makeSignedBinary().
+constexpr uint8_t kImageHash[] = {
+    0x8b, 0x5f, 0xc0, 0xe9, 0xb5, 0x59, 0xac, 0xd8, 0x6a, 0x49, 0x01,
+    0x79, 0x43, 0x70, 0x7c, 0x53, 0xe2, 0x83, 0xf2, 0x6b, 0xb6, 0x29,
+    0xcb, 0x20, 0xbc, 0xe9, 0x13, 0xba, 0xc9, 0x97, 0x5c, 0x21};
+
+// The signature of the header built by makeSignedBinary(), made with the
+// private half of kPublicKey.
+constexpr uint8_t kSignature[] = {
+    0xbc, 0x7a, 0x50, 0x65, 0x81, 0xc0, 0xaf, 0xfb, 0x7c, 0x86, 0x97,
+    0x2f, 0xa5, 0xda, 0x31, 0x3c, 0xcc, 0x33, 0xfb, 0x61, 0xd8, 0x36,
+    0xaf, 0x1c, 0xd3, 0xea, 0xc8, 0x4d, 0x50, 0xef, 0x2e, 0x69, 0x1d,
+    0xa5, 0x52, 0x73, 0xed, 0x7f, 0xa2, 0x19, 0x1f, 0x43, 0x54, 0xa2,
+    0xb1, 0xee, 0x2e, 0xea, 0xb0, 0x86, 0x08, 0x81, 0x59, 0xb1, 0x11,
+    0x7c, 0x64, 0x3c, 0x31, 0x4d, 0x74, 0x81, 0x6f, 0xcd};
+
+void writeUint32(std::vector<uint8_t> &binary, size_t offset, uint32_t value) {
+  memcpy(&binary[offset], &value, sizeof(value));
+}
+
+std::vector<uint8_t> makeSignedBinary() {
+  std::vector<uint8_t> binary(kHeaderSize + kImageSize);
+  memcpy(&binary[kSignatureOffset], kSignature, sizeof(kSignature));
+  memcpy(&binary[kPublicKeyOffset], kPublicKey, sizeof(kPublicKey));
+  writeUint32(binary, kHeaderInfoOffset, 0x45524843 /* magic */);
+  writeUint32(binary, kHeaderInfoOffset + 4, 1 /* headerVersion */);
+  writeUint32(binary, kHeaderInfoOffset + 12, kImageSize);
+  memcpy(&binary[kImageHashOffset], kImageHash, sizeof(kImageHash));
+  for (size_t i = 0; i < kImageSize; i++) {
+    binary[kHeaderSize + i] = static_cast<uint8_t>(i * 31 + 7);
+  }
+  return binary;
+}
+
+//! Authenticates a binary passed in fragments of the given size.
+bool authenticate(const std::vector<uint8_t> &binary, size_t fragmentSize) {
+  size_t headerSize = 0;
+  BinaryAuthentication *authentication =
+      startBinaryAuthentication(binary.size(), &headerSize);
+  if (authentication == nullptr) {
+    return false;
+  }
+  EXPECT_EQ(headerSize, kHeaderSize);
+
+  for (size_t offset = 0; offset < binary.size(); offset += fragmentSize) {
+    size_t size = std::min(fragmentSize, binary.size() - offset);
+    if (!updateBinaryAuthentication(authentication, &binary[offset], size)) {
+      abortBinaryAuthentication(authentication);
+      return false;
+    }
+  }
+  return finishBinaryAuthentication(authentication);
+}
+
+TEST(Authentication, AcceptsSignedBinaryInAnyFragmentation) {
+  std::vector<uint8_t> binary = makeSignedBinary();
+  for (size_t fragmentSize :
+       {size_t{1}, size_t{7}, size_t{0x200}, size_t{1000}, binary.size()}) {
+    EXPECT_TRUE(authenticate(binary, fragmentSize))
+        << "Fragment size " << fragmentSize;
+  }
+}
+
+TEST(Authentication, RejectsModifiedImage) {
+  std::vector<uint8_t> binary = makeSignedBinary();
+  binary[kHeaderSize + kImageSize / 2] ^= 1;
+  EXPECT_FALSE(authenticate(binary, 1000));
+}
+
+TEST(Authentication, RejectsModifiedSignedHeader) {
+  std::vector<uint8_t> binary = makeSignedBinary();
+  binary[kHeaderSize - 1] ^= 1;
+  EXPECT_FALSE(authenticate(binary, 1000));
+}
+
+TEST(Authentication, RejectsUntrustedKeyBeforeImage) {
+  std::vector<uint8_t> binary = makeSignedBinary();
+  binary[kPublicKeyOffset] ^= 1;
+
+  size_t headerSize = 0;
+  BinaryAuthentication *authentication =
+      startBinaryAuthentication(binary.size(), &headerSize);
+  ASSERT_NE(authentication, nullptr);
+  EXPECT_FALSE(
+      updateBinaryAuthentication(authentication, binary.data(), kHeaderSize));
+  EXPECT_FALSE(finishBinaryAuthentication(authentication));
+}
+
+TEST(Authentication, RejectsMismatchedLength) {
+  std::vector<uint8_t> binary = makeSignedBinary();
+  binary.push_back(0);
+  EXPECT_FALSE(authenticate(binary, 1000));
+}
+
+TEST(Authentication, RejectsIncompleteBinary) {
+  std::vector<uint8_t> binary = makeSignedBinary();
+  size_t headerSize = 0;
+  BinaryAuthentication *authentication =
+      startBinaryAuthentication(binary.size(), &headerSize);
+  ASSERT_NE(authentication, nullptr);
+  EXPECT_TRUE(updateBinaryAuthentication(authentication, binary.data(),
+                                         binary.size() - 1));
+  EXPECT_FALSE(finishBinaryAuthentication(authentication));
+}
+
+TEST(Authentication, RejectsBinaryWithoutImage) {
+  size_t headerSize = 0;
+  EXPECT_EQ(startBinaryAuthentication(kHeaderSize, &headerSize), nullptr);
+}
+
+}  // namespace
@@ -106,6 +106,7 @@ SLPI_SRCS += platform/shared/host_protocol_chre.cc
 SLPI_SRCS += platform/shared/host_protocol_common.cc
 SLPI_SRCS += platform/shared/memory_manager.cc
 SLPI_SRCS += platform/shared/nanoapp_abort.cc
+SLPI_SRCS += platform/shared/nanoapp_binary_cache.cc
 SLPI_SRCS += platform/shared/nanoapp_load_manager.cc
 SLPI_SRCS += platform/shared/nanoapp/nanoapp_dso_util.cc
 SLPI_SRCS += platform/shared/pal_system_api.cc
@@ -186,6 +187,7 @@ SLPI_QSH_SRCS += platform/slpi/see/power_control_manager.cc
 ifeq ($(CHRE_USE_BUFFERED_LOGGING), true)
 SLPI_QSH_SRCS += platform/shared/log_buffer.cc
 SLPI_QSH_SRCS += platform/shared/log_buffer_manager.cc
+SLPI_QSH_SRCS += platform/shared/log_double_buffer.cc
 SLPI_QSH_SRCS += platform/slpi/log_buffer_manager.cc
 endif
 
@@ -342,21 +344,40 @@ GOOGLETEST_CFLAGS += $(FLATBUFFERS_CFLAGS)
 # The order here is important so that the googletest target prefers shared,
 # linux and then SLPI.
 GOOGLETEST_CFLAGS += -Iplatform/shared/include
+GOOGLETEST_CFLAGS += -Iplatform/shared/nanoapp/include
 GOOGLETEST_CFLAGS += -Iplatform/linux/include
 GOOGLETEST_CFLAGS += -Iplatform/slpi/include
 GOOGLETEST_CFLAGS += -Iplatform/shared/pw_trace/include
 
+# The nanoapp loader tests provide a vendor symbol list.
+GOOGLETEST_CFLAGS += -Iplatform/tests/include
+GOOGLETEST_CFLAGS += -DCHREX_SYMBOL_EXTENSIONS
+
 # GoogleTest Source Files ######################################################
 
 GOOGLETEST_COMMON_SRCS += platform/linux/assert.cc
+GOOGLETEST_COMMON_SRCS += platform/linux/authentication.cc
 GOOGLETEST_COMMON_SRCS += platform/linux/sim/audio_source.cc
 GOOGLETEST_COMMON_SRCS += platform/linux/sim/platform_audio.cc
+GOOGLETEST_COMMON_SRCS += platform/linux/tests/authentication_test.cc
 GOOGLETEST_COMMON_SRCS += platform/linux/tests/task_test.cc
 GOOGLETEST_COMMON_SRCS += platform/linux/tests/task_manager_test.cc
 GOOGLETEST_COMMON_SRCS += platform/tests/log_buffer_test.cc
+GOOGLETEST_COMMON_SRCS += platform/tests/log_double_buffer_test.cc
+GOOGLETEST_COMMON_SRCS += platform/tests/nanoapp_binary_cache_test.cc
+GOOGLETEST_COMMON_SRCS += platform/tests/nanoapp_loader_test.cc
+GOOGLETEST_COMMON_SRCS += platform/tests/trace_buffer_test.cc
 GOOGLETEST_COMMON_SRCS += platform/tests/trace_test.cc
+GOOGLETEST_COMMON_SRCS += platform/shared/authentication.cc
 GOOGLETEST_COMMON_SRCS += platform/shared/log_buffer.cc
+GOOGLETEST_COMMON_SRCS += platform/shared/log_double_buffer.cc
 GOOGLETEST_COMMON_SRCS += platform/shared/nanoapp_abort.cc
+GOOGLETEST_COMMON_SRCS += platform/shared/nanoapp_binary_cache.cc
+GOOGLETEST_COMMON_SRCS += platform/shared/nanoapp_loader.cc
+# The trace buffer is already built when enabled by CHRE_TRACE_BUFFER_ENABLED.
+ifneq ($(CHRE_TRACE_BUFFER_ENABLED), true)
+GOOGLETEST_COMMON_SRCS += platform/shared/trace_buffer.cc
+endif
 ifeq ($(CHRE_WIFI_NAN_SUPPORT_ENABLED), true)
 GOOGLETEST_COMMON_SRCS += platform/linux/pal_nan.cc
 endif
@@ -416,6 +437,7 @@ EXYNOS_SRCS += $(CHRE_PREFIX)/platform/exynos/platform_pal.cc
 EXYNOS_SRCS += $(CHRE_PREFIX)/platform/exynos/power_control_manager.cc
 EXYNOS_SRCS += $(CHRE_PREFIX)/platform/exynos/system_time.cc
 EXYNOS_SRCS += $(CHRE_PREFIX)/platform/shared/nanoapp_abort.cc
+EXYNOS_SRCS += $(CHRE_PREFIX)/platform/shared/nanoapp_binary_cache.cc
 EXYNOS_SRCS += $(CHRE_PREFIX)/platform/shared/nanoapp_load_manager.cc
 
 EXYNOS_SRCS += $(FLATBUFFERS_SRCS)
@@ -466,6 +488,7 @@ TINYSYS_SRCS += $(CHRE_PREFIX)/platform/riscv/nanoapp_loader.cc
 
 # Shared sources
 TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/assert.cc
+TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/authentication.cc
 TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/chre_api_audio.cc
 TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/chre_api_ble.cc
 TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/chre_api_core.cc
@@ -482,8 +505,10 @@ TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/host_protocol_chre.cc
 TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/host_protocol_common.cc
 TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/log_buffer.cc
 TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/log_buffer_manager.cc
+TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/log_double_buffer.cc
 TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/memory_manager.cc
 TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/nanoapp_abort.cc
+TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/nanoapp_binary_cache.cc
 TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/nanoapp_load_manager.cc
 TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/nanoapp_loader.cc
 TINYSYS_SRCS += $(CHRE_PREFIX)/platform/shared/pal_system_api.cc
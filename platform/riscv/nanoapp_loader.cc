@@ -34,11 +34,15 @@ bool NanoappLoader::relocateTable(DynamicHeader *dyn, int tag) {
       // The value of the RELA entry in dynamic table is the sh_addr field
       // of ".rela.dyn" section header. We actually need to use the sh_offset
       // which is usually the same, but on occasions can be different.
-      SectionHeader *dynamicRelaTablePtr = getSectionHeader(".rela.dyn");
+      SectionHeader *dynamicRelaTablePtr = getSectionHeader(kRelaDynTableName);
       CHRE_ASSERT(dynamicRelaTablePtr != nullptr);
-      ElfRela *reloc =
-          reinterpret_cast<ElfRela *>(mBinary + dynamicRelaTablePtr->sh_offset);
       size_t relocSize = dynamicRelaTablePtr->sh_size;
+      ElfRela *reloc = reinterpret_cast<ElfRela *>(
+          getFileData(dynamicRelaTablePtr->sh_offset, relocSize));
+      if (reloc == nullptr) {
+        LOGE("DT_RELA table is out of bounds");
+        break;
+      }
       size_t nRelocs = relocSize / sizeof(ElfRela);
       LOGV("Relocation %zu entries in DT_RELA table", nRelocs);
 
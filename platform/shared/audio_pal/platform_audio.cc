@@ -21,6 +21,7 @@
 #include "chre/core/event_loop_manager.h"
 #include "chre/platform/log.h"
 #include "chre/platform/shared/pal_system_api.h"
+#include "chre/platform/tracing.h"
 #include "chre/util/macros.h"
 #include "chre_api/chre/audio.h"
 
@@ -115,6 +116,7 @@ bool PlatformAudio::getAudioSource(uint32_t handle,
 
 void PlatformAudioBase::audioDataEventCallback(
     struct chreAudioDataEvent *event) {
+  CHRE_TRACE_INSTANT("Audio data event", "pal", event->handle);
   EventLoopManagerSingleton::get()
       ->getAudioRequestManager()
       .handleAudioDataEvent(event);
@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/platform/shared/authentication.h"
+
+#include <inttypes.h>
+#include <cstdint>
+#include <cstring>
+
+#include "chre/platform/log.h"
+#include "chre/util/macros.h"
+#include "chre/util/memory.h"
+
+#include "mbedtls/pk.h"
+#include "mbedtls/sha256.h"
+
+namespace chre {
+namespace {
+
+// All the size below are in bytes
+constexpr uint32_t kEcdsaP256SigSize = 64;
+constexpr uint32_t kEcdsaP256PublicKeySize = 64;
+constexpr uint32_t kHeaderSize = 0x1000;
+constexpr uint32_t kSha256HashSize = 32;
+
+//! The signature covers the header from this offset, i.e. everything but the
+//! signature itself.
+constexpr size_t kSignedDataOffset = 0x200;
+
+// ASCII of "CHRE", in BE
+constexpr uint32_t kChreMagicNumber = 0x45524843;
+
+/**
+ * A data structure encapsulating metadata necessary for nanoapp binary
+ * signature verification.
+ *
+ * Note that the structure field names that start with 'reserved' are currently
+ * unused.
+ */
+struct HeaderInfo {
+  /**
+   * A magic number indicating the start of the header info, ASCII decodes to
+   * 'CHRE'.
+   */
+  uint32_t magic;
+
+  uint32_t headerVersion;
+
+  // TODO(b/260099197): We should have a hardware backed rollback info check.
+  uint32_t reservedRollbackInfo;
+
+  /** The size in bytes of the actual nanoapp binary. */
+  uint32_t binaryLength;
+
+  /** The flag indicating the public key size. */
+  uint64_t flags[2];
+
+  /** The SHA-256 hash of the actual nanoapp binary. */
+  uint8_t binarySha256[kSha256HashSize];
+
+  uint8_t reservedChipId[32];
+
+  uint8_t reservedAuthConfig[256];
+
+  uint8_t reservedImageConfig[256];
+};
+
+/**
+ * A header containing information relevant to nanoapp signature authentication
+ * that is tacked onto every signed nanoapp.
+ */
+struct ImageHeader {
+  /** The zero-padded signature of the nanoapp binary. */
+  uint8_t signature[512];
+
+  /** The zero-padded public key for the key pair used to sign the hash, which
+   * we use to verify whether we trust the signer or not. */
+  uint8_t publicKey[512];
+
+  /** @see struct HeaderInfo. */
+  HeaderInfo headerInfo;
+};
+
+static_assert(sizeof(ImageHeader) <= kHeaderSize,
+              "The image header must fit in the authentication header");
+
+class Authenticator {
+ public:
+  Authenticator() {
+    mbedtls_ecp_group_init(&mGroup);
+    mbedtls_ecp_point_init(&mQ);
+    mbedtls_mpi_init(&mR);
+    mbedtls_mpi_init(&mS);
+  }
+
+  ~Authenticator() {
+    mbedtls_mpi_free(&mS);
+    mbedtls_mpi_free(&mR);
+    mbedtls_ecp_point_free(&mQ);
+    mbedtls_ecp_group_free(&mGroup);
+  }
+
+  bool loadEcpGroup() {
+    int result = mbedtls_ecp_group_load(&mGroup, MBEDTLS_ECP_DP_SECP256R1);
+    if (result != 0) {
+      LOGE("Failed to load ecp group. Error code: %d", result);
+      return false;
+    }
+    return true;
+  }
+
+  bool loadPublicKey(const uint8_t *publicKey) {
+    // 0x04 prefix is required by mbedtls
+    constexpr uint8_t kPublicKeyPrefix = 0x04;
+    uint8_t buffer[kEcdsaP256PublicKeySize + 1] = {kPublicKeyPrefix};
+    memcpy(buffer + 1, publicKey, kEcdsaP256PublicKeySize);
+    int result =
+        mbedtls_ecp_point_read_binary(&mGroup, &mQ, buffer, ARRAY_SIZE(buffer));
+    if (result != 0) {
+      LOGE("Failed to load the public key. Error code: %d", result);
+      return false;
+    }
+    return true;
+  }
+
+  bool loadSignature(const ImageHeader *header) {
+    constexpr uint32_t kRSigSize = kEcdsaP256SigSize / 2;
+    constexpr uint32_t kSSigSize = kEcdsaP256SigSize / 2;
+    int result = mbedtls_mpi_read_binary(&mR, header->signature, kRSigSize);
+    if (result != 0) {
+      LOGE("Failed to read r signature. Error code: %d", result);
+      return false;
+    }
+    result =
+        mbedtls_mpi_read_binary(&mS, header->signature + kRSigSize, kSSigSize);
+    if (result != 0) {
+      LOGE("Failed to read s signature. Error code: %d", result);
+      return false;
+    }
+    return true;
+  }
+
+  bool authenticate(const uint8_t *digest) {
+    int result = mbedtls_ecdsa_verify(&mGroup, digest, kSha256HashSize, &mQ,
+                                      &mR, &mS);
+    if (result != 0) {
+      LOGE("Signature verification failed. Error code: %d", result);
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  mbedtls_ecp_group mGroup;
+  mbedtls_ecp_point mQ;
+  mbedtls_mpi mR;
+  mbedtls_mpi mS;
+};
+
+/** Retrieves the public key length based on the flag. */
+uint32_t getPublicKeyLength(const uint64_t *flag) {
+  constexpr int kPkSizeMaskPosition = 9;
+  constexpr uint64_t kPkSizeMask = 0x3;
+  uint8_t keySizeFlag = ((*flag) >> kPkSizeMaskPosition) & kPkSizeMask;
+  switch (keySizeFlag) {
+    case 0:
+      return 64;
+    case 1:
+      return 96;
+    case 2:
+      return 132;
+    default:
+      LOGE("Unsupported flags in nanoapp header!");
+      return 0;
+  }
+}
+
+/** Checks if the public key in the header matches a trusted public key. */
+bool isTrustedPublicKey(const uint8_t *publicKey, size_t publicKeyLength) {
+  if (publicKeyLength != kEcdsaP256PublicKeySize) {
+    LOGE("Public key length %zu is unexpected.", publicKeyLength);
+    return false;
+  }
+  size_t numKeys = 0;
+  const uint8_t *const *trustedPublicKeys = getTrustedPublicKeys(&numKeys);
+  for (size_t i = 0; i < numKeys; i++) {
+    if (memcmp(trustedPublicKeys[i], publicKey, kEcdsaP256PublicKeySize) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Checks the header fields that don't depend on the rest of the binary. */
+bool isValidHeader(const ImageHeader *header, size_t appBinaryLen) {
+  const uint32_t expectedAppBinaryLength =
+      header->headerInfo.binaryLength + kHeaderSize;
+
+  if (header->headerInfo.magic != kChreMagicNumber) {
+    LOGE("Mismatched magic number.");
+  } else if (header->headerInfo.headerVersion != 1) {
+    LOGE("Header version %" PRIu32 " is unsupported.",
+         header->headerInfo.headerVersion);
+  } else if (expectedAppBinaryLength != appBinaryLen) {
+    LOGE("Invalid binary length %zu. Expected %" PRIu32, appBinaryLen,
+         expectedAppBinaryLength);
+  } else if (!isTrustedPublicKey(
+                 header->publicKey,
+                 getPublicKeyLength(header->headerInfo.flags))) {
+    LOGE("Invalid public key attached on the image.");
+  } else {
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Hashes the part of a fragment that lies within [start, end) of the binary.
+ *
+ * @param fragmentOffset The offset of the fragment within the binary.
+ */
+void updateHash(mbedtls_sha256_context *context, size_t start, size_t end,
+                size_t fragmentOffset, const uint8_t *fragment,
+                size_t fragmentLen) {
+  size_t hashStart = MAX(start, fragmentOffset);
+  size_t hashEnd = MIN(end, fragmentOffset + fragmentLen);
+  if (hashStart < hashEnd) {
+    mbedtls_sha256_update(context, fragment + (hashStart - fragmentOffset),
+                          hashEnd - hashStart);
+  }
+}
+
+}  // anonymous namespace
+
+struct BinaryAuthentication {
+  explicit BinaryAuthentication(size_t binaryLen) : appBinaryLen(binaryLen) {
+    mbedtls_sha256_init(&signedDataHash);
+    mbedtls_sha256_init(&imageHash);
+    mbedtls_sha256_starts(&signedDataHash, /* is224= */ 0);
+    mbedtls_sha256_starts(&imageHash, /* is224= */ 0);
+  }
+
+  ~BinaryAuthentication() {
+    mbedtls_sha256_free(&imageHash);
+    mbedtls_sha256_free(&signedDataHash);
+  }
+
+  //! The length of the binary, including the authentication header.
+  const size_t appBinaryLen;
+
+  //! The number of bytes of the binary received so far.
+  size_t bytesReceived = 0;
+
+  //! Set once the binary has failed authentication.
+  bool failed = false;
+
+  //! A copy of the start of the authentication header, which holds everything
+  //! needed once the whole binary has been received.
+  ImageHeader header = {};
+
+  //! The hash of the signed part of the authentication header.
+  mbedtls_sha256_context signedDataHash;
+
+  //! The hash of the binary following the authentication header.
+  mbedtls_sha256_context imageHash;
+};
+
+bool authenticateBinary(const void *binary, size_t appBinaryLen,
+                        void **realBinaryStart) {
+#ifndef CHRE_NAPP_AUTHENTICATION_ENABLED
+  UNUSED_VAR(binary);
+  UNUSED_VAR(appBinaryLen);
+  UNUSED_VAR(realBinaryStart);
+  LOGW(
+      "Nanoapp authentication is disabled, which exposes the device to "
+      "security risks!");
+  return true;
+#else
+  size_t headerSize = 0;
+  BinaryAuthentication *authentication =
+      startBinaryAuthentication(appBinaryLen, &headerSize);
+  if (authentication == nullptr) {
+    return false;
+  }
+
+  // A failed update is reported when the authentication is finished.
+  updateBinaryAuthentication(authentication, binary, appBinaryLen);
+  bool success = finishBinaryAuthentication(authentication);
+  if (success) {
+    *realBinaryStart = reinterpret_cast<void *>(
+        reinterpret_cast<uintptr_t>(binary) + headerSize);
+  }
+  return success;
+#endif  // CHRE_NAPP_AUTHENTICATION_ENABLED
+}
+
+BinaryAuthentication *startBinaryAuthentication(size_t appBinaryLen,
+                                                size_t *headerSize) {
+  BinaryAuthentication *authentication = nullptr;
+  if (appBinaryLen <= kHeaderSize) {
+    LOGE("Binary size %zu is too short.", appBinaryLen);
+  } else {
+    authentication = memoryAlloc<BinaryAuthentication>(appBinaryLen);
+    if (authentication == nullptr) {
+      LOG_OOM();
+    } else {
+      *headerSize = kHeaderSize;
+    }
+  }
+  return authentication;
+}
+
+bool updateBinaryAuthentication(BinaryAuthentication *authentication,
+                                const void *fragment, size_t fragmentLen) {
+  if (authentication->failed) {
+    return false;
+  }
+
+  size_t offset = authentication->bytesReceived;
+  if (fragmentLen > authentication->appBinaryLen - offset) {
+    LOGE("Received %zu bytes past the end of a %zu byte binary",
+         fragmentLen - (authentication->appBinaryLen - offset),
+         authentication->appBinaryLen);
+    authentication->failed = true;
+    return false;
+  }
+
+  auto data = static_cast<const uint8_t *>(fragment);
+  constexpr size_t kImageHeaderSize = sizeof(ImageHeader);
+  if (offset < kImageHeaderSize) {
+    size_t copySize = MIN(kImageHeaderSize - offset, fragmentLen);
+    memcpy(reinterpret_cast<uint8_t *>(&authentication->header) + offset, data,
+           copySize);
+  }
+
+  setAuthenticationHighPerformance(true);
+  updateHash(&authentication->signedDataHash, kSignedDataOffset, kHeaderSize,
+             offset, data, fragmentLen);
+  updateHash(&authentication->imageHash, kHeaderSize,
+             authentication->appBinaryLen, offset, data, fragmentLen);
+  setAuthenticationHighPerformance(false);
+  authentication->bytesReceived += fragmentLen;
+
+  // Reject a binary with a bad header before the rest of it is received.
+  if (offset < kImageHeaderSize &&
+      authentication->bytesReceived >= kImageHeaderSize &&
+      !isValidHeader(&authentication->header, authentication->appBinaryLen)) {
+    authentication->failed = true;
+  }
+  return !authentication->failed;
+}
+
+bool finishBinaryAuthentication(BinaryAuthentication *authentication) {
+  bool success = false;
+  if (authentication->failed) {
+    LOGE("Failed to authenticate the image.");
+  } else if (authentication->bytesReceived != authentication->appBinaryLen) {
+    LOGE("Only received %zu/%zu bytes of the image.",
+         authentication->bytesReceived, authentication->appBinaryLen);
+  } else {
+    setAuthenticationHighPerformance(true);
+    uint8_t signedDataDigest[kSha256HashSize] = {};
+    uint8_t imageDigest[kSha256HashSize] = {};
+    mbedtls_sha256_finish(&authentication->signedDataHash, signedDataDigest);
+    mbedtls_sha256_finish(&authentication->imageHash, imageDigest);
+
+    const ImageHeader *header = &authentication->header;
+    Authenticator authenticator;
+    if (memcmp(imageDigest, header->headerInfo.binarySha256,
+               kSha256HashSize) != 0) {
+      LOGE("Hash of the nanoapp image is incorrect.");
+    } else if (!authenticator.loadEcpGroup() ||
+               !authenticator.loadPublicKey(header->publicKey) ||
+               !authenticator.loadSignature(header)) {
+      LOGE("Failed to load authentication data.");
+    } else if (!authenticator.authenticate(signedDataDigest)) {
+      LOGE("Failed to authenticate the image.");
+    } else {
+      LOGI("Image is authenticated successfully!");
+      success = true;
+    }
+    setAuthenticationHighPerformance(false);
+  }
+
+  abortBinaryAuthentication(authentication);
+  return success;
+}
+
+void abortBinaryAuthentication(BinaryAuthentication *authentication) {
+  memoryFreeAndDestroy(authentication);
+}
+
+}  // namespace chre
@@ -16,11 +16,13 @@
 
 #include "chre/core/event_loop.h"
 #include "chre/core/event_loop_manager.h"
+#include "chre/core/shared_payload.h"
 #include "chre/platform/assert.h"
 #include "chre/platform/memory.h"
 #include "chre/platform/shared/debug_dump.h"
 #include "chre/platform/system_time.h"
 #include "chre/util/macros.h"
+#include "chre/util/nanoapp/shared_payload.h"
 #include "chre_api/chre/re.h"
 
 using chre::EventLoopManager;
@@ -107,6 +109,47 @@ DLL_EXPORT void chreHeapFree(void *ptr) {
       nanoapp, ptr);
 }
 
+DLL_EXPORT void *chreSharedPayloadAlloc(uint32_t bytes) {
+  chre::Nanoapp *nanoapp = EventLoopManager::validateChreApiCall(__func__);
+  chre::SharedPayload *payload = chre::SharedPayload::allocate(*nanoapp, bytes);
+  void *data = nullptr;
+  if (payload != nullptr) {
+    if (nanoapp->addSharedPayloadRef(payload)) {
+      data = payload->getData();
+    } else {
+      payload->decRef();
+    }
+  }
+  return data;
+}
+
+DLL_EXPORT void chreSharedPayloadRetain(const void *payload) {
+  chre::Nanoapp *nanoapp = EventLoopManager::validateChreApiCall(__func__);
+  chre::SharedPayload *sharedPayload = chre::SharedPayload::fromData(payload);
+  if (sharedPayload == nullptr) {
+    LOGE("Nanoapp 0x%016" PRIx64 " retained an invalid shared payload %p",
+         nanoapp->getAppId(), payload);
+  } else if (nanoapp->addSharedPayloadRef(sharedPayload)) {
+    sharedPayload->incRef();
+  }
+}
+
+DLL_EXPORT void chreSharedPayloadRelease(const void *payload) {
+  chre::Nanoapp *nanoapp = EventLoopManager::validateChreApiCall(__func__);
+  if (payload != nullptr) {
+    chre::SharedPayload *sharedPayload = chre::SharedPayload::fromData(payload);
+    if (sharedPayload == nullptr) {
+      LOGE("Nanoapp 0x%016" PRIx64 " released an invalid shared payload %p",
+           nanoapp->getAppId(), payload);
+    } else if (!nanoapp->removeSharedPayloadRef(sharedPayload)) {
+      LOGE("Nanoapp 0x%016" PRIx64 " released a shared payload it doesn't hold",
+           nanoapp->getAppId());
+    } else {
+      sharedPayload->decRef();
+    }
+  }
+}
+
 DLL_EXPORT void platform_chreDebugDumpVaLog(const char *formatStr,
                                             va_list args) {
   chre::Nanoapp *nanoapp = EventLoopManager::validateChreApiCall(__func__);
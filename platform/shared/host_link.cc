@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+
 #include "chre/core/event_loop_manager.h"
 #include "chre/platform/shared/host_protocol_chre.h"
 #include "chre/platform/shared/nanoapp_load_manager.h"
@@ -49,10 +51,12 @@ void HostMessageHandlers::finishLoadingNanoappCallback(
   } else {
     LOGE("Nanoapp is not loaded");
   }
+  getLoadManager().onNanoappStarted(cbData->appId, success);
 
   if (cbData->sendFragmentResponse) {
     sendFragmentResponse(cbData->hostClientId, cbData->transactionId,
-                         cbData->fragmentId, success);
+                         cbData->fragmentId, success,
+                         cbData->fragmentWindowSize, cbData->binaryResident);
   }
 }
 
@@ -60,39 +64,64 @@ void HostMessageHandlers::loadNanoappData(
     uint16_t hostClientId, uint32_t transactionId, uint64_t appId,
     uint32_t appVersion, uint32_t appFlags, uint32_t targetApiVersion,
     const void *buffer, size_t bufferLen, uint32_t fragmentId,
-    size_t appBinaryLen, bool respondBeforeStart) {
+    size_t appBinaryLen, bool respondBeforeStart, uint32_t fragmentWindowSize,
+    uint64_t appBinaryHash) {
+  NanoappLoadManager &loadManager = getLoadManager();
   bool success = true;
-
-  if (fragmentId == 0 || fragmentId == 1) {
+  bool binaryResident = false;
+
+  // Windowing only applies to fragmented loads, and a resent first fragment
+  // of a windowed transaction in progress is a duplicate rather than a restart
+  uint32_t windowSize =
+      (fragmentId == 0)
+          ? 0
+          : std::min<uint32_t>(fragmentWindowSize,
+                               CHRE_NANOAPP_LOAD_MAX_WINDOW_SIZE);
+  bool isFirstFragment = (fragmentId == 0 || fragmentId == 1);
+  if (isFirstFragment &&
+      (windowSize == 0 ||
+       !loadManager.hasPendingLoadTransaction(hostClientId, transactionId))) {
     size_t totalAppBinaryLen = (fragmentId == 0) ? bufferLen : appBinaryLen;
     LOGD("Load nanoapp request for app ID 0x%016" PRIx64 " ver 0x%" PRIx32
          " flags 0x%" PRIx32 " target API 0x%08" PRIx32
-         " size %zu (txnId %" PRIu32 " client %" PRIu16 ")",
+         " size %zu (txnId %" PRIu32 " client %" PRIu16 " window %" PRIu32 ")",
          appId, appVersion, appFlags, targetApiVersion, totalAppBinaryLen,
-         transactionId, hostClientId);
+         transactionId, hostClientId, windowSize);
 
-    if (getLoadManager().hasPendingLoadTransaction()) {
-      FragmentedLoadInfo info = getLoadManager().getTransactionInfo();
+    FragmentedLoadInfo info;
+    if (loadManager.getTransactionToReplace(hostClientId, transactionId,
+                                            &info)) {
       sendFragmentResponse(info.hostClientId, info.transactionId,
-                           0 /* fragmentId */, false /* success */);
-      getLoadManager().markFailure();
+                           0 /* fragmentId */, false /* success */,
+                           info.windowSize);
+      loadManager.markFailure(info.hostClientId, info.transactionId);
     }
 
-    success = getLoadManager().prepareForLoad(
+    success = loadManager.prepareForLoad(
         hostClientId, transactionId, appId, appVersion, appFlags,
-        totalAppBinaryLen, targetApiVersion);
+        totalAppBinaryLen, targetApiVersion, windowSize, appBinaryHash);
+    // The binary retained across a restart is loaded without the fragments
+    binaryResident =
+        success && loadManager.isLoadComplete(hostClientId, transactionId);
   }
 
-  if (success) {
-    success = getLoadManager().copyNanoappFragment(
+  NanoappLoadManager::FragmentResult result =
+      NanoappLoadManager::FragmentResult::FAILED;
+  if (binaryResident) {
+    result = NanoappLoadManager::FragmentResult::ACCEPTED;
+  } else if (success) {
+    result = loadManager.copyNanoappFragment(
         hostClientId, transactionId, (fragmentId == 0) ? 1 : fragmentId, buffer,
         bufferLen);
   } else {
     LOGE("Failed to prepare for load");
   }
 
-  if (getLoadManager().isLoadComplete()) {
+  FragmentedLoadInfo info;
+  if (result == NanoappLoadManager::FragmentResult::ACCEPTED &&
+      loadManager.isLoadComplete(hostClientId, transactionId)) {
     LOGD("Load manager load complete...");
+    loadManager.getTransactionInfo(hostClientId, transactionId, &info);
     auto cbData = MakeUnique<LoadNanoappCallbackData>();
     if (cbData.isNull()) {
       LOG_OOM();
@@ -101,8 +130,10 @@ void HostMessageHandlers::loadNanoappData(
       cbData->hostClientId = hostClientId;
       cbData->appId = appId;
       cbData->fragmentId = fragmentId;
-      cbData->nanoapp = getLoadManager().releaseNanoapp();
+      cbData->nanoapp = loadManager.releaseNanoapp(hostClientId, transactionId);
       cbData->sendFragmentResponse = !respondBeforeStart;
+      cbData->fragmentWindowSize = info.windowSize;
+      cbData->binaryResident = binaryResident;
 
       LOGD("Instance ID %" PRIu16 " assigned to app ID 0x%" PRIx64,
            cbData->nanoapp->getInstanceId(), appId);
@@ -113,12 +144,23 @@ void HostMessageHandlers::loadNanoappData(
           SystemCallbackType::FinishLoadingNanoapp, std::move(cbData),
           finishLoadingNanoappCallback);
       if (respondBeforeStart) {
-        sendFragmentResponse(hostClientId, transactionId, fragmentId, success);
+        sendFragmentResponse(hostClientId, transactionId, fragmentId, success,
+                             info.windowSize, binaryResident);
       }  // else the response will be sent in finishLoadingNanoappCallback
     }
+  } else if (loadManager.getTransactionInfo(hostClientId, transactionId,
+                                            &info) &&
+             info.windowSize > 0) {
+    // Acknowledge every fragment received in order so far
+    sendFragmentResponse(hostClientId, transactionId, info.nextFragmentId - 1,
+                         result != NanoappLoadManager::FragmentResult::FAILED,
+                         info.windowSize);
   } else {
     // send a response for this fragment
-    sendFragmentResponse(hostClientId, transactionId, fragmentId, success);
+    sendFragmentResponse(
+        hostClientId, transactionId, fragmentId,
+        result == NanoappLoadManager::FragmentResult::ACCEPTED,
+        0 /* fragmentWindowSize */);
   }
 }
 
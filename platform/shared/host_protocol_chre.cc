@@ -29,6 +29,25 @@ using flatbuffers::Offset;
 using flatbuffers::Vector;
 
 namespace chre {
+namespace {
+
+//! The size of a record in TraceData::records.
+constexpr size_t kTraceRecordSize = 18;
+
+//! The offset of the group in TraceData::records when it has none.
+constexpr uint16_t kTraceNoGroup = 0xffff;
+
+//! Labels and groups longer than this are truncated in TraceData::strings.
+constexpr size_t kMaxTraceStringLen = 63;
+
+uint8_t *writeLittleEndian(uint8_t *dest, uint64_t value, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    dest[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+  return dest + size;
+}
+
+}  // anonymous namespace
 
 // This is similar to getStringFromByteVector in host_protocol_host.h. Ensure
 // that method's implementation is kept in sync with this.
@@ -96,7 +115,8 @@ bool HostProtocolChre::decodeMessageFromHost(const void *message,
             request->app_version(), request->app_flags(),
             request->target_api_version(), appBinary->data(), appBinary->size(),
             appBinaryFilename, request->fragment_id(),
-            request->total_app_size(), request->respond_before_start());
+            request->total_app_size(), request->respond_before_start(),
+            request->fragment_window_size(), request->app_binary_hash());
         break;
       }
 
@@ -200,6 +220,10 @@ bool HostProtocolChre::decodeMessageFromHost(const void *message,
         break;
       }
 
+      case fbs::ChreMessage::TraceDataRequest:
+        HostMessageHandlers::handleTraceDataRequest(hostClientId);
+        break;
+
       default:
         LOGW("Got invalid/unexpected message type %" PRIu8,
              static_cast<uint8_t>(container->message_type()));
@@ -266,6 +290,32 @@ void HostProtocolChre::finishNanoappListResponse(
            hostClientId);
 }
 
+void HostProtocolChre::addNanoappMessageToBatch(
+    ChreFlatBufferBuilder &builder,
+    DynamicVector<Offset<fbs::NanoappMessage>> &offsetVector, uint64_t appId,
+    uint32_t messageType, uint16_t hostEndpoint, const void *messageData,
+    size_t messageDataLen, uint32_t permissions, uint32_t messagePermissions,
+    bool wokeHost) {
+  auto messageDataOffset = builder.CreateVector(
+      static_cast<const uint8_t *>(messageData), messageDataLen);
+  auto offset = fbs::CreateNanoappMessage(
+      builder, appId, messageType, hostEndpoint, messageDataOffset,
+      messagePermissions, permissions, wokeHost);
+
+  if (!offsetVector.push_back(offset)) {
+    LOGE("Couldn't push nanoapp message offset!");
+  }
+}
+
+void HostProtocolChre::finishNanoappMessageBatch(
+    ChreFlatBufferBuilder &builder,
+    DynamicVector<Offset<fbs::NanoappMessage>> &offsetVector) {
+  auto vectorOffset =
+      builder.CreateVector<Offset<fbs::NanoappMessage>>(offsetVector);
+  auto batch = fbs::CreateNanoappMessageBatch(builder, vectorOffset);
+  finalize(builder, fbs::ChreMessage::NanoappMessageBatch, batch.Union());
+}
+
 void HostProtocolChre::encodePulseResponse(ChreFlatBufferBuilder &builder) {
   auto response = fbs::CreatePulseResponse(builder);
   finalize(builder, fbs::ChreMessage::PulseResponse, response.Union());
@@ -275,9 +325,13 @@ void HostProtocolChre::encodeLoadNanoappResponse(ChreFlatBufferBuilder &builder,
                                                  uint16_t hostClientId,
                                                  uint32_t transactionId,
                                                  bool success,
-                                                 uint32_t fragmentId) {
-  auto response = fbs::CreateLoadNanoappResponse(builder, transactionId,
-                                                 success, fragmentId);
+                                                 uint32_t fragmentId,
+                                                 uint32_t fragmentWindowSize,
+                                                 bool binaryResident) {
+  auto response =
+      fbs::CreateLoadNanoappResponse(builder, transactionId, success,
+                                     fragmentId, fragmentWindowSize,
+                                     binaryResident);
   finalize(builder, fbs::ChreMessage::LoadNanoappResponse, response.Union(),
            hostClientId);
 }
@@ -320,6 +374,70 @@ void HostProtocolChre::encodeLogMessagesV2(ChreFlatBufferBuilder &builder,
   finalize(builder, fbs::ChreMessage::LogMessageV2, message.Union());
 }
 
+void HostProtocolChre::encodeTraceData(ChreFlatBufferBuilder &builder,
+                                       uint16_t hostClientId,
+                                       const TraceRecord *records,
+                                       size_t numRecords, uint8_t threadIndex,
+                                       uint32_t numDropped, bool last) {
+  numRecords = MIN(numRecords, kMaxTraceRecordsPerMessage);
+
+  // Labels and groups are string literals, so each one is only sent once
+  const char *strings[2 * kMaxTraceRecordsPerMessage];
+  uint16_t stringOffsets[2 * kMaxTraceRecordsPerMessage];
+  size_t numStrings = 0;
+  size_t stringsSize = 0;
+  auto addString = [&](const char *str) {
+    for (size_t i = 0; i < numStrings; i++) {
+      if (strings[i] == str) {
+        return stringOffsets[i];
+      }
+    }
+    strings[numStrings] = str;
+    stringOffsets[numStrings] = static_cast<uint16_t>(stringsSize);
+    stringsSize += MIN(strlen(str), kMaxTraceStringLen) + 1;
+    return stringOffsets[numStrings++];
+  };
+
+  uint16_t labelOffsets[kMaxTraceRecordsPerMessage];
+  uint16_t groupOffsets[kMaxTraceRecordsPerMessage];
+  for (size_t i = 0; i < numRecords; i++) {
+    labelOffsets[i] = addString(records[i].label);
+    groupOffsets[i] = (records[i].group == nullptr)
+                          ? kTraceNoGroup
+                          : addString(records[i].group);
+  }
+
+  int8_t *stringsData;
+  auto stringsOffset =
+      builder.CreateUninitializedVector(stringsSize, &stringsData);
+  for (size_t i = 0; i < numStrings; i++) {
+    size_t len = MIN(strlen(strings[i]), kMaxTraceStringLen);
+    memcpy(stringsData + stringOffsets[i], strings[i], len);
+    stringsData[stringOffsets[i] + len] = '\0';
+  }
+
+  uint8_t *recordsData;
+  auto recordsOffset = builder.CreateUninitializedVector(
+      numRecords * kTraceRecordSize, &recordsData);
+  for (size_t i = 0; i < numRecords; i++) {
+    recordsData = writeLittleEndian(recordsData, records[i].timestampNs,
+                                    sizeof(uint64_t));
+    recordsData =
+        writeLittleEndian(recordsData, records[i].traceId, sizeof(uint32_t));
+    recordsData =
+        writeLittleEndian(recordsData, labelOffsets[i], sizeof(uint16_t));
+    recordsData =
+        writeLittleEndian(recordsData, groupOffsets[i], sizeof(uint16_t));
+    *recordsData++ = static_cast<uint8_t>(records[i].type);
+    *recordsData++ = threadIndex;
+  }
+
+  auto message = fbs::CreateTraceData(builder, recordsOffset, stringsOffset,
+                                      numDropped, last);
+  finalize(builder, fbs::ChreMessage::TraceData, message.Union(),
+           hostClientId);
+}
+
 void HostProtocolChre::encodeDebugDumpData(ChreFlatBufferBuilder &builder,
                                            uint16_t hostClientId,
                                            const char *debugStr,
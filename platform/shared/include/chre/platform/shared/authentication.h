@@ -18,9 +18,14 @@
 #define CHRE_PLATFORM_SHARED_AUTHENTICATION_H_
 
 #include <cstddef>
+#include <cstdint>
 
 namespace chre {
 
+//! The state of a binary being authenticated as it is received, see
+//! startBinaryAuthentication().
+struct BinaryAuthentication;
+
 /**
  * Authenticates the signature of the provided binary. If not provided
  * elsewhere by the platform, this method must ensure that nanoapps are signed
@@ -39,6 +44,69 @@ namespace chre {
 bool authenticateBinary(const void *binary, size_t appBinaryLen,
                         void **realBinaryStart);
 
+/**
+ * Starts authenticating a binary that is received in fragments. The fragments
+ * are hashed by updateBinaryAuthentication() as they arrive, so that only the
+ * signature verification is left for finishBinaryAuthentication() once the
+ * whole binary has been received.
+ *
+ * @param appBinaryLen The length of the binary.
+ * @param headerSize A non-null pointer that, if this method succeeds, is
+ *     filled with the size of the headers used by the authentication code,
+ *     which are followed by the raw binary.
+ * @return The state of the authentication, which must be released with
+ *     finishBinaryAuthentication() or abortBinaryAuthentication(), or null if
+ *     the binary can't be authenticated.
+ */
+BinaryAuthentication *startBinaryAuthentication(size_t appBinaryLen,
+                                                size_t *headerSize);
+
+/**
+ * Hashes the next fragment of a binary. The headers are validated as soon as
+ * they have been received.
+ *
+ * @param authentication The state returned by startBinaryAuthentication().
+ * @param fragment Pointer to the fragment.
+ * @param fragmentLen The length of the fragment.
+ * @return False if the binary can no longer pass authentication.
+ */
+bool updateBinaryAuthentication(BinaryAuthentication *authentication,
+                                const void *fragment, size_t fragmentLen);
+
+/**
+ * Verifies the hash and signature of a binary that has been fully passed to
+ * updateBinaryAuthentication(), and releases the state of the authentication.
+ *
+ * @param authentication The state returned by startBinaryAuthentication().
+ * @return True if the binary passed authentication.
+ */
+bool finishBinaryAuthentication(BinaryAuthentication *authentication);
+
+/**
+ * Releases the state of an authentication that won't be finished.
+ *
+ * @param authentication The state returned by startBinaryAuthentication().
+ */
+void abortBinaryAuthentication(BinaryAuthentication *authentication);
+
+/**
+ * Provides the public keys of the signers the platform trusts. Must be
+ * implemented by platforms using the shared authentication code.
+ *
+ * @param numKeys Filled with the number of keys returned.
+ * @return An array of ECDSA P-256 public keys, each made of the 32 byte X and
+ *     Y coordinates of the public point.
+ */
+const uint8_t *const *getTrustedPublicKeys(size_t *numKeys);
+
+/**
+ * Called with true before the shared authentication code hashes or verifies
+ * data and with false afterwards, e.g. for the platform to raise the CPU
+ * frequency meanwhile. Must be implemented by platforms using the shared
+ * authentication code.
+ */
+void setAuthenticationHighPerformance(bool enabled);
+
 }  // namespace chre
 
 #endif  // CHRE_PLATFORM_SHARED_AUTHENTICATION_H_
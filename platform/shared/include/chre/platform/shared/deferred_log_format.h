@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_PLATFORM_SHARED_DEFERRED_LOG_FORMAT_H_
+#define CHRE_PLATFORM_SHARED_DEFERRED_LOG_FORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file
+ * Helpers shared by CHRE and the host for LogType::DEFERRED_STRING logs, where
+ * CHRE captures the arguments of a printf style log and the host formats it.
+ * Both sides must derive the encoded size of each argument from the format
+ * string alone, so the rules are kept here. See LogMessageV2 in
+ * host_messages.fbs for the log format.
+ */
+
+namespace chre {
+
+//! Set in the format index byte of a deferred log when the format string
+//! follows it.
+constexpr uint8_t kDeferredLogFormatDefinitionFlag = 0x80;
+
+//! The number of format strings that can be referenced by index within a
+//! single log buffer.
+constexpr uint8_t kDeferredLogMaxFormats = 16;
+static_assert(kDeferredLogMaxFormats <= kDeferredLogFormatDefinitionFlag,
+              "Format indices must not overlap with the definition flag");
+
+//! How the argument of a conversion is encoded in a deferred log.
+enum class DeferredLogArgType : uint8_t {
+  //! The conversion consumes no argument, e.g. "%%".
+  NONE,
+  //! int or unsigned int, encoded in 4 bytes.
+  INT32,
+  //! Integers with an l, ll, j, z or t length modifier, encoded in 8 bytes.
+  INT64,
+  //! double, encoded in 8 bytes.
+  DOUBLE,
+  //! void *, widened to 8 bytes.
+  POINTER,
+  //! A NULL terminated copy of the string.
+  STRING,
+  //! The conversion can't be deferred, e.g. "%n" or a '*' width.
+  UNSUPPORTED,
+};
+
+//! A single conversion specification within a format string.
+struct DeferredLogConversion {
+  //! Points to the '%' starting the specification.
+  const char *start;
+
+  //! The length of the specification, including the conversion character.
+  size_t length;
+
+  //! The offset and length of the length modifier (e.g. "ll") within the
+  //! specification. The length is 0 if there is no modifier.
+  size_t modifierOffset;
+  size_t modifierLength;
+
+  //! The conversion character, e.g. 'd'.
+  char specifier;
+
+  DeferredLogArgType argType;
+};
+
+/**
+ * Finds the next conversion specification in a format string.
+ *
+ * @param format The position in the format string to search from, which is
+ *        advanced past the conversion that was found.
+ * @param conversion Populated with the conversion that was found.
+ * @return false if the end of the format string was reached without finding a
+ *         conversion.
+ */
+inline bool getNextDeferredLogConversion(const char **format,
+                                         DeferredLogConversion *conversion) {
+  const char *cursor = *format;
+  while (*cursor != '\0' && *cursor != '%') {
+    cursor++;
+  }
+  if (*cursor == '\0') {
+    *format = cursor;
+    return false;
+  }
+
+  const char *start = cursor++;
+  bool supported = true;
+  while (*cursor != '\0' && (*cursor == '-' || *cursor == '+' ||
+                             *cursor == ' ' || *cursor == '#' ||
+                             *cursor == '0' || *cursor == '\'')) {
+    cursor++;
+  }
+  while ((*cursor >= '0' && *cursor <= '9') || *cursor == '.' ||
+         *cursor == '*') {
+    if (*cursor == '*') {
+      supported = false;
+    }
+    cursor++;
+  }
+
+  const char *modifier = cursor;
+  while (*cursor == 'h' || *cursor == 'l' || *cursor == 'j' ||
+         *cursor == 'z' || *cursor == 't' || *cursor == 'L') {
+    cursor++;
+  }
+  size_t modifierLength = static_cast<size_t>(cursor - modifier);
+  bool wide = modifierLength > 0 && *modifier != 'h';
+  bool validIntModifier =
+      modifierLength == 0 ||
+      (modifierLength == 1 && *modifier != 'L') ||
+      (modifierLength == 2 && modifier[0] == modifier[1] &&
+       (*modifier == 'h' || *modifier == 'l'));
+
+  char specifier = *cursor;
+  if (specifier != '\0') {
+    cursor++;
+  }
+
+  DeferredLogArgType argType;
+  switch (specifier) {
+    case '%':
+      argType = DeferredLogArgType::NONE;
+      break;
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+      argType = wide ? DeferredLogArgType::INT64 : DeferredLogArgType::INT32;
+      supported &= validIntModifier;
+      break;
+    case 'c':
+      argType = DeferredLogArgType::INT32;
+      supported &= (modifierLength == 0);
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      argType = DeferredLogArgType::DOUBLE;
+      supported &= (modifierLength == 0 ||
+                    (modifierLength == 1 && *modifier == 'l'));
+      break;
+    case 'p':
+      argType = DeferredLogArgType::POINTER;
+      supported &= (modifierLength == 0);
+      break;
+    case 's':
+      argType = DeferredLogArgType::STRING;
+      supported &= (modifierLength == 0);
+      break;
+    default:
+      argType = DeferredLogArgType::UNSUPPORTED;
+      break;
+  }
+
+  conversion->start = start;
+  conversion->length = static_cast<size_t>(cursor - start);
+  conversion->modifierOffset = static_cast<size_t>(modifier - start);
+  conversion->modifierLength = modifierLength;
+  conversion->specifier = specifier;
+  conversion->argType = supported ? argType : DeferredLogArgType::UNSUPPORTED;
+  *format = cursor;
+  return true;
+}
+
+}  // namespace chre
+
+#endif  // CHRE_PLATFORM_SHARED_DEFERRED_LOG_FORMAT_H_
@@ -15,6 +15,9 @@ struct NanoappMessageBuilder;
 struct MessageDeliveryStatus;
 struct MessageDeliveryStatusBuilder;
 
+struct NanoappMessageBatch;
+struct NanoappMessageBatchBuilder;
+
 struct HubInfoRequest;
 struct HubInfoRequestBuilder;
 
@@ -111,6 +114,12 @@ struct PulseRequestBuilder;
 struct PulseResponse;
 struct PulseResponseBuilder;
 
+struct TraceDataRequest;
+struct TraceDataRequestBuilder;
+
+struct TraceData;
+struct TraceDataBuilder;
+
 struct HostAddress;
 
 struct MessageContainer;
@@ -231,33 +240,36 @@ enum class LogType : int8_t {
   TOKENIZED = 1,
   BLUETOOTH = 2,
   NANOAPP_TOKENIZED = 3,
+  DEFERRED_STRING = 4,
   MIN = STRING,
-  MAX = NANOAPP_TOKENIZED
+  MAX = DEFERRED_STRING
 };
 
-inline const LogType (&EnumValuesLogType())[4] {
+inline const LogType (&EnumValuesLogType())[5] {
   static const LogType values[] = {
     LogType::STRING,
     LogType::TOKENIZED,
     LogType::BLUETOOTH,
-    LogType::NANOAPP_TOKENIZED
+    LogType::NANOAPP_TOKENIZED,
+    LogType::DEFERRED_STRING
   };
   return values;
 }
 
 inline const char * const *EnumNamesLogType() {
-  static const char * const names[5] = {
+  static const char * const names[6] = {
     "STRING",
     "TOKENIZED",
     "BLUETOOTH",
     "NANOAPP_TOKENIZED",
+    "DEFERRED_STRING",
     nullptr
   };
   return names;
 }
 
 inline const char *EnumNameLogType(LogType e) {
-  if (flatbuffers::IsOutRange(e, LogType::STRING, LogType::NANOAPP_TOKENIZED)) return "";
+  if (flatbuffers::IsOutRange(e, LogType::STRING, LogType::DEFERRED_STRING)) return "";
   const size_t index = static_cast<size_t>(e);
   return EnumNamesLogType()[index];
 }
@@ -328,11 +340,14 @@ enum class ChreMessage : uint8_t {
   PulseResponse = 30,
   NanoappTokenDatabaseInfo = 31,
   MessageDeliveryStatus = 32,
+  NanoappMessageBatch = 33,
+  TraceDataRequest = 34,
+  TraceData = 35,
   MIN = NONE,
-  MAX = MessageDeliveryStatus
+  MAX = TraceData
 };
 
-inline const ChreMessage (&EnumValuesChreMessage())[33] {
+inline const ChreMessage (&EnumValuesChreMessage())[36] {
   static const ChreMessage values[] = {
     ChreMessage::NONE,
     ChreMessage::NanoappMessage,
@@ -366,13 +381,16 @@ inline const ChreMessage (&EnumValuesChreMessage())[33] {
     ChreMessage::PulseRequest,
     ChreMessage::PulseResponse,
     ChreMessage::NanoappTokenDatabaseInfo,
-    ChreMessage::MessageDeliveryStatus
+    ChreMessage::MessageDeliveryStatus,
+    ChreMessage::NanoappMessageBatch,
+    ChreMessage::TraceDataRequest,
+    ChreMessage::TraceData
   };
   return values;
 }
 
 inline const char * const *EnumNamesChreMessage() {
-  static const char * const names[34] = {
+  static const char * const names[37] = {
     "NONE",
     "NanoappMessage",
     "HubInfoRequest",
@@ -406,13 +424,16 @@ inline const char * const *EnumNamesChreMessage() {
     "PulseResponse",
     "NanoappTokenDatabaseInfo",
     "MessageDeliveryStatus",
+    "NanoappMessageBatch",
+    "TraceDataRequest",
+    "TraceData",
     nullptr
   };
   return names;
 }
 
 inline const char *EnumNameChreMessage(ChreMessage e) {
-  if (flatbuffers::IsOutRange(e, ChreMessage::NONE, ChreMessage::MessageDeliveryStatus)) return "";
+  if (flatbuffers::IsOutRange(e, ChreMessage::NONE, ChreMessage::TraceData)) return "";
   const size_t index = static_cast<size_t>(e);
   return EnumNamesChreMessage()[index];
 }
@@ -549,6 +570,18 @@ template<> struct ChreMessageTraits<chre::fbs::MessageDeliveryStatus> {
   static const ChreMessage enum_value = ChreMessage::MessageDeliveryStatus;
 };
 
+template<> struct ChreMessageTraits<chre::fbs::NanoappMessageBatch> {
+  static const ChreMessage enum_value = ChreMessage::NanoappMessageBatch;
+};
+
+template<> struct ChreMessageTraits<chre::fbs::TraceDataRequest> {
+  static const ChreMessage enum_value = ChreMessage::TraceDataRequest;
+};
+
+template<> struct ChreMessageTraits<chre::fbs::TraceData> {
+  static const ChreMessage enum_value = ChreMessage::TraceData;
+};
+
 bool VerifyChreMessage(flatbuffers::Verifier &verifier, const void *obj, ChreMessage type);
 bool VerifyChreMessageVector(flatbuffers::Verifier &verifier, const flatbuffers::Vector<flatbuffers::Offset<void>> *values, const flatbuffers::Vector<uint8_t> *types);
 
@@ -782,6 +815,59 @@ inline flatbuffers::Offset<MessageDeliveryStatus> CreateMessageDeliveryStatus(
   return builder_.Finish();
 }
 
+struct NanoappMessageBatch FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  typedef NanoappMessageBatchBuilder Builder;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_MESSAGES = 4
+  };
+  const flatbuffers::Vector<flatbuffers::Offset<chre::fbs::NanoappMessage>> *messages() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<chre::fbs::NanoappMessage>> *>(VT_MESSAGES);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_MESSAGES) &&
+           verifier.VerifyVector(messages()) &&
+           verifier.VerifyVectorOfTables(messages()) &&
+           verifier.EndTable();
+  }
+};
+
+struct NanoappMessageBatchBuilder {
+  typedef NanoappMessageBatch Table;
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_messages(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<chre::fbs::NanoappMessage>>> messages) {
+    fbb_.AddOffset(NanoappMessageBatch::VT_MESSAGES, messages);
+  }
+  explicit NanoappMessageBatchBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  NanoappMessageBatchBuilder &operator=(const NanoappMessageBatchBuilder &);
+  flatbuffers::Offset<NanoappMessageBatch> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<NanoappMessageBatch>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<NanoappMessageBatch> CreateNanoappMessageBatch(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<chre::fbs::NanoappMessage>>> messages = 0) {
+  NanoappMessageBatchBuilder builder_(_fbb);
+  builder_.add_messages(messages);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<NanoappMessageBatch> CreateNanoappMessageBatchDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    const std::vector<flatbuffers::Offset<chre::fbs::NanoappMessage>> *messages = nullptr) {
+  auto messages__ = messages ? _fbb.CreateVector<flatbuffers::Offset<chre::fbs::NanoappMessage>>(*messages) : 0;
+  return chre::fbs::CreateNanoappMessageBatch(
+      _fbb,
+      messages__);
+}
+
 struct HubInfoRequest FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   typedef HubInfoRequestBuilder Builder;
   bool Verify(flatbuffers::Verifier &verifier) const {
@@ -1332,7 +1418,9 @@ struct LoadNanoappRequest FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
     VT_TOTAL_APP_SIZE = 16,
     VT_APP_BINARY_FILE_NAME = 18,
     VT_APP_FLAGS = 20,
-    VT_RESPOND_BEFORE_START = 22
+    VT_RESPOND_BEFORE_START = 22,
+    VT_FRAGMENT_WINDOW_SIZE = 24,
+    VT_APP_BINARY_HASH = 26
   };
   uint32_t transaction_id() const {
     return GetField<uint32_t>(VT_TRANSACTION_ID, 0);
@@ -1376,6 +1464,20 @@ struct LoadNanoappRequest FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   bool respond_before_start() const {
     return GetField<uint8_t>(VT_RESPOND_BEFORE_START, 0) != 0;
   }
+  /// If nonzero, the requestor may send up to this many fragments of a
+  /// fragmented load without waiting for their responses. See
+  /// LoadNanoappResponse::fragment_window_size.
+  uint32_t fragment_window_size() const {
+    return GetField<uint32_t>(VT_FRAGMENT_WINDOW_SIZE, 0);
+  }
+  /// If nonzero, a hash of the whole nanoapp binary chosen by the requestor,
+  /// set in the first fragment. CHRE may retain binaries across restarts and
+  /// load the nanoapp from the retained copy of a binary loaded earlier with
+  /// the same app ID, version, size and hash, see
+  /// LoadNanoappResponse::binary_resident.
+  uint64_t app_binary_hash() const {
+    return GetField<uint64_t>(VT_APP_BINARY_HASH, 0);
+  }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<uint32_t>(verifier, VT_TRANSACTION_ID) &&
@@ -1390,6 +1492,8 @@ struct LoadNanoappRequest FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
            verifier.VerifyVector(app_binary_file_name()) &&
            VerifyField<uint32_t>(verifier, VT_APP_FLAGS) &&
            VerifyField<uint8_t>(verifier, VT_RESPOND_BEFORE_START) &&
+           VerifyField<uint32_t>(verifier, VT_FRAGMENT_WINDOW_SIZE) &&
+           VerifyField<uint64_t>(verifier, VT_APP_BINARY_HASH) &&
            verifier.EndTable();
   }
 };
@@ -1428,6 +1532,12 @@ struct LoadNanoappRequestBuilder {
   void add_respond_before_start(bool respond_before_start) {
     fbb_.AddElement<uint8_t>(LoadNanoappRequest::VT_RESPOND_BEFORE_START, static_cast<uint8_t>(respond_before_start), 0);
   }
+  void add_fragment_window_size(uint32_t fragment_window_size) {
+    fbb_.AddElement<uint32_t>(LoadNanoappRequest::VT_FRAGMENT_WINDOW_SIZE, fragment_window_size, 0);
+  }
+  void add_app_binary_hash(uint64_t app_binary_hash) {
+    fbb_.AddElement<uint64_t>(LoadNanoappRequest::VT_APP_BINARY_HASH, app_binary_hash, 0);
+  }
   explicit LoadNanoappRequestBuilder(flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -1452,8 +1562,11 @@ inline flatbuffers::Offset<LoadNanoappRequest> CreateLoadNanoappRequest(
     uint32_t total_app_size = 0,
     flatbuffers::Offset<flatbuffers::Vector<int8_t>> app_binary_file_name = 0,
     uint32_t app_flags = 0,
-    bool respond_before_start = false) {
+    bool respond_before_start = false,
+    uint32_t fragment_window_size = 0,
+    uint64_t app_binary_hash = 0) {
   LoadNanoappRequestBuilder builder_(_fbb);
+  builder_.add_app_binary_hash(app_binary_hash);
   builder_.add_app_id(app_id);
   builder_.add_app_flags(app_flags);
   builder_.add_app_binary_file_name(app_binary_file_name);
@@ -1463,6 +1576,7 @@ inline flatbuffers::Offset<LoadNanoappRequest> CreateLoadNanoappRequest(
   builder_.add_target_api_version(target_api_version);
   builder_.add_app_version(app_version);
   builder_.add_transaction_id(transaction_id);
+  builder_.add_fragment_window_size(fragment_window_size);
   builder_.add_respond_before_start(respond_before_start);
   return builder_.Finish();
 }
@@ -1478,7 +1592,9 @@ inline flatbuffers::Offset<LoadNanoappRequest> CreateLoadNanoappRequestDirect(
     uint32_t total_app_size = 0,
     const std::vector<int8_t> *app_binary_file_name = nullptr,
     uint32_t app_flags = 0,
-    bool respond_before_start = false) {
+    bool respond_before_start = false,
+    uint32_t fragment_window_size = 0,
+    uint64_t app_binary_hash = 0) {
   auto app_binary__ = app_binary ? _fbb.CreateVector<uint8_t>(*app_binary) : 0;
   auto app_binary_file_name__ = app_binary_file_name ? _fbb.CreateVector<int8_t>(*app_binary_file_name) : 0;
   return chre::fbs::CreateLoadNanoappRequest(
@@ -1492,7 +1608,9 @@ inline flatbuffers::Offset<LoadNanoappRequest> CreateLoadNanoappRequestDirect(
       total_app_size,
       app_binary_file_name__,
       app_flags,
-      respond_before_start);
+      respond_before_start,
+      fragment_window_size,
+      app_binary_hash);
 }
 
 struct LoadNanoappResponse FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
@@ -1500,7 +1618,9 @@ struct LoadNanoappResponse FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table
   enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
     VT_TRANSACTION_ID = 4,
     VT_SUCCESS = 6,
-    VT_FRAGMENT_ID = 8
+    VT_FRAGMENT_ID = 8,
+    VT_FRAGMENT_WINDOW_SIZE = 10,
+    VT_BINARY_RESIDENT = 12
   };
   uint32_t transaction_id() const {
     return GetField<uint32_t>(VT_TRANSACTION_ID, 0);
@@ -1515,11 +1635,27 @@ struct LoadNanoappResponse FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table
   uint32_t fragment_id() const {
     return GetField<uint32_t>(VT_FRAGMENT_ID, 0);
   }
+  /// The number of fragments CHRE accepts in flight for this transaction.
+  /// If 0, CHRE doesn't support windowed loading and the requestor must wait
+  /// for the response to each fragment before sending the next one.
+  /// Otherwise, fragment_id is a cumulative acknowledgement of all fragments
+  /// up to and including it.
+  uint32_t fragment_window_size() const {
+    return GetField<uint32_t>(VT_FRAGMENT_WINDOW_SIZE, 0);
+  }
+  /// If true, CHRE loaded the nanoapp from the retained copy of a binary with
+  /// the app_binary_hash given in the first fragment, and the requestor must
+  /// not send the remaining fragments. This response ends the transaction.
+  bool binary_resident() const {
+    return GetField<uint8_t>(VT_BINARY_RESIDENT, 0) != 0;
+  }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<uint32_t>(verifier, VT_TRANSACTION_ID) &&
            VerifyField<uint8_t>(verifier, VT_SUCCESS) &&
            VerifyField<uint32_t>(verifier, VT_FRAGMENT_ID) &&
+           VerifyField<uint32_t>(verifier, VT_FRAGMENT_WINDOW_SIZE) &&
+           VerifyField<uint8_t>(verifier, VT_BINARY_RESIDENT) &&
            verifier.EndTable();
   }
 };
@@ -1537,6 +1673,12 @@ struct LoadNanoappResponseBuilder {
   void add_fragment_id(uint32_t fragment_id) {
     fbb_.AddElement<uint32_t>(LoadNanoappResponse::VT_FRAGMENT_ID, fragment_id, 0);
   }
+  void add_fragment_window_size(uint32_t fragment_window_size) {
+    fbb_.AddElement<uint32_t>(LoadNanoappResponse::VT_FRAGMENT_WINDOW_SIZE, fragment_window_size, 0);
+  }
+  void add_binary_resident(bool binary_resident) {
+    fbb_.AddElement<uint8_t>(LoadNanoappResponse::VT_BINARY_RESIDENT, static_cast<uint8_t>(binary_resident), 0);
+  }
   explicit LoadNanoappResponseBuilder(flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -1553,10 +1695,14 @@ inline flatbuffers::Offset<LoadNanoappResponse> CreateLoadNanoappResponse(
     flatbuffers::FlatBufferBuilder &_fbb,
     uint32_t transaction_id = 0,
     bool success = false,
-    uint32_t fragment_id = 0) {
+    uint32_t fragment_id = 0,
+    uint32_t fragment_window_size = 0,
+    bool binary_resident = false) {
   LoadNanoappResponseBuilder builder_(_fbb);
   builder_.add_fragment_id(fragment_id);
   builder_.add_transaction_id(transaction_id);
+  builder_.add_fragment_window_size(fragment_window_size);
+  builder_.add_binary_resident(binary_resident);
   builder_.add_success(success);
   return builder_.Finish();
 }
@@ -2787,6 +2933,126 @@ inline flatbuffers::Offset<PulseResponse> CreatePulseResponse(
   return builder_.Finish();
 }
 
+struct TraceDataRequest FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  typedef TraceDataRequestBuilder Builder;
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           verifier.EndTable();
+  }
+};
+
+struct TraceDataRequestBuilder {
+  typedef TraceDataRequest Table;
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  explicit TraceDataRequestBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  TraceDataRequestBuilder &operator=(const TraceDataRequestBuilder &);
+  flatbuffers::Offset<TraceDataRequest> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<TraceDataRequest>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<TraceDataRequest> CreateTraceDataRequest(
+    flatbuffers::FlatBufferBuilder &_fbb) {
+  TraceDataRequestBuilder builder_(_fbb);
+  return builder_.Finish();
+}
+
+struct TraceData FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  typedef TraceDataBuilder Builder;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_RECORDS = 4,
+    VT_STRINGS = 6,
+    VT_NUM_DROPPED = 8,
+    VT_LAST = 10
+  };
+  const flatbuffers::Vector<uint8_t> *records() const {
+    return GetPointer<const flatbuffers::Vector<uint8_t> *>(VT_RECORDS);
+  }
+  const flatbuffers::Vector<int8_t> *strings() const {
+    return GetPointer<const flatbuffers::Vector<int8_t> *>(VT_STRINGS);
+  }
+  uint32_t num_dropped() const {
+    return GetField<uint32_t>(VT_NUM_DROPPED, 0);
+  }
+  bool last() const {
+    return GetField<uint8_t>(VT_LAST, 0) != 0;
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_RECORDS) &&
+           verifier.VerifyVector(records()) &&
+           VerifyOffset(verifier, VT_STRINGS) &&
+           verifier.VerifyVector(strings()) &&
+           VerifyField<uint32_t>(verifier, VT_NUM_DROPPED) &&
+           VerifyField<uint8_t>(verifier, VT_LAST) &&
+           verifier.EndTable();
+  }
+};
+
+struct TraceDataBuilder {
+  typedef TraceData Table;
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_records(flatbuffers::Offset<flatbuffers::Vector<uint8_t>> records) {
+    fbb_.AddOffset(TraceData::VT_RECORDS, records);
+  }
+  void add_strings(flatbuffers::Offset<flatbuffers::Vector<int8_t>> strings) {
+    fbb_.AddOffset(TraceData::VT_STRINGS, strings);
+  }
+  void add_num_dropped(uint32_t num_dropped) {
+    fbb_.AddElement<uint32_t>(TraceData::VT_NUM_DROPPED, num_dropped, 0);
+  }
+  void add_last(bool last) {
+    fbb_.AddElement<uint8_t>(TraceData::VT_LAST, static_cast<uint8_t>(last), 0);
+  }
+  explicit TraceDataBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  TraceDataBuilder &operator=(const TraceDataBuilder &);
+  flatbuffers::Offset<TraceData> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<TraceData>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<TraceData> CreateTraceData(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> records = 0,
+    flatbuffers::Offset<flatbuffers::Vector<int8_t>> strings = 0,
+    uint32_t num_dropped = 0,
+    bool last = false) {
+  TraceDataBuilder builder_(_fbb);
+  builder_.add_num_dropped(num_dropped);
+  builder_.add_strings(strings);
+  builder_.add_records(records);
+  builder_.add_last(last);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<TraceData> CreateTraceDataDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    const std::vector<uint8_t> *records = nullptr,
+    const std::vector<int8_t> *strings = nullptr,
+    uint32_t num_dropped = 0,
+    bool last = false) {
+  auto records__ = records ? _fbb.CreateVector<uint8_t>(*records) : 0;
+  auto strings__ = strings ? _fbb.CreateVector<int8_t>(*strings) : 0;
+  return chre::fbs::CreateTraceData(
+      _fbb,
+      records__,
+      strings__,
+      num_dropped,
+      last);
+}
+
 /// The top-level container that encapsulates all possible messages. Note that
 /// per FlatBuffers requirements, we can't use a union as the top-level
 /// structure (root type), so we must wrap it in a table.
@@ -2900,6 +3166,15 @@ struct MessageContainer FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   const chre::fbs::MessageDeliveryStatus *message_as_MessageDeliveryStatus() const {
     return message_type() == chre::fbs::ChreMessage::MessageDeliveryStatus ? static_cast<const chre::fbs::MessageDeliveryStatus *>(message()) : nullptr;
   }
+  const chre::fbs::NanoappMessageBatch *message_as_NanoappMessageBatch() const {
+    return message_type() == chre::fbs::ChreMessage::NanoappMessageBatch ? static_cast<const chre::fbs::NanoappMessageBatch *>(message()) : nullptr;
+  }
+  const chre::fbs::TraceDataRequest *message_as_TraceDataRequest() const {
+    return message_type() == chre::fbs::ChreMessage::TraceDataRequest ? static_cast<const chre::fbs::TraceDataRequest *>(message()) : nullptr;
+  }
+  const chre::fbs::TraceData *message_as_TraceData() const {
+    return message_type() == chre::fbs::ChreMessage::TraceData ? static_cast<const chre::fbs::TraceData *>(message()) : nullptr;
+  }
   /// The originating or destination client ID on the host side, used to direct
   /// responses only to the client that sent the request. Although initially
   /// populated by the requesting client, this is enforced to be the correct
@@ -3047,6 +3322,18 @@ template<> inline const chre::fbs::MessageDeliveryStatus *MessageContainer::mess
   return message_as_MessageDeliveryStatus();
 }
 
+template<> inline const chre::fbs::NanoappMessageBatch *MessageContainer::message_as<chre::fbs::NanoappMessageBatch>() const {
+  return message_as_NanoappMessageBatch();
+}
+
+template<> inline const chre::fbs::TraceDataRequest *MessageContainer::message_as<chre::fbs::TraceDataRequest>() const {
+  return message_as_TraceDataRequest();
+}
+
+template<> inline const chre::fbs::TraceData *MessageContainer::message_as<chre::fbs::TraceData>() const {
+  return message_as_TraceData();
+}
+
 struct MessageContainerBuilder {
   typedef MessageContainer Table;
   flatbuffers::FlatBufferBuilder &fbb_;
@@ -3219,6 +3506,18 @@ inline bool VerifyChreMessage(flatbuffers::Verifier &verifier, const void *obj,
       auto ptr = reinterpret_cast<const chre::fbs::MessageDeliveryStatus *>(obj);
       return verifier.VerifyTable(ptr);
     }
+    case ChreMessage::NanoappMessageBatch: {
+      auto ptr = reinterpret_cast<const chre::fbs::NanoappMessageBatch *>(obj);
+      return verifier.VerifyTable(ptr);
+    }
+    case ChreMessage::TraceDataRequest: {
+      auto ptr = reinterpret_cast<const chre::fbs::TraceDataRequest *>(obj);
+      return verifier.VerifyTable(ptr);
+    }
+    case ChreMessage::TraceData: {
+      auto ptr = reinterpret_cast<const chre::fbs::TraceData *>(obj);
+      return verifier.VerifyTable(ptr);
+    }
     default: return true;
   }
 }
@@ -24,6 +24,7 @@
 #include "chre/core/settings.h"
 #include "chre/platform/shared/generated/host_messages_generated.h"
 #include "chre/platform/shared/host_protocol_common.h"
+#include "chre/platform/shared/trace_buffer.h"
 #include "chre/util/dynamic_vector.h"
 #include "chre/util/flatbuffers/helpers.h"
 #include "chre_api/chre/event.h"
@@ -32,6 +33,7 @@
 namespace chre {
 
 typedef flatbuffers::Offset<fbs::NanoappListEntry> NanoappListEntryOffset;
+typedef flatbuffers::Offset<fbs::NanoappMessage> NanoappMessageOffset;
 
 /**
  * Checks that a string encapsulated as a byte vector is null-terminated, and
@@ -59,6 +61,8 @@ class HostMessageHandlers {
     UniquePtr<Nanoapp> nanoapp;
     uint32_t fragmentId;
     bool sendFragmentResponse;
+    uint32_t fragmentWindowSize;
+    bool binaryResident;
   };
 
   static void handleNanoappMessage(uint64_t appId, uint32_t messageType,
@@ -83,7 +87,8 @@ class HostMessageHandlers {
       uint16_t hostClientId, uint32_t transactionId, uint64_t appId,
       uint32_t appVersion, uint32_t appFlags, uint32_t targetApiVersion,
       const void *buffer, size_t bufferLen, const char *appFileName,
-      uint32_t fragmentId, size_t appBinaryLen, bool respondBeforeStart);
+      uint32_t fragmentId, size_t appBinaryLen, bool respondBeforeStart,
+      uint32_t fragmentWindowSize, uint64_t appBinaryHash);
 
   static void handleUnloadNanoappRequest(uint16_t hostClientId,
                                          uint32_t transactionId, uint64_t appId,
@@ -100,10 +105,13 @@ class HostMessageHandlers {
 
   static void handleNanConfigurationUpdate(bool enabled);
 
+  static void handleTraceDataRequest(uint16_t hostClientId);
+
  private:
   static void sendFragmentResponse(uint16_t hostClientId,
                                    uint32_t transactionId, uint32_t fragmentId,
-                                   bool success);
+                                   bool success, uint32_t fragmentWindowSize,
+                                   bool binaryResident = false);
 
   static void finishLoadingNanoappCallback(
       SystemCallbackType type, UniquePtr<LoadNanoappCallbackData> &&cbData);
@@ -123,6 +131,10 @@ class HostMessageHandlers {
    * @param bufferLen the size of buffer in bytes
    * @param fragmentId the identifier indicating which fragment is being loaded
    * @param appBinaryLen the full size of the nanoapp binary to be loaded
+   * @param fragmentWindowSize the number of fragments the host may send
+   *     without waiting for their responses, 0 if it waits for each one
+   * @param appBinaryHash the hash of the whole binary given by the host, or 0
+   *     if the binary isn't to be retained across CHRE restarts
    *
    * @return void
    */
@@ -131,7 +143,9 @@ class HostMessageHandlers {
                               uint32_t appFlags, uint32_t targetApiVersion,
                               const void *buffer, size_t bufferLen,
                               uint32_t fragmentId, size_t appBinaryLen,
-                              bool respondBeforeStart);
+                              bool respondBeforeStart,
+                              uint32_t fragmentWindowSize,
+                              uint64_t appBinaryHash);
 };
 
 /**
@@ -140,6 +154,10 @@ class HostMessageHandlers {
  */
 class HostProtocolChre : public HostProtocolCommon {
  public:
+  //! The maximum number of records encoded by encodeTraceData(), which keeps
+  //! the labels and groups it references addressable by 16-bit offsets.
+  static constexpr size_t kMaxTraceRecordsPerMessage = 32;
+
   /**
    * Verifies and decodes a FlatBuffers-encoded CHRE message.
    *
@@ -206,6 +224,40 @@ class HostProtocolChre : public HostProtocolCommon {
       DynamicVector<NanoappListEntryOffset> &offsetVector,
       uint16_t hostClientId);
 
+  /**
+   * Supports construction of a NanoappMessageBatch by adding a single
+   * NanoappMessage to the batch. The offset for the newly added message is
+   * maintained in the given vector until finishNanoappMessageBatch() is called.
+   * Messages are delivered to the host in the order they were added.
+   *
+   * @param builder A ChreFlatBufferBuilder to use for encoding the message
+   * @param offsetVector A vector to track the offset to the newly added
+   *        NanoappMessage, which will be passed to finishNanoappMessageBatch()
+   *        once all messages are added
+   *
+   * @see HostProtocolCommon::encodeNanoappMessage() for the other parameters
+   */
+  static void addNanoappMessageToBatch(
+      ChreFlatBufferBuilder &builder,
+      DynamicVector<NanoappMessageOffset> &offsetVector, uint64_t appId,
+      uint32_t messageType, uint16_t hostEndpoint, const void *messageData,
+      size_t messageDataLen, uint32_t permissions, uint32_t messagePermissions,
+      bool wokeHost);
+
+  /**
+   * Finishes encoding a NanoappMessageBatch after all NanoappMessage elements
+   * have already been added to the builder.
+   *
+   * @param builder The ChreFlatBufferBuilder used with
+   *        addNanoappMessageToBatch()
+   * @param offsetVector The vector used with addNanoappMessageToBatch()
+   *
+   * @see addNanoappMessageToBatch()
+   */
+  static void finishNanoappMessageBatch(
+      ChreFlatBufferBuilder &builder,
+      DynamicVector<NanoappMessageOffset> &offsetVector);
+
   /**
    * Encodes a response to the host indicating CHRE is up running.
    */
@@ -218,7 +270,9 @@ class HostProtocolChre : public HostProtocolCommon {
   static void encodeLoadNanoappResponse(ChreFlatBufferBuilder &builder,
                                         uint16_t hostClientId,
                                         uint32_t transactionId, bool success,
-                                        uint32_t fragmentId);
+                                        uint32_t fragmentId,
+                                        uint32_t fragmentWindowSize = 0,
+                                        bool binaryResident = false);
 
   /**
    * Encodes a response to the host communicating the result of dynamically
@@ -250,6 +304,20 @@ class HostProtocolChre : public HostProtocolCommon {
                                   const uint8_t *logBuffer, size_t bufferSize,
                                   uint32_t numLogsDropped);
 
+  /**
+   * Encodes trace records read from the TraceBuffer into a TraceData message.
+   *
+   * @param records the records of one thread, oldest first
+   * @param numRecords the number of records, up to kMaxTraceRecordsPerMessage
+   * @param threadIndex the index of the thread which recorded them
+   * @param numDropped the number of records dropped since the last request
+   * @param last true if this is the last TraceData message for the request
+   */
+  static void encodeTraceData(ChreFlatBufferBuilder &builder,
+                              uint16_t hostClientId, const TraceRecord *records,
+                              size_t numRecords, uint8_t threadIndex,
+                              uint32_t numDropped, bool last);
+
   /**
    * Encodes a string into a DebugDumpData message.
    *
@@ -17,6 +17,7 @@
 #ifndef CHRE_PLATFORM_SHARED_HOST_PROTOCOL_COMMON_H_
 #define CHRE_PLATFORM_SHARED_HOST_PROTOCOL_COMMON_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "chre/util/system/napp_permissions.h"
@@ -46,6 +47,16 @@ constexpr uint16_t kHostClientIdUnspecified = 0;
  */
 class HostProtocolCommon {
  public:
+  //! Upper bound on the encoded size of a NanoappMessage in a MessageContainer,
+  //! excluding the message payload. Used to size the FlatBufferBuilder so that
+  //! encoding a message doesn't reallocate.
+  static constexpr size_t kNanoappMessageEncodingOverhead = 88;
+
+  //! Upper bound on the encoded size of a NanoappMessageBatch in a
+  //! MessageContainer, excluding the messages it holds. Each message in the
+  //! batch adds at most kNanoappMessageEncodingOverhead plus its payload.
+  static constexpr size_t kNanoappMessageBatchEncodingOverhead = 56;
+
   /**
    * Encodes a message between a nanoapp and a host (in both directions) using
    * the given FlatBufferBuilder and supplied parameters.
@@ -24,6 +24,7 @@
 #include "chre/core/event.h"
 #include "chre/platform/mutex.h"
 #include "chre/platform/shared/bt_snoop_log.h"
+#include "chre/platform/shared/deferred_log_format.h"
 #include "chre/platform/shared/generated/host_messages_generated.h"
 
 namespace chre {
@@ -111,6 +112,25 @@ class LogBuffer {
   //! instanceId field.
   static constexpr size_t kNanoappTokenizedLogOffset = 3;
 
+  //! The number of bytes in a deferred format string log entry of the buffer
+  //! after the 'header' and before the format index. The value indicates the
+  //! size of the uint8_t logSize field.
+  static constexpr size_t kDeferredLogOffset = 1;
+
+  /**
+   * The arguments of a printf style log captured by captureDeferredLog(), so
+   * that the log can be formatted by the host. See LogType::DEFERRED_STRING.
+   */
+  struct DeferredLog {
+    const char *format;
+    //! The size of the format string, including the null terminator.
+    size_t formatSize;
+    uint32_t formatHash;
+    //! The arguments in the format described in host_messages.fbs.
+    size_t argsSize;
+    uint8_t args[kLogMaxSize];
+  };
+
   /**
    * @param callback The callback object that will receive notifications about
    *                 the state of the log buffer or nullptr if it is not needed.
@@ -171,6 +191,38 @@ class LogBuffer {
                                  uint32_t timestampMs, uint16_t instanceId,
                                  const uint8_t *log, size_t logSize);
 
+  /**
+   * Captures the arguments of a printf style log so that formatting it can be
+   * deferred to the host. This only scans the format string for conversions,
+   * which is much cheaper than formatting the log.
+   *
+   * @param logFormat The ASCII log format, which must remain valid until the
+   *        log is passed to handleDeferredLog().
+   * @param args The arguments in a va_list type.
+   * @param log Populated with the captured log.
+   * @return false if the log can't be deferred because it's too large or uses
+   *         a conversion that isn't supported, in which case handleLogVa()
+   *         should be used instead.
+   */
+  static bool captureDeferredLog(const char *logFormat, va_list args,
+                                 DeferredLog *log);
+
+  /**
+   * @return The maximum size of the log payload buffered for this log by
+   *         handleDeferredLog(), excluding the kDeferredLogOffset overhead.
+   */
+  static size_t getDeferredLogMaxSize(const DeferredLog &log) {
+    return 1 /* format index */ + log.formatSize + log.argsSize;
+  }
+
+  /**
+   * Adds a log captured by captureDeferredLog() to the buffer and determines
+   * whether to send log buffer to host. The format string is only written to
+   * the buffer the first time it is used after the buffer was emptied.
+   */
+  void handleDeferredLog(LogBufferLogLevel logLevel, uint32_t timestampMs,
+                         const DeferredLog &log);
+
 #ifdef CHRE_BLE_SUPPORT_ENABLED
   /**
    * Similar to handleLog but buffer a BT snoop log.
@@ -219,14 +271,24 @@ class LogBuffer {
    * Transfer all data from one log buffer to another. The destination log
    * buffer must have equal or greater capacity than this buffer. The
    * otherBuffer will be reset prior to this buffer's data being transferred to
-   * it and after the transfer this buffer will be reset. This method is
-   * thread-safe and will ensure that logs are kept in FIFO ordering during a
-   * transfer operation.
+   * it and after the transfer this buffer will be reset. Any logs still in
+   * otherBuffer are discarded and counted in its number of logs dropped. This
+   * method is thread-safe and will ensure that logs are kept in FIFO ordering
+   * during a transfer operation.
    *
    * @param otherBuffer The log buffer that is transferred to.
    */
   void transferTo(LogBuffer &otherBuffer);
 
+  /**
+   * Rearranges the data in the buffer in place so that the oldest log starts
+   * at the beginning of the data returned by getBufferData(), making all logs
+   * contiguous in the same format that transferTo() produces. Thread safe, but
+   * should only be used on a buffer that isn't receiving new logs, as it takes
+   * time linear in the buffer size.
+   */
+  void linearize();
+
   /**
    * Update the current log buffer notification setting which will determine
    * when the platform is notified to copy logs out of the buffer. Thread-safe.
@@ -248,6 +310,14 @@ class LogBuffer {
    */
   void reset();
 
+  /**
+   * Thread safe.
+   *
+   * Same as reset(), but the log entries that were in the buffer become the
+   * number of logs dropped, for use when those logs won't be sent.
+   */
+  void discardLogs();
+
   /**
    * The data inside the buffer that is returned may be altered by
    * another thread so it is up to the calling code to ensure that race
@@ -326,6 +396,12 @@ class LogBuffer {
    */
   void resetLocked();
 
+  /**
+   * @return The number of log entries currently in the buffer. Requires that
+   *         the lock already be held.
+   */
+  size_t countLogsLocked();
+
   /**
    * Get next index indicating the start of a log entry from the starting
    * index of a previous log entry.
@@ -364,6 +440,58 @@ class LogBuffer {
    */
   void discardExcessOldLogsLocked(uint8_t currentLogLen);
 
+  /**
+   * Removes the log at the head of the buffer. This function must only be
+   * called with the log buffer mutex locked.
+   */
+  void discardOldestLogLocked();
+
+  /**
+   * Finds the index of the format string of a deferred log, if it was written
+   * to the buffer. This function must only be called with the log buffer mutex
+   * locked.
+   *
+   * @return true if the format string is in the buffer and formatIndex was
+   *         set.
+   */
+  bool findDeferredLogFormatLocked(const DeferredLog &log,
+                                   uint8_t *formatIndex);
+
+  /**
+   * Assigns an index to the format string of a deferred log that is about to
+   * be written to the buffer by a log starting at the tail of the buffer,
+   * replacing the oldest assignment if all indices are in use. This function
+   * must only be called with the log buffer mutex locked.
+   */
+  uint8_t addDeferredLogFormatLocked(const DeferredLog &log);
+
+  /**
+   * Handles the log at the head of the buffer being removed if it defines a
+   * deferred log format string. If later logs still reference the format
+   * string, it is moved into the first of them so that they remain decodable,
+   * and only the rest of the head log is removed. Otherwise, the format
+   * string is forgotten. This function must only be called with the log buffer
+   * mutex locked.
+   *
+   * @param logSize The size of the log at the head of the buffer.
+   *
+   * @return true if the format string was moved, in which case the head of
+   *         the buffer was already advanced.
+   */
+  bool moveDeferredLogFormatLocked(size_t logSize);
+
+  /**
+   * Rotates a range of the circular buffer left by the given number of bytes.
+   * This function must only be called with the log buffer mutex locked.
+   */
+  void rotateLeftLocked(size_t startIndex, size_t size, size_t shift);
+
+  /**
+   * Forget all deferred log format strings written to the buffer. This
+   * function must only be called with the log buffer mutex locked.
+   */
+  void clearDeferredLogFormatsLocked();
+
   /**
    * Add an encoding header to the log message if the encoding param is true.
    * This function must only be called with the log buffer mutex locked.
@@ -449,6 +577,20 @@ class LogBuffer {
   //! The number of bytes that will trigger the threshold notification
   size_t mNotificationThresholdBytes = 0;
 
+  //! The hashes of the deferred log format strings in the buffer, indexed by
+  //! the format index used in the logs.
+  uint32_t mDeferredLogFormatHashes[kDeferredLogMaxFormats];
+  //! The format string pointers the hashes were computed from.
+  const char *mDeferredLogFormatPointers[kDeferredLogMaxFormats];
+  //! The buffer index of the log that defined each format string.
+  size_t mDeferredLogFormatLogIndices[kDeferredLogMaxFormats];
+  //! Bitmask of the valid entries of the arrays above.
+  uint32_t mDeferredLogFormatsValid = 0;
+  static_assert(kDeferredLogMaxFormats <= 32,
+                "Valid deferred log formats must fit in the bitmask");
+  //! The format index to replace next once all indices are in use
+  uint8_t mNextDeferredLogFormatIndex = 0;
+
   // TODO(srok): Optimize the locking scheme
   //! The mutex guarding all thread safe operations.
   Mutex mLock;
@@ -23,6 +23,7 @@
 #include "chre/platform/shared/bt_snoop_log.h"
 #include "chre/platform/shared/generated/host_messages_generated.h"
 #include "chre/platform/shared/log_buffer.h"
+#include "chre/platform/shared/log_double_buffer.h"
 #include "chre/util/singleton.h"
 #include "chre_api/chre/re.h"
 
@@ -39,13 +40,13 @@ using LogType = fbs::LogType;
  * is not available and then send them off when the host becomes available. Uses
  * the LogBuffer API to buffer the logs in memory.
  *
- * The manager uses two LogBuffer objects to handle flushing logs to the host at
- * the same time as handling more incoming logs. Incoming logs are always put
- * into the primary buffer first. The secondary buffer takes all the logs
- * currently in the primary buffer before the logs are sent off to the host
- * because the secondary buffer is the memory location passed to the
- * HostLink::sendLogs API. Logs are also flushed to the secondary buffer from
- * the primary buffer when the primary buffer fills up.
+ * The manager uses two LogBuffer objects, via LogDoubleBuffer, to handle
+ * flushing logs to the host at the same time as handling more incoming logs.
+ * Incoming logs are always put into the active buffer. The active buffer is
+ * retired before the logs are sent off to the host, and the retired buffer is
+ * the memory location passed to the HostLink::sendLogs API. The active buffer
+ * is also retired when it fills up. See LogDoubleBuffer for how retiring works
+ * with and without CHRE_LOG_BUFFER_SWAP_ENABLED.
  *
  * When implementing this class in platform code. Use the singleton defined
  * after this class and pass logs to the log or logVa methods. Initialize the
@@ -56,9 +57,8 @@ class LogBufferManager : public LogBufferCallbackInterface {
  public:
   LogBufferManager(uint8_t *primaryBufferData, uint8_t *secondaryBufferData,
                    size_t bufferSize)
-      : mPrimaryLogBuffer(this, primaryBufferData, bufferSize),
-        mSecondaryLogBuffer(nullptr /* callback */, secondaryBufferData,
-                            bufferSize) {}
+      : mLogBuffers(this, primaryBufferData, secondaryBufferData, bufferSize) {
+  }
 
   ~LogBufferManager() = default;
 
@@ -138,8 +138,8 @@ class LogBufferManager : public LogBufferCallbackInterface {
   LogBufferLogLevel chreToLogBufferLogLevel(chreLogLevel chreLogLevel);
 
   /**
-   * Perform any setup needed by the plaform before the secondary buffer is
-   * used.
+   * Perform any setup needed by the plaform before the secondary (retired)
+   * buffer is used.
    *
    * Implemented by the platform.
    */
@@ -157,8 +157,18 @@ class LogBufferManager : public LogBufferCallbackInterface {
 
   void bufferOverflowGuard(size_t logSize, LogType type);
 
-  LogBuffer mPrimaryLogBuffer;
-  LogBuffer mSecondaryLogBuffer;
+#ifdef CHRE_LOG_DEFERRED_FORMAT_ENABLED
+  /**
+   * Buffers a printf-style log as a deferred format string log, leaving the
+   * formatting to the host.
+   *
+   * @return false if the log can't be deferred and must be formatted instead.
+   */
+  bool logDeferredVa(chreLogLevel logLevel, const char *formatStr,
+                     va_list args);
+#endif  // CHRE_LOG_DEFERRED_FORMAT_ENABLED
+
+  LogDoubleBuffer mLogBuffers;
 
   size_t mNumLogsDroppedTotal = 0;
 
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_PLATFORM_SHARED_LOG_DOUBLE_BUFFER_H_
+#define CHRE_PLATFORM_SHARED_LOG_DOUBLE_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chre/platform/atomic.h"
+#include "chre/platform/condition_variable.h"
+#include "chre/platform/mutex.h"
+#include "chre/platform/shared/log_buffer.h"
+#include "chre/util/non_copyable.h"
+
+namespace chre {
+
+/**
+ * A pair of LogBuffers where producers always write into the active buffer
+ * while a single flushing thread reads logs out of the retired buffer.
+ *
+ * When CHRE_LOG_BUFFER_SWAP_ENABLED is defined, retiring the active buffer
+ * exchanges the roles of the two buffers by flipping an index and waiting for
+ * writes already in progress on the old buffer to complete. Producers never
+ * wait on a copy of the buffered logs, and the flushing thread can read the
+ * retired buffer without holding any lock producers need. This requires both
+ * buffers to be writable from every context that logs.
+ *
+ * Otherwise, the logs are copied from the primary buffer (which is always the
+ * active one) into the secondary buffer via LogBuffer::transferTo(), which
+ * allows the platform to place the secondary buffer in memory that isn't
+ * always accessible.
+ *
+ * Notifications from the underlying LogBuffers are forwarded to the callback
+ * supplied at construction after the producer has finished writing, so the
+ * callback may retire the active buffer.
+ */
+class LogDoubleBuffer : public LogBufferCallbackInterface, public NonCopyable {
+ public:
+  /**
+   * Gives a producer access to the active buffer for the lifetime of this
+   * object. The buffer it refers to won't be retired until it is destroyed,
+   * so it should only be held for the duration of a single log call.
+   */
+  class Writer : public NonCopyable {
+   public:
+    explicit Writer(LogDoubleBuffer &logBuffers);
+    ~Writer();
+
+    LogBuffer *operator->() {
+      return &mLogBuffers.mBuffers[mIndex];
+    }
+
+   private:
+    LogDoubleBuffer &mLogBuffers;
+    uint32_t mIndex;
+  };
+
+  /**
+   * @param callback The callback to notify when logs are ready, or nullptr.
+   * @param primaryBufferData The memory for the buffer that's initially
+   *        active.
+   * @param secondaryBufferData The memory for the buffer that's initially
+   *        retired.
+   * @param bufferSize The size of each of the two buffers.
+   */
+  LogDoubleBuffer(LogBufferCallbackInterface *callback,
+                  void *primaryBufferData, void *secondaryBufferData,
+                  size_t bufferSize);
+
+  /**
+   * Moves the logs in the active buffer into the retired buffer, discarding
+   * any logs that were left in the retired buffer. Discarded logs are counted
+   * as dropped by the retired buffer no later than the next retire. Must only
+   * be called by one thread at a time, and not while the retired buffer is
+   * being read.
+   */
+  void retireActiveBuffer();
+
+  /**
+   * @return The buffer holding the logs that were last retired. Must only be
+   *         used by the thread calling retireActiveBuffer(). Call
+   *         LogBuffer::linearize() before reading its data directly.
+   */
+  LogBuffer &getRetiredBuffer();
+
+  /**
+   * @return The number of bytes buffered in the active buffer. As producers
+   *         may be writing concurrently, this is only a snapshot.
+   */
+  size_t getActiveBufferSize();
+
+  /**
+   * @see LogBuffer::logWouldCauseOverflow. As producers may be writing
+   * concurrently, this is only a hint.
+   */
+  bool activeLogWouldCauseOverflow(size_t logSize);
+
+  /**
+   * Overrides required method from LogBufferCallbackInterface.
+   */
+  void onLogsReady() final;
+
+ private:
+  //! Releases a producer's reference to the buffer at the given index, waking
+  //! up retireActiveBuffer() if it's waiting for this buffer.
+  void releaseWriter(uint32_t index);
+
+  LogBufferCallbackInterface *mCallback;
+
+  LogBuffer mBuffers[2];
+
+  //! The index of the buffer producers write into. Only modified by
+  //! retireActiveBuffer().
+  AtomicUint32 mActiveIndex{0};
+
+  //! The number of Writers referencing each buffer.
+  AtomicUint32 mNumWriters[2] = {0, 0};
+
+  //! Set when a buffer requested a notification, which is delivered once the
+  //! Writer that triggered it is released.
+  AtomicBool mLogsReadyPending{false};
+
+  //! Used by retireActiveBuffer() to wait for Writers of the retired buffer.
+  Mutex mWritersMutex;
+  ConditionVariable mWritersDoneCondition;
+};
+
+}  // namespace chre
+
+#endif  // CHRE_PLATFORM_SHARED_LOG_DOUBLE_BUFFER_H_
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_PLATFORM_SHARED_NANOAPP_BINARY_CACHE_H_
+#define CHRE_PLATFORM_SHARED_NANOAPP_BINARY_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chre/platform/mutex.h"
+#include "chre/util/non_copyable.h"
+
+namespace chre {
+
+/**
+ * Retains the binaries of nanoapps loaded by the host in a memory region that
+ * survives CHRE restarts, so that the host doesn't need to send them again
+ * after a restart. See LoadNanoappRequest::app_binary_hash in
+ * host_messages.fbs.
+ *
+ * A binary is stored as it is loaded, and is only returned by find() once the
+ * nanoapp was started from it, so a binary which fails to load isn't retained.
+ * Binaries are kept in the order they were stored, and the oldest ones are
+ * evicted when a new binary doesn't fit.
+ *
+ * The region is validated by init() and each binary is checked against its
+ * checksum before it's used, so that a region corrupted or partially written
+ * when CHRE restarted is recovered from rather than trusted.
+ *
+ * The methods may be called from different threads, but the binary returned by
+ * find() is only valid until the next call to startStore().
+ */
+class NanoappBinaryCache : public NonCopyable {
+ public:
+  /**
+   * Uses the given region to retain binaries, keeping the binaries it holds if
+   * it's valid and clearing it otherwise.
+   *
+   * @param region the memory retained across CHRE restarts, aligned to 8 bytes
+   * @param size the size of region in bytes
+   */
+  void init(void *region, size_t size);
+
+  /**
+   * Finds the retained binary of a nanoapp.
+   *
+   * @param appId the ID of the nanoapp
+   * @param appVersion the version of the nanoapp
+   * @param binaryHash the hash given by the host for the binary
+   * @param binaryLen the size of the binary in bytes
+   *
+   * @return the binary, or nullptr if no valid binary matches the arguments
+   */
+  const void *find(uint64_t appId, uint32_t appVersion, uint64_t binaryHash,
+                   size_t binaryLen);
+
+  /**
+   * Starts storing the binary of a nanoapp being loaded, replacing the binary
+   * retained for the same nanoapp if any. Only one binary is stored at a time.
+   *
+   * @return true if the binary is being stored
+   */
+  bool startStore(uint64_t appId, uint32_t appVersion, uint64_t binaryHash,
+                  size_t binaryLen);
+
+  /**
+   * Appends data to the binary being stored. Storing is aborted if the data
+   * doesn't fit in the size given to startStore().
+   */
+  void appendStore(const void *data, size_t size);
+
+  /**
+   * Ends storing the binary, which is aborted if it's incomplete. The binary
+   * is only returned by find() once retain() is called for its nanoapp.
+   */
+  void finishStore();
+
+  /**
+   * Aborts storing the binary, if one is being stored.
+   */
+  void abortStore();
+
+  /**
+   * Retains the binary stored for a nanoapp, which must be called once the
+   * nanoapp was started successfully.
+   */
+  void retain(uint64_t appId);
+
+  /**
+   * Drops the binary stored or retained for a nanoapp, e.g. if it failed to
+   * start.
+   */
+  void drop(uint64_t appId);
+
+ private:
+  struct RegionHeader;
+  struct EntryHeader;
+
+  //! The start of the region given to init(), or nullptr if it's unusable.
+  RegionHeader *mHeader = nullptr;
+
+  //! The entry being written by appendStore(), or nullptr.
+  EntryHeader *mStoreEntry = nullptr;
+
+  //! The number of bytes of the binary of mStoreEntry written so far.
+  size_t mStoreSize = 0;
+
+  //! Serializes access to the region.
+  Mutex mMutex;
+
+  EntryHeader *firstEntry() const;
+  EntryHeader *endEntry() const;
+  static EntryHeader *nextEntry(EntryHeader *entry);
+  static uint8_t *getBinary(EntryHeader *entry);
+  static uint32_t computeHeaderChecksum(const EntryHeader *entry);
+
+  /**
+   * Removes dropped entries, moving the following ones down.
+   */
+  void compact();
+
+  /**
+   * Drops all entries of a nanoapp.
+   */
+  void dropEntries(uint64_t appId);
+
+  /**
+   * Initializes the region so that it holds no binaries.
+   */
+  void clear(size_t size);
+};
+
+/**
+ * Provides the memory retained across CHRE restarts which holds the binaries
+ * of the NanoappBinaryCache used by the host link. Must be implemented by
+ * platforms defining CHRE_NANOAPP_BINARY_CACHE_ENABLED.
+ *
+ * @param size populated with the size of the region in bytes
+ *
+ * @return the region, aligned to 8 bytes
+ */
+void *getNanoappBinaryCacheRegion(size_t *size);
+
+}  // namespace chre
+
+#endif  // CHRE_PLATFORM_SHARED_NANOAPP_BINARY_CACHE_H_
@@ -21,9 +21,22 @@
 #include <cstdint>
 
 #include "chre/core/nanoapp.h"
+#include "chre/platform/shared/nanoapp_binary_cache.h"
 #include "chre/util/non_copyable.h"
 #include "chre/util/unique_ptr.h"
 
+//! The number of fragmented load transactions that can be in progress at once.
+//! Each of them holds a buffer for its whole nanoapp binary.
+#ifndef CHRE_NANOAPP_LOAD_MAX_CONCURRENT
+#define CHRE_NANOAPP_LOAD_MAX_CONCURRENT 1
+#endif
+
+//! The largest number of fragments a host may send ahead of the
+//! acknowledgements for a windowed load transaction.
+#ifndef CHRE_NANOAPP_LOAD_MAX_WINDOW_SIZE
+#define CHRE_NANOAPP_LOAD_MAX_WINDOW_SIZE 4
+#endif
+
 namespace chre {
 
 /**
@@ -36,17 +49,45 @@ struct FragmentedLoadInfo {
   uint32_t transactionId;
   //! The next fragment ID that is expected to be received for this transaction.
   uint32_t nextFragmentId;
+  //! The number of fragments the host may send without waiting for their
+  //! responses, or 0 if the host waits for the response to each fragment.
+  uint32_t windowSize;
 };
 
 /**
- * A class which handles loading a (possibly fragmented) nanoapp binary.
+ * A class which handles loading (possibly fragmented) nanoapp binaries.
+ *
+ * Up to CHRE_NANOAPP_LOAD_MAX_CONCURRENT transactions, identified by their
+ * host client ID and transaction ID, can be in progress at once. Windowed
+ * transactions are acknowledged cumulatively: fragments that are duplicates or
+ * arrive ahead of a missing one are ignored rather than failing the
+ * transaction, so the host can resend the fragments after the last one
+ * received in order.
+ *
+ * If CHRE_NANOAPP_BINARY_CACHE_ENABLED is defined, binaries loaded with a hash
+ * are retained in a NanoappBinaryCache across CHRE restarts, and a transaction
+ * for a retained binary is complete without receiving any fragment.
  */
 class NanoappLoadManager : public NonCopyable {
  public:
+  //! The outcome of copyNanoappFragment().
+  enum class FragmentResult : uint8_t {
+    //! The fragment was the next one expected and was copied.
+    ACCEPTED,
+    //! The fragment of a windowed transaction wasn't the next one expected,
+    //! and was dropped without affecting the transaction.
+    IGNORED,
+    //! The fragment couldn't be copied, or didn't match a transaction.
+    FAILED,
+  };
+
   /**
-   * Prepares for a (possibly fragmented) load transaction. If an ongoing
-   * transaction exists, the transaction will be overwritten by the new
-   * incoming transaction.
+   * Prepares for a (possibly fragmented) load transaction. If a transaction
+   * with the same IDs exists, or no more transactions can be started, it must
+   * be abandoned first. See getTransactionToReplace().
+   *
+   * If the binary cache retains the binary, the nanoapp is loaded from it and
+   * the transaction is complete when this returns, see isLoadComplete().
    *
    * @param hostClientId the ID of client that originated this transaction
    * @param transactionId the ID of the transaction
@@ -55,16 +96,31 @@ class NanoappLoadManager : public NonCopyable {
    * @param appFlags the flags provided by the app being loaded
    * @param totalBinaryLen the total nanoapp binary length
    * @param targetApiVersion the target API version of the nanoapp to load
+   * @param windowSize the number of fragments the host may send without
+   *        waiting for their responses, 0 if it isn't windowed
+   * @param binaryHash the hash of the binary given by the host, or 0 if the
+   *        binary isn't to be retained
    *
    * @return true if the preparation was successful, false otherwise
    */
   bool prepareForLoad(uint16_t hostClientId, uint32_t transactionId,
                       uint64_t appId, uint32_t appVersion, uint32_t appFlags,
-                      size_t totalBinaryLen, uint32_t targetApiVersion);
+                      size_t totalBinaryLen, uint32_t targetApiVersion,
+                      uint32_t windowSize = 0, uint64_t binaryHash = 0);
 
   /**
-   * Copies a fragment of a nanoapp binary. If the parameters do not match the
-   * expected load transaction, the transaction is marked as a failure.
+   * Retains the binary stored while loading a nanoapp once the nanoapp was
+   * started, or drops it if the nanoapp failed to start. May be called from a
+   * different thread than the other methods.
+   *
+   * @param appId the ID of the nanoapp
+   * @param started whether the nanoapp was started successfully
+   */
+  void onNanoappStarted(uint64_t appId, bool started);
+
+  /**
+   * Copies a fragment of a nanoapp binary. If the copy fails, the transaction
+   * is marked as a failure.
    *
    * @param hostClientId the ID of client that originated this transaction
    * @param transactionId the ID of the transaction
@@ -72,72 +128,135 @@ class NanoappLoadManager : public NonCopyable {
    * @param buffer the pointer to the buffer binary
    * @param bufferLen the size of the buffer in bytes
    *
-   * @return true if the copy was successful, false otherwise
+   * @return whether the fragment was copied, see FragmentResult
+   */
+  FragmentResult copyNanoappFragment(uint16_t hostClientId,
+                                     uint32_t transactionId,
+                                     uint32_t fragmentId, const void *buffer,
+                                     size_t bufferLen);
+
+  /**
+   * Finds the transaction that must be abandoned via markFailure() before
+   * prepareForLoad() can be called for a new transaction. That's a transaction
+   * with the same IDs, or the least recently active one if the maximum number
+   * of transactions are in progress.
+   *
+   * @param hostClientId the ID of client that originated the new transaction
+   * @param transactionId the ID of the new transaction
+   * @param info populated with the transaction to abandon, if any
+   *
+   * @return true if a transaction must be abandoned
    */
-  bool copyNanoappFragment(uint16_t hostClientId, uint32_t transactionId,
-                           uint32_t fragmentId, const void *buffer,
-                           size_t bufferLen);
+  bool getTransactionToReplace(uint16_t hostClientId, uint32_t transactionId,
+                               FragmentedLoadInfo *info) const;
 
   /**
    * Invalidates an ongoing load transaction. After this method is invoked,
-   * hasPendingLoadTransaction() will return false, and a new transaction must
-   * be started by invoking prepareForLoad.
+   * hasPendingLoadTransaction() will return false for it, and a new
+   * transaction must be started by invoking prepareForLoad.
    */
-  void markFailure() {
-    mNanoapp.reset(nullptr);
-  }
+  void markFailure(uint16_t hostClientId, uint32_t transactionId);
 
   /**
-   * @return true if a pending transaction exists, false otherwise
+   * @return true if the given transaction is in progress, false otherwise
    */
-  bool hasPendingLoadTransaction() const {
-    return !mNanoapp.isNull();
+  bool hasPendingLoadTransaction(uint16_t hostClientId,
+                                 uint32_t transactionId) const {
+    return findTransaction(hostClientId, transactionId) != nullptr;
   }
 
   /**
-   * @return true if a pending transaction exists and the nanoapp is fully
-   *         loaded, false otherwise
+   * @return true if the given transaction is in progress and the nanoapp is
+   *         fully loaded, false otherwise
    */
-  bool isLoadComplete() const {
-    return hasPendingLoadTransaction() && mNanoapp->isLoaded();
+  bool isLoadComplete(uint16_t hostClientId, uint32_t transactionId) const {
+    const LoadTransaction *transaction =
+        findTransaction(hostClientId, transactionId);
+    return transaction != nullptr && transaction->nanoapp->isLoaded();
   }
 
   /**
-   * @return the currently ongoing load transaction, invalid if
-   *         hasPendingLoadTransaction() returns false
+   * @param info populated with the given transaction, if it's in progress
+   *
+   * @return true if the transaction is in progress, false otherwise
    */
-  FragmentedLoadInfo getTransactionInfo() const {
-    return mCurrentLoadInfo;
-  }
+  bool getTransactionInfo(uint16_t hostClientId, uint32_t transactionId,
+                          FragmentedLoadInfo *info) const;
 
   /**
-   * Releases the underlying nanoapp of a currently ongoing load transaction,
-   * regardless of completion status. After this method is called, the ownership
-   * of the nanoapp is transferred to the caller. This method should only be
-   * called if hasPendingLoadTransaction() is true.
+   * Releases the underlying nanoapp of an ongoing load transaction, regardless
+   * of completion status, and ends the transaction. After this method is
+   * called, the ownership of the nanoapp is transferred to the caller.
    *
-   * @return the UniquePtr<Nanoapp> of the ongoing transaction, or null if no
-   *             transaction exists
+   * @return the UniquePtr<Nanoapp> of the transaction, or null if no such
+   *         transaction exists
    */
-  UniquePtr<Nanoapp> releaseNanoapp() {
-    return std::move(mNanoapp);
-  }
+  UniquePtr<Nanoapp> releaseNanoapp(uint16_t hostClientId,
+                                    uint32_t transactionId);
 
  private:
-  //! The currently managed fragmented load.
-  FragmentedLoadInfo mCurrentLoadInfo;
+  //! A fragmented load in progress, or an available slot if nanoapp is null.
+  struct LoadTransaction {
+    FragmentedLoadInfo info;
+
+    //! The underlying nanoapp that is being loaded.
+    UniquePtr<Nanoapp> nanoapp;
+
+    //! The value of mActivityCounter when this transaction last received a
+    //! fragment, used to pick the transaction to replace.
+    uint32_t lastActivity;
+
+    //! Whether the binary is being stored in mBinaryCache as it's copied.
+    bool isStoringBinary;
+  };
+
+  //! The currently managed fragmented loads.
+  LoadTransaction mTransactions[CHRE_NANOAPP_LOAD_MAX_CONCURRENT];
+
+  //! Incremented whenever a transaction is prepared or receives a fragment.
+  uint32_t mActivityCounter = 0;
+
+#ifdef CHRE_NANOAPP_BINARY_CACHE_ENABLED
+  //! Retains the binaries of loaded nanoapps across CHRE restarts.
+  NanoappBinaryCache mBinaryCache;
 
-  //! The underlying nanoapp that is being loaded.
-  UniquePtr<Nanoapp> mNanoapp;
+  //! Whether mBinaryCache was initialized with the platform's region.
+  bool mIsBinaryCacheInitialized = false;
+#endif  // CHRE_NANOAPP_BINARY_CACHE_ENABLED
+
+  LoadTransaction *findTransaction(uint16_t hostClientId,
+                                   uint32_t transactionId);
+  const LoadTransaction *findTransaction(uint16_t hostClientId,
+                                         uint32_t transactionId) const;
 
   /**
    * Validates an incoming fragment against the next expected one. An error is
    * logged if invalid arguments are passed.
    *
-   * @return true if the arguments represent the next fragment, false otherwise
+   * @return ACCEPTED if the arguments represent the next fragment of the
+   *         transaction, otherwise IGNORED or FAILED as described by
+   *         copyNanoappFragment()
+   */
+  FragmentResult validateFragment(const LoadTransaction *transaction,
+                                  uint16_t hostClientId,
+                                  uint32_t transactionId,
+                                  uint32_t fragmentId) const;
+
+  /**
+   * Loads the nanoapp of a transaction being prepared from the binary cache if
+   * it retains the binary, or starts storing the binary in the cache as it's
+   * copied otherwise.
+   *
+   * @return false if the retained binary couldn't be loaded
+   */
+  bool useBinaryCache(LoadTransaction *transaction, uint64_t appId,
+                      uint32_t appVersion, size_t binaryLen,
+                      uint64_t binaryHash);
+
+  /**
+   * Ends the transaction, aborting the storage of its binary if any.
    */
-  bool validateFragment(uint16_t hostClientId, uint32_t transactionId,
-                        uint32_t fragmentId) const;
+  void resetTransaction(LoadTransaction *transaction);
 };
 
 }  // namespace chre
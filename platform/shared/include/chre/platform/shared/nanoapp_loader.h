@@ -24,6 +24,7 @@
 
 #include "chre/util/dynamic_vector.h"
 #include "chre/util/optional.h"
+#include "chre/util/time.h"
 
 namespace chre {
 
@@ -83,6 +84,20 @@ class NanoappLoader {
    */
   static NanoappLoader *create(void *elfInput, bool mapIntoTcm);
 
+  /**
+   * Factory method to create a NanoappLoader instance that maps an ELF binary
+   * while it is received in fragments, so that the binary doesn't need to be
+   * assembled in a buffer of its own. The fragments must be passed in order to
+   * copyFragment(), and the binary opened with finishStreaming() once all of
+   * them were copied.
+   *
+   * @param binaryLen The size of the ELF binary in bytes.
+   * @param mapIntoTcm Indicates whether the elfBinary should be mapped into
+   *     tightly coupled memory.
+   * @return Class instance on success, nullptr otherwise.
+   */
+  static NanoappLoader *createStreaming(size_t binaryLen, bool mapIntoTcm);
+
   /**
    * Closes and destroys the NanoappLoader instance.
    *
@@ -90,6 +105,28 @@ class NanoappLoader {
    */
   static void destroy(NanoappLoader *loader);
 
+  /**
+   * Copies the next fragment of a binary being streamed into the loader. The
+   * ELF and program headers are verified, and the memory the binary is mapped
+   * into allocated, as soon as the headers were received. The content of load
+   * segments is then copied to its final location directly, and only the
+   * parts of the rest of the binary that are needed to open it are kept.
+   *
+   * @param fragment The fragment of the binary.
+   * @param fragmentLen The size of the fragment in bytes.
+   * @return false if the fragment overflowed the binary, the binary failed
+   *     verification, or memory couldn't be allocated.
+   */
+  bool copyFragment(const void *fragment, size_t fragmentLen);
+
+  /**
+   * Opens a binary whose fragments were all passed to copyFragment(). This
+   * resolves symbols and invokes any static initializers, as create() does.
+   *
+   * @return true if all required opening steps were completed.
+   */
+  bool finishStreaming();
+
   /**
    * Attempts to locate the exported symbol specified by the given function
    * name.
@@ -146,6 +183,28 @@ class NanoappLoader {
    */
   void getTokenDatabaseSectionInfo(uint32_t *offset, size_t *size);
 
+  /**
+   * @return the time spent mapping the binary into memory, including the time
+   *     spent in copyFragment() for a streamed binary.
+   */
+  Nanoseconds getLoadTime() const {
+    return mLoadTime;
+  }
+
+  /**
+   * @return the time spent fixing relocations and resolving symbols.
+   */
+  Nanoseconds getRelocationTime() const {
+    return mRelocationTime;
+  }
+
+  /**
+   * @return the time spent invoking the static initializers.
+   */
+  Nanoseconds getInitArrayTime() const {
+    return mInitArrayTime;
+  }
+
  private:
   explicit NanoappLoader(void *elfInput, bool mapIntoTcm) {
     mBinary = static_cast<uint8_t *>(elfInput);
@@ -186,6 +245,19 @@ class NanoappLoader {
   static constexpr const char *kInitArrayName = ".init_array";
   static constexpr const char *kFiniArrayName = ".fini_array";
   static constexpr const char *kTokenTableName = ".pw_tokenizer.entries";
+  static constexpr const char *kRelaDynTableName = ".rela.dyn";
+
+  //! The section names above, which are the only ones that can be looked up
+  //! in a streamed binary.
+  static constexpr size_t kNumStreamedSectionNames = 6;
+  static constexpr const char *kStreamedSectionNames[kNumStreamedSectionNames] =
+      {kDynsymTableName, kDynstrTableName, kInitArrayName,
+       kFiniArrayName,   kTokenTableName,  kRelaDynTableName};
+  //! The number of positions recorded for each of these names while streaming.
+  static constexpr size_t kMaxStreamedSectionNameMatches = 4;
+  //! The size of the window of streamed bytes matched against these names,
+  //! which must hold the longest one.
+  static constexpr size_t kStreamedSectionNameWindowSize = 32;
 
   //! Pointer to the table of all the section names.
   char *mSectionNamesPtr = nullptr;
@@ -201,8 +273,41 @@ class NanoappLoader {
   size_t mDynamicSymbolTableSize = 0;
 
   //! The ELF that is being mapped into the system. This pointer will be invalid
-  //! after open returns.
+  //! after open returns. For a streamed binary, this holds the ELF header and
+  //! the program headers.
   uint8_t *mBinary = nullptr;
+  //! Whether the binary is being streamed in by copyFragment().
+  bool mIsStreaming = false;
+  //! The size of a streamed binary in bytes.
+  size_t mBinaryLen = 0;
+  //! The number of bytes of a streamed binary received so far.
+  size_t mBytesReceived = 0;
+  //! The size of the headers held by mBinary for a streamed binary.
+  size_t mHeadersSize = 0;
+  //! The section names of a streamed binary are received after its load
+  //! segments, along with the symbol table and debug data, and aren't kept.
+  //! Instead, the file offsets of the names that are looked up are recorded
+  //! while the data following the load segments is received, and matched
+  //! against the section names table once the section headers are known.
+  size_t mSectionNameOffsets[kNumStreamedSectionNames]
+                            [kMaxStreamedSectionNameMatches] = {};
+  //! The number of times each looked up name was found while streaming.
+  size_t mNumSectionNameMatches[kNumStreamedSectionNames] = {};
+  //! The last bytes scanned for section names, indexed by file offset.
+  char mSectionNameWindow[kStreamedSectionNameWindowSize] = {};
+  //! The file offset where the scan for section names starts.
+  size_t mSectionNameScanStart = 0;
+  //! The file offset following the last byte scanned for section names.
+  size_t mSectionNameScanEnd = 0;
+  //! The number of contiguous bytes held by mSectionNameWindow.
+  size_t mSectionNameWindowLen = 0;
+  //! The addresses of the dynamic symbols resolved while relocating, indexed
+  //! by their position in the symbol table, so that each symbol is looked up
+  //! once. nullptr if symbols aren't being cached.
+  void **mResolvedSymbolCache = nullptr;
+  //! Whether static initialization ran, so termination functions must be
+  //! invoked when closing.
+  bool mIsOpen = false;
   //! The starting location of the memory that has been mapped into the system.
   uint8_t *mMapping = nullptr;
   //! The span of memory that has been mapped into the system.
@@ -216,6 +321,10 @@ class NanoappLoader {
   DynamicVector<struct AtExitCallback> mAtexitFunctions;
   //! Whether this loader instance is managing a TCM nanoapp binary.
   bool mIsTcmBinary = false;
+  //! See getLoadTime(), getRelocationTime() and getInitArrayTime().
+  Nanoseconds mLoadTime;
+  Nanoseconds mRelocationTime;
+  Nanoseconds mInitArrayTime;
 
   /**
    * Invokes all functions registered via atexit during static initialization.
@@ -234,6 +343,14 @@ class NanoappLoader {
    */
   void callTerminatorArray();
 
+  /**
+   * Resolves symbols and invokes static initializers once the binary has been
+   * mapped into memory.
+   *
+   * @return true if all remaining opening steps were completed.
+   */
+  bool relocateAndInitialize();
+
   /**
    * Allocates memory for all load segments that need to be mapped into virtual
    * memory and copies the load segments into the newly allocated memory.
@@ -243,6 +360,15 @@ class NanoappLoader {
    */
   bool createMappings();
 
+  /**
+   * Allocates memory for all load segments that need to be mapped into virtual
+   * memory, and zeroes the part of each segment that isn't in the binary.
+   *
+   * @return true if the memory for mapping was allocated and the load segments
+   *     were formatted correctly.
+   */
+  bool allocateMappings();
+
   /**
    * Copies various sections and headers from the ELF while verifying that they
    * match the ELF format specification.
@@ -251,6 +377,75 @@ class NanoappLoader {
    */
   bool copyAndVerifyHeaders();
 
+  /**
+   * Allocates the array of section headers.
+   *
+   * @return true if the section headers are valid and were allocated.
+   */
+  bool allocateSectionHeaders();
+
+  /**
+   * Copies the section names table from the ELF and verifies the dynamic
+   * tables. The section headers must have been copied. For a streamed binary,
+   * the section names aren't copied, as only the recorded positions of the
+   * names that are looked up are used.
+   *
+   * @return true if all data was copied and verified.
+   */
+  bool copyAndVerifySectionNames();
+
+  /**
+   * Called when a streamed binary's headers held by mBinary were received.
+   * Once the ELF header is received, mBinary is grown to hold the program
+   * headers. Once those are received, the memory for the mapping is allocated
+   * and the headers are copied into it.
+   *
+   * @return true if the headers passed verification and memory was allocated.
+   */
+  bool onStreamedHeadersReceived();
+
+  /**
+   * Copies data of a streamed binary following its headers to wherever it's
+   * needed: the load segments it belongs to, the section headers, or the tail
+   * buffer. Other data is dropped.
+   *
+   * @param offset The offset of the data in the binary.
+   * @param data The data to copy.
+   * @param size The size of the data in bytes.
+   */
+  void copyStreamedData(size_t offset, const uint8_t *data, size_t size);
+
+  /**
+   * Records where the names of the sections that are looked up appear in the
+   * given data of a streamed binary, which must follow its load segments.
+   *
+   * @param offset The offset in the ELF file of the data.
+   * @param data The data to scan.
+   * @param size The size of the data.
+   */
+  void scanStreamedSectionNames(size_t offset, const uint8_t *data,
+                                size_t size);
+
+  /**
+   * Retrieves the section header of a streamed binary whose name was found
+   * at a recorded position in the section names table.
+   *
+   * @param headerName One of the section names that are looked up.
+   * @return The address of the section. nullptr if not found.
+   */
+  SectionHeader *getStreamedSectionHeader(const char *headerName);
+
+  /**
+   * Retrieves data of the binary by its offset in the ELF file. For a streamed
+   * binary, only data held in the headers or in a load segment can be
+   * retrieved.
+   *
+   * @param offset The offset of the data in the binary.
+   * @param size The size of the data in bytes.
+   * @return The address of the data, or nullptr if it isn't available.
+   */
+  uint8_t *getFileData(size_t offset, size_t size);
+
   /**
    * Resolves all relocated symbols located in the DT_REL table.
    *
@@ -339,7 +534,8 @@ class NanoappLoader {
   /**
    * Resolves the address of an undefined symbol located at the given position
    * in the symbol table. This symbol must be defined and exposed by the given
-   * platform in order for it to be resolved successfully.
+   * platform in order for it to be resolved successfully. Resolved addresses
+   * are cached while relocating.
    *
    * @param posInSymbolTable The position of the undefined symbol in the symbol
    *     table.
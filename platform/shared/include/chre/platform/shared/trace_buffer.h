@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_PLATFORM_SHARED_TRACE_BUFFER_H_
+#define CHRE_PLATFORM_SHARED_TRACE_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chre/platform/atomic.h"
+#include "chre/platform/mutex.h"
+#include "chre/util/non_copyable.h"
+#include "chre/util/singleton.h"
+
+//! The maximum number of threads which can record traces. Records of any
+//! additional thread are dropped.
+#ifndef CHRE_TRACE_BUFFER_MAX_THREADS
+#define CHRE_TRACE_BUFFER_MAX_THREADS 4
+#endif
+
+//! The number of records buffered per thread, which must be a power of two.
+#ifndef CHRE_TRACE_BUFFER_RECORDS_PER_THREAD
+#define CHRE_TRACE_BUFFER_RECORDS_PER_THREAD 128
+#endif
+
+namespace chre {
+
+enum class TraceRecordType : uint8_t {
+  INSTANT = 0,
+  START = 1,
+  END = 2,
+};
+
+/**
+ * A trace recorded by one of the CHRE_TRACE_* macros. The label and group are
+ * string literals, so only their addresses are recorded.
+ */
+struct TraceRecord {
+  uint64_t timestampNs;
+  const char *label;
+  //! nullptr if the trace has no group.
+  const char *group;
+  uint32_t traceId;
+  TraceRecordType type;
+};
+
+/**
+ * Buffers the records of the CHRE_TRACE_* macros until the host reads them.
+ *
+ * Each thread recording traces is given its own ring of records, so recording
+ * only takes a few atomic operations and never blocks, which keeps the
+ * overhead low enough to trace the event loop. A record is dropped when the
+ * ring of its thread is full. The records are read by a single thread at a
+ * time, e.g. the one handling a TraceDataRequest from the host.
+ *
+ * Threads are assigned a ring through a thread_local, which the platform's
+ * toolchain must support. On FreeRTOS, where a thread_local is shared by all
+ * tasks, the ring is kept in two task-local storage pointers instead, starting
+ * at index CHRE_TRACE_BUFFER_TASK_LOCAL_STORAGE_INDEX.
+ */
+class TraceBuffer : public NonCopyable {
+ public:
+  static constexpr size_t kMaxThreads = CHRE_TRACE_BUFFER_MAX_THREADS;
+  static constexpr size_t kRecordsPerThread =
+      CHRE_TRACE_BUFFER_RECORDS_PER_THREAD;
+
+  static_assert(kMaxThreads <= UINT8_MAX,
+                "Thread indices must fit in the TraceData records");
+  static_assert((kRecordsPerThread & (kRecordsPerThread - 1)) == 0,
+                "The number of records per thread must be a power of two");
+
+  TraceBuffer();
+
+  /**
+   * Records a trace in the ring of the calling thread, timestamped with the
+   * current monotonic time.
+   *
+   * @param type the type of the trace
+   * @param label a string literal describing the trace
+   * @param group a string literal grouping traces, or nullptr
+   * @param traceId groups the traces with the same group and ID
+   */
+  void record(TraceRecordType type, const char *label, const char *group,
+              uint32_t traceId);
+
+  /**
+   * @return the number of threads which recorded traces so far, the indices of
+   *         which may be given to read()
+   */
+  size_t getNumThreads() const;
+
+  /**
+   * Removes the oldest records of a thread from the buffer.
+   *
+   * @param threadIndex the index of the thread, less than getNumThreads()
+   * @param records populated with the records, oldest first
+   * @param maxRecords the number of records which fit in records
+   *
+   * @return the number of records populated
+   */
+  size_t read(size_t threadIndex, TraceRecord *records, size_t maxRecords);
+
+  /**
+   * @return the number of records dropped since the last call to this method
+   */
+  uint32_t getAndResetNumDropped();
+
+ private:
+  struct ThreadRing {
+    //! The number of records read and written, wrapping at UINT32_MAX.
+    AtomicUint32 readCount{0};
+    AtomicUint32 writeCount{0};
+    TraceRecord records[kRecordsPerThread];
+  };
+
+  ThreadRing mRings[kMaxThreads];
+
+  //! Distinguishes this buffer from the previous ones, so that threads which
+  //! recorded into a buffer at the same address are assigned a new ring.
+  uint32_t mGeneration;
+
+  //! The number of rings assigned to threads, which may exceed kMaxThreads.
+  AtomicUint32 mNumThreads{0};
+
+  AtomicUint32 mNumDropped{0};
+
+  //! Serializes read().
+  Mutex mReadMutex;
+
+  /**
+   * @return the ring of the calling thread, or nullptr if all rings are used
+   */
+  ThreadRing *getThreadRing();
+};
+
+//! Provides an alias to the TraceBuffer singleton.
+typedef Singleton<TraceBuffer> TraceBufferSingleton;
+
+extern template class Singleton<TraceBuffer>;
+
+/**
+ * Records a trace if the TraceBuffer singleton is initialized. Used by the
+ * CHRE_TRACE_* macros.
+ */
+void recordTrace(TraceRecordType type, const char *label,
+                 const char *group = nullptr, uint32_t traceId = 0);
+
+}  // namespace chre
+
+#endif  // CHRE_PLATFORM_SHARED_TRACE_BUFFER_H_
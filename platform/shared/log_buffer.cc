@@ -17,8 +17,10 @@
 #include "chre/platform/shared/log_buffer.h"
 #include "chre/platform/assert.h"
 #include "chre/platform/shared/generated/host_messages_generated.h"
+#include "chre/util/hash.h"
 #include "chre/util/lock_guard.h"
 
+#include <algorithm>
 #include <cstdarg>
 #include <cstdio>
 
@@ -107,6 +109,145 @@ void LogBuffer::handleNanoappTokenizedLog(LogBufferLogLevel logLevel,
              instanceId);
 }
 
+bool LogBuffer::captureDeferredLog(const char *logFormat, va_list args,
+                                   DeferredLog *log) {
+  // Leave room for the format index and format string in the log payload.
+  const size_t maxArgsSize = kLogMaxSize - kDeferredLogOffset - 1 -
+                             (strnlen(logFormat, kLogMaxSize) + 1);
+  const char *cursor = logFormat;
+  size_t argsSize = 0;
+  bool success = (maxArgsSize < kLogMaxSize);
+
+  auto appendArg = [&](const void *value, size_t size) {
+    if (argsSize + size > maxArgsSize) {
+      success = false;
+    } else {
+      memcpy(&log->args[argsSize], value, size);
+      argsSize += size;
+    }
+  };
+
+  DeferredLogConversion conversion;
+  while (success && getNextDeferredLogConversion(&cursor, &conversion)) {
+    bool isSigned =
+        (conversion.specifier == 'd' || conversion.specifier == 'i');
+    switch (conversion.argType) {
+      case DeferredLogArgType::NONE:
+        break;
+
+      case DeferredLogArgType::INT32: {
+        uint32_t value = isSigned ? static_cast<uint32_t>(va_arg(args, int))
+                                  : va_arg(args, unsigned int);
+        appendArg(&value, sizeof(value));
+        break;
+      }
+
+      case DeferredLogArgType::INT64: {
+        uint64_t value;
+        switch (conversion.start[conversion.modifierOffset]) {
+          case 'j':
+            value = isSigned ? static_cast<uint64_t>(va_arg(args, intmax_t))
+                             : va_arg(args, uintmax_t);
+            break;
+          case 'z':
+            value = va_arg(args, size_t);
+            break;
+          case 't':
+            value = static_cast<uint64_t>(va_arg(args, ptrdiff_t));
+            break;
+          default:
+            if (conversion.modifierLength == 2) {
+              value = isSigned ? static_cast<uint64_t>(va_arg(args, long long))
+                               : va_arg(args, unsigned long long);
+            } else {
+              value = isSigned ? static_cast<uint64_t>(va_arg(args, long))
+                               : va_arg(args, unsigned long);
+            }
+            break;
+        }
+        appendArg(&value, sizeof(value));
+        break;
+      }
+
+      case DeferredLogArgType::DOUBLE: {
+        double value = va_arg(args, double);
+        appendArg(&value, sizeof(value));
+        break;
+      }
+
+      case DeferredLogArgType::POINTER: {
+        uint64_t value = reinterpret_cast<uintptr_t>(va_arg(args, void *));
+        appendArg(&value, sizeof(value));
+        break;
+      }
+
+      case DeferredLogArgType::STRING: {
+        const char *value = va_arg(args, const char *);
+        if (value == nullptr) {
+          value = "(null)";
+        }
+        size_t length = strnlen(value, maxArgsSize);
+        appendArg(value, length + 1);
+        break;
+      }
+
+      default:
+        success = false;
+        break;
+    }
+  }
+
+  if (success) {
+    log->format = logFormat;
+    log->formatSize = static_cast<size_t>(cursor - logFormat) + 1;
+    log->formatHash = fnv1a32Hash(reinterpret_cast<const uint8_t *>(logFormat),
+                                  log->formatSize);
+    log->argsSize = argsSize;
+  }
+  return success;
+}
+
+void LogBuffer::handleDeferredLog(LogBufferLogLevel logLevel,
+                                  uint32_t timestampMs,
+                                  const DeferredLog &log) {
+  {
+    LockGuard<Mutex> lockGuard(mLock);
+
+    uint8_t formatIndex = 0;
+    bool isNewFormat = !findDeferredLogFormatLocked(log, &formatIndex);
+    auto logLen = static_cast<uint8_t>(1 /* format index */ + log.argsSize);
+    if (isNewFormat) {
+      logLen += log.formatSize;
+    }
+
+    discardExcessOldLogsLocked(logLen + kDeferredLogOffset);
+    if (!isNewFormat && !findDeferredLogFormatLocked(log, &formatIndex)) {
+      // The log that defined the format string was just discarded, so the
+      // format string has to be written again.
+      isNewFormat = true;
+      logLen += log.formatSize;
+      discardExcessOldLogsLocked(logLen + kDeferredLogOffset);
+    }
+
+    uint8_t indexField = formatIndex;
+    if (isNewFormat) {
+      indexField =
+          addDeferredLogFormatLocked(log) | kDeferredLogFormatDefinitionFlag;
+    }
+
+    uint8_t metadata = setLogMetadata(LogType::DEFERRED_STRING, logLevel);
+    copyVarToBuffer(&metadata);
+    copyVarToBuffer(&timestampMs);
+    copyVarToBuffer(&logLen);
+    copyVarToBuffer(&indexField);
+    if (isNewFormat) {
+      copyToBuffer(log.formatSize, log.format);
+    }
+    copyToBuffer(log.argsSize, log.args);
+  }
+  dispatch();
+}
+
 size_t LogBuffer::copyLogs(void *destination, size_t size,
                            size_t *numLogsDropped) {
   LockGuard<Mutex> lock(mLock);
@@ -121,6 +262,7 @@ bool LogBuffer::logWouldCauseOverflow(size_t logSize) {
 void LogBuffer::transferTo(LogBuffer &buffer) {
   LockGuard<Mutex> lockGuardOther(buffer.mLock);
   size_t numLogsDropped;
+  size_t numLogsDiscarded = buffer.countLogsLocked();
   size_t bytesCopied;
   {
     LockGuard<Mutex> lockGuardThis(mLock);
@@ -136,7 +278,17 @@ void LogBuffer::transferTo(LogBuffer &buffer) {
   }
   buffer.mBufferDataTailIndex = bytesCopied % buffer.mBufferMaxSize;
   buffer.mBufferDataSize = bytesCopied;
-  buffer.mNumLogsDropped = numLogsDropped;
+  buffer.mNumLogsDropped = numLogsDropped + numLogsDiscarded;
+}
+
+void LogBuffer::linearize() {
+  LockGuard<Mutex> lock(mLock);
+  if (mBufferDataHeadIndex != 0) {
+    std::rotate(mBufferData, &mBufferData[mBufferDataHeadIndex],
+                &mBufferData[mBufferMaxSize]);
+    mBufferDataHeadIndex = 0;
+    mBufferDataTailIndex = mBufferDataSize % mBufferMaxSize;
+  }
 }
 
 void LogBuffer::updateNotificationSetting(LogBufferNotificationSetting setting,
@@ -152,6 +304,13 @@ void LogBuffer::reset() {
   resetLocked();
 }
 
+void LogBuffer::discardLogs() {
+  LockGuard<Mutex> lock(mLock);
+  size_t numLogsDiscarded = countLogsLocked();
+  resetLocked();
+  mNumLogsDropped = numLogsDiscarded;
+}
+
 const uint8_t *LogBuffer::getBufferData() {
   return mBufferData;
 }
@@ -208,16 +367,31 @@ size_t LogBuffer::copyLogsLocked(void *destination, size_t size,
   if (size != 0 && destination != nullptr && mBufferDataSize != 0) {
     if (size >= mBufferDataSize) {
       copySize = mBufferDataSize;
+      copyFromBuffer(copySize, destination);
+      clearDeferredLogFormatsLocked();
     } else {
+      size_t numLogs = 0;
       size_t logSize;
       size_t logStartIndex = getNextLogIndex(mBufferDataHeadIndex, &logSize);
       while (copySize + logSize <= size &&
              copySize + logSize <= mBufferDataSize) {
         copySize += logSize;
+        numLogs++;
         logStartIndex = getNextLogIndex(logStartIndex, &logSize);
       }
+
+      // The logs left in the buffer may reference format strings defined by
+      // the logs copied out, so those definitions are moved rather than
+      // discarded with the logs.
+      size_t headIndex = mBufferDataHeadIndex;
+      size_t dataSize = mBufferDataSize;
+      copyFromBuffer(copySize, destination);
+      mBufferDataHeadIndex = headIndex;
+      mBufferDataSize = dataSize;
+      for (size_t i = 0; i < numLogs; i++) {
+        discardOldestLogLocked();
+      }
     }
-    copyFromBuffer(copySize, destination);
   }
 
   *numLogsDropped = mNumLogsDropped;
@@ -230,6 +404,20 @@ void LogBuffer::resetLocked() {
   mBufferDataTailIndex = 0;
   mBufferDataSize = 0;
   mNumLogsDropped = 0;
+  clearDeferredLogFormatsLocked();
+}
+
+size_t LogBuffer::countLogsLocked() {
+  size_t numLogs = 0;
+  size_t bytesCounted = 0;
+  size_t logStartIndex = mBufferDataHeadIndex;
+  while (bytesCounted < mBufferDataSize) {
+    size_t logSize;
+    logStartIndex = getNextLogIndex(logStartIndex, &logSize);
+    bytesCounted += logSize;
+    numLogs++;
+  }
+  return numLogs;
 }
 
 size_t LogBuffer::getNextLogIndex(size_t startingIndex, size_t *logSize) {
@@ -273,6 +461,10 @@ size_t LogBuffer::getLogDataLength(size_t startingIndex, LogType type) {
       numBytes = mBufferData[currentIndex] + kNanoappTokenizedLogOffset;
       break;
 
+    case LogType::DEFERRED_STRING:
+      numBytes = mBufferData[startingIndex] + kDeferredLogOffset;
+      break;
+
     default:
       CHRE_ASSERT_LOG(false, "Received unexpected log message type");
       break;
@@ -334,12 +526,166 @@ void LogBuffer::discardExcessOldLogsLocked(uint8_t currentLogLen) {
   size_t totalLogSize = kLogDataOffset + currentLogLen;
   while (mBufferDataSize + totalLogSize > mBufferMaxSize) {
     mNumLogsDropped++;
-    size_t logSize;
-    mBufferDataHeadIndex = getNextLogIndex(mBufferDataHeadIndex, &logSize);
+    discardOldestLogLocked();
+  }
+}
+
+void LogBuffer::discardOldestLogLocked() {
+  size_t logSize;
+  size_t nextLogIndex = getNextLogIndex(mBufferDataHeadIndex, &logSize);
+  if (mDeferredLogFormatsValid == 0 ||
+      !moveDeferredLogFormatLocked(logSize)) {
+    mBufferDataHeadIndex = nextLogIndex;
     mBufferDataSize -= logSize;
   }
 }
 
+bool LogBuffer::findDeferredLogFormatLocked(const DeferredLog &log,
+                                            uint8_t *formatIndex) {
+  for (uint8_t i = 0; i < kDeferredLogMaxFormats; i++) {
+    // The hash alone could match a different format string
+    if ((mDeferredLogFormatsValid & (UINT32_C(1) << i)) != 0 &&
+        mDeferredLogFormatHashes[i] == log.formatHash &&
+        mDeferredLogFormatPointers[i] == log.format) {
+      *formatIndex = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint8_t LogBuffer::addDeferredLogFormatLocked(const DeferredLog &log) {
+  uint8_t formatIndex = 0;
+  while (formatIndex < kDeferredLogMaxFormats &&
+         (mDeferredLogFormatsValid & (UINT32_C(1) << formatIndex)) != 0) {
+    formatIndex++;
+  }
+  if (formatIndex == kDeferredLogMaxFormats) {
+    // Logs that use the replaced format string were written before the new
+    // definition, so the host can still decode them.
+    formatIndex = mNextDeferredLogFormatIndex;
+    mNextDeferredLogFormatIndex =
+        (mNextDeferredLogFormatIndex + 1) % kDeferredLogMaxFormats;
+  }
+  mDeferredLogFormatHashes[formatIndex] = log.formatHash;
+  mDeferredLogFormatPointers[formatIndex] = log.format;
+  mDeferredLogFormatLogIndices[formatIndex] = mBufferDataTailIndex;
+  mDeferredLogFormatsValid |= (UINT32_C(1) << formatIndex);
+  return formatIndex;
+}
+
+bool LogBuffer::moveDeferredLogFormatLocked(size_t logSize) {
+  // The size of a deferred log entry up to its format string
+  constexpr size_t kFormatOffset = kLogDataOffset + kDeferredLogOffset + 1;
+
+  const size_t headIndex = mBufferDataHeadIndex;
+  if (getLogTypeFromMetadata(mBufferData[headIndex]) !=
+      LogType::DEFERRED_STRING) {
+    return false;
+  }
+  uint8_t indexField = mBufferData[incrementAndModByBufferMaxSize(
+      headIndex, kLogDataOffset + kDeferredLogOffset)];
+  uint8_t formatIndex = indexField & ~kDeferredLogFormatDefinitionFlag;
+  if ((indexField & kDeferredLogFormatDefinitionFlag) == 0 ||
+      formatIndex >= kDeferredLogMaxFormats) {
+    return false;
+  }
+  // The index may have been reassigned to a later log since, in which case the
+  // logs up to that one can still reference this definition.
+  bool isCurrentDefinition =
+      (mDeferredLogFormatsValid & (UINT32_C(1) << formatIndex)) != 0 &&
+      mDeferredLogFormatLogIndices[formatIndex] == headIndex;
+
+  // Find the first log referencing the format string before it's redefined
+  size_t referenceIndex = incrementAndModByBufferMaxSize(headIndex, logSize);
+  size_t remainingSize = mBufferDataSize - logSize;
+  bool isReferenced = false;
+  while (remainingSize > 0) {
+    if (getLogTypeFromMetadata(mBufferData[referenceIndex]) ==
+        LogType::DEFERRED_STRING) {
+      uint8_t field = mBufferData[incrementAndModByBufferMaxSize(
+          referenceIndex, kLogDataOffset + kDeferredLogOffset)];
+      if ((field & ~kDeferredLogFormatDefinitionFlag) == formatIndex) {
+        isReferenced = (field & kDeferredLogFormatDefinitionFlag) == 0;
+        break;
+      }
+    }
+    size_t referenceLogSize;
+    referenceIndex = getNextLogIndex(referenceIndex, &referenceLogSize);
+    remainingSize -= referenceLogSize;
+  }
+
+  if (!isReferenced) {
+    if (isCurrentDefinition) {
+      mDeferredLogFormatsValid &= ~(UINT32_C(1) << formatIndex);
+    }
+    return false;
+  }
+
+  size_t formatSize = 1;
+  while (mBufferData[incrementAndModByBufferMaxSize(
+             headIndex, kFormatOffset + formatSize - 1)] != '\0') {
+    formatSize++;
+  }
+
+  // Rotate the format string to the end of the span ending with the header of
+  // the referencing log, which shifts the logs in between back over the rest
+  // of the defining log, and turn the reference into a definition.
+  size_t spanStart = incrementAndModByBufferMaxSize(headIndex, kFormatOffset);
+  size_t spanEnd =
+      incrementAndModByBufferMaxSize(referenceIndex, kFormatOffset);
+  size_t spanSize = (spanEnd + mBufferMaxSize - spanStart) % mBufferMaxSize;
+  rotateLeftLocked(spanStart, spanSize, formatSize);
+
+  size_t movedStart = incrementAndModByBufferMaxSize(headIndex, logSize);
+  size_t movedSize =
+      (referenceIndex + mBufferMaxSize - movedStart) % mBufferMaxSize;
+  for (uint8_t i = 0; i < kDeferredLogMaxFormats; i++) {
+    size_t &logIndex = mDeferredLogFormatLogIndices[i];
+    if ((mDeferredLogFormatsValid & (UINT32_C(1) << i)) != 0 &&
+        (logIndex + mBufferMaxSize - movedStart) % mBufferMaxSize <
+            movedSize) {
+      logIndex = (logIndex + mBufferMaxSize - formatSize) % mBufferMaxSize;
+    }
+  }
+
+  referenceIndex =
+      (referenceIndex + mBufferMaxSize - formatSize) % mBufferMaxSize;
+  mBufferData[incrementAndModByBufferMaxSize(referenceIndex, kLogDataOffset)] +=
+      static_cast<uint8_t>(formatSize);
+  mBufferData[incrementAndModByBufferMaxSize(
+      referenceIndex, kLogDataOffset + kDeferredLogOffset)] |=
+      kDeferredLogFormatDefinitionFlag;
+  if (isCurrentDefinition) {
+    mDeferredLogFormatLogIndices[formatIndex] = referenceIndex;
+  }
+
+  size_t discardedSize = logSize - formatSize;
+  mBufferDataHeadIndex =
+      incrementAndModByBufferMaxSize(headIndex, discardedSize);
+  mBufferDataSize -= discardedSize;
+  return true;
+}
+
+void LogBuffer::rotateLeftLocked(size_t startIndex, size_t size,
+                                 size_t shift) {
+  auto reverse = [this](size_t first, size_t count) {
+    for (size_t i = 0; i < count / 2; i++) {
+      std::swap(mBufferData[incrementAndModByBufferMaxSize(first, i)],
+                mBufferData[incrementAndModByBufferMaxSize(first,
+                                                           count - 1 - i)]);
+    }
+  };
+  reverse(startIndex, shift);
+  reverse(incrementAndModByBufferMaxSize(startIndex, shift), size - shift);
+  reverse(startIndex, size);
+}
+
+void LogBuffer::clearDeferredLogFormatsLocked() {
+  mDeferredLogFormatsValid = 0;
+  mNextDeferredLogFormatIndex = 0;
+}
+
 void LogBuffer::encodeAndCopyLogLocked(LogBufferLogLevel level,
                                        uint32_t timestampMs,
                                        const void *logBuffer, uint8_t logLen,
@@ -382,17 +728,8 @@ void LogBuffer::dispatch() {
 }
 
 LogType LogBuffer::getLogTypeFromMetadata(uint8_t metadata) {
-  LogType type;
-  if (((metadata & 0x20) != 0) && ((metadata & 0x10) != 0)) {
-    type = LogType::NANOAPP_TOKENIZED;
-  } else if ((metadata & 0x20) != 0) {
-    type = LogType::BLUETOOTH;
-  } else if ((metadata & 0x10) != 0) {
-    type = LogType::TOKENIZED;
-  } else {
-    type = LogType::STRING;
-  }
-  return type;
+  // The upper nibble of the metadata holds the log type, see setLogMetadata.
+  return static_cast<LogType>(metadata >> 4);
 }
 
 uint8_t LogBuffer::setLogMetadata(LogType type, LogBufferLogLevel logLevel) {
@@ -88,23 +88,26 @@ void LogBufferManager::startSendLogsToHostLoop() {
       auto &hostCommsMgr =
           EventLoopManagerSingleton::get()->getHostCommsManager();
       preSecondaryBufferUse();
-      if (mSecondaryLogBuffer.getBufferSize() == 0) {
+      if (mLogBuffers.getRetiredBuffer().getBufferSize() == 0) {
         // TODO (b/184178045): Transfer logs into the secondary buffer from
         // primary if there is room.
-        mPrimaryLogBuffer.transferTo(mSecondaryLogBuffer);
+        mLogBuffers.retireActiveBuffer();
       }
-      // If the primary buffer was not flushed to the secondary buffer then set
-      // the flag that will cause sendLogsToHost to be run again after
-      // onLogsSentToHost has been called and the secondary buffer has been
-      // cleared out.
-      if (mPrimaryLogBuffer.getBufferSize() > 0) {
+      // If the active buffer was not retired then set the flag that will cause
+      // sendLogsToHost to be run again after onLogsSentToHost has been called
+      // and the retired buffer has been cleared out.
+      if (mLogBuffers.getActiveBufferSize() > 0) {
         mLogsBecameReadyWhileFlushPending = true;
       }
-      if (mSecondaryLogBuffer.getBufferSize() > 0) {
-        mNumLogsDroppedTotal += mSecondaryLogBuffer.getNumLogsDropped();
+      LogBuffer &retiredBuffer = mLogBuffers.getRetiredBuffer();
+      if (retiredBuffer.getBufferSize() > 0) {
+        mNumLogsDroppedTotal += retiredBuffer.getNumLogsDropped();
         mFlushLogsMutex.unlock();
-        hostCommsMgr.sendLogMessageV2(mSecondaryLogBuffer.getBufferData(),
-                                      mSecondaryLogBuffer.getBufferSize(),
+        // Producers only write to the active buffer, so the retired one can be
+        // prepared and sent without holding the lock
+        retiredBuffer.linearize();
+        hostCommsMgr.sendLogMessageV2(retiredBuffer.getBufferData(),
+                                      retiredBuffer.getBufferSize(),
                                       mNumLogsDroppedTotal);
         logWasSent = true;
         mFlushLogsMutex.lock();
@@ -142,21 +145,30 @@ void LogBufferManager::bufferOverflowGuard(size_t logSize, LogType type) {
     case LogType::NANOAPP_TOKENIZED:
       logSize += LogBuffer::kNanoappTokenizedLogOffset;
       break;
+    case LogType::DEFERRED_STRING:
+      logSize += LogBuffer::kDeferredLogOffset;
+      break;
     default:
       CHRE_ASSERT_LOG(false, "Received unexpected log message type");
       break;
   }
-  if (mPrimaryLogBuffer.logWouldCauseOverflow(logSize)) {
+  if (mLogBuffers.activeLogWouldCauseOverflow(logSize)) {
     LockGuard<Mutex> lockGuard(mFlushLogsMutex);
     if (!mLogFlushToHostPending) {
       preSecondaryBufferUse();
-      mPrimaryLogBuffer.transferTo(mSecondaryLogBuffer);
+      mLogBuffers.retireActiveBuffer();
     }
   }
 }
 
 void LogBufferManager::logVa(chreLogLevel logLevel, const char *formatStr,
                              va_list args) {
+#ifdef CHRE_LOG_DEFERRED_FORMAT_ENABLED
+  if (logDeferredVa(logLevel, formatStr, args)) {
+    return;
+  }
+#endif  // CHRE_LOG_DEFERRED_FORMAT_ENABLED
+
   // Copy the va_list before getting size from vsnprintf so that the next
   // argument that will be accessed in buffer.handleLogVa is the starting one.
   va_list getSizeArgs;
@@ -164,15 +176,40 @@ void LogBufferManager::logVa(chreLogLevel logLevel, const char *formatStr,
   size_t logSize = vsnprintf(nullptr, 0, formatStr, getSizeArgs);
   va_end(getSizeArgs);
   bufferOverflowGuard(logSize, LogType::STRING);
-  mPrimaryLogBuffer.handleLogVa(chreToLogBufferLogLevel(logLevel),
-                                getTimestampMs(), formatStr, args);
+  LogDoubleBuffer::Writer writer(mLogBuffers);
+  writer->handleLogVa(chreToLogBufferLogLevel(logLevel), getTimestampMs(),
+                      formatStr, args);
+}
+
+#ifdef CHRE_LOG_DEFERRED_FORMAT_ENABLED
+bool LogBufferManager::logDeferredVa(chreLogLevel logLevel,
+                                     const char *formatStr, va_list args) {
+  // Capture from a copy of the va_list so that the log can still be formatted
+  // if it can't be deferred.
+  LogBuffer::DeferredLog deferredLog;
+  va_list captureArgs;
+  va_copy(captureArgs, args);
+  bool success =
+      LogBuffer::captureDeferredLog(formatStr, captureArgs, &deferredLog);
+  va_end(captureArgs);
+
+  if (success) {
+    bufferOverflowGuard(LogBuffer::getDeferredLogMaxSize(deferredLog),
+                        LogType::DEFERRED_STRING);
+    LogDoubleBuffer::Writer writer(mLogBuffers);
+    writer->handleDeferredLog(chreToLogBufferLogLevel(logLevel),
+                              getTimestampMs(), deferredLog);
+  }
+  return success;
 }
+#endif  // CHRE_LOG_DEFERRED_FORMAT_ENABLED
 
 void LogBufferManager::logBtSnoop(BtSnoopDirection direction,
                                   const uint8_t *buffer, size_t size) {
 #ifdef CHRE_BLE_SUPPORT_ENABLED
   bufferOverflowGuard(size, LogType::BLUETOOTH);
-  mPrimaryLogBuffer.handleBtLog(direction, getTimestampMs(), buffer, size);
+  LogDoubleBuffer::Writer writer(mLogBuffers);
+  writer->handleBtLog(direction, getTimestampMs(), buffer, size);
 #else
   UNUSED_VAR(direction);
   UNUSED_VAR(buffer);
@@ -184,18 +221,18 @@ void LogBufferManager::logEncoded(chreLogLevel logLevel,
                                   const uint8_t *encodedLog,
                                   size_t encodedLogSize) {
   bufferOverflowGuard(encodedLogSize, LogType::TOKENIZED);
-  mPrimaryLogBuffer.handleEncodedLog(chreToLogBufferLogLevel(logLevel),
-                                     getTimestampMs(), encodedLog,
-                                     encodedLogSize);
+  LogDoubleBuffer::Writer writer(mLogBuffers);
+  writer->handleEncodedLog(chreToLogBufferLogLevel(logLevel), getTimestampMs(),
+                           encodedLog, encodedLogSize);
 }
 
 void LogBufferManager::logNanoappTokenized(chreLogLevel logLevel,
                                            uint16_t instanceId,
                                            const uint8_t *msg, size_t msgSize) {
   bufferOverflowGuard(msgSize, LogType::NANOAPP_TOKENIZED);
-  mPrimaryLogBuffer.handleNanoappTokenizedLog(chreToLogBufferLogLevel(logLevel),
-                                              getTimestampMs(), instanceId, msg,
-                                              msgSize);
+  LogDoubleBuffer::Writer writer(mLogBuffers);
+  writer->handleNanoappTokenizedLog(chreToLogBufferLogLevel(logLevel),
+                                    getTimestampMs(), instanceId, msg, msgSize);
 }
 
 LogBufferLogLevel LogBufferManager::chreToLogBufferLogLevel(
@@ -214,7 +251,7 @@ LogBufferLogLevel LogBufferManager::chreToLogBufferLogLevel(
 
 void LogBufferManager::onLogsSentToHostLocked(bool success) {
   if (success) {
-    mSecondaryLogBuffer.reset();
+    mLogBuffers.getRetiredBuffer().reset();
   }
   // If there is a failure to send a log through do not try to send another
   // one to avoid an infinite loop occurring
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/platform/shared/log_double_buffer.h"
+
+#include "chre/util/lock_guard.h"
+
+namespace chre {
+
+LogDoubleBuffer::Writer::Writer(LogDoubleBuffer &logBuffers)
+    : mLogBuffers(logBuffers) {
+  while (true) {
+    mIndex = mLogBuffers.mActiveIndex.load();
+    mLogBuffers.mNumWriters[mIndex].fetch_increment();
+    if (mLogBuffers.mActiveIndex.load() == mIndex) {
+      break;
+    }
+
+    // The buffer was retired before we registered as a writer, so try again
+    // with the new active buffer
+    mLogBuffers.releaseWriter(mIndex);
+  }
+}
+
+LogDoubleBuffer::Writer::~Writer() {
+  mLogBuffers.releaseWriter(mIndex);
+  if (mLogBuffers.mLogsReadyPending.exchange(false) &&
+      mLogBuffers.mCallback != nullptr) {
+    mLogBuffers.mCallback->onLogsReady();
+  }
+}
+
+LogDoubleBuffer::LogDoubleBuffer(LogBufferCallbackInterface *callback,
+                                 void *primaryBufferData,
+                                 void *secondaryBufferData, size_t bufferSize)
+    : mCallback(callback),
+      mBuffers{{this, primaryBufferData, bufferSize},
+               {this, secondaryBufferData, bufferSize}} {}
+
+void LogDoubleBuffer::retireActiveBuffer() {
+#ifdef CHRE_LOG_BUFFER_SWAP_ENABLED
+  uint32_t retiredIndex = mActiveIndex.load();
+  uint32_t activeIndex = retiredIndex ^ 1;
+  mBuffers[activeIndex].discardLogs();
+  mActiveIndex.store(activeIndex);
+
+  LockGuard<Mutex> lock(mWritersMutex);
+  while (mNumWriters[retiredIndex].load() != 0) {
+    mWritersDoneCondition.wait(mWritersMutex);
+  }
+#else
+  mBuffers[0].transferTo(mBuffers[1]);
+#endif  // CHRE_LOG_BUFFER_SWAP_ENABLED
+}
+
+LogBuffer &LogDoubleBuffer::getRetiredBuffer() {
+  return mBuffers[mActiveIndex.load() ^ 1];
+}
+
+size_t LogDoubleBuffer::getActiveBufferSize() {
+  return mBuffers[mActiveIndex.load()].getBufferSize();
+}
+
+bool LogDoubleBuffer::activeLogWouldCauseOverflow(size_t logSize) {
+  return mBuffers[mActiveIndex.load()].logWouldCauseOverflow(logSize);
+}
+
+void LogDoubleBuffer::onLogsReady() {
+  mLogsReadyPending = true;
+}
+
+void LogDoubleBuffer::releaseWriter(uint32_t index) {
+  if (mNumWriters[index].fetch_decrement() == 1 &&
+      mActiveIndex.load() != index) {
+    LockGuard<Mutex> lock(mWritersMutex);
+    mWritersDoneCondition.notify_one();
+  }
+}
+
+}  // namespace chre
@@ -23,32 +23,16 @@ namespace chre {
 
 void *MemoryManager::nanoappAlloc(Nanoapp *app, uint32_t bytes) {
   HeapBlockHeader *header = nullptr;
-  if (bytes > 0) {
-    if (mAllocationCount >= kMaxAllocationCount) {
-      LOGE("Failed to allocate memory from Nanoapp ID %" PRIu16
-           ": allocation count exceeded limit.",
-           app->getInstanceId());
-    } else if ((bytes > kMaxAllocationBytes) ||
-               ((mTotalAllocatedBytes + bytes) > kMaxAllocationBytes)) {
-      LOGE("Failed to allocate memory from Nanoapp ID %" PRIu16
-           ": not enough space.",
-           app->getInstanceId());
-    } else {
-      header = static_cast<HeapBlockHeader *>(
-          doAlloc(app, sizeof(HeapBlockHeader) + bytes));
-
-      if (header != nullptr) {
-        app->setTotalAllocatedBytes(app->getTotalAllocatedBytes() + bytes);
-        mTotalAllocatedBytes += bytes;
-        if (mTotalAllocatedBytes > mPeakAllocatedBytes) {
-          mPeakAllocatedBytes = mTotalAllocatedBytes;
-        }
-        mAllocationCount++;
-        app->linkHeapBlock(header);
-        header->data.bytes = bytes;
-        header->data.instanceId = app->getInstanceId();
-        header++;
-      }
+  if (bytes > 0 && isAllocationAllowed(app, bytes)) {
+    header = static_cast<HeapBlockHeader *>(
+        doAlloc(app, sizeof(HeapBlockHeader) + bytes));
+
+    if (header != nullptr) {
+      addAllocation(app, bytes);
+      app->linkHeapBlock(header);
+      header->data.bytes = bytes;
+      header->data.instanceId = app->getInstanceId();
+      header++;
     }
   }
   return header;
@@ -67,23 +51,7 @@ void MemoryManager::nanoappFree(Nanoapp *app, void *ptr) {
            app->getInstanceId(), header->data.instanceId);
     }
 
-    size_t nanoAppTotalAllocatedBytes = app->getTotalAllocatedBytes();
-    if (nanoAppTotalAllocatedBytes >= header->data.bytes) {
-      app->setTotalAllocatedBytes(nanoAppTotalAllocatedBytes -
-                                  header->data.bytes);
-    } else {
-      app->setTotalAllocatedBytes(0);
-    }
-
-    if (mTotalAllocatedBytes >= header->data.bytes) {
-      mTotalAllocatedBytes -= header->data.bytes;
-    } else {
-      mTotalAllocatedBytes = 0;
-    }
-    if (mAllocationCount > 0) {
-      mAllocationCount--;
-    }
-
+    removeAllocation(app, header->data.bytes);
     app->unlinkHeapBlock(header);
     doFree(app, header);
   }
@@ -112,6 +80,65 @@ uint32_t MemoryManager::nanoappFreeAll(Nanoapp *app) {
   return numFreedBlocks;
 }
 
+bool MemoryManager::nanoappCharge(Nanoapp *app, uint32_t bytes) {
+  bool success = isAllocationAllowed(app, bytes);
+  if (success) {
+    addAllocation(app, bytes);
+  }
+  return success;
+}
+
+void MemoryManager::nanoappUncharge(Nanoapp *app, uint32_t bytes) {
+  removeAllocation(app, bytes);
+}
+
+bool MemoryManager::isAllocationAllowed(const Nanoapp *app,
+                                        uint32_t bytes) const {
+  bool allowed = false;
+  if (mAllocationCount >= kMaxAllocationCount) {
+    LOGE("Failed to allocate memory from Nanoapp ID %" PRIu16
+         ": allocation count exceeded limit.",
+         app->getInstanceId());
+  } else if ((bytes > kMaxAllocationBytes) ||
+             ((mTotalAllocatedBytes + bytes) > kMaxAllocationBytes)) {
+    LOGE("Failed to allocate memory from Nanoapp ID %" PRIu16
+         ": not enough space.",
+         app->getInstanceId());
+  } else {
+    allowed = true;
+  }
+  return allowed;
+}
+
+void MemoryManager::addAllocation(Nanoapp *app, uint32_t bytes) {
+  app->setTotalAllocatedBytes(app->getTotalAllocatedBytes() + bytes);
+  mTotalAllocatedBytes += bytes;
+  if (mTotalAllocatedBytes > mPeakAllocatedBytes) {
+    mPeakAllocatedBytes = mTotalAllocatedBytes;
+  }
+  mAllocationCount++;
+}
+
+void MemoryManager::removeAllocation(Nanoapp *app, uint32_t bytes) {
+  if (app != nullptr) {
+    size_t nanoAppTotalAllocatedBytes = app->getTotalAllocatedBytes();
+    if (nanoAppTotalAllocatedBytes >= bytes) {
+      app->setTotalAllocatedBytes(nanoAppTotalAllocatedBytes - bytes);
+    } else {
+      app->setTotalAllocatedBytes(0);
+    }
+  }
+
+  if (mTotalAllocatedBytes >= bytes) {
+    mTotalAllocatedBytes -= bytes;
+  } else {
+    mTotalAllocatedBytes = 0;
+  }
+  if (mAllocationCount > 0) {
+    mAllocationCount--;
+  }
+}
+
 void MemoryManager::logStateToBuffer(DebugDumpWrapper &debugDump) const {
   debugDump.print(
       "\nNanoapp heap usage: %zu bytes allocated, %zu peak bytes"
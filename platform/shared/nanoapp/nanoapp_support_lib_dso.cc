@@ -26,6 +26,7 @@
 #include "chre_api/chre.h"
 #include "chre_nsl_internal/platform/shared/debug_dump.h"
 #include "chre_nsl_internal/util/macros.h"
+#include "chre_nsl_internal/util/nanoapp/shared_payload.h"
 #include "chre_nsl_internal/util/system/napp_permissions.h"
 #ifdef CHRE_NANOAPP_USES_WIFI
 #include "chre_nsl_internal/util/system/wifi_util.h"
@@ -668,4 +669,28 @@ uint32_t chreGetMessageToHostMaxSize() {
 }
 #endif /* CHRE_FIRST_SUPPORTED_API_VERSION < CHRE_API_VERSION_1_10 */
 
+// Shared payloads are an extension which isn't part of any CHRE API version, so
+// they are always looked up
+WEAK_SYMBOL
+void *chreSharedPayloadAlloc(uint32_t bytes) {
+  auto *fptr = CHRE_NSL_LAZY_LOOKUP(chreSharedPayloadAlloc);
+  return (fptr != nullptr) ? fptr(bytes) : nullptr;
+}
+
+WEAK_SYMBOL
+void chreSharedPayloadRetain(const void *payload) {
+  auto *fptr = CHRE_NSL_LAZY_LOOKUP(chreSharedPayloadRetain);
+  if (fptr != nullptr) {
+    fptr(payload);
+  }
+}
+
+WEAK_SYMBOL
+void chreSharedPayloadRelease(const void *payload) {
+  auto *fptr = CHRE_NSL_LAZY_LOOKUP(chreSharedPayloadRelease);
+  if (fptr != nullptr) {
+    fptr(payload);
+  }
+}
+
 #endif  // !defined(CHRE_NANOAPP_DISABLE_BACKCOMPAT)
@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/platform/shared/nanoapp_binary_cache.h"
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+
+#include "chre/platform/assert.h"
+#include "chre/platform/log.h"
+#include "chre/util/hash.h"
+#include "chre/util/lock_guard.h"
+
+namespace chre {
+namespace {
+
+//! Identifies a region initialized by NanoappBinaryCache ("CHBC").
+constexpr uint32_t kRegionMagic = 0x43424843;
+
+//! Must be incremented whenever the layout of the region changes.
+constexpr uint32_t kRegionVersion = 1;
+
+//! The binary is being written by appendStore().
+constexpr uint32_t kStateStoring = 1;
+//! The binary is complete, but its nanoapp hasn't started yet.
+constexpr uint32_t kStateStored = 2;
+//! The binary may be returned by find().
+constexpr uint32_t kStateRetained = 3;
+//! The entry is unused and is removed by compact().
+constexpr uint32_t kStateDropped = 4;
+
+//! The alignment of the entries in the region.
+constexpr size_t kEntryAlignment = 8;
+
+size_t alignEntrySize(size_t size) {
+  return (size + kEntryAlignment - 1) & ~(kEntryAlignment - 1);
+}
+
+}  // anonymous namespace
+
+//! Starts the region given to init(), followed by the entries.
+struct NanoappBinaryCache::RegionHeader {
+  uint32_t magic;
+  uint32_t version;
+  //! The size of the region, including this header.
+  uint32_t size;
+  //! The number of bytes used by the entries following this header.
+  uint32_t usedSize;
+};
+
+//! Precedes each binary, which is padded to kEntryAlignment.
+struct NanoappBinaryCache::EntryHeader {
+  uint32_t state;
+  //! The hash of the fields from appId to binaryChecksum, valid once the
+  //! binary is stored.
+  uint32_t headerChecksum;
+  uint64_t appId;
+  uint64_t binaryHash;
+  uint32_t appVersion;
+  uint32_t binaryLen;
+  //! The hash of the binary, valid once it's stored.
+  uint32_t binaryChecksum;
+  uint32_t reserved;
+};
+
+void NanoappBinaryCache::init(void *region, size_t size) {
+  LockGuard<Mutex> lock(mMutex);
+  mHeader = nullptr;
+  mStoreEntry = nullptr;
+  if (region == nullptr ||
+      size < sizeof(RegionHeader) + sizeof(EntryHeader) + kEntryAlignment ||
+      size > UINT32_MAX) {
+    LOGE("Unusable nanoapp binary cache region of %zu bytes", size);
+    return;
+  }
+
+  mHeader = static_cast<RegionHeader *>(region);
+  if (mHeader->magic != kRegionMagic || mHeader->version != kRegionVersion ||
+      mHeader->size != size ||
+      mHeader->usedSize > size - sizeof(RegionHeader)) {
+    LOGI("Clearing nanoapp binary cache");
+    clear(size);
+    return;
+  }
+
+  // Keep the entries preceding the first corrupted one, as the size of the
+  // following ones can't be trusted. Binaries which weren't retained before
+  // the restart are dropped.
+  EntryHeader *end = endEntry();
+  EntryHeader *entry = firstEntry();
+  while (entry < end) {
+    size_t remaining = reinterpret_cast<uint8_t *>(end) -
+                       reinterpret_cast<uint8_t *>(entry);
+    if (remaining < sizeof(EntryHeader) ||
+        entry->binaryLen > remaining - sizeof(EntryHeader) ||
+        sizeof(EntryHeader) + alignEntrySize(entry->binaryLen) > remaining) {
+      break;
+    }
+    if (entry->state == kStateRetained) {
+      if (entry->headerChecksum != computeHeaderChecksum(entry)) {
+        break;
+      }
+    } else if (entry->state == kStateStoring || entry->state == kStateStored ||
+               entry->state == kStateDropped) {
+      entry->state = kStateDropped;
+    } else {
+      break;
+    }
+    entry = nextEntry(entry);
+  }
+
+  if (entry < end) {
+    LOGW("Truncating corrupted nanoapp binary cache");
+    mHeader->usedSize = static_cast<uint32_t>(
+        reinterpret_cast<uint8_t *>(entry) -
+        reinterpret_cast<uint8_t *>(firstEntry()));
+  }
+  compact();
+}
+
+const void *NanoappBinaryCache::find(uint64_t appId, uint32_t appVersion,
+                                     uint64_t binaryHash, size_t binaryLen) {
+  LockGuard<Mutex> lock(mMutex);
+  if (mHeader == nullptr) {
+    return nullptr;
+  }
+
+  EntryHeader *end = endEntry();
+  for (EntryHeader *entry = firstEntry(); entry < end;
+       entry = nextEntry(entry)) {
+    if (entry->state == kStateRetained && entry->appId == appId &&
+        entry->appVersion == appVersion && entry->binaryHash == binaryHash &&
+        entry->binaryLen == binaryLen) {
+      if (fnv1a32Hash(getBinary(entry), entry->binaryLen) ==
+          entry->binaryChecksum) {
+        return getBinary(entry);
+      }
+      LOGE("Dropping corrupted binary of nanoapp 0x%016" PRIx64, appId);
+      entry->state = kStateDropped;
+    }
+  }
+  return nullptr;
+}
+
+bool NanoappBinaryCache::startStore(uint64_t appId, uint32_t appVersion,
+                                    uint64_t binaryHash, size_t binaryLen) {
+  LockGuard<Mutex> lock(mMutex);
+  if (mHeader == nullptr || mStoreEntry != nullptr || binaryLen == 0) {
+    return false;
+  }
+
+  dropEntries(appId);
+  size_t capacity = mHeader->size - sizeof(RegionHeader);
+  if (binaryLen > capacity ||
+      sizeof(EntryHeader) + alignEntrySize(binaryLen) > capacity) {
+    LOGW("Nanoapp 0x%016" PRIx64 " binary of %zu bytes is too large to retain",
+         appId, binaryLen);
+    return false;
+  }
+
+  size_t entrySize = sizeof(EntryHeader) + alignEntrySize(binaryLen);
+  compact();
+  while (capacity - mHeader->usedSize < entrySize) {
+    EntryHeader *oldest = firstEntry();
+    LOGD("Evicting retained binary of nanoapp 0x%016" PRIx64, oldest->appId);
+    oldest->state = kStateDropped;
+    compact();
+  }
+
+  // The entry is only counted once it's marked as being stored, so that it's
+  // dropped if CHRE restarts before the binary is complete
+  EntryHeader *entry = endEntry();
+  entry->state = kStateStoring;
+  entry->appId = appId;
+  entry->binaryHash = binaryHash;
+  entry->appVersion = appVersion;
+  entry->binaryLen = static_cast<uint32_t>(binaryLen);
+  entry->reserved = 0;
+  mHeader->usedSize += static_cast<uint32_t>(entrySize);
+
+  mStoreEntry = entry;
+  mStoreSize = 0;
+  return true;
+}
+
+void NanoappBinaryCache::appendStore(const void *data, size_t size) {
+  LockGuard<Mutex> lock(mMutex);
+  if (mStoreEntry != nullptr) {
+    if (size > mStoreEntry->binaryLen - mStoreSize) {
+      LOGE("Nanoapp 0x%016" PRIx64 " binary exceeds its size of %" PRIu32,
+           mStoreEntry->appId, mStoreEntry->binaryLen);
+      mStoreEntry->state = kStateDropped;
+      mStoreEntry = nullptr;
+    } else {
+      memcpy(getBinary(mStoreEntry) + mStoreSize, data, size);
+      mStoreSize += size;
+    }
+  }
+}
+
+void NanoappBinaryCache::finishStore() {
+  LockGuard<Mutex> lock(mMutex);
+  if (mStoreEntry != nullptr) {
+    if (mStoreSize == mStoreEntry->binaryLen) {
+      mStoreEntry->binaryChecksum =
+          fnv1a32Hash(getBinary(mStoreEntry), mStoreEntry->binaryLen);
+      mStoreEntry->headerChecksum = computeHeaderChecksum(mStoreEntry);
+      mStoreEntry->state = kStateStored;
+    } else {
+      mStoreEntry->state = kStateDropped;
+    }
+    mStoreEntry = nullptr;
+  }
+}
+
+void NanoappBinaryCache::abortStore() {
+  LockGuard<Mutex> lock(mMutex);
+  if (mStoreEntry != nullptr) {
+    mStoreEntry->state = kStateDropped;
+    mStoreEntry = nullptr;
+  }
+}
+
+void NanoappBinaryCache::retain(uint64_t appId) {
+  LockGuard<Mutex> lock(mMutex);
+  if (mHeader == nullptr) {
+    return;
+  }
+
+  EntryHeader *end = endEntry();
+  for (EntryHeader *entry = firstEntry(); entry < end;
+       entry = nextEntry(entry)) {
+    if (entry->state == kStateStored && entry->appId == appId) {
+      entry->state = kStateRetained;
+    }
+  }
+}
+
+void NanoappBinaryCache::drop(uint64_t appId) {
+  LockGuard<Mutex> lock(mMutex);
+  if (mHeader != nullptr) {
+    dropEntries(appId);
+  }
+}
+
+NanoappBinaryCache::EntryHeader *NanoappBinaryCache::firstEntry() const {
+  return reinterpret_cast<EntryHeader *>(mHeader + 1);
+}
+
+NanoappBinaryCache::EntryHeader *NanoappBinaryCache::endEntry() const {
+  return reinterpret_cast<EntryHeader *>(
+      reinterpret_cast<uint8_t *>(firstEntry()) + mHeader->usedSize);
+}
+
+NanoappBinaryCache::EntryHeader *NanoappBinaryCache::nextEntry(
+    EntryHeader *entry) {
+  return reinterpret_cast<EntryHeader *>(getBinary(entry) +
+                                         alignEntrySize(entry->binaryLen));
+}
+
+uint8_t *NanoappBinaryCache::getBinary(EntryHeader *entry) {
+  return reinterpret_cast<uint8_t *>(entry + 1);
+}
+
+uint32_t NanoappBinaryCache::computeHeaderChecksum(const EntryHeader *entry) {
+  return fnv1a32Hash(
+      reinterpret_cast<const uint8_t *>(entry) + offsetof(EntryHeader, appId),
+      offsetof(EntryHeader, reserved) - offsetof(EntryHeader, appId));
+}
+
+void NanoappBinaryCache::compact() {
+  CHRE_ASSERT(mStoreEntry == nullptr);
+
+  uint8_t *dest = reinterpret_cast<uint8_t *>(firstEntry());
+  EntryHeader *end = endEntry();
+  for (EntryHeader *entry = firstEntry(); entry < end;) {
+    EntryHeader *next = nextEntry(entry);
+    if (entry->state != kStateDropped) {
+      size_t entrySize = reinterpret_cast<uint8_t *>(next) -
+                         reinterpret_cast<uint8_t *>(entry);
+      if (dest != reinterpret_cast<uint8_t *>(entry)) {
+        memmove(dest, entry, entrySize);
+      }
+      dest += entrySize;
+    }
+    entry = next;
+  }
+  mHeader->usedSize = static_cast<uint32_t>(
+      dest - reinterpret_cast<uint8_t *>(firstEntry()));
+}
+
+void NanoappBinaryCache::dropEntries(uint64_t appId) {
+  EntryHeader *end = endEntry();
+  for (EntryHeader *entry = firstEntry(); entry < end;
+       entry = nextEntry(entry)) {
+    if (entry->appId == appId && entry->state != kStateDropped) {
+      entry->state = kStateDropped;
+      if (entry == mStoreEntry) {
+        mStoreEntry = nullptr;
+      }
+    }
+  }
+}
+
+void NanoappBinaryCache::clear(size_t size) {
+  mHeader->magic = kRegionMagic;
+  mHeader->version = kRegionVersion;
+  mHeader->size = static_cast<uint32_t>(size);
+  mHeader->usedSize = 0;
+}
+
+}  // namespace chre
@@ -16,69 +16,201 @@
 
 #include "chre/platform/shared/nanoapp_load_manager.h"
 
+#include <cinttypes>
+
+#include "chre/util/macros.h"
+
 namespace chre {
 
 bool NanoappLoadManager::prepareForLoad(uint16_t hostClientId,
                                         uint32_t transactionId, uint64_t appId,
                                         uint32_t appVersion, uint32_t appFlags,
                                         size_t totalBinaryLen,
-                                        uint32_t targetApiVersion) {
-  if (hasPendingLoadTransaction()) {
+                                        uint32_t targetApiVersion,
+                                        uint32_t windowSize,
+                                        uint64_t binaryHash) {
+  LoadTransaction *transaction = findTransaction(hostClientId, transactionId);
+  if (transaction != nullptr) {
     LOGW(
         "Pending load transaction already exists. Overriding previous"
         " transaction.");
+    resetTransaction(transaction);
+  } else {
+    for (LoadTransaction &candidate : mTransactions) {
+      if (candidate.nanoapp.isNull()) {
+        transaction = &candidate;
+        break;
+      }
+    }
   }
 
-  mCurrentLoadInfo.hostClientId = hostClientId;
-  mCurrentLoadInfo.transactionId = transactionId;
-  mCurrentLoadInfo.nextFragmentId = 1;
-  mNanoapp = MakeUnique<Nanoapp>();
-
   bool success = false;
-  if (mNanoapp.isNull()) {
-    LOG_OOM();
+  if (transaction == nullptr) {
+    LOGE("Too many pending load transactions");
   } else {
-    success = mNanoapp->reserveBuffer(appId, appVersion, appFlags,
-                                      totalBinaryLen, targetApiVersion);
-  }
+    transaction->info.hostClientId = hostClientId;
+    transaction->info.transactionId = transactionId;
+    transaction->info.nextFragmentId = 1;
+    transaction->info.windowSize = windowSize;
+    transaction->lastActivity = ++mActivityCounter;
+    transaction->isStoringBinary = false;
+    transaction->nanoapp = MakeUnique<Nanoapp>();
 
-  if (!success) {
-    markFailure();
+    if (transaction->nanoapp.isNull()) {
+      LOG_OOM();
+    } else {
+      success = transaction->nanoapp->reserveBuffer(
+          appId, appVersion, appFlags, totalBinaryLen, targetApiVersion);
+    }
+
+    if (success && binaryHash != 0) {
+      success = useBinaryCache(transaction, appId, appVersion, totalBinaryLen,
+                               binaryHash);
+    }
+
+    if (!success) {
+      transaction->nanoapp.reset(nullptr);
+    }
   }
 
   return success;
 }
 
-bool NanoappLoadManager::copyNanoappFragment(uint16_t hostClientId,
-                                             uint32_t transactionId,
-                                             uint32_t fragmentId,
-                                             const void *buffer,
-                                             size_t bufferLen) {
-  bool success = false;
-  if (validateFragment(hostClientId, transactionId, fragmentId)) {
-    success = mNanoapp->copyNanoappFragment(buffer, bufferLen);
-    if (success) {
-      mCurrentLoadInfo.nextFragmentId++;
+NanoappLoadManager::FragmentResult NanoappLoadManager::copyNanoappFragment(
+    uint16_t hostClientId, uint32_t transactionId, uint32_t fragmentId,
+    const void *buffer, size_t bufferLen) {
+  LoadTransaction *transaction = findTransaction(hostClientId, transactionId);
+  FragmentResult result =
+      validateFragment(transaction, hostClientId, transactionId, fragmentId);
+  if (result == FragmentResult::ACCEPTED) {
+    transaction->lastActivity = ++mActivityCounter;
+    if (transaction->nanoapp->copyNanoappFragment(buffer, bufferLen)) {
+      transaction->info.nextFragmentId++;
+#ifdef CHRE_NANOAPP_BINARY_CACHE_ENABLED
+      if (transaction->isStoringBinary) {
+        mBinaryCache.appendStore(buffer, bufferLen);
+        if (transaction->nanoapp->isLoaded()) {
+          mBinaryCache.finishStore();
+          transaction->isStoringBinary = false;
+        }
+      }
+#endif  // CHRE_NANOAPP_BINARY_CACHE_ENABLED
     } else {
-      markFailure();
+      resetTransaction(transaction);
+      result = FragmentResult::FAILED;
     }
   }
 
-  return success;
+  return result;
+}
+
+bool NanoappLoadManager::getTransactionToReplace(
+    uint16_t hostClientId, uint32_t transactionId,
+    FragmentedLoadInfo *info) const {
+  const LoadTransaction *transaction =
+      findTransaction(hostClientId, transactionId);
+  if (transaction == nullptr) {
+    for (const LoadTransaction &candidate : mTransactions) {
+      if (candidate.nanoapp.isNull()) {
+        return false;
+      }
+      // Compare the distance from the counter so that the least recently
+      // active transaction is found even after the counter wraps around.
+      if (transaction == nullptr ||
+          mActivityCounter - candidate.lastActivity >
+              mActivityCounter - transaction->lastActivity) {
+        transaction = &candidate;
+      }
+    }
+  }
+
+  *info = transaction->info;
+  return true;
+}
+
+void NanoappLoadManager::markFailure(uint16_t hostClientId,
+                                     uint32_t transactionId) {
+  LoadTransaction *transaction = findTransaction(hostClientId, transactionId);
+  if (transaction != nullptr) {
+    resetTransaction(transaction);
+  }
+}
+
+void NanoappLoadManager::onNanoappStarted(uint64_t appId, bool started) {
+#ifdef CHRE_NANOAPP_BINARY_CACHE_ENABLED
+  if (started) {
+    mBinaryCache.retain(appId);
+  } else {
+    mBinaryCache.drop(appId);
+  }
+#else
+  UNUSED_VAR(appId);
+  UNUSED_VAR(started);
+#endif  // CHRE_NANOAPP_BINARY_CACHE_ENABLED
+}
+
+bool NanoappLoadManager::getTransactionInfo(uint16_t hostClientId,
+                                            uint32_t transactionId,
+                                            FragmentedLoadInfo *info) const {
+  const LoadTransaction *transaction =
+      findTransaction(hostClientId, transactionId);
+  if (transaction != nullptr) {
+    *info = transaction->info;
+  }
+  return transaction != nullptr;
 }
 
-bool NanoappLoadManager::validateFragment(uint16_t hostClientId,
-                                          uint32_t transactionId,
-                                          uint32_t fragmentId) const {
-  bool valid = false;
-  if (!hasPendingLoadTransaction()) {
-    LOGE("No pending load transaction exists");
+UniquePtr<Nanoapp> NanoappLoadManager::releaseNanoapp(uint16_t hostClientId,
+                                                      uint32_t transactionId) {
+  LoadTransaction *transaction = findTransaction(hostClientId, transactionId);
+  if (transaction == nullptr) {
+    return UniquePtr<Nanoapp>();
+  }
+
+  UniquePtr<Nanoapp> nanoapp = std::move(transaction->nanoapp);
+  resetTransaction(transaction);
+  return nanoapp;
+}
+
+NanoappLoadManager::LoadTransaction *NanoappLoadManager::findTransaction(
+    uint16_t hostClientId, uint32_t transactionId) {
+  return const_cast<LoadTransaction *>(
+      static_cast<const NanoappLoadManager *>(this)->findTransaction(
+          hostClientId, transactionId));
+}
+
+const NanoappLoadManager::LoadTransaction *NanoappLoadManager::findTransaction(
+    uint16_t hostClientId, uint32_t transactionId) const {
+  for (const LoadTransaction &transaction : mTransactions) {
+    if (!transaction.nanoapp.isNull() &&
+        transaction.info.hostClientId == hostClientId &&
+        transaction.info.transactionId == transactionId) {
+      return &transaction;
+    }
+  }
+  return nullptr;
+}
+
+NanoappLoadManager::FragmentResult NanoappLoadManager::validateFragment(
+    const LoadTransaction *transaction, uint16_t hostClientId,
+    uint32_t transactionId, uint32_t fragmentId) const {
+  FragmentResult result = FragmentResult::FAILED;
+  if (transaction == nullptr) {
+    LOGE("No pending load transaction exists for host %" PRIu16
+         " transaction %" PRIu32,
+         hostClientId, transactionId);
   } else {
-    const FragmentedLoadInfo &info = mCurrentLoadInfo;
-    valid = (info.hostClientId == hostClientId &&
-             info.transactionId == transactionId &&
-             info.nextFragmentId == fragmentId);
-    if (!valid) {
+    const FragmentedLoadInfo &info = transaction->info;
+    if (info.nextFragmentId == fragmentId) {
+      result = FragmentResult::ACCEPTED;
+    } else if (info.windowSize > 0) {
+      // The host resends the fragments following the last one acknowledged,
+      // so the transaction can carry on.
+      LOGW("Dropping out of order load fragment %" PRIu32 " for host %" PRIu16
+           " transaction %" PRIu32 ", expected fragment %" PRIu32,
+           fragmentId, hostClientId, transactionId, info.nextFragmentId);
+      result = FragmentResult::IGNORED;
+    } else {
       LOGE("Unexpected load fragment: expected host %" PRIu16
            "transaction %" PRIu32 " fragment %" PRIu32
            ", received host %" PRIu16 " transaction %" PRIu32
@@ -88,7 +220,48 @@ bool NanoappLoadManager::validateFragment(uint16_t hostClientId,
     }
   }
 
-  return valid;
+  return result;
+}
+
+bool NanoappLoadManager::useBinaryCache(LoadTransaction *transaction,
+                                        uint64_t appId, uint32_t appVersion,
+                                        size_t binaryLen, uint64_t binaryHash) {
+  bool success = true;
+#ifdef CHRE_NANOAPP_BINARY_CACHE_ENABLED
+  if (!mIsBinaryCacheInitialized) {
+    size_t regionSize = 0;
+    void *region = getNanoappBinaryCacheRegion(&regionSize);
+    mBinaryCache.init(region, regionSize);
+    mIsBinaryCacheInitialized = true;
+  }
+
+  const void *binary =
+      mBinaryCache.find(appId, appVersion, binaryHash, binaryLen);
+  if (binary != nullptr) {
+    LOGI("Loading app ID 0x%016" PRIx64 " from its retained binary", appId);
+    success = transaction->nanoapp->copyNanoappFragment(binary, binaryLen);
+  } else {
+    transaction->isStoringBinary =
+        mBinaryCache.startStore(appId, appVersion, binaryHash, binaryLen);
+  }
+#else
+  UNUSED_VAR(transaction);
+  UNUSED_VAR(appId);
+  UNUSED_VAR(appVersion);
+  UNUSED_VAR(binaryLen);
+  UNUSED_VAR(binaryHash);
+#endif  // CHRE_NANOAPP_BINARY_CACHE_ENABLED
+  return success;
+}
+
+void NanoappLoadManager::resetTransaction(LoadTransaction *transaction) {
+#ifdef CHRE_NANOAPP_BINARY_CACHE_ENABLED
+  if (transaction->isStoringBinary) {
+    mBinaryCache.abortStore();
+    transaction->isStoringBinary = false;
+  }
+#endif  // CHRE_NANOAPP_BINARY_CACHE_ENABLED
+  transaction->nanoapp.reset(nullptr);
 }
 
 }  // namespace chre
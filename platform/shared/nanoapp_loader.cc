@@ -27,9 +27,11 @@
 #include "chre/platform/shared/debug_dump.h"
 #include "chre/platform/shared/memory.h"
 #include "chre/platform/shared/nanoapp/tokenized_log.h"
+#include "chre/platform/system_time.h"
 #include "chre/target_platform/platform_cache_management.h"
 #include "chre/util/dynamic_vector.h"
 #include "chre/util/macros.h"
+#include "chre/util/nanoapp/shared_payload.h"
 
 #ifdef CHREX_SYMBOL_EXTENSIONS
 #include "chre/extensions/platform/symbol_list.h"
@@ -45,9 +47,145 @@ namespace {
 using ElfHeader = ElfW(Ehdr);
 using ProgramHeader = ElfW(Phdr);
 
+/**
+ * A symbol exported to nanoapps. The address of the symbol is returned by a
+ * function, rather than stored, so that the table of exported symbols can be
+ * constexpr and their names hashed at compile time.
+ */
 struct ExportedData {
-  void *data;
   const char *dataName;
+  size_t dataNameLen;
+  void *(*getData)();
+};
+
+constexpr size_t constStrlen(const char *str) {
+  size_t len = 0;
+  while (str[len] != '\0') {
+    len++;
+  }
+  return len;
+}
+
+/**
+ * Hashes a symbol name. The seed selects one of a family of hash functions.
+ */
+constexpr uint32_t hashSymbolName(const char *name, size_t nameLen,
+                                  uint32_t seed) {
+  // FNV-1a, followed by the MurmurHash3 finalizer to mix the low bits which
+  // are used to index the table.
+  uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+  for (size_t i = 0; i < nameLen; i++) {
+    hash = (hash ^ static_cast<uint8_t>(name[i])) * 16777619u;
+  }
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+/**
+ * A perfect hash table over the names of a table of exported symbols, built at
+ * compile time using hash and displace. A name is first hashed with seed 0 to
+ * pick a bucket. The bucket's displacement is then used as the seed of a
+ * second hash, which picks the only slot the name can be in. Displacements
+ * are chosen, largest bucket first, so that no two names share a slot.
+ */
+template <size_t kNumSymbols>
+struct ExportedDataHashTable {
+  static constexpr size_t kNumBuckets = (kNumSymbols + 1) / 2;
+  static constexpr size_t kNumSlots = 2 * kNumSymbols;
+  //! With twice as many slots as names, the names of a bucket are placed
+  //! within a few displacements, so the search is bounded to keep building
+  //! the table at compile time cheap, failing the build if it's exceeded.
+  static constexpr uint16_t kMaxDisplacement = 64;
+  static constexpr uint16_t kEmptySlot = UINT16_MAX;
+  static_assert(kNumSymbols < kEmptySlot, "Too many exported symbols");
+
+  //! The seed of the second hash of the names in each bucket.
+  uint16_t displacements[kNumBuckets] = {};
+  //! The index in the table of symbols of the name in each slot.
+  uint16_t slots[kNumSlots] = {};
+  //! Whether the table could be built, which fails if names are duplicated or
+  //! a bucket can't be placed within kMaxDisplacement.
+  bool valid = false;
+
+  static constexpr size_t getBucket(const char *name, size_t nameLen) {
+    return hashSymbolName(name, nameLen, 0 /* seed */) % kNumBuckets;
+  }
+
+  constexpr size_t getSlot(const char *name, size_t nameLen) const {
+    return hashSymbolName(name, nameLen,
+                          displacements[getBucket(name, nameLen)]) %
+           kNumSlots;
+  }
+
+  constexpr explicit ExportedDataHashTable(
+      const ExportedData (&symbols)[kNumSymbols]) {
+    for (size_t i = 0; i < kNumSlots; i++) {
+      slots[i] = kEmptySlot;
+    }
+
+    size_t buckets[kNumSymbols] = {};
+    size_t bucketSizes[kNumBuckets] = {};
+    size_t maxBucketSize = 0;
+    for (size_t i = 0; i < kNumSymbols; i++) {
+      buckets[i] = getBucket(symbols[i].dataName, symbols[i].dataNameLen);
+      bucketSizes[buckets[i]]++;
+      if (bucketSizes[buckets[i]] > maxBucketSize) {
+        maxBucketSize = bucketSizes[buckets[i]];
+      }
+    }
+
+    valid = true;
+    for (size_t size = maxBucketSize; size > 0 && valid; size--) {
+      for (size_t bucket = 0; bucket < kNumBuckets && valid; bucket++) {
+        if (bucketSizes[bucket] == size) {
+          valid = placeBucket(symbols, buckets, bucket);
+        }
+      }
+    }
+  }
+
+ private:
+  /**
+   * Finds a displacement that puts the names of a bucket in free slots, and
+   * fills those slots.
+   */
+  constexpr bool placeBucket(const ExportedData (&symbols)[kNumSymbols],
+                             const size_t (&buckets)[kNumSymbols],
+                             size_t bucket) {
+    for (uint16_t displacement = 1; displacement <= kMaxDisplacement;
+         displacement++) {
+      displacements[bucket] = displacement;
+      bool placed = true;
+      for (size_t i = 0; i < kNumSymbols && placed; i++) {
+        if (buckets[i] == bucket) {
+          size_t slot = getSlot(symbols[i].dataName, symbols[i].dataNameLen);
+          if (slots[slot] == kEmptySlot) {
+            slots[slot] = static_cast<uint16_t>(i);
+          } else {
+            placed = false;
+          }
+        }
+      }
+      if (placed) {
+        return true;
+      }
+
+      // Undo the placement of the names of this bucket.
+      for (size_t i = 0; i < kNumSymbols; i++) {
+        if (buckets[i] == bucket) {
+          size_t slot = getSlot(symbols[i].dataName, symbols[i].dataNameLen);
+          if (slots[slot] == i) {
+            slots[slot] = kEmptySlot;
+          }
+        }
+      }
+    }
+    return false;
+  }
 };
 
 //! If non-null, a nanoapp is currently being loaded. This allows certain C
@@ -147,6 +285,16 @@ void __cxa_pure_virtual(void) {
   chreAbort(CHRE_ERROR /* abortCode */);
 }
 
+// Entries of kExportedData are built through a function returning their
+// address, see ExportedData.
+#pragma push_macro("ADD_EXPORTED_SYMBOL")
+#undef ADD_EXPORTED_SYMBOL
+#define ADD_EXPORTED_SYMBOL(function_name, function_string)     \
+  {                                                             \
+    function_string, constStrlen(function_string),              \
+        []() { return reinterpret_cast<void *>(function_name); } \
+  }
+
 // TODO(karthikmb/stange): While this array was hand-coded for simple
 // "hello-world" prototyping, the list of exported symbols must be
 // generated to minimize runtime errors and build breaks.
@@ -154,7 +302,7 @@ void __cxa_pure_virtual(void) {
 // Disable deprecation warning so that deprecated symbols in the array
 // can be exported for older nanoapps and tests.
 CHRE_DEPRECATED_PREAMBLE
-const ExportedData kExportedData[] = {
+constexpr ExportedData kExportedData[] = {
     /* libmath overrides and symbols */
     ADD_EXPORTED_SYMBOL(asinOverride, "asin"),
     ADD_EXPORTED_SYMBOL(atan2Override, "atan2"),
@@ -261,6 +409,9 @@ const ExportedData kExportedData[] = {
     ADD_EXPORTED_C_SYMBOL(chreSensorFindDefault),
     ADD_EXPORTED_C_SYMBOL(chreSensorFlushAsync),
     ADD_EXPORTED_C_SYMBOL(chreSensorGetThreeAxisBias),
+    ADD_EXPORTED_C_SYMBOL(chreSharedPayloadAlloc),
+    ADD_EXPORTED_C_SYMBOL(chreSharedPayloadRelease),
+    ADD_EXPORTED_C_SYMBOL(chreSharedPayloadRetain),
     ADD_EXPORTED_C_SYMBOL(chreTimerCancel),
     ADD_EXPORTED_C_SYMBOL(chreTimerSet),
     ADD_EXPORTED_C_SYMBOL(chreUserSettingConfigureEvents),
@@ -284,6 +435,12 @@ const ExportedData kExportedData[] = {
 };
 CHRE_DEPRECATED_EPILOGUE
 // clang-format on
+#pragma pop_macro("ADD_EXPORTED_SYMBOL")
+
+constexpr ExportedDataHashTable<ARRAY_SIZE(kExportedData)>
+    kExportedDataHashTable(kExportedData);
+static_assert(kExportedDataHashTable.valid,
+              "Exported symbol names must be unique and fit in the hash table");
 
 }  // namespace
 
@@ -311,6 +468,36 @@ NanoappLoader *NanoappLoader::create(void *elfInput, bool mapIntoTcm) {
   return nullptr;
 }
 
+NanoappLoader *NanoappLoader::createStreaming(size_t binaryLen,
+                                              bool mapIntoTcm) {
+  if (binaryLen < sizeof(ElfHeader)) {
+    LOGE("Binary size %zu is too small for an ELF header", binaryLen);
+    return nullptr;
+  }
+
+  auto *loader =
+      static_cast<NanoappLoader *>(memoryAllocDram(sizeof(NanoappLoader)));
+  if (loader == nullptr) {
+    LOG_OOM();
+    return nullptr;
+  }
+  new (loader) NanoappLoader(nullptr /* elfInput */, mapIntoTcm);
+
+  // Start by receiving the ELF header, which gives the size of the rest of the
+  // headers.
+  loader->mBinary = static_cast<uint8_t *>(memoryAllocDram(sizeof(ElfHeader)));
+  if (loader->mBinary == nullptr) {
+    LOG_OOM();
+    loader->~NanoappLoader();
+    memoryFreeDram(loader);
+    return nullptr;
+  }
+  loader->mIsStreaming = true;
+  loader->mBinaryLen = binaryLen;
+  loader->mHeadersSize = sizeof(ElfHeader);
+  return loader;
+}
+
 void NanoappLoader::destroy(NanoappLoader *loader) {
   loader->close();
   // TODO(b/151847750): Modify utilities to support free'ing from regions other
@@ -321,11 +508,12 @@ void NanoappLoader::destroy(NanoappLoader *loader) {
 
 void *NanoappLoader::findExportedSymbol(const char *name) {
   size_t nameLen = strlen(name);
-  for (size_t i = 0; i < ARRAY_SIZE(kExportedData); i++) {
-    if (nameLen == strlen(kExportedData[i].dataName) &&
-        strncmp(name, kExportedData[i].dataName, nameLen) == 0) {
-      return kExportedData[i].data;
-    }
+  size_t slot = kExportedDataHashTable.getSlot(name, nameLen);
+  uint16_t index = kExportedDataHashTable.slots[slot];
+  if (index != kExportedDataHashTable.kEmptySlot &&
+      nameLen == kExportedData[index].dataNameLen &&
+      memcmp(name, kExportedData[index].dataName, nameLen) == 0) {
+    return kExportedData[index].getData();
   }
 
 #ifdef CHREX_SYMBOL_EXTENSIONS
@@ -340,32 +528,134 @@ void *NanoappLoader::findExportedSymbol(const char *name) {
   return nullptr;
 }
 
+bool NanoappLoader::copyFragment(const void *fragment, size_t fragmentLen) {
+  CHRE_ASSERT(mIsStreaming);
+  if (mBinary == nullptr) {
+    LOGE("Nanoapp binary failed to load");
+    return false;
+  }
+  if (fragmentLen > mBinaryLen - mBytesReceived) {
+    LOGE("Overflow: cannot load %zu bytes to %zu/%zu nanoapp binary",
+         fragmentLen, mBytesReceived, mBinaryLen);
+    return false;
+  }
+
+  Nanoseconds copyStartTime = SystemTime::getMonotonicTime();
+  const auto *data = static_cast<const uint8_t *>(fragment);
+  bool success = true;
+  while (success && fragmentLen > 0) {
+    size_t chunkLen = fragmentLen;
+    if (mBytesReceived < mHeadersSize) {
+      chunkLen = MIN(chunkLen, mHeadersSize - mBytesReceived);
+      memcpy(mBinary + mBytesReceived, data, chunkLen);
+      if (mBytesReceived + chunkLen == mHeadersSize) {
+        mBytesReceived += chunkLen;
+        success = onStreamedHeadersReceived();
+      } else {
+        mBytesReceived += chunkLen;
+      }
+    } else {
+      copyStreamedData(mBytesReceived, data, chunkLen);
+      mBytesReceived += chunkLen;
+    }
+    data += chunkLen;
+    fragmentLen -= chunkLen;
+  }
+  mLoadTime = mLoadTime + (SystemTime::getMonotonicTime() - copyStartTime);
+
+  if (!success) {
+    freeAllocatedData();
+  }
+  return success;
+}
+
+bool NanoappLoader::finishStreaming() {
+  CHRE_ASSERT(mIsStreaming);
+  bool success = false;
+  if (mBytesReceived != mBinaryLen) {
+    LOGE("Only received %zu/%zu bytes of the nanoapp binary", mBytesReceived,
+         mBinaryLen);
+  } else if (mMapping == nullptr) {
+    LOGE("Nanoapp binary ended before its headers");
+  } else {
+    Nanoseconds loadStartTime = SystemTime::getMonotonicTime();
+    bool copied = copyAndVerifySectionNames();
+    mLoadTime = mLoadTime + (SystemTime::getMonotonicTime() - loadStartTime);
+    if (!copied) {
+      LOGE("Failed to copy and verify elf headers");
+    } else {
+      success = relocateAndInitialize();
+    }
+  }
+
+  if (!success) {
+    freeAllocatedData();
+  }
+  return success;
+}
+
 bool NanoappLoader::open() {
+  Nanoseconds loadStartTime = SystemTime::getMonotonicTime();
   if (!copyAndVerifyHeaders()) {
     LOGE("Failed to copy and verify elf headers");
   } else if (!createMappings()) {
     LOGE("Failed to create mappings");
-  } else if (!fixRelocations()) {
+  } else {
+    mLoadTime = SystemTime::getMonotonicTime() - loadStartTime;
+    if (relocateAndInitialize()) {
+      return true;
+    }
+  }
+  freeAllocatedData();
+  return false;
+}
+
+bool NanoappLoader::relocateAndInitialize() {
+  Nanoseconds relocationStartTime = SystemTime::getMonotonicTime();
+  // Symbols are resolved without the cache if it can't be allocated.
+  size_t resolvedSymbolCacheSize =
+      (mDynamicSymbolTableSize / sizeof(ElfSym)) * sizeof(void *);
+  mResolvedSymbolCache =
+      static_cast<void **>(memoryAllocDram(resolvedSymbolCacheSize));
+  if (mResolvedSymbolCache != nullptr) {
+    memset(mResolvedSymbolCache, 0, resolvedSymbolCacheSize);
+  }
+
+  bool success = false;
+  if (!fixRelocations()) {
     LOGE("Failed to fix relocations");
   } else if (!resolveGot()) {
     LOGE("Failed to resolve GOT");
   } else {
+    success = true;
+  }
+  memoryFreeDram(mResolvedSymbolCache);
+  mResolvedSymbolCache = nullptr;
+  mRelocationTime = SystemTime::getMonotonicTime() - relocationStartTime;
+
+  if (success) {
     // Wipe caches before calling init array to ensure initializers are not in
     // the data cache.
     wipeSystemCaches(reinterpret_cast<uintptr_t>(mMapping), mMemorySpan);
-    if (!callInitArray()) {
+    Nanoseconds initArrayStartTime = SystemTime::getMonotonicTime();
+    success = callInitArray();
+    mInitArrayTime = SystemTime::getMonotonicTime() - initArrayStartTime;
+    if (!success) {
       LOGE("Failed to perform static init");
     } else {
-      return true;
+      mIsOpen = true;
     }
   }
-  freeAllocatedData();
-  return false;
+  return success;
 }
 
 void NanoappLoader::close() {
-  callAtexitFunctions();
-  callTerminatorArray();
+  // A streamed binary may be closed before it was opened.
+  if (mIsOpen) {
+    callAtexitFunctions();
+    callTerminatorArray();
+    mIsOpen = false;
+  }
   freeAllocatedData();
 }
 
@@ -393,13 +683,15 @@ void NanoappLoader::registerAtexitFunction(struct AtExitCallback &cb) {
 void NanoappLoader::mapBss(const ProgramHeader *hdr) {
   // if the memory size of this segment exceeds the file size zero fill the
   // difference.
-  LOGV("Program Hdr mem sz: %u file size: %u", hdr->p_memsz, hdr->p_filesz);
+  LOGV("Program Hdr mem sz: %zu file size: %zu",
+       static_cast<size_t>(hdr->p_memsz), static_cast<size_t>(hdr->p_filesz));
   if (hdr->p_memsz > hdr->p_filesz) {
     ElfAddr endOfFile = hdr->p_vaddr + hdr->p_filesz + mLoadBias;
     ElfAddr endOfMem = hdr->p_vaddr + hdr->p_memsz + mLoadBias;
     if (endOfMem > endOfFile) {
       auto deltaMem = endOfMem - endOfFile;
-      LOGV("Zeroing out %u from page %x", deltaMem, endOfFile);
+      LOGV("Zeroing out %zu from page %zx", static_cast<size_t>(deltaMem),
+           static_cast<size_t>(endOfFile));
       memset(reinterpret_cast<void *>(endOfFile), 0, deltaMem);
     }
   }
@@ -414,24 +706,21 @@ bool NanoappLoader::callInitArray() {
   // TODO(b/151847750): ELF can have other sections like .init, .preinit, .fini
   // etc. Be sure to look for those if they end up being something that should
   // be supported for nanoapps.
-  for (size_t i = 0; i < mNumSectionHeaders; ++i) {
-    const char *name = getSectionHeaderName(mSectionHeadersPtr[i].sh_name);
-    if (strncmp(name, kInitArrayName, strlen(kInitArrayName)) == 0) {
-      LOGV("Invoking init function");
-      uintptr_t initArray =
-          static_cast<uintptr_t>(mLoadBias + mSectionHeadersPtr[i].sh_addr);
-      uintptr_t offset = 0;
-      while (offset < mSectionHeadersPtr[i].sh_size) {
-        ElfAddr *funcPtr = reinterpret_cast<ElfAddr *>(initArray + offset);
-        uintptr_t initFunction = static_cast<uintptr_t>(*funcPtr);
-        ((void (*)())initFunction)();
-        offset += sizeof(initFunction);
-        if (gStaticInitFailure) {
-          success = false;
-          break;
-        }
+  SectionHeader *initArrayHeader = getSectionHeader(kInitArrayName);
+  if (initArrayHeader != nullptr) {
+    LOGV("Invoking init function");
+    uintptr_t initArray =
+        static_cast<uintptr_t>(mLoadBias + initArrayHeader->sh_addr);
+    uintptr_t offset = 0;
+    while (offset < initArrayHeader->sh_size) {
+      ElfAddr *funcPtr = reinterpret_cast<ElfAddr *>(initArray + offset);
+      uintptr_t initFunction = static_cast<uintptr_t>(*funcPtr);
+      ((void (*)())initFunction)();
+      offset += sizeof(initFunction);
+      if (gStaticInitFailure) {
+        success = false;
+        break;
       }
-      break;
     }
   }
 
@@ -447,15 +736,29 @@ uintptr_t NanoappLoader::roundDownToAlign(uintptr_t virtualAddr,
 }
 
 void NanoappLoader::freeAllocatedData() {
-  if (mIsTcmBinary) {
-    nanoappBinaryFree(mMapping);
-  } else {
-    nanoappBinaryDramFree(mMapping);
+  if (mMapping != nullptr) {
+    if (mIsTcmBinary) {
+      nanoappBinaryFree(mMapping);
+    } else {
+      nanoappBinaryDramFree(mMapping);
+    }
+    mMapping = nullptr;
   }
   memoryFreeDram(mSectionHeadersPtr);
+  mSectionHeadersPtr = nullptr;
+  mNumSectionHeaders = 0;
   memoryFreeDram(mSectionNamesPtr);
+  mSectionNamesPtr = nullptr;
+  mDynamicStringTablePtr = nullptr;
   mDynamicSymbolTablePtr = nullptr;
   mDynamicSymbolTableSize = 0;
+
+  // The binary of a streamed load is owned by the loader.
+  if (mIsStreaming) {
+    memoryFreeDram(mBinary);
+    mBinary = nullptr;
+    mHeadersSize = 0;
+  }
 }
 
 bool NanoappLoader::verifyElfHeader() {
@@ -477,15 +780,21 @@ bool NanoappLoader::verifyElfHeader() {
 }
 
 bool NanoappLoader::verifyProgramHeaders() {
-  // This is a minimal check for now -
-  // there should be at least one load segment.
+  // There should be at least one load segment, and no segment can have more
+  // data in the file than in memory, as it would overflow its mapping.
+  bool foundLoadSegment = false;
   for (size_t i = 0; i < getProgramHeaderArraySize(); ++i) {
-    if (getProgramHeaderArray()[i].p_type == PT_LOAD) {
-      return true;
+    const ProgramHeader &ph = getProgramHeaderArray()[i];
+    if (ph.p_filesz > ph.p_memsz) {
+      LOGE("Segment %zu has more file data than memory", i);
+      return false;
     }
+    foundLoadSegment |= (ph.p_type == PT_LOAD);
   }
-  LOGE("No load segment found");
-  return false;
+  if (!foundLoadSegment) {
+    LOGE("No load segment found");
+  }
+  return foundLoadSegment;
 }
 
 const char *NanoappLoader::getSectionHeaderName(size_t headerOffset) {
@@ -498,6 +807,10 @@ const char *NanoappLoader::getSectionHeaderName(size_t headerOffset) {
 
 NanoappLoader::SectionHeader *NanoappLoader::getSectionHeader(
     const char *headerName) {
+  if (mIsStreaming) {
+    return getStreamedSectionHeader(headerName);
+  }
+
   SectionHeader *rv = nullptr;
   for (size_t i = 0; i < mNumSectionHeaders; ++i) {
     const char *name = getSectionHeaderName(mSectionHeadersPtr[i].sh_name);
@@ -509,6 +822,31 @@ NanoappLoader::SectionHeader *NanoappLoader::getSectionHeader(
   return rv;
 }
 
+uint8_t *NanoappLoader::getFileData(size_t offset, size_t size) {
+  if (!mIsStreaming) {
+    return mBinary + offset;
+  }
+
+  if (offset > mBinaryLen || size > mBinaryLen - offset) {
+    return nullptr;
+  }
+  if (offset + size <= mHeadersSize) {
+    return mBinary + offset;
+  }
+  if (mMapping != nullptr) {
+    ProgramHeader *programHeaders = getProgramHeaderArray();
+    for (size_t i = 0; i < getProgramHeaderArraySize(); ++i) {
+      const ProgramHeader &ph = programHeaders[i];
+      if (ph.p_type == PT_LOAD && offset >= ph.p_offset &&
+          offset + size <= ph.p_offset + ph.p_filesz) {
+        return reinterpret_cast<uint8_t *>(ph.p_vaddr + mLoadBias +
+                                           (offset - ph.p_offset));
+      }
+    }
+  }
+  return nullptr;
+}
+
 ProgramHeader *NanoappLoader::getProgramHeaderArray() {
   return reinterpret_cast<ProgramHeader *>(mBinary + getElfHeader()->e_phoff);
 }
@@ -518,20 +856,31 @@ size_t NanoappLoader::getProgramHeaderArraySize() {
 }
 
 bool NanoappLoader::verifyDynamicTables() {
+  // For a streamed binary, the dynamic tables are read from the mapping, as
+  // they are part of a load segment.
   SectionHeader *dynamicStringTablePtr = getSectionHeader(kDynstrTableName);
   if (dynamicStringTablePtr == nullptr) {
     LOGE("Failed to find table %s", kDynstrTableName);
     return false;
   }
-  mDynamicStringTablePtr =
-      reinterpret_cast<char *>(mBinary + dynamicStringTablePtr->sh_offset);
+  mDynamicStringTablePtr = reinterpret_cast<char *>(getFileData(
+      dynamicStringTablePtr->sh_offset, dynamicStringTablePtr->sh_size));
+  if (mDynamicStringTablePtr == nullptr) {
+    LOGE("Table %s is out of bounds", kDynstrTableName);
+    return false;
+  }
 
   SectionHeader *dynamicSymbolTablePtr = getSectionHeader(kDynsymTableName);
   if (dynamicSymbolTablePtr == nullptr) {
     LOGE("Failed to find table %s", kDynsymTableName);
     return false;
   }
-  mDynamicSymbolTablePtr = (mBinary + dynamicSymbolTablePtr->sh_offset);
+  mDynamicSymbolTablePtr = getFileData(dynamicSymbolTablePtr->sh_offset,
+                                       dynamicSymbolTablePtr->sh_size);
+  if (mDynamicSymbolTablePtr == nullptr) {
+    LOGE("Table %s is out of bounds", kDynsymTableName);
+    return false;
+  }
   mDynamicSymbolTableSize = dynamicSymbolTablePtr->sh_size;
 
   return true;
@@ -551,27 +900,53 @@ bool NanoappLoader::copyAndVerifyHeaders() {
   }
 
   // Load Section Headers
+  if (!allocateSectionHeaders()) {
+    return false;
+  }
+  memcpy(mSectionHeadersPtr, (mBinary + getElfHeader()->e_shoff),
+         sizeof(SectionHeader) * mNumSectionHeaders);
+
+  return copyAndVerifySectionNames();
+}
+
+bool NanoappLoader::allocateSectionHeaders() {
   ElfHeader *elfHeader = getElfHeader();
   size_t sectionHeaderSizeBytes = sizeof(SectionHeader) * elfHeader->e_shnum;
+  if (mIsStreaming &&
+      (elfHeader->e_shoff > mBinaryLen ||
+       sectionHeaderSizeBytes > mBinaryLen - elfHeader->e_shoff)) {
+    LOGE("Section headers are out of bounds");
+    return false;
+  }
+
   mSectionHeadersPtr =
       static_cast<SectionHeader *>(memoryAllocDram(sectionHeaderSizeBytes));
   if (mSectionHeadersPtr == nullptr) {
     LOG_OOM();
     return false;
   }
-  memcpy(mSectionHeadersPtr, (mBinary + elfHeader->e_shoff),
-         sectionHeaderSizeBytes);
   mNumSectionHeaders = elfHeader->e_shnum;
+  return true;
+}
 
+bool NanoappLoader::copyAndVerifySectionNames() {
   // Load section header names
-  SectionHeader &stringSection = mSectionHeadersPtr[elfHeader->e_shstrndx];
+  SectionHeader &stringSection = mSectionHeadersPtr[getElfHeader()->e_shstrndx];
   size_t sectionSize = stringSection.sh_size;
-  mSectionNamesPtr = static_cast<char *>(memoryAllocDram(sectionSize));
-  if (mSectionNamesPtr == nullptr) {
-    LOG_OOM();
-    return false;
+  if (mIsStreaming) {
+    if (stringSection.sh_offset > mBinaryLen ||
+        sectionSize > mBinaryLen - stringSection.sh_offset) {
+      LOGE("Section names are out of bounds");
+      return false;
+    }
+  } else {
+    mSectionNamesPtr = static_cast<char *>(memoryAllocDram(sectionSize));
+    if (mSectionNamesPtr == nullptr) {
+      LOG_OOM();
+      return false;
+    }
+    memcpy(mSectionNamesPtr, mBinary + stringSection.sh_offset, sectionSize);
   }
-  memcpy(mSectionNamesPtr, mBinary + stringSection.sh_offset, sectionSize);
 
   // Verify dynamic symbol table
   if (!verifyDynamicTables()) {
@@ -582,7 +957,215 @@ bool NanoappLoader::copyAndVerifyHeaders() {
   return true;
 }
 
+bool NanoappLoader::onStreamedHeadersReceived() {
+  ElfHeader *elfHeader = getElfHeader();
+  if (mHeadersSize == sizeof(ElfHeader)) {
+    if (!verifyElfHeader()) {
+      LOGE("ELF header is invalid");
+      return false;
+    }
+
+    // Grow the headers to include the program headers, which are expected to
+    // follow the ELF header.
+    size_t programHeadersSize = elfHeader->e_phnum * sizeof(ProgramHeader);
+    if (elfHeader->e_phoff < sizeof(ElfHeader) ||
+        elfHeader->e_phoff > mBinaryLen ||
+        programHeadersSize > mBinaryLen - elfHeader->e_phoff) {
+      LOGE("Program headers are out of bounds");
+      return false;
+    }
+    size_t headersSize = elfHeader->e_phoff + programHeadersSize;
+    auto *headers = static_cast<uint8_t *>(memoryAllocDram(headersSize));
+    if (headers == nullptr) {
+      LOG_OOM();
+      return false;
+    }
+    memcpy(headers, mBinary, sizeof(ElfHeader));
+    memoryFreeDram(mBinary);
+    mBinary = headers;
+    mHeadersSize = headersSize;
+    return (headersSize > sizeof(ElfHeader)) || onStreamedHeadersReceived();
+  }
+
+  if (!verifyProgramHeaders()) {
+    LOGE("Program headers are invalid");
+    return false;
+  }
+  if (!allocateSectionHeaders()) {
+    return false;
+  }
+
+  // The section names are scanned for in everything following the load
+  // segments, until the section headers tell where the section names are.
+  size_t loadEnd = 0;
+  ProgramHeader *programHeaders = getProgramHeaderArray();
+  for (size_t i = 0; i < getProgramHeaderArraySize(); ++i) {
+    const ProgramHeader &ph = programHeaders[i];
+    if (ph.p_type == PT_LOAD) {
+      if (ph.p_offset > mBinaryLen || ph.p_filesz > mBinaryLen - ph.p_offset) {
+        LOGE("Load segment %zu is out of bounds", i);
+        return false;
+      }
+      loadEnd = MAX(loadEnd, ph.p_offset + ph.p_filesz);
+    }
+  }
+  if (elfHeader->e_shoff < loadEnd) {
+    LOGE("Section headers must follow the load segments");
+    return false;
+  }
+  mSectionNameScanStart = MAX(loadEnd, mHeadersSize);
+  mSectionNameScanEnd = mSectionNameScanStart;
+
+  if (!allocateMappings()) {
+    LOGE("Failed to create mappings");
+    return false;
+  }
+
+  // The headers are part of the first load segment.
+  copyStreamedData(0 /* offset */, mBinary, mHeadersSize);
+  return true;
+}
+
+void NanoappLoader::copyStreamedData(size_t offset, const uint8_t *data,
+                                     size_t size) {
+  // Copies the part of the data within [start, start + len) to dest.
+  auto copyRange = [offset, data, size](uint8_t *dest, size_t start,
+                                        size_t len) {
+    size_t begin = MAX(offset, start);
+    size_t end = MIN(offset + size, start + len);
+    if (begin < end) {
+      memcpy(dest + (begin - start), data + (begin - offset), end - begin);
+    }
+  };
+
+  ProgramHeader *programHeaders = getProgramHeaderArray();
+  for (size_t i = 0; i < getProgramHeaderArraySize(); ++i) {
+    const ProgramHeader &ph = programHeaders[i];
+    if (ph.p_type == PT_LOAD) {
+      copyRange(reinterpret_cast<uint8_t *>(ph.p_vaddr + mLoadBias),
+                ph.p_offset, ph.p_filesz);
+    }
+  }
+  size_t sectionHeadersStart = getElfHeader()->e_shoff;
+  size_t sectionHeadersEnd =
+      sectionHeadersStart + sizeof(SectionHeader) * mNumSectionHeaders;
+  copyRange(reinterpret_cast<uint8_t *>(mSectionHeadersPtr),
+            sectionHeadersStart, sectionHeadersEnd - sectionHeadersStart);
+
+  // Scans the part of the data within [start, end) for section names.
+  auto scanRange = [this, offset, data, size](size_t start, size_t end) {
+    size_t begin = MAX(offset, start);
+    end = MIN(offset + size, end);
+    if (begin < end) {
+      scanStreamedSectionNames(begin, data + (begin - offset), end - begin);
+    }
+  };
+  scanRange(mSectionNameScanStart, sectionHeadersStart);
+  scanRange(MAX(mSectionNameScanStart, sectionHeadersEnd), mBinaryLen);
+}
+
+void NanoappLoader::scanStreamedSectionNames(size_t offset,
+                                             const uint8_t *data,
+                                             size_t size) {
+  // Names are only matched within contiguous data, as the section names table
+  // can't overlap with the section headers.
+  if (offset != mSectionNameScanEnd) {
+    mSectionNameWindowLen = 0;
+  }
+  mSectionNameScanEnd = offset + size;
+
+  for (size_t i = 0; i < size; ++i) {
+    size_t position = offset + i;
+    char c = static_cast<char>(data[i]);
+    if (c == '\0') {
+      // Matches the names terminated by this byte against the window.
+      for (size_t n = 0; n < kNumStreamedSectionNames; ++n) {
+        const char *name = kStreamedSectionNames[n];
+        size_t nameLen = strlen(name);
+        if (nameLen > mSectionNameWindowLen) {
+          continue;
+        }
+        size_t start = position - nameLen;
+        size_t j = 0;
+        while (j < nameLen &&
+               mSectionNameWindow[(start + j) %
+                                  kStreamedSectionNameWindowSize] == name[j]) {
+          ++j;
+        }
+        if (j == nameLen) {
+          // The most recent matches are kept, as the section names table
+          // usually follows the other data that is scanned.
+          size_t match =
+              mNumSectionNameMatches[n] % kMaxStreamedSectionNameMatches;
+          mSectionNameOffsets[n][match] = start;
+          ++mNumSectionNameMatches[n];
+        }
+      }
+    }
+    mSectionNameWindow[position % kStreamedSectionNameWindowSize] = c;
+    mSectionNameWindowLen =
+        MIN(mSectionNameWindowLen + 1, kStreamedSectionNameWindowSize);
+  }
+}
+
+NanoappLoader::SectionHeader *NanoappLoader::getStreamedSectionHeader(
+    const char *headerName) {
+  size_t n = 0;
+  while (n < kNumStreamedSectionNames &&
+         strcmp(headerName, kStreamedSectionNames[n]) != 0) {
+    ++n;
+  }
+  if (n == kNumStreamedSectionNames) {
+    LOGE("Section %s can't be looked up in a streamed binary", headerName);
+    return nullptr;
+  }
+
+  // A section matches if its name is found at a recorded position within the
+  // section names table.
+  const SectionHeader &stringSection =
+      mSectionHeadersPtr[getElfHeader()->e_shstrndx];
+  size_t nameSize = strlen(headerName) + 1;
+  size_t numMatches =
+      MIN(mNumSectionNameMatches[n], kMaxStreamedSectionNameMatches);
+  for (size_t i = 0; i < mNumSectionHeaders; ++i) {
+    size_t nameOffset = mSectionHeadersPtr[i].sh_name;
+    if (nameOffset == 0 || nameOffset > stringSection.sh_size ||
+        nameSize > stringSection.sh_size - nameOffset) {
+      continue;
+    }
+    for (size_t match = 0; match < numMatches; ++match) {
+      if (stringSection.sh_offset + nameOffset ==
+          mSectionNameOffsets[n][match]) {
+        return &mSectionHeadersPtr[i];
+      }
+    }
+  }
+  return nullptr;
+}
+
 bool NanoappLoader::createMappings() {
+  if (!allocateMappings()) {
+    return false;
+  }
+
+  ProgramHeader *programHeaders = getProgramHeaderArray();
+  for (size_t i = 0; i < getProgramHeaderArraySize(); ++i) {
+    const ProgramHeader *ph = &programHeaders[i];
+    if (ph->p_type == PT_LOAD) {
+      ElfAddr segStart = ph->p_vaddr + mLoadBias;
+      void *startPage = reinterpret_cast<void *>(segStart);
+      void *binaryStartPage = mBinary + ph->p_offset;
+      size_t segmentLen = ph->p_filesz;
+
+      LOGV("Mapping start page %p from %p with length %zu", startPage,
+           binaryStartPage, segmentLen);
+      memcpy(startPage, binaryStartPage, segmentLen);
+    }
+  }
+  return true;
+}
+
+bool NanoappLoader::allocateMappings() {
   // ELF needs pt_load segments to be in contiguous ascending order of
   // virtual addresses. So the first and last segs can be used to
   // calculate the entire address span of the image.
@@ -644,17 +1227,10 @@ bool NanoappLoader::createMappings() {
   }
 
   if (success) {
-    // Map the remaining segments
+    // Zero the part of the segments that isn't in the binary, the rest is
+    // copied by the caller
     for (const ProgramHeader *ph = first; ph <= last; ++ph) {
       if (ph->p_type == PT_LOAD) {
-        ElfAddr segStart = ph->p_vaddr + mLoadBias;
-        void *startPage = reinterpret_cast<void *>(segStart);
-        void *binaryStartPage = mBinary + ph->p_offset;
-        size_t segmentLen = ph->p_filesz;
-
-        LOGV("Mapping start page %p from %p with length %zu", startPage,
-             binaryStartPage, segmentLen);
-        memcpy(startPage, binaryStartPage, segmentLen);
         mapBss(ph);
       } else {
         LOGE("Non-load segment found between load segments");
@@ -691,6 +1267,12 @@ void *NanoappLoader::getSymbolTarget(const ElfSym *symbol) {
 }
 
 void *NanoappLoader::resolveData(size_t posInSymbolTable) {
+  if (mResolvedSymbolCache != nullptr &&
+      posInSymbolTable < mDynamicSymbolTableSize / sizeof(ElfSym) &&
+      mResolvedSymbolCache[posInSymbolTable] != nullptr) {
+    return mResolvedSymbolCache[posInSymbolTable];
+  }
+
   const ElfSym *symbol = getDynamicSymbol(posInSymbolTable);
   const char *dataName = getDataName(symbol);
   void *target = nullptr;
@@ -703,6 +1285,8 @@ void *NanoappLoader::resolveData(size_t posInSymbolTable) {
     }
     if (target == nullptr) {
       LOGE("Unable to find %s", dataName);
+    } else if (mResolvedSymbolCache != nullptr) {
+      mResolvedSymbolCache[posInSymbolTable] = target;
     }
   }
 
@@ -714,8 +1298,8 @@ NanoappLoader::DynamicHeader *NanoappLoader::getDynamicHeader() {
   ProgramHeader *programHeaders = getProgramHeaderArray();
   for (size_t i = 0; i < getProgramHeaderArraySize(); ++i) {
     if (programHeaders[i].p_type == PT_DYNAMIC) {
-      dyn = reinterpret_cast<DynamicHeader *>(programHeaders[i].p_offset +
-                                              mBinary);
+      dyn = reinterpret_cast<DynamicHeader *>(
+          getFileData(programHeaders[i].p_offset, programHeaders[i].p_filesz));
       break;
     }
   }
@@ -777,19 +1361,16 @@ void NanoappLoader::callAtexitFunctions() {
 }
 
 void NanoappLoader::callTerminatorArray() {
-  for (size_t i = 0; i < mNumSectionHeaders; ++i) {
-    const char *name = getSectionHeaderName(mSectionHeadersPtr[i].sh_name);
-    if (strncmp(name, kFiniArrayName, strlen(kFiniArrayName)) == 0) {
-      uintptr_t finiArray =
-          static_cast<uintptr_t>(mLoadBias + mSectionHeadersPtr[i].sh_addr);
-      uintptr_t offset = 0;
-      while (offset < mSectionHeadersPtr[i].sh_size) {
-        ElfAddr *funcPtr = reinterpret_cast<ElfAddr *>(finiArray + offset);
-        uintptr_t finiFunction = static_cast<uintptr_t>(*funcPtr);
-        ((void (*)())finiFunction)();
-        offset += sizeof(finiFunction);
-      }
-      break;
+  SectionHeader *finiArrayHeader = getSectionHeader(kFiniArrayName);
+  if (finiArrayHeader != nullptr) {
+    uintptr_t finiArray =
+        static_cast<uintptr_t>(mLoadBias + finiArrayHeader->sh_addr);
+    uintptr_t offset = 0;
+    while (offset < finiArrayHeader->sh_size) {
+      ElfAddr *funcPtr = reinterpret_cast<ElfAddr *>(finiArray + offset);
+      uintptr_t finiFunction = static_cast<uintptr_t>(*funcPtr);
+      ((void (*)())finiFunction)();
+      offset += sizeof(finiFunction);
     }
   }
 }
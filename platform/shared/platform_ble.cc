@@ -22,6 +22,7 @@
 #include "chre/platform/log.h"
 #include "chre/platform/shared/bt_snoop_log.h"
 #include "chre/platform/shared/pal_system_api.h"
+#include "chre/platform/tracing.h"
 #include "chre_api/chre/ble.h"
 
 namespace chre {
@@ -123,6 +124,7 @@ void PlatformBleBase::scanStatusChangeCallback(bool enabled,
 
 void PlatformBleBase::advertisingEventCallback(
     struct chreBleAdvertisementEvent *event) {
+  CHRE_TRACE_INSTANT("BLE advertising event", "pal");
   EventLoopManagerSingleton::get()
       ->getBleRequestManager()
       .handleAdvertisementEvent(event);
@@ -21,6 +21,7 @@
 #include "chre/core/event_loop_manager.h"
 #include "chre/platform/log.h"
 #include "chre/platform/shared/pal_system_api.h"
+#include "chre/platform/tracing.h"
 
 namespace chre {
 
@@ -107,6 +108,7 @@ void PlatformGnssBase::locationStatusChangeCallback(bool enabled,
 
 void PlatformGnssBase::locationEventCallback(
     struct chreGnssLocationEvent *event) {
+  CHRE_TRACE_INSTANT("GNSS location event", "pal");
   EventLoopManagerSingleton::get()
       ->getGnssManager()
       .getLocationSession()
@@ -151,6 +153,7 @@ void PlatformGnssBase::measurementStatusChangeCallback(bool enabled,
 
 void PlatformGnssBase::measurementEventCallback(
     struct chreGnssDataEvent *event) {
+  CHRE_TRACE_INSTANT("GNSS measurement event", "pal");
   EventLoopManagerSingleton::get()
       ->getGnssManager()
       .getMeasurementSession()
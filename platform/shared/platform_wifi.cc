@@ -21,6 +21,7 @@
 #include "chre/core/event_loop_manager.h"
 #include "chre/platform/log.h"
 #include "chre/platform/shared/pal_system_api.h"
+#include "chre/platform/tracing.h"
 #include "chre/util/system/wifi_util.h"
 
 namespace chre {
@@ -176,6 +177,7 @@ bool PlatformWifi::nanSubscribeCancel(uint32_t subscriptionId) {
 
 void PlatformWifiBase::rangingEventCallback(
     uint8_t errorCode, struct chreWifiRangingEvent *event) {
+  CHRE_TRACE_INSTANT("WiFi ranging event", "pal");
   EventLoopManagerSingleton::get()->getWifiRequestManager().handleRangingEvent(
       errorCode, event);
 }
@@ -188,11 +190,13 @@ void PlatformWifiBase::scanMonitorStatusChangeCallback(bool enabled,
 }
 
 void PlatformWifiBase::scanResponseCallback(bool pending, uint8_t errorCode) {
+  CHRE_TRACE_INSTANT("WiFi scan response", "pal");
   EventLoopManagerSingleton::get()->getWifiRequestManager().handleScanResponse(
       pending, errorCode);
 }
 
 void PlatformWifiBase::scanEventCallback(struct chreWifiScanEvent *event) {
+  CHRE_TRACE_INSTANT("WiFi scan event", "pal");
   EventLoopManagerSingleton::get()->getWifiRequestManager().handleScanEvent(
       event);
 }
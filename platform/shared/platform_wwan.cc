@@ -21,6 +21,7 @@
 #include "chre/core/event_loop_manager.h"
 #include "chre/platform/log.h"
 #include "chre/platform/shared/pal_system_api.h"
+#include "chre/platform/tracing.h"
 
 namespace chre {
 
@@ -86,6 +87,7 @@ void PlatformWwan::releaseCellInfoResult(chreWwanCellInfoResult *result) {
 
 void PlatformWwanBase::cellInfoResultCallback(
     struct chreWwanCellInfoResult *result) {
+  CHRE_TRACE_INSTANT("WWAN cell info result", "pal");
   EventLoopManagerSingleton::get()
       ->getWwanRequestManager()
       .handleCellInfoResult(result);
@@ -21,6 +21,7 @@
 #include "chre/core/event_loop_manager.h"
 #include "chre/platform/log.h"
 #include "chre/platform/shared/pal_system_api.h"
+#include "chre/platform/tracing.h"
 
 namespace chre {
 
@@ -137,6 +138,7 @@ void PlatformSensorManagerBase::samplingStatusUpdateCallback(
 
 void PlatformSensorManagerBase::dataEventCallback(uint32_t sensorHandle,
                                                   void *data) {
+  CHRE_TRACE_INSTANT("Sensor data event", "pal", sensorHandle);
   EventLoopManagerSingleton::get()
       ->getSensorRequestManager()
       .handleSensorDataEvent(sensorHandle, data);
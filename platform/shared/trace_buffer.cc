@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/platform/shared/trace_buffer.h"
+
+#include "chre/platform/system_time.h"
+#include "chre/util/lock_guard.h"
+
+#ifdef CHRE_TRACE_BUFFER_TASK_LOCAL_STORAGE_INDEX
+#include "FreeRTOS.h"
+#include "task.h"
+
+static_assert(CHRE_TRACE_BUFFER_TASK_LOCAL_STORAGE_INDEX + 1 <
+                  configNUM_THREAD_LOCAL_STORAGE_POINTERS,
+              "The trace buffer needs two task-local storage pointers");
+#endif  // CHRE_TRACE_BUFFER_TASK_LOCAL_STORAGE_INDEX
+
+namespace chre {
+namespace {
+
+//! The generation of the last TraceBuffer constructed.
+uint32_t gLastGeneration = 0;
+
+}  // anonymous namespace
+
+TraceBuffer::TraceBuffer() : mGeneration(++gLastGeneration) {}
+
+void TraceBuffer::record(TraceRecordType type, const char *label,
+                         const char *group, uint32_t traceId) {
+  ThreadRing *ring = getThreadRing();
+  if (ring == nullptr) {
+    mNumDropped.fetch_increment();
+    return;
+  }
+
+  // Only this thread writes to the ring, so the records between the counts
+  // can't change until writeCount is updated
+  uint32_t writeCount = ring->writeCount.load();
+  if (writeCount - ring->readCount.load() >= kRecordsPerThread) {
+    mNumDropped.fetch_increment();
+    return;
+  }
+
+  TraceRecord &record = ring->records[writeCount & (kRecordsPerThread - 1)];
+  record.timestampNs = SystemTime::getMonotonicTime().toRawNanoseconds();
+  record.label = label;
+  record.group = group;
+  record.traceId = traceId;
+  record.type = type;
+  ring->writeCount.store(writeCount + 1);
+}
+
+size_t TraceBuffer::getNumThreads() const {
+  uint32_t numThreads = mNumThreads.load();
+  return (numThreads < kMaxThreads) ? numThreads : kMaxThreads;
+}
+
+size_t TraceBuffer::read(size_t threadIndex, TraceRecord *records,
+                         size_t maxRecords) {
+  LockGuard<Mutex> lock(mReadMutex);
+  if (threadIndex >= getNumThreads()) {
+    return 0;
+  }
+
+  ThreadRing &ring = mRings[threadIndex];
+  uint32_t readCount = ring.readCount.load();
+  size_t numRecords = ring.writeCount.load() - readCount;
+  if (numRecords > maxRecords) {
+    numRecords = maxRecords;
+  }
+  for (size_t i = 0; i < numRecords; i++) {
+    records[i] = ring.records[(readCount + i) & (kRecordsPerThread - 1)];
+  }
+  ring.readCount.store(readCount + static_cast<uint32_t>(numRecords));
+  return numRecords;
+}
+
+uint32_t TraceBuffer::getAndResetNumDropped() {
+  return mNumDropped.exchange(0);
+}
+
+TraceBuffer::ThreadRing *TraceBuffer::getThreadRing() {
+  // The generation is kept alongside the ring so that a thread recording into
+  // another TraceBuffer, e.g. after the singleton is re-initialized, is
+  // assigned a new ring.
+#ifdef CHRE_TRACE_BUFFER_TASK_LOCAL_STORAGE_INDEX
+  // FreeRTOS tasks all share the thread_local variables of the toolchain, so
+  // they are kept in the storage pointers of the task instead.
+  constexpr BaseType_t kRingIndex = CHRE_TRACE_BUFFER_TASK_LOCAL_STORAGE_INDEX;
+  constexpr BaseType_t kGenerationIndex = kRingIndex + 1;
+
+  auto generation = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(
+      pvTaskGetThreadLocalStoragePointer(nullptr, kGenerationIndex)));
+  if (generation != mGeneration) {
+    uint32_t index = mNumThreads.fetch_increment();
+    vTaskSetThreadLocalStoragePointer(
+        nullptr, kGenerationIndex,
+        reinterpret_cast<void *>(static_cast<uintptr_t>(mGeneration)));
+    vTaskSetThreadLocalStoragePointer(
+        nullptr, kRingIndex, (index < kMaxThreads) ? &mRings[index] : nullptr);
+  }
+  return static_cast<ThreadRing *>(
+      pvTaskGetThreadLocalStoragePointer(nullptr, kRingIndex));
+#else
+  static thread_local uint32_t tGeneration = 0;
+  static thread_local ThreadRing *tRing = nullptr;
+
+  if (tGeneration != mGeneration) {
+    uint32_t index = mNumThreads.fetch_increment();
+    tGeneration = mGeneration;
+    tRing = (index < kMaxThreads) ? &mRings[index] : nullptr;
+  }
+  return tRing;
+#endif  // CHRE_TRACE_BUFFER_TASK_LOCAL_STORAGE_INDEX
+}
+
+void recordTrace(TraceRecordType type, const char *label, const char *group,
+                 uint32_t traceId) {
+  if (TraceBufferSingleton::isInitialized()) {
+    TraceBufferSingleton::get()->record(type, label, group, traceId);
+  }
+}
+
+//! Explicitly instantiate the TraceBufferSingleton to reduce codesize.
+template class Singleton<TraceBuffer>;
+
+}  // namespace chre
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_PLATFORM_SHARED_TRACE_BUFFER_TRACING_H_
+#define CHRE_PLATFORM_SHARED_TRACE_BUFFER_TRACING_H_
+
+#include "chre/platform/shared/trace_buffer.h"
+
+/**
+ * Implements the CHRE_TRACE_* macros by recording into the TraceBuffer, which
+ * the host reads with a TraceDataRequest. See chre/platform/tracing.h for the
+ * parameters of the macros.
+ *
+ * The records have a fixed size, so the data passed to the *_DATA macros is
+ * evaluated but not recorded.
+ */
+
+namespace chre {
+
+template <typename... Args>
+inline void ignoreTraceData(const Args &... /* args */) {}
+
+}  // namespace chre
+
+#define CHRE_TRACE_INSTANT(label, ...) \
+  ::chre::recordTrace(::chre::TraceRecordType::INSTANT, label, ##__VA_ARGS__)
+
+#define CHRE_TRACE_START(label, ...) \
+  ::chre::recordTrace(::chre::TraceRecordType::START, label, ##__VA_ARGS__)
+
+#define CHRE_TRACE_END(label, ...) \
+  ::chre::recordTrace(::chre::TraceRecordType::END, label, ##__VA_ARGS__)
+
+#define CHRE_TRACE_RECORD_DATA(type, label, group, traceId, firstData, ...) \
+  do {                                                                     \
+    ::chre::recordTrace(type, label, group, traceId);                      \
+    ::chre::ignoreTraceData(firstData, ##__VA_ARGS__);                     \
+  } while (0)
+
+#define CHRE_TRACE_INSTANT_DATA(label, dataFmtString, firstData, ...)     \
+  CHRE_TRACE_RECORD_DATA(::chre::TraceRecordType::INSTANT, label, nullptr, \
+                         0, firstData, ##__VA_ARGS__)
+
+#define CHRE_TRACE_INSTANT_DATA_GROUP(label, group, dataFmtString, firstData, \
+                                      ...)                                    \
+  CHRE_TRACE_RECORD_DATA(::chre::TraceRecordType::INSTANT, label, group, 0,   \
+                         firstData, ##__VA_ARGS__)
+
+#define CHRE_TRACE_INSTANT_DATA_TRACE_ID(label, group, trace_id,          \
+                                         dataFmtString, firstData, ...)   \
+  CHRE_TRACE_RECORD_DATA(::chre::TraceRecordType::INSTANT, label, group, \
+                         trace_id, firstData, ##__VA_ARGS__)
+
+#define CHRE_TRACE_START_DATA(label, dataFmtString, firstData, ...)     \
+  CHRE_TRACE_RECORD_DATA(::chre::TraceRecordType::START, label, nullptr, \
+                         0, firstData, ##__VA_ARGS__)
+
+#define CHRE_TRACE_START_DATA_GROUP(label, group, dataFmtString, firstData, \
+                                    ...)                                    \
+  CHRE_TRACE_RECORD_DATA(::chre::TraceRecordType::START, label, group, 0,   \
+                         firstData, ##__VA_ARGS__)
+
+#define CHRE_TRACE_START_DATA_TRACE_ID(label, group, trace_id, dataFmtString, \
+                                       firstData, ...)                        \
+  CHRE_TRACE_RECORD_DATA(::chre::TraceRecordType::START, label, group,        \
+                         trace_id, firstData, ##__VA_ARGS__)
+
+#define CHRE_TRACE_END_DATA(label, dataFmtString, firstData, ...)     \
+  CHRE_TRACE_RECORD_DATA(::chre::TraceRecordType::END, label, nullptr, \
+                         0, firstData, ##__VA_ARGS__)
+
+#define CHRE_TRACE_END_DATA_GROUP(label, group, dataFmtString, firstData, ...) \
+  CHRE_TRACE_RECORD_DATA(::chre::TraceRecordType::END, label, group, 0,        \
+                         firstData, ##__VA_ARGS__)
+
+#define CHRE_TRACE_END_DATA_TRACE_ID(label, group, trace_id, dataFmtString, \
+                                     firstData, ...)                        \
+  CHRE_TRACE_RECORD_DATA(::chre::TraceRecordType::END, label, group,        \
+                         trace_id, firstData, ##__VA_ARGS__)
+
+#endif  // CHRE_PLATFORM_SHARED_TRACE_BUFFER_TRACING_H_
@@ -78,6 +78,7 @@ enum class PendingMessageType {
   SelfTestResponse,
   MetricLog,
   NanConfigurationRequest,
+  NanoappMessageBatch,
 };
 
 struct PendingMessage {
@@ -511,6 +512,7 @@ extern "C" int chre_slpi_get_message_to_host(unsigned char *buffer,
       case PendingMessageType::SelfTestResponse:
       case PendingMessageType::MetricLog:
       case PendingMessageType::NanConfigurationRequest:
+      case PendingMessageType::NanoappMessageBatch:
         result = generateMessageFromBuilder(
             pendingMsg.data.builder, buffer, bufferSize, messageLen,
             pendingMsg.type == PendingMessageType::EncodedLogMessage);
@@ -594,6 +596,55 @@ bool HostLink::sendMessage(const MessageToHost *message) {
       PendingMessage(PendingMessageType::NanoappMessageToHost, message));
 }
 
+bool HostLink::sendMessageBatch(const MessageToHost *const *messages,
+                                size_t numMessages) {
+  struct MessageBatchData {
+    const MessageToHost *const *messages;
+    size_t numMessages;
+  };
+
+  auto msgBuilder = [](ChreFlatBufferBuilder &builder, void *cookie) {
+    const auto *data = static_cast<const MessageBatchData *>(cookie);
+    DynamicVector<NanoappMessageOffset> messageOffsets;
+    messageOffsets.reserve(data->numMessages);
+    for (size_t i = 0; i < data->numMessages; i++) {
+      const MessageToHost *msgToHost = data->messages[i];
+      HostProtocolChre::addNanoappMessageToBatch(
+          builder, messageOffsets, msgToHost->appId,
+          msgToHost->toHostData.messageType, msgToHost->toHostData.hostEndpoint,
+          msgToHost->message.data(), msgToHost->message.size(),
+          msgToHost->toHostData.appPermissions,
+          msgToHost->toHostData.messagePermissions,
+          msgToHost->toHostData.wokeHost);
+    }
+    HostProtocolChre::finishNanoappMessageBatch(builder, messageOffsets);
+  };
+
+  size_t initialSize = HostProtocolChre::kNanoappMessageBatchEncodingOverhead;
+  for (size_t i = 0; i < numMessages; i++) {
+    initialSize += messages[i]->message.size() +
+                   HostProtocolChre::kNanoappMessageEncodingOverhead;
+  }
+
+  MessageBatchData data;
+  data.messages = messages;
+  data.numMessages = numMessages;
+  bool success =
+      buildAndEnqueueMessage(PendingMessageType::NanoappMessageBatch,
+                             initialSize, msgBuilder, &data);
+
+  // The message payloads were copied into the encoded batch, so they can be
+  // released right away
+  if (success) {
+    auto &hostCommsManager =
+        EventLoopManagerSingleton::get()->getHostCommsManager();
+    for (size_t i = 0; i < numMessages; i++) {
+      hostCommsManager.onMessageToHostComplete(messages[i]);
+    }
+  }
+  return success;
+}
+
 bool HostLink::sendMessageDeliveryStatus(uint32_t /* messageSequenceNumber */,
                                          uint8_t /* errorCode */) {
   return false;
@@ -743,19 +794,23 @@ void sendAudioRelease() {
 void HostMessageHandlers::sendFragmentResponse(uint16_t hostClientId,
                                                uint32_t transactionId,
                                                uint32_t fragmentId,
-                                               bool success) {
+                                               bool success,
+                                               uint32_t fragmentWindowSize,
+                                               bool binaryResident) {
   struct FragmentedLoadInfoResponse {
     uint16_t hostClientId;
     uint32_t transactionId;
     uint32_t fragmentId;
     bool success;
+    uint32_t fragmentWindowSize;
+    bool binaryResident;
   };
 
   auto msgBuilder = [](ChreFlatBufferBuilder &builder, void *cookie) {
     auto *cbData = static_cast<FragmentedLoadInfoResponse *>(cookie);
     HostProtocolChre::encodeLoadNanoappResponse(
         builder, cbData->hostClientId, cbData->transactionId, cbData->success,
-        cbData->fragmentId);
+        cbData->fragmentId, cbData->fragmentWindowSize, cbData->binaryResident);
   };
 
   FragmentedLoadInfoResponse response = {
@@ -763,6 +818,8 @@ void HostMessageHandlers::sendFragmentResponse(uint16_t hostClientId,
       .transactionId = transactionId,
       .fragmentId = fragmentId,
       .success = success,
+      .fragmentWindowSize = fragmentWindowSize,
+      .binaryResident = binaryResident,
   };
   constexpr size_t kInitialBufferSize = 48;
   buildAndEnqueueMessage(PendingMessageType::LoadNanoappResponse,
@@ -828,11 +885,13 @@ void HostMessageHandlers::handleLoadNanoappRequest(
     uint16_t hostClientId, uint32_t transactionId, uint64_t appId,
     uint32_t appVersion, uint32_t appFlags, uint32_t targetApiVersion,
     const void *buffer, size_t bufferLen, const char *appFileName,
-    uint32_t fragmentId, size_t appBinaryLen, bool respondBeforeStart) {
+    uint32_t fragmentId, size_t appBinaryLen, bool respondBeforeStart,
+    uint32_t fragmentWindowSize, uint64_t appBinaryHash) {
   if (appFileName == nullptr) {
     loadNanoappData(hostClientId, transactionId, appId, appVersion, appFlags,
                     targetApiVersion, buffer, bufferLen, fragmentId,
-                    appBinaryLen, respondBeforeStart);
+                    appBinaryLen, respondBeforeStart, fragmentWindowSize,
+                    appBinaryHash);
     return;
   }
 
@@ -928,4 +987,9 @@ void HostMessageHandlers::handleNanConfigurationUpdate(bool enabled) {
 #endif  // CHRE_WIFI_NAN_SUPPORT_ENABLED
 }
 
+void HostMessageHandlers::handleTraceDataRequest(
+    uint16_t /* hostClientId */) {
+  LOGE("Trace data unsupported");
+}
+
 }  // namespace chre
@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_EXTENSIONS_PLATFORM_SYMBOL_LIST_H_
+#define CHRE_EXTENSIONS_PLATFORM_SYMBOL_LIST_H_
+
+// The vendor symbols exported by the nanoapp loader when it is built into the
+// tests, which are looked up once the symbols exported by CHRE were searched.
+
+#include "chre/platform/shared/loader_util.h"
+#include "chre/util/macros.h"
+
+extern "C" void chreTestVendorFunction(void);
+
+const ExportedData kVendorExportedData[] = {
+    ADD_EXPORTED_C_SYMBOL(chreTestVendorFunction),
+};
+
+#endif  // CHRE_EXTENSIONS_PLATFORM_SYMBOL_LIST_H_
@@ -16,7 +16,9 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "chre/core/event.h"
 #include "chre/platform/atomic.h"
@@ -42,6 +44,14 @@ class TestLogBufferCallback : public LogBufferCallbackInterface {
 static constexpr size_t kDefaultBufferSize = 1024;
 
 // Helpers
+bool captureDeferredLog(LogBuffer::DeferredLog *log, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  bool success = LogBuffer::captureDeferredLog(format, args, log);
+  va_end(args);
+  return success;
+}
+
 void copyStringWithOffset(char *destination, const char *source,
                           size_t sourceOffset) {
   size_t strlength = strlen(source + sourceOffset);
@@ -503,6 +513,261 @@ TEST(LogBuffer, GetLogDataLengthTest) {
             LogBuffer::kNanoappTokenizedLogOffset + kLogPayloadSize);
 }
 
+TEST(LogBuffer, DeferredLogWritesFormatStringOnce) {
+  char buffer[kDefaultBufferSize];
+  constexpr size_t kOutBufferSize = 128;
+  uint8_t outBuffer[kOutBufferSize];
+  const char *format = "value %d %s";
+  TestLogBufferCallback callback;
+  LogBuffer logBuffer(&callback, buffer, kDefaultBufferSize);
+
+  LogBuffer::DeferredLog log;
+  ASSERT_TRUE(captureDeferredLog(&log, format, -2, "ab"));
+  EXPECT_EQ(log.formatSize, strlen(format) + 1);
+  ASSERT_EQ(log.argsSize, sizeof(int32_t) + 3);
+  int32_t intArg;
+  memcpy(&intArg, log.args, sizeof(intArg));
+  EXPECT_EQ(intArg, -2);
+  EXPECT_STREQ(reinterpret_cast<const char *>(&log.args[sizeof(intArg)]),
+               "ab");
+
+  logBuffer.handleDeferredLog(LogBufferLogLevel::INFO, 0, log);
+  logBuffer.handleDeferredLog(LogBufferLogLevel::INFO, 0, log);
+
+  size_t numLogsDropped;
+  size_t bytesCopied =
+      logBuffer.copyLogs(outBuffer, kOutBufferSize, &numLogsDropped);
+  size_t firstLogSize = LogBuffer::kLogDataOffset +
+                        LogBuffer::kDeferredLogOffset + 1 + log.formatSize +
+                        log.argsSize;
+  size_t secondLogSize = LogBuffer::kLogDataOffset +
+                         LogBuffer::kDeferredLogOffset + 1 + log.argsSize;
+  ASSERT_EQ(bytesCopied, firstLogSize + secondLogSize);
+
+  // The first log defines the format string at index 0
+  const uint8_t *data = &outBuffer[LogBuffer::kLogDataOffset];
+  EXPECT_EQ(outBuffer[0] >> 4, static_cast<uint8_t>(LogType::DEFERRED_STRING));
+  EXPECT_EQ(data[0], firstLogSize - LogBuffer::kLogDataOffset -
+                         LogBuffer::kDeferredLogOffset);
+  EXPECT_EQ(data[1], kDeferredLogFormatDefinitionFlag);
+  EXPECT_STREQ(reinterpret_cast<const char *>(&data[2]), format);
+  EXPECT_EQ(memcmp(&data[2 + log.formatSize], log.args, log.argsSize), 0);
+
+  // The second log only references it
+  data = &outBuffer[firstLogSize + LogBuffer::kLogDataOffset];
+  EXPECT_EQ(data[1], 0);
+  EXPECT_EQ(memcmp(&data[2], log.args, log.argsSize), 0);
+}
+
+TEST(LogBuffer, DeferredLogRedefinesFormatStringAfterCopy) {
+  char buffer[kDefaultBufferSize];
+  constexpr size_t kOutBufferSize = 128;
+  uint8_t outBuffer[kOutBufferSize];
+  TestLogBufferCallback callback;
+  LogBuffer logBuffer(&callback, buffer, kDefaultBufferSize);
+
+  LogBuffer::DeferredLog log;
+  ASSERT_TRUE(captureDeferredLog(&log, "no args"));
+  EXPECT_EQ(log.argsSize, 0);
+
+  size_t numLogsDropped;
+  for (int i = 0; i < 2; i++) {
+    logBuffer.handleDeferredLog(LogBufferLogLevel::INFO, 0, log);
+    size_t bytesCopied =
+        logBuffer.copyLogs(outBuffer, kOutBufferSize, &numLogsDropped);
+    ASSERT_EQ(bytesCopied, LogBuffer::kLogDataOffset +
+                               LogBuffer::kDeferredLogOffset + 1 +
+                               log.formatSize);
+    EXPECT_EQ(outBuffer[LogBuffer::kLogDataOffset + 1],
+              kDeferredLogFormatDefinitionFlag);
+  }
+}
+
+TEST(LogBuffer, DeferredLogWidensLongArguments) {
+  LogBuffer::DeferredLog log;
+  ASSERT_TRUE(captureDeferredLog(&log, "%ld %zu %" PRIu64 " %p %f %%", -1L,
+                                 size_t{7}, uint64_t{1} << 40,
+                                 reinterpret_cast<void *>(0x10), 0.5));
+  ASSERT_EQ(log.argsSize, 5 * sizeof(uint64_t));
+
+  int64_t longArg;
+  uint64_t sizeArg;
+  uint64_t uint64Arg;
+  uint64_t pointerArg;
+  double doubleArg;
+  memcpy(&longArg, &log.args[0], sizeof(longArg));
+  memcpy(&sizeArg, &log.args[8], sizeof(sizeArg));
+  memcpy(&uint64Arg, &log.args[16], sizeof(uint64Arg));
+  memcpy(&pointerArg, &log.args[24], sizeof(pointerArg));
+  memcpy(&doubleArg, &log.args[32], sizeof(doubleArg));
+  EXPECT_EQ(longArg, -1);
+  EXPECT_EQ(sizeArg, 7);
+  EXPECT_EQ(uint64Arg, uint64_t{1} << 40);
+  EXPECT_EQ(pointerArg, 0x10);
+  EXPECT_EQ(doubleArg, 0.5);
+}
+
+TEST(LogBuffer, DeferredLogRejectsUnsupportedConversions) {
+  LogBuffer::DeferredLog log;
+  EXPECT_FALSE(captureDeferredLog(&log, "%*d", 2, 3));
+  EXPECT_FALSE(captureDeferredLog(&log, "%Lf", 1.0L));
+  EXPECT_FALSE(captureDeferredLog(&log, "trailing %"));
+
+  std::string longString(LogBuffer::kLogMaxSize, 'a');
+  EXPECT_FALSE(captureDeferredLog(&log, "%s", longString.c_str()));
+  EXPECT_FALSE(captureDeferredLog(&log, longString.c_str()));
+}
+
+TEST(LogBuffer, DeferredLogMovesFormatStringWhenDefinitionDropped) {
+  char buffer[kDefaultBufferSize];
+  uint8_t outBuffer[kDefaultBufferSize];
+  TestLogBufferCallback callback;
+  LogBuffer logBuffer(&callback, buffer, kDefaultBufferSize);
+
+  LogBuffer::DeferredLog log;
+  ASSERT_TRUE(captureDeferredLog(&log, "%s", "a string to fill the buffer"));
+  while (logBuffer.getNumLogsDropped() == 0) {
+    logBuffer.handleDeferredLog(LogBufferLogLevel::INFO, 0, log);
+  }
+  logBuffer.handleDeferredLog(LogBufferLogLevel::INFO, 0, log);
+  ASSERT_EQ(logBuffer.getNumLogsDropped(), 2);
+
+  size_t numLogsDropped;
+  size_t bytesCopied =
+      logBuffer.copyLogs(outBuffer, kDefaultBufferSize, &numLogsDropped);
+  std::vector<bool> definesFormat;
+  size_t offset = 0;
+  while (offset < bytesCopied) {
+    const uint8_t *data = &outBuffer[offset + LogBuffer::kLogDataOffset];
+    definesFormat.push_back((data[1] & kDeferredLogFormatDefinitionFlag) != 0);
+    offset += LogBuffer::kLogDataOffset + LogBuffer::kDeferredLogOffset +
+              data[0];
+  }
+  ASSERT_EQ(offset, bytesCopied);
+
+  // The definition was moved to the oldest log left rather than written again
+  std::vector<bool> expected(definesFormat.size(), false);
+  expected[0] = true;
+  EXPECT_EQ(definesFormat, expected);
+}
+
+TEST(LogBuffer, DeferredLogComparesFormatStringPointers) {
+  char buffer[kDefaultBufferSize];
+  uint8_t outBuffer[kDefaultBufferSize];
+  TestLogBufferCallback callback;
+  LogBuffer logBuffer(&callback, buffer, kDefaultBufferSize);
+
+  // Equal format strings at different addresses have the same hash
+  const char format[] = "same format";
+  const char otherFormat[] = "same format";
+  LogBuffer::DeferredLog log;
+  LogBuffer::DeferredLog otherLog;
+  ASSERT_TRUE(captureDeferredLog(&log, format));
+  ASSERT_TRUE(captureDeferredLog(&otherLog, otherFormat));
+  ASSERT_EQ(log.formatHash, otherLog.formatHash);
+
+  logBuffer.handleDeferredLog(LogBufferLogLevel::INFO, 0, log);
+  logBuffer.handleDeferredLog(LogBufferLogLevel::INFO, 0, otherLog);
+  size_t numLogsDropped;
+  size_t bytesCopied =
+      logBuffer.copyLogs(outBuffer, kDefaultBufferSize, &numLogsDropped);
+  size_t logSize = LogBuffer::kLogDataOffset + LogBuffer::kDeferredLogOffset +
+                   1 + log.formatSize;
+  ASSERT_EQ(bytesCopied, 2 * logSize);
+  EXPECT_EQ(outBuffer[LogBuffer::kLogDataOffset + 1],
+            kDeferredLogFormatDefinitionFlag);
+  EXPECT_EQ(outBuffer[logSize + LogBuffer::kLogDataOffset + 1],
+            kDeferredLogFormatDefinitionFlag | 1);
+}
+
+//! Decodes deferred logs with a single %s conversion the way the host does,
+//! failing the test if a log references a format string which wasn't defined
+//! earlier in the same copy.
+void decodeDeferredLogs(const uint8_t *data, size_t size,
+                        std::vector<std::string> *decoded) {
+  std::optional<std::string> formats[kDeferredLogMaxFormats];
+  size_t offset = 0;
+  while (offset < size) {
+    ASSERT_EQ(data[offset] >> 4,
+              static_cast<uint8_t>(LogType::DEFERRED_STRING));
+    const uint8_t *log = &data[offset + LogBuffer::kLogDataOffset];
+    uint8_t formatIndex = log[1] & ~kDeferredLogFormatDefinitionFlag;
+    ASSERT_LT(formatIndex, kDeferredLogMaxFormats);
+    const char *args = reinterpret_cast<const char *>(&log[2]);
+    if ((log[1] & kDeferredLogFormatDefinitionFlag) != 0) {
+      formats[formatIndex] = args;
+      args += formats[formatIndex]->size() + 1;
+    }
+    ASSERT_TRUE(formats[formatIndex].has_value())
+        << "Undefined format index " << static_cast<int>(formatIndex);
+
+    std::string line = *formats[formatIndex];
+    line.replace(line.find("%s"), 2, args);
+    decoded->push_back(line);
+    offset += LogBuffer::kLogDataOffset + LogBuffer::kDeferredLogOffset +
+              log[0];
+  }
+  ASSERT_EQ(offset, size);
+}
+
+TEST(LogBuffer, DeferredLogsDecodableAfterOverflow) {
+  constexpr size_t kBufferSize = kDefaultBufferSize;
+  constexpr size_t kPartialCopySize = 128;
+  constexpr int kNumLogs = 1000;
+  const char *kFormats[] = {"rare %s", "even %s", "odd %s"};
+  char buffer[kBufferSize];
+  uint8_t outBuffer[kBufferSize];
+  TestLogBufferCallback callback;
+  LogBuffer logBuffer(&callback, buffer, kBufferSize);
+
+  auto formatOf = [&](int i) {
+    return (i % 13 == 0) ? kFormats[0] : kFormats[1 + i % 2];
+  };
+  auto argOf = [](int i) {
+    return std::string(i % 7, '.') + std::to_string(i);
+  };
+
+  std::vector<std::string> decoded;
+  size_t numLogsDropped = 0;
+  for (int i = 0; i < kNumLogs; i++) {
+    LogBuffer::DeferredLog log;
+    ASSERT_TRUE(captureDeferredLog(&log, formatOf(i), argOf(i).c_str()));
+    logBuffer.handleDeferredLog(LogBufferLogLevel::INFO, 0, log);
+
+    // Occasionally copy out part of the buffer, leaving references to format
+    // strings defined by the logs copied out
+    if (i % 150 == 149) {
+      size_t bytesCopied =
+          logBuffer.copyLogs(outBuffer, kPartialCopySize, &numLogsDropped);
+      ASSERT_GT(bytesCopied, 0);
+      ASSERT_NO_FATAL_FAILURE(
+          decodeDeferredLogs(outBuffer, bytesCopied, &decoded));
+    }
+  }
+  size_t bytesCopied =
+      logBuffer.copyLogs(outBuffer, kBufferSize, &numLogsDropped);
+  ASSERT_NO_FATAL_FAILURE(decodeDeferredLogs(outBuffer, bytesCopied, &decoded));
+
+  ASSERT_GT(numLogsDropped, 0);
+  ASSERT_EQ(decoded.size() + numLogsDropped, kNumLogs);
+
+  // Every log that wasn't dropped is decoded in order
+  std::vector<std::string> expected;
+  for (int i = 0; i < kNumLogs; i++) {
+    std::string line = formatOf(i);
+    line.replace(line.find("%s"), 2, argOf(i));
+    expected.push_back(line);
+  }
+  size_t next = 0;
+  for (const std::string &line : decoded) {
+    while (next < expected.size() && expected[next] != line) {
+      next++;
+    }
+    ASSERT_LT(next, expected.size()) << "Unexpected or reordered log " << line;
+    next++;
+  }
+}
+
 // TODO(srok): Add multithreaded tests
 
 }  // namespace chre
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "chre/platform/shared/log_buffer.h"
+#include "chre/platform/shared/log_double_buffer.h"
+
+/**
+ * @file
+ * A benchmark of the time producers spend in a single log call, with and
+ * without a thread concurrently flushing the logs. Flushing either retires the
+ * active buffer of a LogDoubleBuffer, or copies the logs out of a single
+ * LogBuffer with LogBuffer::transferTo() as was done before the double buffer.
+ *
+ * Usage:
+ *  chre_log_double_buffer_benchmark [logs per producer]
+ */
+
+using chre::LogBuffer;
+using chre::LogBufferLogLevel;
+using chre::LogDoubleBuffer;
+
+namespace {
+
+constexpr size_t kDefaultLogsPerProducer = 100000;
+constexpr size_t kNumProducers = 4;
+constexpr size_t kBufferSize = 4096;
+
+using LogFunction = std::function<void(const char *log)>;
+
+/**
+ * Runs kNumProducers threads that each log logsPerProducer messages through
+ * logFunction, while flushFunction is called in a loop until they're done.
+ * Prints the percentiles of the time spent in logFunction.
+ *
+ * @param flushFunction Called repeatedly while producers run, or nullptr.
+ */
+void runBenchmark(const char *name, size_t logsPerProducer,
+                  const LogFunction &logFunction,
+                  const std::function<void()> &flushFunction) {
+  std::atomic<size_t> numProducersDone{0};
+  std::vector<std::vector<uint64_t>> latenciesNs(kNumProducers);
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < kNumProducers; p++) {
+    latenciesNs[p].reserve(logsPerProducer);
+    producers.emplace_back([&, p]() {
+      char log[32];
+      for (size_t i = 0; i < logsPerProducer; i++) {
+        snprintf(log, sizeof(log), "p%zu-%zu", p, i);
+        auto start = std::chrono::steady_clock::now();
+        logFunction(log);
+        latenciesNs[p].push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count());
+      }
+      numProducersDone++;
+    });
+  }
+
+  size_t numFlushes = 0;
+  while (numProducersDone.load() != kNumProducers) {
+    if (flushFunction) {
+      flushFunction();
+      numFlushes++;
+    }
+  }
+  for (std::thread &producer : producers) {
+    producer.join();
+  }
+
+  std::vector<uint64_t> allLatenciesNs;
+  for (const std::vector<uint64_t> &producerLatenciesNs : latenciesNs) {
+    allLatenciesNs.insert(allLatenciesNs.end(), producerLatenciesNs.begin(),
+                          producerLatenciesNs.end());
+  }
+  std::sort(allLatenciesNs.begin(), allLatenciesNs.end());
+  size_t numLogs = allLatenciesNs.size();
+  printf("%-14s p50 %6" PRIu64 " ns  p99 %6" PRIu64 " ns  max %9" PRIu64
+         " ns (%zu flushes)\n",
+         name, allLatenciesNs[numLogs / 2], allLatenciesNs[numLogs * 99 / 100],
+         allLatenciesNs.back(), numFlushes);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  size_t logsPerProducer = kDefaultLogsPerProducer;
+  if (argc > 1) {
+    logsPerProducer = strtoul(argv[1], nullptr, 0);
+  }
+  if (logsPerProducer == 0) {
+    fprintf(stderr, "The number of logs per producer must be positive\n");
+    return -1;
+  }
+
+  uint8_t primary[kBufferSize];
+  uint8_t secondary[kBufferSize];
+
+  {
+    LogDoubleBuffer logBuffers(nullptr, primary, secondary, kBufferSize);
+    auto logToDoubleBuffer = [&](const char *log) {
+      LogDoubleBuffer::Writer writer(logBuffers);
+      writer->handleLog(LogBufferLogLevel::INFO, 0, log);
+    };
+    runBenchmark("no flusher", logsPerProducer, logToDoubleBuffer, nullptr);
+    runBenchmark("double buffer", logsPerProducer, logToDoubleBuffer, [&]() {
+      logBuffers.retireActiveBuffer();
+      LogBuffer &retired = logBuffers.getRetiredBuffer();
+      retired.linearize();
+      retired.reset();
+    });
+  }
+
+  {
+    LogBuffer activeBuffer(nullptr, primary, kBufferSize);
+    LogBuffer flushBuffer(nullptr, secondary, kBufferSize);
+    runBenchmark(
+        "transferTo", logsPerProducer,
+        [&](const char *log) {
+          activeBuffer.handleLog(LogBufferLogLevel::INFO, 0, log);
+        },
+        [&]() {
+          activeBuffer.transferTo(flushBuffer);
+          flushBuffer.reset();
+        });
+  }
+  return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "chre/platform/shared/log_buffer.h"
+#include "chre/platform/shared/log_double_buffer.h"
+
+namespace chre {
+namespace {
+
+constexpr size_t kBufferSize = 1024;
+
+class CountingLogBufferCallback : public LogBufferCallbackInterface {
+ public:
+  void onLogsReady() override {
+    mNumCalls++;
+  }
+
+  std::atomic<size_t> mNumCalls{0};
+};
+
+void logToDoubleBuffer(LogDoubleBuffer &logBuffers, uint32_t timestampMs,
+                       const char *log) {
+  LogDoubleBuffer::Writer writer(logBuffers);
+  writer->handleLog(LogBufferLogLevel::INFO, timestampMs, log);
+}
+
+TEST(LogDoubleBuffer, RetiredBufferMatchesCopiedLogs) {
+  uint8_t primary[kBufferSize];
+  uint8_t secondary[kBufferSize];
+  uint8_t reference[kBufferSize];
+  LogDoubleBuffer logBuffers(nullptr, primary, secondary, kBufferSize);
+  LogBuffer referenceBuffer(nullptr, reference, kBufferSize);
+
+  // Log enough to wrap around the buffers and drop the oldest logs
+  char log[32];
+  for (uint32_t i = 0; i < 200; i++) {
+    snprintf(log, sizeof(log), "log number %" PRIu32, i);
+    logToDoubleBuffer(logBuffers, i, log);
+    referenceBuffer.handleLog(LogBufferLogLevel::INFO, i, log);
+  }
+
+  uint8_t expected[kBufferSize];
+  size_t expectedNumLogsDropped;
+  size_t expectedSize =
+      referenceBuffer.copyLogs(expected, kBufferSize, &expectedNumLogsDropped);
+  ASSERT_GT(expectedNumLogsDropped, 0);
+
+  logBuffers.retireActiveBuffer();
+  EXPECT_EQ(logBuffers.getActiveBufferSize(), 0);
+  LogBuffer &retired = logBuffers.getRetiredBuffer();
+  retired.linearize();
+  ASSERT_EQ(retired.getBufferSize(), expectedSize);
+  EXPECT_EQ(retired.getNumLogsDropped(), expectedNumLogsDropped);
+  EXPECT_EQ(memcmp(retired.getBufferData(), expected, expectedSize), 0);
+}
+
+TEST(LogDoubleBuffer, ActiveBufferIsEmptyAfterRetire) {
+  uint8_t primary[kBufferSize];
+  uint8_t secondary[kBufferSize];
+  LogDoubleBuffer logBuffers(nullptr, primary, secondary, kBufferSize);
+
+  logToDoubleBuffer(logBuffers, 1, "first");
+  logBuffers.retireActiveBuffer();
+  logToDoubleBuffer(logBuffers, 2, "second");
+
+  LogBuffer &retired = logBuffers.getRetiredBuffer();
+  EXPECT_EQ(retired.getBufferSize(),
+            LogBuffer::kLogDataOffset + strlen("first") + 1);
+  EXPECT_EQ(logBuffers.getActiveBufferSize(),
+            LogBuffer::kLogDataOffset + strlen("second") + 1);
+}
+
+TEST(LogDoubleBuffer, DiscardedRetiredLogsAreCountedAsDropped) {
+  uint8_t primary[kBufferSize];
+  uint8_t secondary[kBufferSize];
+  LogDoubleBuffer logBuffers(nullptr, primary, secondary, kBufferSize);
+
+  // Retire again without reading the retired logs, as when sending them to the
+  // host failed.
+  logToDoubleBuffer(logBuffers, 1, "first");
+  logToDoubleBuffer(logBuffers, 2, "second");
+  logBuffers.retireActiveBuffer();
+  logToDoubleBuffer(logBuffers, 3, "third");
+  logBuffers.retireActiveBuffer();
+
+  LogBuffer &retired = logBuffers.getRetiredBuffer();
+  EXPECT_EQ(retired.getBufferSize(),
+            LogBuffer::kLogDataOffset + strlen("third") + 1);
+  size_t numLogsDropped = retired.getNumLogsDropped();
+  retired.reset();
+
+  logBuffers.retireActiveBuffer();
+  numLogsDropped += logBuffers.getRetiredBuffer().getNumLogsDropped();
+  EXPECT_EQ(numLogsDropped, 2);
+}
+
+TEST(LogDoubleBuffer, NotifiesCallbackAfterWrite) {
+  uint8_t primary[kBufferSize];
+  uint8_t secondary[kBufferSize];
+  CountingLogBufferCallback callback;
+  LogDoubleBuffer logBuffers(&callback, primary, secondary, kBufferSize);
+
+  {
+    LogDoubleBuffer::Writer writer(logBuffers);
+    writer->handleLog(LogBufferLogLevel::INFO, 0, "test");
+    EXPECT_EQ(callback.mNumCalls, 0);
+  }
+  EXPECT_EQ(callback.mNumCalls, 1);
+}
+
+//! Several producers log concurrently while a flusher repeatedly retires and
+//! drains the active buffer. Every log must either be received in order or
+//! be accounted for as dropped.
+TEST(LogDoubleBuffer, ConcurrentProducersAndFlusher) {
+  constexpr size_t kNumProducers = 4;
+  constexpr size_t kLogsPerProducer = 20000;
+  uint8_t primary[kBufferSize];
+  uint8_t secondary[kBufferSize];
+  LogDoubleBuffer logBuffers(nullptr, primary, secondary, kBufferSize);
+
+  std::atomic<size_t> numProducersDone{0};
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < kNumProducers; p++) {
+    producers.emplace_back([&, p]() {
+      char log[32];
+      for (size_t i = 0; i < kLogsPerProducer; i++) {
+        snprintf(log, sizeof(log), "p%zu-%zu", p, i);
+        logToDoubleBuffer(logBuffers, 0, log);
+      }
+      numProducersDone++;
+    });
+  }
+
+  std::vector<size_t> nextExpected(kNumProducers, 0);
+  size_t numReceived = 0;
+  size_t numDropped = 0;
+  bool producersDone = false;
+  do {
+    producersDone = (numProducersDone.load() == kNumProducers);
+    logBuffers.retireActiveBuffer();
+    LogBuffer &retired = logBuffers.getRetiredBuffer();
+    retired.linearize();
+
+    numDropped += retired.getNumLogsDropped();
+    const char *data =
+        reinterpret_cast<const char *>(retired.getBufferData());
+    size_t offset = 0;
+    while (offset < retired.getBufferSize()) {
+      const char *log = &data[offset + LogBuffer::kLogDataOffset];
+      size_t producer;
+      size_t index;
+      ASSERT_EQ(sscanf(log, "p%zu-%zu", &producer, &index), 2);
+      ASSERT_LT(producer, kNumProducers);
+      // Logs may have been dropped in between, but never reordered.
+      ASSERT_GE(index, nextExpected[producer]);
+      nextExpected[producer] = index + 1;
+      numReceived++;
+      offset += LogBuffer::kLogDataOffset + strlen(log) + 1;
+    }
+    ASSERT_EQ(offset, retired.getBufferSize());
+    retired.reset();
+  } while (!producersDone);
+
+  for (std::thread &producer : producers) {
+    producer.join();
+  }
+  EXPECT_EQ(logBuffers.getActiveBufferSize(), 0);
+  EXPECT_EQ(numReceived + numDropped, kNumProducers * kLogsPerProducer);
+}
+
+}  // namespace
+}  // namespace chre
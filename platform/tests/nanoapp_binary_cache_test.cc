@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "chre/platform/shared/nanoapp_binary_cache.h"
+
+namespace chre {
+namespace {
+
+constexpr uint64_t kAppId = 0x0123456789abcdef;
+constexpr uint32_t kAppVersion = 2;
+constexpr uint64_t kBinaryHash = 0xfeedfacecafebeef;
+constexpr size_t kBinarySize = 1000;
+constexpr size_t kRegionSize = 4096;
+
+std::vector<uint8_t> makeBinary(uint8_t seed, size_t size = kBinarySize) {
+  std::vector<uint8_t> binary(size);
+  for (size_t i = 0; i < size; i++) {
+    binary[i] = static_cast<uint8_t>(i * 7 + seed);
+  }
+  return binary;
+}
+
+/**
+ * Simulates CHRE restarts by initializing a new cache over the same retained
+ * region.
+ */
+class NanoappBinaryCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mRegion.resize(kRegionSize / sizeof(uint64_t));
+    restart();
+  }
+
+  void restart() {
+    mCache = std::make_unique<NanoappBinaryCache>();
+    mCache->init(mRegion.data(), kRegionSize);
+  }
+
+  //! Stores a binary in fragments as it would be loaded.
+  bool store(uint64_t appId, const std::vector<uint8_t> &binary,
+             uint64_t binaryHash = kBinaryHash) {
+    if (!mCache->startStore(appId, kAppVersion, binaryHash, binary.size())) {
+      return false;
+    }
+    constexpr size_t kFragmentSize = 300;
+    for (size_t offset = 0; offset < binary.size(); offset += kFragmentSize) {
+      mCache->appendStore(&binary[offset],
+                          std::min(kFragmentSize, binary.size() - offset));
+    }
+    mCache->finishStore();
+    return true;
+  }
+
+  bool isRetained(uint64_t appId, const std::vector<uint8_t> &binary,
+                  uint64_t binaryHash = kBinaryHash) {
+    const void *retained =
+        mCache->find(appId, kAppVersion, binaryHash, binary.size());
+    return retained != nullptr &&
+           memcmp(retained, binary.data(), binary.size()) == 0;
+  }
+
+  uint8_t *regionBytes() {
+    return reinterpret_cast<uint8_t *>(mRegion.data());
+  }
+
+  std::vector<uint64_t> mRegion;
+  std::unique_ptr<NanoappBinaryCache> mCache;
+};
+
+TEST_F(NanoappBinaryCacheTest, RetainsStartedBinaryAcrossRestarts) {
+  std::vector<uint8_t> binary = makeBinary(1);
+  ASSERT_TRUE(store(kAppId, binary));
+  mCache->retain(kAppId);
+  EXPECT_TRUE(isRetained(kAppId, binary));
+
+  restart();
+  EXPECT_TRUE(isRetained(kAppId, binary));
+  restart();
+  EXPECT_TRUE(isRetained(kAppId, binary));
+
+  EXPECT_FALSE(isRetained(kAppId, binary, kBinaryHash + 1));
+  EXPECT_EQ(mCache->find(kAppId, kAppVersion + 1, kBinaryHash, kBinarySize),
+            nullptr);
+  EXPECT_EQ(mCache->find(kAppId, kAppVersion, kBinaryHash, kBinarySize + 1),
+            nullptr);
+  EXPECT_EQ(mCache->find(kAppId + 1, kAppVersion, kBinaryHash, kBinarySize),
+            nullptr);
+}
+
+TEST_F(NanoappBinaryCacheTest, OnlyRetainsStartedBinaries) {
+  std::vector<uint8_t> binary = makeBinary(1);
+  ASSERT_TRUE(store(kAppId, binary));
+  EXPECT_FALSE(isRetained(kAppId, binary));
+
+  // The nanoapp didn't start before the restart
+  restart();
+  mCache->retain(kAppId);
+  EXPECT_FALSE(isRetained(kAppId, binary));
+
+  ASSERT_TRUE(store(kAppId, binary));
+  mCache->drop(kAppId);
+  mCache->retain(kAppId);
+  EXPECT_FALSE(isRetained(kAppId, binary));
+}
+
+TEST_F(NanoappBinaryCacheTest, DropsBinaryInterruptedByRestart) {
+  std::vector<uint8_t> binary = makeBinary(1);
+  ASSERT_TRUE(mCache->startStore(kAppId, kAppVersion, kBinaryHash,
+                                 binary.size()));
+  mCache->appendStore(binary.data(), binary.size() / 2);
+
+  restart();
+  mCache->retain(kAppId);
+  EXPECT_FALSE(isRetained(kAppId, binary));
+
+  // The space of the partial binary is reclaimed
+  std::vector<uint8_t> other = makeBinary(2, 3 * kBinarySize);
+  ASSERT_TRUE(store(kAppId + 1, other));
+  mCache->retain(kAppId + 1);
+  EXPECT_TRUE(isRetained(kAppId + 1, other));
+}
+
+TEST_F(NanoappBinaryCacheTest, DropsCorruptedBinary) {
+  std::vector<uint8_t> binary = makeBinary(1);
+  ASSERT_TRUE(store(kAppId, binary));
+  mCache->retain(kAppId);
+  auto *retained = static_cast<uint8_t *>(const_cast<void *>(
+      mCache->find(kAppId, kAppVersion, kBinaryHash, binary.size())));
+  ASSERT_NE(retained, nullptr);
+  retained[kBinarySize / 2] ^= 1;
+
+  restart();
+  EXPECT_EQ(mCache->find(kAppId, kAppVersion, kBinaryHash, binary.size()),
+            nullptr);
+}
+
+TEST_F(NanoappBinaryCacheTest, KeepsBinariesBeforeCorruptedHeader) {
+  std::vector<uint8_t> first = makeBinary(1);
+  std::vector<uint8_t> second = makeBinary(2);
+  ASSERT_TRUE(store(kAppId, first));
+  ASSERT_TRUE(store(kAppId + 1, second));
+  mCache->retain(kAppId);
+  mCache->retain(kAppId + 1);
+
+  // Corrupt the size in the header preceding the second binary
+  auto *retained = static_cast<uint8_t *>(const_cast<void *>(
+      mCache->find(kAppId + 1, kAppVersion, kBinaryHash, second.size())));
+  ASSERT_NE(retained, nullptr);
+  retained[-12] ^= 0x10;
+
+  restart();
+  EXPECT_TRUE(isRetained(kAppId, first));
+  EXPECT_FALSE(isRetained(kAppId + 1, second));
+}
+
+TEST_F(NanoappBinaryCacheTest, ClearsUninitializedRegion) {
+  std::fill(regionBytes(), regionBytes() + kRegionSize, 0xa5);
+  restart();
+
+  std::vector<uint8_t> binary = makeBinary(1);
+  ASSERT_TRUE(store(kAppId, binary));
+  mCache->retain(kAppId);
+  restart();
+  EXPECT_TRUE(isRetained(kAppId, binary));
+}
+
+TEST_F(NanoappBinaryCacheTest, EvictsOldestBinaries) {
+  std::vector<uint8_t> binaries[] = {makeBinary(1), makeBinary(2),
+                                     makeBinary(3), makeBinary(4),
+                                     makeBinary(5)};
+  for (size_t i = 0; i < 5; i++) {
+    ASSERT_TRUE(store(kAppId + i, binaries[i]));
+    mCache->retain(kAppId + i);
+  }
+
+  // Only the last three binaries fit in the region
+  restart();
+  EXPECT_FALSE(isRetained(kAppId, binaries[0]));
+  EXPECT_FALSE(isRetained(kAppId + 1, binaries[1]));
+  for (size_t i = 2; i < 5; i++) {
+    EXPECT_TRUE(isRetained(kAppId + i, binaries[i]));
+  }
+
+  EXPECT_FALSE(store(kAppId, makeBinary(1, kRegionSize)));
+}
+
+TEST_F(NanoappBinaryCacheTest, ReplacesBinaryOfSameNanoapp) {
+  std::vector<uint8_t> binary = makeBinary(1);
+  std::vector<uint8_t> update = makeBinary(2);
+  ASSERT_TRUE(store(kAppId, binary));
+  mCache->retain(kAppId);
+  ASSERT_TRUE(store(kAppId, update, kBinaryHash + 1));
+  EXPECT_FALSE(isRetained(kAppId, binary));
+
+  mCache->retain(kAppId);
+  restart();
+  EXPECT_FALSE(isRetained(kAppId, binary));
+  EXPECT_TRUE(isRetained(kAppId, update, kBinaryHash + 1));
+}
+
+TEST_F(NanoappBinaryCacheTest, StoresOneBinaryAtATime) {
+  std::vector<uint8_t> binary = makeBinary(1);
+  ASSERT_TRUE(mCache->startStore(kAppId, kAppVersion, kBinaryHash,
+                                 binary.size()));
+  EXPECT_FALSE(mCache->startStore(kAppId + 1, kAppVersion, kBinaryHash,
+                                  binary.size()));
+
+  // Data past the size of the binary aborts storing it
+  mCache->appendStore(binary.data(), binary.size());
+  mCache->appendStore(binary.data(), 1);
+  mCache->finishStore();
+  mCache->retain(kAppId);
+  EXPECT_FALSE(isRetained(kAppId, binary));
+
+  mCache->abortStore();
+  EXPECT_TRUE(store(kAppId + 1, binary));
+}
+
+}  // namespace
+}  // namespace chre
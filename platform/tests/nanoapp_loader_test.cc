@@ -0,0 +1,600 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "chre/platform/shared/memory.h"
+#include "chre/platform/shared/nanoapp_loader.h"
+#include "chre/target_platform/platform_cache_management.h"
+#include "chre_api/chre/re.h"
+
+#ifdef CHREX_SYMBOL_EXTENSIONS
+//! Exported by the vendor symbol list of the tests.
+extern "C" void chreTestVendorFunction(void) {}
+#endif  // CHREX_SYMBOL_EXTENSIONS
+
+namespace chre {
+
+// The nanoapp loader is built for targets that provide the following, which
+// are implemented here on top of the host's heap. The binaries built by the
+// tests only reference absolute addresses, other than their imported symbols.
+
+namespace {
+
+size_t gNumAllocations = 0;
+//! Size of the allocation to fail, or 0 to fail none.
+size_t gFailedAllocationSize = 0;
+//! Number of imported symbols resolved from the cache while relocating.
+size_t gNumCachedSymbols = 0;
+
+void *allocate(size_t size, size_t alignment) {
+  if (size == gFailedAllocationSize) {
+    return nullptr;
+  }
+  alignment = std::max(alignment, alignof(std::max_align_t));
+  void *pointer = aligned_alloc(alignment, (size + alignment - 1) & -alignment);
+  if (pointer != nullptr) {
+    gNumAllocations++;
+  }
+  return pointer;
+}
+
+void deallocate(void *pointer) {
+  if (pointer != nullptr) {
+    gNumAllocations--;
+    free(pointer);
+  }
+}
+
+}  // namespace
+
+void *nanoappBinaryAlloc(size_t size, size_t alignment) {
+  return allocate(size, alignment);
+}
+
+void *nanoappBinaryDramAlloc(size_t size, size_t alignment) {
+  return allocate(size, alignment);
+}
+
+void nanoappBinaryFree(void *pointer) {
+  deallocate(pointer);
+}
+
+void nanoappBinaryDramFree(void *pointer) {
+  deallocate(pointer);
+}
+
+void *memoryAllocDram(size_t size) {
+  return allocate(size, 0 /* alignment */);
+}
+
+void memoryFreeDram(void *pointer) {
+  deallocate(pointer);
+}
+
+void wipeSystemCaches(uintptr_t /* address */, uint32_t /* span */) {}
+
+//! Points each entry of the DT_RELA table at the imported symbol it refers to.
+bool NanoappLoader::relocateTable(DynamicHeader *dyn, int tableTag) {
+  if (tableTag != DT_RELA) {
+    return true;
+  }
+
+  size_t relocSize = getDynEntry(dyn, DT_RELASZ);
+  auto *reloc = reinterpret_cast<ElfRela *>(
+      getFileData(getDynEntry(dyn, DT_RELA), relocSize));
+  if (reloc == nullptr) {
+    return false;
+  }
+  bool resolvedAllSymbols = true;
+  for (size_t i = 0; i < relocSize / sizeof(ElfRela); ++i) {
+    size_t posInSymbolTable = ELFW_R_SYM(reloc[i].r_info);
+    if (mResolvedSymbolCache != nullptr &&
+        mResolvedSymbolCache[posInSymbolTable] != nullptr) {
+      gNumCachedSymbols++;
+    }
+    void *resolved = resolveData(posInSymbolTable);
+    resolvedAllSymbols &= (resolved != nullptr);
+    *reinterpret_cast<ElfAddr *>(mMapping + reloc[i].r_offset) =
+        reinterpret_cast<ElfAddr>(resolved);
+  }
+  return resolvedAllSymbols;
+}
+
+bool NanoappLoader::resolveGot() {
+  return true;
+}
+
+namespace {
+
+using namespace std::string_literals;
+
+using ElfAddr = ElfW(Addr);
+using ElfDyn = ElfW(Dyn);
+using ElfHeader = ElfW(Ehdr);
+using ElfRela = ElfW(Rela);
+using ElfSym = ElfW(Sym);
+using ProgramHeader = ElfW(Phdr);
+using SectionHeader = ElfW(Shdr);
+
+#ifdef CHRE_LOADER_ARCH
+constexpr uint16_t kLoaderArch = CHRE_LOADER_ARCH;
+#else
+constexpr uint16_t kLoaderArch = EM_ARM;
+#endif
+
+constexpr uint32_t kValue = 0xcafe;
+constexpr size_t kBssSize = 64;
+//! The number of relocations against each imported symbol.
+constexpr size_t kRelocationsPerImport = 2;
+//! The number of symbols defined by the binaries built by the tests, other
+//! than the null symbol.
+constexpr size_t kNumDefinedSymbols = 2;
+
+int gNumInitCalls = 0;
+int gNumFiniCalls = 0;
+
+void initFunction() {
+  gNumInitCalls++;
+}
+
+void finiFunction() {
+  gNumFiniCalls++;
+}
+
+//! The order of the sections following the load segment, as output by the
+//! GNU linker or by LLVM's.
+enum class Layout {
+  kSymtabStrtabShstrtab,
+  kSymtabShstrtabStrtab,
+};
+
+template <typename T>
+size_t append(std::vector<uint8_t> &binary, const T &value) {
+  size_t offset = binary.size();
+  const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+  binary.insert(binary.end(), bytes, bytes + sizeof(T));
+  return offset;
+}
+
+size_t appendString(std::vector<uint8_t> &binary, const std::string &string) {
+  size_t offset = binary.size();
+  binary.insert(binary.end(), string.begin(), string.end());
+  return offset;
+}
+
+void alignTo(std::vector<uint8_t> &binary, size_t alignment) {
+  binary.resize((binary.size() + alignment - 1) & -alignment);
+}
+
+SectionHeader makeSection(const std::string &names, const char *name,
+                          size_t offset, size_t size) {
+  SectionHeader header = {};
+  header.sh_name = static_cast<ElfW(Word)>(
+      names.find(std::string(name) + '\0', 1 /* pos */));
+  header.sh_offset = offset;
+  header.sh_addr = offset;
+  header.sh_size = size;
+  return header;
+}
+
+/**
+ * Builds a shared object with a single load segment holding its dynamic tables,
+ * the slots of its imported symbols, an init and a fini array and an exported
+ * value, followed by a symbol table and string tables that aren't loaded and
+ * contain the names of the sections that are looked up.
+ */
+std::vector<uint8_t> makeBinary(
+    Layout layout = Layout::kSymtabStrtabShstrtab,
+    const std::vector<std::string> &imports = {}) {
+  std::vector<uint8_t> binary(sizeof(ElfHeader) + 2 * sizeof(ProgramHeader));
+
+  std::string symbolNames = "\0nanoappValue\0nanoappImports\0"s;
+  std::vector<ElfSym> symbols(1 + kNumDefinedSymbols + imports.size());
+  symbols[1].st_name = symbolNames.find("nanoappValue");
+  symbols[2].st_name = symbolNames.find("nanoappImports");
+  for (size_t i = 0; i < imports.size(); i++) {
+    symbols[1 + kNumDefinedSymbols + i].st_name = symbolNames.size();
+    symbolNames += imports[i] + '\0';
+  }
+  size_t dynsymOffset = binary.size();
+  binary.resize(dynsymOffset + symbols.size() * sizeof(ElfSym));
+  size_t dynstrOffset = appendString(binary, symbolNames);
+  alignTo(binary, sizeof(ElfAddr));
+
+  size_t numRelocations = imports.size() * kRelocationsPerImport;
+  size_t relaOffset = binary.size();
+  for (size_t i = 0; i < numRelocations; i++) {
+    ElfRela relocation = {};
+    relocation.r_offset =
+        relaOffset + numRelocations * sizeof(ElfRela) + i * sizeof(ElfAddr);
+    relocation.r_info =
+        ELFW(R_INFO)(1 + kNumDefinedSymbols + i / kRelocationsPerImport, 0);
+    append(binary, relocation);
+  }
+  size_t importsOffset = binary.size();
+  binary.resize(importsOffset + numRelocations * sizeof(ElfAddr));
+  const ElfDyn dynamic[] = {
+      {DT_RELA, {relaOffset}},
+      {DT_RELASZ, {numRelocations * sizeof(ElfRela)}},
+      {DT_NULL, {0}},
+  };
+  size_t dynamicOffset = append(binary, dynamic);
+
+  size_t initArrayOffset =
+      append(binary, static_cast<ElfAddr>(
+                         reinterpret_cast<uintptr_t>(&initFunction)));
+  size_t finiArrayOffset =
+      append(binary, static_cast<ElfAddr>(
+                         reinterpret_cast<uintptr_t>(&finiFunction)));
+  size_t valueOffset = append(binary, kValue);
+  alignTo(binary, sizeof(ElfAddr));
+  size_t loadSize = binary.size();
+
+  symbols[1].st_value = valueOffset;
+  symbols[2].st_value = importsOffset;
+  for (size_t i = 1; i <= kNumDefinedSymbols; i++) {
+    symbols[i].st_shndx = 1;
+  }
+  memcpy(&binary[dynsymOffset], symbols.data(),
+         symbols.size() * sizeof(ElfSym));
+
+  // The .init_array name is merged into the tail of another name, and names
+  // of sections that are looked up appear in the data that isn't loaded.
+  const std::string names =
+      "\0.dynsym\0.dynstr\0.dynamic\0.rela.init_array\0.fini_array\0"
+      ".symtab\0.strtab\0.shstrtab\0"s;
+  const std::string decoys =
+      "\0.init_array\0.fini_array\0.dynsym\0.dynstr\0.init_array\0"s;
+  size_t symtabOffset = binary.size();
+  for (int i = 0; i < 4; i++) {
+    appendString(binary, decoys);
+  }
+  size_t symtabSize = binary.size() - symtabOffset;
+  size_t strtabOffset = 0;
+  size_t shstrtabOffset = 0;
+  if (layout == Layout::kSymtabStrtabShstrtab) {
+    strtabOffset = appendString(binary, decoys);
+    shstrtabOffset = appendString(binary, names);
+  } else {
+    shstrtabOffset = appendString(binary, names);
+    strtabOffset = appendString(binary, decoys);
+  }
+  alignTo(binary, sizeof(ElfAddr));
+
+  const SectionHeader sections[] = {
+      {},
+      makeSection(names, ".dynsym", dynsymOffset,
+                  symbols.size() * sizeof(ElfSym)),
+      makeSection(names, ".dynstr", dynstrOffset, symbolNames.size()),
+      makeSection(names, ".dynamic", dynamicOffset, sizeof(dynamic)),
+      makeSection(names, ".init_array", initArrayOffset, sizeof(ElfAddr)),
+      makeSection(names, ".fini_array", finiArrayOffset, sizeof(ElfAddr)),
+      makeSection(names, ".symtab", symtabOffset, symtabSize),
+      makeSection(names, ".strtab", strtabOffset, decoys.size()),
+      makeSection(names, ".shstrtab", shstrtabOffset, names.size()),
+  };
+  size_t sectionHeadersOffset = binary.size();
+  for (const SectionHeader &section : sections) {
+    append(binary, section);
+  }
+
+  auto *elfHeader = reinterpret_cast<ElfHeader *>(binary.data());
+  memcpy(elfHeader->e_ident, ELFMAG, SELFMAG);
+  elfHeader->e_type = ET_DYN;
+  elfHeader->e_machine = kLoaderArch;
+  elfHeader->e_version = EV_CURRENT;
+  elfHeader->e_phoff = sizeof(ElfHeader);
+  elfHeader->e_shoff = sectionHeadersOffset;
+  elfHeader->e_ehsize = sizeof(ElfHeader);
+  elfHeader->e_phentsize = sizeof(ProgramHeader);
+  elfHeader->e_phnum = 2;
+  elfHeader->e_shentsize = sizeof(SectionHeader);
+  elfHeader->e_shnum = sizeof(sections) / sizeof(sections[0]);
+  elfHeader->e_shstrndx = elfHeader->e_shnum - 1;
+
+  auto *programHeaders =
+      reinterpret_cast<ProgramHeader *>(&binary[elfHeader->e_phoff]);
+  programHeaders[0].p_type = PT_LOAD;
+  programHeaders[0].p_flags = PF_R | PF_W | PF_X;
+  programHeaders[0].p_filesz = loadSize;
+  programHeaders[0].p_memsz = loadSize + kBssSize;
+  programHeaders[0].p_align = 16;
+  programHeaders[1].p_type = PT_DYNAMIC;
+  programHeaders[1].p_flags = PF_R | PF_W;
+  programHeaders[1].p_offset = dynamicOffset;
+  programHeaders[1].p_vaddr = dynamicOffset;
+  programHeaders[1].p_filesz = sizeof(dynamic);
+  programHeaders[1].p_memsz = sizeof(dynamic);
+  return binary;
+}
+
+ElfHeader *getElfHeader(std::vector<uint8_t> &binary) {
+  return reinterpret_cast<ElfHeader *>(binary.data());
+}
+
+ProgramHeader *getProgramHeaders(std::vector<uint8_t> &binary) {
+  return reinterpret_cast<ProgramHeader *>(
+      &binary[getElfHeader(binary)->e_phoff]);
+}
+
+class NanoappLoaderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    gNumAllocations = 0;
+    gFailedAllocationSize = 0;
+    gNumCachedSymbols = 0;
+    gNumInitCalls = 0;
+    gNumFiniCalls = 0;
+  }
+
+  void TearDown() override {
+    EXPECT_EQ(gNumAllocations, 0);
+  }
+
+  //! Streams a binary in fragments, returning nullptr if it failed to load.
+  NanoappLoader *stream(const std::vector<uint8_t> &binary,
+                        size_t fragmentSize) {
+    NanoappLoader *loader =
+        NanoappLoader::createStreaming(binary.size(), false /* mapIntoTcm */);
+    if (loader == nullptr) {
+      return nullptr;
+    }
+    bool success = true;
+    for (size_t offset = 0; success && offset < binary.size();
+         offset += fragmentSize) {
+      success = loader->copyFragment(
+          &binary[offset], std::min(fragmentSize, binary.size() - offset));
+    }
+    if (!success || !loader->finishStreaming()) {
+      NanoappLoader::destroy(loader);
+      return nullptr;
+    }
+    return loader;
+  }
+
+  NanoappLoader *load(std::vector<uint8_t> &binary, bool streamed) {
+    return streamed
+               ? stream(binary, 64 /* fragmentSize */)
+               : NanoappLoader::create(binary.data(), false /* mapIntoTcm */);
+  }
+
+  //! Verifies a loaded binary and destroys its loader.
+  void expectLoaded(NanoappLoader *loader) {
+    ASSERT_NE(loader, nullptr);
+    EXPECT_EQ(gNumInitCalls, 1);
+    auto *value =
+        static_cast<uint32_t *>(loader->findSymbolByName("nanoappValue"));
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(*value, kValue);
+
+    // The memory that isn't in the file, following the value and its padding,
+    // is zeroed
+    const auto *bss = reinterpret_cast<const uint8_t *>(value + 2);
+    for (size_t i = 0; i < kBssSize; i++) {
+      ASSERT_EQ(bss[i], 0);
+    }
+
+    NanoappLoader::destroy(loader);
+    EXPECT_EQ(gNumFiniCalls, 1);
+  }
+};
+
+TEST_F(NanoappLoaderTest, LoadsWholeBinary) {
+  std::vector<uint8_t> binary = makeBinary();
+  expectLoaded(NanoappLoader::create(binary.data(), false /* mapIntoTcm */));
+}
+
+TEST_F(NanoappLoaderTest, StreamsBinaryInAnyFragmentSize) {
+  for (Layout layout :
+       {Layout::kSymtabStrtabShstrtab, Layout::kSymtabShstrtabStrtab}) {
+    std::vector<uint8_t> binary = makeBinary(layout);
+    for (size_t fragmentSize : {size_t{1}, size_t{7}, size_t{64}, size_t{100},
+                                binary.size()}) {
+      SCOPED_TRACE(testing::Message() << "fragment size " << fragmentSize);
+      SetUp();
+      expectLoaded(stream(binary, fragmentSize));
+    }
+  }
+}
+
+TEST_F(NanoappLoaderTest, RejectsTruncatedBinary) {
+  std::vector<uint8_t> binary = makeBinary();
+  size_t sectionHeadersOffset = getElfHeader(binary)->e_shoff;
+  for (size_t size : {sizeof(ElfHeader) / 2, sizeof(ElfHeader),
+                      sizeof(ElfHeader) + sizeof(ProgramHeader),
+                      sectionHeadersOffset, binary.size() - 1}) {
+    SCOPED_TRACE(testing::Message() << "truncated to " << size);
+    std::vector<uint8_t> truncated(binary.begin(), binary.begin() + size);
+    EXPECT_EQ(stream(truncated, 64 /* fragmentSize */), nullptr);
+  }
+
+  // Receiving less data than announced
+  NanoappLoader *loader =
+      NanoappLoader::createStreaming(binary.size(), false /* mapIntoTcm */);
+  ASSERT_NE(loader, nullptr);
+  EXPECT_TRUE(loader->copyFragment(binary.data(), binary.size() - 1));
+  EXPECT_FALSE(loader->finishStreaming());
+  NanoappLoader::destroy(loader);
+
+  // Receiving more data than announced
+  loader =
+      NanoappLoader::createStreaming(binary.size(), false /* mapIntoTcm */);
+  ASSERT_NE(loader, nullptr);
+  EXPECT_TRUE(loader->copyFragment(binary.data(), binary.size() - 1));
+  EXPECT_FALSE(loader->copyFragment(binary.data(), 2));
+  NanoappLoader::destroy(loader);
+  EXPECT_EQ(gNumInitCalls, 0);
+}
+
+TEST_F(NanoappLoaderTest, RejectsMalformedElfHeader) {
+  std::vector<uint8_t> badMagic = makeBinary();
+  getElfHeader(badMagic)->e_ident[EI_MAG1] = 'X';
+  EXPECT_EQ(stream(badMagic, 64 /* fragmentSize */), nullptr);
+
+  std::vector<uint8_t> badMachine = makeBinary();
+  getElfHeader(badMachine)->e_machine = kLoaderArch + 1;
+  EXPECT_EQ(stream(badMachine, 64 /* fragmentSize */), nullptr);
+
+  std::vector<uint8_t> badSectionNames = makeBinary();
+  getElfHeader(badSectionNames)->e_shstrndx =
+      getElfHeader(badSectionNames)->e_shnum;
+  EXPECT_EQ(stream(badSectionNames, 64 /* fragmentSize */), nullptr);
+  EXPECT_EQ(gNumInitCalls, 0);
+}
+
+TEST_F(NanoappLoaderTest, RejectsProgramHeadersOutOfBounds) {
+  std::vector<uint8_t> binary = makeBinary();
+  for (size_t phoff :
+       {size_t{0}, sizeof(ElfHeader) - 1, binary.size(),
+        binary.size() - sizeof(ProgramHeader), SIZE_MAX,
+        SIZE_MAX - sizeof(ProgramHeader) + 1}) {
+    SCOPED_TRACE(testing::Message() << "e_phoff " << phoff);
+    std::vector<uint8_t> malformed = binary;
+    getElfHeader(malformed)->e_phoff = phoff;
+    EXPECT_EQ(stream(malformed, 64 /* fragmentSize */), nullptr);
+  }
+
+  std::vector<uint8_t> tooManyHeaders = binary;
+  getElfHeader(tooManyHeaders)->e_phnum = UINT16_MAX;
+  EXPECT_EQ(stream(tooManyHeaders, 64 /* fragmentSize */), nullptr);
+  EXPECT_EQ(gNumInitCalls, 0);
+}
+
+TEST_F(NanoappLoaderTest, RejectsSegmentsLargerInFileThanInMemory) {
+  std::vector<uint8_t> binary = makeBinary();
+  ProgramHeader &loadSegment = getProgramHeaders(binary)[0];
+  loadSegment.p_memsz = loadSegment.p_filesz - 1;
+  EXPECT_EQ(stream(binary, 64 /* fragmentSize */), nullptr);
+  EXPECT_EQ(NanoappLoader::create(binary.data(), false /* mapIntoTcm */),
+            nullptr);
+
+  std::vector<uint8_t> dynamic = makeBinary();
+  getProgramHeaders(dynamic)[1].p_filesz = SIZE_MAX;
+  EXPECT_EQ(stream(dynamic, 64 /* fragmentSize */), nullptr);
+  EXPECT_EQ(gNumInitCalls, 0);
+}
+
+TEST_F(NanoappLoaderTest, RejectsSectionsOutOfBounds) {
+  std::vector<uint8_t> binary = makeBinary();
+  for (size_t shoff : {binary.size(), SIZE_MAX - sizeof(SectionHeader)}) {
+    SCOPED_TRACE(testing::Message() << "e_shoff " << shoff);
+    std::vector<uint8_t> malformed = binary;
+    getElfHeader(malformed)->e_shoff = shoff;
+    EXPECT_EQ(stream(malformed, 64 /* fragmentSize */), nullptr);
+  }
+
+  // The section names table is the last section header
+  std::vector<uint8_t> badNames = binary;
+  auto *sectionNames = reinterpret_cast<SectionHeader *>(
+      &badNames[badNames.size() - sizeof(SectionHeader)]);
+  sectionNames->sh_size = SIZE_MAX;
+  EXPECT_EQ(stream(badNames, 64 /* fragmentSize */), nullptr);
+  EXPECT_EQ(gNumInitCalls, 0);
+}
+
+TEST_F(NanoappLoaderTest, FindsExportedSymbols) {
+  EXPECT_EQ(NanoappLoader::findExportedSymbol("chreGetTime"),
+            reinterpret_cast<void *>(chreGetTime));
+  EXPECT_EQ(NanoappLoader::findExportedSymbol("chreLog"),
+            reinterpret_cast<void *>(chreLog));
+  EXPECT_NE(NanoappLoader::findExportedSymbol("__cxa_atexit"), nullptr);
+
+  for (const char *name :
+       {"", "chreGetTim", "chreGetTimes", "chreGetTime ", "CHREGETTIME",
+        "nanoappValue"}) {
+    EXPECT_EQ(NanoappLoader::findExportedSymbol(name), nullptr)
+        << "'" << name << "'";
+  }
+}
+
+#ifdef CHREX_SYMBOL_EXTENSIONS
+TEST_F(NanoappLoaderTest, FindsVendorSymbolsMissingFromExportedOnes) {
+  EXPECT_EQ(NanoappLoader::findExportedSymbol("chreTestVendorFunction"),
+            reinterpret_cast<void *>(chreTestVendorFunction));
+  EXPECT_EQ(NanoappLoader::findExportedSymbol("chreTestVendorFunctio"),
+            nullptr);
+}
+#endif  // CHREX_SYMBOL_EXTENSIONS
+
+class NanoappLoaderImportsTest : public NanoappLoaderTest,
+                                 public ::testing::WithParamInterface<bool> {
+ protected:
+  void SetUp() override {
+    NanoappLoaderTest::SetUp();
+    mImports = {"chreGetTime", "chreLog"};
+    mExpected = {reinterpret_cast<void *>(chreGetTime),
+                 reinterpret_cast<void *>(chreLog)};
+#ifdef CHREX_SYMBOL_EXTENSIONS
+    mImports.push_back("chreTestVendorFunction");
+    mExpected.push_back(reinterpret_cast<void *>(chreTestVendorFunction));
+#endif  // CHREX_SYMBOL_EXTENSIONS
+  }
+
+  //! Loads a binary importing mImports, and verifies where they resolved to.
+  void expectImportsResolved() {
+    std::vector<uint8_t> binary =
+        makeBinary(Layout::kSymtabStrtabShstrtab, mImports);
+    NanoappLoader *loader = load(binary, GetParam() /* streamed */);
+    ASSERT_NE(loader, nullptr);
+    auto *slots =
+        static_cast<ElfAddr *>(loader->findSymbolByName("nanoappImports"));
+    ASSERT_NE(slots, nullptr);
+    for (size_t i = 0; i < mImports.size() * kRelocationsPerImport; i++) {
+      EXPECT_EQ(reinterpret_cast<void *>(slots[i]),
+                mExpected[i / kRelocationsPerImport])
+          << mImports[i / kRelocationsPerImport];
+    }
+    NanoappLoader::destroy(loader);
+  }
+
+  std::vector<std::string> mImports;
+  std::vector<void *> mExpected;
+};
+
+TEST_P(NanoappLoaderImportsTest, ResolvesEachImportedSymbolOnce) {
+  expectImportsResolved();
+  EXPECT_EQ(gNumCachedSymbols,
+            mImports.size() * (kRelocationsPerImport - 1));
+}
+
+TEST_P(NanoappLoaderImportsTest, ResolvesImportedSymbolsWithoutCache) {
+  // The cache holds an address for each symbol of the binary
+  gFailedAllocationSize =
+      (1 + kNumDefinedSymbols + mImports.size()) * sizeof(void *);
+  expectImportsResolved();
+  EXPECT_EQ(gNumCachedSymbols, 0);
+}
+
+TEST_P(NanoappLoaderImportsTest, RejectsMissingImportedSymbol) {
+  mImports.push_back("chreNotExported");
+  std::vector<uint8_t> binary =
+      makeBinary(Layout::kSymtabStrtabShstrtab, mImports);
+  EXPECT_EQ(load(binary, GetParam() /* streamed */), nullptr);
+  EXPECT_EQ(gNumInitCalls, 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(NanoappLoaderImportsTest, NanoappLoaderImportsTest,
+                         ::testing::Bool());
+
+}  // namespace
+}  // namespace chre
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "chre/platform/shared/trace_buffer.h"
+
+namespace chre {
+namespace {
+
+constexpr const char *kLabel = "label";
+constexpr const char *kGroup = "group";
+
+TEST(TraceBuffer, ReadsRecordsInOrder) {
+  auto buffer = std::make_unique<TraceBuffer>();
+  EXPECT_EQ(buffer->getNumThreads(), 0);
+
+  buffer->record(TraceRecordType::START, kLabel, kGroup, 1);
+  buffer->record(TraceRecordType::INSTANT, kLabel, nullptr, 2);
+  buffer->record(TraceRecordType::END, kLabel, kGroup, 3);
+  ASSERT_EQ(buffer->getNumThreads(), 1);
+
+  TraceRecord records[4];
+  ASSERT_EQ(buffer->read(0, records, 2), 2);
+  EXPECT_EQ(records[0].type, TraceRecordType::START);
+  EXPECT_EQ(records[0].label, kLabel);
+  EXPECT_EQ(records[0].group, kGroup);
+  EXPECT_EQ(records[0].traceId, 1);
+  EXPECT_EQ(records[1].type, TraceRecordType::INSTANT);
+  EXPECT_EQ(records[1].group, nullptr);
+  EXPECT_LE(records[0].timestampNs, records[1].timestampNs);
+
+  ASSERT_EQ(buffer->read(0, records, 4), 1);
+  EXPECT_EQ(records[0].type, TraceRecordType::END);
+  EXPECT_EQ(records[0].traceId, 3);
+  EXPECT_EQ(buffer->read(0, records, 4), 0);
+  EXPECT_EQ(buffer->read(1, records, 4), 0);
+  EXPECT_EQ(buffer->getAndResetNumDropped(), 0);
+}
+
+TEST(TraceBuffer, DropsRecordsWhenFull) {
+  auto buffer = std::make_unique<TraceBuffer>();
+  constexpr size_t kNumRecords = TraceBuffer::kRecordsPerThread + 3;
+  for (uint32_t i = 0; i < kNumRecords; i++) {
+    buffer->record(TraceRecordType::INSTANT, kLabel, kGroup, i);
+  }
+  EXPECT_EQ(buffer->getAndResetNumDropped(), 3);
+  EXPECT_EQ(buffer->getAndResetNumDropped(), 0);
+
+  // The newest records are dropped, and recording resumes once read
+  TraceRecord records[TraceBuffer::kRecordsPerThread];
+  ASSERT_EQ(buffer->read(0, records, 1), 1);
+  EXPECT_EQ(records[0].traceId, 0);
+  buffer->record(TraceRecordType::INSTANT, kLabel, kGroup, kNumRecords);
+  EXPECT_EQ(buffer->getAndResetNumDropped(), 0);
+
+  ASSERT_EQ(buffer->read(0, records, TraceBuffer::kRecordsPerThread),
+            TraceBuffer::kRecordsPerThread);
+  EXPECT_EQ(records[0].traceId, 1);
+  EXPECT_EQ(records[TraceBuffer::kRecordsPerThread - 1].traceId, kNumRecords);
+}
+
+TEST(TraceBuffer, RecordsThreadsSeparately) {
+  auto buffer = std::make_unique<TraceBuffer>();
+  buffer->record(TraceRecordType::INSTANT, kLabel, kGroup, 0);
+  for (uint32_t i = 1; i < TraceBuffer::kMaxThreads + 2; i++) {
+    std::thread thread([&buffer, i]() {
+      buffer->record(TraceRecordType::START, kLabel, kGroup, i);
+      buffer->record(TraceRecordType::END, kLabel, kGroup, i);
+    });
+    thread.join();
+  }
+  buffer->record(TraceRecordType::INSTANT, kLabel, kGroup, 0);
+
+  // The records of the threads past the limit are dropped
+  ASSERT_EQ(buffer->getNumThreads(), TraceBuffer::kMaxThreads);
+  EXPECT_EQ(buffer->getAndResetNumDropped(), 4);
+
+  TraceRecord records[4];
+  ASSERT_EQ(buffer->read(0, records, 4), 2);
+  EXPECT_EQ(records[0].traceId, 0);
+  EXPECT_EQ(records[1].traceId, 0);
+  for (uint32_t i = 1; i < TraceBuffer::kMaxThreads; i++) {
+    ASSERT_EQ(buffer->read(i, records, 4), 2);
+    EXPECT_EQ(records[0].type, TraceRecordType::START);
+    EXPECT_EQ(records[0].traceId, i);
+    EXPECT_EQ(records[1].type, TraceRecordType::END);
+    EXPECT_EQ(records[1].traceId, i);
+  }
+}
+
+TEST(TraceBuffer, AssignsNewRingsToNewBuffer) {
+  auto buffer = std::make_unique<TraceBuffer>();
+  buffer->record(TraceRecordType::INSTANT, kLabel, kGroup, 1);
+  buffer.reset();
+
+  // The thread isn't assigned its ring of the previous buffer even if the new
+  // one is allocated at the same address
+  buffer = std::make_unique<TraceBuffer>();
+  EXPECT_EQ(buffer->getNumThreads(), 0);
+  buffer->record(TraceRecordType::INSTANT, kLabel, kGroup, 2);
+  ASSERT_EQ(buffer->getNumThreads(), 1);
+
+  TraceRecord record;
+  ASSERT_EQ(buffer->read(0, &record, 1), 1);
+  EXPECT_EQ(record.traceId, 2);
+}
+
+TEST(TraceBuffer, RecordTraceRequiresSingleton) {
+  recordTrace(TraceRecordType::INSTANT, kLabel);
+
+  TraceBufferSingleton::init();
+  recordTrace(TraceRecordType::INSTANT, kLabel);
+  TraceRecord record;
+  ASSERT_EQ(TraceBufferSingleton::get()->read(0, &record, 1), 1);
+  EXPECT_EQ(record.label, kLabel);
+  EXPECT_EQ(record.group, nullptr);
+  EXPECT_EQ(record.traceId, 0);
+  TraceBufferSingleton::deinit();
+}
+
+}  // namespace
+}  // namespace chre
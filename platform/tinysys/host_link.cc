@@ -132,6 +132,8 @@ enum class PendingMessageType {
   NanConfigurationRequest,
   PulseRequest,
   PulseResponse,
+  NanoappMessageBatch,
+  TraceData,
 };
 
 struct PendingMessage {
@@ -257,6 +259,8 @@ DRAM_REGION_FUNCTION bool dequeueMessage(PendingMessage pendingMsg) {
     case PendingMessageType::MetricLog:
     case PendingMessageType::NanConfigurationRequest:
     case PendingMessageType::PulseResponse:
+    case PendingMessageType::NanoappMessageBatch:
+    case PendingMessageType::TraceData:
       result = generateMessageFromBuilder(pendingMsg.data.builder);
       break;
 
@@ -680,6 +684,58 @@ DRAM_REGION_FUNCTION bool HostLink::sendMessage(HostMessage const *message) {
   return success;
 }
 
+DRAM_REGION_FUNCTION bool HostLink::sendMessageBatch(
+    const MessageToHost *const *messages, size_t numMessages) {
+  struct MessageBatchData {
+    const MessageToHost *const *messages;
+    size_t numMessages;
+  };
+
+  auto msgBuilder = [](ChreFlatBufferBuilder &builder, void *cookie) {
+    const auto *data = static_cast<const MessageBatchData *>(cookie);
+    DynamicVector<NanoappMessageOffset> messageOffsets;
+    messageOffsets.reserve(data->numMessages);
+    for (size_t i = 0; i < data->numMessages; i++) {
+      const MessageToHost *msgToHost = data->messages[i];
+      HostProtocolChre::addNanoappMessageToBatch(
+          builder, messageOffsets, msgToHost->appId,
+          msgToHost->toHostData.messageType, msgToHost->toHostData.hostEndpoint,
+          msgToHost->message.data(), msgToHost->message.size(),
+          msgToHost->toHostData.appPermissions,
+          msgToHost->toHostData.messagePermissions,
+          msgToHost->toHostData.wokeHost);
+    }
+    HostProtocolChre::finishNanoappMessageBatch(builder, messageOffsets);
+  };
+
+  size_t initialSize = HostProtocolChre::kNanoappMessageBatchEncodingOverhead;
+  for (size_t i = 0; i < numMessages; i++) {
+    initialSize += messages[i]->message.size() +
+                   HostProtocolChre::kNanoappMessageEncodingOverhead;
+  }
+
+  if (!isInitialized()) {
+    LOGW("Dropping outbound message batch: host link not initialized yet");
+    return false;
+  }
+
+  MessageBatchData data;
+  data.messages = messages;
+  data.numMessages = numMessages;
+  bool success =
+      buildAndEnqueueMessage(PendingMessageType::NanoappMessageBatch,
+                             initialSize, msgBuilder, &data);
+
+  // The message payloads were copied into the encoded batch, so they can be
+  // released right away
+  if (success) {
+    for (size_t i = 0; i < numMessages; i++) {
+      getHostCommsManager().onMessageToHostComplete(messages[i]);
+    }
+  }
+  return success;
+}
+
 bool HostLink::sendMessageDeliveryStatus(uint32_t /* messageSequenceNumber */,
                                          uint8_t /* errorCode */) {
   return false;
@@ -745,19 +801,21 @@ DRAM_REGION_FUNCTION void HostMessageHandlers::handleNanoappListRequest(
 
 DRAM_REGION_FUNCTION void HostMessageHandlers::sendFragmentResponse(
     uint16_t hostClientId, uint32_t transactionId, uint32_t fragmentId,
-    bool success) {
+    bool success, uint32_t fragmentWindowSize, bool binaryResident) {
   struct FragmentedLoadInfoResponse {
     uint16_t hostClientId;
     uint32_t transactionId;
     uint32_t fragmentId;
     bool success;
+    uint32_t fragmentWindowSize;
+    bool binaryResident;
   };
 
   auto msgBuilder = [](ChreFlatBufferBuilder &builder, void *cookie) {
     auto *cbData = static_cast<FragmentedLoadInfoResponse *>(cookie);
     HostProtocolChre::encodeLoadNanoappResponse(
         builder, cbData->hostClientId, cbData->transactionId, cbData->success,
-        cbData->fragmentId);
+        cbData->fragmentId, cbData->fragmentWindowSize, cbData->binaryResident);
   };
 
   FragmentedLoadInfoResponse response = {
@@ -765,6 +823,8 @@ DRAM_REGION_FUNCTION void HostMessageHandlers::sendFragmentResponse(
       .transactionId = transactionId,
       .fragmentId = fragmentId,
       .success = success,
+      .fragmentWindowSize = fragmentWindowSize,
+      .binaryResident = binaryResident,
   };
   constexpr size_t kInitialBufferSize = 52;
   buildAndEnqueueMessage(PendingMessageType::LoadNanoappResponse,
@@ -785,12 +845,13 @@ DRAM_REGION_FUNCTION void HostMessageHandlers::handleLoadNanoappRequest(
     uint16_t hostClientId, uint32_t transactionId, uint64_t appId,
     uint32_t appVersion, uint32_t appFlags, uint32_t targetApiVersion,
     const void *buffer, size_t bufferLen, const char *appFileName,
-    uint32_t fragmentId, size_t appBinaryLen, bool respondBeforeStart) {
+    uint32_t fragmentId, size_t appBinaryLen, bool respondBeforeStart,
+    uint32_t fragmentWindowSize, uint64_t appBinaryHash) {
   UNUSED_VAR(appFileName);
 
   loadNanoappData(hostClientId, transactionId, appId, appVersion, appFlags,
                   targetApiVersion, buffer, bufferLen, fragmentId, appBinaryLen,
-                  respondBeforeStart);
+                  respondBeforeStart, fragmentWindowSize, appBinaryHash);
 }
 
 DRAM_REGION_FUNCTION void HostMessageHandlers::handleUnloadNanoappRequest(
@@ -876,6 +937,72 @@ DRAM_REGION_FUNCTION void HostMessageHandlers::handleNanConfigurationUpdate(
   LOGE("%s is unsupported", __func__);
 }
 
+DRAM_REGION_FUNCTION void HostMessageHandlers::handleTraceDataRequest(
+    uint16_t hostClientId) {
+#ifdef CHRE_TRACE_BUFFER_ENABLED
+  struct TraceMessageData {
+    uint16_t hostClientId;
+    TraceRecord records[HostProtocolChre::kMaxTraceRecordsPerMessage];
+    size_t numRecords;
+    uint8_t threadIndex;
+    uint32_t numDropped;
+    bool last;
+  };
+
+  auto msgBuilder = [](ChreFlatBufferBuilder &builder, void *cookie) {
+    const auto *data = static_cast<const TraceMessageData *>(cookie);
+    HostProtocolChre::encodeTraceData(builder, data->hostClientId,
+                                      data->records, data->numRecords,
+                                      data->threadIndex, data->numDropped,
+                                      data->last);
+  };
+
+  auto data = MakeUnique<TraceMessageData>();
+  if (data.isNull()) {
+    LOG_OOM();
+    return;
+  }
+
+  // Each record takes 18 bytes, plus its label and group the first time
+  constexpr size_t kInitialSize =
+      64 + HostProtocolChre::kMaxTraceRecordsPerMessage * 48;
+  data->hostClientId = hostClientId;
+  data->numDropped = 0;
+  data->last = false;
+
+  // Only the records buffered when the request is received are sent, so that
+  // threads tracing continuously can't make the response unbounded
+  TraceBuffer *traceBuffer = TraceBufferSingleton::safeGet();
+  size_t numThreads =
+      (traceBuffer == nullptr) ? 0 : traceBuffer->getNumThreads();
+  bool enqueued = true;
+  for (size_t i = 0; i < numThreads && enqueued; i++) {
+    data->threadIndex = static_cast<uint8_t>(i);
+    for (size_t numRead = 0;
+         numRead < TraceBuffer::kRecordsPerThread && enqueued;
+         numRead += data->numRecords) {
+      data->numRecords = traceBuffer->read(
+          i, data->records, HostProtocolChre::kMaxTraceRecordsPerMessage);
+      if (data->numRecords == 0) {
+        break;
+      }
+      enqueued = buildAndEnqueueMessage(PendingMessageType::TraceData,
+                                        kInitialSize, msgBuilder, data.get());
+    }
+  }
+
+  data->numRecords = 0;
+  data->numDropped =
+      (traceBuffer == nullptr) ? 0 : traceBuffer->getAndResetNumDropped();
+  data->last = true;
+  buildAndEnqueueMessage(PendingMessageType::TraceData, kInitialSize,
+                         msgBuilder, data.get());
+#else
+  UNUSED_VAR(hostClientId);
+  LOGE("%s is unsupported", __func__);
+#endif  // CHRE_TRACE_BUFFER_ENABLED
+}
+
 DRAM_REGION_FUNCTION void sendAudioRequest() {
   auto msgBuilder = [](ChreFlatBufferBuilder &builder, void * /*cookie*/) {
     HostProtocolChre::encodeLowPowerMicAccessRequest(builder);
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "chre/core/event_loop_manager.h"
+#include "chre/core/event_loop_watchdog.h"
+#include "chre_api/chre/event.h"
+
+#include "gtest/gtest.h"
+#include "inc/test_util.h"
+#include "test_base.h"
+#include "test_event.h"
+#include "test_event_queue.h"
+#include "test_util.h"
+
+namespace chre {
+namespace {
+
+constexpr uint16_t kLowPriorityEventType = CHRE_EVENT_FIRST_USER_VALUE;
+
+CREATE_CHRE_TEST_EVENT(SLOW, 0);
+CREATE_CHRE_TEST_EVENT(PING, 1);
+CREATE_CHRE_TEST_EVENT(LOW_PRIORITY_RECEIVED, 2);
+
+//! Takes longer than its budget to handle SLOW events.
+class SlowApp : public TestNanoapp {
+ public:
+  explicit SlowApp(
+      std::chrono::milliseconds slowDuration = std::chrono::milliseconds(30))
+      : mSlowDuration(slowDuration) {}
+
+  void handleEvent(uint32_t, uint16_t eventType,
+                   const void *eventData) override {
+    switch (eventType) {
+      case kLowPriorityEventType: {
+        TestEventQueueSingleton::get()->pushEvent(LOW_PRIORITY_RECEIVED);
+        break;
+      }
+      case CHRE_EVENT_TEST_EVENT: {
+        auto event = static_cast<const TestEvent *>(eventData);
+        if (event->type == SLOW) {
+          std::this_thread::sleep_for(mSlowDuration);
+        }
+        // Pushed for every event, so that the test can wait for the watchdog
+        // to be disarmed after the SLOW event by sending a following event
+        TestEventQueueSingleton::get()->pushEvent(PING);
+        break;
+      }
+    }
+  }
+
+ private:
+  const std::chrono::milliseconds mSlowDuration;
+};
+
+class EventLoopWatchdogTest : public TestBase {
+ protected:
+  //! Sends an event through the event loop and waits for it to be handled.
+  void sendAndWait(uint64_t appId, uint16_t eventType) {
+    sendEventToNanoapp(appId, eventType);
+    waitForEvent(PING);
+  }
+
+  void postLowPriorityEvent(uint16_t instanceId) {
+    EXPECT_TRUE(EventLoopManagerSingleton::get()
+                    ->getEventLoop()
+                    .postLowPriorityEventOrFree(
+                        kLowPriorityEventType, /* eventData= */ nullptr,
+                        /* freeCallback= */ nullptr, kSystemInstanceId,
+                        instanceId));
+  }
+};
+
+TEST_F(EventLoopWatchdogTest, RecordsNanoappExceedingBudget) {
+  uint64_t appId = loadNanoapp(MakeUnique<SlowApp>());
+  Nanoapp *nanoapp = getNanoappByAppId(appId);
+  ASSERT_NE(nanoapp, nullptr);
+  EXPECT_EQ(nanoapp->getEventBudget(),
+            Nanoseconds(EventLoopWatchdog::kDefaultBudget));
+  nanoapp->setEventBudget(Milliseconds(10));
+
+  EventLoopWatchdog &watchdog =
+      EventLoopManagerSingleton::get()->getEventLoop().getWatchdog();
+  uint32_t numOverruns = watchdog.getNumOverruns();
+  uint32_t numMissedDeadlines = watchdog.getNumMissedDeadlines();
+
+  sendAndWait(appId, PING);
+  sendAndWait(appId, PING);
+  EXPECT_EQ(nanoapp->getNumEventBudgetOverruns(), 0);
+
+  sendAndWait(appId, SLOW);
+  sendAndWait(appId, PING);
+  EXPECT_EQ(nanoapp->getNumEventBudgetOverruns(), 1);
+  EXPECT_EQ(watchdog.getNumOverruns(), numOverruns + 1);
+  EXPECT_EQ(watchdog.getNumMissedDeadlines(), numMissedDeadlines + 1);
+
+  // Throttling is disabled by default
+  postLowPriorityEvent(nanoapp->getInstanceId());
+  waitForEvent(LOW_PRIORITY_RECEIVED);
+  EXPECT_EQ(nanoapp->getNumThrottledEvents(), 0);
+}
+
+TEST_F(EventLoopWatchdogTest, DeadlineFollowsTheBudgetOfTheNanoapp) {
+  uint64_t defaultBudgetMs =
+      EventLoopWatchdog::kDefaultBudget.getMilliseconds();
+  uint64_t appId = loadNanoapp(MakeUnique<SlowApp>(
+      std::chrono::milliseconds(defaultBudgetMs + defaultBudgetMs / 2)));
+  Nanoapp *nanoapp = getNanoappByAppId(appId);
+  ASSERT_NE(nanoapp, nullptr);
+  nanoapp->setEventBudget(Milliseconds(3 * defaultBudgetMs));
+
+  EventLoopWatchdog &watchdog =
+      EventLoopManagerSingleton::get()->getEventLoop().getWatchdog();
+  uint32_t numMissedDeadlines = watchdog.getNumMissedDeadlines();
+
+  // Handling the event past the default budget but within the budget of the
+  // nanoapp isn't reported
+  sendAndWait(appId, SLOW);
+  sendAndWait(appId, PING);
+  EXPECT_EQ(nanoapp->getNumEventBudgetOverruns(), 0);
+  EXPECT_EQ(watchdog.getNumMissedDeadlines(), numMissedDeadlines);
+}
+
+TEST_F(EventLoopWatchdogTest, ThrottlesLowPriorityEventsOfSlowNanoapp) {
+  uint64_t appId = loadNanoapp(MakeUnique<SlowApp>());
+  Nanoapp *nanoapp = getNanoappByAppId(appId);
+  ASSERT_NE(nanoapp, nullptr);
+  nanoapp->setEventBudget(Milliseconds(10));
+  EventLoopManagerSingleton::get()
+      ->getEventLoop()
+      .getWatchdog()
+      .setThrottleDuration(Seconds(60));
+
+  sendAndWait(appId, SLOW);
+  sendAndWait(appId, PING);
+  ASSERT_EQ(nanoapp->getNumEventBudgetOverruns(), 1);
+
+  // Low-priority events are dropped while other events are still delivered
+  postLowPriorityEvent(nanoapp->getInstanceId());
+  sendAndWait(appId, PING);
+  EXPECT_EQ(nanoapp->getNumThrottledEvents(), 1);
+
+  EventLoopManagerSingleton::get()
+      ->getEventLoop()
+      .getWatchdog()
+      .setThrottleDuration(Nanoseconds(0));
+  postLowPriorityEvent(nanoapp->getInstanceId());
+  waitForEvent(LOW_PRIORITY_RECEIVED);
+  EXPECT_EQ(nanoapp->getNumThrottledEvents(), 1);
+}
+
+}  // namespace
+}  // namespace chre
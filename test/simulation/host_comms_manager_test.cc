@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+
+#include "chre/core/event_loop_manager.h"
+#include "chre/core/host_comms_manager.h"
+#include "chre/platform/system_time.h"
+#include "chre/util/time.h"
+
+#include "gtest/gtest.h"
+#include "test_base.h"
+
+namespace chre {
+
+#ifdef CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+
+constexpr uint16_t kHostEndpoint = 0x8001;
+
+//! Exercises the reliable message bookkeeping of the HostCommsManager
+//! directly, while the event loop is idle.
+class HostCommsManagerTest : public TestBase {
+ protected:
+  using EndpointStats = HostCommsManager::ReliableMessageEndpointStats;
+  using OutstandingMessage = HostCommsManager::OutstandingReliableMessage;
+
+  static constexpr size_t kNumSlots = HostCommsManager::kMaxOutstandingMessages;
+
+  HostCommsManager &manager() {
+    return EventLoopManagerSingleton::get()->getHostCommsManager();
+  }
+
+  static void updateRttEstimate(EndpointStats &stats, Nanoseconds rtt) {
+    HostCommsManager::updateRttEstimate(stats, rtt);
+  }
+
+  static Nanoseconds minRetryWaitTime() {
+    return HostCommsManager::kReliableMessageMinRetryWaitTime;
+  }
+
+  static Nanoseconds maxRetryWaitTime() {
+    return HostCommsManager::kReliableMessageMaxRetryWaitTime;
+  }
+
+  OutstandingMessage *add(MessageToHost &message, uint32_t sequenceNumber) {
+    message.messageSequenceNumber = sequenceNumber;
+    message.toHostData.hostEndpoint = kHostEndpoint;
+    return manager().addOutstandingReliableMessage(&message);
+  }
+
+  OutstandingMessage *find(uint32_t sequenceNumber) {
+    return manager().findOutstandingReliableMessage(sequenceNumber);
+  }
+
+  void remove(uint32_t sequenceNumber) {
+    manager().removeOutstandingReliableMessage(sequenceNumber);
+  }
+
+  size_t slotOf(uint32_t sequenceNumber) {
+    for (size_t i = 0; i < kNumSlots; ++i) {
+      MessageToHost *message =
+          manager().mOutstandingReliableMessages[i].message;
+      if (message != nullptr &&
+          message->messageSequenceNumber == sequenceNumber) {
+        return i;
+      }
+    }
+    return kNumSlots;
+  }
+
+  void recordResponse(uint32_t sequenceNumber) {
+    manager().recordReliableMessageResponse(sequenceNumber);
+  }
+
+  EndpointStats &endpointStats() {
+    return manager().getReliableMessageEndpointStats(kHostEndpoint);
+  }
+};
+
+TEST_F(HostCommsManagerTest, RttEstimateFollowsRfc6298) {
+  EndpointStats stats;
+
+  // The first sample initializes SRTT = R and RTTVAR = R/2
+  updateRttEstimate(stats, Milliseconds(100));
+  EXPECT_EQ(stats.rttSampleCount, 1);
+  EXPECT_EQ(stats.smoothedRtt, Milliseconds(100));
+  EXPECT_EQ(stats.rttVariation, Milliseconds(50));
+  EXPECT_EQ(stats.retryWaitTime, Milliseconds(300));
+
+  // Subsequent samples use alpha = 1/8 and beta = 1/4
+  updateRttEstimate(stats, Milliseconds(200));
+  EXPECT_EQ(stats.rttSampleCount, 2);
+  EXPECT_EQ(stats.rttVariation, Microseconds(62500));
+  EXPECT_EQ(stats.smoothedRtt, Microseconds(112500));
+  EXPECT_EQ(stats.retryWaitTime, Microseconds(362500));
+}
+
+TEST_F(HostCommsManagerTest, RetryWaitTimeIsClamped) {
+  EndpointStats fastStats;
+  updateRttEstimate(fastStats, Milliseconds(1));
+  EXPECT_EQ(fastStats.retryWaitTime, minRetryWaitTime());
+
+  EndpointStats slowStats;
+  updateRttEstimate(slowStats, Seconds(10));
+  EXPECT_EQ(slowStats.retryWaitTime, maxRetryWaitTime());
+}
+
+TEST_F(HostCommsManagerTest, RetriedMessagesDontGiveRttSamples) {
+  MessageToHost message;
+  OutstandingMessage *entry = add(message, /* sequenceNumber= */ 5);
+  ASSERT_NE(entry, nullptr);
+  entry->firstAttemptTime = SystemTime::getMonotonicTime() - Milliseconds(100);
+
+  // Per Karn's algorithm, the ACK of a retried message is ambiguous
+  entry->attemptCount = 2;
+  recordResponse(5);
+  EXPECT_EQ(endpointStats().ackCount, 1);
+  EXPECT_EQ(endpointStats().rttSampleCount, 0);
+
+  entry->attemptCount = 1;
+  recordResponse(5);
+  EXPECT_EQ(endpointStats().ackCount, 2);
+  EXPECT_EQ(endpointStats().rttSampleCount, 1);
+  EXPECT_GE(endpointStats().smoothedRtt, Milliseconds(100));
+  EXPECT_LT(endpointStats().smoothedRtt, Milliseconds(1000));
+
+  remove(5);
+  EXPECT_EQ(find(5), nullptr);
+}
+
+TEST_F(HostCommsManagerTest, RemoveShiftsBackCollidingEntries) {
+  // 0, 32 and 64 share home slot 0, and 1 is displaced from slot 1 by them
+  MessageToHost messages[4];
+  const uint32_t sequenceNumbers[] = {0, kNumSlots, 2 * kNumSlots, 1};
+  for (size_t i = 0; i < 4; ++i) {
+    ASSERT_NE(add(messages[i], sequenceNumbers[i]), nullptr);
+  }
+  EXPECT_EQ(slotOf(0), 0);
+  EXPECT_EQ(slotOf(kNumSlots), 1);
+  EXPECT_EQ(slotOf(2 * kNumSlots), 2);
+  EXPECT_EQ(slotOf(1), 3);
+
+  remove(0);
+  EXPECT_EQ(find(0), nullptr);
+  EXPECT_EQ(slotOf(kNumSlots), 0);
+  EXPECT_EQ(slotOf(2 * kNumSlots), 1);
+  EXPECT_EQ(slotOf(1), 2);
+  for (size_t i = 1; i < 4; ++i) {
+    OutstandingMessage *entry = find(sequenceNumbers[i]);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->message, &messages[i]);
+  }
+
+  // An entry already in its home slot isn't moved
+  remove(kNumSlots);
+  EXPECT_EQ(slotOf(2 * kNumSlots), 0);
+  EXPECT_EQ(slotOf(1), 1);
+
+  remove(2 * kNumSlots);
+  remove(1);
+  EXPECT_EQ(find(1), nullptr);
+}
+
+TEST_F(HostCommsManagerTest, RemoveShiftsBackAcrossWrapAround) {
+  // kNumSlots - 1 and 2 * kNumSlots - 1 share the last slot, so the second
+  // wraps around to slot 0
+  MessageToHost first;
+  MessageToHost second;
+  ASSERT_NE(add(first, kNumSlots - 1), nullptr);
+  ASSERT_NE(add(second, 2 * kNumSlots - 1), nullptr);
+  EXPECT_EQ(slotOf(2 * kNumSlots - 1), 0);
+
+  remove(kNumSlots - 1);
+  EXPECT_EQ(slotOf(2 * kNumSlots - 1), kNumSlots - 1);
+  OutstandingMessage *entry = find(2 * kNumSlots - 1);
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->message, &second);
+
+  remove(2 * kNumSlots - 1);
+  EXPECT_EQ(find(2 * kNumSlots - 1), nullptr);
+}
+
+#endif  // CHRE_RELIABLE_MESSAGE_SUPPORT_ENABLED
+
+}  // namespace chre
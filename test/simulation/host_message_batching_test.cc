@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "chre/core/event_loop_manager.h"
+#include "chre/core/host_comms_manager.h"
+#include "chre/platform/system_time.h"
+#include "chre/util/time.h"
+#include "chre_api/chre/event.h"
+
+#include "gtest/gtest.h"
+#include "inc/test_util.h"
+#include "test_base.h"
+#include "test_event.h"
+#include "test_event_queue.h"
+#include "test_util.h"
+
+namespace chre {
+
+#ifdef CHRE_HOST_MESSAGE_BATCHING_ENABLED
+
+namespace {
+
+CREATE_CHRE_TEST_EVENT(SEND_MESSAGES, 0);
+CREATE_CHRE_TEST_EVENT(MESSAGES_SENT, 1);
+CREATE_CHRE_TEST_EVENT(MESSAGE_FREED, 2);
+
+constexpr size_t kMaxNumMessages = 16;
+
+//! The payloads of the messages, each holding its index.
+uint8_t gMessages[kMaxNumMessages];
+
+//! The indices of the messages whose free callback was invoked, in order.
+//! Only accessed from the event loop thread, or by the test once it waited
+//! for an event pushed after the accesses.
+std::vector<uint8_t> gFreedMessages;
+
+Nanoseconds gSendTime;
+Nanoseconds gLastFreeTime;
+
+void recordFreedMessage(void *message, size_t /* messageSize */) {
+  gFreedMessages.push_back(*static_cast<uint8_t *>(message));
+  gLastFreeTime = SystemTime::getMonotonicTime();
+  TestEventQueueSingleton::get()->pushEvent(MESSAGE_FREED);
+}
+
+//! Sends the requested number of messages to the host, then reports how many
+//! of them were already released by the HostCommsManager.
+class SenderApp : public TestNanoapp {
+ public:
+  void handleEvent(uint32_t, uint16_t eventType,
+                   const void *eventData) override {
+    if (eventType == CHRE_EVENT_TEST_EVENT) {
+      auto event = static_cast<const TestEvent *>(eventData);
+      if (event->type == SEND_MESSAGES) {
+        auto numMessages = *static_cast<const uint32_t *>(event->data);
+        gSendTime = SystemTime::getMonotonicTime();
+        for (uint32_t i = 0; i < numMessages; i++) {
+          EXPECT_TRUE(chreSendMessageToHostEndpoint(
+              &gMessages[i], sizeof(gMessages[i]), /* messageType= */ 0,
+              CHRE_HOST_ENDPOINT_BROADCAST, recordFreedMessage));
+        }
+        TestEventQueueSingleton::get()->pushEvent(
+            MESSAGES_SENT, static_cast<uint32_t>(gFreedMessages.size()));
+      }
+    }
+  }
+};
+
+}  // namespace
+
+//! The Linux HostLink releases messages as soon as they're sent, so the free
+//! callbacks tell when, and in which order, messages left the batch.
+class HostMessageBatchingTest : public TestBase {
+ protected:
+  static constexpr size_t kMaxBatchedMessages =
+      HostCommsManager::kMaxBatchedMessages;
+  static constexpr Milliseconds kMaxBatchAge = HostCommsManager::kMaxBatchAge;
+
+  static_assert(kMaxBatchedMessages + 2 <= kMaxNumMessages);
+
+  void SetUp() override {
+    TestBase::SetUp();
+    for (size_t i = 0; i < kMaxNumMessages; i++) {
+      gMessages[i] = static_cast<uint8_t>(i);
+    }
+    gFreedMessages.clear();
+  }
+
+  //! @return the number of messages released before the sender returned
+  uint32_t sendMessages(uint64_t appId, uint32_t numMessages) {
+    sendEventToNanoapp(appId, SEND_MESSAGES, numMessages);
+    uint32_t numFreedWhenSent;
+    waitForEvent(MESSAGES_SENT, &numFreedWhenSent);
+    return numFreedWhenSent;
+  }
+};
+
+TEST_F(HostMessageBatchingTest, FlushesFullBatchesInOrder) {
+  uint64_t appId = loadNanoapp(MakeUnique<SenderApp>());
+
+  // Adding a message to a full batch flushes the batch first
+  uint32_t numMessages = kMaxBatchedMessages + 2;
+  EXPECT_EQ(sendMessages(appId, numMessages), kMaxBatchedMessages);
+
+  // The rest is flushed by the batch timer
+  for (uint32_t i = kMaxBatchedMessages; i < numMessages; i++) {
+    waitForEvent(MESSAGE_FREED);
+  }
+  ASSERT_EQ(gFreedMessages.size(), numMessages);
+  for (uint32_t i = 0; i < numMessages; i++) {
+    EXPECT_EQ(gFreedMessages[i], i);
+  }
+}
+
+TEST_F(HostMessageBatchingTest, FlushesBatchOnceItReachesMaxAge) {
+  uint64_t appId = loadNanoapp(MakeUnique<SenderApp>());
+
+  EXPECT_EQ(sendMessages(appId, 1), 0);
+  waitForEvent(MESSAGE_FREED);
+  ASSERT_EQ(gFreedMessages.size(), 1);
+  EXPECT_GE(gLastFreeTime - gSendTime, Nanoseconds(kMaxBatchAge));
+}
+
+TEST_F(HostMessageBatchingTest, FlushesBatchOnNanoappUnload) {
+  uint64_t appId = loadNanoapp(MakeUnique<SenderApp>());
+
+  // The unload is queued right behind the messages, so it's handled before
+  // the batch timer can expire
+  sendEventToNanoapp(appId, SEND_MESSAGES, static_cast<uint32_t>(2));
+  unloadNanoapp(appId);
+
+  std::vector<uint8_t> expectedMessages = {0, 1};
+  EXPECT_EQ(gFreedMessages, expectedMessages);
+}
+
+#endif  // CHRE_HOST_MESSAGE_BATCHING_ENABLED
+
+}  // namespace chre
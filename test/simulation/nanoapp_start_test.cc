@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "chre/core/event_loop_manager.h"
+#include "chre/core/nanoapp.h"
+#include "chre/util/system/napp_permissions.h"
+
+#include "gtest/gtest.h"
+#include "test_base.h"
+#include "test_event.h"
+#include "test_event_queue.h"
+#include "test_util.h"
+
+namespace chre {
+namespace {
+
+constexpr uint64_t kFirstAppId = 0x0123456789000001;
+constexpr uint64_t kSecondAppId = 0x0123456789000002;
+
+CREATE_CHRE_TEST_EVENT(SECOND_NANOAPP_STARTED, 0);
+
+//! What ran on the event loop thread, in order.
+enum class Step {
+  FirstNanoappStart,
+  DeferredCallback,
+  SecondNanoappStart,
+};
+
+std::vector<Step> gSteps;
+
+//! Whether a nanoapp colliding with a scheduled one was started.
+bool gCollidingNanoappStarted;
+
+bool firstNanoappStart() {
+  gSteps.push_back(Step::FirstNanoappStart);
+  return true;
+}
+
+bool secondNanoappStart() {
+  gSteps.push_back(Step::SecondNanoappStart);
+  TestEventQueueSingleton::get()->pushEvent(SECOND_NANOAPP_STARTED);
+  return true;
+}
+
+void recordDeferredCallback(uint16_t /* type */, void * /* data */,
+                            void * /* extraData */) {
+  gSteps.push_back(Step::DeferredCallback);
+}
+
+//! Schedules both nanoapps as static nanoapps are at init, then posts an event
+//! that must be delivered before the second nanoapp starts.
+void scheduleNanoappStarts(uint16_t /* type */, void * /* data */,
+                           void * /* extraData */) {
+  EventLoop &eventLoop = EventLoopManagerSingleton::get()->getEventLoop();
+  UniquePtr<Nanoapp> first = createStaticNanoapp(
+      "First", kFirstAppId, /* appVersion= */ 0,
+      NanoappPermissions::CHRE_PERMS_NONE, firstNanoappStart,
+      defaultNanoappHandleEvent, defaultNanoappEnd);
+  UniquePtr<Nanoapp> second = createStaticNanoapp(
+      "Second", kSecondAppId, /* appVersion= */ 0,
+      NanoappPermissions::CHRE_PERMS_NONE, secondNanoappStart,
+      defaultNanoappHandleEvent, defaultNanoappEnd);
+  EXPECT_TRUE(eventLoop.scheduleNanoappStart(first));
+  EXPECT_TRUE(eventLoop.scheduleNanoappStart(second));
+
+  EventLoopManagerSingleton::get()->deferCallback(
+      SystemCallbackType::FirstCallbackType, /* data= */ nullptr,
+      recordDeferredCallback);
+
+  // A nanoapp loaded by the host with the ID of a scheduled one is rejected
+  UniquePtr<Nanoapp> colliding = createStaticNanoapp(
+      "Colliding", kSecondAppId, /* appVersion= */ 0,
+      NanoappPermissions::CHRE_PERMS_NONE, defaultNanoappStart,
+      defaultNanoappHandleEvent, defaultNanoappEnd);
+  gCollidingNanoappStarted = eventLoop.startNanoapp(colliding);
+}
+
+class NanoappStartTest : public TestBase {
+ protected:
+  void SetUp() override {
+    TestBase::SetUp();
+    gSteps.clear();
+    gCollidingNanoappStarted = false;
+  }
+};
+
+TEST_F(NanoappStartTest, InterleavesScheduledStartsWithPendingEvents) {
+  EventLoopManagerSingleton::get()->deferCallback(
+      SystemCallbackType::FirstCallbackType, /* data= */ nullptr,
+      scheduleNanoappStarts);
+  waitForEvent(SECOND_NANOAPP_STARTED);
+
+  EXPECT_FALSE(gCollidingNanoappStarted);
+  const std::vector<Step> expectedSteps = {
+      Step::FirstNanoappStart,
+      Step::DeferredCallback,
+      Step::SecondNanoappStart,
+  };
+  EXPECT_EQ(gSteps, expectedSteps);
+
+  // Both scheduled nanoapps are found once started
+  EXPECT_NE(getNanoappByAppId(kFirstAppId), nullptr);
+  EXPECT_NE(getNanoappByAppId(kSecondAppId), nullptr);
+}
+
+}  // namespace
+}  // namespace chre
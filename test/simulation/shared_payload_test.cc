@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+
+#include "chre/core/event_loop_manager.h"
+#include "chre/platform/memory_manager.h"
+#include "chre/util/nanoapp/callbacks.h"
+#include "chre/util/nanoapp/shared_payload.h"
+#include "chre_api/chre/event.h"
+#include "chre_api/chre/re.h"
+
+#include "gtest/gtest.h"
+#include "inc/test_util.h"
+#include "test_base.h"
+#include "test_event.h"
+#include "test_event_queue.h"
+#include "test_util.h"
+
+namespace chre {
+namespace {
+
+constexpr uint16_t kSharedPayloadEventType = CHRE_EVENT_FIRST_USER_VALUE;
+constexpr uint64_t kSenderAppId = 1;
+constexpr uint64_t kReceiverAppId = 2;
+constexpr uint32_t kPayloadValue = 0xcafe;
+
+TEST_F(TestBase, SharedPayloadOutlivesEventInReceiver) {
+  CREATE_CHRE_TEST_EVENT(SEND, 0);
+  CREATE_CHRE_TEST_EVENT(RECEIVED, 1);
+  CREATE_CHRE_TEST_EVENT(RELEASE, 2);
+  CREATE_CHRE_TEST_EVENT(RELEASED, 3);
+
+  class SenderApp : public TestNanoapp {
+   public:
+    SenderApp() : TestNanoapp(TestNanoappInfo{.id = kSenderAppId}) {}
+
+    void handleEvent(uint32_t, uint16_t eventType,
+                     const void *eventData) override {
+      if (eventType == CHRE_EVENT_TEST_EVENT) {
+        auto event = static_cast<const TestEvent *>(eventData);
+        if (event->type == SEND) {
+          auto receiverInstanceId = static_cast<const uint16_t *>(event->data);
+          auto payload = static_cast<uint32_t *>(
+              chreSharedPayloadAlloc(sizeof(uint32_t)));
+          ASSERT_NE(payload, nullptr);
+          *payload = kPayloadValue;
+          chreSendEvent(kSharedPayloadEventType, payload,
+                        sharedPayloadFreeEventCallback, *receiverInstanceId);
+        }
+      }
+    }
+  };
+
+  class ReceiverApp : public TestNanoapp {
+   public:
+    ReceiverApp() : TestNanoapp(TestNanoappInfo{.id = kReceiverAppId}) {}
+
+    void handleEvent(uint32_t, uint16_t eventType,
+                     const void *eventData) override {
+      switch (eventType) {
+        case kSharedPayloadEventType: {
+          chreSharedPayloadRetain(eventData);
+          mPayload = static_cast<const uint32_t *>(eventData);
+          TestEventQueueSingleton::get()->pushEvent(RECEIVED);
+          break;
+        }
+        case CHRE_EVENT_TEST_EVENT: {
+          auto event = static_cast<const TestEvent *>(eventData);
+          if (event->type == RELEASE) {
+            // The payload is still valid after the sender dropped its
+            // reference
+            uint32_t value = *mPayload;
+            chreSharedPayloadRelease(mPayload);
+            mPayload = nullptr;
+            TestEventQueueSingleton::get()->pushEvent(RELEASED, value);
+          }
+          break;
+        }
+      }
+    }
+
+   private:
+    const uint32_t *mPayload = nullptr;
+  };
+
+  uint64_t senderAppId = loadNanoapp(MakeUnique<SenderApp>());
+  uint64_t receiverAppId = loadNanoapp(MakeUnique<ReceiverApp>());
+  Nanoapp *sender = getNanoappByAppId(senderAppId);
+  Nanoapp *receiver = getNanoappByAppId(receiverAppId);
+  ASSERT_NE(sender, nullptr);
+  ASSERT_NE(receiver, nullptr);
+
+  MemoryManager &memManager =
+      EventLoopManagerSingleton::get()->getMemoryManager();
+
+  sendEventToNanoapp(senderAppId, SEND, receiver->getInstanceId());
+  waitForEvent(RECEIVED);
+  EXPECT_EQ(receiver->getNumSharedPayloadRefs(), 1);
+
+  // The payload is accounted to the heap of the nanoapp which allocated it
+  EXPECT_EQ(memManager.getTotalAllocatedBytes(), sizeof(uint32_t));
+  EXPECT_EQ(sender->getTotalAllocatedBytes(), sizeof(uint32_t));
+  EXPECT_EQ(receiver->getTotalAllocatedBytes(), 0);
+
+  // The event was freed before the next event is delivered to the receiver
+  uint32_t value;
+  sendEventToNanoapp(receiverAppId, RELEASE);
+  waitForEvent(RELEASED, &value);
+  EXPECT_EQ(value, kPayloadValue);
+  EXPECT_EQ(sender->getNumSharedPayloadRefs(), 0);
+  EXPECT_EQ(receiver->getNumSharedPayloadRefs(), 0);
+  EXPECT_EQ(memManager.getTotalAllocatedBytes(), 0);
+  EXPECT_EQ(sender->getTotalAllocatedBytes(), 0);
+}
+
+TEST_F(TestBase, SharedPayloadReferencesAreReleasedAtUnload) {
+  CREATE_CHRE_TEST_EVENT(SEND, 0);
+  CREATE_CHRE_TEST_EVENT(RECEIVED, 1);
+
+  class SenderApp : public TestNanoapp {
+   public:
+    SenderApp() : TestNanoapp(TestNanoappInfo{.id = kSenderAppId}) {}
+
+    void handleEvent(uint32_t, uint16_t eventType,
+                     const void *eventData) override {
+      if (eventType == CHRE_EVENT_TEST_EVENT) {
+        auto event = static_cast<const TestEvent *>(eventData);
+        if (event->type == SEND) {
+          auto receiverInstanceId = static_cast<const uint16_t *>(event->data);
+          void *payload = chreSharedPayloadAlloc(sizeof(uint32_t));
+          ASSERT_NE(payload, nullptr);
+          chreSendEvent(kSharedPayloadEventType, payload,
+                        sharedPayloadFreeEventCallback, *receiverInstanceId);
+        }
+      }
+    }
+  };
+
+  class ReceiverApp : public TestNanoapp {
+   public:
+    ReceiverApp() : TestNanoapp(TestNanoappInfo{.id = kReceiverAppId}) {}
+
+    void handleEvent(uint32_t, uint16_t eventType,
+                     const void *eventData) override {
+      if (eventType == kSharedPayloadEventType) {
+        // The receiver never releases its reference
+        chreSharedPayloadRetain(eventData);
+        TestEventQueueSingleton::get()->pushEvent(RECEIVED);
+      }
+    }
+  };
+
+  uint64_t senderAppId = loadNanoapp(MakeUnique<SenderApp>());
+  uint64_t receiverAppId = loadNanoapp(MakeUnique<ReceiverApp>());
+  Nanoapp *receiver = getNanoappByAppId(receiverAppId);
+  ASSERT_NE(receiver, nullptr);
+
+  MemoryManager &memManager =
+      EventLoopManagerSingleton::get()->getMemoryManager();
+
+  sendEventToNanoapp(senderAppId, SEND, receiver->getInstanceId());
+  waitForEvent(RECEIVED);
+  EXPECT_EQ(memManager.getTotalAllocatedBytes(), sizeof(uint32_t));
+
+  // The payload is freed once the last nanoapp holding it is unloaded
+  unloadNanoapp(receiverAppId);
+  EXPECT_EQ(memManager.getTotalAllocatedBytes(), 0);
+  EXPECT_EQ(memManager.getAllocationCount(), 0);
+}
+
+TEST_F(TestBase, SharedPayloadIgnoresInvalidPointers) {
+  CREATE_CHRE_TEST_EVENT(MISUSE, 0);
+
+  class App : public TestNanoapp {
+   public:
+    App() : TestNanoapp(TestNanoappInfo{.id = kSenderAppId}) {}
+
+    void handleEvent(uint32_t, uint16_t eventType,
+                     const void *eventData) override {
+      if (eventType == CHRE_EVENT_TEST_EVENT) {
+        auto event = static_cast<const TestEvent *>(eventData);
+        if (event->type == MISUSE) {
+          // Neither memory which isn't a shared payload nor a payload which
+          // was already freed may be read as the header of a payload
+          uint32_t notAPayload = 0;
+          chreSharedPayloadRetain(&notAPayload);
+          chreSharedPayloadRelease(&notAPayload);
+          void *heap = chreHeapAlloc(sizeof(uint32_t));
+          ASSERT_NE(heap, nullptr);
+          chreSharedPayloadRetain(heap);
+          chreHeapFree(heap);
+
+          void *payload = chreSharedPayloadAlloc(sizeof(uint32_t));
+          ASSERT_NE(payload, nullptr);
+          chreSharedPayloadRelease(payload);
+          chreSharedPayloadRetain(payload);
+          chreSharedPayloadRelease(payload);
+          TestEventQueueSingleton::get()->pushEvent(MISUSE);
+        }
+      }
+    }
+  };
+
+  uint64_t appId = loadNanoapp(MakeUnique<App>());
+  MemoryManager &memManager =
+      EventLoopManagerSingleton::get()->getMemoryManager();
+
+  sendEventToNanoapp(appId, MISUSE);
+  waitForEvent(MISUSE);
+  EXPECT_EQ(memManager.getTotalAllocatedBytes(), 0);
+  EXPECT_EQ(memManager.getAllocationCount(), 0);
+}
+
+}  // namespace
+}  // namespace chre
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef CHRE_STATIC_EVENT_DISPATCH
+
+#include <cstdint>
+
+#include "chre/core/event_loop_manager.h"
+#include "chre/core/nanoapp.h"
+#include "chre/platform/linux/pal_sensor.h"
+#include "chre_api/chre/event.h"
+#include "chre_api/chre/sensor.h"
+
+#include "gtest/gtest.h"
+#include "inc/test_util.h"
+#include "test_base.h"
+#include "test_event.h"
+#include "test_event_queue.h"
+#include "test_util.h"
+
+namespace chre {
+namespace {
+
+constexpr uint64_t kListenerAppId = 1;
+constexpr uint64_t kBystanderAppId = 2;
+constexpr uint64_t kStartedAppId = 3;
+constexpr uint64_t kSecondAppId = 4;
+
+Nanoapp *getCurrentNanoapp() {
+  return EventLoopManagerSingleton::get()->getEventLoop().getCurrentNanoapp();
+}
+
+EventLoop::BroadcastDispatchTable &getDispatchTable() {
+  return EventLoopManagerSingleton::get()
+      ->getEventLoop()
+      .getBroadcastDispatchTable();
+}
+
+TEST_F(TestBase, StaticDispatchDeliversBroadcastsToRegisteredNanoapps) {
+  CREATE_CHRE_TEST_EVENT(GET_NUM_STARTED, 0);
+
+  class App : public TestNanoapp {
+   public:
+    App(uint64_t appId, bool listen)
+        : TestNanoapp(TestNanoappInfo{.id = appId}), mListen(listen) {}
+
+    bool start() override {
+      chreConfigureNanoappInfoEvents(mListen);
+      return true;
+    }
+
+    void handleEvent(uint32_t, uint16_t eventType,
+                     const void *eventData) override {
+      switch (eventType) {
+        case CHRE_EVENT_NANOAPP_STARTED: {
+          auto info = static_cast<const chreNanoappInfo *>(eventData);
+          if (info->appId == kStartedAppId) {
+            mNumStarted++;
+          }
+          break;
+        }
+
+        case CHRE_EVENT_TEST_EVENT: {
+          auto event = static_cast<const TestEvent *>(eventData);
+          if (event->type == GET_NUM_STARTED) {
+            TestEventQueueSingleton::get()->pushEvent(GET_NUM_STARTED,
+                                                      mNumStarted);
+          }
+          break;
+        }
+      }
+    }
+
+   private:
+    const bool mListen;
+    uint32_t mNumStarted = 0;
+  };
+
+  uint64_t listenerAppId =
+      loadNanoapp(MakeUnique<App>(kListenerAppId, /*listen=*/true));
+  uint64_t bystanderAppId =
+      loadNanoapp(MakeUnique<App>(kBystanderAppId, /*listen=*/false));
+  loadNanoapp(MakeUnique<App>(kStartedAppId, /*listen=*/false));
+
+  uint32_t numStarted;
+  sendEventToNanoapp(listenerAppId, GET_NUM_STARTED);
+  waitForEvent(GET_NUM_STARTED, &numStarted);
+  EXPECT_EQ(numStarted, 1);
+  sendEventToNanoapp(bystanderAppId, GET_NUM_STARTED);
+  waitForEvent(GET_NUM_STARTED, &numStarted);
+  EXPECT_EQ(numStarted, 0);
+}
+
+TEST_F(TestBase, StaticDispatchRejectsRegistrationsWhenTheTableIsFull) {
+  CREATE_CHRE_TEST_EVENT(FILL_TABLE, 0);
+  CREATE_CHRE_TEST_EVENT(CONFIGURE, 1);
+  CREATE_CHRE_TEST_EVENT(UNREGISTER_ONE, 2);
+
+  class App : public TestNanoapp {
+   public:
+    explicit App(uint64_t appId) : TestNanoapp(TestNanoappInfo{.id = appId}) {}
+
+    void handleEvent(uint32_t, uint16_t eventType,
+                     const void *eventData) override {
+      if (eventType != CHRE_EVENT_TEST_EVENT) {
+        return;
+      }
+      auto event = static_cast<const TestEvent *>(eventData);
+      switch (event->type) {
+        case FILL_TABLE: {
+          // Registers for user event types until the table is full.
+          uint32_t numRegistered = 0;
+          while (getCurrentNanoapp()->registerForBroadcastEvent(
+              mNextEventType)) {
+            mNextEventType++;
+            numRegistered++;
+          }
+          TestEventQueueSingleton::get()->pushEvent(FILL_TABLE,
+                                                    numRegistered);
+          break;
+        }
+
+        case CONFIGURE: {
+          bool success = chreSensorConfigure(
+              0 /*sensorHandle*/, CHRE_SENSOR_CONFIGURE_MODE_CONTINUOUS,
+              CHRE_NSEC_PER_SEC, 0 /*latency*/);
+          TestEventQueueSingleton::get()->pushEvent(CONFIGURE, success);
+          break;
+        }
+
+        case UNREGISTER_ONE: {
+          mNextEventType--;
+          getCurrentNanoapp()->unregisterForBroadcastEvent(mNextEventType);
+          TestEventQueueSingleton::get()->pushEvent(UNREGISTER_ONE);
+          break;
+        }
+      }
+    }
+
+   private:
+    uint16_t mNextEventType = CHRE_EVENT_FIRST_USER_VALUE;
+  };
+
+  uint64_t appId = loadNanoapp(MakeUnique<App>(kListenerAppId));
+
+  uint32_t numRegistered;
+  sendEventToNanoapp(appId, FILL_TABLE);
+  waitForEvent(FILL_TABLE, &numRegistered);
+  EXPECT_GT(numRegistered, 0);
+  EXPECT_EQ(getDispatchTable().size(), CHRE_MAX_BROADCAST_REGISTRATIONS);
+
+  // The sensor request fails as its events can't be registered for, and the
+  // registrations made before it are kept.
+  bool success;
+  sendEventToNanoapp(appId, CONFIGURE);
+  waitForEvent(CONFIGURE, &success);
+  EXPECT_FALSE(success);
+  EXPECT_FALSE(chrePalSensorIsSensor0Enabled());
+  EXPECT_EQ(getDispatchTable().size(), CHRE_MAX_BROADCAST_REGISTRATIONS);
+
+  sendEventToNanoapp(appId, UNREGISTER_ONE);
+  waitForEvent(UNREGISTER_ONE);
+  sendEventToNanoapp(appId, CONFIGURE);
+  waitForEvent(CONFIGURE, &success);
+  EXPECT_TRUE(success);
+  EXPECT_TRUE(chrePalSensorIsSensor0Enabled());
+
+  // Unloading the nanoapp frees its registrations for other nanoapps.
+  unloadNanoapp(appId);
+  EXPECT_FALSE(chrePalSensorIsSensor0Enabled());
+  uint64_t secondAppId = loadNanoapp(MakeUnique<App>(kSecondAppId));
+  sendEventToNanoapp(secondAppId, FILL_TABLE);
+  waitForEvent(FILL_TABLE, &numRegistered);
+  EXPECT_GT(numRegistered, 0);
+  EXPECT_EQ(getDispatchTable().size(), CHRE_MAX_BROADCAST_REGISTRATIONS);
+}
+
+}  // namespace
+}  // namespace chre
+
+#endif  // CHRE_STATIC_EVENT_DISPATCH
@@ -22,6 +22,9 @@
 #include "chre/core/init.h"
 #include "chre/platform/linux/platform_log.h"
 #include "chre/platform/linux/task_util/task_manager.h"
+#ifdef CHRE_TRACE_BUFFER_ENABLED
+#include "chre/platform/shared/trace_buffer.h"
+#endif  // CHRE_TRACE_BUFFER_ENABLED
 #include "chre/util/time.h"
 #include "chre_api/chre/version.h"
 #include "inc/test_util.h"
@@ -47,6 +50,9 @@ void TestBase::SetUp() {
   // TODO(b/346903946): remove these extra prints once init failure is resolved
   printf("SetUp(): log\n");
   chre::PlatformLogSingleton::init();
+#ifdef CHRE_TRACE_BUFFER_ENABLED
+  TraceBufferSingleton::init();
+#endif  // CHRE_TRACE_BUFFER_ENABLED
   printf("SetUp(): TaskManager\n");
   TaskManagerSingleton::init();
   printf("SetUp(): TestEventQueue\n");
@@ -82,6 +88,9 @@ void TestBase::TearDown() {
   TaskManagerSingleton::deinit();
   deleteNanoappInfos();
   unregisterAllTestNanoapps();
+#ifdef CHRE_TRACE_BUFFER_ENABLED
+  TraceBufferSingleton::deinit();
+#endif  // CHRE_TRACE_BUFFER_ENABLED
   chre::PlatformLogSingleton::deinit();
 }
 
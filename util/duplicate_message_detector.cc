@@ -19,6 +19,7 @@
 #include "chre/platform/system_time.h"
 
 #include <cstdint>
+#include <utility>
 
 namespace chre {
 
@@ -59,10 +60,12 @@ bool DuplicateMessageDetector::findAndSetError(uint32_t messageSequenceNumber,
 
 void DuplicateMessageDetector::removeOldEntries() {
   Nanoseconds now = SystemTime::getMonotonicTime();
-  while (!mReliableMessageRecordQueue.empty()) {
-    ReliableMessageRecord &record = mReliableMessageRecordQueue.top();
+  while (mCount > 0) {
+    ReliableMessageRecord &record = mRecords[mHead];
     if (record.timestamp + kTimeout <= now) {
-      mReliableMessageRecordQueue.pop();
+      removeFromIndex(mHead);
+      mHead = (mHead + 1) % mRecords.size();
+      --mCount;
     } else {
       break;
     }
@@ -73,24 +76,32 @@ DuplicateMessageDetector::ReliableMessageRecord*
     DuplicateMessageDetector::addLocked(
         uint32_t messageSequenceNumber,
         uint16_t hostEndpoint) {
-  bool success = mReliableMessageRecordQueue.push(
-      ReliableMessageRecord{
-          .timestamp = SystemTime::getMonotonicTime(),
-          .messageSequenceNumber = messageSequenceNumber,
-          .hostEndpoint = hostEndpoint,
-          .error = Optional<chreError>()});
-  return success
-      ? findLocked(messageSequenceNumber, hostEndpoint, /* reverse= */ true)
-      : nullptr;
+  if (mCount == mRecords.size() && !grow()) {
+    return nullptr;
+  }
+
+  size_t position = (mHead + mCount) % mRecords.size();
+  mRecords[position] = ReliableMessageRecord{
+      .timestamp = SystemTime::getMonotonicTime(),
+      .messageSequenceNumber = messageSequenceNumber,
+      .hostEndpoint = hostEndpoint,
+      .error = Optional<chreError>()};
+  ++mCount;
+  addToIndex(position);
+  return &mRecords[position];
 }
 
 DuplicateMessageDetector::ReliableMessageRecord*
   DuplicateMessageDetector::findLocked(uint32_t messageSequenceNumber,
-                                       uint16_t hostEndpoint,
-                                       bool reverse) {
-  for (size_t i = 0; i < mReliableMessageRecordQueue.size(); ++i) {
-    size_t index = reverse ? mReliableMessageRecordQueue.size() - i - 1 : i;
-    ReliableMessageRecord &record = mReliableMessageRecordQueue[index];
+                                       uint16_t hostEndpoint) {
+  if (mCount == 0) {
+    return nullptr;
+  }
+
+  size_t mask = mIndex.size() - 1;
+  for (size_t slot = getHomeSlot(messageSequenceNumber, hostEndpoint);
+       mIndex[slot] != kEmptySlot; slot = (slot + 1) & mask) {
+    ReliableMessageRecord &record = mRecords[mIndex[slot] - 1];
     if (record.messageSequenceNumber == messageSequenceNumber &&
         record.hostEndpoint == hostEndpoint) {
       return &record;
@@ -99,4 +110,75 @@ DuplicateMessageDetector::ReliableMessageRecord*
   return nullptr;
 }
 
+bool DuplicateMessageDetector::grow() {
+  size_t newCapacity =
+      mRecords.empty() ? kInitialCapacity : mRecords.size() * 2;
+  DynamicVector<ReliableMessageRecord> newRecords;
+  DynamicVector<uint32_t> newIndex;
+  if (!newRecords.reserve(newCapacity) || !newIndex.resize(newCapacity * 2)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < mCount; ++i) {
+    newRecords.push_back(mRecords[(mHead + i) % mRecords.size()]);
+  }
+  newRecords.resize(newCapacity);
+  mRecords = std::move(newRecords);
+  mIndex = std::move(newIndex);
+  mHead = 0;
+
+  for (size_t i = 0; i < mCount; ++i) {
+    addToIndex(i);
+  }
+  return true;
+}
+
+size_t DuplicateMessageDetector::getHomeSlot(uint32_t messageSequenceNumber,
+                                             uint16_t hostEndpoint) const {
+  // Sequence numbers are mostly consecutive, so mix in the endpoint and fold
+  // the high bits down to spread nearby keys from different endpoints
+  uint32_t hash = messageSequenceNumber ^
+                  (static_cast<uint32_t>(hostEndpoint) * 0x9E3779B1u);
+  hash ^= hash >> 16;
+  return hash & (mIndex.size() - 1);
+}
+
+void DuplicateMessageDetector::addToIndex(size_t position) {
+  const ReliableMessageRecord &record = mRecords[position];
+  size_t mask = mIndex.size() - 1;
+  size_t slot = getHomeSlot(record.messageSequenceNumber, record.hostEndpoint);
+  while (mIndex[slot] != kEmptySlot) {
+    slot = (slot + 1) & mask;
+  }
+  mIndex[slot] = static_cast<uint32_t>(position + 1);
+}
+
+void DuplicateMessageDetector::removeFromIndex(size_t position) {
+  const ReliableMessageRecord &record = mRecords[position];
+  size_t mask = mIndex.size() - 1;
+  size_t hole =
+      getHomeSlot(record.messageSequenceNumber, record.hostEndpoint);
+  while (mIndex[hole] != position + 1) {
+    if (mIndex[hole] == kEmptySlot) {
+      return;
+    }
+    hole = (hole + 1) & mask;
+  }
+
+  // Shift back any later entries in the probe sequence that would no longer
+  // be reachable from their home slot once this one is emptied
+  for (size_t slot = (hole + 1) & mask; mIndex[slot] != kEmptySlot;
+       slot = (slot + 1) & mask) {
+    const ReliableMessageRecord &other = mRecords[mIndex[slot] - 1];
+    size_t home = getHomeSlot(other.messageSequenceNumber, other.hostEndpoint);
+    bool homeInRange = (hole <= slot) ? (hole < home && home <= slot)
+                                      : (hole < home || home <= slot);
+    if (!homeInRange) {
+      mIndex[hole] = mIndex[slot];
+      hole = slot;
+    }
+  }
+  mIndex[hole] = kEmptySlot;
+}
+
 }  // namespace chre
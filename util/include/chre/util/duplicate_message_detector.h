@@ -17,13 +17,14 @@
 #ifndef CHRE_UTIL_DUPLICATE_MESSAGE_DETECTOR_H_
 #define CHRE_UTIL_DUPLICATE_MESSAGE_DETECTOR_H_
 
+#include "chre/util/dynamic_vector.h"
 #include "chre/util/non_copyable.h"
 #include "chre/util/optional.h"
-#include "chre/util/priority_queue.h"
 #include "chre/util/time.h"
 #include "chre_api/chre.h"
 
-#include <functional>
+#include <cstddef>
+#include <cstdint>
 
 namespace chre {
 
@@ -45,6 +46,11 @@ namespace chre {
  *
  * Call removeOldEntries() to remove any messages that have been in the detector
  * for longer than the timeout specified in the constructor.
+ *
+ * Records are kept in a ring buffer in the order they were added, which is
+ * also time order, alongside an open addressing hash index keyed on the
+ * message sequence number and host endpoint. This makes lookup, insertion and
+ * expiry O(1) amortized.
  */
 class DuplicateMessageDetector : public NonCopyable {
  public:
@@ -53,10 +59,6 @@ class DuplicateMessageDetector : public NonCopyable {
     uint32_t messageSequenceNumber;
     uint16_t hostEndpoint;
     Optional<chreError> error;
-
-    inline bool operator>(const ReliableMessageRecord &rhs) const {
-      return timestamp > rhs.timestamp;
-    }
   };
 
   DuplicateMessageDetector() = delete;
@@ -85,13 +87,31 @@ class DuplicateMessageDetector : public NonCopyable {
   void removeOldEntries();
 
  private:
+  //! The number of records allocated when the first message is added. The
+  //! capacity doubles each time it's exceeded.
+  static constexpr size_t kInitialCapacity = 8;
+
+  //! The value of an empty slot in mIndex.
+  static constexpr uint32_t kEmptySlot = 0;
+
   //! The timeout specified in the constructor. This should be the reliable
   //! message timeout.
   Nanoseconds kTimeout;
 
-  //! The queue of reliable message records.
-  PriorityQueue<ReliableMessageRecord, std::greater<ReliableMessageRecord>>
-      mReliableMessageRecordQueue;
+  //! Ring buffer of reliable message records, oldest first, starting at
+  //! mHead. Its size is the capacity of the ring buffer.
+  DynamicVector<ReliableMessageRecord> mRecords;
+
+  //! The position of the oldest record in mRecords.
+  size_t mHead = 0;
+
+  //! The number of records in mRecords.
+  size_t mCount = 0;
+
+  //! Open addressing hash index of the records in mRecords. Each slot holds
+  //! the position of a record plus one, or kEmptySlot. Twice the size of
+  //! mRecords (a power of two) to keep probe sequences short.
+  DynamicVector<uint32_t> mIndex;
 
   //! Adds a new message to the detector. Returns the message record, or nullptr
   //! if the message could not be added. Not thread safe.
@@ -99,11 +119,23 @@ class DuplicateMessageDetector : public NonCopyable {
                                    uint16_t hostEndpoint);
 
   //! Finds the message with the given message sequence number and host
-  //! endpoint, else returns nullptr. Not thread safe. If reverse is true,
-  //! this function searches from the end of the queue.
+  //! endpoint, else returns nullptr. Not thread safe.
   ReliableMessageRecord *findLocked(uint32_t messageSequenceNumber,
-                                    uint16_t hostEndpoint,
-                                    bool reverse = false);
+                                    uint16_t hostEndpoint);
+
+  //! Doubles the capacity of mRecords and rebuilds mIndex. Returns false if
+  //! memory could not be allocated, in which case nothing is changed.
+  bool grow();
+
+  //! @return the slot in mIndex at which to start probing for the given key.
+  size_t getHomeSlot(uint32_t messageSequenceNumber,
+                     uint16_t hostEndpoint) const;
+
+  //! Adds the record at the given position in mRecords to mIndex.
+  void addToIndex(size_t position);
+
+  //! Removes the record at the given position in mRecords from mIndex.
+  void removeFromIndex(size_t position);
 };
 
 }  // namespace chre
@@ -18,6 +18,7 @@
 #define CHRE_UTIL_CALLBACKS_H_
 
 #include <cstddef>
+#include <cstdint>
 
 namespace chre {
 
@@ -31,6 +32,16 @@ namespace chre {
  */
 void heapFreeMessageCallback(void *message, size_t messageSize);
 
+/**
+ * Implementation of a chreEventCompleteFunction that releases the reference of
+ * the sender to a payload allocated with chreSharedPayloadAlloc(), handing it
+ * over to the event. Receivers of the event may take their own reference with
+ * chreSharedPayloadRetain().
+ *
+ * @see chreEventCompleteFunction
+ */
+void sharedPayloadFreeEventCallback(uint16_t eventType, void *eventData);
+
 }  // namespace chre
 
 #endif  // CHRE_UTIL_CALLBACKS_H_
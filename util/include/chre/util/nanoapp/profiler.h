@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_UTIL_NANOAPP_PROFILER_H_
+#define CHRE_UTIL_NANOAPP_PROFILER_H_
+
+/**
+ * @file
+ * Profiles named scopes of a nanoapp, keeping a histogram of their durations
+ * which is logged in debug dumps. For example:
+ *
+ *   CHRE_PROFILE_HISTOGRAM(gPushProfile, "AdvReportCache::Push");
+ *
+ *   void AdvReportCache::Push(...) {
+ *     CHRE_PROFILE_SCOPE(gPushProfile);
+ *     ...
+ *   }
+ *
+ *   // When handling CHRE_EVENT_DEBUG_DUMP
+ *   CHRE_PROFILE_DUMP(gPushProfile);
+ *
+ * The macros compile to nothing unless CHRE_NANOAPP_PROFILING_ENABLED is
+ * defined, so profiling has no cost when compiled out.
+ *
+ * Durations are measured with chreGetTime() in nanoseconds by default. A
+ * nanoapp may count cycles instead by defining CHRE_PROFILE_GET_TICKS() to
+ * read the cycle counter of its platform, and CHRE_PROFILE_TICKS_UNIT to
+ * "cycles".
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chre/util/macros.h"
+#include "chre/util/non_copyable.h"
+#include "chre_api/chre.h"
+
+#ifndef CHRE_PROFILE_GET_TICKS
+#define CHRE_PROFILE_GET_TICKS() chreGetTime()
+#endif
+
+#ifndef CHRE_PROFILE_TICKS_UNIT
+#define CHRE_PROFILE_TICKS_UNIT "ns"
+#endif
+
+#ifdef CHRE_NANOAPP_PROFILING_ENABLED
+
+//! Defines a histogram named var profiling the scope with the given name,
+//! which must be a string literal.
+#define CHRE_PROFILE_HISTOGRAM(var, name) ::chre::ProfileHistogram var(name)
+
+//! Adds the duration of the enclosing scope to a histogram.
+#define CHRE_PROFILE_SCOPE(histogram)                                   \
+  ::chre::ProfileScopeTimer MACRO_CONCAT(chreProfileScopeTimer, __LINE__)( \
+      histogram)
+
+//! Logs a histogram to the debug dump.
+#define CHRE_PROFILE_DUMP(histogram) (histogram).dump()
+
+//! Resets a histogram.
+#define CHRE_PROFILE_RESET(histogram) (histogram).reset()
+
+#else
+
+// Expands to a declaration, so that the semicolon following it at namespace
+// scope isn't an empty declaration.
+#define CHRE_PROFILE_HISTOGRAM(var, name) static_assert(true, "")
+#define CHRE_PROFILE_SCOPE(histogram)
+#define CHRE_PROFILE_DUMP(histogram)
+#define CHRE_PROFILE_RESET(histogram)
+
+#endif  // CHRE_NANOAPP_PROFILING_ENABLED
+
+namespace chre {
+
+/**
+ * The durations of a profiled scope, counted in buckets of exponentially
+ * increasing size so that a fixed amount of memory covers durations from a few
+ * ticks to seconds.
+ *
+ * Bucket 0 counts durations of 0 ticks, and bucket i > 0 counts durations in
+ * [2^(i-1), 2^i) ticks. The last bucket also counts all longer durations.
+ */
+class ProfileHistogram : public NonCopyable {
+ public:
+  static constexpr size_t kNumBuckets = 32;
+
+  /**
+   * @param name the name of the profiled scope, which must outlive the
+   *        histogram
+   */
+  explicit ProfileHistogram(const char *name) : mName(name) {
+    reset();
+  }
+
+  /**
+   * Adds the duration of an execution of the scope.
+   */
+  void addSample(uint64_t ticks);
+
+  /**
+   * Logs the statistics and non-empty buckets of the histogram with
+   * chreDebugDumpLog(), which must be called while handling
+   * CHRE_EVENT_DEBUG_DUMP.
+   */
+  void dump() const;
+
+  /**
+   * Clears the samples added so far.
+   */
+  void reset();
+
+  /**
+   * @return the index of the bucket counting the given duration
+   */
+  static size_t getBucketIndex(uint64_t ticks);
+
+  const char *getName() const {
+    return mName;
+  }
+
+  uint32_t getCount() const {
+    return mCount;
+  }
+
+  uint64_t getTotalTicks() const {
+    return mTotalTicks;
+  }
+
+  //! The minimum duration, or UINT64_MAX if there are no samples.
+  uint64_t getMinTicks() const {
+    return mMinTicks;
+  }
+
+  uint64_t getMaxTicks() const {
+    return mMaxTicks;
+  }
+
+  uint32_t getBucketCount(size_t index) const {
+    return (index < kNumBuckets) ? mBuckets[index] : 0;
+  }
+
+ private:
+  const char *mName;
+  uint32_t mCount;
+  uint64_t mTotalTicks;
+  uint64_t mMinTicks;
+  uint64_t mMaxTicks;
+  uint32_t mBuckets[kNumBuckets];
+};
+
+/**
+ * Adds its lifespan to a ProfileHistogram. Used by CHRE_PROFILE_SCOPE.
+ */
+class ProfileScopeTimer : public NonCopyable {
+ public:
+  explicit ProfileScopeTimer(ProfileHistogram &histogram)
+      : mHistogram(histogram), mStartTicks(CHRE_PROFILE_GET_TICKS()) {}
+
+  ~ProfileScopeTimer() {
+    mHistogram.addSample(CHRE_PROFILE_GET_TICKS() - mStartTicks);
+  }
+
+ private:
+  ProfileHistogram &mHistogram;
+  uint64_t mStartTicks;
+};
+
+}  // namespace chre
+
+#endif  // CHRE_UTIL_NANOAPP_PROFILER_H_
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHRE_UTIL_NANOAPP_SHARED_PAYLOAD_H_
+#define CHRE_UTIL_NANOAPP_SHARED_PAYLOAD_H_
+
+/**
+ * @file
+ * Reference-counted payloads which nanoapps can share, e.g. as the data of
+ * events sent to several nanoapps.
+ *
+ * These functions are an extension provided by this CHRE implementation, and
+ * aren't part of the CHRE API: an implementation of any API version may lack
+ * them, in which case chreSharedPayloadAlloc() returns NULL. Nanoapps using
+ * them must handle that case, e.g. by copying their payloads instead.
+ */
+
+#include <stdint.h>
+
+#include <chre/toolchain.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Allocate a read-only payload which can be shared by several nanoapps, e.g. as
+ * the data of an event sent with chreSendEvent() or read by nanoapps other
+ * than the one that allocated it.
+ *
+ * Unlike memory from chreHeapAlloc(), a shared payload is reference counted
+ * and freed by the CHRE once its last reference is released, regardless of
+ * which nanoapp holds it. The payload counts towards the heap usage of the
+ * nanoapp allocating it, which holds its first reference. A nanoapp which
+ * receives the payload and wants to read it after returning from
+ * nanoappHandleEvent() takes its own reference with chreSharedPayloadRetain()
+ * instead of copying the payload. The references a nanoapp still holds when
+ * it's unloaded are released on its behalf.
+ *
+ * The payload must not be modified once it's shared. To hand the reference of
+ * the sender over to an event, a nanoapp releases it from the
+ * chreEventCompleteFunction given to chreSendEvent().
+ *
+ * @param bytes  The number of bytes requested.
+ * @return  A pointer to 'bytes' contiguous bytes aligned to 8 bytes, or NULL
+ *     if the allocation could not be performed or the CHRE doesn't support
+ *     shared payloads.
+ *
+ * @see chreSharedPayloadRetain
+ * @see chreSharedPayloadRelease
+ */
+CHRE_MALLOC_ATTR
+void *chreSharedPayloadAlloc(uint32_t bytes);
+
+/**
+ * Takes a reference to a shared payload, so that it stays valid until the
+ * reference is released with chreSharedPayloadRelease().
+ *
+ * @param payload  A pointer returned by chreSharedPayloadAlloc() whose
+ *     payload has at least one reference, e.g. the data of an event received
+ *     from a nanoapp which sends shared payloads.
+ *
+ * @see chreSharedPayloadAlloc
+ */
+void chreSharedPayloadRetain(const void *payload);
+
+/**
+ * Releases a reference to a shared payload which the calling nanoapp took with
+ * chreSharedPayloadAlloc() or chreSharedPayloadRetain(), freeing the payload
+ * if it was the last one.
+ *
+ * @param payload  A pointer returned by chreSharedPayloadAlloc(). NULL is
+ *     ignored.
+ *
+ * @see chreSharedPayloadAlloc
+ */
+void chreSharedPayloadRelease(const void *payload);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // CHRE_UTIL_NANOAPP_SHARED_PAYLOAD_H_
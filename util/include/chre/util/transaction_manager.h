@@ -37,6 +37,17 @@ class TransactionManagerCallback {
   //! Invoked when a transaction fails to complete after the max attempt limit
   virtual void onTransactionFailure(uint32_t transactionId,
                                     uint16_t groupId) = 0;
+
+  //! Returns how long to wait after the given attempt (starting at 1) before
+  //! retrying or failing the transaction. Invoked right after
+  //! onTransactionAttempt(). The default uses the fixed timeout supplied to the
+  //! TransactionManager, which is passed in as defaultTimeout.
+  virtual Nanoseconds getTransactionTimeout(uint32_t /*transactionId*/,
+                                            uint16_t /*groupId*/,
+                                            uint8_t /*attemptCount*/,
+                                            Nanoseconds defaultTimeout) {
+    return defaultTimeout;
+  }
 };
 
 /**
@@ -76,7 +87,8 @@ class TransactionManager : public NonCopyable {
    * @param cb Callback
    * @param timerPool TimerPool-like object to use for retry timers
    * @param timeout How long to wait for remove() to be called after
-   *        onTransactionAttempt() before trying again or failing
+   *        onTransactionAttempt() before trying again or failing, unless
+   *        overridden by TransactionManagerCallback::getTransactionTimeout()
    * @param maxAttempts Maximum number of times to try the transaction before
    *        giving up
    */
@@ -206,6 +218,10 @@ class TransactionManager : public NonCopyable {
   //! set the timer
   void startTransaction(Transaction &transaction);
 
+  //! Invoke the attempt callback for a transaction whose attemptCount was
+  //! already updated, and set its timeout relative to now
+  void attemptTransaction(Transaction &transaction, Nanoseconds now);
+
   //! Updates the timer to the proper state for mTransactions
   void updateTimer();
 
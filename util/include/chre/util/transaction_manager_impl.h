@@ -131,11 +131,17 @@ void TransactionManager<kMaxTransactions, TimerPoolType>::startTransaction(
     Transaction &transaction) {
   CHRE_ASSERT(transaction.attemptCount == 0);
   transaction.attemptCount = 1;
-  transaction.timeout = SystemTime::getMonotonicTime() + kTimeout;
-  {
-    ScopedFlag f(mInCallback);
-    mCb.onTransactionAttempt(transaction.id, transaction.groupId);
-  }
+  attemptTransaction(transaction, SystemTime::getMonotonicTime());
+}
+
+template <size_t kMaxTransactions, class TimerPoolType>
+void TransactionManager<kMaxTransactions, TimerPoolType>::attemptTransaction(
+    Transaction &transaction, Nanoseconds now) {
+  ScopedFlag f(mInCallback);
+  mCb.onTransactionAttempt(transaction.id, transaction.groupId);
+  transaction.timeout =
+      now + mCb.getTransactionTimeout(transaction.id, transaction.groupId,
+                                      transaction.attemptCount, kTimeout);
 }
 
 template <size_t kMaxTransactions, class TimerPoolType>
@@ -200,11 +206,7 @@ void TransactionManager<kMaxTransactions, TimerPoolType>::handleTimerExpiry() {
         // will appear after this one, so we don't need to restart the loop
         continue;
       } else {
-        transaction.timeout = now + kTimeout;
-        {
-          ScopedFlag f(mInCallback);
-          mCb.onTransactionAttempt(transaction.id, transaction.groupId);
-        }
+        attemptTransaction(transaction, now);
       }
     }
     if (transaction.timeout < nextTimeout) {
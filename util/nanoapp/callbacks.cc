@@ -17,6 +17,7 @@
 #include "chre/util/nanoapp/callbacks.h"
 
 #include "chre/util/container_support.h"
+#include "chre/util/nanoapp/shared_payload.h"
 
 namespace chre {
 
@@ -26,4 +27,9 @@ void heapFreeMessageCallback(void *message, size_t /* messageSize */) {
   memoryFree(message);
 }
 
+void sharedPayloadFreeEventCallback(uint16_t /* eventType */,
+                                    void *eventData) {
+  chreSharedPayloadRelease(eventData);
+}
+
 }  // namespace chre
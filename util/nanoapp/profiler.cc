@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chre/util/nanoapp/profiler.h"
+
+#include <cinttypes>
+#include <cstring>
+
+namespace chre {
+
+void ProfileHistogram::addSample(uint64_t ticks) {
+  mCount++;
+  mTotalTicks += ticks;
+  mMinTicks = MIN(mMinTicks, ticks);
+  mMaxTicks = MAX(mMaxTicks, ticks);
+  mBuckets[getBucketIndex(ticks)]++;
+}
+
+void ProfileHistogram::dump() const {
+  if (mCount == 0) {
+    chreDebugDumpLog("  %s: no samples\n", mName);
+    return;
+  }
+
+  chreDebugDumpLog("  %s: count %" PRIu32 " min %" PRIu64 " avg %" PRIu64
+                   " max %" PRIu64 " " CHRE_PROFILE_TICKS_UNIT "\n",
+                   mName, mCount, mMinTicks, mTotalTicks / mCount, mMaxTicks);
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    if (mBuckets[i] == 0) {
+      continue;
+    }
+    if (i == 0) {
+      chreDebugDumpLog("    0: %" PRIu32 "\n", mBuckets[i]);
+    } else if (i == kNumBuckets - 1) {
+      chreDebugDumpLog("    >= %" PRIu64 ": %" PRIu32 "\n",
+                       UINT64_C(1) << (i - 1), mBuckets[i]);
+    } else {
+      chreDebugDumpLog("    [%" PRIu64 ", %" PRIu64 "): %" PRIu32 "\n",
+                       UINT64_C(1) << (i - 1), UINT64_C(1) << i, mBuckets[i]);
+    }
+  }
+}
+
+void ProfileHistogram::reset() {
+  mCount = 0;
+  mTotalTicks = 0;
+  mMinTicks = UINT64_MAX;
+  mMaxTicks = 0;
+  memset(mBuckets, 0, sizeof(mBuckets));
+}
+
+size_t ProfileHistogram::getBucketIndex(uint64_t ticks) {
+  if (ticks == 0) {
+    return 0;
+  }
+
+  // The index is the number of significant bits of the duration
+  size_t index = 64 - static_cast<size_t>(__builtin_clzll(ticks));
+  return MIN(index, kNumBuckets - 1);
+}
+
+}  // namespace chre
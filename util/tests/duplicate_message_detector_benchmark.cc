@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+#include "chre/platform/linux/system_time.h"
+#include "chre/util/duplicate_message_detector.h"
+#include "chre_api/chre.h"
+
+/**
+ * @file
+ * A benchmark of the DuplicateMessageDetector holding a steady number of live
+ * records, as when the host keeps sending reliable messages. Each iteration
+ * expires the oldest record, adds a new message and looks up the retry of a
+ * message received half a window ago.
+ *
+ * Usage:
+ *  chre_duplicate_message_detector_benchmark [iterations]
+ */
+
+using chre::DuplicateMessageDetector;
+using chre::Nanoseconds;
+using chre::platform_linux::SystemTimeOverride;
+
+namespace {
+
+constexpr uint32_t kDefaultIterations = 100000;
+constexpr uint16_t kNumHostEndpoints = 4;
+
+void runBenchmark(uint32_t liveMessages, uint32_t iterations) {
+  const Nanoseconds window(liveMessages);
+  DuplicateMessageDetector duplicateMessageDetector(window);
+
+  // Each message is added 1 ns after the previous one, so removeOldEntries()
+  // keeps the detector at liveMessages records once it has filled up.
+  SystemTimeOverride override(0);
+  uint32_t newMessagesFoundAsDuplicates = 0;
+  uint32_t retriesNotFound = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; ++i) {
+    override.update(i);
+    duplicateMessageDetector.removeOldEntries();
+
+    bool isDuplicate = true;
+    duplicateMessageDetector.findOrAdd(i, i % kNumHostEndpoints, &isDuplicate);
+    if (isDuplicate) {
+      newMessagesFoundAsDuplicates++;
+    }
+
+    if (i >= liveMessages / 2) {
+      uint32_t retried = i - liveMessages / 2;
+      if (!duplicateMessageDetector.findAndSetError(
+              retried, retried % kNumHostEndpoints, CHRE_ERROR_NONE)) {
+        retriesNotFound++;
+      }
+    }
+  }
+  auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  printf("%6" PRIu32 " live records %8.1f ns/iteration (%" PRIu32
+         " false duplicates, %" PRIu32 " missed retries)\n",
+         liveMessages, static_cast<double>(elapsedNs) / iterations,
+         newMessagesFoundAsDuplicates, retriesNotFound);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  uint32_t iterations = kDefaultIterations;
+  if (argc > 1) {
+    iterations = static_cast<uint32_t>(strtoul(argv[1], nullptr, 0));
+  }
+
+  constexpr uint32_t kLiveMessages[] = {64, 1024, 8192};
+  for (uint32_t liveMessages : kLiveMessages) {
+    runBenchmark(liveMessages, iterations);
+  }
+  return 0;
+}
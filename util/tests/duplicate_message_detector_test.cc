@@ -98,4 +98,40 @@ TEST(DuplicateMessageDetectorTest, RemoveOldEntriesDoesNotRemoveRecentEntries) {
   }
 }
 
+TEST(DuplicateMessageDetectorTest, DetectsDuplicatesAtSteadyStateCapacity) {
+  constexpr uint32_t kLiveMessages = 1024;
+  constexpr uint32_t kIterations = 100000;
+  constexpr uint16_t kNumHostEndpoints = 4;
+  constexpr Nanoseconds kWindow = Nanoseconds(kLiveMessages);
+  DuplicateMessageDetector duplicateMessageDetector(kWindow);
+
+  // Each message is added 1 ns after the previous one, so removeOldEntries()
+  // keeps the detector at kLiveMessages records once it has filled up.
+  SystemTimeOverride override(0);
+  uint32_t newMessagesFoundAsDuplicates = 0;
+  uint32_t retriesNotFound = 0;
+  for (uint32_t i = 0; i < kIterations; ++i) {
+    override.update(i);
+    duplicateMessageDetector.removeOldEntries();
+
+    bool isDuplicate = true;
+    duplicateMessageDetector.findOrAdd(i, i % kNumHostEndpoints, &isDuplicate);
+    if (isDuplicate) {
+      newMessagesFoundAsDuplicates++;
+    }
+
+    // A retry of a message received half a window ago is still detected
+    if (i >= kLiveMessages / 2) {
+      uint32_t retried = i - kLiveMessages / 2;
+      if (!duplicateMessageDetector.findAndSetError(
+              retried, retried % kNumHostEndpoints, CHRE_ERROR_NONE)) {
+        retriesNotFound++;
+      }
+    }
+  }
+
+  EXPECT_EQ(newMessagesFoundAsDuplicates, 0);
+  EXPECT_EQ(retriesNotFound, 0);
+}
+
 }  // namespace chre
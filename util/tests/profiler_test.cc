@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+
+#include "chre/util/nanoapp/profiler.h"
+
+using chre::ProfileHistogram;
+using chre::ProfileScopeTimer;
+
+TEST(ProfileHistogram, ComputesBucketIndices) {
+  EXPECT_EQ(ProfileHistogram::getBucketIndex(0), 0);
+  EXPECT_EQ(ProfileHistogram::getBucketIndex(1), 1);
+  EXPECT_EQ(ProfileHistogram::getBucketIndex(2), 2);
+  EXPECT_EQ(ProfileHistogram::getBucketIndex(3), 2);
+  EXPECT_EQ(ProfileHistogram::getBucketIndex(4), 3);
+  EXPECT_EQ(ProfileHistogram::getBucketIndex(1000), 10);
+  EXPECT_EQ(ProfileHistogram::getBucketIndex(1024), 11);
+  EXPECT_EQ(ProfileHistogram::getBucketIndex(UINT64_C(1) << 29), 30);
+  EXPECT_EQ(ProfileHistogram::getBucketIndex(UINT64_C(1) << 30),
+            ProfileHistogram::kNumBuckets - 1);
+  EXPECT_EQ(ProfileHistogram::getBucketIndex(UINT64_MAX),
+            ProfileHistogram::kNumBuckets - 1);
+}
+
+TEST(ProfileHistogram, AddsSamples) {
+  ProfileHistogram histogram("scope");
+  EXPECT_STREQ(histogram.getName(), "scope");
+  EXPECT_EQ(histogram.getCount(), 0);
+  EXPECT_EQ(histogram.getMinTicks(), UINT64_MAX);
+
+  histogram.addSample(5);
+  histogram.addSample(7);
+  histogram.addSample(1000);
+  EXPECT_EQ(histogram.getCount(), 3);
+  EXPECT_EQ(histogram.getTotalTicks(), 1012);
+  EXPECT_EQ(histogram.getMinTicks(), 5);
+  EXPECT_EQ(histogram.getMaxTicks(), 1000);
+  EXPECT_EQ(histogram.getBucketCount(3), 2);
+  EXPECT_EQ(histogram.getBucketCount(10), 1);
+  EXPECT_EQ(histogram.getBucketCount(0), 0);
+  EXPECT_EQ(histogram.getBucketCount(ProfileHistogram::kNumBuckets), 0);
+
+  histogram.reset();
+  EXPECT_EQ(histogram.getCount(), 0);
+  EXPECT_EQ(histogram.getTotalTicks(), 0);
+  EXPECT_EQ(histogram.getMaxTicks(), 0);
+  EXPECT_EQ(histogram.getBucketCount(3), 0);
+}
+
+TEST(ProfileHistogram, ScopeTimerAddsOneSample) {
+  ProfileHistogram histogram("scope");
+  {
+    ProfileScopeTimer timer(histogram);
+    EXPECT_EQ(histogram.getCount(), 0);
+  }
+  EXPECT_EQ(histogram.getCount(), 1);
+}
@@ -28,6 +28,7 @@
 
 using chre::platform_linux::SystemTimeOverride;
 using testing::_;
+using testing::ElementsAre;
 using testing::Return;
 
 namespace chre {
@@ -114,6 +115,19 @@ class FakeTransactionManagerCallback : public TransactionManagerCallback {
   std::vector<uint32_t> mFailures;
 };
 
+class BackoffTransactionManagerCallback
+    : public FakeTransactionManagerCallback {
+ public:
+  Nanoseconds getTransactionTimeout(uint32_t /*transactionId*/,
+                                    uint16_t /*groupId*/, uint8_t attemptCount,
+                                    Nanoseconds defaultTimeout) override {
+    mAttemptCounts.push_back(attemptCount);
+    return defaultTimeout * (1 << (attemptCount - 1));
+  }
+
+  std::vector<uint8_t> mAttemptCounts;
+};
+
 using TxnMgr = TransactionManager<kMaxTransactions, MockTimerPool>;
 using TxnMgrF = TransactionManager<kMaxTransactions, FakeTimerPool>;
 
@@ -348,4 +362,30 @@ TEST_F(TransactionManagerTest, CallbackUsesCorrectGroupId) {
   mFakeTimerPool.invokeNextTimer(mTime);
 }
 
+TEST_F(TransactionManagerTest, CallbackOverridesTimeout) {
+  BackoffTransactionManagerCallback cb;
+  TxnMgrF tm(cb, mFakeTimerPool, kTimeout, kMaxAttempts);
+
+  uint32_t id;
+  ASSERT_TRUE(tm.add(/*groupId=*/0, &id));
+
+  // Each retry should wait twice as long as the previous attempt
+  static_assert(kMaxAttempts == 3);
+  EXPECT_TRUE(mFakeTimerPool.invokeNextTimer(mTime));
+  EXPECT_EQ(SystemTime::getMonotonicTime().toRawNanoseconds(),
+            kTimeout.toRawNanoseconds());
+  EXPECT_TRUE(mFakeTimerPool.invokeNextTimer(mTime));
+  EXPECT_EQ(SystemTime::getMonotonicTime().toRawNanoseconds(),
+            (kTimeout * 3).toRawNanoseconds());
+  EXPECT_TRUE(mFakeTimerPool.invokeNextTimer(mTime));
+  EXPECT_EQ(SystemTime::getMonotonicTime().toRawNanoseconds(),
+            (kTimeout * 7).toRawNanoseconds());
+
+  EXPECT_THAT(cb.mAttemptCounts, ElementsAre(1, 2, 3));
+  EXPECT_EQ(cb.mTries.size(), kMaxAttempts);
+  ASSERT_EQ(cb.mFailures.size(), 1);
+  EXPECT_EQ(cb.mFailures[0], id);
+  EXPECT_FALSE(mFakeTimerPool.invokeNextTimer(mTime));
+}
+
 }  // namespace chre
@@ -18,6 +18,7 @@ COMMON_SRCS += $(CHRE_PREFIX)/util/nanoapp/audio.cc
 COMMON_SRCS += $(CHRE_PREFIX)/util/nanoapp/ble.cc
 COMMON_SRCS += $(CHRE_PREFIX)/util/nanoapp/callbacks.cc
 COMMON_SRCS += $(CHRE_PREFIX)/util/nanoapp/debug.cc
+COMMON_SRCS += $(CHRE_PREFIX)/util/nanoapp/profiler.cc
 COMMON_SRCS += $(CHRE_PREFIX)/util/nanoapp/string.cc
 COMMON_SRCS += $(CHRE_PREFIX)/util/nanoapp/wifi.cc
 COMMON_SRCS += $(CHRE_PREFIX)/util/system/ble_util.cc
@@ -42,6 +43,7 @@ GOOGLETEST_SRCS += $(CHRE_PREFIX)/util/tests/lock_guard_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/util/tests/memory_pool_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/util/tests/optional_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/util/tests/priority_queue_test.cc
+GOOGLETEST_SRCS += $(CHRE_PREFIX)/util/tests/profiler_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/util/tests/raw_storage_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/util/tests/ref_base_test.cc
 GOOGLETEST_SRCS += $(CHRE_PREFIX)/util/tests/segmented_queue_test.cc
@@ -24,6 +24,7 @@ GOOGLE_X86_LINUX_CFLAGS += -fexceptions
 CHRE_AUDIO_SUPPORT_ENABLED = true
 CHRE_BLE_SUPPORT_ENABLED = true
 CHRE_GNSS_SUPPORT_ENABLED = true
+CHRE_HOST_MESSAGE_BATCHING_ENABLED = true
 CHRE_SENSORS_SUPPORT_ENABLED = true
 CHRE_WIFI_SUPPORT_ENABLED = true
 CHRE_WIFI_NAN_SUPPORT_ENABLED = true